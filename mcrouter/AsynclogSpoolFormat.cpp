@@ -0,0 +1,245 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "AsynclogSpoolFormat.h"
+
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <folly/Conv.h>
+#include <folly/Format.h>
+#include <folly/json.h>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+namespace {
+
+// Fixed part of a record: magic, version, op, port, timestamp.
+constexpr size_t kRecordHeaderSize = 4 + 1 + 1 + 2 + 8;
+
+// The mmap'd window the writer appends through. Large enough that
+// remaps are rare, small enough that a crash wastes little spool
+// preallocation.
+constexpr size_t kSpoolWindowSize = 1u << 20;
+
+void appendLE(std::string& out, uint64_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; ++i) {
+    out.push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+uint64_t readLE(const uint8_t* p, size_t bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; ++i) {
+    value |= static_cast<uint64_t>(p[i]) << (8 * i);
+  }
+  return value;
+}
+
+void appendVarint(std::string& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+bool readVarint(folly::StringPiece& buffer, uint64_t& value) {
+  value = 0;
+  for (size_t shift = 0; shift < 64; shift += 7) {
+    if (buffer.empty()) {
+      return false;
+    }
+    const uint8_t byte = buffer.front();
+    buffer.advance(1);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void appendString(std::string& out, folly::StringPiece s) {
+  appendVarint(out, s.size());
+  out.append(s.data(), s.size());
+}
+
+bool readString(folly::StringPiece& buffer, folly::StringPiece& s) {
+  uint64_t len;
+  if (!readVarint(buffer, len) || buffer.size() < len) {
+    return false;
+  }
+  s = buffer.subpiece(0, len);
+  buffer.advance(len);
+  return true;
+}
+
+size_t pageFloor(size_t offset) {
+  static const size_t pageSize = sysconf(_SC_PAGESIZE);
+  return offset & ~(pageSize - 1);
+}
+
+} // anonymous namespace
+
+void serializeAsynclogRecord(const AsynclogBinaryRecord& record,
+                             std::string& out) {
+  appendLE(out, kAsynclogBinaryMagic, 4);
+  out.push_back(static_cast<char>(kAsynclogBinaryVersion));
+  out.push_back(record.op);
+  appendLE(out, record.port, 2);
+  appendLE(out, record.timestampMs, 8);
+  appendString(out, record.flavor);
+  appendString(out, record.host);
+  appendString(out, record.pool);
+  appendString(out, record.key);
+}
+
+bool parseAsynclogRecord(folly::StringPiece& buffer,
+                         AsynclogBinaryRecord& record) {
+  auto cursor = buffer;
+  if (cursor.size() < kRecordHeaderSize) {
+    return false;
+  }
+  const auto* header = reinterpret_cast<const uint8_t*>(cursor.data());
+  if (readLE(header, 4) != kAsynclogBinaryMagic ||
+      header[4] != kAsynclogBinaryVersion) {
+    return false;
+  }
+  record.op = static_cast<char>(header[5]);
+  record.port = static_cast<uint16_t>(readLE(header + 6, 2));
+  record.timestampMs = readLE(header + 8, 8);
+  cursor.advance(kRecordHeaderSize);
+
+  if (!readString(cursor, record.flavor) ||
+      !readString(cursor, record.host) ||
+      !readString(cursor, record.pool) ||
+      !readString(cursor, record.key)) {
+    return false;
+  }
+  buffer = cursor;
+  return true;
+}
+
+std::string asynclogRecordToJsonLine(const AsynclogBinaryRecord& record) {
+  folly::dynamic json = folly::dynamic::object;
+  json["f"] = record.flavor.str();
+  json["h"] = folly::sformat("[{}]:{}", record.host, record.port);
+  json["p"] = record.pool.str();
+  json["k"] = record.key.str();
+
+  folly::dynamic jsonOut = folly::dynamic::array;
+  jsonOut.push_back("AS2.0");
+  jsonOut.push_back(1e-3 * record.timestampMs);
+  jsonOut.push_back(std::string(1, record.op));
+  jsonOut.push_back(json);
+  return folly::to<std::string>(folly::toJson(jsonOut)) + "\n";
+}
+
+AsynclogSpoolWriter::~AsynclogSpoolWriter() {
+  finalize();
+}
+
+bool AsynclogSpoolWriter::attach(std::shared_ptr<folly::File> file) {
+  if (file == file_) {
+    return window_ != nullptr;
+  }
+  finalize();
+  if (!file) {
+    return false;
+  }
+
+  const off_t end = lseek(file->fd(), 0, SEEK_END);
+  if (end < 0) {
+    return false;
+  }
+  file_ = std::move(file);
+  fileEnd_ = syncedEnd_ = allocatedSize_ = size_t(end);
+  if (!remap(pageFloor(fileEnd_))) {
+    file_.reset();
+    return false;
+  }
+  return true;
+}
+
+bool AsynclogSpoolWriter::append(folly::StringPiece bytes) {
+  if (window_ == nullptr || bytes.size() > kSpoolWindowSize) {
+    return false;
+  }
+  if (fileEnd_ + bytes.size() > windowStart_ + kSpoolWindowSize) {
+    sync();
+    if (!remap(pageFloor(fileEnd_))) {
+      // Detach so the caller's write syscall fallback starts from a
+      // trimmed file with a correct offset.
+      finalize();
+      return false;
+    }
+  }
+  memcpy(static_cast<char*>(window_) + (fileEnd_ - windowStart_),
+         bytes.data(), bytes.size());
+  fileEnd_ += bytes.size();
+  return true;
+}
+
+void AsynclogSpoolWriter::sync() {
+  if (window_ == nullptr || syncedEnd_ >= fileEnd_) {
+    return;
+  }
+  const size_t from = std::max(windowStart_, pageFloor(syncedEnd_));
+  msync(static_cast<char*>(window_) + (from - windowStart_),
+        fileEnd_ - from, MS_SYNC);
+  syncedEnd_ = fileEnd_;
+}
+
+bool AsynclogSpoolWriter::remap(size_t windowStart) {
+  if (window_ != nullptr) {
+    munmap(window_, kSpoolWindowSize);
+    window_ = nullptr;
+  }
+  const size_t needed = windowStart + kSpoolWindowSize;
+  if (needed > allocatedSize_) {
+    if (ftruncate(file_->fd(), needed) != 0) {
+      return false;
+    }
+    allocatedSize_ = needed;
+  }
+  void* window = mmap(nullptr, kSpoolWindowSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, file_->fd(), off_t(windowStart));
+  if (window == MAP_FAILED) {
+    return false;
+  }
+  window_ = window;
+  windowStart_ = windowStart;
+  return true;
+}
+
+void AsynclogSpoolWriter::finalize() {
+  if (window_ != nullptr) {
+    sync();
+    munmap(window_, kSpoolWindowSize);
+    window_ = nullptr;
+  }
+  if (file_) {
+    if (allocatedSize_ > fileEnd_) {
+      // Trim the preallocation so readers never see the zeroed tail.
+      ftruncate(file_->fd(), off_t(fileEnd_));
+    }
+    // Leave the offset where the data ends, in case the caller falls
+    // back to write syscalls on this fd (it is not opened O_APPEND
+    // when freshly created).
+    lseek(file_->fd(), off_t(fileEnd_), SEEK_SET);
+    file_.reset();
+  }
+  windowStart_ = fileEnd_ = syncedEnd_ = allocatedSize_ = 0;
+}
+
+}}} // facebook::memcache::mcrouter
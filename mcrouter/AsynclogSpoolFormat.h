@@ -0,0 +1,125 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <folly/File.h>
+#include <folly/Range.h>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Binary asynclog spool format ("ASB", version 1).
+ *
+ * Each record is self-contained: a fixed little-endian header followed
+ * by four varint-length-prefixed strings (flavor, host, pool, key).
+ * Varints use the same LEB128 encoding as Carbon serialization. A
+ * record carries the same information as an asynclog version 2.0 JSON
+ * line at roughly a fifth of the bytes, with no JSON escaping on the
+ * write path and no parsing ambiguity on replay.
+ *
+ * Consumers that only understand the JSON formats can convert spools
+ * offline with mcasynclogconvert (mcrouter/tools/mcasynclogconvert).
+ */
+
+constexpr uint32_t kAsynclogBinaryMagic = 0x31425341;  // "ASB1" on disk
+constexpr uint8_t kAsynclogBinaryVersion = 1;
+
+struct AsynclogBinaryRecord {
+  uint64_t timestampMs{0};
+  uint16_t port{0};
+  /** Operation code; 'C' for delete, matching the JSON formats. */
+  char op{'C'};
+  folly::StringPiece flavor;
+  folly::StringPiece host;
+  folly::StringPiece pool;
+  folly::StringPiece key;
+};
+
+/**
+ * Appends the serialized form of 'record' to 'out'.
+ */
+void serializeAsynclogRecord(const AsynclogBinaryRecord& record,
+                             std::string& out);
+
+/**
+ * Parses one record from the front of 'buffer', advancing it past the
+ * record on success. The StringPieces of 'record' point into 'buffer'.
+ *
+ * @return false on bad magic, unknown version or truncation; 'buffer'
+ *         is left unchanged in that case.
+ */
+bool parseAsynclogRecord(folly::StringPiece& buffer,
+                         AsynclogBinaryRecord& record);
+
+/**
+ * Renders a record as the equivalent asynclog version 2.0 JSON line
+ * (newline-terminated), for consumers of the old format.
+ */
+std::string asynclogRecordToJsonLine(const AsynclogBinaryRecord& record);
+
+/**
+ * Appends to a spool file through an mmap'd window, msync'ing
+ * page-aligned ranges instead of issuing one write syscall per batch.
+ *
+ * The writer owns a reference to the file it is attached to; attach()
+ * with a different file (spools rotate hourly) or destruction finalizes
+ * the previous one, trimming the preallocated tail back to the bytes
+ * actually written. Not thread safe; meant to live on the awriter
+ * thread.
+ */
+class AsynclogSpoolWriter {
+ public:
+  AsynclogSpoolWriter() = default;
+  ~AsynclogSpoolWriter();
+
+  AsynclogSpoolWriter(const AsynclogSpoolWriter&) = delete;
+  AsynclogSpoolWriter& operator=(const AsynclogSpoolWriter&) = delete;
+
+  /**
+   * Points the writer at 'file', finalizing the previously attached
+   * file if it differs.
+   *
+   * @return false if the file could not be mapped; the writer is left
+   *         detached and the caller should fall back to write syscalls.
+   */
+  bool attach(std::shared_ptr<folly::File> file);
+
+  /**
+   * Copies 'bytes' to the end of the attached file, growing and
+   * remapping the window as needed. The data is durable only after the
+   * next sync().
+   */
+  bool append(folly::StringPiece bytes);
+
+  /**
+   * msync's everything appended since the last sync().
+   */
+  void sync();
+
+ private:
+  bool remap(size_t windowStart);
+  void finalize();
+
+  std::shared_ptr<folly::File> file_;
+  void* window_{nullptr};
+  /** File offset the mapped window starts at; page aligned. */
+  size_t windowStart_{0};
+  /** End of written data, as a file offset. */
+  size_t fileEnd_{0};
+  /** File offset up to which data was msync'ed. */
+  size_t syncedEnd_{0};
+  /** Size the file was ftruncate'd to; >= fileEnd_ while attached. */
+  size_t allocatedSize_{0};
+};
+
+}}} // facebook::memcache::mcrouter
@@ -9,11 +9,10 @@
  */
 #include <mutex>
 #include <set>
+#include <vector>
 
 #include <glog/logging.h>
 
-#include "mcrouter/lib/fbi/cpp/sfrlock.h"
-
 namespace facebook { namespace memcache { namespace mcrouter {
 
 /* CallbackPool::CallbackHandle */
@@ -23,28 +22,53 @@ struct CallbackPool<Args...>::CallbackHandleImpl {
   CallbackHandleImpl(const CallbackHandleImpl&) = delete;
   CallbackHandleImpl& operator=(const CallbackHandleImpl&) = delete;
   ~CallbackHandleImpl() {
-    std::lock_guard<SFRWriteLock> lck(data_->callbackLock.writeLock());
+    std::lock_guard<std::mutex> lck(data_->mutex);
     data_->callbacks.erase(this);
+    data_->publishSnapshot();
   }
  private:
   friend class CallbackPool;
 
   std::shared_ptr<Data> data_;
-  const OnUpdateFunc func_;
+  const std::shared_ptr<const OnUpdateFunc> func_;
 
   CallbackHandleImpl(std::shared_ptr<Data> data, OnUpdateFunc func)
       : data_(std::move(data)),
-        func_(std::move(func)) {
-    std::lock_guard<SFRWriteLock> lck(data_->callbackLock.writeLock());
+        func_(std::make_shared<const OnUpdateFunc>(std::move(func))) {
+    std::lock_guard<std::mutex> lck(data_->mutex);
     data_->callbacks.insert(this);
+    data_->publishSnapshot();
   }
 };
 
 /* CallbackPool::Data */
 template<typename... Args>
 struct CallbackPool<Args...>::Data {
+  /**
+   * Immutable list of subscribed callbacks, replaced wholesale on every
+   * subscribe/unsubscribe and read with an atomic load on 'notify'.
+   * Callbacks are held by shared_ptr so an in-flight 'notify' keeps the
+   * functions it loaded alive even if their handles are destroyed meanwhile.
+   */
+  typedef std::vector<std::shared_ptr<const OnUpdateFunc>> Snapshot;
+
   std::set<CallbackHandleImpl*> callbacks;
-  SFRLock callbackLock;
+  std::shared_ptr<const Snapshot> snapshot;
+  // guards 'callbacks' and snapshot publication; never held during 'notify'
+  std::mutex mutex;
+
+  // must be called with 'mutex' held
+  void publishSnapshot() {
+    auto next = std::make_shared<Snapshot>();
+    next->reserve(callbacks.size());
+    for (auto handle : callbacks) {
+      next->push_back(handle->func_);
+    }
+    std::atomic_store_explicit(
+        &snapshot,
+        std::shared_ptr<const Snapshot>(std::move(next)),
+        std::memory_order_release);
+  }
 };
 
 /* CallbackPool */
@@ -56,10 +80,14 @@ CallbackPool<Args...>::CallbackPool()
 
 template<typename... Args>
 void CallbackPool<Args...>::notify(Args... args) {
-  std::lock_guard<SFRReadLock> lck(data_->callbackLock.readLock());
-  for (auto& it : data_->callbacks) {
+  auto snapshot = std::atomic_load_explicit(
+      &data_->snapshot, std::memory_order_acquire);
+  if (!snapshot) {
+    return;
+  }
+  for (const auto& func : *snapshot) {
     try {
-      it->func_(args...);
+      (*func)(args...);
     } catch (const std::exception& e) {
       LOG(ERROR) << "Error occured in callback: " << e.what();
     } catch (...) {
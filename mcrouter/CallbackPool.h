@@ -39,6 +39,8 @@ class CallbackPool {
   /**
    * Callback handle for this CallbackPool. Once it is destroyed corresponding
    * callback will be unsubscribed.
+   * NOTE: a 'notify' that is already in flight on another thread may still
+   * invoke the callback one last time after the handle is destroyed.
    */
   typedef std::unique_ptr<CallbackHandleImpl> CallbackHandle;
 
@@ -53,6 +55,8 @@ class CallbackPool {
 
   /**
    * Call all subscribed callbacks. Order of callbacks is undefined.
+   * Runs on an immutable snapshot of the subscribers without holding any
+   * lock, so subscription changes never block behind callback invocation.
    */
   void notify(Args... args);
  private:
@@ -0,0 +1,77 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "CompressionLevelController.h"
+
+#include <algorithm>
+
+#include <folly/io/async/EventBase.h>
+
+#include "mcrouter/lib/CompressionCodecManager.h"
+#include "mcrouter/McrouterInstanceBase.h"
+#include "mcrouter/McrouterLogFailure.h"
+#include "mcrouter/Proxy.h"
+
+namespace facebook {
+namespace memcache {
+namespace mcrouter {
+
+namespace {
+
+constexpr uint32_t kAdjustIntervalMs = 100;
+
+} // anonymous namespace
+
+CompressionLevelController::CompressionLevelController(Proxy& proxy)
+    : proxy_(proxy),
+      timer_(*this),
+      minLevel_(std::max(
+          1u,
+          proxy.getRouterOptions().adaptive_compression_min_level)),
+      maxLevel_(std::max(
+          minLevel_,
+          proxy.getRouterOptions().adaptive_compression_max_level)),
+      targetLagUs_(proxy.getRouterOptions().adaptive_compression_target_lag_us),
+      level_(maxLevel_) {}
+
+void CompressionLevelController::attachEventBase(folly::EventBase& evb) {
+  timer_.attachEventBase(&evb);
+  timerCallback();
+}
+
+void CompressionLevelController::timerCallback() {
+  const int64_t lagUs = proxy_.queueDrainIntervalUs();
+
+  auto level = level_.load(std::memory_order_relaxed);
+  if (lagUs > targetLagUs_ && level > minLevel_) {
+    // The event loop is falling behind; shed compression CPU.
+    --level;
+  } else if (lagUs * 2 < targetLagUs_ && level < maxLevel_) {
+    // Plenty of headroom; claw compression ratio back.
+    ++level;
+  }
+  level_.store(level, std::memory_order_relaxed);
+
+  // Applied every window, not just on changes: the thread's codec map
+  // may have been rebuilt (at configured levels) by a config rollover
+  // since the last one.
+  if (const auto* codecManager = proxy_.router().getCodecManager()) {
+    codecManager->getCodecMap()->limitCompressionLevel(level);
+  }
+
+  if (!timer_.scheduleTimeout(kAdjustIntervalMs)) {
+    MC_LOG_FAILURE(proxy_.getRouterOptions(),
+                   memcache::failure::Category::kSystemError,
+                   "failed to schedule adaptive compression timer");
+  }
+}
+
+} // mcrouter
+} // memcache
+} // facebook
@@ -0,0 +1,76 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+
+#include "mcrouter/AsyncTimer.h"
+
+namespace folly {
+class EventBase;
+} // folly
+
+namespace facebook {
+namespace memcache {
+namespace mcrouter {
+
+class Proxy;
+
+/**
+ * Adapts the reply compression level to the CPU headroom of a proxy
+ * thread, so compression sheds load during traffic peaks and claws
+ * ratio back during troughs.
+ *
+ * The load signal is the smoothed interval between message queue drains
+ * (see MessageQueue::avgDrainIntervalUs()): the queue is drained once
+ * per event loop iteration that notices it, so when routing work
+ * saturates the thread the interval stretches well past the
+ * notification period. Each adjustment window the controller steps the
+ * level down one notch while the interval is above the configured
+ * target lag, and probes one notch back up once the interval drops
+ * below half of it. The level moves within
+ * [adaptive_compression_min_level, adaptive_compression_max_level] and
+ * never raises a codec above its configured level (see
+ * CompressionCodecMap::limitCompressionLevel()).
+ *
+ * Must be created on and driven by the proxy's event base thread. The
+ * level in effect is exported as the adaptive_compression_level stat.
+ */
+class CompressionLevelController {
+ public:
+  explicit CompressionLevelController(Proxy& proxy);
+
+  /**
+   * Starts the periodic adjustment cycle on the proxy's event base.
+   */
+  void attachEventBase(folly::EventBase& evb);
+
+  /**
+   * Compression level currently in effect. Can be read from any thread.
+   */
+  uint32_t currentLevel() const noexcept {
+    return level_.load(std::memory_order_relaxed);
+  }
+
+  void timerCallback();
+
+ private:
+  Proxy& proxy_;
+  AsyncTimer<CompressionLevelController> timer_;
+
+  const uint32_t minLevel_;
+  const uint32_t maxLevel_;
+  const int64_t targetLagUs_;
+  std::atomic<uint32_t> level_;
+};
+
+} // mcrouter
+} // memcache
+} // facebook
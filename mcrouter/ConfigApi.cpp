@@ -29,6 +29,9 @@ const char* const kMcrouterConfigKey = "mcrouter_config";
 const char* const kConfigFile = "config_file";
 const char* const kConfigImport = "config_import";
 const int kConfigReloadInterval = 60;
+/* Limit on settling rounds, so constantly changing files can not delay
+   reconfiguration forever. */
+const size_t kMaxSettleRounds = 10;
 
 const char* const ConfigApi::kFilePrefix = "file:";
 
@@ -76,8 +79,15 @@ bool ConfigApi::checkFileUpdate() {
     // hasUpdate reads events from inotify, so we need to poll all
     // providers to reconfigure only once when multiple files have changed
     try {
-      if (file.provider) {
-        hasUpdate |= file.provider->hasUpdate();
+      if (file.provider && file.provider->hasUpdate()) {
+        try {
+          // config pushes touch files without necessarily changing them;
+          // rebuild only if contents actually changed
+          hasUpdate |= file.checkMd5Changed();
+        } catch (const std::exception&) {
+          // file is being replaced right now, assume it changed
+          hasUpdate = true;
+        }
       }
     } catch (const std::exception& e) {
       LOG(ERROR) << "Check " << file.path << " for update failed: "
@@ -109,10 +119,16 @@ void ConfigApi::configThreadRun() {
     return;
   }
 
-  while (!finish_) {
-    bool hasUpdate = false;
+  auto waitReconfigurationDelay = [this] {
+    std::unique_lock<std::mutex> lk(finishMutex_);
+    finishCV_.wait_for(
+      lk, std::chrono::milliseconds(opts_.reconfiguration_delay_ms),
+      [this] { return finish_.load(); });
+  };
+
+  auto checkFileUpdateSafe = [this] {
     try {
-      hasUpdate = checkFileUpdate();
+      return checkFileUpdate();
     } catch (const std::exception& e) {
       MC_LOG_FAILURE(opts_, memcache::failure::Category::kOther,
                      "Check for config update failed: {}", e.what());
@@ -120,6 +136,11 @@ void ConfigApi::configThreadRun() {
       MC_LOG_FAILURE(opts_, memcache::failure::Category::kOther,
                      "Check for config update failed with unknown error");
     }
+    return false;
+  };
+
+  while (!finish_) {
+    bool hasUpdate = checkFileUpdateSafe();
     // There are a couple of races that can happen here
     // First, the IN_MODIFY event can be fired before the write is complete,
     // resulting in a malformed JSON error. Second, text editors may do
@@ -130,16 +151,21 @@ void ConfigApi::configThreadRun() {
     // watch for IN_MODIFY to IN_CLOSE_WRITE, but Race 2 has no apparent
     // elegant solution. The following jankiness fixes both.
 
-    {
-      std::unique_lock<std::mutex> lk(finishMutex_);
-      finishCV_.wait_for(
-        lk, std::chrono::milliseconds(opts_.reconfiguration_delay_ms),
-        [this] { return finish_.load(); });
-
-    }
+    waitReconfigurationDelay();
 
     if (hasUpdate) {
-      callbacks_.notify();
+      // A config push typically touches many files over a short period.
+      // Let it settle: keep absorbing updates until a full delay passes
+      // without further changes, so one push costs one rebuild.
+      size_t settleRounds = 0;
+      while (!finish_ && settleRounds < kMaxSettleRounds &&
+             checkFileUpdateSafe()) {
+        ++settleRounds;
+        waitReconfigurationDelay();
+      }
+      if (!finish_) {
+        callbacks_.notify();
+      }
     }
 
     // Otherwise there was nothing to read, so check that we aren't shutting
@@ -0,0 +1,152 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "HotKeyTracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+#include <folly/Hash.h>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+namespace {
+
+/** Counters are halved this often, bounding how stale an estimate gets */
+constexpr int64_t kDecayIntervalUs = 10 * 1000 * 1000;
+/** Minimum interval between top-K snapshot publishes */
+constexpr int64_t kPublishIntervalUs = 1000 * 1000;
+
+/**
+ * With counters halved every T seconds, a steady rate of R req/s
+ * oscillates between R*T (right after a halving) and 2*R*T (right
+ * before one), so the midpoint maps an estimate back to a rate.
+ */
+constexpr double kEstimateToQps = 1.0 / (1.5 * (kDecayIntervalUs / 1e6));
+
+} // anonymous namespace
+
+void HotKeyTracker::touch(folly::StringPiece key, int64_t nowUs) {
+  if (nowUs - lastDecayUs_ >= kDecayIntervalUs) {
+    decay(nowUs);
+  }
+
+  /* Standard double-hashing scheme: row i uses h1 + i*h2, so one key
+     hash drives all rows. */
+  const uint64_t h1 = folly::hash::fnv64_buf(key.data(), key.size());
+  const uint64_t h2 = folly::hash::twang_mix64(h1);
+  uint32_t estimate = std::numeric_limits<uint32_t>::max();
+  for (size_t row = 0; row < kRows; ++row) {
+    auto& count = counts_[row][(h1 + row * h2) % kCols];
+    if (count != std::numeric_limits<uint32_t>::max()) {
+      ++count;
+    }
+    estimate = std::min(estimate, count);
+  }
+
+  if (estimate > topKeysMin_ ||
+      topKeys_.size() < kTopK) {
+    updateTopK(key, estimate);
+  }
+
+  if (topKeysDirty_ && nowUs - lastPublishUs_ >= kPublishIntervalUs) {
+    publish(nowUs);
+  }
+}
+
+void HotKeyTracker::decay(int64_t nowUs) {
+  /* First call just starts the window */
+  if (lastDecayUs_ != 0) {
+    for (auto& row : counts_) {
+      for (auto& count : row) {
+        count /= 2;
+      }
+    }
+    for (auto it = topKeys_.begin(); it != topKeys_.end();) {
+      it->second /= 2;
+      if (it->second == 0) {
+        it = topKeys_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    topKeysMin_ = 0;
+    if (topKeys_.size() == kTopK) {
+      for (const auto& it : topKeys_) {
+        topKeysMin_ = topKeysMin_ == 0
+          ? it.second
+          : std::min(topKeysMin_, it.second);
+      }
+    }
+    topKeysDirty_ = true;
+  }
+  lastDecayUs_ = nowUs;
+}
+
+void HotKeyTracker::updateTopK(folly::StringPiece key, uint32_t estimate) {
+  auto it = topKeys_.find(key);
+  if (it != topKeys_.end()) {
+    it->second = std::max(it->second, estimate);
+  } else {
+    if (topKeys_.size() >= kTopK) {
+      auto coldest = topKeys_.begin();
+      for (auto candidate = topKeys_.begin(); candidate != topKeys_.end();
+           ++candidate) {
+        if (candidate->second < coldest->second) {
+          coldest = candidate;
+        }
+      }
+      if (coldest->second >= estimate) {
+        /* Lost the race against a sketch collision; keep what we have */
+        topKeysMin_ = coldest->second;
+        return;
+      }
+      topKeys_.erase(coldest);
+    }
+    topKeys_[key] = estimate;
+  }
+
+  topKeysMin_ = 0;
+  if (topKeys_.size() == kTopK) {
+    for (const auto& entry : topKeys_) {
+      topKeysMin_ = topKeysMin_ == 0
+        ? entry.second
+        : std::min(topKeysMin_, entry.second);
+    }
+  }
+  topKeysDirty_ = true;
+}
+
+void HotKeyTracker::publish(int64_t nowUs) {
+  auto hotKeys = std::make_shared<std::vector<HotKey>>();
+  hotKeys->reserve(topKeys_.size());
+  for (const auto& entry : topKeys_) {
+    hotKeys->push_back(
+      HotKey{entry.first.str(), entry.second * kEstimateToQps});
+  }
+  std::sort(hotKeys->begin(), hotKeys->end(),
+            [](const HotKey& a, const HotKey& b) {
+              return a.estimatedQps > b.estimatedQps;
+            });
+  std::atomic_store_explicit(
+    &published_,
+    std::shared_ptr<const std::vector<HotKey>>(std::move(hotKeys)),
+    std::memory_order_release);
+  lastPublishUs_ = nowUs;
+  topKeysDirty_ = false;
+}
+
+std::vector<HotKeyTracker::HotKey> HotKeyTracker::snapshot() const {
+  auto hotKeys =
+    std::atomic_load_explicit(&published_, std::memory_order_acquire);
+  return hotKeys == nullptr ? std::vector<HotKey>() : *hotKeys;
+}
+
+}}}  // facebook::memcache::mcrouter
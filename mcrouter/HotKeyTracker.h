@@ -0,0 +1,87 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/experimental/StringKeyedUnorderedMap.h>
+#include <folly/Range.h>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Always-on hot key detector.
+ *
+ * A small count-min sketch estimates per-key request rates and feeds a
+ * top-K table of the hottest keys.  touch() runs on the proxy thread
+ * for every keyed request and costs a few hashes and counter bumps;
+ * keys are only materialized when they enter the top-K.  Counters are
+ * halved periodically, so estimates decay toward the recent request
+ * rate instead of accumulating forever.
+ *
+ * The proxy thread publishes a snapshot of the top-K at most once a
+ * second; snapshot() hands it out to any thread, so pollers (the
+ * "hot_keys" ServiceInfo command) never touch the live sketch.
+ */
+class HotKeyTracker {
+ public:
+  struct HotKey {
+    std::string key;
+    /** Approximate requests/second over the recent decay window. */
+    double estimatedQps;
+  };
+
+  /** Records one request for key.  Proxy thread only. */
+  void touch(folly::StringPiece key, int64_t nowUs);
+
+  /**
+   * True if key is currently in the live top-K.  Proxy thread only;
+   * one hash lookup, no allocation.
+   */
+  bool isHot(folly::StringPiece key) const {
+    return topKeys_.find(key) != topKeys_.end();
+  }
+
+  /**
+   * The most recently published top-K, hottest first.  Safe to call
+   * from any thread; may lag the live sketch by up to a second.
+   */
+  std::vector<HotKey> snapshot() const;
+
+ private:
+  static constexpr size_t kRows = 4;
+  /** Must be a power of two */
+  static constexpr size_t kCols = 1024;
+  static constexpr size_t kTopK = 16;
+
+  void decay(int64_t nowUs);
+  void updateTopK(folly::StringPiece key, uint32_t estimate);
+  void publish(int64_t nowUs);
+
+  std::array<std::array<uint32_t, kCols>, kRows> counts_{};
+
+  /** Hottest keys by decayed sketch estimate */
+  folly::StringKeyedUnorderedMap<uint32_t> topKeys_;
+  /** Smallest estimate in topKeys_ once it is full; 0 while it isn't */
+  uint32_t topKeysMin_{0};
+
+  int64_t lastDecayUs_{0};
+  int64_t lastPublishUs_{0};
+  bool topKeysDirty_{false};
+
+  /** Published snapshot; accessed with atomic shared_ptr loads/stores */
+  std::shared_ptr<const std::vector<HotKey>> published_;
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,108 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Fixed-size log-linear histogram of latency samples (microseconds).
+ *
+ * Each power-of-two range is split into 16 linear sub-buckets, so any
+ * percentile estimate is within ~6% of the true value while inserts stay
+ * a handful of bit operations and one array increment.  Samples of
+ * 2^26 us (~67 seconds) and above all land in the last bucket.
+ *
+ * Not synchronized: written from the owning proxy thread; the stats
+ * thread reads the plain counters racily, same as the rest of the
+ * per-destination stats.
+ */
+class LatencyHistogram {
+ public:
+  void insertSample(uint64_t sampleUs) {
+    ++buckets_[bucketOf(sampleUs)];
+    ++count_;
+  }
+
+  void merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+      buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+  }
+
+  uint64_t count() const {
+    return count_;
+  }
+
+  /**
+   * Estimated value (us) below which `pct` percent of the samples fall,
+   * interpolated linearly within the bucket holding that rank.
+   * Returns 0 if no samples were recorded.
+   */
+  double getPercentile(double pct) const {
+    if (count_ == 0) {
+      return 0.0;
+    }
+    const double rank = pct / 100.0 * count_;
+    uint64_t cum = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+      if (buckets_[i] == 0) {
+        continue;
+      }
+      cum += buckets_[i];
+      if (cum >= rank) {
+        const double fraction =
+            1.0 - (cum - rank) / static_cast<double>(buckets_[i]);
+        return bucketLowerBound(i) + fraction * bucketWidth(i);
+      }
+    }
+    return bucketLowerBound(kBucketCount - 1) + bucketWidth(kBucketCount - 1);
+  }
+
+ private:
+  static constexpr size_t kSubBucketBits = 4;
+  static constexpr size_t kSubBuckets = 1ULL << kSubBucketBits;
+  // Ranges 0..22 cover [0, 2^26) us; the linear range 0 plus one range
+  // per additional bit of magnitude.
+  static constexpr size_t kRanges = 23;
+  static constexpr size_t kBucketCount = kRanges * kSubBuckets;
+
+  static size_t bucketOf(uint64_t us) {
+    if (us < kSubBuckets) {
+      return us;
+    }
+    const size_t msb = 63 - __builtin_clzll(us);
+    const size_t range = msb - (kSubBucketBits - 1);
+    if (range >= kRanges) {
+      return kBucketCount - 1;
+    }
+    return range * kSubBuckets + (us >> (range - 1)) - kSubBuckets;
+  }
+
+  static uint64_t bucketWidth(size_t bucket) {
+    const size_t range = bucket >> kSubBucketBits;
+    return range == 0 ? 1 : 1ULL << (range - 1);
+  }
+
+  static uint64_t bucketLowerBound(size_t bucket) {
+    const size_t range = bucket >> kSubBucketBits;
+    const size_t sub = bucket & (kSubBuckets - 1);
+    return range == 0 ? sub : (kSubBuckets + sub) << (range - 1);
+  }
+
+  std::array<uint64_t, kBucketCount> buckets_{};
+  uint64_t count_{0};
+};
+
+}}}  // facebook::memcache::mcrouter
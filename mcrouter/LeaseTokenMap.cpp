@@ -25,6 +25,8 @@ inline uint64_t applyMagic(uint32_t id) {
 
 } // anonymous
 
+constexpr size_t LeaseTokenMap::kNumShards;
+
 LeaseTokenMap::LeaseTokenMap(folly::ScopedEventBaseThread& evbThread,
                              uint32_t leaseTokenTtl)
     : evbThread_(evbThread),
@@ -46,16 +48,17 @@ LeaseTokenMap::~LeaseTokenMap() {
 }
 
 uint64_t LeaseTokenMap::insert(std::string routeName, Item item) {
-  std::lock_guard<std::mutex> lock(mutex_);
-
-  uint64_t specialToken = applyMagic(nextId_++);
-
-  auto it = data_.emplace(specialToken,
-                          LeaseTokenMap::ListItem(specialToken,
-                                                  std::move(routeName),
-                                                  std::move(item),
-                                                  leaseTokenTtlMs_));
-  invalidationQueue_.push_back(it.first->second);
+  uint64_t specialToken =
+      applyMagic(nextId_.fetch_add(1, std::memory_order_relaxed));
+  auto& shard = shardForToken(specialToken);
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.data.emplace(specialToken,
+                               LeaseTokenMap::ListItem(specialToken,
+                                                       std::move(routeName),
+                                                       std::move(item),
+                                                       leaseTokenTtlMs_));
+  shard.invalidationQueue.push_back(it.first->second);
 
   return specialToken;
 }
@@ -69,11 +72,12 @@ folly::Optional<LeaseTokenMap::Item> LeaseTokenMap::query(
   }
 
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = data_.find(token);
-    if (it != data_.end() && it->second.routeName == routeName) {
+    auto& shard = shardForToken(token);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.data.find(token);
+    if (it != shard.data.end() && it->second.routeName == routeName) {
       item.emplace(std::move(it->second.item));
-      data_.erase(it);
+      shard.data.erase(it);
     }
   }
 
@@ -87,9 +91,10 @@ uint64_t LeaseTokenMap::getOriginalLeaseToken(folly::StringPiece routeName,
   }
 
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = data_.find(token);
-    if (it != data_.end() && it->second.routeName == routeName) {
+    const auto& shard = shardForToken(token);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.data.find(token);
+    if (it != shard.data.end() && it->second.routeName == routeName) {
       return it->second.item.originalToken;
     }
   }
@@ -97,28 +102,41 @@ uint64_t LeaseTokenMap::getOriginalLeaseToken(folly::StringPiece routeName,
 }
 
 void LeaseTokenMap::onTimeout() {
-  std::lock_guard<std::mutex> lock(mutex_);
-
   auto now = ListItem::Clock::now();
-  auto cur = invalidationQueue_.begin();
-  while (cur != invalidationQueue_.end() && cur->tokenTimeout <= now) {
-    uint64_t specialToken = cur->specialToken;
-    cur = invalidationQueue_.erase(cur);
-    data_.erase(specialToken);
+  folly::Optional<ListItem::TimePoint> nextExpiration;
+
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto cur = shard.invalidationQueue.begin();
+    while (cur != shard.invalidationQueue.end() && cur->tokenTimeout <= now) {
+      uint64_t specialToken = cur->specialToken;
+      cur = shard.invalidationQueue.erase(cur);
+      shard.data.erase(specialToken);
+    }
+    if (!shard.invalidationQueue.empty()) {
+      auto shardNext = shard.invalidationQueue.front().tokenTimeout;
+      if (!nextExpiration || shardNext < *nextExpiration) {
+        nextExpiration = shardNext;
+      }
+    }
   }
 
-  if (invalidationQueue_.empty()) {
+  if (!nextExpiration) {
     timeoutHandler_.scheduleTimeout(leaseTokenTtlMs_);
   } else {
-    auto nextExpiration = std::chrono::duration_cast<std::chrono::milliseconds>(
-        invalidationQueue_.front().tokenTimeout - now).count();
-    timeoutHandler_.scheduleTimeout(std::max<uint32_t>(nextExpiration, 1));
+    auto delayMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        *nextExpiration - now).count();
+    timeoutHandler_.scheduleTimeout(std::max<uint32_t>(delayMs, 1));
   }
 }
 
 size_t LeaseTokenMap::size() const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return data_.size();
+  size_t total = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    total += shard.data.size();
+  }
+  return total;
 }
 
 bool LeaseTokenMap::conflicts(uint64_t originalToken) {
@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <mutex>
@@ -24,6 +26,11 @@ namespace facebook { namespace memcache { namespace mcrouter {
 /**
  * Class responsible for mapping lease-tokens to destinations.
  * All operations are thread-safe.
+ *
+ * The map is sharded by the low bits of the token, each shard with its
+ * own lock, so proxies inserting/querying concurrently don't serialize
+ * on a single mutex and expiry only ever holds one shard's lock at a
+ * time.
  */
 class LeaseTokenMap {
  public:
@@ -119,15 +126,32 @@ class LeaseTokenMap {
     folly::IntrusiveListHook listHook;
   };
 
+  // Must be a power of two: ids are assigned round-robin, so tokens
+  // spread evenly over shards.
+  static constexpr size_t kNumShards = 16;
+
+  struct Shard {
+    // Underlying data structure.
+    std::unordered_map<uint64_t, ListItem> data;
+    // Keeps an in-order list of what should be invalidated.  The TTL is
+    // constant, so insertion order == expiration order and expiry stops
+    // at the first non-expired item: O(expired), never a full scan.
+    folly::IntrusiveList<ListItem, &ListItem::listHook> invalidationQueue;
+    // Synchronizes access to this shard only.
+    mutable std::mutex mutex;
+  };
+
   // Hold the id of the next element to be inserted in the data structure.
-  uint32_t nextId_{0};
-
-  // Underlying data structure.
-  std::unordered_map<uint64_t, ListItem> data_;
-  // Keeps an in-order list of what should be invalidated.
-  folly::IntrusiveList<ListItem, &ListItem::listHook> invalidationQueue_;
-  // Mutex to synchronize access to underlying data structure
-  mutable std::mutex mutex_;
+  std::atomic<uint32_t> nextId_{0};
+
+  std::array<Shard, kNumShards> shards_;
+
+  Shard& shardForToken(uint64_t token) {
+    return shards_[token & (kNumShards - 1)];
+  }
+  const Shard& shardForToken(uint64_t token) const {
+    return shards_[token & (kNumShards - 1)];
+  }
 
   // Handles timeout
   class TimeoutHandler : public folly::AsyncTimeout {
@@ -0,0 +1,299 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "ListenSocketHandoff.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+#include <glog/logging.h>
+
+#include "mcrouter/lib/fbi/cpp/util.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+namespace {
+
+constexpr uint32_t kHandoffMagic = 0x6d637266; /* "mcrf" */
+/* Plenty for any realistic ports list, well under the SCM_RIGHTS limit */
+constexpr size_t kMaxHandoffFds = 64;
+constexpr uint8_t kReadyAck = 'R';
+
+struct HandoffHeader {
+  uint32_t magic;
+  uint32_t numPlainFds;
+  uint32_t numSslFds;
+};
+
+void setIoTimeout(int fd) {
+  /* Don't let a wedged peer block startup or the handoff thread */
+  struct timeval tv = { /* tv_sec */ 2, /* tv_usec */ 0 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+bool makeUnixAddress(const std::string& path, struct sockaddr_un& addr) {
+  if (path.size() >= sizeof(addr.sun_path)) {
+    LOG(ERROR) << "Handoff socket path too long: " << path;
+    return false;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  memcpy(addr.sun_path, path.data(), path.size());
+  return true;
+}
+
+bool sendFds(int fd,
+             const std::vector<int>& plainFds,
+             const std::vector<int>& sslFds) {
+  HandoffHeader header;
+  header.magic = kHandoffMagic;
+  header.numPlainFds = plainFds.size();
+  header.numSslFds = sslFds.size();
+
+  std::vector<int> fds(plainFds);
+  fds.insert(fds.end(), sslFds.begin(), sslFds.end());
+  CHECK(fds.size() <= kMaxHandoffFds);
+
+  struct iovec iov;
+  iov.iov_base = &header;
+  iov.iov_len = sizeof(header);
+
+  char control[CMSG_SPACE(sizeof(int) * kMaxHandoffFds)];
+  memset(control, 0, sizeof(control));
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+  memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+  ssize_t sent;
+  do {
+    sent = sendmsg(fd, &msg, 0);
+  } while (sent < 0 && errno == EINTR);
+  if (sent != static_cast<ssize_t>(sizeof(header))) {
+    PLOG(ERROR) << "Failed to send listen fds to successor";
+    return false;
+  }
+  return true;
+}
+
+} // anonymous
+
+bool receiveListenSockets(const std::string& path,
+                          std::vector<int>& plainFds,
+                          std::vector<int>& sslFds,
+                          int& ackFd) {
+  struct sockaddr_un addr;
+  if (!makeUnixAddress(path, addr)) {
+    return false;
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    PLOG(ERROR) << "Failed to create handoff socket";
+    return false;
+  }
+  setIoTimeout(fd);
+
+  if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr),
+              sizeof(addr)) != 0) {
+    /* No running instance; the common case on cold start */
+    close(fd);
+    return false;
+  }
+
+  HandoffHeader header;
+  struct iovec iov;
+  iov.iov_base = &header;
+  iov.iov_len = sizeof(header);
+
+  char control[CMSG_SPACE(sizeof(int) * kMaxHandoffFds)];
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t received;
+  do {
+    received = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+  } while (received < 0 && errno == EINTR);
+  if (received != static_cast<ssize_t>(sizeof(header)) ||
+      header.magic != kHandoffMagic ||
+      header.numPlainFds + header.numSslFds == 0 ||
+      header.numPlainFds + header.numSslFds > kMaxHandoffFds ||
+      (msg.msg_flags & MSG_CTRUNC)) {
+    LOG(ERROR) << "Bad listen fd handoff message, ignoring it";
+    close(fd);
+    return false;
+  }
+
+  std::vector<int> fds;
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+      continue;
+    }
+    size_t n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    size_t prev = fds.size();
+    fds.resize(prev + n);
+    memcpy(fds.data() + prev, CMSG_DATA(cmsg), n * sizeof(int));
+  }
+
+  if (fds.size() != header.numPlainFds + header.numSslFds) {
+    LOG(ERROR) << "Listen fd handoff fd count mismatch, ignoring it";
+    for (auto receivedFd : fds) {
+      close(receivedFd);
+    }
+    close(fd);
+    return false;
+  }
+
+  plainFds.assign(fds.begin(), fds.begin() + header.numPlainFds);
+  sslFds.assign(fds.begin() + header.numPlainFds, fds.end());
+  ackFd = fd;
+  return true;
+}
+
+void sendReadyAck(int ackFd) {
+  ssize_t sent;
+  do {
+    sent = write(ackFd, &kReadyAck, 1);
+  } while (sent < 0 && errno == EINTR);
+  if (sent != 1) {
+    PLOG(WARNING) << "Failed to ack listen fd handoff; "
+                     "predecessor will keep running";
+  }
+  close(ackFd);
+}
+
+ListenSocketHandoffServer::ListenSocketHandoffServer(
+  std::string path,
+  std::vector<int> plainFds,
+  std::vector<int> sslFds,
+  std::function<void()> onHandoff)
+    : path_(std::move(path)),
+      plainFds_(std::move(plainFds)),
+      sslFds_(std::move(sslFds)),
+      onHandoff_(std::move(onHandoff)) {
+
+  checkRuntime(plainFds_.size() + sslFds_.size() <= kMaxHandoffFds,
+               "Too many listen sockets for handoff");
+
+  struct sockaddr_un addr;
+  checkRuntime(makeUnixAddress(path_, addr),
+               "Invalid handoff socket path: {}", path_);
+
+  listenFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  checkRuntime(listenFd_ >= 0, "Failed to create handoff socket");
+
+  /* A stale file from a crashed predecessor would make bind fail */
+  std::remove(path_.c_str());
+  if (bind(listenFd_, reinterpret_cast<struct sockaddr*>(&addr),
+           sizeof(addr)) != 0 ||
+      listen(listenFd_, 1) != 0) {
+    close(listenFd_);
+    throwRuntime("Failed to listen on handoff socket {}: {}",
+                 path_, strerror(errno));
+  }
+
+  PCHECK(pipe2(wakePipe_, O_CLOEXEC) == 0);
+
+  thread_ = std::thread([this] () { run(); });
+}
+
+ListenSocketHandoffServer::~ListenSocketHandoffServer() {
+  uint8_t wake = 0;
+  ssize_t sent;
+  do {
+    sent = write(wakePipe_[1], &wake, 1);
+  } while (sent < 0 && errno == EINTR);
+  thread_.join();
+
+  close(listenFd_);
+  close(wakePipe_[0]);
+  close(wakePipe_[1]);
+  if (!handedOff_) {
+    std::remove(path_.c_str());
+  }
+}
+
+void ListenSocketHandoffServer::run() {
+  for (;;) {
+    struct pollfd pfd[2];
+    pfd[0].fd = listenFd_;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = wakePipe_[0];
+    pfd[1].events = POLLIN;
+
+    int ret = poll(pfd, 2, -1);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret < 0 || (pfd[1].revents & POLLIN)) {
+      /* shutting down */
+      return;
+    }
+
+    int fd = accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      continue;
+    }
+    setIoTimeout(fd);
+
+    if (serveOneSuccessor(fd)) {
+      handedOff_ = true;
+      LOG(INFO) << "Listen sockets handed off to successor";
+      if (onHandoff_) {
+        onHandoff_();
+      }
+      return;
+    }
+    LOG(WARNING) << "Listen socket handoff attempt failed; still serving";
+  }
+}
+
+bool ListenSocketHandoffServer::serveOneSuccessor(int fd) {
+  if (!sendFds(fd, plainFds_, sslFds_)) {
+    close(fd);
+    return false;
+  }
+
+  /*
+   * Wait for the successor to confirm it is actually serving before we
+   * stop; EOF without the ack means it died during startup.
+   */
+  uint8_t ack = 0;
+  ssize_t received;
+  do {
+    received = read(fd, &ack, 1);
+  } while (received < 0 && errno == EINTR);
+  close(fd);
+
+  return received == 1 && ack == kReadyAck;
+}
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,115 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Listen socket handoff for zero-downtime restarts of standalone mcrouter.
+ *
+ * On startup a new instance connects to a well-known unix domain socket
+ * path; if a running instance is serving it, the running instance passes
+ * its TCP listen fds over the connection with SCM_RIGHTS. Both processes
+ * then share the same listen queues, so there is never a moment when the
+ * port is closed: new connections simply start landing in the new process.
+ * Once the new instance has spawned its workers it sends a one-byte ready
+ * ack back on the same connection, at which point the old instance stops
+ * accepting and drains its established sessions. If the new instance dies
+ * before acking, the old one just keeps serving.
+ *
+ * Established sessions are not transferred; they are closed gracefully by
+ * the draining process after in-flight replies are flushed, so their
+ * clients reconnect gradually against a listen socket that is already
+ * live in the new process instead of storming a dead port.
+ */
+
+/**
+ * Attempts to adopt listen sockets from a running instance serving
+ * `path`. Returns false (and leaves the outputs empty) if no instance is
+ * listening there or the transfer fails; the caller then binds its own
+ * sockets as usual.
+ *
+ * On success the received fds are owned by the caller. sendReadyAck()
+ * must be called on the returned ack fd once the caller is serving.
+ *
+ * @param path      unix domain socket path of the handoff listener
+ * @param plainFds  output, listen fds for plaintext ports
+ * @param sslFds    output, listen fds for SSL ports
+ * @param ackFd     output, connected fd to ack on; owned by the caller
+ */
+bool receiveListenSockets(const std::string& path,
+                          std::vector<int>& plainFds,
+                          std::vector<int>& sslFds,
+                          int& ackFd);
+
+/**
+ * Tells the predecessor that this instance is serving, so it can stop
+ * accepting and start draining. Closes ackFd.
+ */
+void sendReadyAck(int ackFd);
+
+/**
+ * Serves this instance's listen fds to a successor.
+ *
+ * Listens on `path` from a dedicated thread. When a successor connects,
+ * sends it duplicates of the listen fds and waits for the ready ack;
+ * on ack it invokes onHandoff (once) from the handoff thread. A successor
+ * that disconnects without acking is forgotten and the next connection is
+ * served again.
+ */
+class ListenSocketHandoffServer {
+ public:
+  /**
+   * @param path       unix domain socket path to listen on; any stale
+   *                   socket file is replaced
+   * @param plainFds   listen fds for plaintext ports
+   * @param sslFds     listen fds for SSL ports
+   * @param onHandoff  called from the handoff thread after a successor
+   *                   acked; typically initiates graceful shutdown
+   *
+   * @throws std::runtime_error  if the path can't be bound
+   */
+  ListenSocketHandoffServer(std::string path,
+                            std::vector<int> plainFds,
+                            std::vector<int> sslFds,
+                            std::function<void()> onHandoff);
+
+  /**
+   * Stops the handoff thread and removes the socket file (unless a
+   * handoff happened, in which case the path now belongs to the
+   * successor).
+   */
+  ~ListenSocketHandoffServer();
+
+  ListenSocketHandoffServer(const ListenSocketHandoffServer&) = delete;
+  ListenSocketHandoffServer& operator=(const ListenSocketHandoffServer&)
+    = delete;
+
+ private:
+  const std::string path_;
+  const std::vector<int> plainFds_;
+  const std::vector<int> sslFds_;
+  const std::function<void()> onHandoff_;
+  int listenFd_{-1};
+  /* self-pipe to wake the handoff thread up on stop */
+  int wakePipe_[2]{-1, -1};
+  bool handedOff_{false};
+  std::thread thread_;
+
+  void run();
+  bool serveOneSuccessor(int fd);
+};
+
+}}}  // facebook::memcache::mcrouter
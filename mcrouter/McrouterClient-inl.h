@@ -66,6 +66,22 @@ void bumpMcrouterClientStats(CacheClientStats& stats,
   // We don't have any other operation specific stats.
 }
 
+/**
+ * Whether requests of this type ride the priority lane of the proxy
+ * message queue.  Deletes (correctness-critical invalidations) and
+ * admin operations go there so they see bounded queueing delay even
+ * when the get path saturates the regular lane.
+ */
+template <class Request>
+constexpr bool priorityLaneRequest() {
+  return DeleteLike<Request>::value ||
+      std::is_same<Request, McFlushAllRequest>::value ||
+      std::is_same<Request, McFlushReRequest>::value ||
+      std::is_same<Request, McShutdownRequest>::value ||
+      std::is_same<Request, McStatsRequest>::value ||
+      std::is_same<Request, McVersionRequest>::value;
+}
+
 template <class Request>
 const Request& unwrapRequest(const Request& req) {
   return req;
@@ -83,7 +99,7 @@ bool McrouterClient::send(const Request& req,
                           F&& callback,
                           folly::StringPiece ipAddr) {
   auto makePreq = [this, ipAddr, &req, &callback] {
-    auto preq = createProxyRequestContext(*proxy_, req, [
+    auto preq = createProxyRequestContext(targetProxy(), req, [
       this,
       cb = std::forward<F>(callback)
     ](const Request& request, ReplyT<Request>&& reply) mutable {
@@ -107,14 +123,54 @@ bool McrouterClient::send(const Request& req,
     callback(req, ReplyT<Request>(mc_res_local_error));
   };
 
-  return sendMultiImpl(1, makePreq, cancelRemaining);
+  return sendMultiImpl(
+      1, makePreq, cancelRemaining, detail::priorityLaneRequest<Request>());
+}
+
+template <class F>
+bool McrouterClient::sendGetBatch(std::vector<McGetRequest>&& reqs,
+                                  F&& callback,
+                                  folly::StringPiece ipAddr) {
+  assert(!reqs.empty());
+
+  auto makePreq = [this, ipAddr, &reqs, &callback] {
+    auto preq = createProxyGetBatchContext(targetProxy(), std::move(reqs), [
+      this,
+      cb = std::forward<F>(callback)
+    ](size_t idx, const McGetRequest& request, McGetReply&& reply) mutable {
+      detail::bumpMcrouterClientStats(stats_, request, reply);
+      if (disconnected_) {
+        // "Cancelled" reply.
+        cb(idx, request, McGetReply(mc_res_unknown));
+      } else {
+        cb(idx, request, std::move(reply));
+      }
+    });
+
+    preq->requester_ = self_;
+    if (!ipAddr.empty()) {
+      preq->setUserIpAddress(ipAddr);
+    }
+    return preq;
+  };
+
+  auto cancelRemaining = [&reqs, &callback]() {
+    for (size_t i = 0; i < reqs.size(); ++i) {
+      callback(i, reqs[i], McGetReply(mc_res_local_error));
+    }
+  };
+
+  /* The batch is a single unit as far as the outstanding limit is
+     concerned; its context posts one slot back on destruction. */
+  return sendMultiImpl(1, std::move(makePreq), std::move(cancelRemaining));
 }
 
 template <class F, class G>
 bool McrouterClient::sendMultiImpl(
     size_t nreqs,
     F&& makeNextPreq,
-    G&& failRemaining) {
+    G&& failRemaining,
+    bool priorityLane) {
   auto router = router_.lock();
   if (!router) {
     return false;
@@ -127,7 +183,7 @@ bool McrouterClient::sendMultiImpl(
       }
     } else {
       for (size_t i = 0; i < nreqs; ++i) {
-        sendRemoteThread(makeNextPreq());
+        sendRemoteThread(makeNextPreq(), priorityLane);
       }
     }
   } else if (maxOutstandingError_) {
@@ -145,7 +201,7 @@ bool McrouterClient::sendMultiImpl(
         }
       } else {
         for (size_t i = begin; i < end; i++) {
-          sendRemoteThread(makeNextPreq());
+          sendRemoteThread(makeNextPreq(), priorityLane);
         }
       }
 
@@ -160,7 +216,7 @@ bool McrouterClient::sendMultiImpl(
     while (i < nreqs) {
       n += counting_sem_lazy_wait(&outstandingReqsSem_, nreqs - n);
       for (size_t j = i; j < n; ++j) {
-        sendRemoteThread(makeNextPreq());
+        sendRemoteThread(makeNextPreq(), priorityLane);
       }
       i = n;
     }
@@ -181,7 +237,7 @@ bool McrouterClient::send(
 
   auto makeNextPreq = [this, ipAddr, &callback, &begin]() {
     auto preq = createProxyRequestContext(
-        *proxy_,
+        targetProxy(),
         detail::unwrapRequest(*begin),
         [this, callback](
             const Request& request, ReplyT<Request>&& reply) mutable {
@@ -214,7 +270,8 @@ bool McrouterClient::send(
   return sendMultiImpl(
       std::distance(begin, end),
       std::move(makeNextPreq),
-      std::move(cancelRemaining));
+      std::move(cancelRemaining),
+      detail::priorityLaneRequest<Request>());
 }
 
 } // mcrouter
@@ -9,6 +9,8 @@
  */
 #include "McrouterClient.h"
 
+#include <algorithm>
+
 #include "mcrouter/McrouterInstance.h"
 #include "mcrouter/Proxy.h"
 #include "mcrouter/ProxyRequestContext.h"
@@ -17,15 +19,33 @@
 namespace facebook { namespace memcache { namespace mcrouter {
 
 void McrouterClient::sendRemoteThread(
-    std::unique_ptr<ProxyRequestContext> req) {
-  proxy_->messageQueue_->blockingWriteRelaxed(ProxyMessage::Type::REQUEST,
+    std::unique_ptr<ProxyRequestContext> req, bool priorityLane) {
+  /* The request runs on the proxy bound into its context, which may
+     differ from proxy_ when it was stolen by a less loaded proxy
+     (see targetProxy()). */
+  auto& proxy = req->proxy();
+  if (priorityLane) {
+    proxy.messageQueue_->blockingWritePriority(ProxyMessage::Type::REQUEST,
+                                               req.release());
+  } else {
+    proxy.messageQueue_->blockingWriteRelaxed(ProxyMessage::Type::REQUEST,
                                               req.release());
+  }
 }
 
 void McrouterClient::sendSameThread(std::unique_ptr<ProxyRequestContext> req) {
   proxy_->messageReady(ProxyMessage::Type::REQUEST, req.release());
 }
 
+Proxy& McrouterClient::targetProxy() {
+  if (!sameThread_) {
+    if (auto router = router_.lock()) {
+      return *router->pickProxyForRequest(proxy_);
+    }
+  }
+  return *proxy_;
+}
+
 McrouterClient::McrouterClient(
   std::weak_ptr<McrouterInstance> rtr,
   size_t maxOutstanding,
@@ -46,9 +66,27 @@ McrouterClient::McrouterClient(
   if (auto router = router_.lock()) {
     std::lock_guard<std::mutex> guard(router->nextProxyMutex_);
     assert(router->nextProxy_ < router->opts().num_proxies);
-    proxy_ = router->getProxy(router->nextProxy_);
-    router->nextProxy_ =
-      (router->nextProxy_ + 1) % router->opts().num_proxies;
+    auto& counts = router->proxyClientCounts_;
+    if (counts.empty()) {
+      counts.resize(router->opts().num_proxies, 0);
+    }
+    /* Assign to the proxy with the fewest connected clients; the
+       round-robin cursor breaks ties so equally loaded proxies fill
+       evenly. With --background-proxy-init only the proxies that are
+       already serving are eligible. */
+    const size_t numReady = std::max<size_t>(
+      1, std::min<size_t>(router->readyProxyCount(), counts.size()));
+    size_t best = router->nextProxy_ % numReady;
+    for (size_t i = 0; i < numReady; ++i) {
+      const size_t idx = (router->nextProxy_ + i) % numReady;
+      if (counts[idx] < counts[best]) {
+        best = idx;
+      }
+    }
+    ++counts[best];
+    assignedProxyIdx_ = best;
+    proxy_ = router->getProxy(best);
+    router->nextProxy_ = (best + 1) % router->opts().num_proxies;
   }
 }
 
@@ -68,6 +106,14 @@ McrouterClient::Pointer McrouterClient::create(
 
 McrouterClient::~McrouterClient() {
   assert(disconnected_);
+  if (auto router = router_.lock()) {
+    std::lock_guard<std::mutex> guard(router->nextProxyMutex_);
+    auto& counts = router->proxyClientCounts_;
+    if (assignedProxyIdx_ < counts.size() &&
+        counts[assignedProxyIdx_] > 0) {
+      --counts[assignedProxyIdx_];
+    }
+  }
 }
 
 }}}  // facebook::memcache::mcrouter
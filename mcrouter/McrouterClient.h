@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include <vector>
+
 #include <folly/IntrusiveList.h>
 #include <folly/Range.h>
 
@@ -16,7 +18,12 @@
 #include "mcrouter/lib/fbi/counting_sem.h"
 #include "mcrouter/lib/mc/msg.h"
 
-namespace facebook { namespace memcache { namespace mcrouter {
+namespace facebook { namespace memcache {
+
+class McGetReply;
+class McGetRequest;
+
+namespace mcrouter {
 
 class McrouterClient;
 class McrouterInstance;
@@ -25,8 +32,11 @@ class ProxyRequestContext;
 
 /**
  * A mcrouter client is used to communicate with a mcrouter instance.
- * Typically a client is long lived. Request sent through a single client
- * will be sent to the same mcrouter thread that's determined once on creation.
+ * Typically a client is long lived. Requests sent through a single client
+ * are normally processed by the same mcrouter thread, determined on
+ * creation as the proxy with the fewest connected clients.  When
+ * --proxy-steal-threshold is set, individual requests may instead run on
+ * the least-loaded proxy if the assigned one's queue backs up.
  *
  * Create via McrouterInstance::createClient().
  */
@@ -98,6 +108,29 @@ class McrouterClient {
       F&& callback,
       folly::StringPiece ipAddr = folly::StringPiece());
 
+  /**
+   * Sends a batch of get requests through the route tree as a single
+   * dispatch: the whole batch takes one proxy request context and one
+   * top-level fiber task instead of one per request (the route tree
+   * still fans the keys out concurrently).
+   *
+   * @param callback  called exactly once per request, in any order, as
+   *                    f(size_t idx, const McGetRequest&, McGetReply&&)
+   *                  where idx is the request's position in reqs.
+   *
+   * @return true iff the batch was scheduled to be sent,
+   *         false if some error happened (e.g. McrouterInstance was
+   *         destroyed); in that case no callback is called.
+   *
+   * Note: the whole batch counts as a single request toward the
+   *       maximum_outstanding_requests limit.
+   */
+  template <class F>
+  bool sendGetBatch(
+      std::vector<McGetRequest>&& reqs,
+      F&& callback,
+      folly::StringPiece ipAddr = folly::StringPiece());
+
   CacheClientCounters getStatCounters() noexcept {
     return stats_.getCounters();
   }
@@ -129,6 +162,9 @@ class McrouterClient {
 
   Proxy* proxy_{nullptr};
 
+  /** Index of the assigned proxy, for client count bookkeeping */
+  size_t assignedProxyIdx_{0};
+
   CacheClientStats stats_;
 
   /// Maximum allowed requests in flight (unlimited if 0)
@@ -174,13 +210,31 @@ class McrouterClient {
    * @param makeNextPreq   proxy request generator.
    * @param failRemaining  will be called if all remaining requests should be
    *                       canceled due to maxOutstandingError_ flag
+   * @param priorityLane   if true, the requests go to the priority lane
+   *                       of the proxy message queue, ahead of any
+   *                       regular-lane backlog (deletes and admin
+   *                       operations; see detail::priorityLaneRequest()).
    */
   template <class F, class G>
-  bool sendMultiImpl(size_t nreqs, F&& makeNextPreq, G&& failRemaining);
-
-  void sendRemoteThread(std::unique_ptr<ProxyRequestContext> req);
+  bool sendMultiImpl(
+      size_t nreqs,
+      F&& makeNextPreq,
+      G&& failRemaining,
+      bool priorityLane = false);
+
+  void sendRemoteThread(
+      std::unique_ptr<ProxyRequestContext> req,
+      bool priorityLane);
   void sendSameThread(std::unique_ptr<ProxyRequestContext> req);
 
+  /**
+   * The proxy that should run the next request: the assigned proxy, or
+   * the least-loaded one when stealing is enabled and the assigned
+   * proxy's queue is backed up.  Always the assigned proxy for
+   * same-thread clients.
+   */
+  Proxy& targetProxy();
+
   friend class McrouterInstance;
   friend class ProxyRequestContext;
 };
@@ -17,6 +17,7 @@
 #include <folly/ScopeGuard.h>
 
 #include "mcrouter/lib/network/ReplyStatsContext.h"
+#include "mcrouter/lib/RequestArena.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
@@ -65,6 +66,11 @@ struct McrouterFiberContext {
 
   // For logging stats to Scuba
   ReplyStatsContext replyStatsContext;
+
+  // Lazily created request-lifetime arena, see getRequestArena().
+  // shared_ptr so the context stays copyable (runWithLocals) without
+  // invalidating outstanding allocations.
+  std::shared_ptr<RequestArena> requestArena;
 };
 
 }  // detail
@@ -177,6 +183,26 @@ inline bool getFailoverDisabled() {
   return folly::fibers::local<detail::McrouterFiberContext>().failoverDisabled;
 }
 
+/**
+ * Get the request arena of current fiber (thread, if we're not on fiber).
+ *
+ * On fiber, allocations live until the fiber completes the request and
+ * are then reclaimed in one shot together with the context.  Off fiber
+ * the context lives for the whole thread, so the arena is rewound on
+ * each call here: treat allocations as valid only until the next
+ * getRequestArena() call.
+ */
+inline RequestArena& getRequestArena() {
+  auto& arena =
+      folly::fibers::local<detail::McrouterFiberContext>().requestArena;
+  if (!arena) {
+    arena = std::make_shared<RequestArena>();
+  } else if (!folly::fibers::onFiber()) {
+    arena->reset();
+  }
+  return *arena;
+}
+
 /**
  * Update reply stats context for current fiber (thread, if we're not on fiber)
  */
@@ -9,10 +9,14 @@
  */
 #include "McrouterInstance.h"
 
+#include <algorithm>
+
 #include <boost/filesystem/operations.hpp>
 
 #include <folly/DynamicConverter.h>
 #include <folly/fibers/FiberManager.h>
+#include <folly/Format.h>
+#include <folly/io/async/EventBase.h>
 #include <folly/json.h>
 #include <folly/MapUtil.h>
 #include <folly/Singleton.h>
@@ -23,10 +27,13 @@
 #include "mcrouter/Proxy.h"
 #include "mcrouter/ProxyConfig.h"
 #include "mcrouter/ProxyConfigBuilder.h"
+#include "mcrouter/ProxyDestination.h"
+#include "mcrouter/ProxyDestinationMap.h"
 #include "mcrouter/ProxyThread.h"
 #include "mcrouter/RuntimeVarsData.h"
 #include "mcrouter/ThreadUtil.h"
 #include "mcrouter/awriter.h"
+#include "mcrouter/lib/CompressionDictionaryTrainer.h"
 #include "mcrouter/lib/cycles/Cycles.h"
 #include "mcrouter/lib/fbi/cpp/LogFailure.h"
 #include "mcrouter/stats.h"
@@ -64,6 +71,7 @@ class McrouterManager {
         if (mcrouter) {
           std::lock_guard<std::mutex> lg(mutex_);
           mcrouters_[persistence_id.str()] = mcrouter;
+          registrationOrder_.push_back(mcrouter);
         }
       }
     }
@@ -81,9 +89,25 @@ class McrouterManager {
     mcrouters_.clear();
   }
 
+  std::vector<std::shared_ptr<McrouterInstance>> mcroutersInRegistrationOrder() {
+    std::lock_guard<std::mutex> lg(mutex_);
+    std::vector<std::shared_ptr<McrouterInstance>> result;
+    result.reserve(registrationOrder_.size());
+    for (const auto& weak : registrationOrder_) {
+      if (auto mcrouter = weak.lock()) {
+        result.push_back(std::move(mcrouter));
+      }
+    }
+    return result;
+  }
+
  private:
   std::unordered_map<std::string, std::shared_ptr<McrouterInstance>> mcrouters_;
-  // protects mcrouters_
+  // Instances in the order they were registered; weak so an entry
+  // never outlives its mcrouters_ slot (expired entries are skipped).
+  // Drives the owner-selection order of findCrossRouterDestination().
+  std::vector<std::weak_ptr<McrouterInstance>> registrationOrder_;
+  // protects mcrouters_ and registrationOrder_
   std::mutex mutex_;
   // initMutex_ must not be taken under mutex_, otherwise deadlock is possible
   std::mutex initMutex_;
@@ -133,6 +157,43 @@ McrouterInstance* McrouterInstance::get(folly::StringPiece persistence_id) {
   return nullptr;
 }
 
+std::shared_ptr<ProxyDestination> McrouterInstance::findCrossRouterDestination(
+    const AccessPoint& ap,
+    std::chrono::milliseconds timeout,
+    const McrouterInstanceBase& requester,
+    std::shared_ptr<void>& ownerRouter) {
+  auto manager = gMcrouterManager.try_get();
+  if (!manager) {
+    return nullptr;
+  }
+  for (auto& router : manager->mcroutersInRegistrationOrder()) {
+    if (router.get() == &requester) {
+      /* Only earlier-registered instances can own: adoption edges all
+         point one way, so two routers sharing with each other can
+         never form a strong reference cycle through ownerRouter
+         handles. */
+      break;
+    }
+    if (!router->opts().cross_router_shared_destinations) {
+      continue;
+    }
+    for (size_t i = 0; i < router->opts().num_proxies; ++i) {
+      auto* proxy = router->getProxy(i);
+      if (proxy == nullptr) {
+        continue;
+      }
+      auto destination = proxy->destinationMap->find(ap, timeout);
+      /* Forwarders are skipped so forwarding never chains: the copy we
+         adopt must hold the connections itself. */
+      if (destination && !destination->isSharedForwarder()) {
+        ownerRouter = std::move(router);
+        return destination;
+      }
+    }
+  }
+  return nullptr;
+}
+
 McrouterInstance* McrouterInstance::createRaw(
   McrouterOptions input_options,
   const std::vector<folly::EventBase*>& evbs) {
@@ -205,6 +266,30 @@ std::shared_ptr<McrouterInstance> McrouterInstance::create(
     });
 }
 
+bool McrouterInstance::validateConfig(const McrouterOptions& options) {
+  auto opts = options.clone();
+  extraValidateOptions(opts);
+  /* Every proxy builds an identical route tree, so validity only needs
+     one; skipping the num_proxies - 1 duplicate builds is most of the
+     saving over a full init(). */
+  opts.num_proxies = 1;
+
+  folly::EventBase evb;
+  auto deleter = [](McrouterInstance* router) { delete router; };
+  std::unique_ptr<McrouterInstance, decltype(deleter)> router(
+      new McrouterInstance(std::move(opts)), deleter);
+  /* The proxy is never spawned: it exists only so the route tree has
+     somewhere to hang stats and destination bookkeeping. */
+  router->proxies_.emplace_back(Proxy::createProxy(*router, evb, 0));
+
+  auto builder = router->createConfigBuilder();
+  if (!builder) {
+    return false;
+  }
+  builder->buildConfig(*router->getProxy(0));
+  return true;
+}
+
 McrouterClient::Pointer McrouterInstance::createClient(
   size_t max_outstanding,
   bool max_outstanding_error) {
@@ -232,10 +317,17 @@ bool McrouterInstance::spinUp(const std::vector<folly::EventBase*>& evbs) {
     initCompression(*this);
   }
 
+  /* Bringing up only the first proxy here needs a thread of our own to
+     finish the rest, so it only applies when we own the proxy threads. */
+  const bool backgroundInit =
+    opts_.background_proxy_init && evbs.empty() && opts_.num_proxies > 1;
+
+  folly::Optional<ProxyConfigBuilder> builder;
+
   {
     std::lock_guard<std::mutex> lg(configReconfigLock_);
 
-    auto builder = createConfigBuilder();
+    builder = createConfigBuilder();
     if (!builder) {
       return false;
     }
@@ -254,7 +346,20 @@ bool McrouterInstance::spinUp(const std::vector<folly::EventBase*>& evbs) {
       }
     }
 
-    if (!reconfigure(builder.value())) {
+    if (backgroundInit) {
+      /* Configure the first proxy only; backgroundProxyInit() brings the
+         rest up after we return. */
+      try {
+        proxy_config_swap(getProxy(0), builder->buildConfig(*getProxy(0)));
+        configApi_->subscribeToTrackedSources();
+      } catch (const std::exception& e) {
+        MC_LOG_FAILURE(opts(), failure::Category::kInvalidConfig,
+                       "Failed to configure: {}", e.what());
+        configFailures_++;
+        configApi_->abandonTrackedSources();
+        return false;
+      }
+    } else if (!reconfigure(builder.value())) {
       LOG(ERROR) << "Failed to configure proxies";
       return false;
     }
@@ -262,6 +367,24 @@ bool McrouterInstance::spinUp(const std::vector<folly::EventBase*>& evbs) {
 
   startTime_ = time(nullptr);
 
+  if (backgroundInit) {
+    setReadyProxyCount(1);
+    try {
+      proxyThreads_[0]->spawn();
+      spawnAuxiliaryThreads();
+    } catch (const std::exception& e) {
+      LOG(ERROR) << e.what();
+      return false;
+    }
+    backgroundProxyInitThread_ = std::thread(
+      [this, initBuilder = std::move(builder.value())] () mutable {
+        backgroundProxyInit(std::move(initBuilder));
+      });
+    return true;
+  }
+
+  setReadyProxyCount(opts_.num_proxies);
+
   for (auto& pt : proxyThreads_) {
     try {
       pt->spawn();
@@ -284,6 +407,40 @@ bool McrouterInstance::spinUp(const std::vector<folly::EventBase*>& evbs) {
   return true;
 }
 
+void McrouterInstance::backgroundProxyInit(ProxyConfigBuilder builder) {
+  mcrouterSetThisThreadName(opts_, "mcrpxy-init");
+
+  for (size_t i = 1; i < opts_.num_proxies; ++i) {
+    if (shutdownStarted_.load()) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lg(configReconfigLock_);
+      auto proxy = getProxy(i);
+      /* A config update that raced with us already configured everything */
+      if (proxy->getConfig() == nullptr) {
+        try {
+          proxy_config_swap(proxy, builder.buildConfig(*proxy));
+        } catch (const std::exception& e) {
+          MC_LOG_FAILURE(opts(), failure::Category::kInvalidConfig,
+                         "Background proxy init failed: {}", e.what());
+          return;
+        }
+      }
+    }
+    try {
+      proxyThreads_[i]->spawn();
+    } catch (const std::exception& e) {
+      LOG(ERROR) << "Failed to start proxy thread: " << e.what();
+      return;
+    }
+    setReadyProxyCount(i + 1);
+  }
+
+  VLOG(1) << "background initialization of " << opts_.num_proxies - 1
+          << " proxies complete";
+}
+
 void McrouterInstance::freeAllMcrouters() {
   if (auto manager = gMcrouterManager.try_get()) {
     manager->freeAllMcrouters();
@@ -310,6 +467,10 @@ McrouterInstance::McrouterInstance(McrouterOptions inputOptions)
     : McrouterInstanceBase(std::move(inputOptions)) {}
 
 void McrouterInstance::shutdownImpl() noexcept {
+  /* Stops spawning further proxies; must finish before we join them */
+  if (backgroundProxyInitThread_.joinable()) {
+    backgroundProxyInitThread_.join();
+  }
   joinAuxiliaryThreads();
   for (auto& pt : proxyThreads_) {
     pt->stopAndJoin();
@@ -353,6 +514,9 @@ void McrouterInstance::spawnAuxiliaryThreads() {
   startAwriterThreads();
   startObservingRuntimeVarsFile();
   registerOnUpdateCallbackForRxmits();
+  if (compressionDictionaryTrainer() != nullptr) {
+    scheduleCompressionDictionaryTraining();
+  }
   statUpdaterThread_ = std::thread(
     [this] () {
       statUpdaterThreadRun();
@@ -378,8 +542,13 @@ void McrouterInstance::spawnAuxiliaryThreads() {
 
 void McrouterInstance::startAwriterThreads() {
   if (!opts_.asynclog_disable) {
-    if (!asyncWriter_->start("mcrtr-awriter")) {
-      throw std::runtime_error("failed to spawn mcrouter awriter thread");
+    for (size_t i = 0; i < asyncWriters_.size(); ++i) {
+      auto threadName = asyncWriters_.size() == 1
+          ? std::string("mcrtr-awriter")
+          : folly::sformat("mcrtr-awr-{}", i);
+      if (!asyncWriters_[i]->start(threadName)) {
+        throw std::runtime_error("failed to spawn mcrouter awriter thread");
+      }
     }
   }
 
@@ -409,6 +578,22 @@ void McrouterInstance::startObservingRuntimeVarsFile() {
   );
 }
 
+void McrouterInstance::scheduleCompressionDictionaryTraining() {
+  auto* evb = evbAuxiliaryThread_.getEventBase();
+  // runAfterDelay() may only be called from the EventBase thread.
+  evb->runInEventBaseThread([this, evb]() {
+    evb->runAfterDelay(
+        [this]() {
+          auto codecConfigs = compressionDictionaryTrainer()->train();
+          if (!codecConfigs.empty()) {
+            setUpCompressionDictionaries(std::move(codecConfigs));
+          }
+          scheduleCompressionDictionaryTraining();
+        },
+        opts_.compression_training_interval_ms);
+  });
+}
+
 void McrouterInstance::statUpdaterThreadRun() {
   mcrouterSetThisThreadName(opts_, "stats");
 
@@ -421,6 +606,15 @@ void McrouterInstance::statUpdaterThreadRun() {
   static const int BIN_NUM = (MOVING_AVERAGE_WINDOW_SIZE_IN_SECOND /
                             MOVING_AVERAGE_BIN_SIZE_IN_SECOND);
 
+  /* Every request holds a full preallocated fiber stack while it is in
+     flight, so at high concurrency fibers-stack-size directly scales
+     RSS. Once enough traffic has gone through to trust the recorded
+     high watermark, point out (once) when the configured size is far
+     above what the route trees actually use. */
+  constexpr int kFiberStackAdvisoryDelaySec = 600;
+  int secondsElapsed = 0;
+  bool fiberStackAdvisoryDone = false;
+
   while (true) {
     {
       /* Wait for the full timeout unless shutdown is started */
@@ -434,7 +628,15 @@ void McrouterInstance::statUpdaterThreadRun() {
       }
     }
 
-    // to avoid inconsistence among proxies, we lock all mutexes together
+    for (size_t i = 0; i < opts_.num_proxies; ++i) {
+      getProxy(i)->drainTkoEvents();
+    }
+
+    // A stats request aggregates rate/max windows across every proxy
+    // while holding only the requesting proxy's stats_lock, so the
+    // sweep must take all locks together: holding any single lock then
+    // excludes the whole sweep, which is what makes those unlocked
+    // cross-proxy reads safe.
     for (size_t i = 0; i < opts_.num_proxies; ++i) {
       getProxy(i)->stats_lock.lock();
     }
@@ -462,6 +664,23 @@ void McrouterInstance::statUpdaterThreadRun() {
       getProxy(i)->stats_lock.unlock();
     }
 
+    if (!fiberStackAdvisoryDone &&
+        ++secondsElapsed >= kFiberStackAdvisoryDelaySec) {
+      fiberStackAdvisoryDone = true;
+      size_t highWatermark = 0;
+      for (size_t i = 0; i < opts_.num_proxies; ++i) {
+        highWatermark = std::max(
+          highWatermark, getProxy(i)->fiberManager.stackHighWatermark());
+      }
+      if (highWatermark > 0 && highWatermark * 4 <= opts_.fibers_stack_size) {
+        LOG(INFO) << "Fiber stack high watermark is " << highWatermark
+                  << " bytes but fibers-stack-size is "
+                  << opts_.fibers_stack_size
+                  << "; lowering it cuts per-request memory at high"
+                  << " concurrency";
+      }
+    }
+
     idx = (idx + 1) % BIN_NUM;
   }
 }
@@ -503,7 +722,9 @@ void McrouterInstance::joinAuxiliaryThreads() noexcept {
 }
 
 void McrouterInstance::stopAwriterThreads() noexcept {
-  asyncWriter_->stop();
+  for (auto& writer : asyncWriters_) {
+    writer->stop();
+  }
   statsLogWriter_->stop();
 }
 
@@ -557,7 +778,8 @@ folly::Optional<ProxyConfigBuilder> McrouterInstance::createConfigBuilder() {
     try {
       // assume default_route, default_region and default_cluster are same for
       // each proxy
-      return ProxyConfigBuilder(opts_, configApi(), config);
+      return ProxyConfigBuilder(opts_, configApi(), config,
+                                accessPointCache_);
     } catch (const std::exception& e) {
       MC_LOG_FAILURE(opts(), failure::Category::kInvalidConfig,
                      "Failed to reconfigure: {}", e.what());
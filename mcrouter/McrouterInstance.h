@@ -10,6 +10,7 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <memory>
@@ -25,9 +26,14 @@
 #include "mcrouter/Proxy.h"
 #include "mcrouter/ProxyConfigBuilder.h"
 
-namespace facebook { namespace memcache { namespace mcrouter {
+namespace facebook { namespace memcache {
+
+struct AccessPoint;
+
+namespace mcrouter {
 
 class McrouterManager;
+class ProxyDestination;
 class ProxyThread;
 
 /**
@@ -47,7 +53,10 @@ class McrouterInstance : public McrouterInstanceBase,
    * @param evbs  Must be either empty or contain options.num_proxies
    *   event bases.  If empty, mcrouter will spawn its own proxy threads.
    *   Otherwise, proxies will run on the provided event bases
-   *   (auxiliary threads will still be spawned).
+   *   (auxiliary threads will still be spawned).  Several instances may
+   *   be given the same event bases to share one set of proxy threads;
+   *   combine with --cross-router-shared-destinations to also share
+   *   destination connections between them.
    * @throw runtime_error  If no valid instance can be constructed from
    *   the provided options.
    */
@@ -62,6 +71,27 @@ class McrouterInstance : public McrouterInstanceBase,
    */
   static McrouterInstance* get(folly::StringPiece persistence_id);
 
+  /**
+   * Looks through the instances registered before requester with
+   * --cross-router-shared-destinations set for a connection-owning
+   * destination matching (ap, timeout), so requester's destination can
+   * forward to it instead of opening its own connections (see
+   * ProxyDestinationMap::emplace()).  Only earlier-registered instances
+   * are considered so ownerRouter references can never form a cycle.
+   *
+   * @param ownerRouter  On a hit, set to a handle keeping the owning
+   *   instance (and thus its proxies and connections) alive; the caller
+   *   must retain it at least as long as the returned destination is
+   *   forwarded to.
+   * @return  The owner destination, or nullptr if no registered
+   *   instance has a match.
+   */
+  static std::shared_ptr<ProxyDestination> findCrossRouterDestination(
+      const AccessPoint& ap,
+      std::chrono::milliseconds timeout,
+      const McrouterInstanceBase& requester,
+      std::shared_ptr<void>& ownerRouter);
+
   /**
    * Intended for short-lived instances with unusual configs
    * (i.e. for debugging).
@@ -76,6 +106,19 @@ class McrouterInstance : public McrouterInstanceBase,
     McrouterOptions input_options,
     const std::vector<folly::EventBase*>& evbs = {});
 
+  /**
+   * Checks that the config reachable through options builds, without
+   * bringing mcrouter up: the config is fetched, preprocessed and a
+   * single route tree is constructed on an unstarted proxy.  No proxy
+   * threads are spawned and no destinations are connected, which makes
+   * this far cheaper than init() for --validate-config=exit.
+   *
+   * @return  true if the config builds.  Errors are reported through
+   *   the installed failure handlers and may also surface as exceptions
+   *   (e.g. with failure::handlers::throwLogicError() installed).
+   */
+  static bool validateConfig(const McrouterOptions& options);
+
   /**
    * Create a handle to talk to mcrouter.
    *
@@ -131,6 +174,9 @@ class McrouterInstance : public McrouterInstanceBase,
  private:
   std::mutex nextProxyMutex_;
   unsigned int nextProxy_{0};
+  // Number of connected clients assigned to each proxy; guarded by
+  // nextProxyMutex_.
+  std::vector<uint32_t> proxyClientCounts_;
 
   CallbackPool<> onReconfigureSuccess_;
 
@@ -140,6 +186,9 @@ class McrouterInstance : public McrouterInstanceBase,
   // Stat updater thread updates rate stat windows for each proxy
   std::thread statUpdaterThread_;
 
+  // Configures and starts proxies 1..N-1 with --background-proxy-init
+  std::thread backgroundProxyInitThread_;
+
   std::mutex statUpdaterCvMutex_;
   std::condition_variable statUpdaterCv_;
 
@@ -156,6 +205,14 @@ class McrouterInstance : public McrouterInstanceBase,
 
   ConfigApi::CallbackHandle configUpdateHandle_;
 
+  /**
+   * AccessPoints parsed from server strings, kept across config
+   * generations so reconfigurations don't reparse unchanged servers.
+   * Only accessed from the config thread.
+   */
+  const std::shared_ptr<PoolFactory::AccessPointCache> accessPointCache_{
+    std::make_shared<PoolFactory::AccessPointCache>()};
+
   /**
    * Exactly one of these vectors will contain opts.num_proxies elements,
    * others will be empty.
@@ -183,6 +240,13 @@ class McrouterInstance : public McrouterInstanceBase,
 
   bool spinUp(const std::vector<folly::EventBase*>& evbs);
 
+  /**
+   * Body of backgroundProxyInitThread_: configures each remaining proxy
+   * (unless a concurrent reconfiguration got there first) and spawns its
+   * thread, publishing progress through setReadyProxyCount().
+   */
+  void backgroundProxyInit(ProxyConfigBuilder builder);
+
   void startAwriterThreads();
   void stopAwriterThreads() noexcept;
 
@@ -195,6 +259,7 @@ class McrouterInstance : public McrouterInstanceBase,
   void statUpdaterThreadRun();
   void spawnStatLoggerThread();
   void startObservingRuntimeVarsFile();
+  void scheduleCompressionDictionaryTraining();
 
   /** (re)configure the router. true on success, false on error.
       NB file-based configuration is synchronous
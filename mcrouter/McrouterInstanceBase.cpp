@@ -9,32 +9,100 @@
  */
 #include "McrouterInstanceBase.h"
 
+#include <algorithm>
+
 #include <boost/filesystem/operations.hpp>
 
+#include <glog/logging.h>
+
 #include <folly/Memory.h>
 
+#include "mcrouter/Proxy.h"
+#include "mcrouter/TkoSharedBoard.h"
 #include "mcrouter/awriter.h"
 #include "mcrouter/lib/CompressionCodecManager.h"
+#include "mcrouter/lib/CompressionDictionaryTrainer.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
+namespace {
+
+std::vector<std::unique_ptr<AsyncWriter>> createAsyncWriters(size_t n) {
+  std::vector<std::unique_ptr<AsyncWriter>> writers;
+  writers.reserve(std::max<size_t>(1, n));
+  for (size_t i = 0; i < std::max<size_t>(1, n); ++i) {
+    writers.push_back(folly::make_unique<AsyncWriter>());
+  }
+  return writers;
+}
+
+} // anonymous namespace
+
 McrouterInstanceBase::McrouterInstanceBase(McrouterOptions inputOptions)
     : opts_(std::move(inputOptions)),
       pid_(getpid()),
       configApi_(createConfigApi(opts_)),
       statsLogWriter_(
           folly::make_unique<AsyncWriter>(opts_.stats_async_queue_length)),
-      asyncWriter_(folly::make_unique<AsyncWriter>()),
-      leaseTokenMap_(folly::make_unique<LeaseTokenMap>(evbAuxiliaryThread_)) {}
+      asyncWriters_(createAsyncWriters(opts_.asynclog_num_threads)),
+      leaseTokenMap_(folly::make_unique<LeaseTokenMap>(evbAuxiliaryThread_)) {
+  if (opts_.enable_compression && opts_.compression_dictionary_training) {
+    if (CompressionDictionaryTrainer::isSupported()) {
+      compressionDictionaryTrainer_ =
+          folly::make_unique<CompressionDictionaryTrainer>();
+    } else {
+      LOG(WARNING) << "Compression dictionary training requested, "
+                      "but this build has no zdict support.";
+    }
+  }
+  if (!opts_.tko_shared_memory_path.empty()) {
+    if (auto board = TkoSharedBoard::open(opts_.tko_shared_memory_path)) {
+      tkoTrackerMap_.setSharedBoard(std::move(board));
+    } else {
+      LOG(ERROR) << "Can't attach shared TKO board at "
+                 << opts_.tko_shared_memory_path
+                 << ", running with instance-local TKO state";
+    }
+  }
+}
+
+Proxy* McrouterInstanceBase::pickProxyForRequest(Proxy* assigned) {
+  const size_t threshold = opts_.proxy_steal_threshold;
+  if (threshold == 0 || opts_.num_proxies <= 1 ||
+      assigned->queueDepth() < threshold) {
+    return assigned;
+  }
+  Proxy* best = assigned;
+  size_t bestDepth = assigned->queueDepth();
+  /* Don't steal onto proxies that haven't been brought up yet */
+  const size_t numReady =
+    std::min(opts_.num_proxies, readyProxyCount());
+  for (size_t i = 0; i < numReady; ++i) {
+    auto proxy = getProxy(i);
+    const auto depth = proxy->queueDepth();
+    if (depth < bestDepth) {
+      best = proxy;
+      bestDepth = depth;
+    }
+  }
+  if (best != assigned) {
+    stolenRequests_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return best;
+}
 
 void McrouterInstanceBase::setUpCompressionDictionaries(
     std::unordered_map<uint32_t, CodecConfigPtr>&& codecConfigs) noexcept {
-  if (codecConfigs.empty() || compressionCodecManager_ != nullptr) {
+  if (codecConfigs.empty()) {
+    return;
+  }
+  if (compressionCodecManager_ != nullptr) {
+    compressionCodecManager_->updateCodecConfigs(std::move(codecConfigs));
     return;
   }
-  compressionCodecManager_ = folly::make_unique<const CompressionCodecManager>(
-      std::move(codecConfigs));
+  compressionCodecManager_ =
+      folly::make_unique<CompressionCodecManager>(std::move(codecConfigs));
 }
 
 void McrouterInstanceBase::addStartupOpts(
@@ -9,14 +9,17 @@
  */
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include <folly/io/async/ScopedEventBaseThread.h>
 
 #include "mcrouter/ConfigApi.h"
 #include "mcrouter/LeaseTokenMap.h"
 #include "mcrouter/Observable.h"
+#include "mcrouter/StatsSnapshot.h"
 #include "mcrouter/TkoTracker.h"
 #include "mcrouter/options.h"
 
@@ -26,6 +29,7 @@ namespace facebook { namespace memcache {
 struct CodecConfig;
 using CodecConfigPtr = std::unique_ptr<CodecConfig>;
 class CompressionCodecManager;
+class CompressionDictionaryTrainer;
 
 namespace mcrouter {
 
@@ -57,9 +61,24 @@ class McrouterInstanceBase {
     return compressionCodecManager_.get();
   }
 
+  /**
+   * Sets (or, on a dictionary rollover, replaces) the compression codec
+   * configs. Codec maps built from the previous configs stay usable for
+   * decode until their connections go away.
+   */
   void setUpCompressionDictionaries(
       std::unordered_map<uint32_t, CodecConfigPtr>&& codecConfigs) noexcept;
 
+  /**
+   * Returns the online compression dictionary trainer, or nullptr if
+   * --compression-dictionary-training is off (or unsupported by this
+   * build). Proxy threads feed it sampled reply values; a background
+   * thread turns them into dictionary rollovers.
+   */
+  CompressionDictionaryTrainer* compressionDictionaryTrainer() const {
+    return compressionDictionaryTrainer_.get();
+  }
+
   TkoTrackerMap& tkoTrackerMap() {
     return tkoTrackerMap_;
   }
@@ -78,6 +97,10 @@ class McrouterInstanceBase {
     return *statsLogWriter_;
   }
 
+  StatsSnapshot& statsSnapshot() {
+    return statsSnapshot_;
+  }
+
   LeaseTokenMap& leaseTokenMap() {
     return *leaseTokenMap_;
   }
@@ -91,8 +114,21 @@ class McrouterInstanceBase {
   }
 
   AsyncWriter& asyncWriter() {
-    assert(asyncWriter_.get() != nullptr);
-    return *asyncWriter_;
+    return asyncWriter(0);
+  }
+
+  /**
+   * One of the asynclog writer shards (see --asynclog-num-threads);
+   * asynclog traffic is spread over them by key hash.
+   */
+  AsyncWriter& asyncWriter(size_t shard) {
+    assert(shard < asyncWriters_.size());
+    assert(asyncWriters_[shard].get() != nullptr);
+    return *asyncWriters_[shard];
+  }
+
+  size_t numAsyncWriters() const {
+    return asyncWriters_.size();
   }
 
   std::unordered_map<std::string, std::string> getStartupOpts() const;
@@ -121,6 +157,33 @@ class McrouterInstanceBase {
    */
   virtual Proxy* getProxy(size_t index) const = 0;
 
+  /**
+   * Picks the proxy that should run the next request of a client
+   * assigned to `assigned`.  When --proxy-steal-threshold is set and
+   * the assigned proxy's message queue is at or above the threshold,
+   * returns the least-loaded proxy instead; otherwise returns
+   * `assigned`.  Can be called from any thread.
+   */
+  Proxy* pickProxyForRequest(Proxy* assigned);
+
+  /**
+   * Number of proxies that are configured and serving requests. With
+   * --background-proxy-init this grows from 1 to num_proxies as the
+   * background thread brings the remaining proxies up; otherwise it
+   * equals num_proxies once the instance is initialized.
+   */
+  size_t readyProxyCount() const {
+    return readyProxyCount_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @return  total number of requests redirected away from their
+   *          assigned proxy by pickProxyForRequest().
+   */
+  uint64_t stolenRequests() const {
+    return stolenRequests_.load(std::memory_order_relaxed);
+  }
+
  protected:
   const McrouterOptions opts_;
   const pid_t pid_;
@@ -129,9 +192,9 @@ class McrouterInstanceBase {
   const std::unique_ptr<AsyncWriter> statsLogWriter_;
 
   /*
-   * Asynchronous writer.
+   * Asynchronous writer shards.
    */
-  const std::unique_ptr<AsyncWriter> asyncWriter_;
+  const std::vector<std::unique_ptr<AsyncWriter>> asyncWriters_;
 
   // Auxiliary EventBase thread.
   folly::ScopedEventBaseThread evbAuxiliaryThread_;
@@ -146,13 +209,27 @@ class McrouterInstanceBase {
   // Stores whether we should reconnect after hitting rxmit threshold
   std::atomic<bool> disableRxmitReconnection_{true};
 
+  // Requests redirected to a less loaded proxy (--proxy-steal-threshold)
+  std::atomic<uint64_t> stolenRequests_{0};
+
+  // See readyProxyCount(); published by the initialization code
+  std::atomic<size_t> readyProxyCount_{0};
+
+  void setReadyProxyCount(size_t count) {
+    readyProxyCount_.store(count, std::memory_order_release);
+  }
+
  private:
   TkoTrackerMap tkoTrackerMap_;
-  std::unique_ptr<const CompressionCodecManager> compressionCodecManager_;
+  std::unique_ptr<CompressionCodecManager> compressionCodecManager_;
+  std::unique_ptr<CompressionDictionaryTrainer> compressionDictionaryTrainer_;
 
   // Stores data for runtime variables.
   ObservableRuntimeVars rtVarsData_;
 
+  // Snapshot of the stats published by the stats logger thread.
+  StatsSnapshot statsSnapshot_;
+
   // Keep track of lease tokens of failed over requests.
   const std::unique_ptr<LeaseTokenMap> leaseTokenMap_;
 
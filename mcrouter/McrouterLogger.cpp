@@ -13,12 +13,14 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <chrono>
 #include <string>
 
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
 
 #include <folly/DynamicConverter.h>
+#include <folly/Memory.h>
 #include <folly/json.h>
 #include <folly/ThreadName.h>
 
@@ -27,13 +29,14 @@
 #include "mcrouter/McrouterInstance.h"
 #include "mcrouter/McrouterLogFailure.h"
 #include "mcrouter/OptionsUtil.h"
+#include "mcrouter/StatsBinaryLog.h"
 #include "mcrouter/stats.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
 namespace {
 
-const char* kStatsSfx = "stats";
+const char* kStatsBinSfx = "stats.bin";
 const char* kStatsStartupOptionsSfx = "startup_options";
 const char* kConfigSourcesInfoFileName = "config_sources_info";
 
@@ -75,46 +78,6 @@ void write_stats_file(const McrouterOptions& opts,
   write_file(opts, suffix, statsString);
 }
 
-void write_stats_to_disk(const McrouterOptions& opts,
-                         const std::vector<stat_t>& stats) {
-  try {
-    std::string prefix = getStatPrefix(opts) + ".";
-    folly::dynamic jstats = folly::dynamic::object;
-
-    for (size_t i = 0; i < stats.size(); ++i) {
-      if (opts.logging_rtt_outlier_threshold_us == 0 &&
-          (stats[i].group & outlier_stats)) {
-        // outlier detection is disabled
-        continue;
-      }
-      if (stats[i].group & ods_stats) {
-        auto key = prefix + stats[i].name.str();
-
-        switch (stats[i].type) {
-          case stat_uint64:
-            jstats[key] = stats[i].data.uint64;
-            break;
-
-          case stat_int64:
-            jstats[key] = stats[i].data.int64;
-            break;
-
-          case stat_double:
-            jstats[key] = stats[i].data.dbl;
-            break;
-
-          default:
-            continue;
-        }
-      }
-    }
-
-    write_stats_file(opts, kStatsSfx, jstats);
-  } catch (const std::exception& e) {
-    VLOG(1) << "Failed to write stats to disk: " << e.what();
-  }
-}
-
 void write_config_sources_info_to_disk(McrouterInstance& router) {
   auto config_info_json = router.configApi().getConfigSourcesInfo();
 
@@ -236,7 +199,23 @@ void McrouterLogger::log() {
     }
   }
 
-  write_stats_to_disk(router_.opts(), stats);
+  if (!statsLog_) {
+    // In case the dir was deleted some time after mcrouter started
+    if (ensureDirExistsAndWritable(router_.opts().stats_root)) {
+      statsLog_ = folly::make_unique<StatsBinaryLog>(
+          stats_file_path(router_.opts(), kStatsBinSfx),
+          stats,
+          router_.opts());
+    }
+  }
+  router_.statsSnapshot().publish(stats_snapshot_entries(stats));
+
+  if (statsLog_ && statsLog_->initialized()) {
+    statsLog_->append(
+        stats,
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+  }
   write_config_sources_info_to_disk(router_);
 
   for (const auto& filepath : touchStatsFilepaths_) {
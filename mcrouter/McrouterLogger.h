@@ -20,6 +20,7 @@
 namespace facebook { namespace memcache { namespace mcrouter {
 
 class McrouterInstance;
+class StatsBinaryLog;
 class stat_t;
 
 class AdditionalLoggerIf {
@@ -69,6 +70,12 @@ class McrouterLogger {
 
   std::unique_ptr<AdditionalLoggerIf> additionalLogger_;
 
+  /**
+   * Binary ring the periodic stats snapshots are appended to; created
+   * lazily on the first log() call. See StatsBinaryLog.h.
+   */
+  std::unique_ptr<StatsBinaryLog> statsLog_;
+
   /**
    * File paths of stats we want to touch and keep their mtimes up-to-date
    */
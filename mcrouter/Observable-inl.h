@@ -7,15 +7,13 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
-#include <mutex>
-
 #include "mcrouter/lib/fbi/cpp/LogFailure.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
 template<class Data>
 Observable<Data>::Observable(Data data)
-  : data_(std::move(data)) {
+  : data_(std::make_shared<const Data>(std::move(data))) {
 }
 
 template<class Data>
@@ -27,9 +25,11 @@ Observable<Data>::subscribe(OnUpdateOldNew callback) {
 template<class Data>
 typename Observable<Data>::CallbackHandle
 Observable<Data>::subscribeAndCall(OnUpdateOldNew callback) {
-  std::lock_guard<SFRReadLock> lck(dataLock_.readLock());
+  // hold the write mutex so no update can sneak in between the initial
+  // call and the subscription
+  std::lock_guard<std::mutex> lck(writeMutex_);
   try {
-    callback(Data(), data_);
+    callback(Data(), *data_);
   } catch (const std::exception& e) {
     LOG_FAILURE("mcrouter", failure::Category::kOther,
                 "Error occured in observable callback: {}", e.what());
@@ -42,17 +42,18 @@ Observable<Data>::subscribeAndCall(OnUpdateOldNew callback) {
 
 template<class Data>
 Data Observable<Data>::get() {
-  std::lock_guard<SFRReadLock> lck(dataLock_.readLock());
-  return data_;
+  return *std::atomic_load_explicit(&data_, std::memory_order_acquire);
 }
 
 template<class Data>
 void Observable<Data>::set(Data data) {
-  std::lock_guard<SFRWriteLock> lck(dataLock_.writeLock());
-  auto old = std::move(data_);
-  data_ = std::move(data);
-  // no copy here, because old and data are passed by const reference
-  pool_.notify(old, data_);
+  std::lock_guard<std::mutex> lck(writeMutex_);
+  // keep the old snapshot alive while callbacks still reference it
+  auto old = data_;
+  auto next = std::make_shared<const Data>(std::move(data));
+  std::atomic_store_explicit(&data_, next, std::memory_order_release);
+  // no copy here, because old and next are passed by const reference
+  pool_.notify(*old, *next);
 }
 
 template<class Data>
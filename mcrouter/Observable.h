@@ -10,9 +10,10 @@
 #pragma once
 
 #include <functional>
+#include <memory>
+#include <mutex>
 
 #include "mcrouter/CallbackPool.h"
-#include "mcrouter/lib/fbi/cpp/sfrlock.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
@@ -58,9 +59,9 @@ class Observable {
   inline CallbackHandle subscribeAndCall(OnUpdateOldNew callback);
 
   /**
-   * Update stored data. Both data change and callback calls are processed under
-   * write lock on data. So one can assume data change and callback calls is an
-   * atomic operation.
+   * Update stored data. Updates (and their callback calls) are serialized
+   * with each other and with subscribeAndCall, so no subscriber can miss or
+   * reorder an update. Readers ('get') never block on an update in progress.
    */
   inline void set(Data data);
 
@@ -73,15 +74,23 @@ class Observable {
   inline void emplace(Args&&... args);
 
   /**
-   * @return copy of stored data
+   * @return copy of stored data. Lock-free: reads the current snapshot
+   * with a plain atomic load.
    */
   inline Data get();
 
  private:
   CallbackPool<const Data&, const Data&> pool_;
-  Data data_;
+  /**
+   * Current data snapshot, never null. Replaced wholesale on 'set' with an
+   * atomic shared_ptr store and read with an atomic load, so readers never
+   * contend with writers. The old snapshot is kept alive for the duration
+   * of the callback calls.
+   */
+  std::shared_ptr<const Data> data_;
 
-  SFRLock dataLock_;
+  // serializes 'set' (including callback calls) and 'subscribeAndCall'
+  std::mutex writeMutex_;
 };
 
 }}} // facebook::memcache::mcrouter
@@ -9,6 +9,9 @@
  */
 #include "PoolFactory.h"
 
+#include <string>
+#include <vector>
+
 #include <folly/json.h>
 
 #include "mcrouter/ConfigApi.h"
@@ -16,8 +19,27 @@
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
-PoolFactory::PoolFactory(const folly::dynamic& config, ConfigApiIf& configApi)
-  : configApi_(configApi) {
+PoolFactory::PoolFactory(const folly::dynamic& config,
+                         ConfigApiIf& configApi,
+                         std::shared_ptr<AccessPointCache> accessPointCache)
+  : accessPointCache_(accessPointCache
+      ? std::move(accessPointCache)
+      : std::make_shared<AccessPointCache>()),
+    configApi_(configApi) {
+
+  // Drop access points the previous config generation didn't use and
+  // reset usage marks for this build.
+  std::vector<std::string> unused;
+  for (auto& it : *accessPointCache_) {
+    if (!it.second.second) {
+      unused.push_back(it.first.str());
+    } else {
+      it.second.second = false;
+    }
+  }
+  for (const auto& key : unused) {
+    accessPointCache_->erase(key);
+  }
 
   checkLogic(config.isObject(), "config is not an object");
   if (auto jpools = config.get_ptr("pools")) {
@@ -78,4 +100,19 @@ PoolFactory::PoolJson PoolFactory::parsePool(const folly::dynamic& json) {
   return parseNamedPool(jname->stringPiece());
 }
 
+std::shared_ptr<AccessPoint>
+PoolFactory::findAccessPoint(folly::StringPiece key) const {
+  auto it = accessPointCache_->find(key);
+  if (it == accessPointCache_->end()) {
+    return nullptr;
+  }
+  it->second.second = true;
+  return it->second.first;
+}
+
+void PoolFactory::cacheAccessPoint(folly::StringPiece key,
+                                   std::shared_ptr<AccessPoint> ap) {
+  accessPointCache_->emplace(key, std::make_pair(std::move(ap), true));
+}
+
 }}}  // facebook::memcache::mcrouter
@@ -9,10 +9,16 @@
  */
 #pragma once
 
+#include <memory>
+
 #include <folly/dynamic.h>
 #include <folly/experimental/StringKeyedUnorderedMap.h>
 
-namespace facebook { namespace memcache { namespace mcrouter {
+namespace facebook { namespace memcache {
+
+struct AccessPoint;
+
+namespace mcrouter {
 
 class ConfigApiIf;
 
@@ -29,12 +35,25 @@ class PoolFactory {
     const folly::dynamic& json;
   };
 
+  /**
+   * AccessPoints parsed from server strings, keyed by the string plus the
+   * parsing defaults. Entries that go unused for a whole config generation
+   * are dropped by the next one.
+   */
+  using AccessPointCache = folly::StringKeyedUnorderedMap<
+    std::pair<std::shared_ptr<AccessPoint>, bool>>;
+
   /**
    * @param config JSON object with clusters/pools properties (both optional).
    * @param configApi API to fetch pools from files. Should be
    *                  reference once we'll remove 'routerless' mode.
+   * @param accessPointCache cache shared with previous config generations,
+   *                         so unchanged servers are not reparsed on every
+   *                         reconfiguration. May be nullptr.
    */
-  PoolFactory(const folly::dynamic& config, ConfigApiIf& configApi);
+  PoolFactory(const folly::dynamic& config,
+              ConfigApiIf& configApi,
+              std::shared_ptr<AccessPointCache> accessPointCache = nullptr);
 
   /**
    * Load pool from ConfigApi, expand `inherit`, etc.
@@ -45,6 +64,21 @@ class PoolFactory {
    */
   PoolJson parsePool(const folly::dynamic& json);
 
+  /**
+   * @return AccessPoint previously cached under the given key,
+   *         or nullptr if there is none.
+   */
+  std::shared_ptr<AccessPoint> findAccessPoint(folly::StringPiece key) const;
+
+  /**
+   * Caches an AccessPoint parsed from a server string. The key should
+   * encode the string together with the parsing defaults. All proxies
+   * built from this factory share the cached object, so it must not be
+   * modified after insertion.
+   */
+  void cacheAccessPoint(folly::StringPiece key,
+                        std::shared_ptr<AccessPoint> ap);
+
  private:
   enum class PoolState {
     NEW,
@@ -52,6 +86,7 @@ class PoolFactory {
     PARSED
   };
   folly::StringKeyedUnorderedMap<std::pair<folly::dynamic, PoolState>> pools_;
+  std::shared_ptr<AccessPointCache> accessPointCache_;
   ConfigApiIf& configApi_;
 
   PoolJson parseNamedPool(folly::StringPiece name);
@@ -73,7 +73,7 @@ Proxy::routeHandlesProcessRequest(
     const Request& req,
     std::unique_ptr<ProxyRequestContextTyped<Request>> uctx) {
   auto sharedCtx = ProxyRequestContextTyped<Request>::process(
-      std::move(uctx), getConfig());
+      std::move(uctx), getConfigCached());
 
   if (detail::processGetServiceInfoRequest(req, sharedCtx)) {
     return;
@@ -132,10 +132,45 @@ void Proxy::processRequest(
   stat_incr(stats, request_sent_count_stat, 1);
 }
 
+template <class Request>
+bool Proxy::shedIfOverloaded(const Request& req,
+                             ProxyRequestContextTyped<Request>& ctx) {
+  if (!GetLike<Request>::value && !UpdateLike<Request>::value) {
+    return false;
+  }
+  if (!brownoutShouldShed()) {
+    return false;
+  }
+  stat_incr(stats, brownout_shed_requests_stat, 1);
+  if (GetLike<Request>::value && getRouterOptions().brownout_gets_as_miss) {
+    ctx.sendReply(mc_res_notfound);
+  } else {
+    ctx.sendReply(mc_res_busy);
+  }
+  return true;
+}
+
+template <class Request>
+typename std::enable_if<Request::hasKey, void>::type
+Proxy::recordHotKey(const Request& req) {
+  hotKeys.touch(req.key().fullKey(), nowUs());
+}
+
+template <class Request>
+typename std::enable_if<!Request::hasKey, void>::type
+Proxy::recordHotKey(const Request&) {
+}
+
 template <class Request>
 void Proxy::dispatchRequest(
     const Request& req,
     std::unique_ptr<ProxyRequestContextTyped<Request>> ctx) {
+  /* Count demand before shedding or throttling: a key is hot even if
+     we end up not serving it. */
+  recordHotKey(req);
+  if (shedIfOverloaded(req, *ctx)) {
+    return;
+  }
   if (rateLimited(ctx->priority(), req)) {
     if (getRouterOptions().proxy_max_throttled_requests > 0 &&
         numRequestsWaiting_ >=
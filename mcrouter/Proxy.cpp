@@ -15,6 +15,7 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
 
 #include <boost/regex.hpp>
@@ -24,18 +25,22 @@
 #include <folly/File.h>
 #include <folly/FileUtil.h>
 #include <folly/Format.h>
+#include <folly/Likely.h>
 #include <folly/Memory.h>
-#include <folly/Random.h>
 #include <folly/Range.h>
 #include <folly/ThreadName.h>
 
 #include "mcrouter/async.h"
+#include "mcrouter/AsynclogSpoolFormat.h"
+#include "mcrouter/CompressionLevelController.h"
 #include "mcrouter/config-impl.h"
 #include "mcrouter/config.h"
+#include "mcrouter/lib/cycles/Clocks.h"
 #include "mcrouter/lib/cycles/Cycles.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
 #include "mcrouter/lib/fbi/queue.h"
 #include "mcrouter/lib/MessageQueue.h"
+#include "mcrouter/lib/network/AccessPoint.h"
 #include "mcrouter/lib/WeightedCh3HashFunc.h"
 #include "mcrouter/McrouterInstanceBase.h"
 #include "mcrouter/McrouterLogFailure.h"
@@ -46,6 +51,7 @@
 #include "mcrouter/ProxyRequestContext.h"
 #include "mcrouter/ProxyThread.h"
 #include "mcrouter/route.h"
+#include "mcrouter/routes/ProxyRoute.h"
 #include "mcrouter/routes/RateLimiter.h"
 #include "mcrouter/routes/ShardSplitter.h"
 #include "mcrouter/RuntimeVarsData.h"
@@ -55,6 +61,31 @@ namespace facebook { namespace memcache { namespace mcrouter {
 
 namespace {
 
+/* Refresh period of the coarse cached wall clock, see coarseNowWallSec() */
+constexpr uint32_t kCoarseClockIntervalMs = 250;
+
+/* Shadow sends handed to fibers per event loop iteration */
+constexpr size_t kShadowDrainBatchSize = 16;
+/* Retry delay when the loop is too lagged to send shadows */
+constexpr uint32_t kShadowRetryIntervalMs = 1;
+
+/* TKO events buffered per proxy between stat updater sweeps */
+constexpr size_t kTkoEventQueueSize = 256;
+
+const char* describeTkoEvent(TkoLogEvent event) {
+  switch (event) {
+    case TkoLogEvent::MarkHardTko:
+      return "marked hard TKO";
+    case TkoLogEvent::MarkSoftTko:
+      return "marked soft TKO";
+    case TkoLogEvent::UnMarkTko:
+      return "unmarked TKO";
+    case TkoLogEvent::RemoveFromConfig:
+      return "was TKO, removed from config";
+  }
+  return "unknown TKO event";
+}
+
 folly::fibers::FiberManager::Options getFiberManagerOptions(
     const McrouterOptions& opts) {
   folly::fibers::FiberManager::Options fmOpts;
@@ -101,17 +132,19 @@ bool processGetServiceInfoRequestImpl(
 Proxy::Proxy(McrouterInstanceBase& rtr, size_t id)
     : router_(rtr),
       destinationMap(folly::make_unique<ProxyDestinationMap>(this)),
+      asynclogShards(rtr.numAsyncWriters()),
       fiberManager(
           fiber_local::ContextTypeTag(),
           folly::make_unique<folly::fibers::EventBaseLoopController>(),
           getFiberManagerOptions(router_.opts())),
+      shadowQueueDrainer_(*this),
+      canaryInjector_(*this),
+      tkoEventQueue_(kTkoEventQueueSize),
       id_(id) {
   memset(stats, 0, sizeof(stats));
   memset(stats_bin, 0, sizeof(stats_bin));
   memset(stats_num_within_window, 0, sizeof(stats_num_within_window));
 
-  // Setup a full random seed sequence
-  folly::Random::seed(randomGenerator);
   static uint64_t next_magic = 0x12345678900000LL;
 
   magic = __sync_fetch_and_add(&next_magic, 1);
@@ -124,6 +157,7 @@ Proxy::Proxy(McrouterInstanceBase& rtr, size_t id)
       this->messageReady(message.type, message.data);
     },
     router_.opts().client_queue_no_notify_rate,
+    router_.opts().client_queue_target_latency_us,
     router_.opts().client_queue_wait_threshold_us,
     &nowUs,
     [this] () {
@@ -159,35 +193,119 @@ Proxy::Pointer Proxy::createProxy(
         proxy->destinationMap->setResetTimer(connectionResetInterval);
       }
 
+      std::chrono::milliseconds dnsRefreshInterval{
+        proxy->router_.opts().dns_refresh_interval_ms
+      };
+
+      if (dnsRefreshInterval.count() > 0) {
+        proxy->destinationMap->setDnsRefreshTimer(dnsRefreshInterval);
+      }
+
+      proxy->shadowQueueDrainer_.attachEventBase(eventBase);
+
+      proxy->coarseClockTimer_ = folly::make_unique<AsyncTimer<Proxy>>(*proxy);
+      proxy->coarseClockTimer_->attachEventBase(&eventBase);
+      /* Prime the cached clock and start the refresh cycle */
+      proxy->timerCallback();
+
+      if (proxy->router_.opts().enable_compression &&
+          proxy->router_.opts().adaptive_compression) {
+        proxy->compressionLevelController_ =
+            folly::make_unique<CompressionLevelController>(*proxy);
+        proxy->compressionLevelController_->attachEventBase(eventBase);
+      }
+
       if (proxy->router_.opts().cpu_cycles) {
         cycles::attachEventBase(eventBase);
         proxy->fiberManager.setObserver(&proxy->cyclesObserver);
       }
+
+      if (proxy->router_.opts().canary_interval_ms > 0) {
+        proxy->canaryInjector_.attachEventBase(eventBase);
+        /* Inject the first canary and start the cycle */
+        proxy->canaryInjector_.timerCallback();
+      }
     });
 
   return Pointer(proxy.get());
 }
 
+void Proxy::timerCallback() {
+  coarseNowWallSec_.store(nowWallSec(), std::memory_order_relaxed);
+  if (!coarseClockTimer_->scheduleTimeout(kCoarseClockIntervalMs)) {
+    MC_LOG_FAILURE(router_.opts(),
+                   memcache::failure::Category::kSystemError,
+                   "failed to schedule coarse clock timer");
+  }
+}
+
+void Proxy::CanaryInjector::timerCallback() {
+  const auto injectedAt = cycles::getCpuCycles();
+  proxy_.fiberManager.addTask([&proxy = proxy_, injectedAt]() {
+    /* Time from the timer firing to the fiber running: event loop and
+       fiber scheduling overhead every real request also pays. */
+    const auto startedAt = cycles::getCpuCycles();
+    auto config = proxy.getConfigCached();
+    if (config == nullptr) {
+      return;
+    }
+    folly::fibers::Baton baton;
+    auto ctx = ProxyRequestContext::createRecordingNotify(
+        proxy, baton, /* clientCallback */ nullptr);
+    McGetRequest canaryReq("__mcrouter__.canary");
+    fiber_local::runWithLocals([ctx = std::move(ctx),
+                                &canaryReq,
+                                &proxyRoute = config->proxyRoute()]() mutable {
+      fiber_local::setSharedCtx(std::move(ctx));
+      /* The reply is synthesized at DestinationRoute; ignore it */
+      proxyRoute.route(canaryReq);
+    });
+    baton.wait();
+    const auto routedAt = cycles::getCpuCycles();
+    stat_set_uint64(proxy.stats, canary_dispatch_cycles_stat,
+                    startedAt - injectedAt);
+    stat_set_uint64(proxy.stats, canary_route_cycles_stat,
+                    routedAt - startedAt);
+  });
+
+  if (!timer_.scheduleTimeout(proxy_.router().opts().canary_interval_ms)) {
+    MC_LOG_FAILURE(proxy_.router().opts(),
+                   memcache::failure::Category::kSystemError,
+                   "failed to schedule canary timer");
+  }
+}
+
 std::shared_ptr<ProxyConfig> Proxy::getConfig() const {
-  std::lock_guard<SFRReadLock> lg(
-    const_cast<SFRLock&>(configLock_).readLock());
+  std::lock_guard<SFRDistReadLock> lg(
+    const_cast<SFRDistLock&>(configLock_).readLock());
   return config_;
 }
 
-std::pair<std::unique_lock<SFRReadLock>, ProxyConfig&> Proxy::getConfigLocked()
-    const {
-  std::unique_lock<SFRReadLock> lock(
-    const_cast<SFRLock&>(configLock_).readLock());
+std::pair<std::unique_lock<SFRDistReadLock>, ProxyConfig&>
+Proxy::getConfigLocked() const {
+  std::unique_lock<SFRDistReadLock> lock(
+    const_cast<SFRDistLock&>(configLock_).readLock());
   /* make_pair strips the reference, so construct directly */
-  return std::pair<std::unique_lock<SFRReadLock>, ProxyConfig&>(
+  return std::pair<std::unique_lock<SFRDistReadLock>, ProxyConfig&>(
     std::move(lock), *config_);
 }
 
+std::shared_ptr<ProxyConfig> Proxy::getConfigCached() {
+  auto generation = configGeneration_.load(std::memory_order_acquire);
+  if (UNLIKELY(cachedConfigGeneration_ != generation || !cachedConfig_)) {
+    // a swap racing with us just means one extra refresh on the next request
+    cachedConfig_ = getConfig();
+    cachedConfigGeneration_ = generation;
+  }
+  return cachedConfig_;
+}
+
 std::shared_ptr<ProxyConfig> Proxy::swapConfig(
     std::shared_ptr<ProxyConfig> newConfig) {
-  std::lock_guard<SFRWriteLock> lg(configLock_.writeLock());
+  std::lock_guard<SFRDistWriteLock> lg(configLock_.writeLock());
   auto old = std::move(config_);
   config_ = std::move(newConfig);
+  configGeneration_.fetch_add(1, std::memory_order_release);
   return old;
 }
 
@@ -206,7 +324,15 @@ Proxy::~Proxy() {
 
 void Proxy::sendMessage(ProxyMessage::Type t, void* data) noexcept {
   CHECK(messageQueue_.get());
-  messageQueue_->blockingWrite(t, data);
+  /* Config and shutdown messages must not wait behind a request flood. */
+  messageQueue_->blockingWritePriority(t, data);
+}
+
+void Proxy::sendTask(std::function<void()> func) noexcept {
+  CHECK(messageQueue_.get());
+  messageQueue_->blockingWriteRelaxed(
+      ProxyMessage::Type::TASK,
+      new std::function<void()>(std::move(func)));
 }
 
 void Proxy::drainMessageQueue() {
@@ -221,6 +347,126 @@ size_t Proxy::queueNotifyPeriod() const {
   return 0;
 }
 
+int64_t Proxy::queueWakeupLatencyUs() const {
+  if (messageQueue_) {
+    return messageQueue_->wakeupLatencyUs();
+  }
+  return 0;
+}
+
+int64_t Proxy::queueDrainIntervalUs() const {
+  if (messageQueue_) {
+    return messageQueue_->avgDrainIntervalUs();
+  }
+  return 0;
+}
+
+size_t Proxy::queueDepth() const {
+  if (messageQueue_) {
+    return messageQueue_->pendingMessages();
+  }
+  return 0;
+}
+
+void Proxy::recordTkoEvent(TkoEvent event) noexcept {
+  if (!tkoEventQueue_.writeIfNotFull(std::move(event))) {
+    droppedTkoEvents_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Proxy::drainTkoEvents() {
+  TkoEvent ev;
+  while (tkoEventQueue_.readIfNotEmpty(ev)) {
+    VLOG(1) << ev.accessPoint->toHostPortString() << " (" << ev.poolName
+            << ") " << describeTkoEvent(ev.event)
+            << ". Total hard TKOs: " << ev.globalHardTkos
+            << "; soft TKOs: " << ev.globalSoftTkos
+            << ". Reply: " << mc_res_to_string(ev.result);
+
+    TkoLog tkoLog(*ev.accessPoint);
+    tkoLog.event = ev.event;
+    tkoLog.isHardTko = ev.isHardTko;
+    tkoLog.isSoftTko = ev.isSoftTko;
+    tkoLog.avgLatency = ev.avgLatency;
+    tkoLog.probesSent = ev.probesSent;
+    tkoLog.globalSoftTkos = ev.globalSoftTkos;
+    tkoLog.globalHardTkos = ev.globalHardTkos;
+    tkoLog.poolName = ev.poolName;
+    tkoLog.result = ev.result;
+    logTkoEvent(*this, tkoLog);
+  }
+
+  auto dropped = droppedTkoEvents_.exchange(0, std::memory_order_relaxed);
+  if (dropped > 0) {
+    VLOG(1) << dropped << " TKO events dropped on queue overflow";
+  }
+}
+
+void Proxy::dispatchShadowTask(std::function<void()> task) noexcept {
+  const auto maxQueued = getRouterOptions().max_shadow_queue_size;
+  if (maxQueued != 0 && shadowQueue_.size() >= maxQueued) {
+    stat_incr(stats, shadow_queue_drops_stat, 1);
+    return;
+  }
+  shadowQueue_.push_back(std::move(task));
+  shadowQueueDrainer_.schedule();
+}
+
+void Proxy::ShadowQueueDrainer::schedule() {
+  if (!isLoopCallbackScheduled() && !retryTimer_.isScheduled()) {
+    proxy_.eventBase().runInLoop(this);
+  }
+}
+
+void Proxy::ShadowQueueDrainer::runLoopCallback() noexcept {
+  const auto maxLagUs =
+      static_cast<int64_t>(proxy_.getRouterOptions().shadow_send_max_lag_us);
+  if (maxLagUs != 0 && proxy_.queueDrainIntervalUs() > maxLagUs) {
+    /* Production traffic is keeping the loop busy; retry on a timer
+       rather than a loop callback so held shadows don't stop the loop
+       from sleeping.  Overflow drops bound the queue in the meantime. */
+    retryTimer_.scheduleTimeout(kShadowRetryIntervalMs);
+    return;
+  }
+
+  auto batch = std::min(proxy_.shadowQueue_.size(), kShadowDrainBatchSize);
+  while (batch-- > 0) {
+    proxy_.fiberManager.addTask(std::move(proxy_.shadowQueue_.front()));
+    proxy_.shadowQueue_.pop_front();
+  }
+  if (!proxy_.shadowQueue_.empty()) {
+    proxy_.eventBase().runInLoop(this);
+  }
+}
+
+bool Proxy::brownoutShouldShed() {
+  const auto& opts = getRouterOptions();
+  const auto thresholdUs =
+      static_cast<int64_t>(opts.brownout_lag_threshold_us);
+  if (thresholdUs == 0) {
+    return false;
+  }
+  const int64_t lagUs = queueDrainIntervalUs();
+  if (lagUs <= thresholdUs) {
+    return false;
+  }
+  /* Shed fraction ramps linearly from 0 at the threshold to the
+     configured maximum at twice the threshold. */
+  const double maxFraction =
+      std::min<size_t>(opts.brownout_max_shed_percent, 100) / 100.0;
+  const double fraction = std::min(
+      maxFraction,
+      maxFraction * (static_cast<double>(lagUs) / thresholdUs - 1.0));
+  return randomGenerator.randomDouble() < fraction;
+}
+
+uint32_t Proxy::adaptiveCompressionLevel() const {
+  if (compressionLevelController_) {
+    return compressionLevelController_->currentLevel();
+  }
+  return 0;
+}
+
 void Proxy::messageReady(ProxyMessage::Type t, void* data) {
   switch (t) {
     case ProxyMessage::Type::REQUEST:
@@ -243,6 +489,14 @@ void Proxy::messageReady(ProxyMessage::Type t, void* data) {
        * it can exit event loop and check router->shutdown
        */
       break;
+
+    case ProxyMessage::Type::TASK:
+    {
+      std::unique_ptr<std::function<void()>> task(
+          reinterpret_cast<std::function<void()>*>(data));
+      fiberManager.addTask(std::move(*task));
+    }
+    break;
   }
 }
 
@@ -261,6 +515,139 @@ void Proxy::routeHandlesProcessRequest(
   ctx->sendReply(std::move(reply));
 }
 
+void Proxy::dispatchGetBatch(
+    std::unique_ptr<ProxyRequestContextGetBatch> ctx) {
+  assert(!ctx->requests().empty());
+
+  /* One shed roll covers the whole batch, so each member is still shed
+     with the configured probability. */
+  if (brownoutShouldShed()) {
+    stat_incr(stats, brownout_shed_requests_stat, ctx->requests().size());
+    ctx->sendReplies(getRouterOptions().brownout_gets_as_miss
+                         ? mc_res_notfound
+                         : mc_res_busy);
+    return;
+  }
+
+  if (rateLimited(ctx->priority(), ctx->requests().front())) {
+    if (getRouterOptions().proxy_max_throttled_requests > 0 &&
+        numRequestsWaiting_ >=
+            getRouterOptions().proxy_max_throttled_requests) {
+      ctx->sendReplies(mc_res_busy);
+      return;
+    }
+    auto& queue = waitingRequests_[static_cast<int>(ctx->priority())];
+    auto w = folly::make_unique<WaitingGetBatch>(std::move(ctx));
+    if (getRouterOptions().proxy_max_inflight_requests > 0 &&
+        getRouterOptions().proxy_max_throttled_requests > 0 &&
+        getRouterOptions().waiting_request_timeout_ms > 0) {
+      w->setTimePushedOnQueue(nowUs());
+    }
+    queue.pushBack(std::move(w));
+    ++numRequestsWaiting_;
+    stat_incr(stats, proxy_reqs_waiting_stat, 1);
+  } else {
+    processGetBatch(std::move(ctx));
+  }
+}
+
+void Proxy::processGetBatch(
+    std::unique_ptr<ProxyRequestContextGetBatch> uctx) {
+  assert(!uctx->processing_);
+  uctx->processing_ = true;
+  const auto n = uctx->requests().size();
+  numRequestsProcessing_ += n;
+  stat_incr(stats, proxy_reqs_processing_stat, n);
+  stat_incr(stats, cmd_get_stat, n);
+  stat_incr(stats, cmd_get_count_stat, n);
+
+  auto ctx =
+      ProxyRequestContextGetBatch::process(std::move(uctx), getConfigCached());
+  auto funcCtx = ctx;
+
+  fiberManager.addTaskFinally(
+      [ctx = std::move(funcCtx)]() mutable {
+        auto& proute = ctx->proxyRoute();
+        auto& reqs = ctx->requests();
+        fiber_local::setSharedCtx(std::move(ctx));
+        try {
+          /* Validate keys up front; invalid ones get their error reply
+             in place and only the rest enter the route tree. */
+          bool allValid = true;
+          for (const auto& req : reqs) {
+            if (isKeyValid(req.key().fullKey()) != mc_req_err_valid) {
+              allValid = false;
+              break;
+            }
+          }
+          if (LIKELY(allValid)) {
+            return proute.route(std::move(reqs));
+          }
+
+          std::vector<McGetReply> replies(reqs.size());
+          std::vector<McGetRequest> valid;
+          std::vector<size_t> validIdx;
+          valid.reserve(reqs.size());
+          validIdx.reserve(reqs.size());
+          for (size_t i = 0; i < reqs.size(); ++i) {
+            const auto err = isKeyValid(reqs[i].key().fullKey());
+            if (err == mc_req_err_valid) {
+              validIdx.push_back(i);
+              valid.push_back(std::move(reqs[i]));
+            } else {
+              replies[i] = McGetReply(mc_res_local_error);
+              replies[i].message() = mc_req_err_to_string(err);
+            }
+          }
+          auto validReplies = proute.route(std::move(valid));
+          for (size_t j = 0; j < validIdx.size(); ++j) {
+            replies[validIdx[j]] = std::move(validReplies[j]);
+          }
+          return replies;
+        } catch (const std::exception& e) {
+          auto err = folly::sformat(
+              "Error routing get batch! Exception: {}", e.what());
+          std::vector<McGetReply> replies;
+          replies.reserve(reqs.size());
+          for (size_t i = 0; i < reqs.size(); ++i) {
+            McGetReply reply(mc_res_local_error);
+            reply.message() = err;
+            replies.push_back(std::move(reply));
+          }
+          return replies;
+        }
+      },
+      [ctx](folly::Try<std::vector<McGetReply>>&& replies) {
+        ctx->sendReplies(std::move(*replies));
+      });
+
+  stat_incr(stats, request_sent_stat, n);
+  stat_incr(stats, request_sent_count_stat, n);
+}
+
+Proxy::WaitingGetBatch::WaitingGetBatch(
+    std::unique_ptr<ProxyRequestContextGetBatch> ctx)
+    : ctx_(std::move(ctx)) {}
+
+Proxy::WaitingGetBatch::~WaitingGetBatch() = default;
+
+void Proxy::WaitingGetBatch::process(Proxy* proxy) {
+  // timePushedOnQueue_ is nonnegative only if waiting-requests-timeout is
+  // enabled
+  if (timePushedOnQueue_ >= 0) {
+    const auto durationInQueueUs = nowUs() - timePushedOnQueue_;
+
+    if (durationInQueueUs >
+        1000 * static_cast<int64_t>(
+          proxy->getRouterOptions().waiting_request_timeout_ms)) {
+      ctx_->sendReplies(mc_res_busy);
+      return;
+    }
+  }
+
+  proxy->processGetBatch(std::move(ctx_));
+}
+
 void Proxy::pump() {
   auto numPriorities = static_cast<int>(ProxyRequestPriority::kNumPriorities);
   for (int i = 0; i < numPriorities; ++i) {
@@ -17,25 +17,38 @@
 #include <sys/types.h>
 
 #include <atomic>
+#include <deque>
+#include <functional>
 #include <memory>
-#include <random>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <folly/detail/CacheLocality.h>
 #include <folly/fibers/FiberManager.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/MPMCQueue.h>
 #include <folly/Range.h>
 
+#include "mcrouter/AsyncTimer.h"
 #include "mcrouter/config.h"
 #include "mcrouter/CyclesObserver.h"
 #include "mcrouter/ExponentialSmoothData.h"
+#include "mcrouter/HotKeyTracker.h"
 #include "mcrouter/lib/mc/msg.h"
 #include "mcrouter/lib/mc/protocol.h"
 #include "mcrouter/lib/network/CarbonMessageList.h"
 #include "mcrouter/lib/network/UniqueIntrusiveList.h"
+#include "mcrouter/lib/Xorshift128Plus.h"
 #include "mcrouter/Observable.h"
 #include "mcrouter/options.h"
+#include "mcrouter/ProxyRequestContextPool.h"
 #include "mcrouter/ProxyRequestPriority.h"
+#include "mcrouter/SlowRequestRecorder.h"
 #include "mcrouter/stats.h"
+#include "mcrouter/TkoLog.h"
 
 // make sure MOVING_AVERAGE_WINDOW_SIZE_IN_SECOND can be exactly divided by
 // MOVING_AVERAGE_BIN_SIZE_IN_SECOND
@@ -48,6 +61,9 @@
 namespace folly {
   struct dynamic;
   class File;
+  namespace fibers {
+    class Baton;
+  } // fibers
 } // folly
 
 namespace facebook { namespace memcache {
@@ -59,6 +75,7 @@ class MessageQueue;
 
 namespace mcrouter {
 // forward declaration
+class CompressionLevelController;
 class McrouterClient;
 class McrouterInstance;
 class McrouterInstanceBase;
@@ -66,6 +83,7 @@ class ProxyConfig;
 class ProxyDestination;
 class ProxyDestinationMap;
 class ProxyRequestContext;
+class ProxyRequestContextGetBatch;
 template <class Request>
 class ProxyRequestContextTyped;
 class RuntimeVarsData;
@@ -127,11 +145,67 @@ struct ShadowSettings {
   ShadowSettings() = default;
 };
 
+class AsynclogSpoolWriter;
+
+/**
+ * One serialized asynclog line waiting for the awriter thread to write
+ * it out; see asynclog_delete() for the group-commit protocol.
+ */
+struct AsynclogEntry {
+  std::string line;
+  folly::fibers::Baton* baton;
+  int64_t enqueueUs;
+};
+
+/**
+ * Sliding-window dedupe state for asynclog deletes (see
+ * --asynclog-dedupe-window-ms). Two rotating buckets of 64-bit entry
+ * hashes give an effective window between one and two configured
+ * windows. Touched by the proxy thread only.
+ */
+struct AsynclogDedupe {
+  int64_t bucketStartUs{0};
+  std::unordered_set<uint64_t> current;
+  std::unordered_set<uint64_t> previous;
+};
+
+/**
+ * In-flight lease-get state for one key (see
+ * --lease-get-collapse-wait-ms); defined in ProxyRoute.cpp. The entry
+ * lives on the leader fiber's stack while its lease-get is outstanding.
+ */
+struct LeaseGetCollapseEntry;
+
+/**
+ * Asynclog group-commit state for one writer shard: entries serialized
+ * by proxy fibers, written out in batches by the shard's awriter
+ * thread. Entries are sharded by key hash (see asynclog_delete()), and
+ * each (proxy, shard) pair appends to its own spool file.
+ */
+struct AsynclogShard {
+  std::mutex batchLock;
+  std::vector<AsynclogEntry> batch;
+  /** True while a flush task is queued on the shard's awriter. */
+  bool flushScheduled{false};
+
+  /* The members below are touched by the shard's awriter thread only */
+
+  std::shared_ptr<folly::File> spoolFd;
+  time_t spoolTime{0};
+  /** Last time the spool was fdatasync'ed. */
+  int64_t lastSyncUs{0};
+  /** mmap'ed spool writer for the binary format. */
+  std::unique_ptr<AsynclogSpoolWriter> spoolWriter;
+  /** Smoothed time from enqueue to on-disk for this shard's entries. */
+  ExponentialSmoothData<64> spoolLagUs;
+};
+
 struct ProxyMessage {
   enum class Type {
     REQUEST,
     OLD_CONFIG,
-    SHUTDOWN
+    SHUTDOWN,
+    TASK
   };
 
   Type type{Type::REQUEST};
@@ -153,9 +227,32 @@ class Proxy {
 
   std::unique_ptr<ProxyDestinationMap> destinationMap;
 
-  // async spool related
-  std::shared_ptr<folly::File> async_fd{nullptr};
-  time_t async_spool_time{0};
+  // async spool related; one shard per asynclog writer thread
+  std::vector<AsynclogShard> asynclogShards;
+
+  // see --asynclog-dedupe-window-ms; proxy thread only
+  AsynclogDedupe asynclogDedupe;
+
+  /**
+   * Keys with a lease-get currently outstanding, so further lease-gets
+   * for the same key can wait for its reply instead of stampeding the
+   * backend (see --lease-get-collapse-wait-ms). Proxy thread only.
+   */
+  std::unordered_map<std::string, LeaseGetCollapseEntry*> leaseGetInFlight;
+
+  /**
+   * Always-on hot key sketch, fed by dispatchRequest (see the
+   * "hot_keys" ServiceInfo command). touch() is proxy-thread-only;
+   * snapshot() is safe from any thread.
+   */
+  HotKeyTracker hotKeys;
+
+  /**
+   * Flight recorder for replies over --slow-request-threshold-us,
+   * fed by onReplyReceived (see the "slow_requests" ServiceInfo
+   * command). snapshot() is safe from any thread.
+   */
+  SlowRequestRecorder slowRequests;
 
   std::mutex stats_lock;
   stat_t stats[num_stats];
@@ -195,7 +292,13 @@ class Proxy {
    */
   int num_bins_used{0};
 
-  std::mt19937 randomGenerator;
+  /**
+   * Per-proxy generator for request-path randomness (random child
+   * picks, sampling, jitter): self-seeded, proxy thread only, a few ns
+   * per draw.  See Xorshift128Plus for the randomInt()/randomDouble()
+   * helpers.
+   */
+  Xorshift128Plus randomGenerator;
 
   /**
    * If true, processing new requests is not safe.
@@ -207,11 +310,25 @@ class Proxy {
 
   std::unique_ptr<ProxyStatsContainer> statsContainer;
 
+  /** Freelist pool for this proxy's request contexts. */
+  ProxyRequestContextPool requestContextPool;
+
   folly::EventBase& eventBase() const {
     assert(eventBase_ != nullptr);
     return *eventBase_;
   }
 
+  /**
+   * Coarse wall-clock seconds, cached on the proxy and refreshed a few
+   * times per second from the event base, so time-based route handles
+   * don't need a time syscall per request.  Reads the clock directly
+   * until the event base is attached.
+   */
+  time_t coarseNowWallSec() const {
+    auto cached = coarseNowWallSec_.load(std::memory_order_relaxed);
+    return cached != 0 ? cached : nowWallSec();
+  }
+
   ~Proxy();
 
   /**
@@ -219,12 +336,19 @@ class Proxy {
    */
   std::shared_ptr<ProxyConfig> getConfig() const;
 
+  /**
+   * Access to config from the proxy thread only. Refreshes a thread-local
+   * cached reference when the config generation moves, so the per-request
+   * cost is a plain load instead of taking the config lock.
+   */
+  std::shared_ptr<ProxyConfig> getConfigCached();
+
   /**
    * Returns a lock and a reference to the config.
    * The caller may only access the config through the reference
    * while the lock is held.
    */
-  std::pair<std::unique_lock<SFRReadLock>, ProxyConfig&>
+  std::pair<std::unique_lock<SFRDistReadLock>, ProxyConfig&>
   getConfigLocked() const;
 
   /**
@@ -240,11 +364,49 @@ class Proxy {
       const Request& req,
       std::unique_ptr<ProxyRequestContextTyped<Request>> ctx);
 
+  /**
+   * Queue up and route a whole batch of get requests in one dispatch
+   * (see ProxyRequestContextGetBatch).  Each member still counts
+   * individually toward processing stats and the inflight limit.
+   */
+  void dispatchGetBatch(std::unique_ptr<ProxyRequestContextGetBatch> ctx);
+
+  /**
+   * Enqueue a shadow send to run on this proxy's fibers once the event
+   * loop has headroom, so slow shadow targets never backpressure the
+   * production path.  The queue is bounded by max_shadow_queue_size and
+   * drops on overflow (shadow_queue_drops stat).  Must be called from
+   * the proxy thread.
+   */
+  void dispatchShadowTask(std::function<void()> task) noexcept;
+
+  /**
+   * Record a TKO transition for deferred logging.  Never blocks: the
+   * event goes into a bounded lock-free queue drained by the stat
+   * updater thread, so a mass TKO doesn't add logging latency to the
+   * requests that discover the failures.  Drops (and counts) events
+   * when the queue is full.
+   */
+  void recordTkoEvent(TkoEvent event) noexcept;
+
+  /**
+   * Format and log all recorded TKO events.  Called periodically by the
+   * stat updater thread.
+   */
+  void drainTkoEvents();
+
   /**
    * Put a new proxy message into the queue.
    */
   void sendMessage(ProxyMessage::Type t, void* data) noexcept;
 
+  /**
+   * Run `func` on a fiber of this proxy's thread. Safe to call from any
+   * thread; the task travels through the same lock-free message queue
+   * (and relaxed notification lane) as request handoff.
+   */
+  void sendTask(std::function<void()> func) noexcept;
+
   /**
    * Must be called from the EventBase thread;
    * drains message queue.
@@ -256,6 +418,30 @@ class Proxy {
    */
   size_t queueNotifyPeriod() const;
 
+  /**
+   * @return Smoothed notification-to-drain delay of the message queue
+   *   in us; 0 unless client_queue_target_latency_us is set.
+   */
+  int64_t queueWakeupLatencyUs() const;
+
+  /**
+   * @return Smoothed interval between message queue drains in us; grows
+   *   past the notification period when the event loop is falling behind.
+   */
+  int64_t queueDrainIntervalUs() const;
+
+  /**
+   * @return Approximate number of messages waiting in this proxy's
+   *   message queue. Can be read from any thread.
+   */
+  size_t queueDepth() const;
+
+  /**
+   * @return Compression level currently in effect on this proxy, or 0
+   *   if adaptive compression is disabled.
+   */
+  uint32_t adaptiveCompressionLevel() const;
+
   McrouterInstanceBase& router() const {
     return router_;
   }
@@ -274,15 +460,96 @@ class Proxy {
  private:
   folly::EventBase* eventBase_{nullptr};
 
-  /** Read/write lock for config pointer */
-  SFRLock configLock_;
+  /** Refreshes coarseNowWallSec_ and reschedules itself */
+  void timerCallback();
+
+  std::unique_ptr<AsyncTimer<Proxy>> coarseClockTimer_;
+  std::atomic<time_t> coarseNowWallSec_{0};
+
+  /** Adjusts the compression level to event loop lag, if enabled. */
+  std::unique_ptr<CompressionLevelController> compressionLevelController_;
+
+  /**
+   * Read/write lock for config pointer. Distributed-reader variant: taken
+   * for read on every request that needs the config, written only on
+   * reconfiguration.
+   */
+  SFRDistLock configLock_;
   std::shared_ptr<ProxyConfig> config_;
 
+  /** Bumped by swapConfig; lets the proxy thread spot new configs */
+  std::atomic<uint64_t> configGeneration_{0};
+  /** Proxy-thread-only cache of config_, see getConfigCached() */
+  std::shared_ptr<ProxyConfig> cachedConfig_;
+  uint64_t cachedConfigGeneration_{0};
+
   // Stores the id of the next request.
   uint64_t nextReqId_ = 0;
 
   std::unique_ptr<MessageQueue<ProxyMessage>> messageQueue_;
 
+  /**
+   * Drains queued shadow sends onto fibers at the tail of event loop
+   * iterations, a bounded batch at a time; while the loop is lagging it
+   * backs off on a timer instead so held shadows don't keep the loop
+   * spinning.  See dispatchShadowTask().
+   */
+  class ShadowQueueDrainer : public folly::EventBase::LoopCallback {
+   public:
+    explicit ShadowQueueDrainer(Proxy& proxy)
+        : proxy_(proxy), retryTimer_(*this) {}
+
+    void attachEventBase(folly::EventBase& evb) {
+      retryTimer_.attachEventBase(&evb);
+    }
+
+    void schedule();
+    void runLoopCallback() noexcept override final;
+
+    /* AsyncTimer callback for the lagging-loop retry path */
+    void timerCallback() {
+      runLoopCallback();
+    }
+
+   private:
+    Proxy& proxy_;
+    AsyncTimer<ShadowQueueDrainer> retryTimer_;
+  };
+  ShadowQueueDrainer shadowQueueDrainer_;
+
+  /**
+   * Periodically routes a synthetic self-addressed request through the
+   * real route tree on a recording context, which short-circuits at
+   * DestinationRoute without touching the network.  Stage durations are
+   * taken with the cycles clock and exported through the canary_*
+   * stats, giving a continuous reading of router-internal overhead to
+   * subtract from end-to-end client latency.  Enabled with
+   * --canary-interval-ms.
+   */
+  class CanaryInjector {
+   public:
+    explicit CanaryInjector(Proxy& proxy) : proxy_(proxy), timer_(*this) {}
+
+    void attachEventBase(folly::EventBase& evb) {
+      timer_.attachEventBase(&evb);
+    }
+
+    /* AsyncTimer callback: injects one canary and reschedules */
+    void timerCallback();
+
+   private:
+    Proxy& proxy_;
+    AsyncTimer<CanaryInjector> timer_;
+  };
+  CanaryInjector canaryInjector_;
+
+  /** Shadow sends waiting for event loop headroom */
+  std::deque<std::function<void()>> shadowQueue_;
+
+  /** TKO transitions waiting for the stat updater thread to log them */
+  folly::MPMCQueue<TkoEvent> tkoEventQueue_;
+  std::atomic<uint64_t> droppedTkoEvents_{0};
+
   struct ProxyDelayedDestructor {
     void operator()(Proxy* proxy) {
       /* We only access self_ during construction, so this code should
@@ -342,6 +609,14 @@ class Proxy {
   template <class Request>
   void bumpStats(const Request&);
 
+  /** Feeds keyed requests into the hot key sketch; no-op otherwise */
+  template <class Request>
+  typename std::enable_if<Request::hasKey, void>::type
+  recordHotKey(const Request& req);
+  template <class Request>
+  typename std::enable_if<!Request::hasKey, void>::type
+  recordHotKey(const Request&);
+
   /**
    * Incoming request rate limiting.
    *
@@ -399,6 +674,24 @@ class Proxy {
     int64_t timePushedOnQueue_{-1};
   };
 
+  /**
+   * A whole get batch waiting in line.  The batch occupies a single
+   * waiting slot regardless of its size.
+   */
+  class WaitingGetBatch : public WaitingRequestBase {
+   public:
+    explicit WaitingGetBatch(
+        std::unique_ptr<ProxyRequestContextGetBatch> ctx);
+    ~WaitingGetBatch() override;
+    void process(Proxy* proxy) override final;
+    void setTimePushedOnQueue(int64_t now) { timePushedOnQueue_ = now; }
+
+   private:
+    std::unique_ptr<ProxyRequestContextGetBatch> ctx_;
+
+    int64_t timePushedOnQueue_{-1};
+  };
+
   /** Queue of requests we didn't start processing yet */
   WaitingRequestBase::Queue
       waitingRequests_[static_cast<int>(ProxyRequestPriority::kNumPriorities)];
@@ -407,6 +700,28 @@ class Proxy {
   template <class Request>
   bool rateLimited(ProxyRequestPriority priority, const Request&) const;
 
+  /**
+   * Brownout mode: if the event loop is lagging past the configured
+   * threshold, answers a controlled fraction of get-like and
+   * update-like requests immediately instead of routing them.
+   * Deletes, arithmetic and admin commands are never shed.
+   *
+   * @return true if the request was shed and already replied to.
+   */
+  template <class Request>
+  bool shedIfOverloaded(const Request& req,
+                        ProxyRequestContextTyped<Request>& ctx);
+
+  /** Rolls the dice against the current brownout shed fraction */
+  bool brownoutShouldShed();
+
+  /**
+   * Routes a whole get batch through the route tree in one top-level
+   * fiber task (the batch entry point of ProxyRoute fans the keys out
+   * in concurrent subtasks).
+   */
+  void processGetBatch(std::unique_ptr<ProxyRequestContextGetBatch> ctx);
+
   /** Will let through requests from the above queue if we have capacity */
   void pump();
 
@@ -416,9 +731,11 @@ class Proxy {
    */
   uint64_t nextRequestId();
 
+  friend class AsyncTimer<Proxy>;
   friend class McrouterClient;
   friend class McrouterInstance;
   friend class ProxyRequestContext;
+  friend class ProxyRequestContextGetBatch;
   friend class ProxyThread;
 };
 
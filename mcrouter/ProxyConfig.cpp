@@ -9,8 +9,12 @@
  */
 #include "ProxyConfig.h"
 
+#include <utility>
+#include <vector>
+
 #include <folly/Conv.h>
 #include <folly/dynamic.h>
+#include <folly/Hash.h>
 #include <folly/json.h>
 
 #include "mcrouter/PoolFactory.h"
@@ -25,11 +29,58 @@
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
+namespace {
+
+/* Fingerprint of a JSON subtree, stable across reparses of the same text. */
+size_t subtreeHash(const folly::dynamic& json) {
+  folly::json::serialization_opts opts;
+  opts.sort_keys = true;
+  return folly::hash::fnv64(folly::json::serialize(json, opts));
+}
+
+/**
+ * Checks whether a subtree references any named handle that is being
+ * rebuilt. Any string matching a known name (directly or after the '|' of
+ * a short form handle) counts as a reference; false positives only make
+ * reuse more conservative.
+ */
+bool referencesRebuiltHandle(
+    const folly::dynamic& json,
+    const folly::StringKeyedUnorderedMap<bool>& reusable) {
+  if (json.isString()) {
+    auto it = reusable.find(json.stringPiece());
+    if (it == reusable.end()) {
+      auto pipeId = json.stringPiece().find('|');
+      if (pipeId != std::string::npos) {
+        it = reusable.find(json.stringPiece().subpiece(pipeId + 1));
+      }
+    }
+    return it != reusable.end() && !it->second;
+  }
+  if (json.isArray()) {
+    for (const auto& it : json) {
+      if (referencesRebuiltHandle(it, reusable)) {
+        return true;
+      }
+    }
+  } else if (json.isObject()) {
+    for (const auto& it : json.items()) {
+      if (referencesRebuiltHandle(it.second, reusable)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+}  // anonymous namespace
+
 ProxyConfig::ProxyConfig(
     Proxy& proxy,
     const folly::dynamic& json,
     std::string configMd5Digest,
-    PoolFactory& poolFactory)
+    PoolFactory& poolFactory,
+    const ProxyConfig* oldConfig)
     : configMd5Digest_(std::move(configMd5Digest)) {
   McRouteHandleProvider provider(proxy, poolFactory);
   RouteHandleFactory<McrouterRouteHandleIf> factory(provider, proxy.getId());
@@ -37,18 +88,82 @@ ProxyConfig::ProxyConfig(
   checkLogic(json.isObject(), "Config is not an object");
 
   if (auto jNamedHandles = json.get_ptr("named_handles")) {
+    // (name, subtree) pairs in order of appearance
+    std::vector<std::pair<folly::StringPiece, const folly::dynamic*>> named;
     if (jNamedHandles->isArray()) {
       for (const auto& it : *jNamedHandles) {
-        factory.create(it);
+        auto jName = it.get_ptr("name");
+        if (jName && jName->isString()) {
+          named.emplace_back(jName->stringPiece(), &it);
+        }
       }
     } else if (jNamedHandles->isObject()) {
       for (const auto& it : jNamedHandles->items()) {
-        factory.addNamed(it.first.stringPiece(), it.second);
+        named.emplace_back(it.first.stringPiece(), &it.second);
       }
     } else {
       throwLogic("named_handles is {} expected array/object",
                  jNamedHandles->typeName());
     }
+
+    // Pool definitions are folded into every fingerprint: subtrees refer to
+    // pools by name only, so any change to 'pools' disables reuse entirely.
+    size_t poolsHash = 0;
+    if (auto jPools = json.get_ptr("pools")) {
+      poolsHash = subtreeHash(*jPools);
+    }
+    for (const auto& it : named) {
+      namedHandles_.emplace(
+        it.first,
+        std::make_pair(
+          folly::hash::hash_combine(poolsHash, subtreeHash(*it.second)),
+          std::vector<McrouterRouteHandlePtr>()));
+    }
+
+    if (oldConfig) {
+      folly::StringKeyedUnorderedMap<bool> reusable;
+      for (const auto& it : named) {
+        auto oldIt = oldConfig->namedHandles_.find(it.first);
+        reusable.emplace(
+          it.first,
+          oldIt != oldConfig->namedHandles_.end() &&
+            oldIt->second.first == namedHandles_.find(it.first)->second.first &&
+            !oldIt->second.second.empty());
+      }
+      // a subtree referencing a rebuilt name must be rebuilt as well
+      bool changed = true;
+      while (changed) {
+        changed = false;
+        for (const auto& it : named) {
+          auto reuseIt = reusable.find(it.first);
+          if (reuseIt->second && referencesRebuiltHandle(*it.second,
+                                                         reusable)) {
+            reuseIt->second = false;
+            changed = true;
+          }
+        }
+      }
+      for (const auto& it : named) {
+        if (reusable.find(it.first)->second) {
+          const auto& handles =
+            oldConfig->namedHandles_.find(it.first)->second.second;
+          namedHandles_.find(it.first)->second.second = handles;
+          factory.addPrebuilt(it.first, handles);
+        }
+      }
+    }
+
+    if (jNamedHandles->isArray()) {
+      for (const auto& it : *jNamedHandles) {
+        factory.create(it);
+      }
+    } else {
+      for (const auto& it : jNamedHandles->items()) {
+        if (factory.getNamed(it.first.stringPiece()) == nullptr) {
+          factory.addNamed(it.first.stringPiece(), it.second);
+        }
+      }
+    }
   }
 
   RouteSelectorMap routeSelectors;
@@ -92,6 +207,34 @@ ProxyConfig::ProxyConfig(
   asyncLogRoutes_ = provider.releaseAsyncLogRoutes();
   pools_ = provider.releasePools();
   accessPoints_ = provider.releaseAccessPoints();
+
+  // Record handles built during this pass; entries that already have
+  // handles were reused from the previous config.
+  bool reusedAny = false;
+  for (auto& it : namedHandles_) {
+    if (it.second.second.empty()) {
+      if (auto handles = factory.getNamed(it.first)) {
+        it.second.second = *handles;
+      }
+    } else {
+      reusedAny = true;
+    }
+  }
+  // Pools that live only inside reused subtrees were not seen by this
+  // provider, so carry their bookkeeping over from the previous config.
+  // Reuse implies an unchanged 'pools' section, so the definitions match.
+  if (reusedAny) {
+    for (const auto& it : oldConfig->pools_) {
+      pools_.emplace(it.first, it.second);
+    }
+    for (const auto& it : oldConfig->accessPoints_) {
+      accessPoints_.emplace(it.first, it.second);
+    }
+    for (const auto& it : oldConfig->asyncLogRoutes_) {
+      asyncLogRoutes_.emplace(it.first, it.second);
+    }
+  }
+
   proxyRoute_ = std::make_shared<ProxyRoute>(&proxy, routeSelectors);
   serviceInfo_ = std::make_shared<ServiceInfo>(&proxy, *this);
 }
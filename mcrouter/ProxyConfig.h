@@ -70,17 +70,29 @@ class ProxyConfig {
   folly::StringKeyedUnorderedMap<
     std::vector<std::shared_ptr<const AccessPoint>>
   > accessPoints_;
+  /**
+   * Fingerprint and route handles of each entry in 'named_handles', kept so
+   * that the next reconfiguration can reuse subtrees that didn't change.
+   * Handles are empty if the named route was never referenced.
+   */
+  folly::StringKeyedUnorderedMap<
+    std::pair<size_t, std::vector<McrouterRouteHandlePtr>>
+  > namedHandles_;
 
   /**
    * Parses config and creates ProxyRoute
    *
    * @param jsonC config in format of JSON with comments and templates
+   * @param oldConfig previous config of the same proxy (if any); named
+   *                  route handles whose subtrees are unchanged are reused
+   *                  from it instead of being rebuilt
    */
   ProxyConfig(
       Proxy& proxy,
       const folly::dynamic& json,
       std::string configMd5Digest,
-      PoolFactory& poolFactory);
+      PoolFactory& poolFactory,
+      const ProxyConfig* oldConfig);
 
   friend class ProxyConfigBuilder;
 };
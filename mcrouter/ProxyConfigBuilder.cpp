@@ -9,9 +9,11 @@
  */
 #include "ProxyConfigBuilder.h"
 
+#include <folly/FileUtil.h>
 #include <folly/json.h>
 
 #include "mcrouter/ConfigApi.h"
+#include "mcrouter/McrouterLogFailure.h"
 #include "mcrouter/PoolFactory.h"
 #include "mcrouter/Proxy.h"
 #include "mcrouter/ProxyConfig.h"
@@ -23,9 +25,100 @@
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
-ProxyConfigBuilder::ProxyConfigBuilder(const McrouterOptions& opts,
-                                       ConfigApi& configApi,
-                                       folly::StringPiece jsonC)
+namespace {
+
+constexpr int64_t kConfigCacheVersion = 1;
+
+/**
+ * Import resolver that records the content hash of every imported file,
+ * so the preprocessed config can later be validated against its sources.
+ */
+class TrackingImportResolver : public ImportResolverIf {
+ public:
+  explicit TrackingImportResolver(ImportResolverIf& resolver)
+      : resolver_(resolver) {}
+
+  std::string import(folly::StringPiece path) override {
+    auto contents = resolver_.import(path);
+    sources_.insert(path, Md5Hash(contents));
+    return contents;
+  }
+
+  const folly::dynamic& sources() const {
+    return sources_;
+  }
+
+ private:
+  ImportResolverIf& resolver_;
+  folly::dynamic sources_{folly::dynamic::object};
+};
+
+/**
+ * Loads the preprocessed config cached by a previous run, if it was built
+ * from the same config/params and every imported file is unchanged.
+ * Imports are re-read through the resolver, so they stay registered as
+ * tracked config sources. Returns null dynamic on any mismatch.
+ */
+folly::dynamic loadPreprocessedConfig(const std::string& path,
+                                      ImportResolverIf& importResolver,
+                                      folly::StringPiece configMd5,
+                                      folly::StringPiece paramsMd5) {
+  std::string contents;
+  if (!folly::readFile(path.data(), contents)) {
+    return nullptr;
+  }
+  try {
+    auto cached = folly::parseJson(contents);
+    if (!cached.isObject() ||
+        cached.getDefault("version") != kConfigCacheVersion ||
+        cached.getDefault("md5") != configMd5 ||
+        cached.getDefault("params_md5") != paramsMd5) {
+      return nullptr;
+    }
+    auto jSources = cached.get_ptr("sources");
+    auto jConfig = cached.get_ptr("config");
+    if (!jSources || !jSources->isObject() || !jConfig) {
+      return nullptr;
+    }
+    for (const auto& it : jSources->items()) {
+      auto imported = importResolver.import(it.first.stringPiece());
+      if (it.second != Md5Hash(imported)) {
+        return nullptr;
+      }
+    }
+    return std::move(*jConfig);
+  } catch (const std::exception&) {
+    // stale or corrupt cache, fall back to full preprocessing
+    return nullptr;
+  }
+}
+
+void storePreprocessedConfig(const McrouterOptions& opts,
+                             folly::StringPiece configMd5,
+                             folly::StringPiece paramsMd5,
+                             const folly::dynamic& sources,
+                             const folly::dynamic& config) {
+  folly::dynamic cache = folly::dynamic::object
+    ("version", kConfigCacheVersion)
+    ("md5", configMd5)
+    ("params_md5", paramsMd5)
+    ("sources", sources)
+    ("config", config);
+  if (!atomicallyWriteFileToDisk(folly::toJson(cache),
+                                 opts.preprocessed_config_cache_path)) {
+    MC_LOG_FAILURE(opts, failure::Category::kSystemError,
+                   "Can not write preprocessed config cache to {}",
+                   opts.preprocessed_config_cache_path);
+  }
+}
+
+}  // anonymous namespace
+
+ProxyConfigBuilder::ProxyConfigBuilder(
+    const McrouterOptions& opts,
+    ConfigApi& configApi,
+    folly::StringPiece jsonC,
+    std::shared_ptr<PoolFactory::AccessPointCache> accessPointCache)
     : json_(nullptr) {
 
   McImportResolver importResolver(configApi);
@@ -45,20 +138,50 @@ ProxyConfigBuilder::ProxyConfigBuilder(const McrouterOptions& opts,
     globalParams.emplace(param.first, param.second);
   }
 
-  json_ = ConfigPreprocessor::getConfigWithoutMacros(
-    jsonC,
-    importResolver,
-    std::move(globalParams));
+  configMd5Digest_ = Md5Hash(jsonC);
+
+  // preprocessed output depends on global params as well as on the sources
+  std::string paramsMd5;
+  if (!opts.preprocessed_config_cache_path.empty()) {
+    folly::dynamic params = folly::dynamic::object;
+    for (const auto& it : globalParams) {
+      params.insert(it.first, it.second);
+    }
+    folly::json::serialization_opts serOpts;
+    serOpts.sort_keys = true;
+    paramsMd5 = Md5Hash(folly::json::serialize(params, serOpts));
+
+    json_ = loadPreprocessedConfig(opts.preprocessed_config_cache_path,
+                                   importResolver,
+                                   configMd5Digest_,
+                                   paramsMd5);
+  }
+
+  if (json_.isNull()) {
+    TrackingImportResolver trackingResolver(importResolver);
+    json_ = ConfigPreprocessor::getConfigWithoutMacros(
+      jsonC,
+      trackingResolver,
+      std::move(globalParams));
 
-  poolFactory_ = folly::make_unique<PoolFactory>(json_, configApi);
+    if (!opts.preprocessed_config_cache_path.empty()) {
+      storePreprocessedConfig(opts, configMd5Digest_, paramsMd5,
+                              trackingResolver.sources(), json_);
+    }
+  }
 
-  configMd5Digest_ = Md5Hash(jsonC);
+  poolFactory_ = folly::make_unique<PoolFactory>(
+    json_, configApi, std::move(accessPointCache));
 }
 
 std::shared_ptr<ProxyConfig> ProxyConfigBuilder::buildConfig(
     Proxy& proxy) const {
+  // Keep the proxy's current config alive while building: named route
+  // subtrees that didn't change are reused from it.
+  auto oldConfig = proxy.getConfig();
   return std::shared_ptr<ProxyConfig>(
-    new ProxyConfig(proxy, json_, configMd5Digest_, *poolFactory_));
+    new ProxyConfig(proxy, json_, configMd5Digest_, *poolFactory_,
+                    oldConfig.get()));
 }
 
 }}} // facebook::memcache::mcrouter
@@ -28,7 +28,9 @@ class ProxyConfigBuilder {
  public:
   ProxyConfigBuilder(const McrouterOptions& opts,
                      ConfigApi& configApi,
-                     folly::StringPiece jsonC);
+                     folly::StringPiece jsonC,
+                     std::shared_ptr<PoolFactory::AccessPointCache>
+                       accessPointCache = nullptr);
 
   std::shared_ptr<ProxyConfig> buildConfig(Proxy& proxy) const;
 
@@ -7,13 +7,16 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
-#include <limits>
-#include <random>
+#include <folly/Optional.h>
+#include <folly/fibers/Baton.h>
 
+#include "mcrouter/McrouterInstanceBase.h"
 #include "mcrouter/Proxy.h"
 #include "mcrouter/ProxyDestinationMap.h"
 #include "mcrouter/config-impl.h"
+#include "mcrouter/lib/CompressionDictionaryTrainer.h"
 #include "mcrouter/lib/Operation.h"
+#include "mcrouter/lib/carbon/RequestReplyUtil.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
@@ -22,25 +25,81 @@ ReplyT<Request> ProxyDestination::send(const Request& request,
                                        DestinationRequestCtx& req_ctx,
                                        std::chrono::milliseconds timeout) {
   proxy->destinationMap->markAsActive(*this);
-  auto reply = getAsyncMcClient().sendSync(request, timeout);
-  onReply(reply.result(), req_ctx);
-  return reply;
+  folly::Optional<ReplyT<Request>> reply;
+  if (auto* udpClient = udpClientFor<Request>()) {
+    reply.emplace(udpClient->sendSync(request, adaptiveTimeout(timeout)));
+    if (udpLossThresholdReached(reply->result())) {
+      /* The destination just fell back to TCP; retry this request there
+         below instead of surfacing a loss-induced timeout */
+      reply.clear();
+    } else {
+      onUdpReply(reply->result(), req_ctx);
+    }
+  }
+  if (!reply.hasValue()) {
+    reply.emplace(sharedOwner_
+        ? sendShared(request, adaptiveTimeout(timeout))
+        : getAsyncMcClient().sendSync(request, adaptiveTimeout(timeout)));
+    onReply(reply->result(), req_ctx);
+  }
+  if (auto* trainer = proxy->router().compressionDictionaryTrainer()) {
+    if (const folly::IOBuf* value = carbon::valuePtrUnsafe(*reply)) {
+      trainer->sample(*value, ReplyT<Request>::typeId);
+    }
+  }
+  return std::move(*reply);
+}
+
+template <class Request>
+AsyncMcClient* ProxyDestination::udpClientFor() {
+  return nullptr;
+}
+
+template <>
+inline AsyncMcClient* ProxyDestination::udpClientFor<McGetRequest>() {
+  return getUdpClient();
+}
+
+template <class Request>
+ReplyT<Request> ProxyDestination::sendShared(const Request& request,
+                                             std::chrono::milliseconds timeout) {
+  folly::Optional<ReplyT<Request>> reply;
+  folly::fibers::Baton baton;
+  auto& owner = *sharedOwner_;
+  // Capturing references is safe: this fiber doesn't resume until the
+  // owner thread posts the baton. The adaptive timeout was already
+  // derived from this proxy's latency stats by the caller.
+  owner.proxy->sendTask([&owner, &request, &reply, &baton, timeout]() {
+    owner.proxy->destinationMap->markAsActive(owner);
+    reply.emplace(owner.getAsyncMcClient().sendSync(request, timeout));
+    baton.post();
+  });
+  baton.wait();
+  return std::move(*reply);
 }
 
 template <class Request>
 bool ProxyDestination::shouldDrop() const {
-  if (!client_) {
+  /* The drop probability is server-side feedback, so any open
+     connection's view of it will do */
+  const AsyncMcClient* client = nullptr;
+  for (const auto& c : clients_) {
+    if (c) {
+      client = c.get();
+      break;
+    }
+  }
+  if (!client) {
     return false;
   }
 
-  auto dropProbability = client_->getDropProbability<Request>();
+  auto dropProbability = client->getDropProbability<Request>();
 
   if (dropProbability == 0.0) {
     return false;
   }
 
-  return std::generate_canonical<double, std::numeric_limits<double>::digits>(
-             proxy->randomGenerator) < dropProbability;
+  return proxy->randomGenerator.randomDouble() < dropProbability;
 }
 
 }}}  // facebook::memcache::mcrouter
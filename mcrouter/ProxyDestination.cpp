@@ -9,8 +9,8 @@
  */
 #include "ProxyDestination.h"
 
+#include <cmath>
 #include <limits>
-#include <random>
 
 #include <folly/fibers/Fiber.h>
 #include <folly/Memory.h>
@@ -19,6 +19,7 @@
 #include "mcrouter/config.h"
 #include "mcrouter/lib/McResUtil.h"
 #include "mcrouter/lib/network/AsyncMcClient.h"
+#include "mcrouter/lib/Xorshift128Plus.h"
 #include "mcrouter/lib/network/ThreadLocalSSLContextProvider.h"
 #include "mcrouter/McrouterLogFailure.h"
 #include "mcrouter/OptionsUtil.h"
@@ -38,9 +39,29 @@ constexpr double kProbeJitterDelta = kProbeJitterMax - kProbeJitterMin;
 // kReconnectionHoldoffFactor.
 constexpr uint32_t kReconnectionHoldoffFactor = 25;
 
+// Adaptive timeout is avgLatency + factor * latencyDeviation (TCP RTO
+// style), but never below the floor to protect against a burst of fast
+// replies tightening it into spurious-timeout territory.
+constexpr double kAdaptiveTimeoutDeviationFactor = 4.0;
+constexpr int64_t kAdaptiveTimeoutFloorMs = 2;
+
+// Consecutive UDP request timeouts after which the destination gives up
+// on UDP and falls back to TCP (see --udp-gets).
+constexpr size_t kMaxConsecutiveUdpTimeouts = 3;
+
+// After a background DNS refresh sees the destination's address change,
+// busy connections get this many further refresh ticks to drain before
+// they are closed forcibly.
+constexpr uint8_t kDnsDrainTicksMax = 3;
+
 static_assert(kProbeJitterMax >= kProbeJitterMin,
               "ProbeJitterMax should be greater or equal tham ProbeJitterMin");
 
+int jitteredProbeDelayMs(Xorshift128Plus& rng, int delayMs) {
+  double tmo_jitter_pct = rng.randomDouble() * kProbeJitterDelta + kProbeJitterMin;
+  return (double)delayMs * (1.0 + tmo_jitter_pct);
+}
+
 stat_name_t getStatName(ProxyDestination::State st) {
   switch (st) {
     case ProxyDestination::State::kNew:
@@ -74,9 +95,7 @@ void ProxyDestination::schedule_next_probe() {
   }
 
   // Calculate random jitter
-  double r = (double)rand() / (double)RAND_MAX;
-  double tmo_jitter_pct = r * kProbeJitterDelta + kProbeJitterMin;
-  delay_ms = (double)delay_ms * (1.0 + tmo_jitter_pct);
+  delay_ms = jitteredProbeDelayMs(proxy->randomGenerator, delay_ms);
   assert(delay_ms > 0);
 
   if (!probeTimer_.scheduleTimeout(delay_ms)) {
@@ -88,8 +107,25 @@ void ProxyDestination::schedule_next_probe() {
 
 void ProxyDestination::timerCallback() {
   // Note that the previous probe might still be in flight
-  if (!probe_req) {
-    probe_req = folly::make_unique<McVersionRequest>();
+  if (!probeInflight_) {
+    if (!proxy->router().tkoTrackerMap().tryAcquireProbeToken(
+            proxy->router().opts().max_probes_per_second)) {
+      // Over the global probe budget. Retry at the initial delay
+      // without growing this destination's backoff: the budget exists
+      // to spread sends out, not to slow recovery down.
+      if (!probeTimer_.scheduleTimeout(jitteredProbeDelayMs(
+              proxy->randomGenerator,
+              proxy->router().opts().probe_delay_initial_ms))) {
+        MC_LOG_FAILURE(proxy->router().opts(),
+                       memcache::failure::Category::kSystemError,
+                       "failed to schedule probe timer for ProxyDestination");
+      }
+      return;
+    }
+    if (!probe_req) {
+      probe_req = folly::make_unique<McVersionRequest>();
+    }
+    probeInflight_ = true;
     ++stats_.probesSent;
     auto selfPtr = selfPtr_;
     proxy->fiberManager.addTask([selfPtr]() mutable {
@@ -103,7 +139,7 @@ void ProxyDestination::timerCallback() {
         *pdstn->probe_req,
         pdstn->shortestTimeout_);
       pdstn->handle_tko(reply.result(), true);
-      pdstn->probe_req.reset();
+      pdstn->probeInflight_ = false;
     });
   }
   schedule_next_probe();
@@ -126,6 +162,25 @@ void ProxyDestination::stop_sending_probes() {
   probeTimer_.detachEventBase();
 }
 
+void ProxyDestination::warmUp() {
+  if (stats_.state != State::kNew) {
+    return;
+  }
+  auto selfPtr = selfPtr_;
+  proxy->fiberManager.addTask([selfPtr]() {
+    auto pdstn = selfPtr.lock();
+    if (pdstn == nullptr || pdstn->stats_.state != State::kNew) {
+      return;
+    }
+    if (!pdstn->probe_req) {
+      pdstn->probe_req = folly::make_unique<McVersionRequest>();
+    }
+    auto reply = pdstn->getAsyncMcClient().sendSync(
+        *pdstn->probe_req, pdstn->shortestTimeout_);
+    pdstn->handle_tko(reply.result(), /* is_probe_req= */ true);
+  });
+}
+
 void ProxyDestination::handle_tko(const mc_res_t result, bool is_probe_req) {
   if (proxy->router().opts().disable_tko_tracking) {
     return;
@@ -158,16 +213,28 @@ void ProxyDestination::handle_tko(const mc_res_t result, bool is_probe_req) {
 }
 
 void ProxyDestination::handleRxmittingConnection() {
-  if (!client_) {
-    return;
-  }
   const auto retransCycles =
       proxy->router().opts().collect_rxmit_stats_every_hz;
   if (retransCycles > 0) {
     const auto curCycles = cycles::getCpuCycles();
     if (curCycles > lastRetransCycles_ + retransCycles) {
       lastRetransCycles_ = curCycles;
-      const auto currRetransPerKByte = client_->getRetransmissionInfo();
+      /* Track the connection retransmitting the most */
+      AsyncMcClient* worstClient = nullptr;
+      double currRetransPerKByte = -1.0;
+      for (auto& client : clients_) {
+        if (!client) {
+          continue;
+        }
+        const auto retrans = client->getRetransmissionInfo();
+        if (retrans > currRetransPerKByte) {
+          currRetransPerKByte = retrans;
+          worstClient = client.get();
+        }
+      }
+      if (worstClient == nullptr) {
+        return;
+      }
       if (currRetransPerKByte >= 0.0) {
         stats_.retransPerKByte = currRetransPerKByte;
         stat_set_uint64(
@@ -189,14 +256,12 @@ void ProxyDestination::handleRxmittingConnection() {
 
       if (rxmitsToCloseConnection_ > 0 &&
           currRetransPerKByte >= rxmitsToCloseConnection_) {
-        std::uniform_int_distribution<uint64_t> dist(
-            1, kReconnectionHoldoffFactor);
-        const uint64_t reconnectionJitters =
-            retransCycles * dist(proxy->randomGenerator);
+        const uint64_t reconnectionJitters = retransCycles *
+            (1 + proxy->randomGenerator.randomInt(kReconnectionHoldoffFactor));
         if (lastConnCloseCycles_ + reconnectionJitters > curCycles) {
           return;
         }
-        client_->closeNow();
+        worstClient->closeNow();
         stat_incr(proxy->stats, retrans_closed_connections_stat, 1);
         lastConnCloseCycles_ = curCycles;
 
@@ -221,7 +286,22 @@ void ProxyDestination::onReply(
     const mc_res_t result,
     DestinationRequestCtx& destreqCtx) {
   handle_tko(result, false);
+  updateRequestStats(result, destreqCtx);
+  handleRxmittingConnection();
+}
+
+void ProxyDestination::onUdpReply(
+    const mc_res_t result,
+    DestinationRequestCtx& destreqCtx) {
+  if (result != mc_res_timeout) {
+    handle_tko(result, false);
+  }
+  updateRequestStats(result, destreqCtx);
+}
 
+void ProxyDestination::updateRequestStats(
+    const mc_res_t result,
+    DestinationRequestCtx& destreqCtx) {
   if (!stats_.results) {
     stats_.results = folly::make_unique<std::array<uint64_t, mc_nres>>();
   }
@@ -230,18 +310,42 @@ void ProxyDestination::onReply(
 
   int64_t latency = destreqCtx.endTime - destreqCtx.startTime;
   stats_.avgLatency.insertSample(latency);
-
-  handleRxmittingConnection();
+  stats_.latencyDeviation.insertSample(
+      std::abs(latency - stats_.avgLatency.value()));
+  stats_.latencyHistogramUs.insertSample(std::max<int64_t>(latency, 0));
 }
 
 size_t ProxyDestination::getPendingRequestCount() const {
   folly::SpinLockGuard g(clientLock_);
-  return client_ ? client_->getPendingRequestCount() : 0;
+  size_t count = udpClient_ ? udpClient_->getPendingRequestCount() : 0;
+  for (const auto& client : clients_) {
+    count += client ? client->getPendingRequestCount() : 0;
+  }
+  return count;
 }
 
 size_t ProxyDestination::getInflightRequestCount() const {
   folly::SpinLockGuard g(clientLock_);
-  return client_ ? client_->getInflightRequestCount() : 0;
+  size_t count = udpClient_ ? udpClient_->getInflightRequestCount() : 0;
+  for (const auto& client : clients_) {
+    count += client ? client->getInflightRequestCount() : 0;
+  }
+  return count;
+}
+
+bool ProxyDestination::isSaturated() const {
+  folly::SpinLockGuard g(clientLock_);
+  size_t open = 0;
+  for (const auto& client : clients_) {
+    if (client) {
+      ++open;
+      if (!client->isSaturated()) {
+        return false;
+      }
+    }
+  }
+  /* Saturated only once every connection slot is open and backed up */
+  return open > 0 && open == numConnections_;
 }
 
 std::shared_ptr<ProxyDestination> ProxyDestination::create(
@@ -249,13 +353,15 @@ std::shared_ptr<ProxyDestination> ProxyDestination::create(
     std::shared_ptr<AccessPoint> ap,
     std::chrono::milliseconds timeout,
     uint64_t qosClass,
-    uint64_t qosPath) {
+    uint64_t qosPath,
+    size_t numConnections) {
   std::shared_ptr<ProxyDestination> ptr(new ProxyDestination(
     proxy,
     std::move(ap),
     timeout,
     qosClass,
-    qosPath));
+    qosPath,
+    numConnections));
   ptr->selfPtr_ = ptr;
   return ptr;
 }
@@ -270,9 +376,14 @@ ProxyDestination::~ProxyDestination() {
     proxy->destinationMap->removeDestination(*this);
   }
 
-  if (client_) {
-    client_->setStatusCallbacks(nullptr, nullptr);
-    client_->closeNow();
+  for (auto& client : clients_) {
+    if (client) {
+      client->setStatusCallbacks(nullptr, nullptr);
+      client->closeNow();
+    }
+  }
+  if (udpClient_) {
+    udpClient_->closeNow();
   }
 
   stat_decr(proxy->stats, getStatName(stats_.state), 1);
@@ -285,14 +396,18 @@ ProxyDestination::ProxyDestination(
     std::shared_ptr<AccessPoint> ap,
     std::chrono::milliseconds timeout,
     uint64_t qosClass,
-    uint64_t qosPath)
+    uint64_t qosPath,
+    size_t numConnections)
     : proxy(&proxy_),
-      accessPoint_(std::move(ap)),
+      clients_(std::max<size_t>(numConnections, 1)),
+      clientUp_(clients_.size(), false),
       shortestTimeout_(timeout),
-      qosClass_(qosClass),
-      qosPath_(qosPath),
       rxmitsToCloseConnection_(
           proxy->router().opts().min_rxmit_reconnect_threshold),
+      accessPoint_(std::move(ap)),
+      qosClass_(qosClass),
+      qosPath_(qosPath),
+      numConnections_(clients_.size()),
       probeTimer_(*this) {
   static uint64_t next_magic = 0x12345678900000LL;
   magic_ = __sync_fetch_and_add(&next_magic, 1);
@@ -301,23 +416,87 @@ ProxyDestination::ProxyDestination(
 }
 
 bool ProxyDestination::may_send() const {
-  return !tracker->isTko();
+  /* isSharedTko() fast-fails requests when another mcrouter instance on
+     this host has marked the destination TKO; only that instance sends
+     probes and unmarks it. */
+  return !tracker->isTko() && !tracker->isSharedTko();
 }
 
 void ProxyDestination::resetInactive() {
-  // No need to reset non-existing client.
-  if (client_) {
-    std::unique_ptr<AsyncMcClient> client;
-    {
-      folly::SpinLockGuard g(clientLock_);
-      client = std::move(client_);
+  std::vector<std::unique_ptr<AsyncMcClient>> clients;
+  std::unique_ptr<AsyncMcClient> udpClient;
+  {
+    folly::SpinLockGuard g(clientLock_);
+    clients.swap(clients_);
+    clients_.resize(numConnections_);
+    udpClient = std::move(udpClient_);
+  }
+  for (auto& client : clients) {
+    // No need to reset non-existing clients.
+    if (client) {
+      client->closeNow();
     }
-    client->closeNow();
+  }
+  if (udpClient) {
+    udpClient->closeNow();
   }
 }
 
-void ProxyDestination::initializeAsyncMcClient() {
-  assert(!client_);
+void ProxyDestination::refreshDns() {
+  auto addresses = accessPoint_->resolve();
+  if (addresses.empty()) {
+    /* Resolution failure: keep whatever we're connected to. */
+    return;
+  }
+  if (resolvedAddresses_.empty()) {
+    /* First refresh just seeds the baseline; connections opened before
+       it already used a fresh resolution. */
+    resolvedAddresses_ = std::move(addresses);
+    return;
+  }
+  if (addresses != resolvedAddresses_) {
+    resolvedAddresses_ = std::move(addresses);
+    stat_incr(proxy->stats, dns_resolution_changes_stat, 1);
+    dnsDrainTicksLeft_ = kDnsDrainTicksMax;
+  }
+  if (dnsDrainTicksLeft_ == 0) {
+    return;
+  }
+
+  /* Cycle the connections so they reconnect (re-resolving on the way)
+     to the new address: idle ones right away, busy ones once they have
+     drained or when the drain ticks run out. */
+  --dnsDrainTicksLeft_;
+  const bool force = dnsDrainTicksLeft_ == 0;
+  bool busyLeft = false;
+  for (auto& client : clients_) {
+    if (!client) {
+      continue;
+    }
+    if (force ||
+        client->getPendingRequestCount() +
+            client->getInflightRequestCount() == 0) {
+      client->closeNow();
+    } else {
+      busyLeft = true;
+    }
+  }
+  if (udpClient_) {
+    if (force ||
+        udpClient_->getPendingRequestCount() +
+            udpClient_->getInflightRequestCount() == 0) {
+      udpClient_->closeNow();
+    } else {
+      busyLeft = true;
+    }
+  }
+  if (!busyLeft) {
+    dnsDrainTicksLeft_ = 0;
+  }
+}
+
+void ProxyDestination::initializeAsyncMcClient(size_t index) {
+  assert(index < clients_.size() && !clients_[index]);
 
   ConnectionOptions options(accessPoint_);
   auto& opts = proxy->router().opts();
@@ -326,6 +505,10 @@ void ProxyDestination::initializeAsyncMcClient() {
   options.tcpKeepAliveIdle = opts.keepalive_idle_s;
   options.tcpKeepAliveInterval = opts.keepalive_interval_s;
   options.writeTimeout = shortestTimeout_;
+  options.tcpNotsentLowat = opts.tcp_notsent_lowat;
+  options.busyPollUs = opts.socket_busy_poll_us;
+  options.enableTfo = opts.tcp_fastopen;
+  options.keepStandbyConnection = opts.standby_connections;
   options.sessionCachingEnabled = opts.ssl_connection_cache;
   if (!opts.debug_fifo_root.empty()) {
     options.debugFifoPath = getClientDebugFifoFullPath(opts);
@@ -357,10 +540,11 @@ void ProxyDestination::initializeAsyncMcClient() {
                                                   std::move(options));
   {
     folly::SpinLockGuard g(clientLock_);
-    client_ = std::move(client);
+    clients_[index] = std::move(client);
   }
+  auto& mcClient = *clients_[index];
 
-  client_->setRequestStatusCallbacks(
+  mcClient.setRequestStatusCallbacks(
     [this](int pending, int inflight) {
       if (pending != 0) {
         stat_incr(proxy->stats, destination_pending_reqs_stat, pending);
@@ -388,20 +572,30 @@ void ProxyDestination::initializeAsyncMcClient() {
       stat_incr(proxy->stats, destination_requests_sum_stat, numToSend);
     });
 
-  client_->setStatusCallbacks(
-    [this] () mutable {
+  mcClient.setStatusCallbacks(
+    [this, index] () mutable {
+      if (!clientUp_[index]) {
+        clientUp_[index] = true;
+        ++upConnections_;
+      }
       setState(State::kUp);
     },
-    [this] (bool aborting) mutable {
-      if (aborting) {
-        setState(State::kClosed);
-      } else {
-        setState(State::kDown);
+    [this, index] (bool aborting) mutable {
+      if (clientUp_[index]) {
+        clientUp_[index] = false;
+        assert(upConnections_ > 0);
+        --upConnections_;
+      }
+      /* The destination only counts as down once no connection is up */
+      if (upConnections_ == 0) {
+        setState(aborting ? State::kClosed : State::kDown);
+      }
+      if (!aborting) {
         handle_tko(mc_res_connect_error, /* is_probe_req= */ false);
       }
     });
 
-  client_->setReplyStatsCallback([proxy = proxy, accessPoint = accessPoint_](
+  mcClient.setReplyStatsCallback([proxy = proxy, accessPoint = accessPoint_](
       ReplyStatsContext replyStatsContext) {
     if (accessPoint->compressed()) {
       if (replyStatsContext.usedCodecId > 0) {
@@ -423,52 +617,116 @@ void ProxyDestination::initializeAsyncMcClient() {
   });
 
   if (opts.target_max_inflight_requests > 0) {
-    client_->setThrottle(opts.target_max_inflight_requests,
+    mcClient.setThrottle(opts.target_max_inflight_requests,
                          opts.target_max_pending_requests);
   }
 }
 
 AsyncMcClient& ProxyDestination::getAsyncMcClient() {
-  if (!client_) {
-    initializeAsyncMcClient();
+  size_t best = clients_.size();
+  size_t bestLoad = std::numeric_limits<size_t>::max();
+  for (size_t i = 0; i < clients_.size(); ++i) {
+    if (!clients_[i]) {
+      continue;
+    }
+    const auto load = clients_[i]->getPendingRequestCount() +
+                      clients_[i]->getInflightRequestCount();
+    if (load < bestLoad) {
+      best = i;
+      bestLoad = load;
+    }
+  }
+
+  if (bestLoad > 0) {
+    /* Every open connection is busy (or none is open yet); open another
+       one if we still have a free slot */
+    for (size_t i = 0; i < clients_.size(); ++i) {
+      if (!clients_[i]) {
+        initializeAsyncMcClient(i);
+        return *clients_[i];
+      }
+    }
   }
-  return *client_;
+
+  assert(best < clients_.size());
+  return *clients_[best];
 }
 
-void ProxyDestination::onTkoEvent(TkoLogEvent event, mc_res_t result) const {
-  auto logUtil = [this, result](folly::StringPiece eventStr) {
-    VLOG(1) << accessPoint_->toHostPortString() << " (" << poolName_ << ") "
-            << eventStr << ". Total hard TKOs: "
-            << tracker->globalTkos().hardTkos << "; soft TKOs: "
-            << tracker->globalTkos().softTkos << ". Reply: "
-            << mc_res_to_string(result);
-  };
+AsyncMcClient* ProxyDestination::getUdpClient() {
+  if (udpFellBack_ || !proxy->router().opts().udp_gets) {
+    return nullptr;
+  }
+  if (!udpClient_) {
+    if (accessPoint_->getProtocol() != mc_ascii_protocol ||
+        accessPoint_->useSsl() || proxy->router().opts().no_network ||
+        sharedOwner_) {
+      /* Not eligible for UDP; don't re-check on every get */
+      udpFellBack_ = true;
+      return nullptr;
+    }
+    initializeUdpClient();
+  }
+  return udpClient_.get();
+}
 
-  switch (event) {
-    case TkoLogEvent::MarkHardTko:
-      logUtil("marked hard TKO");
-      break;
-    case TkoLogEvent::MarkSoftTko:
-      logUtil("marked soft TKO");
-      break;
-    case TkoLogEvent::UnMarkTko:
-      logUtil("unmarked TKO");
-      break;
-    case TkoLogEvent::RemoveFromConfig:
-      logUtil("was TKO, removed from config");
-      break;
+void ProxyDestination::initializeUdpClient() {
+  assert(!udpClient_);
+
+  ConnectionOptions options(accessPoint_);
+  auto& opts = proxy->router().opts();
+  options.useUdp = true;
+  options.writeTimeout = shortestTimeout_;
+  if (!opts.debug_fifo_root.empty()) {
+    options.debugFifoPath = getClientDebugFifoFullPath(opts);
+  }
+
+  auto client = folly::make_unique<AsyncMcClient>(proxy->eventBase(),
+                                                  std::move(options));
+  if (opts.target_max_inflight_requests > 0) {
+    client->setThrottle(opts.target_max_inflight_requests,
+                        opts.target_max_pending_requests);
   }
+  /* No status callbacks: a UDP socket has no connection state worth
+     feeding into the destination's up/down tracking */
+  folly::SpinLockGuard g(clientLock_);
+  udpClient_ = std::move(client);
+}
 
-  TkoLog tkoLog(*accessPoint_, tracker->globalTkos());
-  tkoLog.event = event;
-  tkoLog.isHardTko = tracker->isHardTko();
-  tkoLog.isSoftTko = tracker->isSoftTko();
-  tkoLog.avgLatency = stats_.avgLatency.value();
-  tkoLog.probesSent = stats_.probesSent;
-  tkoLog.poolName = poolName_;
-  tkoLog.result = result;
+bool ProxyDestination::udpLossThresholdReached(const mc_res_t result) {
+  if (result != mc_res_timeout) {
+    consecutiveUdpTimeouts_ = 0;
+    return false;
+  }
+  if (++consecutiveUdpTimeouts_ < kMaxConsecutiveUdpTimeouts) {
+    return false;
+  }
+  /* The in-flight UDP requests of other fibers hit this branch too once
+     they time out, so they all get retried over TCP as well; the idle
+     client is destroyed with the destination */
+  udpFellBack_ = true;
+  VLOG(1) << accessPoint_->toHostPortString() << " (" << poolName_
+          << ") fell back from UDP to TCP after "
+          << kMaxConsecutiveUdpTimeouts << " consecutive timeouts";
+  return true;
+}
 
-  logTkoEvent(*proxy, tkoLog);
+void ProxyDestination::onTkoEvent(TkoLogEvent event, mc_res_t result) const {
+  /* Only snapshot the transition here; formatting and logging happen on
+     the stat updater thread, so a mass TKO (e.g. a whole rack going
+     dark) doesn't add logging latency to the requests discovering it */
+  TkoEvent ev;
+  ev.event = event;
+  ev.result = result;
+  ev.isHardTko = tracker->isHardTko();
+  ev.isSoftTko = tracker->isSoftTko();
+  ev.probesSent = stats_.probesSent;
+  ev.avgLatency = stats_.avgLatency.value();
+  ev.globalSoftTkos = tracker->globalTkos().softTkos;
+  ev.globalHardTkos = tracker->globalTkos().hardTkos;
+  ev.accessPoint = accessPoint_;
+  ev.poolName = poolName_;
+
+  proxy->recordTkoEvent(std::move(ev));
 }
 
 void ProxyDestination::setState(State new_st) {
@@ -505,6 +763,21 @@ void ProxyDestination::setState(State new_st) {
   }
 }
 
+std::chrono::milliseconds ProxyDestination::adaptiveTimeout(
+    std::chrono::milliseconds timeout) const {
+  if (!proxy->router().opts().enable_adaptive_timeouts ||
+      !stats_.avgLatency.hasValue()) {
+    return timeout;
+  }
+
+  // Latency samples are in microseconds; round the bound up to whole ms.
+  const double boundUs = stats_.avgLatency.value() +
+      kAdaptiveTimeoutDeviationFactor * stats_.latencyDeviation.value();
+  const auto boundMs = std::max(
+      static_cast<int64_t>(boundUs / 1000.0) + 1, kAdaptiveTimeoutFloorMs);
+  return std::min(timeout, std::chrono::milliseconds(boundMs));
+}
+
 void ProxyDestination::updateShortestTimeout(
     std::chrono::milliseconds timeout) {
   if (!timeout.count()) {
@@ -512,8 +785,13 @@ void ProxyDestination::updateShortestTimeout(
   }
   if (shortestTimeout_.count() == 0 || shortestTimeout_ > timeout) {
     shortestTimeout_ = timeout;
-    if (client_) {
-      client_->updateWriteTimeout(shortestTimeout_);
+    for (auto& client : clients_) {
+      if (client) {
+        client->updateWriteTimeout(shortestTimeout_);
+      }
+    }
+    if (udpClient_) {
+      udpClient_->updateWriteTimeout(shortestTimeout_);
     }
   }
 }
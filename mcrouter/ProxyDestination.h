@@ -12,12 +12,15 @@
 #include <array>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <folly/IntrusiveList.h>
+#include <folly/SocketAddress.h>
 #include <folly/SpinLock.h>
 
 #include "mcrouter/AsyncTimer.h"
 #include "mcrouter/ExponentialSmoothData.h"
+#include "mcrouter/LatencyHistogram.h"
 #include "mcrouter/TkoLog.h"
 #include "mcrouter/config.h"
 #include "mcrouter/lib/McOperation.h"
@@ -56,6 +59,12 @@ class ProxyDestination {
   struct Stats {
     State state{State::kNew};
     ExponentialSmoothData<16> avgLatency;
+    // Smoothed absolute deviation of latency samples (us), used together
+    // with avgLatency to derive adaptive timeouts.
+    ExponentialSmoothData<16> latencyDeviation;
+    // Full latency distribution (us), for percentile stats; unlike the
+    // smoothed values above it never forgets past samples.
+    LatencyHistogram latencyHistogramUs;
     std::unique_ptr<std::array<uint64_t, mc_nres>> results;
     size_t probesSent{0};
     double retransPerKByte{0.0};
@@ -90,41 +99,103 @@ class ProxyDestination {
     return accessPoint_;
   }
 
+  /**
+   * True if this destination forwards its sends to a shared owner copy
+   * (see --shared-destination-connections) instead of holding
+   * connections itself.
+   */
+  bool isSharedForwarder() const noexcept {
+    return sharedOwner_ != nullptr;
+  }
+
   void resetInactive();
 
   size_t getPendingRequestCount() const;
   size_t getInflightRequestCount() const;
 
+  /**
+   * True once every possible connection to this destination is open and
+   * backed up beyond its TCP_NOTSENT_LOWAT watermark (see
+   * --tcp-notsent-lowat), i.e. new requests would only queue until they
+   * time out.
+   */
+  bool isSaturated() const;
+
   void updateShortestTimeout(std::chrono::milliseconds timeout);
 
   void updatePoolName(std::string poolName) {
     poolName_ = std::move(poolName);
   }
 
+  folly::StringPiece poolName() const {
+    return poolName_;
+  }
+
  private:
   static const uint64_t kDeadBeef = 0xdeadbeefdeadbeefULL;
 
-  std::unique_ptr<AsyncMcClient> client_;
-  std::shared_ptr<const AccessPoint> accessPoint_;
+  /* Hot fields: everything below up to stats_ is read or written on
+     every request routed to this destination; keep them together so the
+     send path touches as few cache lines as possible. Cold
+     configuration follows after. */
+
+  // Connections to the destination, opened lazily one at a time as the
+  // already-open ones are found busy, up to numConnections_ (see
+  // getAsyncMcClient()).  Slots of never-used connections stay null.
+  std::vector<std::unique_ptr<AsyncMcClient>> clients_;
+  // Whether clients_[i] is currently connected; drives the aggregated
+  // up/down state of the destination.
+  std::vector<bool> clientUp_;
+  size_t upConnections_{0};
   mutable folly::SpinLock clientLock_; // AsyncMcClient lock for stats threads.
 
+  // With --udp-gets, the client get requests go through (see
+  // getUdpClient()); null until the first get, and unused once the loss
+  // fallback below trips.
+  std::unique_ptr<AsyncMcClient> udpClient_;
+  size_t consecutiveUdpTimeouts_{0};
+  bool udpFellBack_{false};
+
   // Shortest timeout among all DestinationRoutes using this destination
   std::chrono::milliseconds shortestTimeout_{0};
-  const uint64_t qosClass_{0};
-  const uint64_t qosPath_{0};
-  uint64_t magic_{0}; ///< to allow asserts that pdstn is still alive
-
-  Stats stats_;
 
   uint64_t lastRetransCycles_{0}; // Cycles when restransmits were last fetched
   uint64_t rxmitsToCloseConnection_{0};
   uint64_t lastConnCloseCycles_{0}; // Cycles when connection was last closed
 
+  Stats stats_;
+
+  /* Cold fields: only touched at config/probe/teardown frequency. */
+
+  std::shared_ptr<const AccessPoint> accessPoint_;
+  // With --shared-destination-connections, the destination on the owner
+  // proxy that holds the actual connections; null when this proxy is the
+  // owner (or sharing is off) and the connections above are used.
+  std::shared_ptr<ProxyDestination> sharedOwner_;
+  const uint64_t qosClass_{0};
+  const uint64_t qosPath_{0};
+  const size_t numConnections_{1};
+  uint64_t magic_{0}; ///< to allow asserts that pdstn is still alive
+
+  // Addresses the destination hostname resolved to on the last
+  // background DNS refresh (see --dns-refresh-interval-ms); empty until
+  // the first refresh.
+  std::vector<folly::SocketAddress> resolvedAddresses_;
+  // Non-zero while connections are being cycled after an address change;
+  // counts refresh ticks left before still-busy connections are closed
+  // forcibly instead of waiting for them to go idle.
+  uint8_t dnsDrainTicksLeft_{0};
+
   int probe_delay_next_ms{0};
+  // Version request reused for every probe (and warm-up) this
+  // destination sends; created on first use and never mutated.
   std::unique_ptr<McVersionRequest> probe_req;
+  bool probeInflight_{false};
   std::string poolName_;
-  // The string is stored in ProxyDestinationMap::destinations_
-  folly::StringPiece pdstnKey_; ///< consists of ap, server_timeout
+  std::string pdstnKey_; ///< consists of ap, server_timeout
+  // Precomputed hash the owning ProxyDestinationMap keys this
+  // destination under; see destinationKeyHash().
+  uint64_t pdstnKeyHash_{0};
 
   AsyncTimer<ProxyDestination> probeTimer_;
 
@@ -133,29 +204,106 @@ class ProxyDestination {
       std::shared_ptr<AccessPoint> ap,
       std::chrono::milliseconds timeout,
       uint64_t qosClass,
-      uint64_t qosPath);
+      uint64_t qosPath,
+      size_t numConnections);
 
   void setState(State st);
 
   void start_sending_probes();
   void stop_sending_probes();
 
+  /**
+   * Opens the connection (including any TLS handshake) and verifies the
+   * server answers a version request, off the critical path of real
+   * traffic. Only destinations that never took traffic are warmed up.
+   */
+  void warmUp();
+
   void schedule_next_probe();
 
+  /**
+   * Re-resolves the destination hostname and, when the result differs
+   * from the previous resolution, closes this destination's connections
+   * (idle ones right away, busy ones once drained or after a few more
+   * refresh ticks) so they reconnect to the new address. Called
+   * periodically by the owning map; see --dns-refresh-interval-ms.
+   * Note: may block on DNS.
+   */
+  void refreshDns();
+
   void handle_tko(const mc_res_t result, bool is_probe_req);
 
   // Process tko, stats and duration timer.
   void onReply(const mc_res_t result, DestinationRequestCtx& destreqCtx);
 
+  /**
+   * Like onReply() for replies received over UDP: a timeout there
+   * usually means a lost datagram rather than a sick server, so it
+   * doesn't count toward TKO (and there are no TCP retransmits to
+   * track).
+   */
+  void onUdpReply(const mc_res_t result, DestinationRequestCtx& destreqCtx);
+
+  // Result counter and latency samples, shared by both of the above.
+  void updateRequestStats(const mc_res_t result,
+                          DestinationRequestCtx& destreqCtx);
+
+  /**
+   * The client for sending requests over UDP (see --udp-gets), or
+   * nullptr when UDP is disabled, not applicable to this destination
+   * (non-ascii protocol, SSL, shared-connection forwarding), or the
+   * destination has fallen back to TCP.
+   */
+  AsyncMcClient* getUdpClient();
+  void initializeUdpClient();
+
+  /**
+   * getUdpClient() if requests of this type should go over UDP
+   * (currently only gets), otherwise nullptr.
+   */
+  template <class Request>
+  AsyncMcClient* udpClientFor();
+
+  /**
+   * Tracks consecutive UDP request timeouts; returns true once the loss
+   * threshold is reached, at which point the destination permanently
+   * falls back to TCP and the caller should retry the request there.
+   */
+  bool udpLossThresholdReached(const mc_res_t result);
+
+  /**
+   * Forwards the request to the proxy owning this destination's
+   * connections (see --shared-destination-connections) and blocks the
+   * calling fiber until the reply comes back.
+   */
+  template <class Request>
+  ReplyT<Request> sendShared(const Request& request,
+                             std::chrono::milliseconds timeout);
+
+  /**
+   * When --enable-adaptive-timeouts is set, returns a timeout derived
+   * from the destination's smoothed latency and deviation (TCP RTO
+   * style), never exceeding the configured timeout; otherwise returns
+   * the configured timeout unchanged.
+   */
+  std::chrono::milliseconds adaptiveTimeout(
+      std::chrono::milliseconds timeout) const;
+
+  /**
+   * Returns the least loaded open connection; if all open connections
+   * have requests outstanding and there's still a free slot, opens a
+   * new connection instead.
+   */
   AsyncMcClient& getAsyncMcClient();
-  void initializeAsyncMcClient();
+  void initializeAsyncMcClient(size_t index);
 
   ProxyDestination(
       Proxy& proxy,
       std::shared_ptr<AccessPoint> ap,
       std::chrono::milliseconds timeout,
       uint64_t qosClass,
-      uint64_t qosPath);
+      uint64_t qosPath,
+      size_t numConnections);
 
   void onTkoEvent(TkoLogEvent event, mc_res_t result) const;
 
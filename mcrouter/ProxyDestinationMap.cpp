@@ -10,6 +10,7 @@
 #include "ProxyDestinationMap.h"
 
 #include <folly/Format.h>
+#include <folly/Hash.h>
 #include <folly/Memory.h>
 #include <folly/io/async/AsyncTimeout.h>
 #include <folly/io/async/EventBase.h>
@@ -25,6 +26,16 @@ namespace facebook { namespace memcache { namespace mcrouter {
 
 namespace {
 
+// How often the warm-up timer fires; together with
+// --destination-warmup-rate this determines the per-tick batch size.
+constexpr uint32_t kWarmUpIntervalMs = 100;
+
+// Destinations re-resolved per DNS refresh tick, and the delay between
+// ticks of the same pass. getaddrinfo() can block the proxy thread, so
+// a pass over a large table is spread over several event loop
+// iterations.
+constexpr size_t kDnsRefreshBatchSize = 32;
+constexpr uint32_t kDnsRefreshBatchDelayMs = 10;
 
 std::string genProxyDestinationKey(const AccessPoint& ap,
                                    std::chrono::milliseconds timeout) {
@@ -37,6 +48,32 @@ std::string genProxyDestinationKey(const AccessPoint& ap,
   }
 }
 
+/**
+ * Hash over the same fields genProxyDestinationKey() encodes, built
+ * from the access point's precomputed hash so the table can be probed
+ * without materializing the key string or re-reading the host.
+ */
+uint64_t destinationKeyHash(const AccessPoint& ap,
+                            std::chrono::milliseconds timeout) {
+  uint64_t hash = ap.hash();
+  if (ap.getProtocol() == mc_ascii_protocol) {
+    hash = folly::hash::hash_128_to_64(
+        hash, static_cast<uint64_t>(timeout.count()));
+  }
+  return hash;
+}
+
+constexpr size_t kInitialTableSize = 16; // must be a power of two
+
+size_t tableCapacityFor(size_t numEntries) {
+  size_t capacity = kInitialTableSize;
+  // Size for a load factor of at most 1/2 after a rehash.
+  while (capacity < numEntries * 2) {
+    capacity <<= 1;
+  }
+  return capacity;
+}
+
 } // anonymous
 
 struct ProxyDestinationMap::StateList {
@@ -45,6 +82,38 @@ struct ProxyDestinationMap::StateList {
   List list;
 };
 
+struct ProxyDestinationMap::WarmUpState {
+  explicit WarmUpState(ProxyDestinationMap& map)
+      : map_(map),
+        timer_(*this) {}
+
+  void timerCallback() {
+    map_.warmUpTick();
+  }
+
+  ProxyDestinationMap& map_;
+  std::vector<std::weak_ptr<ProxyDestination>> queue_;
+  AsyncTimer<WarmUpState> timer_;
+};
+
+struct ProxyDestinationMap::DnsRefreshState {
+  explicit DnsRefreshState(ProxyDestinationMap& map)
+      : map_(map),
+        timer_(*this) {}
+
+  void timerCallback() {
+    map_.dnsRefreshTick();
+  }
+
+  ProxyDestinationMap& map_;
+  uint32_t intervalMs_{0};
+  // Next slot of the destination table to scan; a rehash mid-pass may
+  // make the pass skip or revisit a few destinations, which is harmless
+  // for a periodic refresh.
+  size_t cursor_{0};
+  AsyncTimer<DnsRefreshState> timer_;
+};
+
 ProxyDestinationMap::ProxyDestinationMap(Proxy* proxy)
     : proxy_(proxy),
       active_(folly::make_unique<StateList>()),
@@ -56,14 +125,60 @@ std::shared_ptr<ProxyDestination>
 ProxyDestinationMap::emplace(std::shared_ptr<AccessPoint> ap,
                              std::chrono::milliseconds timeout,
                              uint64_t qosClass,
-                             uint64_t qosPath) {
+                             uint64_t qosPath,
+                             size_t numConnections) {
   auto key = genProxyDestinationKey(*ap, timeout);
+  auto hash = destinationKeyHash(*ap, timeout);
+
+  // With --shared-destination-connections, every destination's
+  // connections live on one owner proxy chosen by key hash; destinations
+  // created on other proxies forward their sends to the owner's copy
+  // (see ProxyDestination::sendShared()).
+  std::shared_ptr<ProxyDestination> sharedOwner;
+  const auto& routerOpts = proxy_->router().opts();
+  if (routerOpts.shared_destination_connections &&
+      routerOpts.num_proxies > 1) {
+    const size_t ownerId = hash % routerOpts.num_proxies;
+    auto* ownerProxy = proxy_->router().getProxy(ownerId);
+    if (ownerId != proxy_->getId() && ownerProxy != nullptr) {
+      auto& ownerMap = *ownerProxy->destinationMap;
+      sharedOwner = ownerMap.find(*ap, timeout);
+      if (!sharedOwner) {
+        // Runs on the config thread; the owner copy's warm-up is
+        // scheduled onto the owner proxy's own thread (see
+        // scheduleWarmUp()), not this one's.
+        sharedOwner = ownerMap.emplace(ap, timeout, qosClass, qosPath,
+                                       numConnections);
+      }
+      // The owner's map keeps its own strong reference, so the owner
+      // copy is torn down with its proxy rather than by whichever
+      // forwarding proxy happens to drop the last reference.
+      ownerMap.retainShared(sharedOwner);
+    }
+  }
+
+  // With --cross-router-shared-destinations, mcrouter instances in this
+  // process share destinations the same way: a matching destination
+  // held by an earlier-registered instance owns the connections, and
+  // this one forwards to it.
+  if (!sharedOwner && routerOpts.cross_router_shared_destinations) {
+    std::shared_ptr<void> ownerRouter;
+    sharedOwner = McrouterInstance::findCrossRouterDestination(
+        *ap, timeout, proxy_->router(), ownerRouter);
+    if (sharedOwner) {
+      std::lock_guard<std::mutex> lck(destinationsLock_);
+      crossRouterRetained_.push_back(std::move(ownerRouter));
+    }
+  }
+
   auto destination = ProxyDestination::create(*proxy_, std::move(ap),
-      timeout, qosClass, qosPath);
+      timeout, qosClass, qosPath, numConnections);
+  destination->pdstnKey_ = std::move(key);
+  destination->pdstnKeyHash_ = hash;
+  destination->sharedOwner_ = std::move(sharedOwner);
   {
     std::lock_guard<std::mutex> lck(destinationsLock_);
-    auto destIt = destinations_.emplace(key, destination);
-    destination->pdstnKey_ = destIt.first->first;
+    insertLocked(hash, timeout, destination);
   }
 
   // Update shared area of ProxyDestinations with same key from different
@@ -73,30 +188,181 @@ ProxyDestinationMap::emplace(std::shared_ptr<AccessPoint> ap,
     proxy_->router().opts().failures_until_tko,
     proxy_->router().opts().maximum_soft_tkos);
 
+  scheduleWarmUp(destination);
+
   return destination;
 }
 
+void ProxyDestinationMap::retainShared(
+    std::shared_ptr<ProxyDestination> destination) {
+  std::lock_guard<std::mutex> lck(destinationsLock_);
+  for (const auto& d : sharedRetained_) {
+    if (d == destination) {
+      return;
+    }
+  }
+  sharedRetained_.push_back(std::move(destination));
+}
+
+void ProxyDestinationMap::scheduleWarmUp(
+    std::shared_ptr<ProxyDestination> destination) {
+  if (proxy_->router().opts().destination_warmup_rate == 0) {
+    return;
+  }
+  // Reconfigurations land here on the config thread, but the warm-up
+  // queue and timer are proxy-thread state: folly::AsyncTimeout may only
+  // be attached and scheduled from its event base's thread, and
+  // warmUpTick() pops the queue there.  Hop to the owning proxy before
+  // touching either; messages queued before the proxy loop starts are
+  // processed once it does.
+  proxy_->sendTask(
+      [this, weak = std::weak_ptr<ProxyDestination>(destination)]() {
+        if (!warmUp_) {
+          warmUp_ = folly::make_unique<WarmUpState>(*this);
+          warmUp_->timer_.attachEventBase(std::addressof(proxy_->eventBase()));
+        }
+        warmUp_->queue_.push_back(weak);
+        if (!warmUp_->timer_.isScheduled() &&
+            !warmUp_->timer_.scheduleTimeout(kWarmUpIntervalMs)) {
+          MC_LOG_FAILURE(proxy_->router().opts(),
+                         memcache::failure::Category::kSystemError,
+                         "failed to schedule destination warm-up timer");
+        }
+      });
+}
+
+void ProxyDestinationMap::warmUpTick() {
+  const auto rate = proxy_->router().opts().destination_warmup_rate;
+  auto& queue = warmUp_->queue_;
+  size_t batch = std::max<uint64_t>(1, rate * kWarmUpIntervalMs / 1000);
+  while (batch > 0 && !queue.empty()) {
+    auto destination = queue.back().lock();
+    queue.pop_back();
+    // Destinations that were dropped by a reconfiguration or already
+    // took traffic don't consume budget.
+    if (destination &&
+        destination->stats().state == ProxyDestination::State::kNew) {
+      destination->warmUp();
+      --batch;
+    }
+  }
+  if (!queue.empty() && !warmUp_->timer_.scheduleTimeout(kWarmUpIntervalMs)) {
+    MC_LOG_FAILURE(proxy_->router().opts(),
+                   memcache::failure::Category::kSystemError,
+                   "failed to re-schedule destination warm-up timer");
+  }
+}
+
 /**
  * If ProxyDestination is already stored in this object - returns it;
  * otherwise, returns nullptr.
  */
 std::shared_ptr<ProxyDestination> ProxyDestinationMap::find(
     const AccessPoint& ap, std::chrono::milliseconds timeout) const {
-  auto key = genProxyDestinationKey(ap, timeout);
+  auto hash = destinationKeyHash(ap, timeout);
   {
     std::lock_guard<std::mutex> lck(destinationsLock_);
-    return find(key);
+    return findLocked(hash, ap, timeout);
   }
 }
 
-// Note: caller must be holding destionationsLock_.
-std::shared_ptr<ProxyDestination>
-ProxyDestinationMap::find(const std::string& key) const {
-  auto it = destinations_.find(key);
-  if (it == destinations_.end()) {
+std::shared_ptr<ProxyDestination> ProxyDestinationMap::findLocked(
+    uint64_t hash,
+    const AccessPoint& ap,
+    std::chrono::milliseconds timeout) const {
+  if (slots_.empty()) {
     return nullptr;
   }
-  return it->second.lock();
+  const size_t mask = slots_.size() - 1;
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    const auto& slot = slots_[i];
+    if (slot.state == kEmptySlot) {
+      return nullptr;
+    }
+    if (slot.state != kUsedSlot || slot.hash != hash) {
+      continue;
+    }
+    if (auto destination = slot.dest.lock()) {
+      if (*destination->accessPoint() == ap &&
+          (ap.getProtocol() != mc_ascii_protocol ||
+           slot.timeoutMs == timeout.count())) {
+        return destination;
+      }
+    }
+  }
+}
+
+void ProxyDestinationMap::insertLocked(
+    uint64_t hash,
+    std::chrono::milliseconds timeout,
+    std::shared_ptr<ProxyDestination> destination) {
+  // Keep occupancy (used + tombstones) below 3/4 so probe chains stay
+  // short; the rehash also reclaims tombstones and expired entries.
+  if (slots_.empty() || (numOccupied_ + 1) * 4 > slots_.size() * 3) {
+    rehashLocked(numUsed_ + 1);
+  }
+  const size_t mask = slots_.size() - 1;
+  size_t i = hash & mask;
+  while (slots_[i].state == kUsedSlot) {
+    i = (i + 1) & mask;
+  }
+  auto& slot = slots_[i];
+  if (slot.state == kEmptySlot) {
+    ++numOccupied_;
+  }
+  slot.hash = hash;
+  slot.timeoutMs = static_cast<int32_t>(timeout.count());
+  slot.state = kUsedSlot;
+  slot.raw = destination.get();
+  slot.dest = std::move(destination);
+  ++numUsed_;
+}
+
+void ProxyDestinationMap::eraseLocked(uint64_t hash,
+                                      ProxyDestination& destination) {
+  if (slots_.empty()) {
+    return;
+  }
+  const size_t mask = slots_.size() - 1;
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    auto& slot = slots_[i];
+    if (slot.state == kEmptySlot) {
+      return;
+    }
+    if (slot.state == kUsedSlot && slot.raw == &destination) {
+      slot.state = kTombstoneSlot;
+      slot.raw = nullptr;
+      slot.dest.reset();
+      --numUsed_;
+      return;
+    }
+  }
+}
+
+void ProxyDestinationMap::rehashLocked(size_t minCapacity) {
+  std::vector<Slot> oldSlots(
+      tableCapacityFor(std::max(minCapacity, numUsed_)));
+  oldSlots.swap(slots_);
+  numUsed_ = 0;
+  numOccupied_ = 0;
+  const size_t mask = slots_.size() - 1;
+  for (auto& slot : oldSlots) {
+    if (slot.state != kUsedSlot || slot.dest.expired()) {
+      continue;
+    }
+    size_t i = slot.hash & mask;
+    while (slots_[i].state == kUsedSlot) {
+      i = (i + 1) & mask;
+    }
+    slots_[i] = std::move(slot);
+    ++numUsed_;
+    ++numOccupied_;
+  }
+}
+
+folly::StringPiece ProxyDestinationMap::destinationKey(
+    const ProxyDestination& destination) {
+  return destination.pdstnKey_;
 }
 
 void ProxyDestinationMap::removeDestination(ProxyDestination& destination) {
@@ -107,7 +373,7 @@ void ProxyDestinationMap::removeDestination(ProxyDestination& destination) {
   }
   {
     std::lock_guard<std::mutex> lck(destinationsLock_);
-    destinations_.erase(destination.pdstnKey_);
+    eraseLocked(destination.pdstnKeyHash_, destination);
   }
 }
 
@@ -146,6 +412,56 @@ void ProxyDestinationMap::setResetTimer(std::chrono::milliseconds interval) {
   }
 }
 
+void ProxyDestinationMap::setDnsRefreshTimer(
+    std::chrono::milliseconds interval) {
+  assert(interval.count() > 0);
+  dnsRefresh_ = folly::make_unique<DnsRefreshState>(*this);
+  dnsRefresh_->intervalMs_ = static_cast<uint32_t>(interval.count());
+
+  dnsRefresh_->timer_.attachEventBase(std::addressof(proxy_->eventBase()));
+  if (!dnsRefresh_->timer_.scheduleTimeout(dnsRefresh_->intervalMs_)) {
+    MC_LOG_FAILURE(proxy_->router().opts(),
+                   memcache::failure::Category::kSystemError,
+                   "failed to schedule DNS refresh timer");
+  }
+}
+
+void ProxyDestinationMap::dnsRefreshTick() {
+  std::vector<std::shared_ptr<ProxyDestination>> batch;
+  bool passDone;
+  {
+    std::lock_guard<std::mutex> lock(destinationsLock_);
+    auto& cursor = dnsRefresh_->cursor_;
+    if (cursor >= slots_.size()) {
+      cursor = 0;
+    }
+    while (batch.size() < kDnsRefreshBatchSize && cursor < slots_.size()) {
+      auto& slot = slots_[cursor++];
+      if (slot.state != kUsedSlot) {
+        continue;
+      }
+      if (auto destination = slot.dest.lock()) {
+        batch.push_back(std::move(destination));
+      }
+    }
+    passDone = cursor >= slots_.size();
+  }
+
+  // Resolve outside the lock: getaddrinfo() may block, and stats
+  // threads also take destinationsLock_.
+  for (auto& destination : batch) {
+    destination->refreshDns();
+  }
+
+  const auto delayMs =
+      passDone ? dnsRefresh_->intervalMs_ : kDnsRefreshBatchDelayMs;
+  if (!dnsRefresh_->timer_.scheduleTimeout(delayMs)) {
+    MC_LOG_FAILURE(proxy_->router().opts(),
+                   memcache::failure::Category::kSystemError,
+                   "failed to re-schedule DNS refresh timer");
+  }
+}
+
 void ProxyDestinationMap::timerCallback() {
   resetAllInactive();
 
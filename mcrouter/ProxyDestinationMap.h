@@ -10,13 +10,13 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
-#include <folly/experimental/StringKeyedUnorderedMap.h>
+#include <folly/Range.h>
 
 #include "mcrouter/AsyncTimer.h"
 
@@ -55,12 +55,34 @@ class ProxyDestinationMap {
       const AccessPoint& ap, std::chrono::milliseconds timeout) const;
   /**
    * If ProxyDestination is already stored in this object - returns it;
-   * otherwise creates a new one.
+   * otherwise creates a new one with up to `numConnections` connections.
+   * Note: pools sharing a destination (same host and timeout) get the
+   * connection count of whichever pool created it first.
    */
   std::shared_ptr<ProxyDestination> emplace(std::shared_ptr<AccessPoint> ap,
                                             std::chrono::milliseconds timeout,
                                             uint64_t qosClass,
-                                            uint64_t qosPath);
+                                            uint64_t qosPath,
+                                            size_t numConnections);
+
+  /**
+   * Holds a strong reference to a destination owned by this map's proxy
+   * on behalf of other proxies' forwarding destinations (see
+   * --shared-destination-connections), so the owner copy is always
+   * destroyed on its own proxy's teardown path rather than by whichever
+   * forwarding proxy drops the last reference to it.
+   */
+  void retainShared(std::shared_ptr<ProxyDestination> destination);
+
+  /**
+   * Queue a rate-limited background warm-up for a newly created
+   * destination: its connection is opened (including any TLS handshake)
+   * and health-checked with a version request before real traffic
+   * arrives. No-op unless --destination-warmup-rate is set.
+   * May be called from any thread; the actual scheduling runs on the
+   * owning proxy's thread.
+   */
+  void scheduleWarmUp(std::shared_ptr<ProxyDestination> destination);
 
   /**
    * Remove destination from both active and inactive lists
@@ -85,6 +107,16 @@ class ProxyDestinationMap {
    */
   void setResetTimer(std::chrono::milliseconds interval);
 
+  /**
+   * Start the background DNS refresh cycle (see
+   * --dns-refresh-interval-ms): every interval, all stored destinations
+   * have their hostname re-resolved in batches and their connections
+   * cycled when the address changed.
+   * @param interval  Full refresh cycle length, should be greater than
+   *                  zero.
+   */
+  void setDnsRefreshTimer(std::chrono::milliseconds interval);
+
   /**
    * Calls f(Key, const ProxyDestination&) for each destination stored
    * in ProxyDestinationMap. The whole map is locked during the call.
@@ -99,9 +131,12 @@ class ProxyDestinationMap {
     std::vector<std::shared_ptr<const ProxyDestination>> toFree;
     {
       std::lock_guard<std::mutex> lock(destinationsLock_);
-      for (auto& it : destinations_) {
-        if (std::shared_ptr<const ProxyDestination> d = it.second.lock()) {
-          f(it.first, *d);
+      for (const auto& slot : slots_) {
+        if (slot.state != kUsedSlot) {
+          continue;
+        }
+        if (std::shared_ptr<const ProxyDestination> d = slot.dest.lock()) {
+          f(destinationKey(*d), *d);
           toFree.push_back(std::move(d));
         }
       }
@@ -112,29 +147,114 @@ class ProxyDestinationMap {
 
  private:
   struct StateList;
+  struct WarmUpState;
+  struct DnsRefreshState;
+
+  enum SlotState : uint8_t {
+    kEmptySlot = 0,
+    kUsedSlot,
+    kTombstoneSlot
+  };
+
+  /**
+   * One slot of the open-addressing table below. Destinations are keyed
+   * by a precomputed hash of their access point (plus timeout for ascii
+   * destinations, mirroring genProxyDestinationKey()); the hash and the
+   * creation-time timeout are kept in the slot so probing rarely has to
+   * lock the weak_ptr.
+   */
+  struct Slot {
+    uint64_t hash{0};
+    int32_t timeoutMs{0};
+    uint8_t state{kEmptySlot};
+    // Raw pointer for identity comparison on erase, when the weak_ptr is
+    // already expired (we get here from ProxyDestination destructor).
+    // Never dereferenced.
+    ProxyDestination* raw{nullptr};
+    std::weak_ptr<ProxyDestination> dest;
+  };
 
   Proxy* proxy_;
-  folly::StringKeyedUnorderedMap<std::weak_ptr<ProxyDestination>> destinations_;
+  std::vector<Slot> slots_;
+  size_t numUsed_{0};     // slots in kUsedSlot state
+  size_t numOccupied_{0}; // used + tombstone slots, drives rehashing
   mutable std::mutex destinationsLock_;
 
   std::unique_ptr<StateList> active_;
   std::unique_ptr<StateList> inactive_;
 
+  // Strong references kept via retainShared(); empty unless
+  // --shared-destination-connections is set.
+  std::vector<std::shared_ptr<ProxyDestination>> sharedRetained_;
+
+  // Routers whose destinations this map's destinations forward to with
+  // --cross-router-shared-destinations; keeping them referenced keeps
+  // the owning proxies (and their connections) alive for our lifetime.
+  std::vector<std::shared_ptr<void>> crossRouterRetained_;
+
   uint32_t inactivityTimeout_;
   std::unique_ptr<AsyncTimer<ProxyDestinationMap>> resetTimer_;
 
+  // Created lazily on first scheduleWarmUp() call.
+  std::unique_ptr<WarmUpState> warmUp_;
+
+  // Created by setDnsRefreshTimer(); null when background DNS refresh
+  // is disabled.
+  std::unique_ptr<DnsRefreshState> dnsRefresh_;
+
   /**
    * If ProxyDestination is already stored in this object - returns it;
    * otherwise, returns nullptr.
    * Note: caller must be holding destionationsLock_.
    */
-  std::shared_ptr<ProxyDestination> find(const std::string& key) const;
+  std::shared_ptr<ProxyDestination> findLocked(
+      uint64_t hash,
+      const AccessPoint& ap,
+      std::chrono::milliseconds timeout) const;
+
+  /**
+   * Inserts destination into the table, growing it if needed.
+   * Note: caller must be holding destionationsLock_.
+   */
+  void insertLocked(uint64_t hash,
+                    std::chrono::milliseconds timeout,
+                    std::shared_ptr<ProxyDestination> destination);
+
+  /**
+   * Removes the slot holding exactly this destination (matched by
+   * pointer identity), leaving a tombstone.
+   * Note: caller must be holding destionationsLock_.
+   */
+  void eraseLocked(uint64_t hash, ProxyDestination& destination);
+
+  /**
+   * Rebuilds the table with capacity for at least minCapacity live
+   * entries, dropping tombstones and expired entries on the way.
+   * Note: caller must be holding destionationsLock_.
+   */
+  void rehashLocked(size_t minCapacity);
+
+  static folly::StringPiece destinationKey(const ProxyDestination& destination);
 
   /**
    * Time callback which clears inactive connections and reschedules the timer.
    */
   void timerCallback();
 
+  /**
+   * Warms up the next batch of queued destinations and reschedules the
+   * warm-up timer while any are left.
+   */
+  void warmUpTick();
+
+  /**
+   * Re-resolves the next batch of destinations (see
+   * ProxyDestination::refreshDns()) and reschedules the refresh timer:
+   * a short delay between batches of the same pass, the full interval
+   * once a pass over the table completes.
+   */
+  void dnsRefreshTick();
+
   friend class AsyncTimer<ProxyDestinationMap>;
 };
 
@@ -43,6 +43,35 @@ class ProxyRequestContextTypedWithCallback
   F f_;
 };
 
+/**
+ * Implementation class for storing the per-reply callback along with a
+ * get batch context.
+ */
+template <class F>
+class ProxyRequestContextGetBatchWithCallback
+    : public ProxyRequestContextGetBatch {
+ public:
+  ProxyRequestContextGetBatchWithCallback(
+      Proxy& pr,
+      std::vector<McGetRequest>&& reqs,
+      F&& f,
+      ProxyRequestPriority priority__)
+      : ProxyRequestContextGetBatch(pr, std::move(reqs), priority__),
+        f_(std::forward<F>(f)) {}
+
+ protected:
+  void sendRepliesImpl(std::vector<McGetReply>&& replies) override final {
+    fiber_local::runWithoutLocals([this, &replies]() {
+      for (size_t i = 0; i < replies.size(); ++i) {
+        f_(i, requests()[i], std::move(replies[i]));
+      }
+    });
+  }
+
+ private:
+  F f_;
+};
+
 constexpr const char* kCommandNotSupportedStr = "Command not supported";
 
 template <class Request>
@@ -182,7 +211,34 @@ std::unique_ptr<ProxyRequestContextTyped<Request>> createProxyRequestContext(
     F&& f,
     ProxyRequestPriority priority) {
   using Type = detail::ProxyRequestContextTypedWithCallback<Request, F>;
-  return folly::make_unique<Type>(pr, req, std::forward<F>(f), priority);
+  /* Contexts are fixed-size per request type and churn once per user
+     request, so they come from the proxy's freelist pool; delete routes
+     the block back through ProxyRequestContext::operator delete. */
+  void* mem = pr.requestContextPool.alloc(sizeof(Type));
+  try {
+    return std::unique_ptr<ProxyRequestContextTyped<Request>>(
+        ::new (mem) Type(pr, req, std::forward<F>(f), priority));
+  } catch (...) {
+    ProxyRequestContextPool::release(mem);
+    throw;
+  }
+}
+
+template <class F>
+std::unique_ptr<ProxyRequestContextGetBatch> createProxyGetBatchContext(
+    Proxy& pr,
+    std::vector<McGetRequest>&& reqs,
+    F&& f,
+    ProxyRequestPriority priority) {
+  using Type = detail::ProxyRequestContextGetBatchWithCallback<F>;
+  void* mem = pr.requestContextPool.alloc(sizeof(Type));
+  try {
+    return std::unique_ptr<ProxyRequestContextGetBatch>(::new (mem) Type(
+        pr, std::move(reqs), std::forward<F>(f), priority));
+  } catch (...) {
+    ProxyRequestContextPool::release(mem);
+    throw;
+  }
 }
 
 } // mcrouter
@@ -13,10 +13,19 @@
 
 #include "mcrouter/McrouterClient.h"
 #include "mcrouter/Proxy.h"
+#include "mcrouter/ProxyRequestContextPool.h"
 #include "mcrouter/config.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
+void* ProxyRequestContext::operator new(size_t size) {
+  return ProxyRequestContextPool::allocUnpooled(size);
+}
+
+void ProxyRequestContext::operator delete(void* ptr) noexcept {
+  ProxyRequestContextPool::release(ptr);
+}
+
 ProxyRequestContext::ProxyRequestContext(
     Proxy& pr,
     ProxyRequestPriority priority__)
@@ -54,6 +63,85 @@ ProxyRequestContext::~ProxyRequestContext() {
   stat_decr_safe(proxy_.stats, proxy_request_num_outstanding_stat);
 }
 
+void ProxyRequestContextGetBatch::sendReplies(
+    std::vector<McGetReply>&& replies) {
+  if (replied_) {
+    return;
+  }
+  replied_ = true;
+  assert(replies.size() == reqs_.size());
+
+  size_t errors = 0;
+  for (const auto& reply : replies) {
+    if (mc_res_is_err(reply.result())) {
+      ++errors;
+    }
+  }
+
+  sendRepliesImpl(std::move(replies));
+
+  const auto n = reqs_.size();
+  stat_incr(proxy().stats, request_replied_stat, n);
+  stat_incr(proxy().stats, request_replied_count_stat, n);
+  if (errors > 0) {
+    stat_incr(proxy().stats, request_error_stat, errors);
+    stat_incr(proxy().stats, request_error_count_stat, errors);
+  }
+  if (n > errors) {
+    stat_incr(proxy().stats, request_success_stat, n - errors);
+    stat_incr(proxy().stats, request_success_count_stat, n - errors);
+  }
+}
+
+void ProxyRequestContextGetBatch::sendReplies(mc_res_t result) {
+  std::vector<McGetReply> replies;
+  replies.reserve(reqs_.size());
+  for (size_t i = 0; i < reqs_.size(); ++i) {
+    replies.emplace_back(result);
+  }
+  sendReplies(std::move(replies));
+}
+
+void ProxyRequestContextGetBatch::startProcessing() {
+  std::unique_ptr<ProxyRequestContextGetBatch> self(this);
+
+  if (proxy().being_destroyed) {
+    /* We can't process this, since 1) we destroyed the config already,
+       and 2) the clients are winding down, so we wouldn't get any
+       meaningful response back anyway. */
+    LOG(ERROR) << "Outstanding request on a proxy that's being destroyed";
+    sendReplies(mc_res_unknown);
+    return;
+  }
+
+  proxy().dispatchGetBatch(std::move(self));
+}
+
+ProxyRequestContextGetBatch::~ProxyRequestContextGetBatch() {
+  /* The base destructor releases a single processing slot, but a batch
+     occupies one per member request (see Proxy::processGetBatch). */
+  if (processing_ && reqs_.size() > 1) {
+    const auto extra = reqs_.size() - 1;
+    proxy().numRequestsProcessing_ -= extra;
+    stat_decr(proxy().stats, proxy_reqs_processing_stat, extra);
+  }
+}
+
+std::shared_ptr<ProxyRequestContextGetBatch>
+ProxyRequestContextGetBatch::process(
+    std::unique_ptr<ProxyRequestContextGetBatch> preq,
+    std::shared_ptr<const ProxyConfig> config) {
+
+  preq->config_ = std::move(config);
+  return std::shared_ptr<ProxyRequestContextGetBatch>(
+      preq.release(),
+      /* Delete on main context for the same reason as
+         ProxyRequestContextTyped::process. */
+      [](ProxyRequestContext* ctx) {
+        folly::fibers::runInMainContext([ctx] { delete ctx; });
+      });
+}
+
 uint64_t ProxyRequestContext::senderId() const {
   uint64_t id = 0;
   if (requester_) {
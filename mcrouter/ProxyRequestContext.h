@@ -11,12 +11,16 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <folly/fibers/FiberManager.h>
+#include <folly/Likely.h>
 
 #include "mcrouter/config-impl.h"
 #include "mcrouter/config.h"
 #include "mcrouter/lib/McRequestList.h"
+#include "mcrouter/lib/network/AccessPoint.h"
+#include "mcrouter/lib/network/gen/Memcache.h"
 #include "mcrouter/lib/RequestLoggerContext.h"
 #include "mcrouter/ProxyConfig.h"
 #include "mcrouter/ProxyRequestLogger.h"
@@ -25,8 +29,6 @@
 namespace facebook {
 namespace memcache {
 
-struct AccessPoint;
-
 namespace mcrouter {
 
 class McrouterClient;
@@ -77,6 +79,16 @@ public:
 
   virtual ~ProxyRequestContext();
 
+  /**
+   * Contexts are allocated through the owning proxy's
+   * ProxyRequestContextPool (see createProxyRequestContext); the pool
+   * header on each block lets delete route the memory back to the right
+   * pool. Plain new (e.g. recording contexts) goes to the heap through
+   * the same release-compatible path.
+   */
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr) noexcept;
+
   Proxy& proxy() const {
     return proxy_;
   }
@@ -137,19 +149,38 @@ public:
       return;
     }
 
-    RequestLoggerContext loggerContext(
-        poolName,
-        ap,
-        strippedRoutingPrefix,
-        request,
-        reply,
-        startTimeUs,
-        endTimeUs,
-        replyStatsContext);
     assert(logger_.hasValue());
-    logger_->log<Request>(loggerContext);
+    logger_->log<Request>(reply.result(), startTimeUs, endTimeUs);
+    const auto slowThresholdUs =
+        proxy_.router().opts().slow_request_threshold_us;
+    if (UNLIKELY(slowThresholdUs > 0 &&
+                 endTimeUs - startTimeUs >=
+                     static_cast<int64_t>(slowThresholdUs))) {
+      proxy_.slowRequests.record(SlowRequestRecorder::Entry{
+          startTimeUs,
+          endTimeUs - startTimeUs,
+          request.key().routingKeyHash(),
+          Request::name,
+          reply.result(),
+          poolName,
+          ap.toHostPortString()});
+    }
     assert(additionalLogger_.hasValue());
-    additionalLogger_->log(loggerContext);
+    if (additionalLogger_->shouldLog()) {
+      /* Materialized only for sampled replies: the context eagerly
+         captures string views and the routing key hash, which is too
+         much work to do on every request just in case */
+      RequestLoggerContext loggerContext(
+          poolName,
+          ap,
+          strippedRoutingPrefix,
+          request,
+          reply,
+          startTimeUs,
+          endTimeUs,
+          replyStatsContext);
+      additionalLogger_->log(loggerContext);
+    }
   }
 
   /**
@@ -255,6 +286,7 @@ public:
 private:
   friend class McrouterClient;
   friend class Proxy;
+  friend class ProxyRequestContextGetBatch;
 };
 
 template <class Request>
@@ -309,6 +341,59 @@ class ProxyRequestContextTyped : public ProxyRequestContext {
   const Request* req_;
 };
 
+/**
+ * Context for a whole batch of get requests dispatched through the
+ * route tree together.  The standalone server collects the gets parsed
+ * from a single read event and sends them as one batch, so the batch
+ * takes one trip through request dispatch and one top-level fiber task
+ * instead of one per key (see ProxyRoute::route(std::vector<...>)).
+ *
+ * Replies are delivered per request through sendReplies(); the context
+ * counts as replied once every member has its reply.
+ */
+class ProxyRequestContextGetBatch : public ProxyRequestContext {
+ public:
+  std::vector<McGetRequest>& requests() {
+    return reqs_;
+  }
+
+  /**
+   * Delivers one reply for each request of the batch.  replies must
+   * have exactly one entry per request, in request order.
+   */
+  void sendReplies(std::vector<McGetReply>&& replies);
+
+  /**
+   * Convenience overload replying to every request of the batch with
+   * the same result.
+   */
+  void sendReplies(mc_res_t result);
+
+  void startProcessing() override final;
+
+  ~ProxyRequestContextGetBatch() override;
+
+  /**
+   * Internally converts the context into one ready to route,
+   * mirroring ProxyRequestContextTyped::process().
+   */
+  static std::shared_ptr<ProxyRequestContextGetBatch> process(
+      std::unique_ptr<ProxyRequestContextGetBatch> preq,
+      std::shared_ptr<const ProxyConfig> config);
+
+ protected:
+  ProxyRequestContextGetBatch(
+      Proxy& pr,
+      std::vector<McGetRequest>&& reqs,
+      ProxyRequestPriority priority__)
+      : ProxyRequestContext(pr, priority__), reqs_(std::move(reqs)) {}
+
+  virtual void sendRepliesImpl(std::vector<McGetReply>&& replies) = 0;
+
+ private:
+  std::vector<McGetRequest> reqs_;
+};
+
 /**
  * Creates a new proxy request context
  */
@@ -318,6 +403,19 @@ std::unique_ptr<ProxyRequestContextTyped<Request>> createProxyRequestContext(
     const Request& req,
     F&& f,
     ProxyRequestPriority priority = ProxyRequestPriority::kCritical);
+
+/**
+ * Creates a new proxy context for a batch of get requests.
+ *
+ * @param f  callback invoked once per request as
+ *           f(size_t idx, const McGetRequest&, McGetReply&&)
+ */
+template <class F>
+std::unique_ptr<ProxyRequestContextGetBatch> createProxyGetBatchContext(
+    Proxy& pr,
+    std::vector<McGetRequest>&& reqs,
+    F&& f,
+    ProxyRequestPriority priority = ProxyRequestPriority::kCritical);
 }}}  // facebook::memcache::mcrouter
 
 #include "ProxyRequestContext-inl.h"
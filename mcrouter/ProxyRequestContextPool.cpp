@@ -0,0 +1,98 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "ProxyRequestContextPool.h"
+
+#include <new>
+
+namespace facebook {
+namespace memcache {
+namespace mcrouter {
+
+constexpr size_t ProxyRequestContextPool::kBlockAlign;
+constexpr size_t ProxyRequestContextPool::kNumBuckets;
+constexpr size_t ProxyRequestContextPool::kMaxFreePerBucket;
+
+static_assert(sizeof(ProxyRequestContextPool*) + sizeof(size_t) <= 64,
+              "Header must fit in one kBlockAlign unit");
+
+ProxyRequestContextPool::~ProxyRequestContextPool() {
+  for (auto& list : free_) {
+    for (auto block : list) {
+      ::operator delete(block);
+    }
+  }
+}
+
+void* ProxyRequestContextPool::alloc(size_t size) {
+  const size_t total = size + sizeof(Header);
+  const size_t bucket = (total + kBlockAlign - 1) / kBlockAlign - 1;
+  if (bucket >= kNumBuckets) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return allocUnpooled(size);
+  }
+
+  void* block = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto& list = free_[bucket];
+    if (!list.empty()) {
+      block = list.back();
+      list.pop_back();
+    }
+  }
+
+  if (block != nullptr) {
+    hits_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    block = ::operator new((bucket + 1) * kBlockAlign);
+  }
+
+  auto header = static_cast<Header*>(block);
+  header->pool = this;
+  header->bucket = bucket;
+  return header + 1;
+}
+
+void* ProxyRequestContextPool::allocUnpooled(size_t size) {
+  auto header =
+      static_cast<Header*>(::operator new(size + sizeof(Header)));
+  header->pool = nullptr;
+  header->bucket = 0;
+  return header + 1;
+}
+
+void ProxyRequestContextPool::release(void* ptr) noexcept {
+  if (ptr == nullptr) {
+    return;
+  }
+  auto header = static_cast<Header*>(ptr) - 1;
+  if (auto pool = header->pool) {
+    pool->recycle(header, header->bucket);
+  } else {
+    ::operator delete(header);
+  }
+}
+
+void ProxyRequestContextPool::recycle(void* block, size_t bucket) noexcept {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto& list = free_[bucket];
+    if (list.size() < kMaxFreePerBucket) {
+      list.push_back(block);
+      return;
+    }
+  }
+  ::operator delete(block);
+}
+
+} // mcrouter
+} // memcache
+} // facebook
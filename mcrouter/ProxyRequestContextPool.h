@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace facebook {
+namespace memcache {
+namespace mcrouter {
+
+/**
+ * Size-bucketed freelist for ProxyRequestContext allocations.
+ *
+ * Every user request allocates one context and frees it when the last
+ * reply comes back, so at high qps this type alone costs millions of
+ * malloc/free pairs per second. Contexts are fixed-size per request
+ * type, so a recycled block is immediately reusable. A context is
+ * allocated on the caller's thread and freed on the proxy thread; the
+ * freelists are guarded by a mutex, which is much cheaper than a heap
+ * round trip and only contended across that handoff.
+ *
+ * Each block carries a small header pointing back to its pool, so
+ * release() doesn't need to know which proxy the context belonged to.
+ * Blocks larger than the biggest bucket (or allocated without a pool,
+ * e.g. recording contexts) fall through to the heap with a null pool in
+ * the header.
+ */
+class ProxyRequestContextPool {
+ public:
+  ProxyRequestContextPool() = default;
+  ~ProxyRequestContextPool();
+
+  // non-copyable
+  ProxyRequestContextPool(const ProxyRequestContextPool&) = delete;
+  ProxyRequestContextPool& operator=(const ProxyRequestContextPool&) = delete;
+
+  /**
+   * Returns memory for an object of the given size, reusing a recycled
+   * block when one is available. Safe to call from any thread.
+   */
+  void* alloc(size_t size);
+
+  /**
+   * Like alloc(), but always from the heap; the block is still
+   * release()-compatible. Used when there's no proxy (and thus no pool)
+   * to allocate from.
+   */
+  static void* allocUnpooled(size_t size);
+
+  /**
+   * Returns a block obtained from alloc()/allocUnpooled() to its pool
+   * (or the heap). Safe to call from any thread.
+   */
+  static void release(void* ptr) noexcept;
+
+  /**
+   * Pool hit/miss counters, for stats reporting.
+   */
+  uint64_t hits() const {
+    return hits_.load(std::memory_order_relaxed);
+  }
+  uint64_t misses() const {
+    return misses_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Header {
+    ProxyRequestContextPool* pool;
+    size_t bucket;
+  };
+
+  /* Bucket granularity; also keeps the object after the header aligned. */
+  static constexpr size_t kBlockAlign = 64;
+  /* Pools blocks of up to kNumBuckets * kBlockAlign bytes (header
+     included); larger contexts go to the heap. */
+  static constexpr size_t kNumBuckets = 16;
+  /* Bound on recycled blocks kept per bucket, to cap idle memory. */
+  static constexpr size_t kMaxFreePerBucket = 1024;
+
+  std::mutex mutex_;
+  std::array<std::vector<void*>, kNumBuckets> free_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+
+  void recycle(void* block, size_t bucket) noexcept;
+};
+
+} // mcrouter
+} // memcache
+} // facebook
@@ -103,13 +103,16 @@ inline void logRequestClass(Proxy& proxy) {
 } // detail
 
 template <class Request>
-void ProxyRequestLogger::log(const RequestLoggerContext& loggerContext) {
-  const auto durationUs = loggerContext.endTimeUs - loggerContext.startTimeUs;
+void ProxyRequestLogger::log(
+    mc_res_t replyResult,
+    int64_t startTimeUs,
+    int64_t endTimeUs) {
+  const auto durationUs = endTimeUs - startTimeUs;
   bool isOutlier =
       proxy_->getRouterOptions().logging_rtt_outlier_threshold_us > 0 &&
       durationUs >= proxy_->getRouterOptions().logging_rtt_outlier_threshold_us;
 
-  logError(loggerContext.replyResult);
+  logError(replyResult);
   detail::logRequestClass<Request>(*proxy_);
   proxy_->durationUs.insertSample(durationUs);
 
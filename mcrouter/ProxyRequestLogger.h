@@ -16,14 +16,18 @@ namespace memcache {
 namespace mcrouter {
 
 class Proxy;
-struct RequestLoggerContext;
 
 class ProxyRequestLogger {
  public:
   explicit ProxyRequestLogger(Proxy* proxy) : proxy_(proxy) {}
 
+  /**
+   * Records error/request-class/duration stats for one reply.  Takes
+   * the few values it needs directly so the caller doesn't have to
+   * materialize a full RequestLoggerContext on the per-request path.
+   */
   template <class Request>
-  void log(const RequestLoggerContext& loggerContext);
+  void log(mc_res_t replyResult, int64_t startTimeUs, int64_t endTimeUs);
 
  protected:
   Proxy* proxy_;
@@ -9,6 +9,9 @@
  */
 #include "ProxyThread.h"
 
+#include <algorithm>
+#include <chrono>
+
 #include <folly/io/async/EventBase.h>
 
 #include "mcrouter/McrouterInstance.h"
@@ -40,18 +43,61 @@ void ProxyThread::stopAndJoin() noexcept {
 
 void ProxyThread::proxyThreadRun() {
   mcrouterSetThisThreadName(proxy_->router().opts(), "mcrpxy");
+  if (proxy_->router().opts().numa_aware) {
+    /* Bind before the fiber manager and caches allocate anything, so
+       first-touch places them on the local node. */
+    mcrouterBindThisThreadToNumaNode(proxy_->getId());
+  }
+
+  if (proxy_->router().opts().proxy_busy_loop) {
+    busyLoopRun();
+  } else {
+    while (state_ == State::RUNNING || proxy_->fiberManager.hasTasks()) {
+      evb_.loopOnce();
+      proxy_->drainMessageQueue();
+    }
+
+    while (state_ != State::STOPPED) {
+      evb_.loopOnce();
+    }
+  }
+
+  /* make sure proxy is deleted on the proxy thread */
+  proxy_.reset();
+}
+
+void ProxyThread::busyLoopRun() {
+  /* Trade a core for wakeup latency: poll the event base and the message
+     queue without ever blocking in epoll_wait.  After kIdleSpinUs with no
+     observed work, back off with a sleep that doubles up to kMaxSleepUs so
+     an idle proxy doesn't pin its CPU; any sign of work resets the spin. */
+  constexpr int64_t kIdleSpinUs = 200;
+  constexpr int64_t kMinSleepUs = 1;
+  constexpr int64_t kMaxSleepUs = 1000;
+
+  int64_t sleepUs = kMinSleepUs;
+  int64_t lastWorkUs = nowUs();
 
   while (state_ == State::RUNNING || proxy_->fiberManager.hasTasks()) {
-    evb_.loopOnce();
+    evb_.loopOnce(EVLOOP_NONBLOCK);
     proxy_->drainMessageQueue();
+
+    if (proxy_->fiberManager.hasTasks() || proxy_->queueDepth() > 0) {
+      lastWorkUs = nowUs();
+      sleepUs = kMinSleepUs;
+      continue;
+    }
+    if (nowUs() - lastWorkUs > kIdleSpinUs) {
+      /* sleep_for rather than yield: with a dedicated core there is
+         nothing to yield to, and the kernel rounds these up anyway */
+      std::this_thread::sleep_for(std::chrono::microseconds(sleepUs));
+      sleepUs = std::min(sleepUs * 2, kMaxSleepUs);
+    }
   }
 
   while (state_ != State::STOPPED) {
-    evb_.loopOnce();
+    evb_.loopOnce(EVLOOP_NONBLOCK);
   }
-
-  /* make sure proxy is deleted on the proxy thread */
-  proxy_.reset();
 }
 
 }}}  // facebook::memcache::mcrouter
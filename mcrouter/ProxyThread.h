@@ -60,6 +60,13 @@ class ProxyThread {
 
   void stopAwriterThreads();
   void proxyThreadRun();
+
+  /**
+   * Body of proxyThreadRun() when proxy_busy_loop is set: polls the
+   * event base without blocking, backing off with short adaptive sleeps
+   * after idle windows.
+   */
+  void busyLoopRun();
 };
 
 
@@ -9,20 +9,26 @@
  */
 #include "ServiceInfo.h"
 
+#include <algorithm>
 #include <functional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include <folly/experimental/StringKeyedUnorderedMap.h>
 #include <folly/Format.h>
 #include <folly/json.h>
 #include <folly/Memory.h>
 #include <folly/Range.h>
 
+#include "mcrouter/LatencyHistogram.h"
 #include "mcrouter/McrouterFiberContext.h"
 #include "mcrouter/McrouterInstance.h"
 #include "mcrouter/Proxy.h"
 #include "mcrouter/ProxyConfigBuilder.h"
+#include "mcrouter/ProxyDestination.h"
+#include "mcrouter/ProxyDestinationMap.h"
+#include "mcrouter/SlowRequestRecorder.h"
 #include "mcrouter/config-impl.h"
 #include "mcrouter/config.h"
 #include "mcrouter/lib/McRequestList.h"
@@ -36,6 +42,10 @@
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
+/* Bound on cached route_handles replies, so introspection can not grow
+   memory without limit when queried with many distinct keys. */
+constexpr size_t kMaxRouteHandlesCacheEntries = 1000;
+
 struct ServiceInfo::ServiceInfoImpl {
   Proxy* proxy_;
   ProxyRoute& proxyRoute_;
@@ -43,6 +53,12 @@ struct ServiceInfo::ServiceInfoImpl {
     std::string,
     std::function<std::string(const std::vector<folly::StringPiece>& args)>>
   commands_;
+  /**
+   * route_handles replies by "op:key". Traversal is deterministic for a
+   * given config and this object lives as long as one config, so entries
+   * never go stale.
+   */
+  std::unordered_map<std::string, std::string> routeHandlesCache_;
 
   ServiceInfoImpl(Proxy* proxy, const ProxyConfig& config);
 
@@ -274,8 +290,17 @@ ServiceInfo::ServiceInfoImpl::ServiceInfoImpl(
       auto op = args[0];
       auto key = args[1];
 
-      return routeHandlesCommandHelper(op, key, proxyRoute_,
-                                       McOpList::LastItem());
+      auto cacheKey = folly::to<std::string>(op, ':', key);
+      auto cacheIt = routeHandlesCache_.find(cacheKey);
+      if (cacheIt != routeHandlesCache_.end()) {
+        return cacheIt->second;
+      }
+      auto tree = routeHandlesCommandHelper(op, key, proxyRoute_,
+                                            McOpList::LastItem());
+      if (routeHandlesCache_.size() < kMaxRouteHandlesCacheEntries) {
+        routeHandlesCache_.emplace(std::move(cacheKey), tree);
+      }
+      return tree;
     }
   );
 
@@ -309,6 +334,139 @@ ServiceInfo::ServiceInfoImpl::ServiceInfoImpl(
     }
   );
 
+  commands_.emplace("destinations",
+    [this] (const std::vector<folly::StringPiece>& args) {
+      /* One compact row per destination, aggregated over all proxies,
+         keyed the same way as the "stats servers" group. Counters come
+         from tracking the destinations already do, so a poll only walks
+         the destination maps. */
+      struct Row {
+        uint64_t requests{0};
+        uint64_t errors{0};
+        LatencyHistogram latencyUs;
+      };
+      folly::StringKeyedUnorderedMap<Row> rows;
+      auto& router = proxy_->router();
+      for (size_t i = 0; i < router.opts().num_proxies; ++i) {
+        router.getProxy(i)->destinationMap->foreachDestinationSynced(
+          [&rows](folly::StringPiece key, const ProxyDestination& pdstn) {
+            auto& row = rows[key];
+            if (pdstn.stats().results) {
+              for (size_t j = 0; j < mc_nres; ++j) {
+                row.requests += (*pdstn.stats().results)[j];
+                if (mc_res_is_err(static_cast<mc_res_t>(j))) {
+                  row.errors += (*pdstn.stats().results)[j];
+                }
+              }
+            }
+            row.latencyUs.merge(pdstn.stats().latencyHistogramUs);
+          });
+      }
+      folly::dynamic blob = folly::dynamic::object;
+      for (const auto& it : rows) {
+        blob[it.first] = folly::dynamic::object
+            ("requests", it.second.requests)
+            ("errors", it.second.errors)
+            ("p99_latency_us",
+             it.second.latencyUs.count() == 0
+                 ? 0.0
+                 : it.second.latencyUs.getPercentile(99));
+      }
+      return folly::to<std::string>(folly::toJson(blob));
+    }
+  );
+
+  commands_.emplace("hot_keys",
+    [this] (const std::vector<folly::StringPiece>& args) {
+      /* Merge the per-proxy top-K snapshots: the same key can be hot
+         on several proxies, so its decayed rate estimates add up.
+         Snapshots are published by the proxy threads, so a poll never
+         touches the live sketches. */
+      std::unordered_map<std::string, double> merged;
+      auto& router = proxy_->router();
+      for (size_t i = 0; i < router.opts().num_proxies; ++i) {
+        for (auto& hotKey : router.getProxy(i)->hotKeys.snapshot()) {
+          merged[hotKey.key] += hotKey.estimatedQps;
+        }
+      }
+      std::vector<std::pair<std::string, double>> sorted(
+        merged.begin(), merged.end());
+      std::sort(sorted.begin(), sorted.end(),
+                [](const std::pair<std::string, double>& a,
+                   const std::pair<std::string, double>& b) {
+                  return a.second > b.second;
+                });
+      folly::dynamic blob = folly::dynamic::array;
+      for (const auto& it : sorted) {
+        blob.push_back(folly::dynamic::object
+            ("key", it.first)
+            ("estimated_qps", it.second));
+      }
+      return folly::to<std::string>(folly::toJson(blob));
+    }
+  );
+
+  commands_.emplace("slow_requests",
+    [this] (const std::vector<folly::StringPiece>& args) {
+      /* Concatenate the per-proxy flight recorder rings (see
+         --slow-request-threshold-us), oldest first across all proxies,
+         so a latency spike can be lined up against what the slow
+         requests actually did. */
+      std::vector<SlowRequestRecorder::Entry> entries;
+      auto& router = proxy_->router();
+      for (size_t i = 0; i < router.opts().num_proxies; ++i) {
+        auto snapshot = router.getProxy(i)->slowRequests.snapshot();
+        entries.insert(entries.end(),
+                       std::make_move_iterator(snapshot.begin()),
+                       std::make_move_iterator(snapshot.end()));
+      }
+      std::sort(entries.begin(), entries.end(),
+                [](const SlowRequestRecorder::Entry& a,
+                   const SlowRequestRecorder::Entry& b) {
+                  return a.startTimeUs < b.startTimeUs;
+                });
+      folly::dynamic blob = folly::dynamic::array;
+      for (const auto& entry : entries) {
+        blob.push_back(folly::dynamic::object
+            ("start_time_us", entry.startTimeUs)
+            ("duration_us", entry.durationUs)
+            ("operation", entry.requestName)
+            ("routing_key_hash", entry.routingKeyHash)
+            ("pool", entry.poolName)
+            ("destination", entry.destination)
+            ("result", mc_res_to_string(entry.result)));
+      }
+      return folly::to<std::string>(folly::toJson(blob));
+    }
+  );
+
+  commands_.emplace("fiber_stacks",
+    [this] (const std::vector<folly::StringPiece>& args) {
+      /* Per-proxy fiber stack telemetry for right-sizing
+         fibers-stack-size: the high watermark is sampled every
+         fibers-record-stack-size-every fibers (see the FiberManager
+         options), so it converges as traffic goes through. */
+      auto& router = proxy_->router();
+      folly::dynamic blob = folly::dynamic::object
+          ("configured_stack_size", router.opts().fibers_stack_size)
+          ("record_stack_size_every",
+           router.opts().fibers_record_stack_size_every);
+      folly::dynamic proxies = folly::dynamic::array;
+      size_t highWatermark = 0;
+      for (size_t i = 0; i < router.opts().num_proxies; ++i) {
+        auto& fm = router.getProxy(i)->fiberManager;
+        proxies.push_back(folly::dynamic::object
+            ("fibers_allocated", fm.fibersAllocated())
+            ("fibers_pool_size", fm.fibersPoolSize())
+            ("stack_high_watermark", fm.stackHighWatermark()));
+        highWatermark = std::max(highWatermark, fm.stackHighWatermark());
+      }
+      blob["stack_high_watermark"] = highWatermark;
+      blob["proxies"] = std::move(proxies);
+      return folly::to<std::string>(folly::toJson(blob));
+    }
+  );
+
   commands_.emplace("hostid",
     [] (const std::vector<folly::StringPiece>& args) {
       return folly::to<std::string>(globals::hostid());
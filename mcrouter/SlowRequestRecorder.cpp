@@ -0,0 +1,37 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "SlowRequestRecorder.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+constexpr size_t SlowRequestRecorder::kEntries;
+
+void SlowRequestRecorder::record(Entry entry) {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (ring_.size() < kEntries) {
+    ring_.push_back(std::move(entry));
+  } else {
+    ring_[next_] = std::move(entry);
+    next_ = (next_ + 1) % kEntries;
+  }
+}
+
+std::vector<SlowRequestRecorder::Entry> SlowRequestRecorder::snapshot() const {
+  std::lock_guard<std::mutex> guard(lock_);
+  std::vector<Entry> result;
+  result.reserve(ring_.size());
+  /* next_ is the oldest entry once the ring has wrapped */
+  for (size_t i = 0; i < ring_.size(); ++i) {
+    result.push_back(ring_[(next_ + i) % ring_.size()]);
+  }
+  return result;
+}
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,63 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "mcrouter/lib/mc/msg.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * In-memory flight recorder for slow requests.
+ *
+ * Keeps the last kEntries compact summaries of replies that exceeded
+ * --slow-request-threshold-us, so a p999 spike can be reconstructed
+ * after the fact instead of guessed at from aggregate stats.  Fast
+ * requests pay only the threshold comparison in onReplyReceived();
+ * only requests already known to be slow reach record(), so its brief
+ * critical section is never on the hot path.
+ *
+ * snapshot() hands out a copy of the ring and is safe from any thread
+ * (the "slow_requests" ServiceInfo command polls all proxies).
+ */
+class SlowRequestRecorder {
+ public:
+  struct Entry {
+    /** When the destination request was sent, from nowUs(). */
+    int64_t startTimeUs;
+    int64_t durationUs;
+    uint32_t routingKeyHash;
+    /** Request::name; points at static storage. */
+    const char* requestName;
+    mc_res_t result;
+    std::string poolName;
+    std::string destination; ///< host:port the request was sent to
+  };
+
+  /** Records one slow reply, evicting the oldest entry once full. */
+  void record(Entry entry);
+
+  /** The recorded entries, oldest first. */
+  std::vector<Entry> snapshot() const;
+
+ private:
+  static constexpr size_t kEntries = 256;
+
+  mutable std::mutex lock_;
+  std::vector<Entry> ring_;
+  /** Index the next entry overwrites once the ring is full */
+  size_t next_{0};
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,135 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "StatsBinaryLog.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include <folly/json.h>
+
+#include "mcrouter/options.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+constexpr uint64_t StatsBinaryLog::kMagic;
+constexpr uint32_t StatsBinaryLog::kVersion;
+constexpr uint32_t StatsBinaryLog::kNumRecords;
+
+namespace {
+
+size_t alignUp(size_t n, size_t alignment) {
+  return (n + alignment - 1) / alignment * alignment;
+}
+
+} // anonymous namespace
+
+StatsBinaryLog::StatsBinaryLog(const std::string& path,
+                               const std::vector<stat_t>& statsTemplate,
+                               const McrouterOptions& opts) {
+  folly::dynamic names = folly::dynamic::array;
+  for (size_t i = 0; i < statsTemplate.size(); ++i) {
+    if (!(statsTemplate[i].group & ods_stats)) {
+      continue;
+    }
+    if (opts.logging_rtt_outlier_threshold_us == 0 &&
+        (statsTemplate[i].group & outlier_stats)) {
+      // outlier detection is disabled
+      continue;
+    }
+    if (statsTemplate[i].type != stat_uint64 &&
+        statsTemplate[i].type != stat_int64 &&
+        statsTemplate[i].type != stat_double) {
+      continue;
+    }
+    indices_.push_back(i);
+    names.push_back(statsTemplate[i].name.str());
+  }
+
+  auto metadata = folly::to<std::string>(folly::toJson(names));
+  const size_t numStats = indices_.size();
+  recordSize_ = alignUp(2 * sizeof(uint64_t) + numStats * sizeof(uint64_t) +
+                        numStats, sizeof(uint64_t));
+  const size_t recordsOffset =
+      alignUp(sizeof(Header) + metadata.size(), 4096);
+  fileSize_ = recordsOffset + static_cast<size_t>(kNumRecords) * recordSize_;
+
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    PLOG(ERROR) << "Can't create binary stats log " << path;
+    return;
+  }
+  if (::ftruncate(fd, fileSize_) != 0) {
+    PLOG(ERROR) << "Can't size binary stats log " << path;
+    ::close(fd);
+    return;
+  }
+  void* buf =
+      ::mmap(nullptr, fileSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (buf == MAP_FAILED) {
+    PLOG(ERROR) << "Can't mmap binary stats log " << path;
+    return;
+  }
+
+  buf_ = static_cast<char*>(buf);
+  header_ = reinterpret_cast<Header*>(buf_);
+  records_ = buf_ + recordsOffset;
+
+  header_->magic = kMagic;
+  header_->version = kVersion;
+  header_->recordsOffset = recordsOffset;
+  header_->metadataOffset = sizeof(Header);
+  header_->metadataSize = metadata.size();
+  header_->recordSize = recordSize_;
+  header_->numRecords = kNumRecords;
+  header_->numStats = numStats;
+  header_->pad = 0;
+  header_->nextSeq = 0;
+  ::memcpy(buf_ + sizeof(Header), metadata.data(), metadata.size());
+}
+
+StatsBinaryLog::~StatsBinaryLog() {
+  if (buf_ != nullptr) {
+    ::munmap(buf_, fileSize_);
+  }
+}
+
+void StatsBinaryLog::append(const std::vector<stat_t>& stats,
+                            uint64_t timeMs) {
+  if (buf_ == nullptr) {
+    return;
+  }
+
+  char* record = records_ + (seq_ % kNumRecords) * recordSize_;
+  uint64_t* values = reinterpret_cast<uint64_t*>(record) + 2;
+  uint8_t* types = reinterpret_cast<uint8_t*>(values + indices_.size());
+
+  reinterpret_cast<uint64_t*>(record)[1] = timeMs;
+  for (size_t i = 0; i < indices_.size(); ++i) {
+    const auto& stat = stats[indices_[i]];
+    values[i] = stat.data.uint64;
+    types[i] = static_cast<uint8_t>(stat.type);
+  }
+
+  ++seq_;
+  // Publish the record; readers treat a slot as valid only once its
+  // sequence number is in the live window.
+  __atomic_store_n(reinterpret_cast<uint64_t*>(record), seq_,
+                   __ATOMIC_RELEASE);
+  __atomic_store_n(&header_->nextSeq, seq_, __ATOMIC_RELEASE);
+}
+
+}}} // facebook::memcache::mcrouter
@@ -0,0 +1,105 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mcrouter/stats.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+class McrouterOptions;
+
+/**
+ * Append-only mmap'd ring of fixed-size binary stat records, replacing
+ * the per-interval JSON stats dump. Appending is a handful of memcpys
+ * into the mapping: no allocation, no serialization and no rename, so
+ * the logger thread holds the prepared stats for microseconds instead
+ * of milliseconds, and the on-disk footprint is fixed.
+ *
+ * File layout (all integers little-endian, native):
+ *   [Header]            fixed struct, see below
+ *   [metadata]          JSON: {"names": [...]} for the logged stats, in
+ *                       record order
+ *   [records]           numRecords slots, each recordSize bytes,
+ *                       starting at recordsOffset
+ *
+ * Record layout:
+ *   uint64_t seq        1-based; 0 means the slot was never written.
+ *                       Written last, so a reader seeing seq within
+ *                       (nextSeq - numRecords, nextSeq] knows the slot
+ *                       is complete and not yet overwritten.
+ *   uint64_t timeMs     wall clock of the snapshot
+ *   uint64_t values[n]  raw 8-byte stat values
+ *   uint8_t  types[n]   stat_type_t of each value, then padding
+ *
+ * Use tools/mcstatsdump to convert a log back to JSON lines.
+ *
+ * Single-writer (the McrouterLogger thread); readers open the file
+ * read-only and never coordinate with the writer.
+ */
+class StatsBinaryLog {
+ public:
+  struct Header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t recordsOffset;
+    uint32_t metadataOffset;
+    uint32_t metadataSize;
+    uint32_t recordSize;
+    uint32_t numRecords;
+    uint32_t numStats;
+    uint32_t pad;
+    uint64_t nextSeq;
+  };
+
+  static constexpr uint64_t kMagic = 0x003174617453634dULL; // "McStat1\0"
+  static constexpr uint32_t kVersion = 1;
+  static constexpr uint32_t kNumRecords = 4096;
+
+  /**
+   * Creates (truncating any previous log) an empty ring at `path`,
+   * logging the stats write_stats_to_disk used to dump: the ods_stats
+   * group, minus outlier stats when outlier detection is off and minus
+   * non-numeric stats.  On any failure the log is left uninitialized
+   * and append() is a no-op; the error is logged once.
+   */
+  StatsBinaryLog(const std::string& path,
+                 const std::vector<stat_t>& statsTemplate,
+                 const McrouterOptions& opts);
+  ~StatsBinaryLog();
+
+  StatsBinaryLog(const StatsBinaryLog&) = delete;
+  StatsBinaryLog& operator=(const StatsBinaryLog&) = delete;
+
+  bool initialized() const {
+    return buf_ != nullptr;
+  }
+
+  /**
+   * Appends one snapshot. `stats` must have the same layout as the
+   * template the log was created with.
+   */
+  void append(const std::vector<stat_t>& stats, uint64_t timeMs);
+
+ private:
+  char* buf_{nullptr};
+  size_t fileSize_{0};
+  Header* header_{nullptr};
+  char* records_{nullptr};
+  uint32_t recordSize_{0};
+  uint64_t seq_{0};
+  // Indices into the stats vector of the logged stats, in record order.
+  std::vector<size_t> indices_;
+};
+
+}}} // facebook::memcache::mcrouter
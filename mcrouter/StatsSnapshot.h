@@ -0,0 +1,58 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Last published rendering of the stats, for cheap high-frequency reads.
+ *
+ * The stats logger thread renders the aggregated stats once per logging
+ * interval and publishes them here; the "stats snapshot" admin command is
+ * served from the published copy without touching any proxy-thread locks,
+ * so it is safe to scrape at high frequency. Publication swaps a pointer
+ * to an immutable buffer, and the previous buffer stays alive while
+ * readers still hold it, so readers never block the writer (or each
+ * other) and never observe a buffer being filled.
+ */
+class StatsSnapshot {
+ public:
+  using Data = std::vector<std::pair<std::string, std::string>>;
+
+  /**
+   * Publishes a new snapshot. Must be called from one thread at a time
+   * (in practice, only the stats logger thread).
+   */
+  void publish(Data entries) {
+    std::atomic_store_explicit(
+        &current_,
+        std::shared_ptr<const Data>(
+            std::make_shared<const Data>(std::move(entries))),
+        std::memory_order_release);
+  }
+
+  /**
+   * Returns the most recently published snapshot, or nullptr if nothing
+   * has been published yet. Safe to call from any thread.
+   */
+  std::shared_ptr<const Data> read() const {
+    return std::atomic_load_explicit(&current_, std::memory_order_acquire);
+  }
+
+ private:
+  std::shared_ptr<const Data> current_;
+};
+
+}}} // facebook::memcache::mcrouter
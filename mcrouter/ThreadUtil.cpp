@@ -9,6 +9,10 @@
  */
 #include "ThreadUtil.h"
 
+#ifdef MCROUTER_HAVE_LIBNUMA
+#include <numa.h>
+#endif
+
 #include <folly/Format.h>
 #include <folly/ThreadName.h>
 
@@ -24,4 +28,28 @@ void mcrouterSetThisThreadName(const McrouterOptions& opts,
   }
 }
 
+bool mcrouterBindThisThreadToNumaNode(size_t index) {
+#ifdef MCROUTER_HAVE_LIBNUMA
+  if (numa_available() < 0) {
+    return false;
+  }
+  const size_t numNodes = numa_max_node() + 1;
+  if (numNodes <= 1) {
+    return false;
+  }
+  const int node = index % numNodes;
+  if (numa_run_on_node(node) != 0) {
+    LOG(WARNING) << "Unable to bind thread to NUMA node " << node;
+    return false;
+  }
+  /* Make first-touch allocations (fiber stacks, arenas, IOBufs) land on
+     the node the thread now runs on. */
+  numa_set_preferred(node);
+  return true;
+#else
+  (void)index;
+  return false;
+#endif
+}
+
 }}} // facebook::memcache::mcrouter
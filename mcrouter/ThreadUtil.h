@@ -20,4 +20,16 @@ namespace mcrouter {
 void mcrouterSetThisThreadName(const McrouterOptions& opts,
                                folly::StringPiece prefix);
 
+/**
+ * Pins the calling thread to a NUMA node chosen round-robin by `index`
+ * and prefers node-local memory for its future allocations, so that
+ * first-touched arenas and buffers end up on the same node as the CPU
+ * running the thread.
+ *
+ * @return true if the thread was bound; false if mcrouter was built
+ *         without libnuma, the host has no NUMA support or only a
+ *         single node.
+ */
+bool mcrouterBindThisThreadToNumaNode(size_t index);
+
 }}} // facebook::memcache::mcrouter
@@ -13,9 +13,8 @@
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
-TkoLog::TkoLog(const AccessPoint& ap, const TkoCounters& gt)
-  : accessPoint(ap),
-    globalTkos(gt) {
+TkoLog::TkoLog(const AccessPoint& ap)
+  : accessPoint(ap) {
 }
 
 std::string TkoLog::eventName() const {
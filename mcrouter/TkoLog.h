@@ -9,12 +9,12 @@
  */
 #pragma once
 
+#include <memory>
 #include <string>
 
 #include <folly/Range.h>
 
 #include "mcrouter/lib/mc/msg.h"
-#include "mcrouter/TkoCounters.h"
 
 namespace facebook { namespace memcache {
 
@@ -30,7 +30,7 @@ enum class TkoLogEvent {
 };
 
 struct TkoLog {
-  TkoLog(const AccessPoint& ap, const TkoCounters& gt);
+  explicit TkoLog(const AccessPoint& ap);
 
   std::string eventName() const;
 
@@ -42,8 +42,29 @@ struct TkoLog {
   size_t probesSent{0};
   double avgLatency{0.0};
   const AccessPoint& accessPoint;
-  const TkoCounters& globalTkos;
+  /* Snapshot of the global TKO counters at event time */
+  size_t globalSoftTkos{0};
+  size_t globalHardTkos{0};
   folly::StringPiece poolName;
 };
 
+/**
+ * By-value snapshot of one TKO transition, safe to log after the fact.
+ * ProxyDestination records these on the request path into a bounded
+ * per-proxy queue; the stat updater thread drains them and does the
+ * actual formatting and logging (see Proxy::recordTkoEvent()).
+ */
+struct TkoEvent {
+  TkoLogEvent event{TkoLogEvent::MarkHardTko};
+  mc_res_t result{mc_res_unknown};
+  bool isHardTko{false};
+  bool isSoftTko{false};
+  size_t probesSent{0};
+  double avgLatency{0.0};
+  size_t globalSoftTkos{0};
+  size_t globalHardTkos{0};
+  std::shared_ptr<const AccessPoint> accessPoint;
+  std::string poolName;
+};
+
 }}}  // facebook::memcache::mcrouter
@@ -0,0 +1,184 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "TkoSharedBoard.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+
+#include <glog/logging.h>
+
+#include <folly/Hash.h>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+namespace {
+
+constexpr uint32_t kBoardMagic = 0x4F4B544D;  // "MTKO"
+constexpr uint32_t kBoardVersion = 1;
+constexpr uint32_t kBoardSlots = 4096;
+constexpr uint32_t kMaxProbeLength = 16;
+
+/* Longer than the maximum probe retry delay (probe_delay_max_ms plus
+   jitter), so the responsible instance's failed probes keep a live
+   entry refreshed, but short enough that a crashed instance's entries
+   go away on their own. */
+constexpr uint64_t kEntryTtlSec = 180;
+
+constexpr uint64_t kExpiryMask = (1ULL << 32) - 1;
+constexpr uint64_t kHardBit = 1ULL << 32;
+
+struct Header {
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint32_t numSlots;
+  uint32_t pad;
+};
+
+uint64_t keyHash(folly::StringPiece key) {
+  auto h = folly::hash::fnv64_buf(key.data(), key.size());
+  /* 0 marks an unclaimed slot */
+  return h == 0 ? 1 : h;
+}
+
+}  // anonymous namespace
+
+struct TkoSharedBoard::Slot {
+  std::atomic<uint64_t> hash;
+  /* Bits 0..31: expiry (unix seconds); bit 32: hard TKO.
+     0 means no live entry. */
+  std::atomic<uint64_t> state;
+};
+
+std::shared_ptr<TkoSharedBoard> TkoSharedBoard::open(const std::string& path) {
+  const size_t size = sizeof(Header) + kBoardSlots * sizeof(Slot);
+
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    PLOG(ERROR) << "Can't open shared TKO board file " << path;
+    return nullptr;
+  }
+  if (ftruncate(fd, size) != 0) {
+    PLOG(ERROR) << "Can't size shared TKO board file " << path;
+    ::close(fd);
+    return nullptr;
+  }
+  void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mem == MAP_FAILED) {
+    PLOG(ERROR) << "Can't map shared TKO board file " << path;
+    return nullptr;
+  }
+
+  auto header = reinterpret_cast<Header*>(mem);
+  uint32_t magic = header->magic.load(std::memory_order_acquire);
+  if (magic == 0) {
+    /* Fresh (zeroed) file.  Concurrent initializers write identical
+       values, so the race is benign; the magic is published last. */
+    header->version = kBoardVersion;
+    header->numSlots = kBoardSlots;
+    header->magic.compare_exchange_strong(magic, kBoardMagic,
+                                          std::memory_order_release);
+    magic = kBoardMagic;
+  }
+  if (magic != kBoardMagic || header->version != kBoardVersion ||
+      header->numSlots != kBoardSlots) {
+    LOG(ERROR) << "Shared TKO board file " << path
+               << " has incompatible layout, ignoring it";
+    munmap(mem, size);
+    return nullptr;
+  }
+
+  return std::shared_ptr<TkoSharedBoard>(new TkoSharedBoard(mem, size));
+}
+
+TkoSharedBoard::TkoSharedBoard(void* mem, size_t size)
+    : mem_(mem), size_(size) {
+}
+
+TkoSharedBoard::~TkoSharedBoard() {
+  munmap(mem_, size_);
+}
+
+TkoSharedBoard::Slot* TkoSharedBoard::findSlot(uint64_t hash,
+                                               bool create) const {
+  auto slots = reinterpret_cast<Slot*>(
+      reinterpret_cast<char*>(mem_) + sizeof(Header));
+  for (uint32_t i = 0; i < kMaxProbeLength; ++i) {
+    auto& slot = slots[(hash + i) % kBoardSlots];
+    uint64_t cur = slot.hash.load(std::memory_order_acquire);
+    if (cur == hash) {
+      return &slot;
+    }
+    if (cur == 0) {
+      if (!create) {
+        return nullptr;
+      }
+      /* Slots stay claimed by their key once used; the set of
+         destinations on a host is small and stable, so the board
+         doesn't need eviction. */
+      if (slot.hash.compare_exchange_strong(cur, hash,
+                                            std::memory_order_acq_rel)) {
+        return &slot;
+      }
+      if (cur == hash) {
+        return &slot;
+      }
+      /* Lost the race to a different key, keep probing */
+    }
+  }
+  return nullptr;
+}
+
+void TkoSharedBoard::publish(folly::StringPiece key, bool hardTko) {
+  auto slot = findSlot(keyHash(key), /* create= */ true);
+  if (slot == nullptr) {
+    LOG_EVERY_N(WARNING, 1000) << "Shared TKO board is full, can't publish "
+                               << key;
+    return;
+  }
+  const uint64_t now = time(nullptr);
+  const uint64_t expiry = now + kEntryTtlSec;
+  uint64_t cur = slot->state.load(std::memory_order_relaxed);
+  uint64_t merged;
+  do {
+    if ((cur & kExpiryMask) > now) {
+      /* Merge with another instance's live entry: latest expiry wins
+         and the hard bit is sticky. */
+      merged = std::max(cur & kExpiryMask, expiry) |
+               (cur & kHardBit) | (hardTko ? kHardBit : 0);
+    } else {
+      merged = expiry | (hardTko ? kHardBit : 0);
+    }
+  } while (!slot->state.compare_exchange_weak(cur, merged,
+                                              std::memory_order_acq_rel));
+}
+
+void TkoSharedBoard::clear(folly::StringPiece key) {
+  if (auto slot = findSlot(keyHash(key), /* create= */ false)) {
+    slot->state.store(0, std::memory_order_release);
+  }
+}
+
+bool TkoSharedBoard::isTko(folly::StringPiece key) const {
+  auto slot = findSlot(keyHash(key), /* create= */ false);
+  if (slot == nullptr) {
+    return false;
+  }
+  const uint64_t now = time(nullptr);
+  return (slot->state.load(std::memory_order_acquire) & kExpiryMask) > now;
+}
+
+}}}  // facebook::memcache::mcrouter
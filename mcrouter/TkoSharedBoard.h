@@ -0,0 +1,86 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <folly/Range.h>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * A fixed-size board of TKO'd destinations in a file-backed shared
+ * memory segment, so that multiple mcrouter instances on one host
+ * (different flavors) can share TKO state: the first instance to mark a
+ * destination TKO protects all of them, instead of each instance
+ * multiplying probe traffic and timeout-discovery latency.
+ *
+ * The board is an open-addressed hash table of
+ * (key hash, expiry + hard bit) slots keyed by "host:port".  All
+ * updates are plain atomics on the mapped memory; concurrent instances
+ * merge their state (latest expiry wins, the hard bit is sticky while
+ * the entry is live).  Entries expire after a TTL longer than the
+ * maximum probe retry delay, so a crashed instance cannot fast-fail a
+ * healthy box forever, while the responsible instance's failed probes
+ * keep a live entry refreshed.
+ */
+class TkoSharedBoard {
+ public:
+  /**
+   * Maps the board file at `path`, creating and initializing it if
+   * needed.  Safe to call concurrently from multiple instances.
+   *
+   * @return nullptr if the file can't be opened, mapped, or was
+   *         created by an incompatible version.
+   */
+  static std::shared_ptr<TkoSharedBoard> open(const std::string& path);
+
+  ~TkoSharedBoard();
+
+  TkoSharedBoard(const TkoSharedBoard&) = delete;
+  TkoSharedBoard& operator=(const TkoSharedBoard&) = delete;
+
+  /**
+   * Marks `key` ("host:port") as TKO, or refreshes the expiry of an
+   * existing entry.  No-op if the board is full.
+   */
+  void publish(folly::StringPiece key, bool hardTko);
+
+  /**
+   * Removes the entry for `key`, if any.  Called when a probe succeeds
+   * and the destination is unmarked.
+   */
+  void clear(folly::StringPiece key);
+
+  /**
+   * @return true if any instance currently has a live TKO entry
+   *         for `key`.
+   */
+  bool isTko(folly::StringPiece key) const;
+
+ private:
+  struct Slot;
+
+  TkoSharedBoard(void* mem, size_t size);
+
+  /**
+   * Linear-probes for the slot owning `hash`, claiming an empty slot
+   * when `create` is set.  Returns nullptr if not found (or, when
+   * creating, if the probe window is exhausted).
+   */
+  Slot* findSlot(uint64_t hash, bool create) const;
+
+  void* mem_;
+  size_t size_;
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -9,6 +9,7 @@
  */
 #include "TkoTracker.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include <glog/logging.h>
@@ -17,6 +18,18 @@
 
 #include "mcrouter/ProxyDestination.h"
 #include "mcrouter/TkoCounters.h"
+#include "mcrouter/TkoSharedBoard.h"
+#include "mcrouter/config.h"
+
+namespace {
+
+// Catch-up tokens the probe budget may accumulate while unused.
+constexpr int64_t kProbeBudgetBurst = 10;
+
+// How often a destination re-reads its shared board entry.
+constexpr int64_t kSharedCheckIntervalUs = 1000000;
+
+} // anonymous namespace
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
@@ -42,6 +55,35 @@ const TkoCounters& TkoTracker::globalTkos() const {
   return trackerMap_.globalTkos_;
 }
 
+bool TkoTracker::isSharedTko() const {
+  auto board = trackerMap_.sharedBoard_.get();
+  if (board == nullptr) {
+    return false;
+  }
+  const int64_t now = nowUs();
+  int64_t next = nextSharedCheckUs_.load(std::memory_order_relaxed);
+  if (now >= next &&
+      nextSharedCheckUs_.compare_exchange_strong(
+          next, now + kSharedCheckIntervalUs, std::memory_order_relaxed)) {
+    sharedTko_.store(board->isTko(key_), std::memory_order_relaxed);
+  }
+  return sharedTko_.load(std::memory_order_relaxed);
+}
+
+void TkoTracker::publishSharedState(bool hard) {
+  if (auto board = trackerMap_.sharedBoard_.get()) {
+    board->publish(key_, hard);
+  }
+}
+
+void TkoTracker::clearSharedState() {
+  if (auto board = trackerMap_.sharedBoard_.get()) {
+    board->clear(key_);
+    sharedTko_.store(false, std::memory_order_relaxed);
+    nextSharedCheckUs_.store(0, std::memory_order_relaxed);
+  }
+}
+
 bool TkoTracker::incrementSoftTkoCount() {
   auto& softTkos = trackerMap_.globalTkos_.softTkos;
   size_t old_soft_tkos = softTkos;
@@ -84,6 +126,10 @@ bool TkoTracker::recordSoftFailure(ProxyDestination* pdstn) {
   */
   /* If host is in any state of TKO, we just leave it alone */
   if (isTko()) {
+    if (isResponsible(pdstn)) {
+      /* A failed probe while TKO: keep the shared board entry fresh. */
+      publishSharedState(isHardTko());
+    }
     return false;
   }
 
@@ -114,13 +160,21 @@ bool TkoTracker::recordSoftFailure(ProxyDestination* pdstn) {
       }
     }
   } while (!sumFailures_.compare_exchange_weak(curSumFailures, value));
-  return value == pdstnAddr;
+  if (value == pdstnAddr) {
+    publishSharedState(/* hard= */ false);
+    return true;
+  }
+  return false;
 }
 
 bool TkoTracker::recordHardFailure(ProxyDestination* pdstn) {
   ++consecutiveFailureCount_;
 
   if (isHardTko()) {
+    if (isResponsible(pdstn)) {
+      /* A failed probe while TKO: keep the shared board entry fresh. */
+      publishSharedState(/* hard= */ true);
+    }
     return false;
   }
   /* If we were already TKO and responsible, but not hard TKO, it means we were
@@ -131,6 +185,7 @@ bool TkoTracker::recordHardFailure(ProxyDestination* pdstn) {
     sumFailures_ |= 1;
     decrementSoftTkoCount();
     ++trackerMap_.globalTkos_.hardTkos;
+    publishSharedState(/* hard= */ true);
     /* We've already been marked responsible */
     return false;
   }
@@ -139,6 +194,7 @@ bool TkoTracker::recordHardFailure(ProxyDestination* pdstn) {
   bool success = setSumFailures(reinterpret_cast<uintptr_t>(pdstn) | 1);
   if (success) {
     ++trackerMap_.globalTkos_.hardTkos;
+    publishSharedState(/* hard= */ true);
   }
   return success;
 }
@@ -160,6 +216,7 @@ bool TkoTracker::recordSuccess(ProxyDestination* pdstn) {
     }
     sumFailures_ = 0;
     consecutiveFailureCount_ = 0;
+    clearSharedState();
     return true;
   }
   /* Skip resetting failures if the counter is at zero.
@@ -208,6 +265,29 @@ void TkoTrackerMap::updateTracker(
   }
 }
 
+bool TkoTrackerMap::tryAcquireProbeToken(size_t maxProbesPerSecond) {
+  if (maxProbesPerSecond == 0) {
+    return true;
+  }
+  const int64_t intervalUs =
+      std::max<int64_t>(1, 1000000 / maxProbesPerSecond);
+  // Allow a short burst of catch-up tokens so a handful of probes
+  // firing together doesn't defer some of them, but never let unused
+  // budget accumulate beyond that.
+  const int64_t burstUs = kProbeBudgetBurst * intervalUs;
+  const int64_t now = nowUs();
+  int64_t next = nextProbeUs_.load(std::memory_order_relaxed);
+  do {
+    if (next > now) {
+      return false;
+    }
+  } while (!nextProbeUs_.compare_exchange_weak(
+      next,
+      std::max(next, now - burstUs) + intervalUs,
+      std::memory_order_relaxed));
+  return true;
+}
+
 std::unordered_map<std::string, std::pair<bool, size_t>>
 TkoTrackerMap::getSuspectServers() {
   std::unordered_map<std::string, std::pair<bool, size_t>> result;
@@ -24,6 +24,7 @@
 namespace facebook { namespace memcache { namespace mcrouter {
 
 class ProxyDestination;
+class TkoSharedBoard;
 class TkoTrackerMap;
 
 /**
@@ -68,6 +69,15 @@ class TkoTracker {
     return sumFailures_ > tkoThreshold_;
   }
 
+  /**
+   * @return Has another mcrouter instance on this host marked the
+   *         destination TKO on the shared board?  Always false when no
+   *         shared board is configured.  The board lookup is cached and
+   *         refreshed at most once a second per destination, so this is
+   *         cheap to call on the request path.
+   */
+  bool isSharedTko() const;
+
   /**
    * @return current number of consecutive failures.
    *         This is basically a number of recordHardFailure/recordSoftFailure
@@ -154,6 +164,11 @@ class TkoTracker {
 
   std::atomic<size_t> consecutiveFailureCount_{0};
 
+  /* Cached result of the shared board lookup and the time (in nowUs()
+     terms) it next needs refreshing. */
+  mutable std::atomic<bool> sharedTko_{false};
+  mutable std::atomic<int64_t> nextSharedCheckUs_{0};
+
   /* Decrement the global counter of current soft TKOs. */
   void decrementSoftTkoCount();
   /* Attempt to increment the global counter of current soft TKOs. Return true
@@ -168,6 +183,15 @@ class TkoTracker {
   /* Return true if this thread is responsible for the TKO state */
   bool isResponsible(ProxyDestination* pdstn) const;
 
+  /* Publish/refresh this destination's TKO state on the shared board,
+     if one is configured. */
+  void publishSharedState(bool hard);
+
+  /* Remove this destination from the shared board, if one is
+     configured.  Also resets the local cache so other threads pick up
+     the change promptly. */
+  void clearSharedState();
+
   /**
    * @param tkoThreshold require this many soft failures to mark
    *        the destination TKO
@@ -216,6 +240,28 @@ class TkoTrackerMap {
     return globalTkos_;
   }
 
+  /**
+   * Attaches a shared TKO board so that TKO state is shared with other
+   * mcrouter instances on this host. Must be called before any proxy
+   * threads are running (at instance startup).
+   */
+  void setSharedBoard(std::shared_ptr<TkoSharedBoard> board) {
+    sharedBoard_ = std::move(board);
+  }
+
+  /**
+   * Claims one send from the instance-wide probe budget. During a big
+   * outage thousands of destinations want to probe at once; the budget
+   * spreads their sends out so recovery traffic stays smooth.
+   * Can be called from any proxy thread.
+   *
+   * @param maxProbesPerSecond  the budget; 0 means unlimited.
+   *
+   * @return true if the caller may send a probe now; false if it
+   *         should defer and retry later.
+   */
+  bool tryAcquireProbeToken(size_t maxProbesPerSecond);
+
   std::weak_ptr<TkoTracker> getTracker(folly::StringPiece key);
  private:
   std::mutex mx_;
@@ -224,6 +270,13 @@ class TkoTrackerMap {
   // Total number of boxes marked as TKO.
   TkoCounters globalTkos_;
 
+  // Time (in nowUs() terms) the next probe token becomes available.
+  std::atomic<int64_t> nextProbeUs_{0};
+
+  // Optional host-wide TKO state shared with other instances.
+  // Set once at startup, read-only afterwards.
+  std::shared_ptr<TkoSharedBoard> sharedBoard_;
+
   void removeTracker(folly::StringPiece key) noexcept;
 
   friend class TkoTracker;
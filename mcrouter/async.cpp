@@ -22,12 +22,15 @@
 #include <unistd.h>
 
 #include <folly/Conv.h>
+#include <folly/fibers/Baton.h>
 #include <folly/fibers/EventBaseLoopController.h>
 #include <folly/File.h>
 #include <folly/FileUtil.h>
+#include <folly/Hash.h>
 #include <folly/json.h>
 #include <folly/ThreadName.h>
 
+#include "mcrouter/AsynclogSpoolFormat.h"
 #include "mcrouter/McrouterInstance.h"
 #include "mcrouter/McrouterLogFailure.h"
 #include "mcrouter/Proxy.h"
@@ -150,8 +153,9 @@ static std::shared_ptr<folly::File> countedfd_new(int fd) {
   return std::make_shared<folly::File>(fd, true);
 }
 
-/** Opens the asynchronous request store.  */
-static std::shared_ptr<folly::File> asynclog_open(Proxy* proxy) {
+/** Opens the asynchronous request store of one writer shard. */
+static std::shared_ptr<folly::File> asynclog_open(Proxy* proxy,
+                                                  AsynclogShard& shard) {
   char path[PATH_MAX + 1];
   time_t now = time(nullptr);
   pid_t tid = syscall(SYS_gettid);
@@ -160,13 +164,13 @@ static std::shared_ptr<folly::File> asynclog_open(Proxy* proxy) {
   int success = 0;
   int fd = -1;
 
-  if (proxy->async_fd &&
-      now - proxy->async_spool_time <= DEFAULT_ASYNCLOG_LIFETIME) {
-    return proxy->async_fd;
+  if (shard.spoolFd &&
+      now - shard.spoolTime <= DEFAULT_ASYNCLOG_LIFETIME) {
+    return shard.spoolFd;
   }
 
-  if (proxy->async_fd) {
-    proxy->async_fd = nullptr;
+  if (shard.spoolFd) {
+    shard.spoolFd = nullptr;
   }
 
   localtime_r(&now, &date);
@@ -221,17 +225,24 @@ static std::shared_ptr<folly::File> asynclog_open(Proxy* proxy) {
   }
 
   /*
-   * Just in case, append to the log if it exists
+   * Just in case, append to the log if it exists.
+   * The mmap'ed spool writer needs a readable fd for MAP_SHARED.
    */
   if (stat(path, &st) != 0) {
-    fd = open(path, O_WRONLY | O_CREAT, 0666);
+    fd = open(path,
+              (proxy->router().opts().use_asynclog_binary_format
+                   ? O_RDWR : O_WRONLY) | O_CREAT,
+              0666);
     if (fd < 0) {
       LOG(ERROR) << "Can't create and open async store " << path << ": " <<
                     strerror(errno);
       goto epilogue;
     }
   } else {
-    fd = open(path, O_WRONLY | O_APPEND, 0666);
+    fd = open(path,
+              (proxy->router().opts().use_asynclog_binary_format
+                   ? O_RDWR : O_WRONLY) | O_APPEND,
+              0666);
     if (fd < 0) {
       LOG(ERROR) << "Can't re-open async store " << path << ": " <<
                     strerror(errno);
@@ -249,16 +260,17 @@ static std::shared_ptr<folly::File> asynclog_open(Proxy* proxy) {
     goto epilogue;
   }
 
-  proxy->async_fd = countedfd_new(fd);
-  if (!proxy->async_fd) {
-    LOG(ERROR) << "Unable to allocate memory for async_fd: " << strerror(errno);
+  shard.spoolFd = countedfd_new(fd);
+  if (!shard.spoolFd) {
+    LOG(ERROR) << "Unable to allocate memory for spool fd: " <<
+                  strerror(errno);
     goto epilogue;
   }
 
-  /* Ownership of the descriptor has been passed to prox->async_fd. */
+  /* Ownership of the descriptor has been passed to shard.spoolFd. */
   fd = -1;
 
-  proxy->async_spool_time = now;
+  shard.spoolTime = now;
 
   success = 1;
 
@@ -269,25 +281,30 @@ epilogue:
     if (fd != -1) {
       close(fd);
     }
-    if (proxy->async_fd) {
-      proxy->async_fd = nullptr;
+    if (shard.spoolFd) {
+      shard.spoolFd = nullptr;
     }
   }
-  return proxy->async_fd;
+  return shard.spoolFd;
 }
 
-/** Adds an asynchronous request to the event log. */
-void asynclog_delete(
-    Proxy* proxy,
-    const AccessPoint& ap,
-    folly::StringPiece key,
-    folly::StringPiece poolName) {
-  dynamic json = dynamic::array;
-  const auto& host = ap.getHost();
-  const auto& port = proxy->router().opts().asynclog_port_override == 0
-    ? ap.getPort()
-    : proxy->router().opts().asynclog_port_override;
+namespace {
+
+// Group commit tuning: one fdatasync at most per interval, and writev
+// batches kept well below typical IOV_MAX values.
+constexpr int64_t kAsynclogSyncIntervalUs = 1000000;
+constexpr size_t kAsynclogMaxIovecs = 64;
 
+/**
+ * Serializes a delete as an asynclog version 1.0 or 2.0 JSON line.
+ */
+std::string asynclog_json_line(Proxy* proxy,
+                               folly::StringPiece host,
+                               uint16_t port,
+                               folly::StringPiece key,
+                               folly::StringPiece poolName,
+                               int64_t timestamp_ms) {
+  dynamic json = dynamic::array;
   if (proxy->router().opts().use_asynclog_version2) {
     json = dynamic::object;
     json["f"] = proxy->router().opts().flavor_name;
@@ -301,15 +318,6 @@ void asynclog_delete(
     json.push_back(folly::sformat("delete {}\r\n", key));
   }
 
-  auto fd = asynclog_open(proxy);
-  if (!fd) {
-    MC_LOG_FAILURE(proxy->router().opts(),
-                   memcache::failure::Category::kSystemError,
-                   "asynclog_open() failed (key {}, pool {})",
-                   key, poolName);
-    return;
-  }
-
   // ["AS1.0", 1289416829.836, "C", ["10.0.0.1", 11302, "delete foo\r\n"]]
   // OR ["AS2.0", 1289416829.836, "C", {"f":"flavor","h":"[10.0.0.1]:11302",
   //                                    "p":"pool_name","k":"foo\r\n"}]
@@ -320,26 +328,218 @@ void asynclog_delete(
     jsonOut.push_back(ASYNCLOG_MAGIC);
   }
 
-  struct timeval timestamp;
-  CHECK(gettimeofday(&timestamp, nullptr) == 0);
-
-  auto timestamp_ms =
-    facebook::memcache::to<std::chrono::milliseconds>(timestamp).count();
-
   jsonOut.push_back(1e-3 * timestamp_ms);
   jsonOut.push_back(std::string("C"));
 
   jsonOut.push_back(json);
 
-  auto jstr = folly::toJson(jsonOut) + "\n";
+  return folly::to<std::string>(folly::toJson(jsonOut)) + "\n";
+}
 
-  ssize_t size = folly::writeFull(fd->fd(), jstr.data(), jstr.size());
-  if (size == -1 || size_t(size) < jstr.size()) {
+/**
+ * Writes a batch with chunked writev calls; the fallback when the
+ * mmap'ed spool writer is disabled or unavailable.
+ */
+void asynclog_writev(Proxy* proxy,
+                     int fd,
+                     const std::vector<AsynclogEntry>& batch) {
+  struct iovec iov[kAsynclogMaxIovecs];
+  size_t i = 0;
+  while (i < batch.size()) {
+    size_t iovcnt = 0;
+    size_t bytes = 0;
+    while (i < batch.size() && iovcnt < kAsynclogMaxIovecs) {
+      const auto& line = batch[i].line;
+      iov[iovcnt].iov_base = const_cast<char*>(line.data());
+      iov[iovcnt].iov_len = line.size();
+      bytes += line.size();
+      ++iovcnt;
+      ++i;
+    }
+    ssize_t written = folly::writevFull(fd, iov, iovcnt);
+    if (written == -1 || size_t(written) < bytes) {
+      MC_LOG_FAILURE(proxy->router().opts(),
+                     memcache::failure::Category::kSystemError,
+                     "Error fully writing asynclog batch ({} entries)",
+                     batch.size());
+      return;
+    }
+  }
+}
+
+/**
+ * Writes out every entry batched on one shard since its last flush.
+ * Runs on the shard's awriter thread; there is at most one flush task
+ * in flight per (proxy, shard) pair (see asynclog_delete()).
+ */
+void asynclog_flush(Proxy* proxy, size_t shardId) {
+  auto& shard = proxy->asynclogShards[shardId];
+  std::vector<AsynclogEntry> batch;
+  {
+    std::lock_guard<std::mutex> lock(shard.batchLock);
+    batch.swap(shard.batch);
+    shard.flushScheduled = false;
+  }
+  if (batch.empty()) {
+    return;
+  }
+
+  auto fd = asynclog_open(proxy, shard);
+  if (!fd) {
     MC_LOG_FAILURE(proxy->router().opts(),
                    memcache::failure::Category::kSystemError,
-                   "Error fully writing asynclog request (key {}, pool {})",
-                   key, poolName);
+                   "asynclog_open() failed, dropping {} entries",
+                   batch.size());
+  } else {
+    bool mapped = false;
+    if (proxy->router().opts().use_asynclog_binary_format) {
+      if (!shard.spoolWriter) {
+        shard.spoolWriter = folly::make_unique<AsynclogSpoolWriter>();
+      }
+      mapped = shard.spoolWriter->attach(fd);
+    }
+    if (mapped) {
+      auto& writer = *shard.spoolWriter;
+      for (const auto& entry : batch) {
+        if (!writer.append(entry.line)) {
+          MC_LOG_FAILURE(proxy->router().opts(),
+                         memcache::failure::Category::kSystemError,
+                         "Error appending to mmap'ed asynclog spool");
+          break;
+        }
+      }
+    } else {
+      asynclog_writev(proxy, fd->fd(), batch);
+    }
+
+    if (nowUs() - shard.lastSyncUs >= kAsynclogSyncIntervalUs) {
+      if (mapped) {
+        shard.spoolWriter->sync();
+      } else {
+        fdatasync(fd->fd());
+      }
+      shard.lastSyncUs = nowUs();
+    }
   }
+
+  const auto doneUs = nowUs();
+  for (auto& entry : batch) {
+    shard.spoolLagUs.insertSample(doneUs - entry.enqueueUs);
+    entry.baton->post();
+  }
+}
+
+/**
+ * Checks the sliding dedupe window (--asynclog-dedupe-window-ms) for an
+ * identical delete and records this one.  Returns true if an entry with
+ * the same key, destination and pool was already spooled within the
+ * window.  Runs on the proxy thread; the window state is per-proxy and
+ * needs no locking.
+ */
+bool asynclog_is_duplicate_delete(
+    Proxy* proxy,
+    const AccessPoint& ap,
+    folly::StringPiece key,
+    folly::StringPiece poolName) {
+  const int64_t windowUs =
+    proxy->router().opts().asynclog_dedupe_window_ms * 1000;
+  if (windowUs == 0) {
+    return false;
+  }
+
+  auto& dedupe = proxy->asynclogDedupe;
+  const auto now = nowUs();
+  if (now - dedupe.bucketStartUs >= windowUs) {
+    if (now - dedupe.bucketStartUs >= 2 * windowUs) {
+      dedupe.previous.clear();
+    } else {
+      dedupe.previous = std::move(dedupe.current);
+    }
+    dedupe.current.clear();
+    dedupe.bucketStartUs = now;
+  }
+
+  const auto& host = ap.getHost();
+  uint64_t hash = folly::hash::fnv64_buf(key.data(), key.size());
+  hash = folly::hash::hash_128_to_64(
+    hash, folly::hash::fnv64_buf(host.data(), host.size()));
+  hash = folly::hash::hash_128_to_64(hash, ap.getPort());
+  hash = folly::hash::hash_128_to_64(
+    hash, folly::hash::fnv64_buf(poolName.data(), poolName.size()));
+
+  if (dedupe.current.count(hash) != 0 || dedupe.previous.count(hash) != 0) {
+    return true;
+  }
+  dedupe.current.insert(hash);
+  return false;
+}
+
+} // anonymous namespace
+
+/** Adds an asynchronous request to the event log. */
+bool asynclog_delete(
+    Proxy* proxy,
+    const AccessPoint& ap,
+    folly::StringPiece key,
+    folly::StringPiece poolName) {
+  if (asynclog_is_duplicate_delete(proxy, ap, key, poolName)) {
+    /* Identical delete already spooled within the window; reply as if
+       this one was spooled too. */
+    stat_incr(proxy->stats, asynclog_duplicate_deletes_stat, 1);
+    return true;
+  }
+
+  const auto& host = ap.getHost();
+  const auto& port = proxy->router().opts().asynclog_port_override == 0
+    ? ap.getPort()
+    : proxy->router().opts().asynclog_port_override;
+
+  struct timeval timestamp;
+  CHECK(gettimeofday(&timestamp, nullptr) == 0);
+
+  auto timestamp_ms =
+    facebook::memcache::to<std::chrono::milliseconds>(timestamp).count();
+
+  std::string jstr;
+  if (proxy->router().opts().use_asynclog_binary_format) {
+    AsynclogBinaryRecord record;
+    record.timestampMs = timestamp_ms;
+    record.port = port;
+    record.flavor = proxy->router().opts().flavor_name;
+    record.host = host;
+    record.pool = poolName;
+    record.key = key;
+    serializeAsynclogRecord(record, jstr);
+  } else {
+    jstr = asynclog_json_line(proxy, host, port, key, poolName, timestamp_ms);
+  }
+
+  const size_t shardId = proxy->asynclogShards.size() == 1
+      ? 0
+      : folly::hash::fnv64_buf(key.data(), key.size()) %
+          proxy->asynclogShards.size();
+  auto& shard = proxy->asynclogShards[shardId];
+
+  folly::fibers::Baton baton;
+  {
+    std::lock_guard<std::mutex> lock(shard.batchLock);
+    shard.batch.push_back(AsynclogEntry{std::move(jstr), &baton, nowUs()});
+    if (!shard.flushScheduled) {
+      // Scheduled under the lock so the flag can't be cleared by a
+      // flush racing with us. run() only queues the task, it never
+      // waits on it.
+      if (!proxy->router().asyncWriter(shardId).run(
+              [proxy, shardId]() { asynclog_flush(proxy, shardId); })) {
+        shard.batch.pop_back();
+        return false;
+      }
+      shard.flushScheduled = true;
+    }
+  }
+
+  /* Don't reply to the user until we safely logged the request to disk */
+  baton.wait();
+  return true;
 }
 
 }}} // facebook::memcache::mcrouter
@@ -23,10 +23,20 @@ class Proxy;
 
 /**
  * Appends a 'delete' request entry to the asynclog.
- * This call blocks until the entry is written to the file
- * or an error occurs.
+ *
+ * The entry is serialized on the calling fiber and handed to one of
+ * the awriter threads (sharded by key hash, see
+ * --asynclog-num-threads), which group-commits everything batched up
+ * since its last wakeup (plus a periodic fdatasync). Each shard
+ * appends to its own spool file. This call blocks the calling fiber
+ * until the entry is written to the file or an error occurs.
+ *
+ * Must be called from a fiber on the proxy thread.
+ *
+ * @return false if the entry could not be queued to the awriter
+ *         (e.g. it is shutting down).
  */
-void asynclog_delete(
+bool asynclog_delete(
     Proxy* proxy,
     const AccessPoint& ap,
     folly::StringPiece key,
@@ -33,6 +33,16 @@ class Ch3HashFunc {
     return furc_hash(hashable.data(), hashable.size(), n_);
   }
 
+  /**
+   * Variant taking the key's memoized furc_key_hash()
+   * (carbon::Keys::routingKeyFurcHash()), so the pass over the key
+   * bytes happens once per request instead of once per pool.
+   */
+  size_t operator() (folly::StringPiece /* hashable */,
+                     uint64_t keyHash) const {
+    return furc_hash_by_key_hash(keyHash, n_);
+  }
+
   static const char* type() {
     return "Ch3";
   }
@@ -9,6 +9,9 @@
  */
 #include "Compression.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include <folly/Format.h>
 #include <folly/Memory.h>
 #include <folly/Portability.h>
@@ -157,5 +160,105 @@ std::unique_ptr<CompressionCodec> createCompressionCodec(
   return nullptr;
 }
 
+namespace {
+
+// Sample size for entropy estimation. Keeps the histogram pass at a few
+// hundred nanoseconds regardless of value size.
+constexpr size_t kEntropySampleSize = 512;
+// Too few bytes to judge; assume compressible.
+constexpr size_t kMinEntropySampleSize = 64;
+// Above this estimated entropy (in bits per byte), compression is not
+// expected to pay for its CPU. Already-compressed data typically sits
+// at 7.9+.
+constexpr double kIncompressibleEntropy = 7.5;
+
+} // anonymous namespace
+
+double estimateByteEntropy(const struct iovec* iov, size_t iovcnt) {
+  size_t totalSize = 0;
+  for (size_t i = 0; i < iovcnt; ++i) {
+    totalSize += iov[i].iov_len;
+  }
+  const size_t stride = std::max<size_t>(1, totalSize / kEntropySampleSize);
+
+  uint32_t histogram[256] = {};
+  size_t sampled = 0;
+  size_t offset = 0; // offset of the next sample in the current iovec
+  for (size_t i = 0; i < iovcnt && sampled < kEntropySampleSize; ++i) {
+    const auto* data = static_cast<const uint8_t*>(iov[i].iov_base);
+    const size_t len = iov[i].iov_len;
+    while (offset < len && sampled < kEntropySampleSize) {
+      ++histogram[data[offset]];
+      ++sampled;
+      offset += stride;
+    }
+    offset -= len; // carry the remainder into the next iovec
+  }
+  if (sampled == 0) {
+    return 0.0;
+  }
+
+  // H = log2(n) - (1/n) * sum(count * log2(count))
+  double acc = 0.0;
+  size_t occupiedBuckets = 0;
+  for (const auto count : histogram) {
+    if (count > 0) {
+      acc += count * std::log2(static_cast<double>(count));
+      ++occupiedBuckets;
+    }
+  }
+  double entropy = std::log2(static_cast<double>(sampled)) - acc / sampled;
+  // Small samples underestimate entropy (512 draws can't fill 256
+  // buckets evenly); the Miller-Madow correction recovers most of it.
+  entropy += (occupiedBuckets - 1) / (2.0 * sampled * std::log(2.0));
+  return std::min(entropy, 8.0);
+}
+
+bool isLikelyCompressible(const struct iovec* iov, size_t iovcnt) {
+  size_t totalSize = 0;
+  for (size_t i = 0; i < iovcnt; ++i) {
+    totalSize += iov[i].iov_len;
+  }
+  if (totalSize < kMinEntropySampleSize) {
+    return true;
+  }
+  return estimateByteEntropy(iov, iovcnt) < kIncompressibleEntropy;
+}
+
+/***************************
+ * CompressionOutcomeCache *
+ ***************************/
+constexpr uint32_t CompressionOutcomeCache::kMaxConsecutiveFailures;
+constexpr uint32_t CompressionOutcomeCache::kSkipWindow;
+
+bool CompressionOutcomeCache::shouldCompress(size_t typeId) {
+  auto it = cache_.find(typeId);
+  if (it == cache_.end()) {
+    return true;
+  }
+  auto& outcomes = it->second;
+  if (outcomes.consecutiveFailures < kMaxConsecutiveFailures) {
+    return true;
+  }
+  if (outcomes.skipsRemaining > 0) {
+    --outcomes.skipsRemaining;
+    return false;
+  }
+  // Window exhausted: probe compression again.
+  outcomes.consecutiveFailures = 0;
+  return true;
+}
+
+void CompressionOutcomeCache::recordOutcome(size_t typeId, bool saved) {
+  auto& outcomes = cache_[typeId];
+  if (saved) {
+    outcomes.consecutiveFailures = 0;
+    return;
+  }
+  if (++outcomes.consecutiveFailures == kMaxConsecutiveFailures) {
+    outcomes.skipsRemaining = kSkipWindow;
+  }
+}
+
 } // memcache
 } // facebook
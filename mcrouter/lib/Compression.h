@@ -12,6 +12,7 @@
 #include <sys/uio.h>
 #include <limits>
 #include <memory>
+#include <unordered_map>
 
 namespace folly {
 class IOBuf;
@@ -139,6 +140,14 @@ class CompressionCodec {
    */
   uint32_t compressionLevel() const { return compressionLevel_; }
 
+  /**
+   * Adjust the compression level this codec actually uses, e.g. to shed
+   * CPU when the owning thread is falling behind. The configured level
+   * (compressionLevel()) is left unchanged and acts as the ceiling.
+   * Codecs without compression levels ignore this.
+   */
+  virtual void setEffectiveCompressionLevel(uint32_t /* level */) {}
+
   /**
    * Return the filtering options used by this codec.
    */
@@ -189,5 +198,55 @@ std::unique_ptr<CompressionCodec> createCompressionCodec(
     FilteringOptions codecFilteringOptions = FilteringOptions(),
     uint32_t codecCompressionLevel = 1);
 
+/**
+ * Cheap compressibility pre-filter: estimates the Shannon entropy of
+ * the data from a strided sample of at most 512 bytes. Already
+ * compressed values (images, thumbnails, ...) score close to 8 bits
+ * per byte, while anything a codec can shrink scores noticeably lower.
+ *
+ * @param iov     Iovec array containing the data.
+ * @param iovcnt  Size of the array.
+ * @return        Estimated entropy, in bits per byte (0.0 to 8.0).
+ */
+double estimateByteEntropy(const struct iovec* iov, size_t iovcnt);
+
+/**
+ * Whether data looks worth handing to a compression codec at all,
+ * based on estimateByteEntropy(). Erring on the side of compressing:
+ * data too small to sample reliably is reported as compressible.
+ */
+bool isLikelyCompressible(const struct iovec* iov, size_t iovcnt);
+
+/**
+ * Remembers recent compression outcomes per reply typeId, so the codec
+ * path can stop burning CPU on message types whose values keep proving
+ * incompressible. After kMaxConsecutiveFailures outcomes in a row that
+ * did not pay off, the next kSkipWindow attempts for that typeId are
+ * skipped, then compression is probed again.
+ * Note: not thread-safe; keep one instance per thread.
+ */
+class CompressionOutcomeCache {
+ public:
+  /**
+   * Whether compression is worth attempting for this typeId.
+   */
+  bool shouldCompress(size_t typeId);
+
+  /**
+   * Record whether a compression attempt actually shrank the data.
+   */
+  void recordOutcome(size_t typeId, bool saved);
+
+ private:
+  static constexpr uint32_t kMaxConsecutiveFailures = 16;
+  static constexpr uint32_t kSkipWindow = 256;
+
+  struct Outcomes {
+    uint32_t consecutiveFailures{0};
+    uint32_t skipsRemaining{0};
+  };
+  std::unordered_map<size_t, Outcomes> cache_;
+};
+
 } // memcache
 } // facebook
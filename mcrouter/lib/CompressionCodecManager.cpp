@@ -10,6 +10,7 @@
 #include "CompressionCodecManager.h"
 
 #include <algorithm>
+#include <stdexcept>
 
 #include <folly/fibers/FiberManager.h>
 #include <folly/Format.h>
@@ -41,11 +42,12 @@ bool isApplicable(const CompressionCodec* codec, const size_t bodySize) {
  ***************************/
 CompressionCodecManager::CompressionCodecManager(
     std::unordered_map<uint32_t, CodecConfigPtr> codecConfigs)
-    : codecConfigs_(std::move(codecConfigs)),
-      compressionCodecMap_([this]() {
-        return folly::fibers::runInMainContext(
-            [this]() { return buildCodecMap(); });
-      }) {
+    : codecConfigs_(std::move(codecConfigs)) {
+  std::lock_guard<std::mutex> lock(configLock_);
+  validateConfigsLocked();
+}
+
+void CompressionCodecManager::validateConfigsLocked() {
   // Validate all dictionaries
   std::vector<uint32_t> badCodecConfigs;
   int64_t largestId = 0;
@@ -53,14 +55,18 @@ CompressionCodecManager::CompressionCodecManager(
     auto codecId = it.first;
     const auto& config = it.second;
     try {
-      // createCompressionCodec throws if the dictionary is invalid.
-      createCompressionCodec(
+      // createCompressionCodec throws if the dictionary is invalid, and
+      // returns nullptr if the codec type is compiled out of this build.
+      auto codec = createCompressionCodec(
           config->codecType,
           folly::IOBuf::wrapBuffer(
               config->dictionary.data(), config->dictionary.size()),
           codecId,
           config->filteringOptions,
           config->compressionLevel);
+      if (codec == nullptr) {
+        throw std::runtime_error("codec type not supported by this build");
+      }
       largestId = std::max<int64_t>(largestId, codecId);
     } catch (const std::exception& e) {
       badCodecConfigs.push_back(codecId);
@@ -71,9 +77,10 @@ CompressionCodecManager::CompressionCodecManager(
     codecConfigs_.erase(id);
   }
 
+  smallestCodecId_ = 0;
+  size_ = 0;
   if (!codecConfigs_.empty()) {
     // Get the longest contiguous range ending in 'largestId'
-    smallestCodecId_ = 0;
     for (int64_t i = largestId - 1; i >= 0; --i) {
       const auto& it = codecConfigs_.find(i);
       if (it == codecConfigs_.end()) {
@@ -89,11 +96,32 @@ CompressionCodecManager::CompressionCodecManager(
   }
 }
 
+void CompressionCodecManager::updateCodecConfigs(
+    std::unordered_map<uint32_t, CodecConfigPtr> codecConfigs) {
+  {
+    std::lock_guard<std::mutex> lock(configLock_);
+    codecConfigs_ = std::move(codecConfigs);
+    validateConfigsLocked();
+  }
+  version_.fetch_add(1, std::memory_order_release);
+}
+
 const CompressionCodecMap* CompressionCodecManager::getCodecMap() const {
-  return compressionCodecMap_.get();
+  auto& local = *compressionCodecMap_;
+  const auto version = version_.load(std::memory_order_acquire);
+  if (local.generations.empty() || local.version != version) {
+    // Codecs allocate large state; build them on the main context to
+    // stay off the fiber stack.
+    local.generations.emplace_back(folly::fibers::runInMainContext([this]() {
+      std::lock_guard<std::mutex> lock(configLock_);
+      return std::unique_ptr<CompressionCodecMap>(buildCodecMapLocked());
+    }));
+    local.version = version;
+  }
+  return local.generations.back().get();
 }
 
-CompressionCodecMap* CompressionCodecManager::buildCodecMap() {
+CompressionCodecMap* CompressionCodecManager::buildCodecMapLocked() const {
   if (size_ == 0) {
     return new CompressionCodecMap();
   }
@@ -141,6 +169,14 @@ CompressionCodecMap::CompressionCodecMap(
   }
 }
 
+void CompressionCodecMap::limitCompressionLevel(uint32_t maxLevel) const
+    noexcept {
+  for (const auto& codec : codecs_) {
+    codec->setEffectiveCompressionLevel(
+        std::min(codec->compressionLevel(), maxLevel));
+  }
+}
+
 CompressionCodec* CompressionCodecMap::get(uint32_t id) const noexcept {
   if (id < firstId_ || index(id) >= size()) {
     return nullptr;
@@ -9,9 +9,11 @@
  */
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -58,21 +60,53 @@ class CompressionCodecManager {
       std::unordered_map<uint32_t, CodecConfigPtr> codecConfigs);
 
   /**
-   * Return the compression codec map.
+   * Return the compression codec map of the calling thread, rebuilding
+   * it first if the codec configs changed since the last call.
    * Note: thread-safe.
    */
   const CompressionCodecMap* getCodecMap() const;
 
+  /**
+   * Replace the set of codec configs (e.g. on a dictionary rollover
+   * delivered through config update).
+   *
+   * Each thread picks up the new generation on its next getCodecMap()
+   * call. Maps built from older generations are kept alive, so codec
+   * pointers cached by connections that negotiated before the rollover
+   * stay valid and old codec ids keep decoding in-flight replies.
+   * Note: thread-safe.
+   */
+  void updateCodecConfigs(
+      std::unordered_map<uint32_t, CodecConfigPtr> codecConfigs);
+
  private:
+  // Per-thread codec maps, one per config generation seen by the
+  // thread; back() is the current one. Codecs are not thread-safe, and
+  // old generations must survive for decode (see updateCodecConfigs()).
+  struct ThreadLocalMaps {
+    uint64_t version{0};
+    std::vector<std::unique_ptr<CompressionCodecMap>> generations;
+  };
+
+  // Guards codecConfigs_ and the id range below; taken on config
+  // rollover and when a thread (re)builds its map.
+  mutable std::mutex configLock_;
   // Storage of compression codec configs (codecId -> codecConfig).
   std::unordered_map<uint32_t, CodecConfigPtr> codecConfigs_;
-  // ThreadLocal of compression codec map, as codecs are not thread-safe.
-  folly::ThreadLocal<CompressionCodecMap> compressionCodecMap_;
+  folly::ThreadLocal<ThreadLocalMaps> compressionCodecMap_;
   // Codec id range
   uint32_t smallestCodecId_{0};
   uint32_t size_{0};
+  // Bumped on every config update; threads compare against their
+  // ThreadLocalMaps::version to notice a rollover.
+  std::atomic<uint64_t> version_{1};
 
-  CompressionCodecMap* buildCodecMap();
+  /**
+   * Drops invalid codec configs and recomputes the contiguous id range.
+   * Note: caller must hold configLock_.
+   */
+  void validateConfigsLocked();
+  CompressionCodecMap* buildCodecMapLocked() const;
 };
 
 
@@ -113,6 +147,15 @@ class CompressionCodecMap {
        const size_t bodySize,
        const size_t typeId) const noexcept;
 
+  /**
+   * Caps the effective compression level of every codec in this map at
+   * min(the codec's configured level, maxLevel). Used by adaptive
+   * compression to shed CPU when the owning thread is falling behind.
+   * Note: codecs are not thread-safe; call this only from the thread
+   * that owns this map (see CompressionCodecManager::getCodecMap()).
+   */
+  void limitCompressionLevel(uint32_t maxLevel) const noexcept;
+
   /**
    * Returns the size of this map.
    */
@@ -0,0 +1,169 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "CompressionDictionaryTrainer.h"
+
+#include <glog/logging.h>
+
+#include <folly/Memory.h>
+
+#ifdef MCROUTER_HAVE_ZDICT
+#include <zdict.h>
+#endif
+
+namespace facebook {
+namespace memcache {
+
+constexpr size_t CompressionDictionaryTrainer::kSampleRate;
+constexpr size_t CompressionDictionaryTrainer::kMaxSampleSize;
+constexpr size_t CompressionDictionaryTrainer::kMaxStagedSamples;
+constexpr size_t CompressionDictionaryTrainer::kReservoirSize;
+constexpr size_t CompressionDictionaryTrainer::kMinSamplesToTrain;
+constexpr size_t CompressionDictionaryTrainer::kDictionarySize;
+constexpr uint32_t CompressionDictionaryTrainer::kCompressionLevel;
+
+bool CompressionDictionaryTrainer::isSupported() noexcept {
+#ifdef MCROUTER_HAVE_ZDICT
+  return true;
+#else
+  return false;
+#endif
+}
+
+void CompressionDictionaryTrainer::sample(
+    const folly::IOBuf& value, size_t typeId) noexcept {
+  if (sampleClock_.fetch_add(1, std::memory_order_relaxed) % kSampleRate != 0) {
+    return;
+  }
+  const auto length = value.computeChainDataLength();
+  if (length == 0 || length > kMaxSampleSize) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(stagingLock_, std::try_to_lock);
+  if (!lock.owns_lock() || staging_.size() >= kMaxStagedSamples) {
+    return;
+  }
+  StagedSample sample;
+  sample.typeId = typeId;
+  sample.value.reserve(length);
+  for (const auto range : value) {
+    sample.value.append(
+        reinterpret_cast<const char*>(range.data()), range.size());
+  }
+  staging_.push_back(std::move(sample));
+}
+
+void CompressionDictionaryTrainer::foldStagedSamples(
+    std::vector<StagedSample> staged) {
+  for (auto& sample : staged) {
+    auto& reservoir = reservoirs_[sample.typeId];
+    ++reservoir.seen;
+    ++reservoir.fresh;
+    if (reservoir.samples.size() < kReservoirSize) {
+      reservoir.samples.push_back(std::move(sample.value));
+    } else {
+      const auto slot = std::uniform_int_distribution<size_t>(
+          0, reservoir.seen - 1)(rng_);
+      if (slot < kReservoirSize) {
+        reservoir.samples[slot] = std::move(sample.value);
+      }
+    }
+  }
+}
+
+std::unordered_map<uint32_t, CodecConfigPtr>
+CompressionDictionaryTrainer::train() {
+  std::vector<StagedSample> staged;
+  {
+    std::lock_guard<std::mutex> lock(stagingLock_);
+    staged.swap(staging_);
+  }
+  foldStagedSamples(std::move(staged));
+
+  bool retrained = false;
+  for (auto& it : reservoirs_) {
+    auto& reservoir = it.second;
+    if (reservoir.samples.size() < kMinSamplesToTrain ||
+        reservoir.fresh * 4 < reservoir.samples.size()) {
+      continue;
+    }
+    auto dictionary = trainFromReservoir(reservoir);
+    reservoir.fresh = 0;
+    if (dictionary.empty()) {
+      continue;
+    }
+    dictionaries_[it.first] = std::move(dictionary);
+    retrained = true;
+  }
+  if (!retrained) {
+    return std::unordered_map<uint32_t, CodecConfigPtr>();
+  }
+
+  // Roll out the full dictionary set under a fresh contiguous id range.
+  std::unordered_map<uint32_t, CodecConfigPtr> codecConfigs;
+  for (const auto& it : dictionaries_) {
+    FilteringOptions filteringOptions;
+    filteringOptions.typeId = it.first;
+    const auto id = nextCodecId_++;
+    codecConfigs.emplace(
+        id,
+        folly::make_unique<CodecConfig>(
+            id,
+            CompressionCodecType::ZSTD,
+            it.second,
+            filteringOptions,
+            kCompressionLevel));
+  }
+  return codecConfigs;
+}
+
+#ifdef MCROUTER_HAVE_ZDICT
+
+std::string CompressionDictionaryTrainer::trainFromReservoir(
+    const Reservoir& reservoir) {
+  size_t totalSize = 0;
+  for (const auto& sample : reservoir.samples) {
+    totalSize += sample.size();
+  }
+  std::string buffer;
+  buffer.reserve(totalSize);
+  std::vector<size_t> sampleSizes;
+  sampleSizes.reserve(reservoir.samples.size());
+  for (const auto& sample : reservoir.samples) {
+    buffer.append(sample);
+    sampleSizes.push_back(sample.size());
+  }
+
+  std::string dictionary(kDictionarySize, '\0');
+  const auto result = ZDICT_trainFromBuffer(
+      &dictionary[0],
+      dictionary.size(),
+      buffer.data(),
+      sampleSizes.data(),
+      sampleSizes.size());
+  if (ZDICT_isError(result)) {
+    LOG(WARNING) << "Compression dictionary training failed: "
+                 << ZDICT_getErrorName(result);
+    return std::string();
+  }
+  dictionary.resize(result);
+  return dictionary;
+}
+
+#else
+
+std::string CompressionDictionaryTrainer::trainFromReservoir(
+    const Reservoir& /* reservoir */) {
+  return std::string();
+}
+
+#endif // MCROUTER_HAVE_ZDICT
+
+} // memcache
+} // facebook
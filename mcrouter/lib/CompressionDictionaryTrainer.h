@@ -0,0 +1,121 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/io/IOBuf.h>
+
+#include "mcrouter/lib/CompressionCodecManager.h"
+
+namespace facebook {
+namespace memcache {
+
+/**
+ * Trains compression dictionaries online from sampled reply values.
+ *
+ * Proxy threads offer values through sample(), which keeps a small
+ * bounded staging buffer. A background thread periodically calls
+ * train(): staged values are folded into one reservoir per typeId and,
+ * once a reservoir has accumulated enough fresh data, a zstd dictionary
+ * is trained over it with zdict. The resulting codec configs are meant
+ * to be passed to CompressionCodecManager::updateCodecConfigs(), which
+ * rolls them out without invalidating codecs still in use, so
+ * compression ratios track the value mix without offline retraining.
+ *
+ * Requires a build with zdict (see MCROUTER_HAVE_ZDICT); without it,
+ * isSupported() is false and train() never produces anything.
+ */
+class CompressionDictionaryTrainer {
+ public:
+  CompressionDictionaryTrainer() = default;
+
+  /**
+   * Whether this build can train dictionaries (i.e. was linked against
+   * a libzstd that provides zdict).
+   */
+  static bool isSupported() noexcept;
+
+  /**
+   * Offer a reply value for sampling. Called on the request hot path
+   * from any proxy thread: keeps only every kSampleRate-th call, and
+   * drops the sample instead of blocking when the staging buffer is
+   * contended or full.
+   */
+  void sample(const folly::IOBuf& value, size_t typeId) noexcept;
+
+  /**
+   * Folds staged samples into the per-typeId reservoirs and trains a
+   * new dictionary for every typeId with enough fresh data. If any
+   * typeId retrained, returns configs for the full dictionary set
+   * (latest dictionary of every typeId) under a fresh contiguous id
+   * range; codec ids are never reused, so codecs of older generations
+   * stay unambiguous. Returns an empty map if nothing was ready.
+   *
+   * Training takes tens of milliseconds per dictionary; call it only
+   * from a single background thread, never from a proxy thread.
+   */
+  std::unordered_map<uint32_t, CodecConfigPtr> train();
+
+ private:
+  // Keep roughly one value in kSampleRate; bounds hot path overhead.
+  static constexpr size_t kSampleRate = 64;
+  // Values larger than this are not worth a dictionary anyway.
+  static constexpr size_t kMaxSampleSize = 16 * 1024;
+  static constexpr size_t kMaxStagedSamples = 256;
+  static constexpr size_t kReservoirSize = 1024;
+  // Train a typeId once its reservoir holds this many samples and at
+  // least a quarter of them arrived since it last trained.
+  static constexpr size_t kMinSamplesToTrain = 128;
+  static constexpr size_t kDictionarySize = 64 * 1024;
+  static constexpr uint32_t kCompressionLevel = 1;
+
+  struct StagedSample {
+    size_t typeId;
+    std::string value;
+  };
+
+  // Classic reservoir (algorithm R) over the sampled values of one
+  // typeId, so long-lived typeIds keep a uniform sample of their
+  // recent traffic without unbounded memory.
+  struct Reservoir {
+    std::vector<std::string> samples;
+    size_t seen{0};
+    // Samples folded in since this typeId last trained.
+    size_t fresh{0};
+  };
+
+  // Rate-limits sample() across all proxy threads.
+  std::atomic<uint64_t> sampleClock_{0};
+
+  // Guards staging_; sample() only ever try-locks it.
+  std::mutex stagingLock_;
+  std::vector<StagedSample> staging_;
+
+  // Everything below is touched only from the training thread.
+  std::unordered_map<size_t, Reservoir> reservoirs_;
+  // Latest trained dictionary per typeId; re-emitted wholesale on every
+  // rollover, since updateCodecConfigs() replaces the full config set.
+  std::unordered_map<size_t, std::string> dictionaries_;
+  uint32_t nextCodecId_{1};
+  std::mt19937 rng_{std::random_device()()};
+
+  void foldStagedSamples(std::vector<StagedSample> staged);
+  std::string trainFromReservoir(const Reservoir& reservoir);
+};
+
+} // memcache
+} // facebook
@@ -64,6 +64,25 @@ class IovecCursor {
    */
   void readInto(uint8_t* dest, size_t size);
 
+  /**
+   * Number of bytes readable at rawData() before the next iovec seam
+   * (0 only when positioned on an empty iovec or at the end).
+   */
+  inline size_t contiguousLength() const {
+    return curBufLen_;
+  }
+
+  /**
+   * Raw pointer to the byte at the current position, valid for
+   * contiguousLength() bytes.  Lets hot loops pin a contiguous window
+   * and run unchecked word-at-a-time reads, paying for seam handling
+   * only when the window ends.
+   */
+  inline const uint8_t* rawData() const {
+    return reinterpret_cast<const uint8_t*>(iov_[iovIndex_].iov_base) +
+        curBufPos_;
+  }
+
   /**
    * Get the total length of this cursor (i.e. the sum of the length of
    * all iovecs).
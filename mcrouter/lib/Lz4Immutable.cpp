@@ -9,6 +9,9 @@
  */
 #include "Lz4Immutable.h"
 
+#include <sys/mman.h>
+
+#include <new>
 #include <type_traits>
 
 #include <folly/Bits.h>
@@ -73,6 +76,60 @@ struct iovec getDictionaryIovec(const Lz4ImmutableState& state) noexcept {
   return iov;
 }
 
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+void freeStateMapping(void* buf, void* userData) {
+  munmap(buf, reinterpret_cast<size_t>(userData));
+}
+
+/**
+ * Maps a 2MB-aligned anonymous region of `size` (rounded up to a
+ * hugepage) and advises the kernel to back it with a transparent
+ * hugepage.  The advice is best effort: without THP the region simply
+ * stays on 4KB pages.
+ */
+void* mapStateBlock(size_t& size) {
+  size = (size + kHugePageSize - 1) & ~(kHugePageSize - 1);
+  void* raw = mmap(
+      nullptr,
+      size + kHugePageSize,
+      PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS,
+      -1,
+      0);
+  if (raw == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  /* Trim the mapping down to an aligned `size`: THP only backs ranges
+     aligned to the hugepage size. */
+  const uintptr_t rawAddr = reinterpret_cast<uintptr_t>(raw);
+  const uintptr_t base = (rawAddr + kHugePageSize - 1) & ~(kHugePageSize - 1);
+  if (base > rawAddr) {
+    munmap(raw, base - rawAddr);
+  }
+  const uintptr_t end = rawAddr + size + kHugePageSize;
+  if (end > base + size) {
+    munmap(reinterpret_cast<void*>(base + size), end - (base + size));
+  }
+#if defined(MADV_HUGEPAGE)
+  madvise(reinterpret_cast<void*>(base), size, MADV_HUGEPAGE);
+#endif
+  return reinterpret_cast<void*>(base);
+}
+
+/**
+ * Warm the first lines of the hash table and the dictionary before the
+ * main loop needs them.
+ */
+void prefetchState(const Lz4ImmutableState& state) noexcept {
+  const auto* table = reinterpret_cast<const char*>(state.table);
+  const auto* dic = reinterpret_cast<const char*>(state.dictionary->data());
+  for (size_t i = 0; i < 4; ++i) {
+    __builtin_prefetch(table + i * 64);
+    __builtin_prefetch(dic + i * 64);
+  }
+}
+
 Lz4ImmutableState loadDictionary(std::unique_ptr<folly::IOBuf> dictionary) {
   if (!dictionary) {
     throw std::invalid_argument("Dictionary cannot be nullptr.");
@@ -92,13 +149,27 @@ Lz4ImmutableState loadDictionary(std::unique_ptr<folly::IOBuf> dictionary) {
   }
 
   Lz4ImmutableState state;
-  state.dictionary = std::move(dictionary);
-  state.table.fill(0);
+  size_t mapSize = sizeof(Hashtable) + dicSize;
+  auto* block = reinterpret_cast<uint8_t*>(mapStateBlock(mapSize));
+  state.table = reinterpret_cast<Hashtable*>(block);
+  state.table->fill(0);
+  std::memcpy(block + sizeof(Hashtable), dictionary->data(), dicSize);
+
+  /* The IOBuf owns the whole mapping but exposes only the dictionary
+     bytes behind the hash table. */
+  state.dictionary = folly::IOBuf::takeOwnership(
+      block,
+      mapSize,
+      mapSize,
+      freeStateMapping,
+      reinterpret_cast<void*>(mapSize));
+  state.dictionary->trimStart(sizeof(Hashtable));
+  state.dictionary->trimEnd(mapSize - sizeof(Hashtable) - dicSize);
 
   struct iovec dicIov = getDictionaryIovec(state);
   IovecCursor dicCursor(&dicIov, 1);
   while (dicCursor.tell() <= dicSize - kHashUnit) {
-    putPosition(state.table, dicCursor);
+    putPosition(*state.table, dicCursor);
     dicCursor.advance(3);
   }
 
@@ -111,20 +182,18 @@ Lz4ImmutableState loadDictionary(std::unique_ptr<folly::IOBuf> dictionary) {
  * Note: cursor will point just past its current position + "count"
  */
 void safeCopy(uint8_t* dest, IovecCursor& source, size_t count) {
-  int64_t left = count;
-  uint64_t src;
-  do {
-    size_t toWrite = std::min(8l, left);
-    if (LIKELY(toWrite == sizeof(uint64_t))) {
-      src = source.peek<uint64_t>();
-    } else {
-      source.peekInto(reinterpret_cast<uint8_t*>(&src), toWrite);
+  while (count > 0) {
+    const size_t chunk = std::min(count, source.contiguousLength());
+    if (UNLIKELY(chunk == 0)) {
+      /* Empty iovec under the cursor; let readInto() walk past it. */
+      source.readInto(dest, count);
+      return;
     }
-    std::memcpy(dest, &src, toWrite);
-    dest += toWrite;
-    source.advance(toWrite);
-    left -= toWrite;
-  } while (left > 0);
+    std::memcpy(dest, source.rawData(), chunk);
+    dest += chunk;
+    source.advance(chunk);
+    count -= chunk;
+  }
 }
 
 /**
@@ -135,6 +204,19 @@ void safeCopy(uint8_t* dest, IovecCursor& source, size_t count) {
  * 7 bytes.
  */
 void wildCopy(uint8_t* dest, IovecCursor& cursor, size_t count) {
+  if (LIKELY(cursor.contiguousLength() >= count + sizeof(uint64_t))) {
+    /* The whole copy (including the trailing overwrite) fits in the
+       pinned window: plain word-at-a-time copy, one cursor update. */
+    const uint8_t* src = cursor.rawData();
+    const uint8_t* destEnd = dest + count;
+    do {
+      std::memcpy(dest, src, sizeof(uint64_t));
+      dest += sizeof(uint64_t);
+      src += sizeof(uint64_t);
+    } while (dest < destEnd);
+    cursor.advance(count);
+    return;
+  }
   const uint8_t* destEnd = dest + count;
   do {
     uint64_t src = cursor.read<uint64_t>();
@@ -188,8 +270,38 @@ size_t numCommonBytes(register size_t diff) {
 size_t
 calculateMatchLength(IovecCursor& source, IovecCursor& match, size_t limit) {
   const size_t start = source.tell();
-
-  while (LIKELY(source.tell() < limit - kStepSize - 1)) {
+  const size_t stepLimit = limit - kStepSize - 1;
+
+  while (LIKELY(source.tell() < stepLimit)) {
+    /* Pin contiguous windows of both cursors and compare word at a
+       time with no per-read seam checks. */
+    const size_t window =
+        std::min(source.contiguousLength(), match.contiguousLength());
+    if (LIKELY(window >= kStepSize)) {
+      const uint8_t* s = source.rawData();
+      const uint8_t* m = match.rawData();
+      const size_t base = source.tell();
+      size_t advanced = 0;
+      while (advanced + kStepSize <= window && base + advanced < stepLimit) {
+        uint64_t sourceWord;
+        uint64_t matchWord;
+        std::memcpy(&sourceWord, s + advanced, kStepSize);
+        std::memcpy(&matchWord, m + advanced, kStepSize);
+        const uint64_t diff = sourceWord ^ matchWord;
+        if (diff) {
+          advanced += numCommonBytes(diff);
+          source.advance(advanced);
+          match.advance(advanced);
+          return source.tell() - start;
+        }
+        advanced += kStepSize;
+      }
+      source.advance(advanced);
+      match.advance(advanced);
+      continue;
+    }
+    /* One of the cursors is within a word of a seam: single checked
+       step, which also moves the window past the seam. */
     uint64_t diff = match.peek<uint64_t>() ^ source.peek<uint64_t>();
     if (!diff) {
       source.advance(kStepSize);
@@ -238,9 +350,60 @@ std::unique_ptr<folly::IOBuf> Lz4Immutable::compress(
 std::unique_ptr<folly::IOBuf> Lz4Immutable::compress(
     const struct iovec* iov,
     size_t iovcnt) const noexcept {
+  const size_t maxOutputSize =
+      compressBound(IovecCursor::computeTotalLength(iov, iovcnt));
+  auto destination = folly::IOBuf::create(maxOutputSize);
+  destination->append(
+      compressTo(iov, iovcnt, destination->writableTail(), maxOutputSize));
+  return destination;
+}
+
+std::vector<std::unique_ptr<folly::IOBuf>> Lz4Immutable::compressBatch(
+    const std::vector<const folly::IOBuf*>& sources) const noexcept {
+  size_t maxOutputSize = 0;
+  for (const auto* source : sources) {
+    maxOutputSize += compressBound(source->computeChainDataLength());
+  }
+
+  // One allocation backs all compressed values; each result is a slice
+  // of it. The values are compressed back-to-back, so the dictionary and
+  // its hash table stay in cache across the whole batch.
+  auto destination = folly::IOBuf::create(maxOutputSize);
+  std::vector<std::unique_ptr<folly::IOBuf>> compressed;
+  compressed.reserve(sources.size());
+
+  size_t used = 0;
+  for (const auto* source : sources) {
+    auto iov = source->getIov();
+    const size_t compressedSize = compressTo(
+        iov.data(),
+        iov.size(),
+        destination->writableTail() + used,
+        maxOutputSize - used);
+
+    auto slice = destination->cloneOne();
+    slice->clear();
+    slice->advance(used);
+    slice->append(compressedSize);
+    compressed.push_back(std::move(slice));
+
+    used += compressedSize;
+  }
+  destination->append(used);
+  return compressed;
+}
+
+size_t Lz4Immutable::compressTo(
+    const struct iovec* iov,
+    size_t iovcnt,
+    uint8_t* output,
+    size_t maxOutputSize) const noexcept {
   IovecCursor source(iov, iovcnt);
   CHECK_LE(source.totalLength(), kMaxInputSize)
       << "Data too large to compress!";
+  assert(maxOutputSize >= compressBound(source.totalLength()));
+
+  prefetchState(state_);
 
   // Creates a match cursor - a cursor that will keep track of matches
   // found in the dictionary.
@@ -258,12 +421,6 @@ std::unique_ptr<folly::IOBuf> Lz4Immutable::compress(
   // Upper limit of where a match can go.
   const size_t matchLimit = source.totalLength() - kLastLiterals;
 
-  // Destination (compressed) buffer.
-  const size_t maxOutputSize = compressBound(source.totalLength());
-  auto destination = folly::IOBuf::create(maxOutputSize);
-
-  // Pointer to where the next compressed position should be written.
-  uint8_t* output = destination->writableTail();
   // Lower and upper limit to where the output buffer can go.
   const uint8_t* outputStart = output;
   const uint8_t* outputLimit = output + maxOutputSize;
@@ -313,7 +470,7 @@ std::unique_ptr<folly::IOBuf> Lz4Immutable::compress(
           break;
         }
 
-        uint32_t matchPos = getPositionOnHash(state_.table, hash);
+        uint32_t matchPos = getPositionOnHash(*state_.table, hash);
         match.seek(matchPos);
       } while (((match.tell() + dictionaryDiff) <=
                 source.tell()) ||
@@ -416,7 +573,7 @@ std::unique_ptr<folly::IOBuf> Lz4Immutable::compress(
     size_t lastRun = source.totalLength() - anchorCursor.tell();
 
     assert(
-        (output - destination->data()) + lastRun + 1 +
+        static_cast<size_t>(output - outputStart) + lastRun + 1 +
             ((lastRun + 255 - kRunMask) / 255) <=
         maxOutputSize);
 
@@ -434,8 +591,7 @@ std::unique_ptr<folly::IOBuf> Lz4Immutable::compress(
     output += lastRun;
   }
 
-  destination->append(output - outputStart);
-  return destination;
+  return output - outputStart;
 }
 
 std::unique_ptr<folly::IOBuf> Lz4Immutable::decompress(
@@ -449,6 +605,8 @@ std::unique_ptr<folly::IOBuf> Lz4Immutable::decompress(
     const struct iovec* iov,
     size_t iovcnt,
     size_t uncompressedSize) const noexcept {
+  prefetchState(state_);
+
   // Creates a match cursor - a cursor that will keep track of matches
   // found in the dictionary.
   struct iovec dicIov = getDictionaryIovec(state_);
@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include <vector>
+
 #include <folly/io/IOBuf.h>
 
 namespace facebook {
@@ -24,9 +26,16 @@ using Hashtable = std::array<uint16_t, kHashtableSize>;
 
 /**
  * Internal state of Lz4Immutable.
+ *
+ * The hash table and the dictionary bytes are laid out back to back in
+ * one anonymous mapping, 2MB-aligned and madvise'd for transparent
+ * hugepages: both are touched on every compression call, and a single
+ * hugepage TLB entry covers what would otherwise be ~20 scattered 4KB
+ * ones.  `dictionary` owns the mapping (its data points just past the
+ * hash table); `table` points at the front of it.
  */
 struct Lz4ImmutableState {
-  Hashtable table;
+  Hashtable* table{nullptr};
   std::unique_ptr<folly::IOBuf> dictionary;
 };
 
@@ -65,6 +74,21 @@ class Lz4Immutable {
   std::unique_ptr<folly::IOBuf> compress(const struct iovec* iov, size_t iovcnt)
       const noexcept;
 
+  /**
+   * Compress a batch of values in one call.
+   *
+   * Compressing the values back-to-back keeps the dictionary and its hash
+   * table warm in cache and pays for a single destination allocation, which
+   * matters when a batch carries many small values. Each returned buffer is
+   * a slice of that shared allocation, which stays alive for as long as any
+   * of the slices does.
+   *
+   * @param sources  Values to compress. Entries must not be null.
+   * @return         Compressed buffers, one per source value, in order.
+   */
+  std::vector<std::unique_ptr<folly::IOBuf>> compressBatch(
+      const std::vector<const folly::IOBuf*>& sources) const noexcept;
+
   /**
    * Decompress the data.
    *
@@ -84,6 +108,18 @@ class Lz4Immutable {
 
  private:
   const Lz4ImmutableState state_;
+
+  /**
+   * Compresses the data described by (iov, iovcnt) into a caller-provided
+   * buffer, which must be at least compressBound() of the data size.
+   *
+   * @return  Number of bytes written to output.
+   */
+  size_t compressTo(
+      const struct iovec* iov,
+      size_t iovcnt,
+      uint8_t* output,
+      size_t maxOutputSize) const noexcept;
 };
 
 } // memcache
@@ -9,7 +9,9 @@
  */
 #pragma once
 
-#include <ctype.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <folly/Range.h>
 
@@ -18,6 +20,25 @@
 
 namespace facebook { namespace memcache {
 
+namespace detail {
+
+#if defined(__SSE2__)
+/**
+ * @return true iff any of the 16 bytes starting at p is a space or a
+ *   control character.
+ */
+inline bool hasSpaceOrCtrl16(const char* p) {
+  auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  // Unsigned chunk[i] <= 0x20 covers all space and control characters
+  // except DEL, which is matched separately.
+  auto bad = _mm_cmpeq_epi8(_mm_min_epu8(chunk, _mm_set1_epi8(0x20)), chunk);
+  bad = _mm_or_si128(bad, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(0x7f)));
+  return _mm_movemask_epi8(bad) != 0;
+}
+#endif
+
+} // detail
+
 /**
  * Checks whether the given memcache key is valid.
  * The key must satisfy:
@@ -34,10 +55,30 @@ inline mc_req_err_t isKeyValid(folly::StringPiece key) {
     return mc_req_err_key_too_long;
   }
 
-  for (auto c : key) {
-    if (iscntrl(c) || isspace(c)) {
+  auto begin = key.begin();
+  auto end = key.end();
+#if defined(__SSE2__)
+  while (begin + 16 <= end) {
+    if (detail::hasSpaceOrCtrl16(begin)) {
+      return mc_req_err_space_or_ctrl;
+    }
+    begin += 16;
+  }
+  if (begin != end && key.size() >= 16) {
+    // Sub-block tail of a long key: reinspect the last 16 bytes rather
+    // than looping byte by byte (the overlap rechecks known-good bytes,
+    // which is harmless).
+    return detail::hasSpaceOrCtrl16(end - 16)
+      ? mc_req_err_space_or_ctrl
+      : mc_req_err_valid;
+  }
+#endif
+  while (begin != end) {
+    auto c = static_cast<uint8_t>(*begin);
+    if (c <= 0x20 || c == 0x7f) {
       return mc_req_err_space_or_ctrl;
     }
+    ++begin;
   }
 
   return mc_req_err_valid;
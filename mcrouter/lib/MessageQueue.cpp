@@ -12,9 +12,11 @@
 namespace facebook { namespace memcache {
 
 Notifier::Notifier(size_t noNotifyRate,
+                   size_t targetLatencyUs,
                    int64_t waitThreshold,
                    NowUsecFunc nowFunc) noexcept
     : noNotifyRate_(noNotifyRate),
+      targetLatencyUs_(targetLatencyUs),
       waitThreshold_(waitThreshold),
       nowFunc_(nowFunc),
       lastTimeUsec_(nowFunc_()),
@@ -36,23 +38,44 @@ bool Notifier::shouldNotifyRelaxed() noexcept {
 }
 
 void Notifier::maybeUpdatePeriod() noexcept {
-  if (noNotifyRate_ == 0) {
+  if (noNotifyRate_ == 0 && targetLatencyUs_ == 0) {
     return;
   }
 
   auto now = nowFunc_();
   if (now - lastTimeUsec_ > kUpdatePeriodUsec) {
-    auto secElapsed = (double)(now - lastTimeUsec_) / 1000000.0;
-    size_t notifyEvery = 1000000;
-    double msgPerSec = (double) curMessages_ / secElapsed;
-    double p = 1.0 - msgPerSec / noNotifyRate_;
-    if (p > 0.0) {
-      notifyEvery = 1.0 / p;
-    }
-    /* Notify on every request is worse than the default notification
-       logic, which is more efficient */
-    if (notifyEvery == 1) {
-      notifyEvery = 0;
+    size_t notifyEvery = 0;
+    if (targetLatencyUs_ != 0) {
+      /* A message waits at most (period - 1) inter-arrival gaps for the
+         one that triggers the notification, and then however long the
+         wakeup itself takes; spend on skipped notifications only the
+         part of the budget the wakeup leaves us. */
+      auto budgetUs =
+        (int64_t)targetLatencyUs_ -
+        wakeupLatencyUs_.load(std::memory_order_relaxed);
+      if (budgetUs > 0 && curMessages_ > 0) {
+        double interArrivalUs =
+          (double)(now - lastTimeUsec_) / curMessages_;
+        auto period = (size_t)(budgetUs / interArrivalUs) + 1;
+        /* Notify on every request is worse than the default notification
+           logic, which is more efficient */
+        if (period > 1) {
+          notifyEvery = period;
+        }
+      }
+    } else {
+      auto secElapsed = (double)(now - lastTimeUsec_) / 1000000.0;
+      notifyEvery = 1000000;
+      double msgPerSec = (double) curMessages_ / secElapsed;
+      double p = 1.0 - msgPerSec / noNotifyRate_;
+      if (p > 0.0) {
+        notifyEvery = 1.0 / p;
+      }
+      /* Notify on every request is worse than the default notification
+         logic, which is more efficient */
+      if (notifyEvery == 1) {
+        notifyEvery = 0;
+      }
     }
     period_ = notifyEvery;
     lastTimeUsec_ = now;
@@ -9,6 +9,10 @@
  */
 #pragma once
 
+#include <atomic>
+#include <mutex>
+#include <vector>
+
 #include <folly/FileUtil.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/EventFDWrapper.h>
@@ -33,6 +37,11 @@ class Notifier {
    *   100% of requests initially).
    *   If 0, this logic is disabled - we notify on every request.
    *
+   * @param targetLatencyUs  If nonzero, the notification period is
+   *   derived from measured message inter-arrival and wakeup latency
+   *   instead of noNotifyRate, so that a skipped notification adds at
+   *   most this many us of queueing latency (see maybeUpdatePeriod()).
+   *
    * @param waitThreshold  Force notification after this number of us
    *   passed since the queue was last drained.
    *   If 0, this logic is disabled.
@@ -40,6 +49,7 @@ class Notifier {
    * @param nowFunc  Function that returns current time in us.
    */
   Notifier(size_t noNotifyRate,
+           size_t targetLatencyUs,
            int64_t waitThresholdUs,
            NowUsecFunc nowFunc) noexcept;
 
@@ -52,13 +62,32 @@ class Notifier {
   }
 
   bool shouldNotify() noexcept {
-    return (state_.exchange(State::NOTIFIED) == State::EMPTY);
+    if (state_.exchange(State::NOTIFIED) == State::EMPTY) {
+      if (targetLatencyUs_ != 0) {
+        /* Timestamp the notification so the reader can measure how long
+           the eventfd wakeup actually takes. */
+        notifySentUs_.store(nowFunc_(), std::memory_order_relaxed);
+      }
+      return true;
+    }
+    return false;
   }
 
   bool shouldNotifyRelaxed() noexcept;
 
   template <class F>
   void drainWhileNonEmpty(F&& drainFunc) {
+    if (targetLatencyUs_ != 0) {
+      auto sentUs = notifySentUs_.exchange(-1, std::memory_order_relaxed);
+      if (sentUs >= 0) {
+        auto latency = nowFunc_() - sentUs;
+        auto avg = wakeupLatencyUs_.load(std::memory_order_relaxed);
+        wakeupLatencyUs_.store(
+          avg + (latency - avg) / kLatencySmoothing,
+          std::memory_order_relaxed);
+      }
+    }
+
     auto expected = State::READING;
     do {
       state_ = State::READING;
@@ -74,18 +103,42 @@ class Notifier {
     return noNotifyRate_;
   }
 
+  bool adaptivePeriod() const {
+    return targetLatencyUs_ != 0;
+  }
+
+  /**
+   * Smoothed delay between posting a notification and the reader
+   * starting its drain, in microseconds.  Only maintained when the
+   * adaptive period is enabled.  Can be read from any thread.
+   */
+  int64_t wakeupLatencyUs() const noexcept {
+    return wakeupLatencyUs_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Microseconds elapsed since the queue was last drained.
+   */
+  int64_t timeSinceLastDrainUs() const noexcept {
+    return nowFunc_() - waitStart_;
+  }
+
  private:
   const size_t noNotifyRate_;
+  const size_t targetLatencyUs_;
   const int64_t waitThreshold_;
   const NowUsecFunc nowFunc_;
   int64_t lastTimeUsec_;
   size_t curMessages_{0};
 
   static constexpr int64_t kUpdatePeriodUsec = 1000000;
+  static constexpr int64_t kLatencySmoothing = 16;
 
   std::atomic<size_t> FOLLY_ALIGN_TO_AVOID_FALSE_SHARING period_{0};
   std::atomic<size_t> FOLLY_ALIGN_TO_AVOID_FALSE_SHARING counter_{0};
   std::atomic<int64_t> FOLLY_ALIGN_TO_AVOID_FALSE_SHARING waitStart_;
+  std::atomic<int64_t> FOLLY_ALIGN_TO_AVOID_FALSE_SHARING notifySentUs_{-1};
+  std::atomic<int64_t> wakeupLatencyUs_{0};
 
   enum class State {
     EMPTY,
@@ -102,14 +155,19 @@ class MessageQueue {
   /**
    * Must be called from the event base thread.
    *
-   * @param capactiy  All queue storage is allocated upfront.
-   *   If queue is full, further writes will block.
+   * @param capactiy  Ring buffer storage allocated upfront, for each of
+   *   the two lanes (see blockingWritePriority()). Writes that find the
+   *   ring full spill into an unbounded side buffer instead of
+   *   blocking (see writeImpl()).
    * @param onMessage Called on every message from the event base thread.
    * @param noNotifyRate  Request rate at which we stop all per-request
    *   notifications.  At any rate from 0 to noNotifyRate, we linearly
    *   reduce the fraction of requests that get notified (starting from
    *   100% of requests initially).
    *   If 0, this logic is disabled - we notify on every request.
+   * @param targetLatencyUs  If nonzero, adapt the notification period
+   *   automatically so that skipped notifications add at most this many
+   *   us of queueing latency; takes precedence over noNotifyRate.
    * @param waitThreshold  Force notification after this number of us
    *   passed since the queue was last drained.
    *   If 0, this logic is disabled.
@@ -120,12 +178,14 @@ class MessageQueue {
   MessageQueue(size_t capacity,
                std::function<void(T&&)> onMessage,
                size_t noNotifyRate,
+               size_t targetLatencyUs,
                int64_t waitThreshold,
                Notifier::NowUsecFunc nowFunc,
                std::function<void()> notifyCallback)
-      : queue_(capacity),
+      : lane_(capacity),
+        priorityLane_(capacity),
         onMessage_(std::move(onMessage)),
-        notifier_(noNotifyRate, waitThreshold, nowFunc),
+        notifier_(noNotifyRate, targetLatencyUs, waitThreshold, nowFunc),
         handler_(*this),
         timeoutHandler_(*this),
         notifyCallback_(std::move(notifyCallback)) {
@@ -142,7 +202,7 @@ class MessageQueue {
     handler_.registerHandler(
       folly::EventHandler::READ | folly::EventHandler::PERSIST);
 
-    if (notifier_.noNotifyRate() > 0) {
+    if (notifier_.noNotifyRate() > 0 || notifier_.adaptivePeriod()) {
       timeoutHandler_.attachEventBase(&evb);
       timeoutHandler_.scheduleTimeout(kWakeupEveryMs);
     }
@@ -152,18 +212,52 @@ class MessageQueue {
     return notifier_.currentNotifyPeriod();
   }
 
+  /**
+   * Smoothed notification-to-drain delay in microseconds; 0 unless the
+   * adaptive notification period is enabled. Can be read from any thread.
+   */
+  int64_t wakeupLatencyUs() const noexcept {
+    return notifier_.wakeupLatencyUs();
+  }
+
   /**
    * Must be called from the event base thread.
    * Manually drains the queue, calling the callback on any remaining messages.
    * Note: the user must guarantee that the queue is empty on destruction.
    */
   void drain() {
+    // Gap since the previous drain; see avgDrainIntervalUs().
+    const auto gapUs = notifier_.timeSinceLastDrainUs();
+    const auto avg = avgDrainIntervalUs_.load(std::memory_order_relaxed);
+    avgDrainIntervalUs_.store(
+      avg + (gapUs - avg) / kDrainIntervalSmoothing,
+      std::memory_order_relaxed);
+
     notifier_.drainWhileNonEmpty(
       [this] () {
         drainImpl();
       });
   }
 
+  /**
+   * Exponentially smoothed interval between queue drains, in
+   * microseconds. The queue is drained once per event loop iteration
+   * that notices it, so this interval stretching well past the
+   * notification period means the event loop itself is falling behind.
+   * Can be read from any thread.
+   */
+  int64_t avgDrainIntervalUs() const noexcept {
+    return avgDrainIntervalUs_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Approximate number of messages written but not yet processed.
+   * Can be read from any thread.
+   */
+  size_t pendingMessages() const noexcept {
+    return pendingMessages_.load(std::memory_order_relaxed);
+  }
+
   ~MessageQueue() {
     handler_.unregisterHandler();
     if (efd_ >= 0) {
@@ -174,13 +268,14 @@ class MessageQueue {
   /**
    * Put a new element into the queue. Can be called from any thread.
    * Allows inplace construction of the message.
-   * Will block if queue is full until the reader catches up.
+   * Never blocks: if the ring is full the message is spilled to a side
+   * buffer drained by the reader.
    *
    * @return true if the notify event was posted
    */
   template <class... Args>
   void blockingWrite(Args&&... args) noexcept {
-    queue_.blockingWrite(std::forward<Args>(args)...);
+    writeImpl(lane_, std::forward<Args>(args)...);
     if (notifier_.shouldNotify()) {
       doNotify();
     }
@@ -188,15 +283,52 @@ class MessageQueue {
 
   template <class... Args>
   void blockingWriteRelaxed(Args&&... args) noexcept {
-    queue_.blockingWrite(std::forward<Args>(args)...);
+    writeImpl(lane_, std::forward<Args>(args)...);
     if (notifier_.shouldNotifyRelaxed()) {
       doNotify();
     }
   }
 
+  /**
+   * Same as blockingWrite(), but the message goes to the priority lane,
+   * which each drain processes before the regular one.  Intended for
+   * low-rate messages that must not queue behind request floods
+   * (invalidations, config and admin messages); these always notify,
+   * never relaxed.  Note that priority messages may overtake regular
+   * ones written earlier by the same producer.
+   */
+  template <class... Args>
+  void blockingWritePriority(Args&&... args) noexcept {
+    writeImpl(priorityLane_, std::forward<Args>(args)...);
+    if (notifier_.shouldNotify()) {
+      doNotify();
+    }
+  }
+
  private:
   static constexpr int64_t kWakeupEveryMs = 2;
-  folly::MPMCQueue<T> queue_;
+  static constexpr int64_t kDrainIntervalSmoothing = 16;
+
+  /**
+   * A ring buffer with its overflow storage.  The spill buffer absorbs
+   * bursts that outrun the ring: once a producer spills, all producers
+   * keep appending here (even if the ring has room again) until the
+   * reader drains it, so messages from one producer are never reordered
+   * around its own spilled ones within a lane.
+   */
+  struct Lane {
+    explicit Lane(size_t capacity) : ring(capacity) {}
+
+    folly::MPMCQueue<T> ring;
+    std::mutex spillMutex;
+    std::vector<T> spillQueue;
+    std::atomic<bool> spilled{false};
+  };
+
+  Lane lane_;
+  Lane priorityLane_;
+  std::atomic<int64_t> avgDrainIntervalUs_{0};
+  std::atomic<size_t> pendingMessages_{0};
   std::function<void(T&&)> onMessage_;
   Notifier notifier_;
 
@@ -250,13 +382,81 @@ class MessageQueue {
     }
   }
 
-  void drainImpl() {
+  template <class... Args>
+  void writeImpl(Lane& lane, Args&&... args) noexcept {
+    pendingMessages_.fetch_add(1, std::memory_order_relaxed);
+    if (!lane.spilled.load(std::memory_order_acquire)) {
+      if (lane.ring.write(std::forward<Args>(args)...)) {
+        return;
+      }
+      // Ring is full: absorb the burst in the spill buffer rather than
+      // spinning until the reader catches up. Under saturation this
+      // also batches producers behind one lock instead of having each
+      // of them fight for ring slots.
+    }
+    std::lock_guard<std::mutex> lock(lane.spillMutex);
+    lane.spillQueue.emplace_back(std::forward<Args>(args)...);
+    lane.spilled.store(true, std::memory_order_release);
+  }
+
+  void drainRing(Lane& lane) {
     T message;
-    while (queue_.read(message)) {
+    size_t drained = 0;
+    while (lane.ring.read(message)) {
       onMessage_(std::move(message));
       notifier_.bumpMessages();
+      ++drained;
+    }
+    if (drained > 0) {
+      pendingMessages_.fetch_sub(drained, std::memory_order_relaxed);
     }
   }
+
+  void drainLane(Lane& lane) {
+    drainRing(lane);
+    if (!lane.spilled.load(std::memory_order_acquire)) {
+      return;
+    }
+    std::vector<T> spill;
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(lane.spillMutex);
+        if (lane.spillQueue.empty()) {
+          // Only now may producers go back to the ring: anything they
+          // write there from here on is newer than every spilled
+          // message we've processed.
+          lane.spilled.store(false, std::memory_order_release);
+          // Swapping the drained vector back hands its capacity over,
+          // so a sustained overload doesn't regrow it on every spill.
+          lane.spillQueue.swap(spill);
+          break;
+        }
+        spill.swap(lane.spillQueue);
+      }
+      // A producer may have squeezed a message into the ring right
+      // before the spill flag went up; ring entries always predate the
+      // batch we just took, so process them first to keep per-producer
+      // order.
+      drainRing(lane);
+      for (auto& m : spill) {
+        onMessage_(std::move(m));
+        notifier_.bumpMessages();
+      }
+      if (!spill.empty()) {
+        pendingMessages_.fetch_sub(spill.size(), std::memory_order_relaxed);
+      }
+      spill.clear();
+    }
+  }
+
+  void drainImpl() {
+    // The priority lane first; a fresh notification restarts
+    // drainWhileNonEmpty()'s loop, so priority messages arriving while
+    // the regular lane is being drained are picked up before the next
+    // regular batch.
+    drainLane(priorityLane_);
+    drainLane(lane_);
+  }
 };
 
 }}  // facebook::memcache
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include <folly/Range.h>
+
+namespace facebook {
+namespace memcache {
+
+/**
+ * Bump-pointer allocator for request-lifetime temporaries (modified keys,
+ * shard split keys and similar short-lived buffers built while routing).
+ *
+ * Allocations are O(1) pointer bumps out of an inline buffer; if the inline
+ * buffer fills up, further allocations come from heap-allocated overflow
+ * blocks.  Nothing is freed individually: all memory is reclaimed at once
+ * by reset() or the destructor.  See fiber_local::getRequestArena() for the
+ * instance tied to the current request's fiber.
+ *
+ * Not thread safe.
+ */
+class RequestArena {
+ public:
+  RequestArena() = default;
+
+  RequestArena(const RequestArena&) = delete;
+  RequestArena& operator=(const RequestArena&) = delete;
+
+  /**
+   * Returns a pointer to `n` bytes valid until reset() or destruction.
+   * No alignment guarantees beyond 1 byte: this arena is meant for
+   * character data.
+   */
+  char* allocate(size_t n) {
+    if (n <= bufAvail()) {
+      auto p = bufPos_;
+      bufPos_ += n;
+      return p;
+    }
+    return allocateSlow(n);
+  }
+
+  /**
+   * Concatenates the given pieces into a single arena-allocated buffer
+   * and returns a range pointing to it.
+   */
+  folly::StringPiece concat(std::initializer_list<folly::StringPiece> pieces) {
+    size_t total = 0;
+    for (const auto piece : pieces) {
+      total += piece.size();
+    }
+    auto buf = allocate(total);
+    auto pos = buf;
+    for (const auto piece : pieces) {
+      std::memcpy(pos, piece.data(), piece.size());
+      pos += piece.size();
+    }
+    return folly::StringPiece(buf, total);
+  }
+
+  /**
+   * Invalidates all outstanding allocations, rewinds the inline buffer
+   * and frees any overflow blocks.
+   */
+  void reset() {
+    bufPos_ = buf_;
+    overflow_.clear();
+  }
+
+ private:
+  static constexpr size_t kInlineSize = 1024;
+
+  size_t bufAvail() const {
+    return buf_ + kInlineSize - bufPos_;
+  }
+
+  char* allocateSlow(size_t n) {
+    assert(n > bufAvail());
+    overflow_.emplace_back(new char[n]);
+    return overflow_.back().get();
+  }
+
+  char buf_[kInlineSize];
+  char* bufPos_{buf_};
+  std::vector<std::unique_ptr<char[]>> overflow_;
+};
+
+} // memcache
+} // facebook
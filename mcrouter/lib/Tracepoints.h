@@ -0,0 +1,56 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+/**
+ * USDT probes (SystemTap/bpftrace) on the request lifecycle, under the
+ * "mcrouter" provider. Compiled in when sys/sdt.h is available at build
+ * time (configure defines MCROUTER_HAVE_SDT); otherwise they expand to
+ * nothing. When no tracer is attached each probe is a single nop, so
+ * they are safe on the hot path.
+ *
+ * Probes:
+ *   request_parsed(session, reqid, op, key_ptr, key_len)
+ *     A request was parsed off a client connection. `session` and
+ *     `reqid` together identify the request within this process;
+ *     `op` is the mc_op_t. The key is passed as pointer/length so the
+ *     tracer decides whether to read or hash it.
+ *   request_routed(proxy_reqid, op, routing_key_hash, dest_idx)
+ *     The request was handed to a destination by DestinationRoute.
+ *     `dest_idx` is the destination's index within its pool.
+ *   reply_received(client, reqid, result)
+ *     A reply was parsed off a destination connection; `reqid` is the
+ *     AsyncMcClient request id, `result` the mc_res_t.
+ *   reply_written(session, reqid)
+ *     The reply was queued for write back to the client; pairs with
+ *     request_parsed on (session, reqid) for end-to-end latency.
+ */
+
+#ifdef MCROUTER_HAVE_SDT
+
+#include <sys/sdt.h>
+
+#define MCROUTER_PROBE_REQUEST_PARSED(session, reqid, op, key, keylen) \
+  DTRACE_PROBE5(mcrouter, request_parsed, session, reqid, op, key, keylen)
+#define MCROUTER_PROBE_REQUEST_ROUTED(reqid, op, keyhash, destidx) \
+  DTRACE_PROBE4(mcrouter, request_routed, reqid, op, keyhash, destidx)
+#define MCROUTER_PROBE_REPLY_RECEIVED(client, reqid, result) \
+  DTRACE_PROBE3(mcrouter, reply_received, client, reqid, result)
+#define MCROUTER_PROBE_REPLY_WRITTEN(session, reqid) \
+  DTRACE_PROBE2(mcrouter, reply_written, session, reqid)
+
+#else
+
+#define MCROUTER_PROBE_REQUEST_PARSED(session, reqid, op, key, keylen)
+#define MCROUTER_PROBE_REQUEST_ROUTED(reqid, op, keyhash, destidx)
+#define MCROUTER_PROBE_REPLY_RECEIVED(client, reqid, result)
+#define MCROUTER_PROBE_REPLY_WRITTEN(session, reqid)
+
+#endif
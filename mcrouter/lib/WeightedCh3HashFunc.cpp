@@ -45,6 +45,13 @@ std::vector<double> ch3wParseWeights(const folly::dynamic& json, size_t n) {
 size_t weightedCh3Hash(
   folly::StringPiece key, const std::vector<double>& weights) {
 
+  return weightedCh3Hash(
+    key, furc_key_hash(key.data(), key.size()), weights);
+}
+
+size_t weightedCh3Hash(folly::StringPiece key,
+                       uint64_t keyHash,
+                       const std::vector<double>& weights) {
   auto n = weights.size();
   checkLogic(n && n <= furc_maximum_pool_size(), "Invalid pool size: {}", n);
   size_t salt = 0;
@@ -52,7 +59,10 @@ size_t weightedCh3Hash(
   std::string saltedKey;
   auto originalKey = key;
   for (size_t i = 0; i < kNumTries; ++i) {
-    index = furc_hash(key.data(), key.size(), n);
+    /* Only the first try hashes the unsalted key, for which the caller
+       may have a memoized hash. */
+    index = i == 0 ? furc_hash_by_key_hash(keyHash, n)
+                   : furc_hash(key.data(), key.size(), n);
 
     /* Use 32-bit hash, but store in 64-bit ints so that
        we don't have to deal with overflows */
@@ -66,9 +76,15 @@ size_t weightedCh3Hash(
       return index;
     }
 
-    /* Change the key to rehash */
+    /* Change the key to rehash.  Reuse one buffer across rounds: only the
+       salt suffix changes, so just drop the previous round's digits. */
     auto s = salt++;
-    saltedKey = originalKey.str();
+    if (saltedKey.empty()) {
+      saltedKey.reserve(originalKey.size() + 4);
+      saltedKey.assign(originalKey.data(), originalKey.size());
+    } else {
+      saltedKey.resize(originalKey.size());
+    }
     do {
       saltedKey.push_back(char(s % 10) + '0');
       s /= 10;
@@ -92,4 +108,9 @@ size_t WeightedCh3HashFunc::operator()(folly::StringPiece key) const {
   return weightedCh3Hash(key, weights_);
 }
 
+size_t WeightedCh3HashFunc::operator()(folly::StringPiece key,
+                                       uint64_t keyHash) const {
+  return weightedCh3Hash(key, keyHash, weights_);
+}
+
 }}  // facebook::memcache
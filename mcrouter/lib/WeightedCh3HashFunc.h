@@ -53,6 +53,14 @@ std::vector<double> ch3wParseWeights(const folly::dynamic& json, size_t n);
 size_t weightedCh3Hash(
   folly::StringPiece key, const std::vector<double>& weights);
 
+/**
+ * Same, but reuses a precomputed furc_key_hash() of the key for the
+ * first (unsalted) try; later tries rehash the salted key as usual.
+ */
+size_t weightedCh3Hash(folly::StringPiece key,
+                       uint64_t keyHash,
+                       const std::vector<double>& weights);
+
 class WeightedCh3HashFunc {
  public:
   /**
@@ -65,6 +73,12 @@ class WeightedCh3HashFunc {
 
   size_t operator()(folly::StringPiece key) const;
 
+  /**
+   * Variant taking the key's memoized furc_key_hash()
+   * (carbon::Keys::routingKeyFurcHash()).
+   */
+  size_t operator()(folly::StringPiece key, uint64_t keyHash) const;
+
   /**
    * @return Saved weights.
    */
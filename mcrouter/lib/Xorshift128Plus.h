@@ -0,0 +1,81 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <random>
+
+namespace facebook { namespace memcache {
+
+/**
+ * xorshift128+ pseudo-random generator: a few ns per draw, 16 bytes of
+ * state, no locking.  Meant for routing decisions (random child pick,
+ * sampling, jitter) that are rolled on the request path; NOT suitable
+ * for anything security sensitive.
+ *
+ * Satisfies UniformRandomBitGenerator, so it can also feed the standard
+ * <random> distributions where those are already in use.
+ */
+class Xorshift128Plus {
+ public:
+  using result_type = uint64_t;
+
+  Xorshift128Plus() : Xorshift128Plus(std::random_device()()) {}
+
+  explicit Xorshift128Plus(uint64_t seed) {
+    /* Expand the seed with splitmix64 so that nearby (or zero) seeds
+       still produce well-mixed, non-zero state words. */
+    state_[0] = splitmix64(seed);
+    state_[1] = splitmix64(seed);
+  }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()() {
+    uint64_t s1 = state_[0];
+    const uint64_t s0 = state_[1];
+    state_[0] = s0;
+    s1 ^= s1 << 23;
+    state_[1] = s1 ^ s0 ^ (s1 >> 18) ^ (s0 >> 5);
+    return state_[1] + s0;
+  }
+
+  /**
+   * Random integer in [0, n).  Uses the multiply-shift reduction, which
+   * avoids the division of `% n`; the bias is on the order of n / 2^32
+   * and irrelevant for routing purposes.
+   */
+  uint32_t randomInt(uint32_t n) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>((*this)())) * n) >> 32;
+  }
+
+  /**
+   * Random double in [0, 1), using the top 53 bits of one draw.
+   */
+  double randomDouble() {
+    return ((*this)() >> 11) * (1.0 / (1ULL << 53));
+  }
+
+ private:
+  uint64_t state_[2];
+
+  static uint64_t splitmix64(uint64_t& x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+};
+
+}} // facebook::memcache
@@ -9,6 +9,8 @@
  */
 #include "ZstdCompressionCodec.h"
 
+#include <algorithm>
+
 #if FOLLY_HAVE_LIBZSTD
 
 namespace facebook {
@@ -26,6 +28,7 @@ ZstdCompressionCodec::ZstdCompressionCodec(
           codecCompressionLevel),
       dictionary_(std::move(dictionary)),
       compressionLevel_(codecCompressionLevel),
+      effectiveCompressionLevel_(codecCompressionLevel),
       zstdCContext_(ZSTD_createCCtx(), ZSTD_freeCCtx),
       zstdDContext_(ZSTD_createDCtx(), ZSTD_freeDCtx),
       zstdCDict_(
@@ -48,6 +51,25 @@ ZstdCompressionCodec::ZstdCompressionCodec(
   }
 }
 
+void ZstdCompressionCodec::setEffectiveCompressionLevel(uint32_t level) {
+  const int newLevel = std::max(1, static_cast<int>(level));
+  if (newLevel == effectiveCompressionLevel_) {
+    return;
+  }
+  UPtr<ZSTD_CDict> cdict(
+      ZSTD_createCDict(
+          reinterpret_cast<const char*>(dictionary_->data()),
+          dictionary_->length(),
+          newLevel),
+      ZSTD_freeCDict);
+  if (cdict == nullptr) {
+    // Keep compressing at the current level.
+    return;
+  }
+  zstdCDict_ = std::move(cdict);
+  effectiveCompressionLevel_ = newLevel;
+}
+
 std::unique_ptr<folly::IOBuf> ZstdCompressionCodec::compress(
     const struct iovec* iov,
     size_t iovcnt) {
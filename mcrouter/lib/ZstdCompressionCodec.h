@@ -36,12 +36,20 @@ class ZstdCompressionCodec : public CompressionCodec {
       size_t iovcnt,
       size_t uncompressedLength = 0) override final;
 
+  /**
+   * Rebuilds the compression dictionary at the given level (clamped to
+   * at least 1). Cheap when the level is unchanged; on failure to build
+   * the dictionary, the current level is kept.
+   */
+  void setEffectiveCompressionLevel(uint32_t level) override final;
+
  private:
   template <class T>
   using UPtr = std::unique_ptr<T, size_t(*)(T*)>;
 
   const std::unique_ptr<folly::IOBuf> dictionary_;
   int compressionLevel_{1};
+  int effectiveCompressionLevel_{1};
 
   UPtr<ZSTD_CCtx> zstdCContext_;
   UPtr<ZSTD_DCtx> zstdDContext_;
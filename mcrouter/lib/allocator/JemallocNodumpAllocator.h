@@ -61,6 +61,7 @@ class JemallocNodumpAllocator {
                            unsigned arena_ind);
 
   void extend_and_setup_arena();
+  void setup_arena_decay();
 
   unsigned arena_index_{0};
   int flags_{0};
@@ -9,6 +9,9 @@
  */
 #include <string>
 
+#include <folly/Conv.h>
+#include <folly/json.h>
+
 #include "mcrouter/lib/carbon/Keys.h"
 
 namespace carbon {
@@ -155,6 +158,206 @@ class ToDynamicVisitor {
   }
 };
 
+class ToJsonVisitor {
+ public:
+  ToJsonVisitor(std::string& out, FollyDynamicConversionOptions opts)
+      : out_(out), opts_(opts) {}
+
+  void begin() {
+    out_.push_back('{');
+  }
+
+  void end() {
+    out_.push_back('}');
+  }
+
+  template <class T>
+  bool enterMixin(uint16_t id, folly::StringPiece name, const T& value) {
+    if (!opts_.inlineMixins) {
+      key("__" + name.str());
+      appendStruct(value);
+      return false;
+    } else {
+      return true;
+    }
+  }
+
+  bool leaveMixin() {
+    return true;
+  }
+
+  template <class T>
+  bool visitField(uint16_t id, folly::StringPiece name, const T& value) {
+    field(name, value);
+    return true;
+  }
+
+ private:
+  std::string& out_;
+  FollyDynamicConversionOptions opts_;
+  folly::json::serialization_opts jsonOpts_;
+  bool first_{true};
+
+  // Detect Carbon generated structures by presence of visitFields method.
+  template <class M>
+  class IsCarbonStruct {
+    template <class T>
+    static auto check(int x) -> decltype(
+        std::declval<T>().visitFields(std::declval<ToJsonVisitor>()),
+        char());
+    template <class T> static int check(...);
+   public:
+    static constexpr bool value = sizeof(check<M>(0)) == sizeof(char);
+  };
+
+  void key(folly::StringPiece name) {
+    if (!first_) {
+      out_.push_back(',');
+    }
+    first_ = false;
+    escape(name);
+    out_.push_back(':');
+  }
+
+  // escapeString() appends the surrounding quotes itself
+  void escape(folly::StringPiece sp) {
+    folly::json::escapeString(sp, out_, jsonOpts_);
+  }
+
+  template <class T>
+  void appendStruct(const T& value) {
+    ToJsonVisitor visitor(out_, opts_);
+    visitor.begin();
+    value.visitFields(visitor);
+    visitor.end();
+  }
+
+  // Unset Optionals are omitted, and a field whose value turns out to be
+  // unserializable (with such fields configured off) is rolled back after
+  // its key has already been written.
+  template <class T>
+  void field(folly::StringPiece name, const folly::Optional<T>& value) {
+    if (value.hasValue()) {
+      field(name, *value);
+    }
+  }
+
+  template <class T>
+  void field(folly::StringPiece name, const T& value) {
+    const auto sizeBefore = out_.size();
+    const bool firstBefore = first_;
+    key(name);
+    if (!append(value)) {
+      out_.resize(sizeBefore);
+      first_ = firstBefore;
+    }
+  }
+
+  // The append() overloads return false iff nothing should be emitted for
+  // this value.
+  bool append(const bool b) {
+    out_.append(b ? "true" : "false");
+    return true;
+  }
+
+  bool append(const char c) {
+    escape(folly::StringPiece(&c, 1));
+    return true;
+  }
+
+  bool append(const folly::IOBuf& value) {
+    if (value.isChained()) {
+      auto copy = value;
+      escape(folly::StringPiece(copy.coalesce()));
+    } else {
+      escape(folly::StringPiece(folly::ByteRange(value.data(),
+                                                 value.length())));
+    }
+    return true;
+  }
+
+  template <class T>
+  bool append(const Keys<T>& value) {
+    escape(value.fullKey());
+    return true;
+  }
+
+  template <class T>
+  bool append(const std::vector<T>& value) {
+    out_.push_back('[');
+    bool firstElem = true;
+    for (const auto& v : value) {
+      if (!firstElem) {
+        out_.push_back(',');
+      }
+      firstElem = false;
+      if (!append(v)) {
+        out_.append("null");
+      }
+    }
+    out_.push_back(']');
+    return true;
+  }
+
+  template <class T>
+  typename std::enable_if<std::is_arithmetic<T>::value, bool>::type
+  append(const T& value) {
+    folly::toAppend(value, &out_);
+    return true;
+  }
+
+  template <class T>
+  typename std::enable_if<!std::is_arithmetic<T>::value, bool>::type
+  append(const T& value) {
+    return append2(value);
+  }
+
+  template <class T>
+  typename std::enable_if<IsCarbonStruct<T>::value, bool>::type
+  append2(const T& value) {
+    appendStruct(value);
+    return true;
+  }
+
+  template <class T>
+  typename std::enable_if<!IsCarbonStruct<T>::value, bool>::type
+  append2(const T& value) {
+    return append3(value);
+  }
+
+  template <class T>
+  typename std::enable_if<std::is_enum<T>::value, bool>::type
+  append3(const T& value) {
+    folly::toAppend(static_cast<int64_t>(value), &out_);
+    return true;
+  }
+
+  template <class T>
+  typename std::enable_if<!std::is_enum<T>::value, bool>::type
+  append3(const T& value) {
+    return append4(value);
+  }
+
+  template <class T>
+  typename std::enable_if<std::is_convertible<T, folly::StringPiece>::value,
+                          bool>::type
+  append4(const T& value) {
+    escape(folly::StringPiece(value));
+    return true;
+  }
+
+  template <class T>
+  typename std::enable_if<!std::is_convertible<T, folly::StringPiece>::value,
+                          bool>::type
+  append4(const T& value) {
+    if (!opts_.ignoreUnserializableTypes) {
+      escape("(not serializable)");
+      return true;
+    }
+    return false;
+  }
+};
+
 } // detail
 
 template <class Message>
@@ -165,4 +368,14 @@ folly::dynamic convertToFollyDynamic(const Message& m,
   return visitor.moveOutput();
 }
 
+template <class Message>
+void convertToJson(const Message& m,
+                   std::string& out,
+                   FollyDynamicConversionOptions opts) {
+  detail::ToJsonVisitor visitor(out, opts);
+  visitor.begin();
+  m.visitFields(visitor);
+  visitor.end();
+}
+
 } // carbon
@@ -45,6 +45,20 @@ folly::dynamic convertToFollyDynamic(
     const Message& m,
     FollyDynamicConversionOptions opts = FollyDynamicConversionOptions());
 
+/**
+ * Streaming counterpart of convertToFollyDynamic(): renders the message as
+ * JSON directly into out, with no intermediate folly::dynamic tree and no
+ * allocations beyond growing out, so it's cheap enough for sampled
+ * inspection of live traffic.  Values match what
+ * folly::toJson(convertToFollyDynamic(m, opts)) would produce; fields
+ * appear in visitFields() order.
+ */
+template <class Message>
+void convertToJson(
+    const Message& m,
+    std::string& out,
+    FollyDynamicConversionOptions opts = FollyDynamicConversionOptions());
+
 } // carbon
 
 #include "CarbonMessageConversionUtils-inl.h"
@@ -9,8 +9,30 @@
  */
 #include "CarbonProtocolReader.h"
 
+#include <folly/Varint.h>
+
 namespace carbon {
 
+void CarbonProtocolReader::skipVarint() {
+  // We only need to find the end of the varint, not its value, so scan
+  // for the terminator byte (high bit clear) in the current buffer and
+  // hop over the whole run at once.
+  const auto peeked = cursor_.peek();
+  const size_t limit =
+      std::min<size_t>(peeked.second, folly::kMaxVarintLength64);
+  for (size_t i = 0; i < limit; ++i) {
+    if (!(peeked.first[i] & 0x80)) {
+      cursor_.skip(i + 1);
+      return;
+    }
+  }
+  // Varint spans an IOBuf boundary (or is malformed); nothing was
+  // consumed above, so just walk it byte by byte.
+  uint8_t iter = 0;
+  while ((readByte() & 0x80) && ++iter < folly::kMaxVarintLength64) {
+  }
+}
+
 void CarbonProtocolReader::skip(const FieldType ft) {
   switch (ft) {
     case FieldType::True:
@@ -18,39 +40,57 @@ void CarbonProtocolReader::skip(const FieldType ft) {
       break;
     }
     case FieldType::Int8: {
-      readRaw<int8_t>();
-      break;
-    }
-    case FieldType::Int16: {
-      readRaw<int16_t>();
-      break;
-    }
-    case FieldType::Int32: {
-      readRaw<int32_t>();
+      cursor_.skip(sizeof(int8_t));
       break;
     }
+    case FieldType::Int16:
+    case FieldType::Int32:
     case FieldType::Int64: {
-      readRaw<int64_t>();
+      skipVarint();
       break;
     }
     case FieldType::Double: {
-      readRaw<double>();
+      cursor_.skip(sizeof(uint64_t));
       break;
     }
     case FieldType::Float: {
-      readRaw<float>();
+      cursor_.skip(sizeof(uint32_t));
       break;
     }
     case FieldType::Binary: {
-      readRaw<std::string>();
+      // Hop over the payload without touching (or copying) its bytes
+      cursor_.skip(readVarint<uint32_t>());
       break;
     }
     case FieldType::List: {
       const auto pr = readVectorFieldSizeAndInnerType();
       const auto fieldType = pr.first;
       const auto len = pr.second;
-      for (size_t i = 0; i < len; ++i) {
-        skip(fieldType);
+      switch (fieldType) {
+        // Fixed-width runs reduce to one cursor skip over the whole list
+        case FieldType::True:
+        case FieldType::False:
+        case FieldType::Int8:
+          cursor_.skip(len);
+          break;
+        case FieldType::Float:
+          cursor_.skip(len * sizeof(uint32_t));
+          break;
+        case FieldType::Double:
+          cursor_.skip(len * sizeof(uint64_t));
+          break;
+        case FieldType::Int16:
+        case FieldType::Int32:
+        case FieldType::Int64:
+          for (size_t i = 0; i < len; ++i) {
+            skipVarint();
+          }
+          break;
+        default:
+          for (size_t i = 0; i < len; ++i) {
+            skip(fieldType);
+          }
+          break;
       }
       break;
     }
@@ -17,6 +17,7 @@
 #include <utility>
 #include <vector>
 
+#include <folly/Likely.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/small_vector.h>
@@ -143,11 +144,25 @@ class CarbonProtocolReader {
   }
 
   void readRawInto(std::string& s) {
-    s = cursor_.readFixedString(readVarint<uint32_t>());
+    const auto len = readVarint<uint32_t>();
+    if (len == 0) {
+      s.clear();
+      return;
+    }
+    s = cursor_.readFixedString(len);
   }
 
+  // The payload is not copied: buf is set up as a slice sharing the
+  // underlying receive buffer, and the serializer appends such IOBufs by
+  // reference, so values pass through mcrouter without touching their
+  // bytes.
   void readRawInto(folly::IOBuf& buf) {
-    cursor_.clone(buf, readVarint<uint32_t>());
+    const auto len = readVarint<uint32_t>();
+    if (len == 0) {
+      buf = folly::IOBuf();
+      return;
+    }
+    cursor_.clone(buf, len);
   }
 
   void readStructBegin() {
@@ -191,6 +206,9 @@ class CarbonProtocolReader {
   void skip(const FieldType fieldType);
 
  private:
+  // Advances the cursor past one varint without decoding its value
+  void skipVarint();
+
   uint8_t readByte() {
     return cursor_.template read<uint8_t>();
   }
@@ -217,6 +235,25 @@ class CarbonProtocolReader {
         sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8,
         "readVarint() may only be used with 16-, 32-, or 64-bit integers");
 
+    // Fast path: if the whole varint is guaranteed to lie in the current
+    // buffer, decode through a local pointer and advance the cursor once,
+    // avoiding a cursor bounds check per byte.
+    // (kMaxIters + 1 covers the malformed case where the loop consumes
+    // one byte past the longest valid encoding, as the slow path would.)
+    const auto peeked = cursor_.peek();
+    if (LIKELY(peeked.second > kMaxIters)) {
+      const uint8_t* p = peeked.first;
+      UnsignedT urv = 0;
+      uint8_t iter = 0;
+      uint8_t byte;
+      do {
+        byte = p[iter];
+        urv |= static_cast<UnsignedT>(byte & 0x7f) << (kShift * iter++);
+      } while (byte & 0x80 && iter <= kMaxIters);
+      cursor_.skip(iter);
+      return static_cast<T>(urv);
+    }
+
     UnsignedT urv = 0;
     uint8_t iter = 0;
     uint8_t byte;
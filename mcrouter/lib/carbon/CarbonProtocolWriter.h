@@ -333,7 +333,7 @@ class CarbonProtocolWriter {
  private:
   template <class T>
   void doWriteVarint(T val) {
-    constexpr uint8_t kMaxIters = (sizeof(T) * 8 + 6) / 7;
+    constexpr uint8_t kMaxBytes = (sizeof(T) * 8 + 6) / 7;
 
     static_assert(
         std::is_unsigned<T>::value,
@@ -343,16 +343,24 @@ class CarbonProtocolWriter {
         sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8,
         "writeVarint() may only be used with 16-, 32-, or 64-bit integers");
 
-    uint8_t iter = 0;
-    // While loop should consume at most (kMaxIters - 1) iterations
-    while (val >= 0x80 && ++iter < kMaxIters) {
-      uint8_t byte = 0x80 | (static_cast<uint8_t>(val) & 0x7f);
-      appender_.write(byte);
+    if (val < 0x80) {
+      // Single-byte varints (small ints, results, most flags) dominate
+      appender_.write(static_cast<uint8_t>(val));
+      return;
+    }
+
+    // Encode into a local buffer and hand the appender the whole run at
+    // once, rather than paying a push() (bounds check + 1-byte memcpy)
+    // per continuation byte.  The loop self-terminates within kMaxBytes
+    // iterations since val shrinks by 7 bits each round.
+    uint8_t buf[kMaxBytes];
+    size_t len = 0;
+    while (val >= 0x80) {
+      buf[len++] = 0x80 | (static_cast<uint8_t>(val) & 0x7f);
       val >>= 7;
     }
-    facebook::memcache::checkRuntime(
-        val < 0x80, "writeVarint() called on invalid varint");
-    appender_.write(static_cast<uint8_t>(val));
+    buf[len++] = static_cast<uint8_t>(val);
+    appender_.push(buf, len);
   }
 
   template <class T>
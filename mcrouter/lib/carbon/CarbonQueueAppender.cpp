@@ -11,8 +11,53 @@
 
 #include <cstring>
 
+#include <folly/ThreadLocal.h>
+
 namespace carbon {
 
+namespace {
+
+/**
+ * Serialization is single-threaded per storage object (it lives with the
+ * session/client on one worker thread), so a per-thread free list of
+ * fixed-size scratch blocks is enough to make overflow allocation-free
+ * in steady state.
+ */
+constexpr size_t kMaxFreeOverflowBlocks = 16;
+
+folly::ThreadLocal<std::vector<std::unique_ptr<uint8_t[]>>> overflowBlockPool;
+
+} // anonymous
+
+uint8_t* CarbonQueueAppenderStorage::acquireOverflowBlock() {
+  auto& pool = *overflowBlockPool;
+  std::unique_ptr<uint8_t[]> block;
+  if (pool.empty()) {
+    block.reset(new uint8_t[kOverflowBlockSize]);
+  } else {
+    block = std::move(pool.back());
+    pool.pop_back();
+  }
+  overflowBlocks_.push_back(std::move(block));
+  return overflowBlocks_.back().get();
+}
+
+void CarbonQueueAppenderStorage::releaseOverflowBlocks() {
+  storageBase_ = storage_;
+  storageCapacity_ = sizeof(storage_);
+  if (overflowBlocks_.empty()) {
+    return;
+  }
+  auto& pool = *overflowBlockPool;
+  for (auto& block : overflowBlocks_) {
+    if (pool.size() >= kMaxFreeOverflowBlocks) {
+      break;
+    }
+    pool.push_back(std::move(block));
+  }
+  overflowBlocks_.clear();
+}
+
 void CarbonQueueAppenderStorage::coalesce() {
   VLOG(4) << "Out of iovecs, coalescing in Caret message serialization";
   assert(nIovsUsed_ == kMaxIovecs);
@@ -36,6 +81,10 @@ void CarbonQueueAppenderStorage::coalesce() {
     newBuf.append(iovs_[i].iov_len);
   }
 
+  // All scratch data has been copied into newBuf, so the overflow blocks
+  // can go back to the pool and push() can start over from inline storage.
+  releaseOverflowBlocks();
+
   // Release old IOBufs and reset head to new large buffer
   head_ = std::move(newBuf);
   ++nIovsUsed_;
@@ -11,8 +11,10 @@
 
 #include <sys/uio.h>
 
+#include <memory>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <folly/Bits.h>
 #include <folly/io/IOBuf.h>
@@ -31,11 +33,28 @@ class CarbonQueueAppenderStorage {
     iovs_[0] = {headerBuf_, 0};
   }
 
+  ~CarbonQueueAppenderStorage() {
+    releaseOverflowBlocks();
+  }
+
   CarbonQueueAppenderStorage(const CarbonQueueAppenderStorage&) = delete;
   CarbonQueueAppenderStorage& operator=(const CarbonQueueAppenderStorage&) =
       delete;
 
   void append(const folly::IOBuf& buf) {
+    if (buf.empty()) {
+      return;
+    }
+
+    // Small unchained buffers (most hit values) are copied into the
+    // scratch region instead of referenced: the reply then rides in one
+    // contiguous iovec with no IOBuf cloning or refcount traffic, which
+    // outweighs the memcpy at this size.
+    if (!buf.isChained() && buf.length() <= kCopyThreshold) {
+      push(buf.data(), buf.length());
+      return;
+    }
+
     finalizeLastIovec();
 
     if (nIovsUsed_ == kMaxIovecs) {
@@ -55,9 +74,6 @@ class CarbonQueueAppenderStorage {
         head_->prependChain(buf.clone());
       }
     } else {
-      if (buf.empty()) {
-        return;
-      }
       appendSlow(buf);
     }
 
@@ -75,29 +91,60 @@ class CarbonQueueAppenderStorage {
 
     assert(nIovsUsed_ < kMaxIovecs);
 
-    if (storageIdx_ + len <= sizeof(storage_)) {
-      if (!canUsePreviousIov_) {
-        // Note, we will be updating iov_len once we're done with this iovec,
-        // i.e. in finalizeLastIovec()
-        iovs_[nIovsUsed_++].iov_base = &storage_[storageIdx_];
-
-        // If the next push() comes before the next append(), and if we still
-        // have room left in storage_,  then we can just extend the last iovec
-        // used since we will write to storage_ where we left off.
-        canUsePreviousIov_ = true;
+    if (storageIdx_ + len > storageCapacity_) {
+      if (len > kOverflowBlockSize) {
+        // Doesn't fit even a fresh scratch block; fall back to an IOBuf.
+        appendNoInline(folly::IOBuf(folly::IOBuf::COPY_BUFFER, buf, len));
+        return;
       }
+      // Current scratch region (inline storage or the latest overflow
+      // block) is full.  Switch to a fresh block from the per-thread
+      // pool and keep writing there; the block is handed back on reset().
+      finalizeLastIovec();
+      storageBase_ = acquireOverflowBlock();
+      storageCapacity_ = kOverflowBlockSize;
+      storageIdx_ = 0;
+      canUsePreviousIov_ = false;
+    }
 
-      std::memcpy(&storage_[storageIdx_], buf, len);
-      storageIdx_ += len;
-    } else {
-      appendNoInline(folly::IOBuf(folly::IOBuf::COPY_BUFFER, buf, len));
+    if (!canUsePreviousIov_) {
+      // Note, we will be updating iov_len once we're done with this iovec,
+      // i.e. in finalizeLastIovec()
+      iovs_[nIovsUsed_++].iov_base = &storageBase_[storageIdx_];
+
+      // If the next push() comes before the next append(), and if we still
+      // have room left in the scratch region, then we can just extend the
+      // last iovec used since we will write where we left off.
+      canUsePreviousIov_ = true;
     }
+
+    std::memcpy(&storageBase_[storageIdx_], buf, len);
+    storageIdx_ += len;
   }
 
   void coalesce();
 
+  /**
+   * Hint from the serializer about how many scratch bytes the upcoming
+   * message needs at most (see carbon::util::estimateScratchSize()).  If
+   * the remaining scratch space can't hold it, switch to a fresh overflow
+   * block now, so the message's non-IOBuf data lands in one contiguous
+   * iovec instead of spilling to a new region mid-field.
+   */
+  void reserve(size_t bytes) {
+    if (storageIdx_ + bytes <= storageCapacity_ || bytes > kOverflowBlockSize) {
+      return;
+    }
+    finalizeLastIovec();
+    storageBase_ = acquireOverflowBlock();
+    storageCapacity_ = kOverflowBlockSize;
+    storageIdx_ = 0;
+    canUsePreviousIov_ = false;
+  }
+
   void reset() {
     storageIdx_ = 0;
+    releaseOverflowBlocks();
     head_.clear();
     // Reserve first element of iovs_ for header, which won't be filled in
     // until after body data is serialized.
@@ -133,9 +180,28 @@ class CarbonQueueAppenderStorage {
     iovs_[0].iov_len = headerSize;
   }
 
+  /**
+   * Points this storage's body iovecs at another storage's already
+   * serialized body, so fan-out legs can share one serialization (see
+   * CaretSerializedMessage::prepare()).  Only the header iovec stays
+   * local.  The caller must keep `other` alive and unmodified for as
+   * long as this storage references it.
+   */
+  void referenceBody(CarbonQueueAppenderStorage& other) {
+    assert(nIovsUsed_ == 1 && storageIdx_ == 0);
+    const auto iovs = other.getIovecs();
+    for (size_t i = 1; i < iovs.second; ++i) {
+      iovs_[nIovsUsed_++] = iovs.first[i];
+    }
+  }
+
  private:
   static constexpr size_t kMaxIovecs{32};
 
+  // IOBuf fields at most this long are copied into the scratch region
+  // by append() rather than referenced.
+  static constexpr size_t kCopyThreshold{192};
+
   // Copied from UmbrellaProtocol.h, which will eventually die
   static constexpr size_t kMaxAdditionalFields = 3;
   static constexpr size_t kMaxHeaderLength = 1 /* magic byte */ +
@@ -144,6 +210,12 @@ class CarbonQueueAppenderStorage {
       2 * kMaxAdditionalFields *
           folly::kMaxVarintLength64; /* key and value for additional fields */
 
+  // Scratch blocks pulled from a per-thread pool once storage_ fills up;
+  // typical lease-get reply headers overflow the inline buffer, and this
+  // recycles that overflow space instead of allocating an IOBuf per
+  // overflowing field.
+  static constexpr size_t kOverflowBlockSize{4096};
+
   size_t storageIdx_{0};
   size_t nIovsUsed_{1};
   bool canUsePreviousIov_{false};
@@ -154,6 +226,12 @@ class CarbonQueueAppenderStorage {
   // data
   uint8_t storage_[512];
 
+  // Region push() currently writes into: starts out as the inline
+  // storage_, then moves through overflow blocks as they fill up.
+  uint8_t* storageBase_{storage_};
+  size_t storageCapacity_{sizeof(storage_)};
+  std::vector<std::unique_ptr<uint8_t[]>> overflowBlocks_;
+
   // The first iovec in iovs_ points to Caret message header data, and nothing
   // else. The remaining iovecs are used for the message body. Note that we do
   // not share iovs_[0] with body data, even if it would be possible, e.g., we
@@ -184,11 +262,17 @@ class CarbonQueueAppenderStorage {
     }
   }
 
+  uint8_t* acquireOverflowBlock();
+
+  // Returns overflow blocks to the per-thread pool and points the scratch
+  // region back at the inline storage.
+  void releaseOverflowBlocks();
+
   void finalizeLastIovec() {
     if (canUsePreviousIov_) {
       auto& iov = iovs_[nIovsUsed_ - 1];
-      iov.iov_len =
-          &storage_[storageIdx_] - static_cast<const uint8_t*>(iov.iov_base);
+      iov.iov_len = &storageBase_[storageIdx_] -
+          static_cast<const uint8_t*>(iov.iov_base);
     }
   }
 };
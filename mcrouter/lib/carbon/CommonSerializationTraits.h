@@ -39,7 +39,12 @@ struct SerializationTraits<Keys<Storage>> {
 template <class T>
 struct SerializationTraits<folly::Optional<T>> {
   static folly::Optional<T> read(carbon::CarbonProtocolReader& reader) {
-    return folly::Optional<T>(reader.readRaw<T>());
+    // Deserialize in place rather than through a temporary T, so e.g. an
+    // IOBuf value is cloned straight into its final resting place.
+    folly::Optional<T> opt;
+    opt.emplace();
+    reader.readRawInto(*opt);
+    return opt;
   }
 
   static void write(
@@ -13,34 +13,41 @@
 namespace carbon {
 
 template <class Storage>
-Keys<Storage>::Keys(const Keys<Storage>& other) : key_(other.key_) {
-  initStringPieces(other);
+Keys<Storage>::Keys(const Keys<Storage>& other) {
+  copyFrom(other);
 }
 
 template <class Storage>
 Keys<Storage>& Keys<Storage>::operator=(const Keys<Storage>& other) {
   if (this != &other) {
-    key_ = other.key_;
-    initStringPieces(other);
+    copyFrom(other);
   }
   return *this;
 }
 
 template <class Storage>
-Keys<Storage>::Keys(Keys<Storage>&& other) noexcept
-    : key_(std::move(other.key_)) {
-  initStringPieces(other);
+Keys<Storage>::Keys(Keys<Storage>&& other) noexcept {
+  moveFrom(other);
 }
 
 template <class Storage>
 Keys<Storage>& Keys<Storage>::operator=(Keys<Storage>&& other) noexcept {
   if (this != &other) {
-    key_ = std::move(other.key_);
-    initStringPieces(other);
+    moveFrom(other);
   }
   return *this;
 }
 
+template <class Storage>
+void Keys<Storage>::spliceKey(
+    size_t start,
+    size_t removeLen,
+    folly::StringPiece replacement) {
+  assert(start + removeLen <= size());
+  spliceKeyImpl(key_, start, removeLen, replacement);
+  update();
+}
+
 template <class Storage>
 void Keys<Storage>::update() {
   const folly::StringPiece key = fullKey();
@@ -66,6 +73,7 @@ void Keys<Storage>::update() {
     routingKey_.reset(keyWithoutRoute_.begin(), pos);
   }
   routingKeyHash_ = 0;
+  routingKeyFurcHash_ = 0;
 }
 
 } // carbon
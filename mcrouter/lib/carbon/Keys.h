@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include <cassert>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <type_traits>
@@ -17,6 +19,8 @@
 #include <folly/Range.h>
 #include <folly/SpookyHashV2.h>
 
+#include "mcrouter/lib/fbi/hash.h"
+
 namespace carbon {
 
 template <class Storage>
@@ -47,16 +51,16 @@ class Keys {
   constexpr Keys() = default;
 
   explicit Keys(Storage&& key) noexcept : key_(std::move(key)) {
+    maybeInline();
     update();
   }
 
-  explicit Keys(folly::StringPiece sp) : key_(makeKey<Storage>(sp)) {
+  explicit Keys(folly::StringPiece sp) {
+    assign(sp);
     update();
   }
 
-  explicit Keys(const char* key) : key_(makeKey<Storage>(key)) {
-    update();
-  }
+  explicit Keys(const char* key) : Keys(folly::StringPiece(key)) {}
 
   Keys(const Keys& other);
   Keys& operator=(const Keys& other);
@@ -65,18 +69,20 @@ class Keys {
 
   Keys& operator=(const Storage& key) {
     key_ = key;
+    maybeInline();
     update();
     return *this;
   }
 
   Keys& operator=(Storage&& key) noexcept {
     key_ = std::move(key);
+    maybeInline();
     update();
     return *this;
   }
 
   Keys& operator=(folly::StringPiece key) {
-    key_ = makeKey<Storage>(key);
+    assign(key);
     update();
     return *this;
   }
@@ -105,10 +111,35 @@ class Keys {
     return routingKeyHash_;
   }
 
+  /**
+   * Memoized furc_key_hash() of routingKey().  furc_hash() itself
+   * depends on the pool size, but its single pass over the key bytes
+   * does not; caching that pass here lets every consistent-hash lookup
+   * on this request (hash route, shadow pool, shard split child) reuse
+   * it through furc_hash_by_key_hash().
+   */
+  uint64_t routingKeyFurcHash() const {
+    if (!routingKeyFurcHash_) {
+      routingKeyFurcHash_ =
+          furc_key_hash(routingKey_.begin(), routingKey_.size());
+    }
+    return routingKeyFurcHash_;
+  }
+
   bool hasHashStop() const {
     return routingKey_.size() != keyWithoutRoute_.size();
   }
 
+  /**
+   * Replaces the `removeLen` bytes at offset `start` of the full key
+   * with `replacement` and re-derives the key pieces.  With IOBuf
+   * storage the result is assembled in the inline buffer whenever it
+   * fits, so the common small-delta rewrites (routing prefix swap,
+   * shard split suffix) make no allocation and no intermediate copy.
+   * `replacement` must not point into this key.
+   */
+  void spliceKey(size_t start, size_t removeLen, folly::StringPiece replacement);
+
   // Hack to save some CPU in DestinationRoute. Avoid if possible.
   void stripRoutingPrefix() {
     trimStart(routingPrefix().size());
@@ -125,8 +156,177 @@ class Keys {
   static constexpr bool usingStringStorage =
       std::is_same<Storage, std::string>::value;
 
+  /**
+   * Keys up to this many bytes are stored inline in the Keys object
+   * itself (IOBuf storage only; std::string has its own small-buffer
+   * optimization): key_ just wraps inline_ and no heap allocation
+   * happens.  Sized so the median production key fits comfortably.
+   */
+  static constexpr size_t kInlineCapacity = 47;
+
+  struct InlineBuffer {
+    char data[kInlineCapacity] = {};
+  };
+  struct NoInlineBuffer {};
+
   void update();
 
+  void assign(folly::StringPiece sp) {
+    assignImpl(key_, sp);
+  }
+
+  void assignImpl(std::string& s, folly::StringPiece sp) {
+    s = sp.str();
+  }
+
+  void assignImpl(folly::IOBuf& buf, folly::StringPiece sp) {
+    if (sp.size() <= kInlineCapacity) {
+      /* memmove: sp may point into our own inline buffer */
+      std::memmove(inline_.data, sp.data(), sp.size());
+      buf = folly::IOBuf(folly::IOBuf::WRAP_BUFFER, inline_.data, sp.size());
+    } else {
+      buf = folly::IOBuf(folly::IOBuf::COPY_BUFFER, sp.data(), sp.size());
+    }
+  }
+
+  /**
+   * If the storage holds a short heap- or shared-buffer key, copy it
+   * into the inline buffer and drop the original reference (for parser
+   * created keys this also releases the connection read buffer early).
+   */
+  void maybeInline() {
+    maybeInlineImpl(key_);
+  }
+
+  static void maybeInlineImpl(std::string&) {}
+
+  void maybeInlineImpl(folly::IOBuf& buf) {
+    if (!buf.isChained() && buf.length() <= kInlineCapacity &&
+        !isInlineImpl(buf)) {
+      std::memcpy(inline_.data, buf.data(), buf.length());
+      buf = folly::IOBuf(folly::IOBuf::WRAP_BUFFER, inline_.data, buf.length());
+    }
+  }
+
+  void spliceKeyImpl(std::string& s,
+                     size_t start,
+                     size_t removeLen,
+                     folly::StringPiece replacement) {
+    s.replace(start, removeLen, replacement.data(), replacement.size());
+  }
+
+  void spliceKeyImpl(folly::IOBuf& buf,
+                     size_t start,
+                     size_t removeLen,
+                     folly::StringPiece replacement) {
+    const size_t oldSize = buf.length();
+    const size_t tailPos = start + removeLen;
+    const size_t newSize = oldSize - removeLen + replacement.size();
+    const auto data = reinterpret_cast<const char*>(buf.data());
+    if (newSize <= kInlineCapacity) {
+      if (isInlineImpl(buf)) {
+        /* Rewrite within our own buffer: shift the tail (which may
+           overlap its destination, hence memmove), then drop the
+           replacement in. */
+        std::memmove(inline_.data + start + replacement.size(),
+                     inline_.data + tailPos,
+                     oldSize - tailPos);
+      } else {
+        /* The key bytes live elsewhere (e.g. a shared connection read
+           buffer we must not scribble on); assemble the result inline. */
+        std::memcpy(inline_.data, data, start);
+        std::memcpy(inline_.data + start + replacement.size(),
+                    data + tailPos,
+                    oldSize - tailPos);
+      }
+      std::memcpy(inline_.data + start, replacement.data(),
+                  replacement.size());
+      buf = folly::IOBuf(folly::IOBuf::WRAP_BUFFER, inline_.data, newSize);
+      return;
+    }
+    folly::IOBuf newBuf(folly::IOBuf::CREATE, newSize);
+    auto out = newBuf.writableTail();
+    std::memcpy(out, data, start);
+    std::memcpy(out + start, replacement.data(), replacement.size());
+    std::memcpy(out + start + replacement.size(),
+                data + tailPos,
+                oldSize - tailPos);
+    newBuf.append(newSize);
+    buf = std::move(newBuf);
+  }
+
+  bool isInline() const {
+    return isInlineImpl(key_);
+  }
+
+  static bool isInlineImpl(const std::string&) {
+    return false;
+  }
+
+  bool isInlineImpl(const folly::IOBuf& buf) const {
+    auto d = reinterpret_cast<const char*>(buf.data());
+    return d >= inline_.data && d < inline_.data + kInlineCapacity;
+  }
+
+  void copyFrom(const Keys& other) {
+    copyFromImpl(key_, other);
+  }
+
+  void copyFromImpl(std::string& s, const Keys& other) {
+    s = other.key_;
+    initStringPieces(other);
+  }
+
+  void copyFromImpl(folly::IOBuf& buf, const Keys& other) {
+    if (other.isInline()) {
+      adoptInline(other);
+    } else {
+      buf = other.key_;
+      copyStringPieces(other);
+    }
+  }
+
+  void moveFrom(Keys& other) {
+    moveFromImpl(key_, other);
+  }
+
+  void moveFromImpl(std::string& s, Keys& other) {
+    s = std::move(other.key_);
+    initStringPieces(other);
+  }
+
+  void moveFromImpl(folly::IOBuf& buf, Keys& other) {
+    if (other.isInline()) {
+      /* The bytes live in `other`; copy them into our own buffer.
+         `other` is left untouched and stays valid. */
+      adoptInline(other);
+    } else {
+      buf = std::move(other.key_);
+      copyStringPieces(other);
+    }
+  }
+
+  /**
+   * Copies other's key bytes into our inline buffer and re-points the
+   * StringPieces at it preserving their offsets (other may have had its
+   * routing prefix stripped, so rerunning update() would be wrong).
+   */
+  void adoptInline(const Keys& other) {
+    const auto full = other.fullKey();
+    assert(full.size() <= kInlineCapacity);
+    std::memcpy(inline_.data, full.data(), full.size());
+    key_ = folly::IOBuf(folly::IOBuf::WRAP_BUFFER, inline_.data, full.size());
+    const auto translate = [&](folly::StringPiece sp) {
+      return folly::StringPiece(
+          inline_.data + (sp.begin() - full.begin()), sp.size());
+    };
+    keyWithoutRoute_ = translate(other.keyWithoutRoute_);
+    routingPrefix_ = translate(other.routingPrefix_);
+    routingKey_ = translate(other.routingKey_);
+    routingKeyHash_ = other.routingKeyHash_;
+    routingKeyFurcHash_ = other.routingKeyFurcHash_;
+  }
+
   // Assumes that this->key_ has been set to the desired value that StringPiece
   // members of *this should point into.
   void initStringPieces(const Keys& other) {
@@ -144,6 +344,7 @@ class Keys {
     routingPrefix_ = other.routingPrefix_;
     routingKey_ = other.routingKey_;
     routingKeyHash_ = other.routingKeyHash_;
+    routingKeyFurcHash_ = other.routingKeyFurcHash_;
   }
 
   static size_t size(const folly::IOBuf& buf) { return buf.length(); }
@@ -165,10 +366,15 @@ class Keys {
   Storage key_;
 
  private:
+  typename std::
+      conditional<usingStringStorage, NoInlineBuffer, InlineBuffer>::type
+          inline_;
+
   folly::StringPiece keyWithoutRoute_;
   folly::StringPiece routingPrefix_;
   folly::StringPiece routingKey_;
   mutable uint32_t routingKeyHash_{0};
+  mutable uint64_t routingKeyFurcHash_{0};
 };
 
 } //carbon
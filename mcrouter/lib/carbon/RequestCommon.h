@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include <memory>
+
 #include "mcrouter/lib/Ref.h"
 
 #ifndef LIBMC_FBTRACE_DISABLE
@@ -17,6 +19,8 @@
 
 namespace carbon {
 
+class CarbonQueueAppenderStorage;
+
 class RequestCommon {
  public:
 #ifndef LIBMC_FBTRACE_DISABLE
@@ -30,6 +34,19 @@ class RequestCommon {
   }
   RequestCommon& operator=(const RequestCommon&) = delete;
 
+  RequestCommon(RequestCommon&&) = default;
+  RequestCommon& operator=(RequestCommon&&) = default;
+#else
+  RequestCommon() = default;
+
+  RequestCommon(const RequestCommon& other) : traceId_(other.traceId_) {}
+  RequestCommon& operator=(const RequestCommon& other) {
+    traceId_ = other.traceId_;
+    fanout_ = false;
+    serializedCaretBody_.reset();
+    return *this;
+  }
+
   RequestCommon(RequestCommon&&) = default;
   RequestCommon& operator=(RequestCommon&&) = default;
 #endif
@@ -42,6 +59,37 @@ class RequestCommon {
     traceId_ = carbonTraceId;
   }
 
+  /**
+   * Marks this request as being routed to several destinations without
+   * modification (AllSyncRoute, AllAsyncRoute, shadowing).  The first
+   * caret serialization of a marked request caches the serialized body
+   * here and the remaining legs reference it instead of re-serializing;
+   * see CaretSerializedMessage::prepare().  The body depends only on
+   * the message fields: per-destination data (request id, supported
+   * codecs) lives in the header, which every leg builds for itself.
+   *
+   * Only legs that see this very object share the body.  Copies may be
+   * modified en route, so neither the mark nor the cache survives
+   * copying.
+   */
+  void markFanout() const {
+    fanout_ = true;
+  }
+
+  bool isFanout() const {
+    return fanout_;
+  }
+
+  const std::shared_ptr<CarbonQueueAppenderStorage>&
+  serializedCaretBody() const {
+    return serializedCaretBody_;
+  }
+
+  void cacheSerializedCaretBody(
+      std::shared_ptr<CarbonQueueAppenderStorage> body) const {
+    serializedCaretBody_ = std::move(body);
+  }
+
 #ifndef LIBMC_FBTRACE_DISABLE
   mc_fbtrace_info_s* fbtraceInfo() const {
     return fbtraceInfo_.get();
@@ -57,6 +105,8 @@ class RequestCommon {
 
  private:
   uint64_t traceId_{0};
+  mutable std::shared_ptr<CarbonQueueAppenderStorage> serializedCaretBody_;
+  mutable bool fanout_{false};
 #ifndef LIBMC_FBTRACE_DISABLE
   struct McFbtraceRefPolicy {
     struct Deleter {
@@ -95,6 +95,26 @@ class CanHandleRequest {
     return {};
   }
 };
+
+// Utility class useful for checking whether a particular OnRequest handler
+// class defines a parseBatchEnd() flush hook.
+class CanHandleBatchEnd {
+  template <class O>
+  static constexpr auto check(int)
+      -> decltype(std::declval<O>().parseBatchEnd(), std::true_type()) {
+    return {};
+  }
+
+  template <class O>
+  static constexpr std::false_type check(...) {
+    return {};
+  }
+ public:
+  template <class OnRequest>
+  static constexpr auto value() -> decltype(check<OnRequest>(0)) {
+    return {};
+  }
+};
 } // detail
 
 } // carbon
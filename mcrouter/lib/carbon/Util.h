@@ -9,6 +9,17 @@
  */
 #pragma once
 
+#include <stdint.h>
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <folly/Optional.h>
+#include <folly/io/IOBuf.h>
+
+#include "mcrouter/lib/carbon/Keys.h"
+
 namespace carbon {
 namespace util {
 
@@ -36,5 +47,127 @@ inline int64_t unzigzag(const uint64_t i) {
   return (i >> 1) ^ -(i & 1);
 }
 
+namespace detail {
+
+/**
+ * Computes upper bounds on the serialized size of a Carbon message in one
+ * pass over the generated visitFields(), without serializing anything.
+ * Two counts are kept: the full wire size, and the portion that goes
+ * through CarbonQueueAppenderStorage scratch space (IOBuf-backed payloads
+ * are appended zero-copy and never touch scratch).
+ *
+ * Per-field bounds: a field header takes at most 3 bytes (type byte plus
+ * two id bytes), a zigzag varint of T at most (8 * sizeof(T) + 6) / 7
+ * bytes, and a binary field a 5-byte length varint plus its payload.
+ */
+class MessageSizeEstimator {
+ public:
+  template <class T>
+  typename std::
+      enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value, bool>::
+          type
+      visitField(int16_t /* id */, const char* /* name */, const T&) {
+    addScratch(kFieldHeaderBound + (8 * sizeof(T) + 6) / 7);
+    return true;
+  }
+
+  bool visitField(int16_t /* id */, const char* /* name */,
+                  const std::string& s) {
+    addScratch(kFieldHeaderBound + kLengthVarintBound + s.size());
+    return true;
+  }
+
+  bool visitField(int16_t /* id */, const char* /* name */,
+                  const folly::IOBuf& buf) {
+    addScratch(kFieldHeaderBound + kLengthVarintBound);
+    addAppended(buf.computeChainDataLength());
+    return true;
+  }
+
+  template <class T>
+  bool visitField(int16_t id, const char* name, const folly::Optional<T>& opt) {
+    if (opt.hasValue()) {
+      visitField(id, name, *opt);
+    }
+    return true;
+  }
+
+  template <class T>
+  bool visitField(int16_t /* id */, const char* /* name */,
+                  const Keys<T>& keys) {
+    addScratch(kFieldHeaderBound + kLengthVarintBound);
+    addAppended(keys.fullKey().size());
+    return true;
+  }
+
+  template <class T>
+  bool visitField(int16_t /* id */, const char* /* name */,
+                  const std::vector<T>& v) {
+    addScratch(kFieldHeaderBound + 1 + kLengthVarintBound);
+    for (const auto& e : v) {
+      addElement(e);
+    }
+    return true;
+  }
+
+  size_t wireSize() const {
+    return wireSize_;
+  }
+
+  size_t scratchSize() const {
+    return scratchSize_;
+  }
+
+ private:
+  static constexpr size_t kFieldHeaderBound = 3;
+  static constexpr size_t kLengthVarintBound = 5;
+
+  size_t wireSize_{0};
+  size_t scratchSize_{0};
+
+  template <class T>
+  typename std::enable_if<std::is_arithmetic<T>::value>::type addElement(
+      const T&) {
+    addScratch((8 * sizeof(T) + 6) / 7);
+  }
+
+  void addElement(const std::string& s) {
+    addScratch(kLengthVarintBound + s.size());
+  }
+
+  void addScratch(size_t n) {
+    wireSize_ += n;
+    scratchSize_ += n;
+  }
+
+  void addAppended(size_t n) {
+    wireSize_ += n;
+  }
+};
+
+} // detail
+
+/**
+ * Upper bound on the full serialized size of a Carbon message.
+ */
+template <class Message>
+size_t estimateSerializedSize(const Message& message) {
+  detail::MessageSizeEstimator estimator;
+  message.visitFields(estimator);
+  return estimator.wireSize() + 1 /* stop byte */;
+}
+
+/**
+ * Upper bound on the scratch-buffer bytes the message pushes through
+ * CarbonQueueAppenderStorage.  IOBuf payloads are excluded since they
+ * are appended as their own iovecs without copying.
+ */
+template <class Message>
+size_t estimateScratchSize(const Message& message) {
+  detail::MessageSizeEstimator estimator;
+  message.visitFields(estimator);
+  return estimator.scratchSize() + 1 /* stop byte */;
+}
+
 } // util
 } // carbon
@@ -9,6 +9,8 @@
  */
 #include <gtest/gtest.h>
 
+#include <folly/json.h>
+
 #include "mcrouter/lib/IOBufUtil.h"
 #include "mcrouter/lib/carbon/CarbonMessageConversionUtils.h"
 #include "mcrouter/lib/carbon/test/gen/CarbonTest.h"
@@ -95,3 +97,32 @@ TEST(CarbonMessageConversionUtils, toFollyDynamic_InlineMixins) {
   opts.inlineMixins = true;
   EXPECT_EQ(withInline, carbon::convertToFollyDynamic(s, opts));
 }
+
+TEST(CarbonMessageConversionUtils, toJson_MatchesFollyDynamic) {
+  carbon::test::TestRequest r;
+  r.baseInt64Member() = 1;
+  r.int32Member() = -1;
+  r.stringMember() = "testStrMbr";
+  r.key() = carbon::Keys<folly::IOBuf>("/test/key/");
+  r.testEnum() = carbon::test2::util::SimpleEnum::Negative;
+  r.testBool() = true;
+  r.testChar() = 'a';
+  r.testInt64() = -9876543210123ll;
+  r.testUInt64() = 9876543210123ll;
+  r.testShortString() = "needs \"escaping\"\n";
+  r.testIobuf() = folly::IOBuf(folly::IOBuf::CopyBufferOp(),
+                               folly::StringPiece("TestTheBuf"));
+  r.testStruct().baseInt64Member() = 345;
+  r.testOptionalString() = "tstOptStr";
+  r.testList() = std::vector<std::string>({"abc", "bce", "xyz"});
+
+  std::string json;
+  carbon::convertToJson(r, json);
+  EXPECT_EQ(carbon::convertToFollyDynamic(r), folly::parseJson(json));
+
+  carbon::FollyDynamicConversionOptions opts;
+  opts.inlineMixins = true;
+  json.clear();
+  carbon::convertToJson(r, json, opts);
+  EXPECT_EQ(carbon::convertToFollyDynamic(r, opts), folly::parseJson(json));
+}
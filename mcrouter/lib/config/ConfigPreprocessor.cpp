@@ -1627,6 +1627,9 @@ void ConfigPreprocessor::addMacro(StringPiece name,
                                   const vector<dynamic>& params,
                                   Macro::Func func,
                                   bool autoExpand) {
+  // A macro may be called while later definitions are still being parsed;
+  // results cached under a name that gets redefined would be stale.
+  macroCache_.clear();
   auto it = macros_.emplace(name, nullptr).first;
   it->second = folly::make_unique<Macro>(*this, it->first, params,
                                          std::move(func), autoExpand);
@@ -1855,16 +1858,46 @@ void ConfigPreprocessor::parseMacroDef(const dynamic& jkey,
   if (objType == "macroDef") {
     const auto& res = tryGet(obj, "result", "Macro definition");
     vector<dynamic> params;
+    vector<string> paramNames;
     auto paramsIt = obj.find("params");
     if (paramsIt != obj.items().end()) {
       checkLogic(paramsIt->second.isArray(),
                  "'{}' macroDef params is not an array", key);
       for (auto& paramObj : paramsIt->second) {
         params.push_back(paramObj);
+        if (paramObj.isString()) {
+          paramNames.push_back(paramObj.getString());
+        } else if (paramObj.isObject()) {
+          if (auto jName = paramObj.get_ptr("name")) {
+            if (jName->isString()) {
+              paramNames.push_back(jName->getString());
+            }
+          }
+        }
       }
     }
-    auto f = [res, this](Context&& ctx) {
-      return expandMacros(res, std::move(ctx));
+    auto name = key.str();
+    auto f = [res, paramNames, name, this](Context&& ctx) {
+      // The body is a function of parameter values only: the context of a
+      // macroDef doesn't escape to the call site and consts/imports are
+      // stable. Memoize, so repeated calls expand the body only once.
+      dynamic argValues = dynamic::array;
+      for (const auto& paramName : paramNames) {
+        if (auto value = ctx.find(paramName)) {
+          argValues.push_back(dynamic::array(paramName, *value));
+        }
+      }
+      folly::json::serialization_opts opts;
+      opts.sort_keys = true;
+      auto cacheKey = folly::to<string>(
+        name, ':', folly::json::serialize(argValues, opts));
+      auto cacheIt = macroCache_.find(cacheKey);
+      if (cacheIt != macroCache_.end()) {
+        return cacheIt->second;
+      }
+      auto result = expandMacros(res, std::move(ctx));
+      macroCache_.emplace(cacheKey, result);
+      return result;
     };
     addMacro(key, params, std::move(f));
   } else if (objType == "constDef") {
@@ -69,6 +69,11 @@ class ConfigPreprocessor {
   folly::StringKeyedUnorderedMap<std::unique_ptr<Macro>> macros_;
   folly::StringKeyedUnorderedMap<std::unique_ptr<Const>> consts_;
   folly::StringKeyedUnorderedMap<folly::dynamic> importCache_;
+  /**
+   * Memoized results of user-defined macro calls, keyed by macro name and
+   * serialized argument values. Cleared whenever a macro is (re)defined.
+   */
+  mutable folly::StringKeyedUnorderedMap<folly::dynamic> macroCache_;
   folly::StringKeyedUnorderedMap<
     std::function<folly::dynamic(folly::dynamic&&, const Context&)>
   > builtInCalls_;
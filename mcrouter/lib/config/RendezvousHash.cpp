@@ -116,22 +116,27 @@ namespace facebook { namespace memcache {
  *
  */
 size_t RendezvousHash::get(uint64_t key) const {
-  double maxWeight = -1.0;
-  size_t maxWeightId = 0;
+  /* Maximizing pow(scaledHash, 1/weight) is equivalent to minimizing
+     -log(scaledHash) / weight, since exp() is strictly increasing; working
+     in the log domain replaces the pow() per node with a cheaper log().
+     Zero-weight nodes map to an infinite score, matching their old
+     scaled weight of 0. */
+  double minScore = std::numeric_limits<double>::infinity();
+  size_t minScoreId = 0;
   for (size_t i = 0; i < nodes_.size(); ++i) {
     auto& it = nodes_[i];
     // combine the hash with the cluster together
     double combinedHash = computeHash(it.first + key);
     double scaledHash = combinedHash / std::numeric_limits<uint64_t>::max();
-    double scaledWeight = it.second > std::numeric_limits<double>::epsilon()
-      ? std::pow(scaledHash, 1.0 / it.second)
-      : 0.0;
-    if (scaledWeight > maxWeight) {
-      maxWeightId = i;
-      maxWeight = scaledWeight;
+    double score = it.second > std::numeric_limits<double>::epsilon()
+      ? -std::log(scaledHash) / it.second
+      : std::numeric_limits<double>::infinity();
+    if (score < minScore) {
+      minScoreId = i;
+      minScore = score;
     }
   }
-  return maxWeightId;
+  return minScoreId;
 }
 
 void RendezvousHash::normalizeWeights() {
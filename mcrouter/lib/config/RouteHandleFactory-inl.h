@@ -39,6 +39,22 @@ void RouteHandleFactory<RouteHandleIf>::addNamed(
              "Route handle '{}' was already registered", name);
 }
 
+template <class RouteHandleIf>
+void RouteHandleFactory<RouteHandleIf>::addPrebuilt(
+  folly::StringPiece name,
+  std::vector<RouteHandlePtr> handles) {
+
+  checkLogic(seen_.emplace(name, std::move(handles)).second,
+             "Route handle '{}' was already parsed", name);
+}
+
+template <class RouteHandleIf>
+const std::vector<std::shared_ptr<RouteHandleIf>>*
+RouteHandleFactory<RouteHandleIf>::getNamed(folly::StringPiece name) const {
+  auto it = seen_.find(name);
+  return it == seen_.end() ? nullptr : &it->second;
+}
+
 template <class RouteHandleIf>
 std::shared_ptr<RouteHandleIf>
 RouteHandleFactory<RouteHandleIf>::create(const folly::dynamic& json) {
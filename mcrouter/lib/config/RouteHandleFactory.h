@@ -46,6 +46,20 @@ class RouteHandleFactory {
    */
   void addNamed(folly::StringPiece name, folly::dynamic json);
 
+  /**
+   * Adds an already-built route handle under the given name. References to
+   * this name will return the existing handles instead of creating new ones.
+   * Used to reuse unchanged subtrees from a previous config.
+   */
+  void addPrebuilt(folly::StringPiece name,
+                   std::vector<RouteHandlePtr> handles);
+
+  /**
+   * @return route handles created so far for the given named route,
+   *         or nullptr if it wasn't parsed yet.
+   */
+  const std::vector<RouteHandlePtr>* getNamed(folly::StringPiece name) const;
+
   /**
    * Creates single RouteHandle from JSON object.
    *
@@ -27,7 +27,9 @@ class EventBase;
  * different EventBase loops related to the same request) to compute the
  * total number of CPU cycles used by each request.
  * The API was designed with effiency in mind, so it safe to leave it operating
- * in an "always-on" mode with minimal performance impact.
+ * in an "always-on" mode with minimal performance impact: only a small
+ * fraction of intervals is actually metered (see sampling constants in
+ * Cycles.cpp); the rest pay a counter increment per start()/finish() pair.
  *
  * Example usage:
  *
@@ -99,6 +101,9 @@ class IntervalGuard {
  *
  * return   False case there is already one interval running
  *          (i.e. start() was called but not finish()). True otherwise.
+ *          A true return does not guarantee the interval is metered:
+ *          intervals outside the sampling window are silently skipped
+ *          and label() will return false for them.
  */
 bool start() noexcept;
 
@@ -67,3 +67,18 @@ TEST_F(CyclesTest, already_labeled) {
   EXPECT_TRUE(cycles::label(1, 2));
   EXPECT_FALSE(cycles::label(5, 6));
 }
+
+TEST_F(CyclesTest, sampling) {
+  // Intervals are sampled; across a full sampling cycle only a small
+  // fraction should actually be metered (i.e. accept a label).
+  const size_t kTotal = 1 << 18;
+  size_t metered = 0;
+  for (size_t i = 0; i < kTotal; ++i) {
+    cycles::IntervalGuard ig;
+    if (cycles::label(1, i)) {
+      ++metered;
+    }
+  }
+  EXPECT_GT(metered, 0);
+  EXPECT_LT(metered, kTotal / 20);
+}
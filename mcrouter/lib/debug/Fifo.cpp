@@ -72,6 +72,16 @@ bool Fifo::isConnected() const noexcept {
 }
 
 bool Fifo::tryConnect() noexcept {
+  // A reader may create (or remove) the shared-memory ring at any time;
+  // pick up changes on each connect pass.
+  auto ring = std::atomic_load(&ring_);
+  if (!ring) {
+    ring = ShmRingWriter::tryOpen(path_ + ".ring");
+    if (ring) {
+      std::atomic_store(&ring_, ring);
+    }
+  }
+
   if (isConnected()) {
     return true;
   }
@@ -109,6 +119,7 @@ void Fifo::disconnect() noexcept {
   if (oldFd >= 0) {
     close(oldFd);
   }
+  std::atomic_store(&ring_, std::shared_ptr<ShmRingWriter>());
 }
 
 bool Fifo::write(void* buf, size_t len) noexcept {
@@ -119,6 +130,10 @@ bool Fifo::write(void* buf, size_t len) noexcept {
 }
 
 bool Fifo::write(const struct iovec* iov, size_t iovcnt) noexcept {
+  if (auto ring = std::atomic_load(&ring_)) {
+    return ring->write(iov, iovcnt);
+  }
+
   if (folly::writevNoInt(fd_, iov, iovcnt) == -1) {
     if (errno != EAGAIN) {
       PLOG(WARNING) << "Error writing to debug pipe.";
@@ -12,8 +12,11 @@
 #include <sys/uio.h>
 
 #include <atomic>
+#include <memory>
 #include <string>
 
+#include "mcrouter/lib/debug/ShmRing.h"
+
 namespace facebook {
 namespace memcache {
 
@@ -72,6 +75,11 @@ class Fifo {
   const std::string path_;
   // Fifo file descriptor.
   std::atomic<int> fd_{-1};
+  // Shared-memory ring ("<path_>.ring"), mapped once a reader creates
+  // it; while present it replaces the pipe as the data path. Accessed
+  // with atomic_load/atomic_store: tryConnect() runs on the
+  // FifoManager thread while write() runs on the owning proxy thread.
+  std::shared_ptr<ShmRingWriter> ring_;
 
   /**
    * Disconnects the pipe.
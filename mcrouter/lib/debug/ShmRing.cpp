@@ -0,0 +1,225 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "ShmRing.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <glog/logging.h>
+
+namespace facebook {
+namespace memcache {
+
+constexpr uint64_t ShmRingHeader::kMagic;
+constexpr uint32_t ShmRingHeader::kVersion;
+
+namespace {
+
+void copyIn(char* data, uint32_t bufSize, uint64_t pos,
+            const void* src, size_t len) {
+  const size_t offset = pos % bufSize;
+  const size_t firstChunk = std::min<size_t>(len, bufSize - offset);
+  std::memcpy(data + offset, src, firstChunk);
+  if (firstChunk < len) {
+    std::memcpy(data, static_cast<const char*>(src) + firstChunk,
+                len - firstChunk);
+  }
+}
+
+void copyOut(const char* data, uint32_t bufSize, uint64_t pos,
+             void* dst, size_t len) {
+  const size_t offset = pos % bufSize;
+  const size_t firstChunk = std::min<size_t>(len, bufSize - offset);
+  std::memcpy(dst, data + offset, firstChunk);
+  if (firstChunk < len) {
+    std::memcpy(static_cast<char*>(dst) + firstChunk, data,
+                len - firstChunk);
+  }
+}
+
+} // anonymous namespace
+
+ShmRingWriter::ShmRingWriter(ShmRingHeader* header, char* data,
+                             size_t mapSize)
+    : header_(header), data_(data), mapSize_(mapSize) {}
+
+ShmRingWriter::~ShmRingWriter() {
+  ::munmap(header_, mapSize_);
+}
+
+std::unique_ptr<ShmRingWriter> ShmRingWriter::tryOpen(
+    const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDWR);
+  if (fd < 0) {
+    // No ring file means no reader asked for one; stay on the pipe.
+    return nullptr;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) <= sizeof(ShmRingHeader)) {
+    ::close(fd);
+    return nullptr;
+  }
+  const size_t mapSize = st.st_size;
+
+  void* buf =
+      ::mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (buf == MAP_FAILED) {
+    PLOG(WARNING) << "Error mapping debug ring " << path;
+    return nullptr;
+  }
+
+  auto header = static_cast<ShmRingHeader*>(buf);
+  if (header->magic != ShmRingHeader::kMagic ||
+      header->version != ShmRingHeader::kVersion ||
+      header->bufSize != mapSize - sizeof(ShmRingHeader)) {
+    VLOG(1) << "Invalid debug ring header in " << path;
+    ::munmap(buf, mapSize);
+    return nullptr;
+  }
+
+  return std::unique_ptr<ShmRingWriter>(new ShmRingWriter(
+      header, static_cast<char*>(buf) + sizeof(ShmRingHeader), mapSize));
+}
+
+bool ShmRingWriter::write(const struct iovec* iov, size_t iovcnt) noexcept {
+  size_t len = 0;
+  for (size_t i = 0; i < iovcnt; ++i) {
+    len += iov[i].iov_len;
+  }
+
+  const uint64_t writePos = header_->writePos.load(std::memory_order_relaxed);
+  const uint64_t readPos = header_->readPos.load(std::memory_order_acquire);
+  const uint64_t used = writePos - readPos;
+  if (sizeof(uint32_t) + len > header_->bufSize - used) {
+    header_->dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  const uint32_t recordLen = len;
+  copyIn(data_, header_->bufSize, writePos, &recordLen, sizeof(recordLen));
+  uint64_t pos = writePos + sizeof(recordLen);
+  for (size_t i = 0; i < iovcnt; ++i) {
+    copyIn(data_, header_->bufSize, pos, iov[i].iov_base, iov[i].iov_len);
+    pos += iov[i].iov_len;
+  }
+  header_->writePos.store(pos, std::memory_order_release);
+  return true;
+}
+
+ShmRingReader::ShmRingReader(const std::string& path, uint32_t bufSize)
+    : path_(path) {
+  const size_t mapSize = sizeof(ShmRingHeader) + bufSize;
+
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0666);
+  if (fd < 0) {
+    PLOG(WARNING) << "Error creating debug ring " << path;
+    return;
+  }
+
+  struct stat st;
+  bool fresh = ::fstat(fd, &st) == 0 && st.st_size == 0;
+  if (fresh && ::ftruncate(fd, mapSize) != 0) {
+    PLOG(WARNING) << "Error sizing debug ring " << path;
+    ::close(fd);
+    return;
+  }
+  if (!fresh && static_cast<size_t>(st.st_size) != mapSize) {
+    VLOG(1) << "Debug ring " << path << " has unexpected size; ignoring";
+    ::close(fd);
+    return;
+  }
+
+  void* buf =
+      ::mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (buf == MAP_FAILED) {
+    PLOG(WARNING) << "Error mapping debug ring " << path;
+    return;
+  }
+
+  auto header = static_cast<ShmRingHeader*>(buf);
+  if (fresh) {
+    header->magic = ShmRingHeader::kMagic;
+    header->version = ShmRingHeader::kVersion;
+    header->bufSize = bufSize;
+    header->writePos.store(0, std::memory_order_relaxed);
+    header->readPos.store(0, std::memory_order_relaxed);
+    header->dropped.store(0, std::memory_order_relaxed);
+  } else if (header->magic != ShmRingHeader::kMagic ||
+             header->version != ShmRingHeader::kVersion ||
+             header->bufSize != bufSize) {
+    VLOG(1) << "Invalid debug ring header in " << path << "; ignoring";
+    ::munmap(buf, mapSize);
+    return;
+  } else {
+    // A writer may still be attached to this ring from a previous
+    // reader; skip whatever backlog is in it and start fresh.
+    header->readPos.store(
+        header->writePos.load(std::memory_order_acquire),
+        std::memory_order_release);
+  }
+
+  header_ = header;
+  data_ = static_cast<char*>(buf) + sizeof(ShmRingHeader);
+  mapSize_ = mapSize;
+}
+
+ShmRingReader::~ShmRingReader() {
+  if (header_ != nullptr) {
+    ::munmap(header_, mapSize_);
+    // Best effort; a writer still attached keeps its mapping and will
+    // fill the (now orphaned) ring until it reconnects.
+    ::unlink(path_.c_str());
+  }
+}
+
+size_t ShmRingReader::read(
+    const std::function<void(const void* buf, size_t len)>& sink) {
+  if (header_ == nullptr) {
+    return 0;
+  }
+
+  size_t numRecords = 0;
+  uint64_t readPos = header_->readPos.load(std::memory_order_relaxed);
+  const uint64_t writePos = header_->writePos.load(std::memory_order_acquire);
+
+  while (readPos < writePos) {
+    uint32_t recordLen;
+    copyOut(data_, header_->bufSize, readPos, &recordLen, sizeof(recordLen));
+    if (recordLen == 0 ||
+        sizeof(recordLen) + recordLen > writePos - readPos) {
+      // Corrupt record (e.g. writer died mid-write); drop the backlog.
+      LOG(WARNING) << "Corrupt record in debug ring " << path_;
+      readPos = writePos;
+      break;
+    }
+
+    recordBuf_.resize(recordLen);
+    copyOut(data_, header_->bufSize, readPos + sizeof(recordLen),
+            recordBuf_.data(), recordLen);
+    readPos += sizeof(recordLen) + recordLen;
+    ++numRecords;
+    sink(recordBuf_.data(), recordLen);
+  }
+
+  header_->readPos.store(readPos, std::memory_order_release);
+  return numRecords;
+}
+
+} // memcache
+} // facebook
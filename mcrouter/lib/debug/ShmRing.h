@@ -0,0 +1,118 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace facebook {
+namespace memcache {
+
+/**
+ * Single-producer single-consumer ring buffer over a shared mmap'd file,
+ * used as a faster transport for the debug fifo streams (see Fifo.h).
+ *
+ * The reader (mcpiper) creates the file next to the fifo it wants to
+ * drain ("<fifo path>.ring"); the writer picks it up on its periodic
+ * connect pass and, once mapped, writes messages into the ring instead
+ * of the pipe. Compared to the pipe this removes the syscall per
+ * message and grows the buffer from PIPE_BUF to the ring size, so
+ * bursts that used to overflow the pipe are absorbed.
+ *
+ * Records are length-prefixed byte blobs, content-identical to what
+ * would have been written to the pipe; bytes wrap around the buffer
+ * with no padding. The writer never overwrites unread data: when the
+ * ring is full the record is dropped and counted, same semantics as a
+ * full pipe today.
+ */
+struct ShmRingHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t bufSize;
+  // Positions increase monotonically; (pos % bufSize) is the offset of
+  // the next byte to write/read. writePos is advanced by the writer
+  // after the record bytes are in place; readPos by the reader after
+  // it has copied them out.
+  std::atomic<uint64_t> writePos;
+  std::atomic<uint64_t> readPos;
+  // Records dropped because the ring was full.
+  std::atomic<uint64_t> dropped;
+
+  static constexpr uint64_t kMagic = 0x0000676e6952634dULL; // "McRing\0\0"
+  static constexpr uint32_t kVersion = 1;
+};
+
+class ShmRingWriter {
+ public:
+  /**
+   * Maps an existing ring file, validating its header.
+   * Returns nullptr (quietly) if the file doesn't exist, i.e. no reader
+   * asked for a ring; other failures are logged.
+   */
+  static std::unique_ptr<ShmRingWriter> tryOpen(const std::string& path);
+  ~ShmRingWriter();
+
+  ShmRingWriter(const ShmRingWriter&) = delete;
+  ShmRingWriter& operator=(const ShmRingWriter&) = delete;
+
+  /**
+   * Appends the iovs as one record. Returns false (and bumps the shared
+   * drop counter) if the ring doesn't have room for the whole record.
+   * Must be called from a single thread at a time.
+   */
+  bool write(const struct iovec* iov, size_t iovcnt) noexcept;
+
+ private:
+  ShmRingWriter(ShmRingHeader* header, char* data, size_t mapSize);
+
+  ShmRingHeader* header_;
+  char* data_;
+  size_t mapSize_;
+};
+
+class ShmRingReader {
+ public:
+  /**
+   * Creates the ring file (reusing a valid existing one, in which case
+   * reading starts at the current write position) and maps it.
+   * Check initialized() before use.
+   */
+  ShmRingReader(const std::string& path, uint32_t bufSize);
+  ~ShmRingReader();
+
+  ShmRingReader(const ShmRingReader&) = delete;
+  ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+  bool initialized() const {
+    return header_ != nullptr;
+  }
+
+  /**
+   * Drains all complete records currently in the ring, calling sink
+   * once per record. Returns the number of records consumed.
+   */
+  size_t read(const std::function<void(const void* buf, size_t len)>& sink);
+
+ private:
+  const std::string path_;
+  ShmRingHeader* header_{nullptr};
+  char* data_{nullptr};
+  size_t mapSize_{0};
+  std::vector<char> recordBuf_;
+};
+
+} // memcache
+} // facebook
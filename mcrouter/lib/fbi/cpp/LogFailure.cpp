@@ -11,10 +11,12 @@
 
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
 #include <map>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -22,6 +24,7 @@
 #include <boost/filesystem/path.hpp>
 
 #include <folly/Format.h>
+#include <folly/Hash.h>
 #include <folly/Singleton.h>
 
 #include "mcrouter/lib/fbi/cpp/util.h"
@@ -88,6 +91,17 @@ void throwErrorImpl(folly::StringPiece file,
   throw Error(createMessage(file, line, service, category, msg, contexts));
 }
 
+/* Per-site rate limit: bursts of up to kLogBurst, then one per second */
+constexpr double kLogBurst = 10.0;
+constexpr double kLogsPerSecond = 1.0;
+
+struct RateLimitEntry {
+  double tokens{kLogBurst};
+  std::chrono::steady_clock::time_point lastRefill{
+      std::chrono::steady_clock::now()};
+  size_t suppressed{0};
+};
+
 struct StaticContainer {
   std::mutex lock;
 
@@ -98,6 +112,9 @@ struct StaticContainer {
   std::vector<std::pair<std::string, HandlerFunc>> handlers = {
     handlers::verboseLogToStdError()
   };
+
+  // failure site hash => token bucket, see detail::shouldLogFailure()
+  std::unordered_map<uint64_t, RateLimitEntry> rateLimits;
 };
 
 folly::Singleton<StaticContainer> containerSingleton;
@@ -183,11 +200,61 @@ void setServiceContext(folly::StringPiece service, std::string context) {
 
 namespace detail {
 
+bool shouldLogFailure(folly::StringPiece file,
+                      int line,
+                      folly::StringPiece category,
+                      size_t& suppressedOut) {
+  suppressedOut = 0;
+  auto container = containerSingleton.try_get();
+  if (!container) {
+    return true;
+  }
+
+  uint64_t key = folly::hash::fnv64_buf(file.data(), file.size());
+  key = folly::hash::hash_128_to_64(
+      key, folly::hash::fnv64_buf(category.data(), category.size()));
+  key = folly::hash::hash_128_to_64(key, static_cast<uint64_t>(line));
+
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(container->lock);
+  auto& entry = container->rateLimits[key];
+  auto secs =
+      std::chrono::duration<double>(now - entry.lastRefill).count();
+  entry.tokens = std::min(kLogBurst, entry.tokens + secs * kLogsPerSecond);
+  entry.lastRefill = now;
+  if (entry.tokens < 1.0) {
+    ++entry.suppressed;
+    return false;
+  }
+  entry.tokens -= 1.0;
+  suppressedOut = entry.suppressed;
+  entry.suppressed = 0;
+  return true;
+}
+
 void log(folly::StringPiece file,
          int line,
          folly::StringPiece service,
          folly::StringPiece category,
          folly::StringPiece msg) {
+  size_t suppressed = 0;
+  if (!shouldLogFailure(file, line, category, suppressed)) {
+    return;
+  }
+  if (suppressed > 0) {
+    logDirect(file, line, service, category,
+              folly::sformat("{} ({} similar failures suppressed)",
+                             msg, suppressed));
+    return;
+  }
+  logDirect(file, line, service, category, msg);
+}
+
+void logDirect(folly::StringPiece file,
+               int line,
+               folly::StringPiece service,
+               folly::StringPiece category,
+               folly::StringPiece msg) {
   std::map<std::string, std::string> contexts;
   std::vector<std::pair<std::string, HandlerFunc>> handlers;
   if (auto container = containerSingleton.try_get()) {
@@ -80,9 +80,35 @@ std::pair<std::string, HandlerFunc> throwLogicError();
 
 namespace detail {
 
+/**
+ * Token-bucket rate limiter keyed by failure site (file, line, category),
+ * so a single failing destination can't flood the log at request rate.
+ * Suppressed failures are counted per site and reported in a summary
+ * appended to the next emitted message.
+ *
+ * @param suppressedOut  On true, set to the number of failures from this
+ *                       site suppressed since the last emitted one.
+ *
+ * @return  true if this failure should be logged.
+ */
+bool shouldLogFailure(folly::StringPiece file,
+                      int line,
+                      folly::StringPiece category,
+                      size_t& suppressedOut);
+
+/**
+ * Dispatch to handlers without rate limiting; see log() below.
+ */
+void logDirect(folly::StringPiece file,
+               int line,
+               folly::StringPiece service,
+               folly::StringPiece category,
+               folly::StringPiece msg);
+
 /**
  * Log failure according to action for given category (see @setCategoryAction).
  * If no special action is provided, default constructed one will be used.
+ * Rate limited per failure site (see @shouldLogFailure).
  */
 void log(folly::StringPiece file,
          int line,
@@ -91,7 +117,8 @@ void log(folly::StringPiece file,
          folly::StringPiece msg);
 
 /**
- * log overload to format messages automatically.
+ * log overload to format messages automatically.  The rate limit check
+ * runs first, so suppressed failures skip the formatting too.
  */
 template <typename... Args>
 void log(folly::StringPiece file,
@@ -100,8 +127,15 @@ void log(folly::StringPiece file,
          folly::StringPiece category,
          folly::StringPiece msgFormat,
          Args&&... args) {
-  log(file, line, service, category,
-      folly::format(msgFormat, std::forward<Args>(args)...).str());
+  size_t suppressed = 0;
+  if (!shouldLogFailure(file, line, category, suppressed)) {
+    return;
+  }
+  auto msg = folly::format(msgFormat, std::forward<Args>(args)...).str();
+  if (suppressed > 0) {
+    msg += folly::sformat(" ({} similar failures suppressed)", suppressed);
+  }
+  logDirect(file, line, service, category, msg);
 }
 
 }  // detail
@@ -0,0 +1,106 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/Range.h>
+
+namespace facebook { namespace memcache {
+
+/**
+ * Immutable longest-prefix-match map.
+ *
+ * Keys and values live in flat sorted arrays, plus one link per key to its
+ * longest proper prefix also stored in the map.  A lookup is a single
+ * binary search over contiguous memory followed by a walk up that prefix
+ * chain, so it touches a handful of cache lines however long the key is.
+ *
+ * Unlike Trie this structure can not be modified after construction, but
+ * it has no per-character nodes: memory is proportional to the keys and
+ * values themselves, which matters for configs with many prefixes.
+ */
+template <class Value>
+class PrefixMap {
+ public:
+  PrefixMap() = default;
+
+  /**
+   * @param items  (key, value) pairs in any order; keys must be distinct.
+   */
+  explicit PrefixMap(std::vector<std::pair<std::string, Value>> items) {
+    std::sort(items.begin(), items.end(),
+              [](const std::pair<std::string, Value>& a,
+                 const std::pair<std::string, Value>& b) {
+                return a.first < b.first;
+              });
+    keys_.reserve(items.size());
+    values_.reserve(items.size());
+    prev_.reserve(items.size());
+    // In sorted order every stored prefix of a key precedes it, so the
+    // chain of indexes whose keys prefix the current key forms a stack.
+    std::vector<uint32_t> chain;
+    for (auto& item : items) {
+      while (!chain.empty() &&
+             !folly::StringPiece(item.first).startsWith(keys_[chain.back()])) {
+        chain.pop_back();
+      }
+      prev_.push_back(chain.empty() ? kNone : chain.back());
+      chain.push_back(keys_.size());
+      keys_.push_back(std::move(item.first));
+      values_.push_back(std::move(item.second));
+    }
+  }
+
+  /**
+   * @return value stored for the longest key that is a prefix of the given
+   *         key, or nullptr if no stored key is a prefix of it.
+   */
+  const Value* findPrefix(folly::StringPiece key) const {
+    auto it = std::upper_bound(
+        keys_.begin(), keys_.end(), key,
+        [](folly::StringPiece k, const std::string& s) {
+          return k < folly::StringPiece(s);
+        });
+    if (it == keys_.begin()) {
+      return nullptr;
+    }
+    // The largest stored key <= our key: every stored prefix of our key is
+    // in turn a prefix of it, i.e. on its prefix chain.
+    uint32_t idx = (it - keys_.begin()) - 1;
+    while (idx != kNone && !key.startsWith(keys_[idx])) {
+      idx = prev_[idx];
+    }
+    return idx == kNone ? nullptr : &values_[idx];
+  }
+
+  bool empty() const {
+    return keys_.empty();
+  }
+
+  size_t size() const {
+    return keys_.size();
+  }
+
+ private:
+  enum : uint32_t { kNone = std::numeric_limits<uint32_t>::max() };
+
+  std::vector<std::string> keys_;
+  std::vector<Value> values_;
+  // index of the longest proper prefix of keys_[i] stored in the map
+  std::vector<uint32_t> prev_;
+};
+
+}} // facebook::memcache
@@ -96,3 +96,82 @@ class SFRLock {
   SFRReadLock readLock_;
   SFRWriteLock writeLock_;
 };
+
+class SFRDistLock;
+
+/**
+ * @class SFRDistReadLock
+ * @brief C++ sfrlock_dist_t read-lock wrapper which implements BasicLockable.
+ *
+ * An instance of SFRDistReadLock can only be retrived via
+ * SFRDistLock::readLock().
+ * NOTE: unlock() must be called on the thread that called lock().
+ */
+class SFRDistReadLock {
+ public:
+  void lock() {
+    sfrlock_dist_rdlock(lock_);
+  }
+  void unlock() {
+    sfrlock_dist_rdunlock(lock_);
+  }
+ private:
+  friend class SFRDistLock;
+
+  explicit SFRDistReadLock(sfrlock_dist_t* lck) : lock_(lck) {}
+  sfrlock_dist_t* lock_;
+};
+
+/**
+ * @class SFRDistWriteLock
+ * @brief C++ sfrlock_dist_t write-lock wrapper which implements BasicLockable.
+ *
+ * An instance of SFRDistWriteLock can only be retrived via
+ * SFRDistLock::writeLock().
+ */
+class SFRDistWriteLock {
+ public:
+  void lock() {
+    sfrlock_dist_wrlock(lock_);
+  }
+  void unlock() {
+    sfrlock_dist_wrunlock(lock_);
+  }
+ private:
+  friend class SFRDistLock;
+
+  explicit SFRDistWriteLock(sfrlock_dist_t* lck) : lock_(lck) {}
+  sfrlock_dist_t* lock_;
+};
+
+/**
+ * @class SFRDistLock
+ * @brief C++ sfrlock_dist_t wrapper
+ *
+ * Same interface as SFRLock, backed by the distributed-reader variant:
+ * read acquisition is an increment of a per-thread slot, so readers never
+ * bounce a shared cache line between them. Writers pay more (they scan all
+ * the slots), so prefer this over SFRLock only for long-lived locks that
+ * are read far more often than they are written.
+ */
+class SFRDistLock {
+ public:
+  SFRDistLock() : readLock_(&lock_), writeLock_(&lock_) {
+    sfrlock_dist_init(&lock_);
+  }
+
+  SFRDistLock(const SFRDistLock& other) = delete;
+  SFRDistLock& operator=(const SFRDistLock& other) = delete;
+
+  SFRDistReadLock& readLock() {
+    return readLock_;
+  }
+  SFRDistWriteLock& writeLock() {
+    return writeLock_;
+  }
+ private:
+  sfrlock_dist_t lock_;
+
+  SFRDistReadLock readLock_;
+  SFRDistWriteLock writeLock_;
+};
@@ -0,0 +1,82 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mcrouter/lib/fbi/cpp/PrefixMap.h"
+#include "mcrouter/lib/fbi/cpp/Trie.h"
+#include "mcrouter/lib/fbi/cpp/util.h"
+
+using facebook::memcache::PrefixMap;
+using facebook::memcache::Trie;
+
+TEST(PrefixMap, empty) {
+  PrefixMap<int> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.findPrefix("key") == nullptr);
+  EXPECT_TRUE(map.findPrefix("") == nullptr);
+}
+
+TEST(PrefixMap, findPrefix) {
+  PrefixMap<int> map({
+    { "", 0 },
+    { "ab", 1 },
+    { "abc", 2 },
+    { "b", 3 },
+  });
+  EXPECT_FALSE(map.empty());
+  EXPECT_EQ(0, *map.findPrefix(""));
+  EXPECT_EQ(0, *map.findPrefix("xyz"));
+  EXPECT_EQ(0, *map.findPrefix("a"));
+  EXPECT_EQ(1, *map.findPrefix("ab"));
+  EXPECT_EQ(1, *map.findPrefix("abd"));
+  EXPECT_EQ(2, *map.findPrefix("abc"));
+  EXPECT_EQ(2, *map.findPrefix("abcdef"));
+  EXPECT_EQ(3, *map.findPrefix("ba"));
+}
+
+TEST(PrefixMap, noWildcard) {
+  PrefixMap<int> map({ { "foo", 1 } });
+  EXPECT_TRUE(map.findPrefix("") == nullptr);
+  EXPECT_TRUE(map.findPrefix("fo") == nullptr);
+  EXPECT_TRUE(map.findPrefix("bar") == nullptr);
+  EXPECT_EQ(1, *map.findPrefix("foo"));
+  EXPECT_EQ(1, *map.findPrefix("foobar"));
+}
+
+TEST(PrefixMap, matchesTrie) {
+  srand(5678);
+
+  Trie<int> trie;
+  std::vector<std::pair<std::string, int>> items;
+  for (int i = 0; i < 1000; ++i) {
+    auto key = facebook::memcache::randomString(1, 10);
+    if (trie.find(key) == trie.end()) {
+      trie.emplace(key, i);
+      items.emplace_back(std::move(key), i);
+    }
+  }
+  PrefixMap<int> map(std::move(items));
+
+  for (int i = 0; i < 100000; ++i) {
+    auto key = facebook::memcache::randomString(1, 12);
+    auto expected = trie.findPrefix(key);
+    auto result = map.findPrefix(key);
+    if (expected == trie.end()) {
+      EXPECT_TRUE(result == nullptr);
+    } else {
+      ASSERT_TRUE(result != nullptr);
+      EXPECT_EQ(expected->second, *result);
+    }
+  }
+}
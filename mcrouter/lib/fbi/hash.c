@@ -122,25 +122,19 @@ static uint64_t murmur_rehash_64A(uint64_t k) {
 /**
  * furc_get_bit -- the bitstream generator
  *
- * Given a key and an index, provides a pseudorandom bit dependent on both.
- * Caches hash values; a NULL key clears the cache.
+ * Given an index, provides a pseudorandom bit from the cached bitstream.
+ * The cache must have hash[0] (the key's hash) filled in and old_ord_p set
+ * to 0 before the first call, so the common case (the 64-bit word for this
+ * index is already cached) costs one comparison and an array read.
  */
-static uint32_t furc_get_bit(const char* const key, const size_t len,
-                             const uint32_t idx, uint64_t* hash,
-                             int32_t* old_ord_p) {
+static inline uint32_t furc_get_bit(const uint32_t idx, uint64_t* hash,
+                                    int32_t* old_ord_p) {
     int32_t ord = (idx >> 6);
     int n;
 
-    if (key == NULL) {
-        *old_ord_p = -1;
-        return 0;
-    }
-
     if (*old_ord_p < ord) {
         for (n = *old_ord_p + 1; n <= ord; n++) {
-            hash[n] = ((n == 0)
-                       ? murmur_hash_64A(key, len, SEED)
-                       : murmur_rehash_64A(hash[n-1]));
+            hash[n] = murmur_rehash_64A(hash[n-1]);
         }
         *old_ord_p = ord;
     }
@@ -148,7 +142,11 @@ static uint32_t furc_get_bit(const char* const key, const size_t len,
     return (hash[ord] >> (idx&0x3f)) & 0x1;
 }
 
-uint32_t furc_hash(const char* const key, const size_t len, const uint32_t m) {
+uint64_t furc_key_hash(const char* const key, const size_t len) {
+    return murmur_hash_64A(key, len, SEED);
+}
+
+uint32_t furc_hash_by_key_hash(const uint64_t key_hash, const uint32_t m) {
     uint32_t try;
     uint32_t d;
     uint32_t num;
@@ -163,13 +161,16 @@ uint32_t furc_hash(const char* const key, const size_t len, const uint32_t m) {
         return 0;
     }
 
-    furc_get_bit(NULL, 0, 0, hash, &old_ord);
+    /* The first word of the bitstream is always needed: hash it up front
+       rather than testing for an empty cache on every bit. */
+    hash[0] = key_hash;
+    old_ord = 0;
     for (d = 0; m > (1ul << d); d++)
         ;
 
     a = d;
     for (try = 0; try < MAX_TRIES; try++) {
-        while (!furc_get_bit(key, len, a, hash, &old_ord)) {
+        while (!furc_get_bit(a, hash, &old_ord)) {
             if (--d == 0) {
                 return 0;
             }
@@ -178,7 +179,7 @@ uint32_t furc_hash(const char* const key, const size_t len, const uint32_t m) {
         a += FURC_SHIFT;
         num = 1;
         for (i = 0; i < d-1; i++) {
-            num = (num << 1) | furc_get_bit(key, len, a, hash, &old_ord);
+            num = (num << 1) | furc_get_bit(a, hash, &old_ord);
             a += FURC_SHIFT;
         }
         if (num < m) {
@@ -190,6 +191,13 @@ uint32_t furc_hash(const char* const key, const size_t len, const uint32_t m) {
     return 0;
 }
 
+uint32_t furc_hash(const char* const key, const size_t len, const uint32_t m) {
+    if (m <= 1) {
+        return 0;
+    }
+    return furc_hash_by_key_hash(furc_key_hash(key, len), m);
+}
+
 inline uint32_t furc_maximum_pool_size(void) {
     return (1 << FURC_SHIFT);
 }
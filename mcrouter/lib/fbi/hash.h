@@ -47,6 +47,18 @@ __BEGIN_DECLS
 uint32_t furc_hash(const char* const key, const size_t len,
                    const uint32_t m);
 
+/**
+ * furc_hash() split in two, for callers that evaluate one key against
+ * several pool sizes: furc_key_hash() performs the single pass over the
+ * key bytes and furc_hash_by_key_hash() walks the decision tree, so the
+ * key pass can be computed once and reused.
+ *
+ * furc_hash(key, len, m) == furc_hash_by_key_hash(furc_key_hash(key, len), m)
+ */
+uint64_t furc_key_hash(const char* const key, const size_t len);
+
+uint32_t furc_hash_by_key_hash(const uint64_t key_hash, const uint32_t m);
+
 uint32_t furc_maximum_pool_size(void);
 
 /**
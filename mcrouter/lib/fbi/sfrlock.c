@@ -91,3 +91,93 @@ void sfrlock_wrlock_contended(sfrlock_t *l) {
 
   __sync_fetch_and_sub(&l->waiters, 1);
 }
+
+__thread uint32_t sfrlock_dist_slot_hint;
+
+uint32_t sfrlock_dist_slot_assign(void) {
+  static uint32_t next_slot;
+
+  sfrlock_dist_slot_hint =
+      __sync_fetch_and_add(&next_slot, 1) % SFRLOCK_DIST_SLOTS + 1;
+  return sfrlock_dist_slot_hint;
+}
+
+void sfrlock_dist_init(sfrlock_dist_t *l) {
+  unsigned i;
+
+  sfrlock_init(&l->lock);
+  for (i = 0; i < SFRLOCK_DIST_SLOTS; i++) {
+    l->slots[i].readers = 0;
+  }
+}
+
+void sfrlock_dist_wake_writer(uint32_t *slot) {
+  /* At most one writer holds the write bit, so waking one waiter is enough. */
+  syscall(SYS_futex, slot, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, NULL, NULL, 0);
+}
+
+void sfrlock_dist_rdlock_contended(sfrlock_dist_t *l, uint32_t *slot) {
+  uint32_t oldv;
+
+  for (;;) {
+    /* Get out of the writer's way before waiting for it. */
+    if (__sync_sub_and_fetch(slot, 1) == 0 &&
+        (ACCESS_ONCE(l->lock.value) & SFRLOCK_WRITE_LOCKED)) {
+      sfrlock_dist_wake_writer(slot);
+    }
+
+    __sync_fetch_and_add(&l->lock.waiters, 1);
+
+    /* Wait for the write lock to be released. */
+    oldv = ACCESS_ONCE(l->lock.value);
+    while (oldv & SFRLOCK_WRITE_LOCKED) {
+      syscall(SYS_futex, &l->lock.value, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, oldv,
+              NULL, NULL, 0);
+      oldv = ACCESS_ONCE(l->lock.value);
+    }
+
+    __sync_fetch_and_sub(&l->lock.waiters, 1);
+
+    /*
+     * Re-register in our slot and recheck; it is possible that another
+     * writer (or the same one again) swooped in since the check above, in
+     * which case we have to get out of its way and wait once more.
+     */
+    __sync_fetch_and_add(slot, 1);
+    if (!(ACCESS_ONCE(l->lock.value) & SFRLOCK_WRITE_LOCKED)) {
+      return;
+    }
+  }
+}
+
+void sfrlock_dist_wrlock(sfrlock_dist_t *l) {
+  uint32_t readers;
+  unsigned i;
+
+  /*
+   * Take the write bit on the embedded lock. Its reader count is always
+   * zero, so this only serializes writers and publishes the bit the reader
+   * fast path checks.
+   */
+  sfrlock_wrlock(&l->lock);
+
+  /* Wait for every reader slot to drain. */
+  for (i = 0; i < SFRLOCK_DIST_SLOTS; i++) {
+    uint32_t *slot = &l->slots[i].readers;
+
+    while ((readers = ACCESS_ONCE(*slot)) != 0) {
+      syscall(SYS_futex, slot, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, readers,
+              NULL, NULL, 0);
+    }
+  }
+
+  /*
+   * Keep the critical section's accesses from being hoisted above the slot
+   * scan; the volatile reads above only constrain each other.
+   */
+  __sync_synchronize();
+}
+
+void sfrlock_dist_wrunlock(sfrlock_dist_t *l) {
+  sfrlock_wrunlock(&l->lock);
+}
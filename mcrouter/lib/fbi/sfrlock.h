@@ -246,4 +246,93 @@ exit:
 #endif
 }
 
+/**
+ * Distributed-reader variant of sfrlock for structures that are read
+ * thousands of times per write by many threads at once.
+ *
+ * With the plain sfrlock every read acquisition CASes the one shared word,
+ * so the cache line holding it bounces between all reader cores even when
+ * no writer ever shows up. The distributed variant splits the reader count
+ * across SFRLOCK_DIST_SLOTS cache-line-sized slots; each thread is assigned
+ * a slot once (round robin, stored in a thread-local hint) and a read
+ * acquisition is an increment of that slot, which in the steady state stays
+ * in the local cache. Writers set the write bit on the embedded sfrlock --
+ * whose reader-count bits always stay zero -- and then wait for every slot
+ * to drain to zero.
+ *
+ * The reader fast path relies on the full barrier implied by the slot
+ * increment: a reader first registers in its slot, then checks the write
+ * bit; a writer first sets the write bit, then sums the slots. Whatever the
+ * interleaving, either the reader observes the write bit (and gets out of
+ * the way), or the writer observes the reader's registration (and waits).
+ *
+ * Trade-offs versus the plain sfrlock: the lock is SFRLOCK_DIST_SLOTS + 1
+ * cache lines rather than 8 bytes, write acquisition scans every slot, and
+ * a read lock must be released on the thread that acquired it. Use it only
+ * for long-lived, heavily read locks.
+ */
+
+#define SFRLOCK_DIST_SLOTS 16
+
+typedef struct {
+  uint32_t readers;
+  uint32_t pad[15]; /* one slot per cache line */
+} sfrlock_dist_slot_t;
+
+typedef struct {
+  /*
+   * Write bit and waiter count. The reader-count bits of 'lock' always stay
+   * zero; readers are counted in the slots below.
+   */
+  sfrlock_t lock;
+  uint32_t pad[14]; /* keep the slots off the writer's line */
+  sfrlock_dist_slot_t slots[SFRLOCK_DIST_SLOTS];
+} sfrlock_dist_t;
+
+void sfrlock_dist_init(sfrlock_dist_t *l);
+void sfrlock_dist_rdlock_contended(sfrlock_dist_t *l, uint32_t *slot);
+void sfrlock_dist_wake_writer(uint32_t *slot);
+void sfrlock_dist_wrlock(sfrlock_dist_t *l);
+void sfrlock_dist_wrunlock(sfrlock_dist_t *l);
+uint32_t sfrlock_dist_slot_assign(void);
+
+extern __thread uint32_t sfrlock_dist_slot_hint;
+
+/**
+ * The slot this thread's read acquisitions use. The hint is one plus the
+ * slot index so that zero means "not assigned yet".
+ */
+static inline uint32_t *sfrlock_dist_slot(sfrlock_dist_t *lock) {
+  uint32_t hint = sfrlock_dist_slot_hint;
+  if (!hint) {
+    hint = sfrlock_dist_slot_assign();
+  }
+  return &lock->slots[hint - 1].readers;
+}
+
+static inline void sfrlock_dist_rdlock(sfrlock_dist_t *lock) {
+  uint32_t *slot = sfrlock_dist_slot(lock);
+  /*
+   * Register in our slot before checking for a writer; the increment is a
+   * full barrier, so a writer that misses our registration must have
+   * published its write bit before our check below.
+   */
+  __sync_fetch_and_add(slot, 1);
+  if (ACCESS_ONCE(lock->lock.value) & SFRLOCK_WRITE_LOCKED) {
+    sfrlock_dist_rdlock_contended(lock, slot);
+  }
+}
+
+static inline void sfrlock_dist_rdunlock(sfrlock_dist_t *lock) {
+  uint32_t *slot = sfrlock_dist_slot(lock);
+  /*
+   * Only the writer that holds the write bit can be waiting on our slot, so
+   * the wake system call is skipped entirely in the common no-writer case.
+   */
+  if (__sync_sub_and_fetch(slot, 1) == 0 &&
+      (ACCESS_ONCE(lock->lock.value) & SFRLOCK_WRITE_LOCKED)) {
+    sfrlock_dist_wake_writer(slot);
+  }
+}
+
 __END_DECLS
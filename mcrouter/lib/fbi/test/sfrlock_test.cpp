@@ -389,3 +389,94 @@ TEST(sfrlock, trivial_acquisition) {
   sfrlock_read_test();
   sfrlock_write_test();
 }
+
+TEST(sfrlock_dist, concurrent_reads_sanity) {
+  const unsigned thread_count = 20;
+  sfrlock_dist_t sfrlock;
+
+  sfrlock_dist_init(&sfrlock);
+
+  measure_time_concurrent(thread_count, [&] (unsigned) {
+        for (unsigned j = repeat; j; j--) {
+          sfrlock_dist_rdlock(&sfrlock);
+          sfrlock_dist_rdunlock(&sfrlock);
+        }
+
+        sfrlock_dist_rdlock(&sfrlock);
+      });
+}
+
+TEST(sfrlock_dist, contended_writes_sanity) {
+  unsigned cnt = 0;
+  const unsigned thread_count = 5;
+  sfrlock_dist_t sfrlock;
+
+  sfrlock_dist_init(&sfrlock);
+
+  measure_time_concurrent(thread_count, [&] (unsigned) {
+        for (unsigned j = repeat; j; j--) {
+          sfrlock_dist_wrlock(&sfrlock);
+          cnt++;
+          sfrlock_dist_wrunlock(&sfrlock);
+        }
+      });
+  EXPECT_EQ(cnt, thread_count * repeat);
+}
+
+TEST(sfrlock_dist, contended_reads_writes_sanity) {
+  volatile unsigned cnt = 0;
+  const unsigned thread_count = 10;
+  const unsigned inc = 100;
+  sfrlock_dist_t sfrlock;
+
+  sfrlock_dist_init(&sfrlock);
+
+  measure_time_concurrent(thread_count, [&] (unsigned idx) {
+        if (idx < thread_count / 2) {
+          for (unsigned j = repeat / 5; j; j--) {
+            sfrlock_dist_wrlock(&sfrlock);
+            for (unsigned k = inc; k; k--) {
+              cnt++;
+            }
+            sfrlock_dist_wrunlock(&sfrlock);
+            usleep(1);
+          }
+        } else {
+          for (unsigned j = repeat; j; j--) {
+            sfrlock_dist_rdlock(&sfrlock);
+            EXPECT_EQ(cnt % inc, 0);
+            sfrlock_dist_rdunlock(&sfrlock);
+          }
+        }
+      });
+  EXPECT_EQ(cnt, inc * (repeat / 5) * (thread_count / 2));
+}
+
+TEST(sfrlock_dist, contended_reads_writes_sanity_cpp) {
+  volatile unsigned cnt = 0;
+  const unsigned thread_count = 10;
+  const unsigned inc = 100;
+  SFRDistLock sfrlock;
+
+  measure_time_concurrent(thread_count, [&] (unsigned idx) {
+        if (idx < thread_count / 2) {
+          for (unsigned j = repeat / 5; j; j--) {
+            {
+              std::lock_guard<SFRDistWriteLock> lg(sfrlock.writeLock());
+              for (unsigned k = inc; k; k--) {
+                cnt++;
+              }
+            }
+            usleep(1);
+          }
+        } else {
+          for (unsigned j = repeat; j; j--) {
+            {
+              std::lock_guard<SFRDistReadLock> lg(sfrlock.readLock());
+              EXPECT_EQ(cnt % inc, 0);
+            }
+          }
+        }
+      });
+  EXPECT_EQ(cnt, inc * (repeat / 5) * (thread_count / 2));
+}
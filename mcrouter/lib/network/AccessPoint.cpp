@@ -9,9 +9,15 @@
  */
 #include "AccessPoint.h"
 
+#include <netdb.h>
+
 #include <folly/Conv.h>
+#include <folly/Hash.h>
 #include <folly/IPAddress.h>
+#include <folly/ScopeGuard.h>
+#include <folly/SocketAddress.h>
 
+#include "mcrouter/lib/fbi/cpp/LogFailure.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
 
 namespace facebook { namespace memcache {
@@ -90,6 +96,17 @@ AccessPoint::AccessPoint(folly::StringPiece host, uint16_t port,
     host_ = host.str();
     isV6_ = false;
   }
+
+  hash_ = computeHash();
+}
+
+uint64_t AccessPoint::computeHash() const {
+  return folly::hash::hash_128_to_64(
+    folly::hash::SpookyHashV2::Hash64(host_.data(), host_.size(), /* seed */ 0),
+    folly::hash::hash_combine(port_,
+                              static_cast<uint32_t>(protocol_),
+                              useSsl_,
+                              compressed_));
 }
 
 std::shared_ptr<AccessPoint>
@@ -144,6 +161,47 @@ AccessPoint::create(folly::StringPiece apString,
 
 void AccessPoint::disableCompression() {
   compressed_ = false;
+  hash_ = computeHash();
+}
+
+std::vector<folly::SocketAddress> AccessPoint::resolve() const {
+  std::vector<folly::SocketAddress> addresses;
+
+  struct addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_TCP;
+  hints.ai_flags = AI_ADDRCONFIG;
+
+  struct addrinfo* results = nullptr;
+  auto port = folly::to<std::string>(port_);
+  auto rv = getaddrinfo(host_.c_str(), port.c_str(), &hints, &results);
+  if (rv != 0) {
+    LOG_FAILURE("AccessPoint", failure::Category::kBadEnvironment,
+                "Failed to resolve {}: {}",
+                toHostPortString(), gai_strerror(rv));
+    return addresses;
+  }
+  SCOPE_EXIT { freeaddrinfo(results); };
+
+  bool haveV4 = false;
+  bool haveV6 = false;
+  for (auto* res = results; res != nullptr; res = res->ai_next) {
+    if ((res->ai_family != AF_INET && res->ai_family != AF_INET6) ||
+        (res->ai_family == AF_INET && haveV4) ||
+        (res->ai_family == AF_INET6 && haveV6)) {
+      continue;
+    }
+    folly::SocketAddress address;
+    address.setFromSockaddr(res->ai_addr, res->ai_addrlen);
+    addresses.push_back(std::move(address));
+    if (res->ai_family == AF_INET) {
+      haveV4 = true;
+    } else {
+      haveV6 = true;
+    }
+  }
+  return addresses;
 }
 
 std::string AccessPoint::toHostPortString() const {
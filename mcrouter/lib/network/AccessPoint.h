@@ -11,11 +11,16 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <folly/Range.h>
 
 #include "mcrouter/lib/mc/protocol.h"
 
+namespace folly {
+class SocketAddress;
+} // folly
+
 namespace facebook { namespace memcache {
 
 struct AccessPoint {
@@ -64,6 +69,13 @@ struct AccessPoint {
     return compressed_;
   }
 
+  /**
+   * Resolves the host to at most one address per family (the first v4
+   * and the first v6 result, in resolver preference order).
+   * Note: may block on DNS; returns an empty vector on failure.
+   */
+  std::vector<folly::SocketAddress> resolve() const;
+
   /**
    * @return [host]:port if address is IPv6, host:port otherwise
    */
@@ -76,13 +88,37 @@ struct AccessPoint {
 
   void disableCompression();
 
+  /**
+   * Hash over the same fields operator==() compares, computed once at
+   * construction, so access points can be used as hash table keys
+   * without re-reading the host string.
+   */
+  uint64_t hash() const {
+    return hash_;
+  }
+
+  /**
+   * Compares the same fields toString() encodes.
+   */
+  bool operator==(const AccessPoint& other) const {
+    return hash_ == other.hash_ && port_ == other.port_ &&
+           protocol_ == other.protocol_ && useSsl_ == other.useSsl_ &&
+           compressed_ == other.compressed_ && host_ == other.host_;
+  }
+  bool operator!=(const AccessPoint& other) const {
+    return !(*this == other);
+  }
+
  private:
   std::string host_;
+  uint64_t hash_{0};
   uint16_t port_;
   mc_protocol_t protocol_;
   bool useSsl_{false};
   bool isV6_{false};
   bool compressed_{false};
+
+  uint64_t computeHash() const;
 };
 
 }}  // facebook::memcache
@@ -9,11 +9,32 @@
  */
 #include "AsciiSerialized.h"
 
+#include <folly/Conv.h>
+
 #include "mcrouter/lib/IOBufUtil.h"
 #include "mcrouter/lib/McResUtil.h"
 
 namespace facebook { namespace memcache {
 
+namespace {
+
+// snprintf is a measurable cost on the request serialization hot path,
+// so the small numeric header fields are formatted by hand. Both helpers
+// return the number of characters written.
+inline size_t formatUint(uint64_t value, char* buf) {
+  return folly::uint64ToBufferUnsafe(value, buf);
+}
+
+inline size_t formatInt(int64_t value, char* buf) {
+  if (value < 0) {
+    *buf = '-';
+    return 1 + folly::uint64ToBufferUnsafe(-value, buf + 1);
+  }
+  return folly::uint64ToBufferUnsafe(value, buf);
+}
+
+} // anonymous namespace
+
 void AsciiSerializedRequest::addString(folly::ByteRange range) {
   assert(iovsCount_ < kMaxIovs);
   iovs_[iovsCount_].iov_base = const_cast<unsigned char*>(range.begin());
@@ -30,11 +51,18 @@ template <class Request>
 void AsciiSerializedRequest::keyValueRequestCommon(folly::StringPiece prefix,
                                                    const Request& request) {
   auto value = coalesceAndGetRange(const_cast<folly::IOBuf&>(request.value()));
-  auto len = snprintf(printBuffer_, kMaxBufferLength, " %lu %d %zd\r\n",
-                      request.flags(), request.exptime(), value.size());
-  assert(len > 0 && static_cast<size_t>(len) < kMaxBufferLength);
+  char* buf = printBuffer_;
+  *buf++ = ' ';
+  buf += formatUint(request.flags(), buf);
+  *buf++ = ' ';
+  buf += formatInt(request.exptime(), buf);
+  *buf++ = ' ';
+  buf += formatUint(value.size(), buf);
+  *buf++ = '\r';
+  *buf++ = '\n';
+  assert(static_cast<size_t>(buf - printBuffer_) < kMaxBufferLength);
   addStrings(prefix, request.key().fullKey(),
-             folly::StringPiece(printBuffer_, static_cast<size_t>(len)),
+             folly::StringPiece(printBuffer_, buf - printBuffer_),
              value, "\r\n");
 }
 
@@ -82,52 +110,77 @@ void AsciiSerializedRequest::prepareImpl(
 
 void AsciiSerializedRequest::prepareImpl(const McCasRequest& request) {
   auto value = coalesceAndGetRange(const_cast<folly::IOBuf&>(request.value()));
-  auto len = snprintf(printBuffer_, kMaxBufferLength, " %lu %d %zd %lu\r\n",
-                      request.flags(), request.exptime(), value.size(),
-                      request.casToken());
-  assert(len > 0 && static_cast<size_t>(len) < kMaxBufferLength);
+  char* buf = printBuffer_;
+  *buf++ = ' ';
+  buf += formatUint(request.flags(), buf);
+  *buf++ = ' ';
+  buf += formatInt(request.exptime(), buf);
+  *buf++ = ' ';
+  buf += formatUint(value.size(), buf);
+  *buf++ = ' ';
+  buf += formatUint(request.casToken(), buf);
+  *buf++ = '\r';
+  *buf++ = '\n';
+  assert(static_cast<size_t>(buf - printBuffer_) < kMaxBufferLength);
   addStrings("cas ", request.key().fullKey(),
-             folly::StringPiece(printBuffer_, static_cast<size_t>(len)), value,
+             folly::StringPiece(printBuffer_, buf - printBuffer_), value,
              "\r\n");
 }
 
 void AsciiSerializedRequest::prepareImpl(
     const McLeaseSetRequest& request) {
   auto value = coalesceAndGetRange(const_cast<folly::IOBuf&>(request.value()));
-  auto len = snprintf(printBuffer_, kMaxBufferLength, " %lu %lu %d %zd\r\n",
-                      request.leaseToken(), request.flags(),
-                      request.exptime(), value.size());
-  assert(len > 0 && static_cast<size_t>(len) < kMaxBufferLength);
+  char* buf = printBuffer_;
+  *buf++ = ' ';
+  buf += formatUint(request.leaseToken(), buf);
+  *buf++ = ' ';
+  buf += formatUint(request.flags(), buf);
+  *buf++ = ' ';
+  buf += formatInt(request.exptime(), buf);
+  *buf++ = ' ';
+  buf += formatUint(value.size(), buf);
+  *buf++ = '\r';
+  *buf++ = '\n';
+  assert(static_cast<size_t>(buf - printBuffer_) < kMaxBufferLength);
   addStrings("lease-set ", request.key().fullKey(),
-             folly::StringPiece(printBuffer_, static_cast<size_t>(len)), value,
+             folly::StringPiece(printBuffer_, buf - printBuffer_), value,
              "\r\n");
 }
 
 // Arithmetic ops.
 void AsciiSerializedRequest::prepareImpl(const McIncrRequest& request) {
-  auto len = snprintf(printBuffer_, kMaxBufferLength, " %lu\r\n",
-                      request.delta());
-  assert(len > 0 && static_cast<size_t>(len) < kMaxBufferLength);
+  char* buf = printBuffer_;
+  *buf++ = ' ';
+  buf += formatUint(request.delta(), buf);
+  *buf++ = '\r';
+  *buf++ = '\n';
+  assert(static_cast<size_t>(buf - printBuffer_) < kMaxBufferLength);
   addStrings("incr ", request.key().fullKey(),
-             folly::StringPiece(printBuffer_, static_cast<size_t>(len)));
+             folly::StringPiece(printBuffer_, buf - printBuffer_));
 }
 
 void AsciiSerializedRequest::prepareImpl(const McDecrRequest& request) {
-  auto len = snprintf(printBuffer_, kMaxBufferLength, " %lu\r\n",
-                      request.delta());
-  assert(len > 0 && static_cast<size_t>(len) < kMaxBufferLength);
+  char* buf = printBuffer_;
+  *buf++ = ' ';
+  buf += formatUint(request.delta(), buf);
+  *buf++ = '\r';
+  *buf++ = '\n';
+  assert(static_cast<size_t>(buf - printBuffer_) < kMaxBufferLength);
   addStrings("decr ", request.key().fullKey(),
-             folly::StringPiece(printBuffer_, static_cast<size_t>(len)));
+             folly::StringPiece(printBuffer_, buf - printBuffer_));
 }
 
 // Delete op.
 void AsciiSerializedRequest::prepareImpl(const McDeleteRequest& request) {
   addStrings("delete ", request.key().fullKey());
   if (request.exptime() != 0) {
-    auto len = snprintf(printBuffer_, kMaxBufferLength, " %d\r\n",
-                        request.exptime());
-    assert(len > 0 && static_cast<size_t>(len) < kMaxBufferLength);
-    addString(folly::StringPiece(printBuffer_, static_cast<size_t>(len)));
+    char* buf = printBuffer_;
+    *buf++ = ' ';
+    buf += formatInt(request.exptime(), buf);
+    *buf++ = '\r';
+    *buf++ = '\n';
+    assert(static_cast<size_t>(buf - printBuffer_) < kMaxBufferLength);
+    addString(folly::StringPiece(printBuffer_, buf - printBuffer_));
   } else {
     addString("\r\n");
   }
@@ -135,11 +188,14 @@ void AsciiSerializedRequest::prepareImpl(const McDeleteRequest& request) {
 
 // Touch op.
 void AsciiSerializedRequest::prepareImpl(const McTouchRequest& request) {
-  auto len = snprintf(printBuffer_, kMaxBufferLength, " %u\r\n",
-                      request.exptime());
-  assert(len > 0 && static_cast<size_t>(len) < kMaxBufferLength);
+  char* buf = printBuffer_;
+  *buf++ = ' ';
+  buf += formatUint(static_cast<uint32_t>(request.exptime()), buf);
+  *buf++ = '\r';
+  *buf++ = '\n';
+  assert(static_cast<size_t>(buf - printBuffer_) < kMaxBufferLength);
   addStrings("touch ", request.key().fullKey(),
-             folly::StringPiece(printBuffer_, static_cast<size_t>(len)));
+             folly::StringPiece(printBuffer_, buf - printBuffer_));
 }
 
 // Version op.
@@ -154,9 +210,11 @@ void AsciiSerializedRequest::prepareImpl(
     const McFlushAllRequest& request) {
   addString("flush_all");
   if (request.delay() != 0) {
-    auto len = snprintf(printBuffer_, kMaxBufferLength, " %u", request.delay());
-    assert(len > 0 && static_cast<size_t>(len) < kMaxBufferLength);
-    addString(folly::StringPiece(printBuffer_, static_cast<size_t>(len)));
+    char* buf = printBuffer_;
+    *buf++ = ' ';
+    buf += formatUint(request.delay(), buf);
+    assert(static_cast<size_t>(buf - printBuffer_) < kMaxBufferLength);
+    addString(folly::StringPiece(printBuffer_, buf - printBuffer_));
   }
   addString("\r\n");
 }
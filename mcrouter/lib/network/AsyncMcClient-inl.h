@@ -58,6 +58,10 @@ inline size_t AsyncMcClient::getInflightRequestCount() const {
   return base_->getInflightRequestCount();
 }
 
+inline bool AsyncMcClient::isSaturated() const {
+  return base_->isSaturated();
+}
+
 inline void AsyncMcClient::updateWriteTimeout(
     std::chrono::milliseconds timeout) {
   base_->updateWriteTimeout(timeout);
@@ -132,6 +132,14 @@ class AsyncMcClient {
    */
   size_t getInflightRequestCount() const;
 
+  /**
+   * Check whether the connection's send path is backed up beyond the
+   * configured TCP_NOTSENT_LOWAT watermark (see
+   * ConnectionOptions::tcpNotsentLowat). Always false when the watermark
+   * is not configured.
+   */
+  bool isSaturated() const;
+
   /**
    * Update send and connect timeout. If new value is larger than current
    * it is ignored.
@@ -9,6 +9,7 @@
  */
 #include <folly/Memory.h>
 
+#include "mcrouter/lib/Tracepoints.h"
 #include "mcrouter/lib/cycles/Cycles.h"
 #include "mcrouter/lib/network/FBTrace.h"
 #include "mcrouter/lib/network/ReplyStatsContext.h"
@@ -38,7 +39,8 @@ ReplyT<Request> AsyncMcClientImpl::sendSync(
       connectionOptions_.accessPoint->getProtocol(),
       std::move(selfPtr),
       queue_,
-      [](ParserT& parser) { parser.expectNext<Request>(); },
+      selectParserInitializer<Request>(
+          connectionOptions_.accessPoint->getProtocol()),
       requestStatusCallbacks_.onStateChange,
       supportedCompressionCodecs_);
   sendCommon(ctx);
@@ -54,6 +56,36 @@ ReplyT<Request> AsyncMcClientImpl::sendSync(
   return reply;
 }
 
+template <class Request>
+typename std::enable_if<
+    ListContains<McRequestList, Request>::value,
+    McClientRequestContextBase::InitializerFuncPtr>::type
+AsyncMcClientImpl::selectParserInitializer(mc_protocol_t protocol) {
+  switch (protocol) {
+#ifndef MCROUTER_CARET_ONLY
+    case mc_ascii_protocol:
+      return [](ParserT& parser) { parser.expectNextAscii<Request>(); };
+    case mc_umbrella_protocol:
+      return [](ParserT& parser) { parser.expectNextUmbrella<Request>(); };
+    default:
+      assert(protocol == mc_caret_protocol);
+      return [](ParserT& parser) { parser.expectNextCaret<Request>(); };
+#else
+    default:
+      /* Non-caret connections fail at parse time in caret-only builds */
+      return [](ParserT& parser) { parser.expectNextCaret<Request>(); };
+#endif
+  }
+}
+
+template <class Request>
+typename std::enable_if<
+    !ListContains<McRequestList, Request>::value,
+    McClientRequestContextBase::InitializerFuncPtr>::type
+AsyncMcClientImpl::selectParserInitializer(mc_protocol_t /* protocol */) {
+  return [](ParserT& parser) { parser.expectNextCaret<Request>(); };
+}
+
 template <class Reply>
 void AsyncMcClientImpl::replyReady(
     Reply&& r,
@@ -62,6 +94,14 @@ void AsyncMcClientImpl::replyReady(
   assert(connectionState_ == ConnectionState::UP);
   DestructorGuard dg(this);
 
+  if (connectionOptions_.useUdp) {
+    // Ascii parsing always reports id 0; over UDP the real id comes
+    // from the frame header of the datagram being delivered.
+    reqId = udpCurrentReplyId();
+  }
+
+  MCROUTER_PROBE_REPLY_RECEIVED(this, reqId, r.result());
+
   queue_.reply(reqId, std::move(r), replyStatsContext);
 }
 
@@ -11,21 +11,27 @@
 
 #include <netinet/tcp.h>
 
+#include <folly/Conv.h>
 #include <folly/EvictingCacheMap.h>
 #include <folly/io/async/AsyncSSLSocket.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/Memory.h>
 #include <folly/SingletonThreadLocal.h>
+#include <folly/small_vector.h>
 
 #include "mcrouter/lib/debug/FifoManager.h"
 #include "mcrouter/lib/fbi/cpp/LogFailure.h"
 #include "mcrouter/lib/network/MockMcClientTransport.h"
+#include "mcrouter/lib/network/UdpClientTransport.h"
 
 namespace facebook { namespace memcache {
 
 constexpr size_t kReadBufferSizeMin = 256;
 constexpr size_t kReadBufferSizeMax = 4096;
 
+/* Bound on the number of iovecs coalesced into one writev call */
+constexpr size_t kMaxBatchIovecs = 512;
+
 namespace detail {
 class OnEventBaseDestructionCallback : public folly::EventBase::LoopCallback {
 public:
@@ -74,8 +80,10 @@ AsyncMcClientImpl::AsyncMcClientImpl(
     : eventBase_(eventBase),
       connectionOptions_(std::move(options)),
       outOfOrder_(connectionOptions_.accessPoint->getProtocol() !=
-                  mc_ascii_protocol),
+                      mc_ascii_protocol ||
+                  connectionOptions_.useUdp),
       queue_(outOfOrder_),
+      timeoutWheel_(eventBase),
       writer_(folly::make_unique<WriterLoop>(*this)),
       eventBaseDestructionCallback_(
         folly::make_unique<detail::OnEventBaseDestructionCallback>(*this)) {
@@ -93,6 +101,11 @@ std::shared_ptr<AsyncMcClientImpl> AsyncMcClientImpl::create(
       options.noNetwork) {
     throw std::logic_error("No network mode is supported only for ascii");
   }
+  if (options.useUdp &&
+      (options.accessPoint->getProtocol() != mc_ascii_protocol ||
+       options.noNetwork || options.sslContextProvider)) {
+    throw std::logic_error("UDP is supported only for plain ascii");
+  }
 
   auto client = std::shared_ptr<AsyncMcClientImpl>(
       new AsyncMcClientImpl(eventBase, std::move(options)), Destructor());
@@ -103,12 +116,21 @@ std::shared_ptr<AsyncMcClientImpl> AsyncMcClientImpl::create(
 void AsyncMcClientImpl::closeNow() {
   DestructorGuard dg(this);
 
+  standby_.reset();
   if (socket_) {
     isAborting_ = true;
     // We need to destroy it immediately.
     socket_->closeNow();
     socket_.reset();
     isAborting_ = false;
+  } else if (!connectAttempts_.empty()) {
+    isAborting_ = true;
+    // Aborts every racing connect without delivering callbacks, then
+    // fail pending requests the same way a connect error would.
+    connectAttempts_.clear();
+    connectErr(folly::AsyncSocketException(
+        folly::AsyncSocketException::INTERRUPTED, "Client closed"));
+    isAborting_ = false;
   }
 }
 
@@ -223,22 +245,67 @@ void AsyncMcClientImpl::pushMessages() {
     requestStatusCallbacks_.onWrite(numToSend);
   }
 
+  if (auto* udp = udpTransport()) {
+    /* Each request is its own datagram stamped with its request id, so
+       there's nothing to coalesce. The write callback fires inline. */
+    while (getPendingRequestCount() != 0 && numToSend > 0 &&
+           connectionState_ == ConnectionState::UP) {
+      auto& req = queue_.markNextAsSending();
+      auto iov = req.reqContext.getIovs();
+      auto iovcnt = req.reqContext.getIovsCount();
+      if (debugFifo_.isConnected()) {
+        debugFifo_.startMessage(
+            MessageDirection::Sent, req.reqContext.typeId());
+        debugFifo_.writeData(iov, iovcnt);
+      }
+      writeBatches_.push_back(1);
+      udp->writeRequest(this, static_cast<uint16_t>(req.id), iov, iovcnt);
+      --numToSend;
+    }
+    writeScheduled_ = false;
+    scheduleNextWriterLoop();
+    return;
+  }
+
+  /* Coalesce every request we're allowed to send in this loop iteration
+     into a single writev, so fan-out-heavy workloads don't pay one
+     syscall (and typically one packet) per request.  Only when a batch
+     outgrows kMaxBatchIovecs do we issue more than one writev. */
+  folly::small_vector<struct iovec, 64> batchIovs;
+  size_t batchedRequests = 0;
+
+  auto flushBatch = [&](folly::WriteFlags flags) {
+    writeBatches_.push_back(batchedRequests);
+    socket_->writev(this, batchIovs.data(), batchIovs.size(), flags);
+    batchIovs.clear();
+    batchedRequests = 0;
+  };
+
   while (getPendingRequestCount() != 0 && numToSend > 0 &&
          /* we might be already not UP, because of failed writev */
          connectionState_ == ConnectionState::UP) {
+    auto iovcnt = queue_.peekNextPending().reqContext.getIovsCount();
+    if (batchedRequests > 0 && batchIovs.size() + iovcnt > kMaxBatchIovecs) {
+      /* Recheck the connection state: the writev may fail inline */
+      flushBatch(folly::WriteFlags::CORK);
+      continue;
+    }
     auto& req = queue_.markNextAsSending();
 
     auto iov = req.reqContext.getIovs();
-    auto iovcnt = req.reqContext.getIovsCount();
     if (debugFifo_.isConnected()) {
       debugFifo_.startMessage(MessageDirection::Sent, req.reqContext.typeId());
       debugFifo_.writeData(iov, iovcnt);
     }
-    socket_->writev(this, iov, iovcnt,
-                    numToSend == 1 ? folly::WriteFlags::NONE
-                    : folly::WriteFlags::CORK);
+    batchIovs.insert(batchIovs.end(), iov, iov + iovcnt);
+    ++batchedRequests;
     --numToSend;
   }
+  if (batchedRequests > 0) {
+    /* Even if a previous batch just failed, write this one out; the
+       writeErr callback does the per-batch bookkeeping either way */
+    flushBatch(folly::WriteFlags::NONE);
+  }
   writeScheduled_ = false;
   scheduleNextWriterLoop();
 }
@@ -357,6 +424,30 @@ folly::AsyncSocket::OptionMap createSocketOptions(
   createTCPKeepAliveOptions(options,
     connectionOptions.tcpKeepAliveCount, connectionOptions.tcpKeepAliveIdle,
     connectionOptions.tcpKeepAliveInterval);
+#ifdef TCP_NOTSENT_LOWAT
+  if (connectionOptions.tcpNotsentLowat > 0) {
+    folly::AsyncSocket::OptionMap::key_type key;
+    key.level = IPPROTO_TCP;
+    key.optname = TCP_NOTSENT_LOWAT;
+    options[key] = connectionOptions.tcpNotsentLowat;
+  }
+#endif // TCP_NOTSENT_LOWAT
+#ifdef SO_BUSY_POLL
+  if (connectionOptions.busyPollUs > 0) {
+    folly::AsyncSocket::OptionMap::key_type key;
+    key.level = SOL_SOCKET;
+    key.optname = SO_BUSY_POLL;
+    options[key] = connectionOptions.busyPollUs;
+  }
+#endif // SO_BUSY_POLL
+#ifdef TCP_FASTOPEN_CONNECT
+  if (connectionOptions.enableTfo) {
+    folly::AsyncSocket::OptionMap::key_type key;
+    key.level = IPPROTO_TCP;
+    key.optname = TCP_FASTOPEN_CONNECT;
+    options[key] = 1;
+  }
+#endif // TCP_FASTOPEN_CONNECT
   if (connectionOptions.enableQoS) {
     createQoSClassOption(options, address.getFamily(),
         connectionOptions.qosClass, connectionOptions.qosPath);
@@ -416,6 +507,188 @@ SSL_SESSION* getSslSession(const AccessPoint& ap) {
 
 } // anonymous namespace
 
+/**
+ * One racing plain-socket connect (we start one per address family for
+ * dual-stack destinations). The owner keeps whichever attempt succeeds
+ * first and destroys the rest; the destructor uses cancelConnect(), which
+ * guarantees no callback is delivered while tearing a loser down.
+ */
+class AsyncMcClientImpl::ConnectionAttempt
+    : public folly::AsyncSocket::ConnectCallback {
+ public:
+  ConnectionAttempt(AsyncMcClientImpl& client, folly::SocketAddress address)
+      : client_(client),
+        address_(std::move(address)) {}
+
+  ~ConnectionAttempt() override {
+    if (socket_) {
+      dynamic_cast<folly::AsyncSocket&>(*socket_).cancelConnect();
+    }
+  }
+
+  void start() {
+    auto socketOptions = createSocketOptions(address_,
+                                             client_.connectionOptions_);
+    auto* socket = new folly::AsyncSocket(&client_.eventBase_);
+    socket_.reset(socket);
+    socket->setSendTimeout(client_.connectionOptions_.writeTimeout.count());
+    // On synchronous failure connectErr() may destroy this attempt, so
+    // this must be the last statement touching any members.
+    socket->connect(this, address_,
+                    client_.connectionOptions_.writeTimeout.count(),
+                    socketOptions);
+  }
+
+  folly::AsyncTransportWrapper::UniquePtr releaseSocket() {
+    return std::move(socket_);
+  }
+
+  bool finished() const {
+    return finished_;
+  }
+
+ private:
+  AsyncMcClientImpl& client_;
+  folly::SocketAddress address_;
+  folly::AsyncTransportWrapper::UniquePtr socket_;
+  bool finished_{false};
+
+  void connectSuccess() noexcept override final {
+    finished_ = true;
+    if (client_.connectionOptions_.enableQoS) {
+      checkWhetherQoSIsApplied(
+          address_, dynamic_cast<folly::AsyncSocket&>(*socket_).getFd(),
+          client_.connectionOptions_);
+    }
+    // Destroys this attempt, do not touch any members afterwards.
+    client_.connectAttemptSuccess(*this);
+  }
+
+  void connectErr(const folly::AsyncSocketException& ex)
+      noexcept override final {
+    finished_ = true;
+    socket_.reset();
+    // May destroy this attempt, do not touch any members afterwards.
+    client_.connectAttemptErr(*this, ex);
+  }
+};
+
+/**
+ * A kept-warm standby socket to the destination, maintained while the main
+ * connection is up (see ConnectionOptions::keepStandbyConnection). A
+ * minimal read callback watches the idle socket, so that anything the
+ * server does to it — an idle-timeout close, an error, or unexpected
+ * data — discards it instead of letting a dead socket get adopted.
+ */
+class AsyncMcClientImpl::StandbyConnection
+    : public folly::AsyncSocket::ConnectCallback,
+      public folly::AsyncTransportWrapper::ReadCallback {
+ public:
+  explicit StandbyConnection(AsyncMcClientImpl& client) : client_(client) {}
+
+  ~StandbyConnection() override {
+    if (socket_) {
+      if (connected_) {
+        socket_->setReadCB(nullptr);
+      } else {
+        dynamic_cast<folly::AsyncSocket&>(*socket_).cancelConnect();
+      }
+    }
+  }
+
+  void start(folly::SocketAddress address) {
+    auto socketOptions = createSocketOptions(address,
+                                             client_.connectionOptions_);
+    auto* socket = new folly::AsyncSocket(&client_.eventBase_);
+    socket_.reset(socket);
+    socket->setSendTimeout(client_.connectionOptions_.writeTimeout.count());
+    // On synchronous failure connectErr() may destroy this standby, so
+    // this must be the last statement touching any members.
+    socket->connect(this, address,
+                    client_.connectionOptions_.writeTimeout.count(),
+                    socketOptions);
+  }
+
+  bool ready() const {
+    return connected_;
+  }
+
+  folly::AsyncTransportWrapper::UniquePtr takeSocket() {
+    socket_->setReadCB(nullptr);
+    return std::move(socket_);
+  }
+
+ private:
+  AsyncMcClientImpl& client_;
+  folly::AsyncTransportWrapper::UniquePtr socket_;
+  bool connected_{false};
+  char scratch_[64];
+
+  void connectSuccess() noexcept override final {
+    connected_ = true;
+    socket_->setReadCB(this);
+  }
+
+  void connectErr(const folly::AsyncSocketException& /* ex */)
+      noexcept override final {
+    socket_.reset();
+    // Destroys this standby, do not touch any members afterwards.
+    client_.standbyBroken(/* wasConnected */ false);
+  }
+
+  void getReadBuffer(void** bufReturn, size_t* lenReturn) override final {
+    *bufReturn = scratch_;
+    *lenReturn = sizeof(scratch_);
+  }
+
+  void readDataAvailable(size_t /* len */) noexcept override final {
+    client_.standbyBroken(/* wasConnected */ true);
+  }
+
+  void readEOF() noexcept override final {
+    client_.standbyBroken(/* wasConnected */ true);
+  }
+
+  void readErr(const folly::AsyncSocketException& /* ex */)
+      noexcept override final {
+    client_.standbyBroken(/* wasConnected */ true);
+  }
+};
+
+void AsyncMcClientImpl::maybeWarmStandby() {
+  if (!connectionOptions_.keepStandbyConnection ||
+      connectionOptions_.noNetwork ||
+      connectionOptions_.sslContextProvider ||
+      standby_) {
+    return;
+  }
+
+  folly::SocketAddress address;
+  try {
+    address = folly::SocketAddress(
+      connectionOptions_.accessPoint->getHost(),
+      connectionOptions_.accessPoint->getPort(),
+      /* allowNameLookup */ true);
+  } catch (const std::system_error&) {
+    // The standby is an optimization; just skip it if we can't resolve.
+    return;
+  }
+
+  standby_ = folly::make_unique<StandbyConnection>(*this);
+  standby_->start(std::move(address));
+}
+
+void AsyncMcClientImpl::standbyBroken(bool wasConnected) noexcept {
+  standby_.reset();
+  if (wasConnected && connectionState_ == ConnectionState::UP) {
+    // The server dropped the idle standby (e.g. an idle timeout); open a
+    // fresh one so the next reconnect still finds a warm socket. Failed
+    // connect attempts are not retried here, to avoid hammering an
+    // unhealthy destination; the next successful connect re-warms.
+    maybeWarmStandby();
+  }
+}
+
 void AsyncMcClientImpl::attemptConnection() {
   // We may use a lot of stack memory (e.g. hostname resolution) or some
   // expensive SSL code. This should be always executed on main context.
@@ -424,12 +697,42 @@ void AsyncMcClientImpl::attemptConnection() {
 
     connectionState_ = ConnectionState::CONNECTING;
 
+    if (standby_ && standby_->ready()) {
+      // Adopt the kept-warm standby socket instead of paying the connect
+      // round trip; connectSuccess() opens a replacement.
+      socket_ = standby_->takeSocket();
+      standby_.reset();
+      connectSuccess();
+      return;
+    }
+
     if (connectionOptions_.noNetwork) {
       socket_.reset(new MockMcClientTransport(eventBase_));
       connectSuccess();
       return;
     }
 
+    if (connectionOptions_.useUdp) {
+      folly::SocketAddress address;
+      try {
+        address = folly::SocketAddress(
+          connectionOptions_.accessPoint->getHost(),
+          connectionOptions_.accessPoint->getPort(),
+          /* allowNameLookup */ true);
+        socket_.reset(new UdpClientTransport(eventBase_, address));
+      } catch (const std::exception& e) {
+        LOG_FAILURE("AsyncMcClient", failure::Category::kBadEnvironment,
+                    "{}", e.what());
+        connectErr(folly::AsyncSocketException(
+                       folly::AsyncSocketException::NOT_OPEN, ""));
+        return;
+      }
+      // A connected UDP socket is usable immediately; there's no
+      // handshake to wait out.
+      connectSuccess();
+      return;
+    }
+
     if (connectionOptions_.sslContextProvider) {
       auto sslContext = connectionOptions_.sslContextProvider();
       if (!sslContext) {
@@ -448,6 +751,24 @@ void AsyncMcClientImpl::attemptConnection() {
       }
       socket_.reset(sslSocket);
     } else {
+      // For dual-stack destinations race one plain connect per address
+      // family and keep whichever succeeds first, instead of waiting out
+      // the full connect timeout on a broken family before failover kicks
+      // in. SSL stays on the single-attempt path below since racing full
+      // handshakes would burn CPU on the loser.
+      auto addresses = connectionOptions_.accessPoint->resolve();
+      if (addresses.size() > 1) {
+        for (auto& address : addresses) {
+          connectAttempts_.push_back(folly::make_unique<ConnectionAttempt>(
+              *this, std::move(address)));
+        }
+        // Iterate by index: a synchronous connect failure on the last
+        // outstanding attempt clears the list.
+        for (size_t i = 0; i < connectAttempts_.size(); ++i) {
+          connectAttempts_[i]->start();
+        }
+        return;
+      }
       socket_.reset(new folly::AsyncSocket(&eventBase_));
     }
 
@@ -520,6 +841,8 @@ void AsyncMcClientImpl::connectSuccess() noexcept {
       connectionOptions_.compressionCodecMap,
       &debugFifo_);
   socket_->setReadCB(this);
+
+  maybeWarmStandby();
 }
 
 void AsyncMcClientImpl::connectErr(
@@ -560,6 +883,31 @@ void AsyncMcClientImpl::connectErr(
   }
 }
 
+void AsyncMcClientImpl::connectAttemptSuccess(
+    ConnectionAttempt& attempt) noexcept {
+  assert(connectionState_ == ConnectionState::CONNECTING);
+  socket_ = attempt.releaseSocket();
+  // Destroys the losing attempts (aborting their connects without
+  // callbacks) as well as `attempt` itself, whose socket we just took.
+  connectAttempts_.clear();
+  connectSuccess();
+}
+
+void AsyncMcClientImpl::connectAttemptErr(
+    ConnectionAttempt& /* attempt */,
+    const folly::AsyncSocketException& ex) noexcept {
+  assert(connectionState_ == ConnectionState::CONNECTING);
+  for (const auto& a : connectAttempts_) {
+    if (!a->finished()) {
+      // Another attempt may still win; stay in CONNECTING.
+      return;
+    }
+  }
+  connectAttempts_.clear();
+  // Every attempt failed; report whichever error came last.
+  connectErr(ex);
+}
+
 void AsyncMcClientImpl::processShutdown() {
   DestructorGuard dg(this);
   switch (connectionState_) {
@@ -619,6 +967,20 @@ void AsyncMcClientImpl::getReadBuffer(void** bufReturn, size_t* lenReturn) {
 void AsyncMcClientImpl::readDataAvailable(size_t len) noexcept {
   assert(curBuffer_.first != nullptr && curBuffer_.second >= len);
   DestructorGuard dg(this);
+  if (auto* udp = udpTransport()) {
+    if (udp->repliesDelivered() != udpRepliesSeen_) {
+      udpRepliesSeen_ = udp->repliesDelivered();
+      // A reply whose request already timed out must not reach the
+      // parser: the ascii parser treats a reply it can't match as a
+      // fatal protocol error. The datagram framing guarantees that the
+      // bytes we swallow here cover exactly that one stale reply.
+      udpDiscardReply_ =
+          queue_.getParserInitializer(udpCurrentReplyId()) == nullptr;
+    }
+    if (udpDiscardReply_) {
+      return;
+    }
+  }
   parser_->readDataAvailable(len);
 }
 
@@ -640,12 +1002,18 @@ void AsyncMcClientImpl::writeSuccess() noexcept {
   assert(connectionState_ == ConnectionState::UP ||
          connectionState_ == ConnectionState::ERROR);
   DestructorGuard dg(this);
-  auto& req = queue_.markNextAsSent();
-  req.scheduleTimeout();
 
-  // In case of no-network we need to provide fake reply.
-  if (connectionOptions_.noNetwork) {
-    sendFakeReply(req);
+  assert(!writeBatches_.empty());
+  auto batchSize = writeBatches_.front();
+  writeBatches_.pop_front();
+  while (batchSize-- > 0) {
+    auto& req = queue_.markNextAsSent();
+    timeoutWheel_.scheduleTimeout(req);
+
+    // In case of no-network we need to provide fake reply.
+    if (connectionOptions_.noNetwork) {
+      sendFakeReply(req);
+    }
   }
 
   // It is possible that we're already processing error, but still have a
@@ -668,7 +1036,12 @@ void AsyncMcClientImpl::writeErr(
 
   // We're already in an error state, so all requests in pendingReplyQueue_ will
   // be replied with an error.
-  queue_.markNextAsSent();
+  assert(!writeBatches_.empty());
+  auto batchSize = writeBatches_.front();
+  writeBatches_.pop_front();
+  while (batchSize-- > 0) {
+    queue_.markNextAsSent();
+  }
   processShutdown();
 }
 
@@ -705,6 +1078,12 @@ void AsyncMcClientImpl::parseError(mc_res_t result, folly::StringPiece reason) {
 bool AsyncMcClientImpl::nextReplyAvailable(uint64_t reqId) {
   assert(connectionState_ == ConnectionState::UP);
 
+  if (connectionOptions_.useUdp) {
+    // Ascii parsing always reports id 0; over UDP the real id comes
+    // from the frame header of the datagram being delivered.
+    reqId = udpCurrentReplyId();
+  }
+
   auto initializer = queue_.getParserInitializer(reqId);
 
   if (initializer) {
@@ -767,6 +1146,25 @@ void AsyncMcClientImpl::sendFakeReply(McClientRequestContextBase& request) {
   transport.fakeDataRead(msg, msgLen);
 }
 
+UdpClientTransport* AsyncMcClientImpl::udpTransport() const {
+  return connectionOptions_.useUdp
+      ? static_cast<UdpClientTransport*>(socket_.get())
+      : nullptr;
+}
+
+uint64_t AsyncMcClientImpl::udpCurrentReplyId() const {
+  const uint64_t low =
+      static_cast<UdpClientTransport&>(*socket_).currentRequestId();
+  // The frame echoes only the low 16 bits; the matching full id is the
+  // largest id issued so far (nextMsgId_ - 1 or below) with those bits.
+  const uint64_t last = nextMsgId_ - 1;
+  uint64_t id = (last & ~uint64_t(0xffff)) | low;
+  if (id > last) {
+    id -= uint64_t(1) << 16;
+  }
+  return id;
+}
+
 void AsyncMcClientImpl::incMsgId(size_t& msgId) {
   ++msgId;
   if (UNLIKELY(msgId == 0)) {
@@ -774,6 +1172,20 @@ void AsyncMcClientImpl::incMsgId(size_t& msgId) {
   }
 }
 
+bool AsyncMcClientImpl::isSaturated() const {
+  if (connectionState_ != ConnectionState::UP ||
+      connectionOptions_.tcpNotsentLowat == 0) {
+    return false;
+  }
+  // With TCP_NOTSENT_LOWAT set, the kernel stops accepting data it can't
+  // send yet and the backlog accumulates inside the transport instead;
+  // more than a watermark's worth of it means the connection can't keep
+  // up and new requests would only sit in the buffer until they time out.
+  const auto buffered =
+      socket_->getAppBytesWritten() - socket_->getRawBytesWritten();
+  return buffered > connectionOptions_.tcpNotsentLowat;
+}
+
 void AsyncMcClientImpl::updateWriteTimeout(std::chrono::milliseconds timeout) {
   if (!timeout.count()) {
     return;
@@ -10,7 +10,9 @@
 #pragma once
 
 #include <chrono>
+#include <deque>
 #include <string>
+#include <vector>
 
 #include <folly/fibers/Baton.h>
 #include <folly/io/async/AsyncTransport.h>
@@ -25,6 +27,7 @@
 #include "mcrouter/lib/network/ConnectionOptions.h"
 #include "mcrouter/lib/network/McClientRequestContext.h"
 #include "mcrouter/lib/network/ReplyStatsContext.h"
+#include "mcrouter/lib/network/RequestTimeoutWheel.h"
 
 namespace facebook { namespace memcache {
 
@@ -32,6 +35,8 @@ namespace detail {
 class OnEventBaseDestructionCallback;
 } // detail
 
+class UdpClientTransport;
+
 /**
  * A base class for network communication with memcache protocol.
  *
@@ -74,6 +79,15 @@ class AsyncMcClientImpl :
   size_t getPendingRequestCount() const;
   size_t getInflightRequestCount() const;
 
+  /**
+   * @return  true if the connection's send path is backed up: with
+   *          TCP_NOTSENT_LOWAT configured, more than a watermark's worth
+   *          of data is waiting inside the transport because the kernel
+   *          stopped accepting it. Always false when the watermark is
+   *          not configured.
+   */
+  bool isSaturated() const;
+
   void updateWriteTimeout(std::chrono::milliseconds timeout);
 
   /**
@@ -134,6 +148,10 @@ class AsyncMcClientImpl :
   bool outOfOrder_{false};
   McClientRequestContextQueue queue_;
 
+  // Coarse-tick wheel driving the wait timeout of every in-flight
+  // request on this client.
+  RequestTimeoutWheel timeoutWheel_;
+
   // Id for the next message that will be used by the next sendMsg() call.
   uint64_t nextMsgId_{1};
 
@@ -150,6 +168,32 @@ class AsyncMcClientImpl :
   bool writeScheduled_{false};
   std::unique_ptr<WriterLoop> writer_;
 
+  // In-flight racing connection attempts (at most one per address
+  // family), non-empty only while CONNECTING to a dual-stack
+  // destination. The first attempt to succeed becomes socket_.
+  class ConnectionAttempt;
+  std::vector<std::unique_ptr<ConnectionAttempt>> connectAttempts_;
+
+  // Kept-warm standby socket for this destination (see
+  // ConnectionOptions::keepStandbyConnection); non-null from the first
+  // successful connect until the standby is adopted or breaks.
+  class StandbyConnection;
+  std::unique_ptr<StandbyConnection> standby_;
+
+  // Number of requests coalesced into each in-flight writev, in issue
+  // order.  writeSuccess()/writeErr() fire once per writev and mark the
+  // front batch's worth of requests as sent.
+  std::deque<size_t> writeBatches_;
+
+  // With ConnectionOptions::useUdp, number of UDP replies the transport
+  // had delivered as of the last readDataAvailable(); when it changes, a
+  // new reply started and the discard decision below is re-made.
+  uint64_t udpRepliesSeen_{0};
+  // True while the UDP reply currently arriving belongs to no pending
+  // request (it came back after its request timed out) and its data must
+  // not reach the parser.
+  bool udpDiscardReply_{false};
+
   bool isAborting_{false};
   std::unique_ptr<detail::OnEventBaseDestructionCallback>
     eventBaseDestructionCallback_;
@@ -162,6 +206,23 @@ class AsyncMcClientImpl :
   // Common part for send/sendSync.
   void sendCommon(McClientRequestContextBase& req);
 
+  /**
+   * Picks the parser initializer for a request up front from the
+   * connection's (fixed) protocol, so the per-reply initializer installs
+   * the matching reply forwarder without re-branching on protocol on the
+   * receive path.  Requests outside McRequestList are Caret-only.
+   */
+  template <class Request>
+  static typename std::enable_if<
+      ListContains<McRequestList, Request>::value,
+      McClientRequestContextBase::InitializerFuncPtr>::type
+  selectParserInitializer(mc_protocol_t protocol);
+  template <class Request>
+  static typename std::enable_if<
+      !ListContains<McRequestList, Request>::value,
+      McClientRequestContextBase::InitializerFuncPtr>::type
+  selectParserInitializer(mc_protocol_t protocol);
+
   // Write some requests from sendQueue_ to the socket, until max inflight limit
   // is reached or queue is empty.
   void pushMessages();
@@ -181,6 +242,27 @@ class AsyncMcClientImpl :
   void connectErr(const folly::AsyncSocketException& ex)
     noexcept override final;
 
+  // Outcome handlers for racing connection attempts. The winner's socket
+  // is adopted into socket_; an error is reported only once every
+  // attempt has failed.
+  void connectAttemptSuccess(ConnectionAttempt& attempt) noexcept;
+  void connectAttemptErr(ConnectionAttempt& attempt,
+                         const folly::AsyncSocketException& ex) noexcept;
+
+  // Open a standby connection if the options ask for one and none exists.
+  void maybeWarmStandby();
+  // The standby broke (connect failure, or the server closed it while
+  // idle); drop it and possibly open a fresh one.
+  void standbyBroken(bool wasConnected) noexcept;
+
+  // The transport as a UdpClientTransport, or nullptr when the client is
+  // not in UDP mode (or not connected).
+  UdpClientTransport* udpTransport() const;
+  // Full 64-bit id of the request whose reply the UDP transport is
+  // currently delivering, reconstructed from the 16 bits echoed in the
+  // frame header and the ids issued so far.
+  uint64_t udpCurrentReplyId() const;
+
   // We've have encountered some error or we're shutting down the client.
   // It goes to DOWN state.
   void processShutdown();
@@ -16,17 +16,21 @@
 #include <chrono>
 #include <condition_variable>
 #include <cstdio>
+#include <deque>
 #include <mutex>
 #include <thread>
 
 #include <folly/io/async/AsyncServerSocket.h>
+#include <folly/io/async/AsyncTimeout.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/SSLContext.h>
 #include <folly/Memory.h>
 #include <folly/String.h>
 
 #include "mcrouter/lib/network/AsyncMcServerWorker.h"
+#include "mcrouter/lib/network/SSLHandshakePool.h"
 #include "mcrouter/lib/network/ThreadLocalSSLContextProvider.h"
+#include "mcrouter/lib/network/UdpListener.h"
 
 namespace facebook { namespace memcache {
 
@@ -70,7 +74,8 @@ class McServerThread {
         evb_(/* enableTimeMeasurement */ false),
         worker_(server.opts_.worker, evb_),
         acceptCallback_(this, false),
-        sslAcceptCallback_(this, true) {
+        sslAcceptCallback_(this, true),
+        accepting_(server.opts_.reusePort) {
   }
 
   enum AcceptorT { Acceptor };
@@ -91,6 +96,22 @@ class McServerThread {
     return evb_;
   }
 
+  AsyncMcServerWorker& worker() {
+    return worker_;
+  }
+
+  /* Valid only on the acceptor thread object, after acceptor setup */
+  std::pair<std::vector<int>, std::vector<int>> listenSocketFds() const {
+    std::pair<std::vector<int>, std::vector<int>> out;
+    if (socket_) {
+      out.first = socket_->getSockets();
+    }
+    if (sslSocket_) {
+      out.second = sslSocket_->getSockets();
+    }
+    return out;
+  }
+
   void waitForAcceptor() {
     std::unique_lock<std::mutex> lock(acceptorLock_);
     acceptorCv_.wait(lock, [this] () { return acceptorSetup_; });
@@ -116,6 +137,8 @@ class McServerThread {
           }
         }
 
+        startUdpListeners();
+
         fn(threadId, evb_, worker_);
 
         // Detach the server sockets from the acceptor thread.
@@ -140,6 +163,7 @@ class McServerThread {
         if (shutdownPipe_) {
           shutdownPipe_->unregisterHandler();
         }
+        udpListeners_.clear();
         worker_.shutdown();
       });
     CHECK(result) << "error calling runInEventBaseThread";
@@ -167,13 +191,26 @@ class McServerThread {
         int fd,
         const folly::SocketAddress& clientAddr) noexcept override final {
       if (secure_) {
-        auto& opts = mcServerThread_->server_.opts_;
+        auto& server = mcServerThread_->server_;
+        auto& opts = server.opts_;
         auto sslCtx = getSSLContext(opts.pemCertPath, opts.pemKeyPath,
                                     opts.pemCaPath);
         if (sslCtx) {
           sslCtx->setVerificationOption(
             folly::SSLContext::SSLVerifyPeerEnum::VERIFY_REQ_CLIENT_CERT);
-          mcServerThread_->worker_.addSecureClientSocket(fd, std::move(sslCtx));
+          if (server.handshakePool_) {
+            // Handshake off the worker loop; the established socket
+            // comes back on this worker's event base.
+            auto worker = &mcServerThread_->worker_;
+            server.handshakePool_->startHandshake(
+                fd, std::move(sslCtx), mcServerThread_->evb_,
+                [worker](folly::AsyncSocket::UniquePtr socket) {
+                  worker->addHandshakenSecureSocket(std::move(socket));
+                });
+          } else {
+            mcServerThread_->worker_.addSecureClientSocket(
+                fd, std::move(sslCtx));
+          }
         } else {
           ::close(fd);
         }
@@ -206,14 +243,54 @@ class McServerThread {
 
   folly::AsyncServerSocket::UniquePtr socket_;
   folly::AsyncServerSocket::UniquePtr sslSocket_;
+  std::vector<std::unique_ptr<UdpListener>> udpListeners_;
   std::unique_ptr<ShutdownPipe> shutdownPipe_;
 
+  /* Every thread binds each UDP port itself (SO_REUSEPORT) */
+  void startUdpListeners() {
+    for (auto port : server_.opts_.udpPorts) {
+      try {
+        udpListeners_.push_back(
+            folly::make_unique<UdpListener>(worker_, evb_, port));
+      } catch (const std::exception& ex) {
+        LOG(ERROR) << "Failed to start UDP listener on port " << port
+                   << ": " << ex.what();
+      }
+    }
+  }
+
   void startAccepting() {
     CHECK(accepting_);
     try {
       auto& opts = server_.opts_;
 
-      if (opts.existingSocketFd != -1) {
+      if (opts.reusePort) {
+        checkLogic(opts.existingSocketFd == -1 &&
+                   opts.existingSocketFds.empty() &&
+                   opts.existingSslSocketFds.empty() &&
+                   opts.unixDomainSockPath.empty(),
+                   "SO_REUSEPORT mode requires listening on ports");
+      }
+
+      if (!opts.existingSocketFds.empty() ||
+          !opts.existingSslSocketFds.empty()) {
+        checkLogic(opts.ports.empty() && opts.sslPorts.empty() &&
+                   opts.existingSocketFd == -1 &&
+                   opts.unixDomainSockPath.empty(),
+                   "Can't use ports or other sockets with existing sockets");
+        if (!opts.existingSocketFds.empty()) {
+          socket_.reset(new folly::AsyncServerSocket());
+          socket_->useExistingSockets(opts.existingSocketFds);
+        }
+        if (!opts.existingSslSocketFds.empty()) {
+          checkLogic(!opts.pemCertPath.empty() && !opts.pemKeyPath.empty() &&
+                     !opts.pemCaPath.empty(),
+                     "All of pemCertPath, pemKeyPath, pemCaPath required "
+                     "with existing SSL sockets");
+          sslSocket_.reset(new folly::AsyncServerSocket());
+          sslSocket_->useExistingSockets(opts.existingSslSocketFds);
+        }
+      } else if (opts.existingSocketFd != -1) {
         checkLogic(opts.ports.empty() && opts.sslPorts.empty(),
                    "Can't use ports if using existing socket");
         if (!opts.pemCertPath.empty() || !opts.pemKeyPath.empty() ||
@@ -245,6 +322,7 @@ class McServerThread {
                    "At least one port (plain or SSL) must be speicified");
         if (!server_.opts_.ports.empty()) {
           socket_.reset(new folly::AsyncServerSocket());
+          socket_->setReusePortEnabled(opts.reusePort);
           for (auto port : server_.opts_.ports) {
             socket_->bind(port);
           }
@@ -257,6 +335,7 @@ class McServerThread {
                      " with sslPorts");
 
           sslSocket_.reset(new folly::AsyncServerSocket());
+          sslSocket_->setReusePortEnabled(opts.reusePort);
           for (auto sslPort : server_.opts_.sslPorts) {
             sslSocket_->bind(sslPort);
           }
@@ -274,12 +353,22 @@ class McServerThread {
         sslSocket_->attachEventBase(&evb_);
       }
 
-      for (auto& t : server_.threads_) {
+      if (opts.reusePort) {
+        /* Each worker accepts only on its own socket */
         if (socket_ != nullptr) {
-          socket_->addAcceptCallback(&t->acceptCallback_, &t->evb_);
+          socket_->addAcceptCallback(&acceptCallback_, &evb_);
         }
         if (sslSocket_ != nullptr) {
-          sslSocket_->addAcceptCallback(&t->sslAcceptCallback_, &t->evb_);
+          sslSocket_->addAcceptCallback(&sslAcceptCallback_, &evb_);
+        }
+      } else {
+        for (auto& t : server_.threads_) {
+          if (socket_ != nullptr) {
+            socket_->addAcceptCallback(&t->acceptCallback_, &t->evb_);
+          }
+          if (sslSocket_ != nullptr) {
+            sslSocket_->addAcceptCallback(&t->sslAcceptCallback_, &t->evb_);
+          }
         }
       }
     } catch (...) {
@@ -294,6 +383,98 @@ class McServerThread {
   }
 };
 
+/**
+ * Periodically compares per-worker request rates and moves one hot
+ * connection at a time from the busiest worker to the least loaded one.
+ * The timer runs on the acceptor thread's event base; load collection
+ * and the fd detach/attach hop onto the owning workers' event bases, so
+ * all session manipulation stays single threaded.
+ */
+class ConnectionRebalancer : public folly::AsyncTimeout {
+ public:
+  ConnectionRebalancer(AsyncMcServer& server,
+                       std::chrono::milliseconds interval)
+      : folly::AsyncTimeout(&server.threads_[0]->eventBase()),
+        server_(server),
+        interval_(interval),
+        loads_(server.threads_.size()) {
+    for (auto& load : loads_) {
+      load.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  /* Both must be called on the acceptor thread's event base */
+  void start() {
+    scheduleTimeout(interval_.count());
+  }
+  void stop() {
+    cancelTimeout();
+  }
+
+  void timeoutExpired() noexcept override final {
+    if (!server_.alive_) {
+      return;
+    }
+    rebalance();
+    collectLoads();
+    scheduleTimeout(interval_.count());
+  }
+
+ private:
+  /* Don't bother migrating until the busiest worker sees real traffic */
+  static constexpr uint64_t kMinLoadToRebalance = 1000;
+
+  AsyncMcServer& server_;
+  const std::chrono::milliseconds interval_;
+  /* Per-worker loads published from the workers' event base threads */
+  std::deque<std::atomic<uint64_t>> loads_;
+
+  void collectLoads() {
+    for (size_t i = 0; i < server_.threads_.size(); ++i) {
+      auto thread = server_.threads_[i].get();
+      auto& slot = loads_[i];
+      thread->eventBase().runInEventBaseThread([thread, &slot]() {
+        slot.store(thread->worker().collectLoad(), std::memory_order_relaxed);
+      });
+    }
+  }
+
+  void rebalance() {
+    size_t busiest = 0;
+    size_t idlest = 0;
+    for (size_t i = 1; i < loads_.size(); ++i) {
+      auto load = loads_[i].load(std::memory_order_relaxed);
+      if (load > loads_[busiest].load(std::memory_order_relaxed)) {
+        busiest = i;
+      }
+      if (load < loads_[idlest].load(std::memory_order_relaxed)) {
+        idlest = i;
+      }
+    }
+    const auto maxLoad = loads_[busiest].load(std::memory_order_relaxed);
+    const auto minLoad = loads_[idlest].load(std::memory_order_relaxed);
+    if (busiest == idlest || maxLoad < kMinLoadToRebalance ||
+        maxLoad < 2 * minLoad) {
+      return;
+    }
+
+    auto source = server_.threads_[busiest].get();
+    auto target = server_.threads_[idlest].get();
+    source->eventBase().runInEventBaseThread([source, target]() {
+      auto fd = source->worker().detachBusiestConnectionFd();
+      if (fd < 0) {
+        return;
+      }
+      target->eventBase().runInEventBaseThread([target, fd]() {
+        /* On failure the transport owns the fd and closes it */
+        target->worker().addClientSocket(fd);
+      });
+    });
+  }
+};
+
+constexpr uint64_t ConnectionRebalancer::kMinLoadToRebalance;
+
 void AsyncMcServer::Options::setPerThreadMaxConns(size_t globalMaxConns,
                                                   size_t numThreads_) {
   if (globalMaxConns == 0) {
@@ -328,6 +509,10 @@ AsyncMcServer::AsyncMcServer(Options opts)
   }
 
   CHECK(opts_.numThreads > 0);
+  if (opts_.numSslHandshakeThreads > 0) {
+    handshakePool_ =
+      folly::make_unique<SSLHandshakePool>(opts_.numSslHandshakeThreads);
+  }
   threads_.emplace_back(folly::make_unique<McServerThread>(
                           McServerThread::Acceptor, *this));
   for (size_t i = 1; i < opts_.numThreads; ++i) {
@@ -362,6 +547,17 @@ void AsyncMcServer::spawn(LoopFn fn, std::function<void()> onShutdown) {
   threads_[0]->waitForAcceptor();
   for (size_t id = 1; id < threads_.size(); ++id) {
     threads_[id]->spawn(fn, id);
+    if (opts_.reusePort) {
+      /* Every thread binds its own listener; propagate bind errors here */
+      threads_[id]->waitForAcceptor();
+    }
+  }
+
+  if (opts_.connectionRebalanceInterval.count() > 0 && threads_.size() > 1) {
+    rebalancer_ = folly::make_unique<ConnectionRebalancer>(
+        *this, opts_.connectionRebalanceInterval);
+    threads_[0]->eventBase().runInEventBaseThread(
+        [this]() { rebalancer_->start(); });
   }
 
   /* We atomically attempt to change the state STARTUP -> SPAWNED.
@@ -379,6 +575,13 @@ void AsyncMcServer::spawn(LoopFn fn, std::function<void()> onShutdown) {
              SignalShutdownState::SPAWNED));
 }
 
+std::pair<std::vector<int>, std::vector<int>>
+AsyncMcServer::listenSocketFds() const {
+  checkLogic(!opts_.reusePort,
+             "listenSocketFds() is not supported in SO_REUSEPORT mode");
+  return threads_[0]->listenSocketFds();
+}
+
 void AsyncMcServer::shutdown() {
   if (!alive_.exchange(false)) {
     return;
@@ -388,6 +591,11 @@ void AsyncMcServer::shutdown() {
     onShutdown_();
   }
 
+  if (rebalancer_) {
+    threads_[0]->eventBase().runInEventBaseThread(
+        [this]() { rebalancer_->stop(); });
+  }
+
   for (auto& thread : threads_) {
     thread->shutdown();
   }
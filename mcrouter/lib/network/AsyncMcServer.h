@@ -10,9 +10,11 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <sys/socket.h>
@@ -27,7 +29,9 @@ class EventBase;
 namespace facebook { namespace memcache {
 
 class AsyncMcServerWorker;
+class ConnectionRebalancer;
 class McServerThread;
+class SSLHandshakePool;
 
 /**
  * A multithreaded, asynchronous MC protocol server.
@@ -47,6 +51,17 @@ class AsyncMcServer {
      */
     int existingSocketFd{-1};
 
+    /**
+     * Take over externally created listen sockets, e.g. received from a
+     * predecessor process during a zero-downtime restart. The server will
+     * call listen(), but not bind(). Sockets in existingSslSocketFds are
+     * served as SSL (the pem* paths are required if it is non-empty).
+     * If either list is non-empty, ports/sslPorts must be empty and
+     * existingSocketFd must be unset (-1).
+     */
+    std::vector<int> existingSocketFds;
+    std::vector<int> existingSslSocketFds;
+
     /**
      * Create Unix Domain Socket to listen on.
      * If this is used (not empty), port must be empty,
@@ -59,6 +74,16 @@ class AsyncMcServer {
      */
     int tcpListenBacklog{SOMAXCONN};
 
+    /**
+     * If true, every worker thread opens its own listening socket with
+     * SO_REUSEPORT and accepts independently, letting the kernel spread
+     * incoming connections across workers.  Avoids serializing accepts
+     * through a single acceptor thread under connection storms.
+     * Requires `ports`/`sslPorts`; incompatible with existingSocketFd
+     * and unixDomainSockPath.
+     */
+    bool reusePort{false};
+
     /**
      * The list of ports to listen on.
      * If this is used, existingSocketFd must be unset (-1).
@@ -71,6 +96,14 @@ class AsyncMcServer {
      */
     std::vector<uint16_t> sslPorts;
 
+    /**
+     * The list of UDP ports to serve (memcached UDP protocol).
+     * Every worker thread binds each port with SO_REUSEPORT, so the
+     * kernel spreads datagrams across workers.  May be combined with
+     * TCP `ports`.  Intended for small single-key get/metaget traffic.
+     */
+    std::vector<uint16_t> udpPorts;
+
     /**
      * SSL cert/key/CA paths.
      * If sslPorts is non-empty, these must also be nonempty.
@@ -79,11 +112,31 @@ class AsyncMcServer {
     std::string pemKeyPath;
     std::string pemCaPath;
 
+    /**
+     * If nonzero, TLS handshakes of accepted connections run on a
+     * dedicated pool of this many threads instead of inline on the
+     * worker event bases, so a reconnect storm doesn't stall request
+     * processing for established connections.  The established socket
+     * is handed back to the accepting worker.
+     * Zero keeps handshakes on the workers.
+     */
+    size_t numSslHandshakeThreads{0};
+
     /**
      * Number of threads to spawn, must be positive.
      */
     size_t numThreads{1};
 
+    /**
+     * If nonzero, periodically compare per-worker request rates and move
+     * one hot connection at a time from the busiest worker to the least
+     * loaded one.  Connections only migrate at a message boundary with
+     * nothing in flight; SSL connections never migrate.  Evens out
+     * per-worker load when a few chatty clients pin one worker.
+     * Zero disables rebalancing.
+     */
+    std::chrono::milliseconds connectionRebalanceInterval{0};
+
     /**
      * Worker-specific options
      */
@@ -156,6 +209,16 @@ class AsyncMcServer {
    */
   void installShutdownHandler(const std::vector<int>& signals);
 
+  /**
+   * The TCP listen socket fds this server accepts on, e.g. to pass them
+   * to a successor process during a zero-downtime restart.
+   * Can only be called after spawn(); not supported with reusePort mode
+   * (every worker owns its own sockets there).
+   *
+   * @return (plaintext fds, SSL fds)
+   */
+  std::pair<std::vector<int>, std::vector<int>> listenSocketFds() const;
+
   /**
    * Signal handler-safe version of shutdown.
    * Can only be called after spawn().
@@ -170,6 +233,9 @@ class AsyncMcServer {
  private:
   Options opts_;
   std::vector<std::unique_ptr<McServerThread>> threads_;
+  std::unique_ptr<ConnectionRebalancer> rebalancer_;
+  /* Non-null only when opts_.numSslHandshakeThreads > 0 */
+  std::unique_ptr<SSLHandshakePool> handshakePool_;
 
   std::atomic<bool> alive_{true};
   std::function<void()> onShutdown_;
@@ -185,6 +251,7 @@ class AsyncMcServer {
   AsyncMcServer(const AsyncMcServer&) = delete;
   AsyncMcServer& operator=(const AsyncMcServer&) = delete;
 
+  friend class ConnectionRebalancer;
   friend class McServerThread;
 };
 
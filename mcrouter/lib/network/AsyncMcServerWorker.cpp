@@ -9,12 +9,21 @@
  */
 #include "AsyncMcServerWorker.h"
 
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
 #include <folly/io/async/AsyncSocket.h>
 #include <folly/io/async/AsyncSSLSocket.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/SSLContext.h>
 #include <folly/Memory.h>
+#include <folly/small_vector.h>
 
+#include "mcrouter/lib/network/IoUringWriter.h"
 #include "mcrouter/lib/network/McServerSession.h"
 
 namespace facebook { namespace memcache {
@@ -23,20 +32,86 @@ AsyncMcServerWorker::AsyncMcServerWorker(AsyncMcServerWorkerOptions opts,
                                          folly::EventBase& eventBase)
     : opts_(std::move(opts)),
       eventBase_(eventBase),
+      flushBatcher_(eventBase),
       tracker_(opts_.maxConns) {
+  tracker_.setOnWriteScheduled(
+      [this](McServerSession& session) { return flushBatcher_.add(session); });
+  writeBufferPool_ =
+      folly::make_unique<WriteBufferPool>(opts_.maxPooledWriteBuffers);
+  opts_.writeBufferPool = writeBufferPool_.get();
+  if (opts_.maxEgressBytes > 0) {
+    egressAccount_ = folly::make_unique<WorkerEgressAccount>();
+    opts_.egressAccount = egressAccount_.get();
+  }
+  if (opts_.defaultVersionHandler) {
+    opts_.packedAsciiVersionReply = std::make_shared<const std::string>(
+        "VERSION " + opts_.versionString + "\r\n");
+  }
+  if (opts_.useIoUring && IoUringWriter::isAvailable()) {
+    ioUringWriter_ = folly::make_unique<IoUringWriter>(eventBase_);
+    opts_.ioUringWriter = ioUringWriter_.get();
+  }
+}
+
+bool AsyncMcServerWorker::FlushBatcher::add(McServerSession& session) {
+  pendingFlush_.push_back(session);
+  if (!scheduled_) {
+    eventBase_.runInLoop(this, /* thisIteration= */ true);
+    scheduled_ = true;
+  }
+  return true;
+}
+
+void AsyncMcServerWorker::FlushBatcher::runLoopCallback() noexcept {
+  scheduled_ = false;
+
+  /* Sessions created close together tend to be close in memory, so
+     flushing in address order keeps this pass cache friendly */
+  folly::small_vector<McServerSession*, 64> sessions;
+  while (!pendingFlush_.empty()) {
+    auto& session = pendingFlush_.front();
+    pendingFlush_.pop_front();
+    sessions.push_back(&session);
+  }
+  std::sort(sessions.begin(), sessions.end());
+  for (auto session : sessions) {
+    session->flushWrites();
+  }
+}
+
+bool AsyncMcServerWorker::shedIfOverloaded(int fd) const {
+  if (opts_.maxConns == 0 ||
+      tracker_.numConnections() < 2 * opts_.maxConns) {
+    return false;
+  }
+  ::close(fd);
+  return true;
 }
 
 bool AsyncMcServerWorker::addSecureClientSocket(
     int fd,
     const std::shared_ptr<folly::SSLContext>& context,
     void* userCtxt) {
+  if (shedIfOverloaded(fd)) {
+    return false;
+  }
   folly::AsyncSSLSocket::UniquePtr sslSocket(
       new folly::AsyncSSLSocket(
           context, &eventBase_, fd, /* server = */ true));
   return addClientSocket(std::move(sslSocket), userCtxt);
 }
 
+bool AsyncMcServerWorker::addHandshakenSecureSocket(
+    folly::AsyncSocket::UniquePtr socket,
+    void* userCtxt) {
+  socket->attachEventBase(&eventBase_);
+  return addClientSocket(std::move(socket), userCtxt);
+}
+
 bool AsyncMcServerWorker::addClientSocket(int fd, void* userCtxt) {
+  if (shedIfOverloaded(fd)) {
+    return false;
+  }
   auto socket = folly::AsyncSocket::UniquePtr(
       new folly::AsyncSocket(&eventBase_, fd));
   return addClientSocket(std::move(socket), userCtxt);
@@ -57,6 +132,16 @@ bool AsyncMcServerWorker::addClientSocket(
   socket->setMaxReadsPerEvent(opts_.maxReadsPerEvent);
   socket->setNoDelay(true);
 
+#ifdef SO_BUSY_POLL
+  if (opts_.busyPollUs > 0) {
+    const int busyPollUs = opts_.busyPollUs;
+    if (setsockopt(socket->getFd(), SOL_SOCKET, SO_BUSY_POLL,
+                   &busyPollUs, sizeof(busyPollUs)) != 0) {
+      PLOG(WARNING) << "Failed to set SO_BUSY_POLL on client socket";
+    }
+  }
+#endif // SO_BUSY_POLL
+
   try {
     tracker_.add(
         std::move(socket), onRequest_, opts_, userCtxt, compressionCodecMap_);
@@ -67,6 +152,33 @@ bool AsyncMcServerWorker::addClientSocket(
   }
 }
 
+bool AsyncMcServerWorker::addUdpTransport(
+    folly::AsyncTransportWrapper::UniquePtr transport,
+    void* userCtxt) {
+  if (!onRequest_) {
+    throw std::logic_error("can't add a transport without onRequest callback");
+  }
+
+  auto opts = opts_;
+  /* One writev() per reply so each reply maps onto its own datagram;
+     TCP-only write path features don't apply */
+  opts.singleWrite = true;
+  opts.zeroCopyThreshold = 0;
+  opts.ioUringWriter = nullptr;
+
+  try {
+    tracker_.add(
+        std::move(transport),
+        onRequest_,
+        std::move(opts),
+        userCtxt,
+        compressionCodecMap_);
+    return true;
+  } catch (const std::exception& ex) {
+    return false;
+  }
+}
+
 void AsyncMcServerWorker::shutdown() {
   if (!isAlive_) {
     return;
@@ -18,7 +18,9 @@
 
 #include "mcrouter/lib/network/AsyncMcServerWorkerOptions.h"
 #include "mcrouter/lib/network/ConnectionTracker.h"
+#include "mcrouter/lib/network/IoUringWriter.h"
 #include "mcrouter/lib/network/McServerRequestContext.h"
+#include "mcrouter/lib/network/WriteBuffer.h"
 #include "mcrouter/lib/network/McServerSession.h"
 
 namespace folly {
@@ -45,13 +47,27 @@ class AsyncMcServerWorker {
 
   /**
    * Moves in ownership of an externally accepted client socket.
+   * If the worker is far enough past its connection limit (see
+   * AsyncMcServerWorkerOptions::maxConns), the fd is closed outright
+   * without constructing a transport or session.
    * @return    true on success, false on error
    */
   bool addClientSocket(int fd, void* userCtxt = nullptr);
 
+  /**
+   * Moves in ownership of a caller-provided transport (e.g. a UDP peer
+   * pseudo-transport created by UdpListener).  The session runs in
+   * singleWrite mode so every reply maps onto its own datagram.
+   * @return    true on success, false on error
+   */
+  bool addUdpTransport(
+      folly::AsyncTransportWrapper::UniquePtr transport,
+      void* userCtxt = nullptr);
+
   /**
    * Moves in ownership of an externally accepted client socket with an ssl
-   * context which will be used to manage it.
+   * context which will be used to manage it.  Subject to the same
+   * overload shedding as addClientSocket(), applied before any TLS setup.
    * @return    true on success, false on error
    */
   bool addSecureClientSocket(
@@ -59,6 +75,17 @@ class AsyncMcServerWorker {
       const std::shared_ptr<folly::SSLContext>& context,
       void* userCtxt = nullptr);
 
+  /**
+   * Moves in ownership of a secure client socket whose TLS handshake
+   * already completed (e.g. on an SSLHandshakePool thread).  The socket
+   * must be detached; it is attached to this worker's event base.
+   * Must be called on this worker's event base thread.
+   * @return    true on success, false on error
+   */
+  bool addHandshakenSecureSocket(
+      folly::AsyncSocket::UniquePtr socket,
+      void* userCtxt = nullptr);
+
   /**
    * Install onRequest callback to call for each request.
    *
@@ -162,11 +189,50 @@ class AsyncMcServerWorker {
    */
   bool writesPending() const;
 
+  /**
+   * Decayed count of requests received by this worker's sessions since
+   * recent collections; see ConnectionTracker::collectRequestCount().
+   * Must be called on the worker's event base thread.
+   */
+  uint64_t collectLoad() {
+    return tracker_.collectRequestCount();
+  }
+
+  /**
+   * Detach the fd of the busiest connection that is at a message
+   * boundary, tearing down its session; the caller owns the fd and
+   * typically re-adds it on a less loaded worker.
+   * Must be called on the worker's event base thread.
+   *
+   * @return  the fd, or -1 if no connection can be moved right now.
+   */
+  int detachBusiestConnectionFd() {
+    return tracker_.detachBusiestConnectionFd();
+  }
+
+  /**
+   * Egress byte accounting for this worker's sessions (current totals
+   * and high-water marks), or nullptr when
+   * AsyncMcServerWorkerOptions::maxEgressBytes is unset.
+   * Must be read on the worker's event base thread.
+   */
+  const WorkerEgressAccount* egressAccount() const {
+    return egressAccount_.get();
+  }
+
  private:
   bool addClientSocket(
       folly::AsyncSocket::UniquePtr&& socket,
       void* userCtxt);
 
+  /**
+   * Close `fd` and return true if the worker is at least twice over its
+   * connection limit.  The tracker's LRU eviction still pays for
+   * transport, TLS and parser setup on each doomed connection, so under
+   * a connection storm we refuse new fds before constructing anything.
+   */
+  bool shedIfOverloaded(int fd) const;
+
   AsyncMcServerWorkerOptions opts_;
   folly::EventBase& eventBase_;
 
@@ -177,6 +243,37 @@ class AsyncMcServerWorker {
 
   bool isAlive_{true};
 
+  /**
+   * Aggregates flushes of all sessions with pending writes into a single
+   * loop callback per event loop iteration, instead of one loop callback
+   * per session.
+   */
+  class FlushBatcher : public folly::EventBase::LoopCallback {
+   public:
+    explicit FlushBatcher(folly::EventBase& evb) : eventBase_(evb) {}
+
+    /* McServerSession::StateCallback::onWriteScheduled contract */
+    bool add(McServerSession& session);
+
+    void runLoopCallback() noexcept override final;
+
+   private:
+    folly::EventBase& eventBase_;
+    McServerSession::FlushList pendingFlush_;
+    bool scheduled_{false};
+  };
+  FlushBatcher flushBatcher_;
+
+  /* Shared write batcher; non-null only when opts_.useIoUring is in effect */
+  std::unique_ptr<IoUringWriter> ioUringWriter_;
+
+  /* Bounded pool of write buffers shared by all sessions of this worker */
+  std::unique_ptr<WriteBufferPool> writeBufferPool_;
+
+  /* Shared egress accounting; non-null only when opts_.maxEgressBytes
+     is set */
+  std::unique_ptr<WorkerEgressAccount> egressAccount_;
+
   /* Open sessions and closing sessions that still have pending writes */
   ConnectionTracker tracker_;
 
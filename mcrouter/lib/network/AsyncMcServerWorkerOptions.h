@@ -12,10 +12,38 @@
 #include <chrono>
 #include <string>
 #include <memory>
+#include <vector>
+
+#include <folly/IPAddress.h>
 
 namespace facebook { namespace memcache {
 
 class CongestionController;
+class IoUringWriter;
+class WriteBufferPool;
+
+/**
+ * Egress byte accounting shared by all sessions of a worker (see
+ * AsyncMcServerWorkerOptions::maxEgressBytes).  Sessions add reply bytes
+ * as they are queued for write and subtract them once the write buffers
+ * are retired; the high-water fields are never reset and are meant for
+ * stats export.
+ *
+ * Single threaded; must only be used from the owning worker's thread.
+ */
+struct WorkerEgressAccount {
+  /* Reply bytes currently buffered across all sessions of the worker */
+  size_t bufferedBytes{0};
+
+  /* Open sessions; drives the per-session share of maxEgressBytes */
+  size_t numSessions{0};
+
+  /* High-water mark of bufferedBytes */
+  size_t maxBufferedBytes{0};
+
+  /* High-water mark of any single session's buffered bytes */
+  size_t maxSessionBufferedBytes{0};
+};
 
 struct AsyncMcServerWorkerOptions {
   /**
@@ -57,6 +85,22 @@ struct AsyncMcServerWorkerOptions {
    */
   size_t maxInFlight{0};
 
+  /**
+   * Source networks whose clients are classified as low-priority
+   * (batch) traffic at accept time; see lowPriorityMaxInFlight.
+   * Empty means all clients are treated equally.
+   */
+  std::vector<folly::CIDRNetwork> lowPriorityNetworks;
+
+  /**
+   * Outstanding request limit for low-priority clients, replacing
+   * maxInFlight for sessions matching lowPriorityNetworks.  A smaller
+   * value here makes batch traffic absorb the queueing while
+   * interactive clients keep the full maxInFlight budget.
+   * If 0, low-priority clients share maxInFlight with everyone else.
+   */
+  size_t lowPriorityMaxInFlight{0};
+
   /**
    * Max connections used at any moment.
    */
@@ -72,11 +116,36 @@ struct AsyncMcServerWorkerOptions {
    */
   size_t maxBufferSize{4096};
 
+  /**
+   * SO_BUSY_POLL value in microseconds, set on accepted client sockets
+   * if > 0 and supported by the OS: the kernel busy-polls the device
+   * queue for up to this long before sleeping in a blocking receive.
+   * 0 disables the option.
+   */
+  unsigned int busyPollUs{0};
+
+  /**
+   * If true, value-carrying read buffers are copied into dedicated
+   * jemalloc arenas marked MADV_DONTDUMP, keeping cached values out of
+   * core dumps. See JemallocNodumpAllocator.
+   */
+  bool useJemallocNodumpAllocator{false};
+
   /**
    * String that will be returned for 'VERSION' commands.
    */
   std::string versionString{"AsyncMcServer-1.0"};
 
+  /**
+   * Preformatted "VERSION <versionString>\r\n" wire reply shared by all
+   * sessions of a worker, so ascii version requests (health checkers
+   * send these at high rates) are answered without serializing a reply
+   * per request.  Set by AsyncMcServerWorker; sessions created without
+   * a worker (e.g. in tests) serialize version replies normally.
+   * Not a user-settable option.
+   */
+  std::shared_ptr<const std::string> packedAsciiVersionReply;
+
   /**
    * Path of the debug fifo.
    * If empty, debug fifo is disabled.
@@ -87,6 +156,70 @@ struct AsyncMcServerWorkerOptions {
    * The congestion controller at the server.
    */
   std::shared_ptr<CongestionController> cpuController;
+
+  /**
+   * If true, move record encryption of established SSL sessions into the
+   * kernel (kTLS) after the handshake, where the kernel, OpenSSL version
+   * and negotiated cipher allow it.  The session then writes replies with
+   * plain writev(), skipping userspace record encryption.
+   */
+  bool useKernelTls{false};
+
+  /**
+   * Bound on the number of free WriteBuffers pooled per protocol by
+   * each worker.  Sessions borrow buffers from the shared per-worker
+   * pool, so idle connections hold no write-path memory.
+   */
+  size_t maxPooledWriteBuffers{50};
+
+  /**
+   * Set by AsyncMcServerWorker; sessions draw their write buffers from
+   * here.  Sessions created without a worker (e.g. in tests) fall back
+   * to a per-thread pool.  Not a user-settable option.
+   */
+  WriteBufferPool* writeBufferPool{nullptr};
+
+  /**
+   * If nonzero, bound on reply bytes buffered for write across all
+   * sessions of a worker.  Each session gets an equal share of the bound
+   * (adapting as connections come and go, with a fixed floor) and stops
+   * reading further requests while its buffered replies exceed that
+   * share, resuming once the backlog drains below half of it.  Protects
+   * against a slow reader pinning the worker's memory with a multiget
+   * flood.  If 0, egress buffering is unbounded.
+   */
+  size_t maxEgressBytes{0};
+
+  /**
+   * Set by AsyncMcServerWorker when maxEgressBytes is nonzero; sessions
+   * account their buffered reply bytes here.  Not a user-settable option.
+   */
+  WorkerEgressAccount* egressAccount{nullptr};
+
+  /**
+   * If nonzero, reply batches whose total size is at least this many
+   * bytes are sent with sendmsg(MSG_ZEROCOPY) on plain (non-SSL) sockets,
+   * and reply buffers are only released after the kernel completion
+   * notification.  Silently ignored on kernels without SO_ZEROCOPY
+   * support.  Should be set well above a page size; zero copy adds
+   * overhead (page pinning, notifications) for small sends.
+   */
+  size_t zeroCopyThreshold{0};
+
+  /**
+   * If true, each worker batches its socket writes through an io_uring
+   * submission queue instead of issuing one writev() per session per loop.
+   * Silently ignored when mcrouter was built without liburing or the
+   * kernel has no io_uring support.
+   */
+  bool useIoUring{false};
+
+  /**
+   * Set by AsyncMcServerWorker when useIoUring is in effect; sessions
+   * with plain (non-SSL) transports submit their batched writes here.
+   * Not a user-settable option.
+   */
+  IoUringWriter* ioUringWriter{nullptr};
 };
 
 }}  // facebook::memcache
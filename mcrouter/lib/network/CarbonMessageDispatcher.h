@@ -16,6 +16,7 @@
 #include "mcrouter/lib/carbon/CarbonProtocolWriter.h"
 #include "mcrouter/lib/carbon/CarbonQueueAppender.h"
 #include "mcrouter/lib/carbon/RequestReplyUtil.h"
+#include "mcrouter/lib/carbon/Util.h"
 #include "mcrouter/lib/network/CaretHeader.h"
 #include "mcrouter/lib/network/TypedMsg.h"
 
@@ -32,6 +33,10 @@ template <class Message>
 void serializeCarbonStruct(
     const Message& msg,
     carbon::CarbonQueueAppenderStorage& storage) {
+  // Reserve scratch space for the whole message upfront, so serialization
+  // never has to jump to a new scratch region (and burn an iovec) halfway
+  // through the field data.
+  storage.reserve(carbon::util::estimateScratchSize(msg));
   carbon::CarbonProtocolWriter writer(storage);
   msg.serialize(writer);
 }
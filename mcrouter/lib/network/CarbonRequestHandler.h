@@ -36,6 +36,10 @@ class CarbonRequestHandler
         carbon::detail::CanHandleRequest::value<Request, OnRequest>());
   }
 
+  void parseBatchEnd() {
+    parseBatchEndImpl(carbon::detail::CanHandleBatchEnd::value<OnRequest>());
+  }
+
  private:
   OnRequest onRequest_;
 
@@ -55,6 +59,12 @@ class CarbonRequestHandler
     facebook::memcache::throwRuntime(
         "onRequest for {} not defined", typeid(Request).name());
   }
+
+  void parseBatchEndImpl(std::true_type) {
+    onRequest_.parseBatchEnd();
+  }
+
+  void parseBatchEndImpl(std::false_type) {}
 };
 
 } // carbon
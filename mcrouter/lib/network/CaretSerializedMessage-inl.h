@@ -18,6 +18,16 @@ bool CaretSerializedMessage::prepare(const Request& req,
                                      const CodecIdRange& supportedCodecs,
                                      const struct iovec*& iovOut,
                                      size_t& niovOut) noexcept {
+  if (req.isFanout()) {
+    return fillShared(
+        req,
+        reqId,
+        Request::typeId,
+        req.traceId(),
+        supportedCodecs,
+        iovOut,
+        niovOut);
+  }
   return fill(
       req,
       reqId,
@@ -72,6 +82,37 @@ bool CaretSerializedMessage::fill(const Message& message,
   return true;
 }
 
+template <class Message>
+bool CaretSerializedMessage::fillShared(const Message& message,
+                                        uint32_t reqId,
+                                        size_t typeId,
+                                        uint64_t traceId,
+                                        const CodecIdRange& supportedCodecs,
+                                        const struct iovec*& iovOut,
+                                        size_t& niovOut) {
+  // The first leg serializes the body into shared storage; the
+  // remaining legs find it cached on the request and just reference it.
+  sharedBody_ = message.serializedCaretBody();
+  if (!sharedBody_) {
+    auto body = std::make_shared<carbon::CarbonQueueAppenderStorage>();
+    try {
+      serializeCarbonStruct(message, *body);
+    } catch (const std::exception& e) {
+      LOG(ERROR) << "Failed to serialize: " << e.what();
+      return false;
+    }
+    message.cacheSerializedCaretBody(body);
+    sharedBody_ = std::move(body);
+  }
+  storage_.referenceBody(*sharedBody_);
+
+  UmbrellaMessageInfo info;
+  info.supportedCodecsFirstId = supportedCodecs.firstId;
+  info.supportedCodecsSize = supportedCodecs.size;
+  fillImpl(info, reqId, typeId, traceId, 0.0, iovOut, niovOut);
+  return true;
+}
+
 template <class Message>
 bool CaretSerializedMessage::fill(
     const Message& message,
@@ -100,7 +141,7 @@ bool CaretSerializedMessage::fill(
       : compressionCodecMap->getBest(
             supportedCodecs, uncompressedSize, typeId);
 
-  if (maybeCompress(codec, uncompressedSize)) {
+  if (maybeCompress(codec, uncompressedSize, typeId)) {
     info.usedCodecId = codec->id();
     info.uncompressedBodySize = uncompressedSize;
   }
@@ -110,7 +151,8 @@ bool CaretSerializedMessage::fill(
 }
 
 inline bool CaretSerializedMessage::maybeCompress(CompressionCodec* codec,
-                                                  size_t uncompressedSize) {
+                                                  size_t uncompressedSize,
+                                                  size_t typeId) {
   if (!codec) {
     return false;
   }
@@ -120,13 +162,29 @@ inline bool CaretSerializedMessage::maybeCompress(CompressionCodec* codec,
     return false;
   }
 
+  // Back off from message types whose values keep proving incompressible.
+  static thread_local CompressionOutcomeCache outcomeCache;
+  if (!outcomeCache.shouldCompress(typeId)) {
+    return false;
+  }
+
   static constexpr size_t kCompressionOverhead = 4;
   try {
     const auto iovs = storage_.getIovecs();
     // The first iovec is the header - we need to compress just the data.
+    // Already-compressed values (images, thumbnails, ...) would only
+    // waste CPU and grow slightly; a sampled entropy estimate weeds
+    // them out before the codec runs.
+    if (!isLikelyCompressible(iovs.first + 1, iovs.second - 1)) {
+      outcomeCache.recordOutcome(typeId, false);
+      return false;
+    }
     auto compressedBuf = codec->compress(iovs.first + 1, iovs.second - 1);
     auto compressedSize = compressedBuf->computeChainDataLength();
-    if ((compressedSize + kCompressionOverhead) < uncompressedSize) {
+    const bool saved = (compressedSize + kCompressionOverhead) <
+        uncompressedSize;
+    outcomeCache.recordOutcome(typeId, saved);
+    if (saved) {
       storage_.reset();
       storage_.append(*compressedBuf);
       return true;
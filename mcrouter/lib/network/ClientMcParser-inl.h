@@ -34,15 +34,17 @@ ClientMcParser<Callback>::ClientMcParser(
 
 template <class Callback>
 std::pair<void*, size_t> ClientMcParser<Callback>::getReadBuffer() {
+#ifndef MCROUTER_CARET_ONLY
   if (shouldReadToAsciiBuffer()) {
     return asciiParser_.getReadBuffer();
-  } else {
-    return parser_.getReadBuffer();
   }
+#endif
+  return parser_.getReadBuffer();
 }
 
 template <class Callback>
 bool ClientMcParser<Callback>::readDataAvailable(size_t len) {
+#ifndef MCROUTER_CARET_ONLY
   if (shouldReadToAsciiBuffer()) {
     if (UNLIKELY(debugFifo_ && debugFifo_->isConnected())) {
       auto buf = asciiParser_.getReadBuffer();
@@ -50,28 +52,23 @@ bool ClientMcParser<Callback>::readDataAvailable(size_t len) {
     }
     asciiParser_.readDataAvailable(len);
     return true;
-  } else {
-    return parser_.readDataAvailable(len);
   }
+#endif
+  return parser_.readDataAvailable(len);
 }
 
 template <class Callback>
 template <class Request>
 typename std::enable_if<ListContains<McRequestList, Request>::value>::type
 ClientMcParser<Callback>::expectNext() {
-  if (parser_.protocol() == mc_ascii_protocol) {
-    asciiParser_.initializeReplyParser<Request>();
-    replyForwarder_ = &ClientMcParser<Callback>::forwardAsciiReply<Request>;
-    if (UNLIKELY(debugFifo_ && debugFifo_->isConnected())) {
-      debugFifo_->startMessage(
-          MessageDirection::Received, ReplyT<Request>::typeId);
-    }
+  if (parser_.protocol() == mc_caret_protocol) {
+    expectNextCaret<Request>();
+#ifndef MCROUTER_CARET_ONLY
+  } else if (parser_.protocol() == mc_ascii_protocol) {
+    expectNextAscii<Request>();
   } else if (parser_.protocol() == mc_umbrella_protocol) {
-    umbrellaOrCaretForwarder_ =
-        &ClientMcParser<Callback>::forwardUmbrellaReply<Request>;
-  } else if (parser_.protocol() == mc_caret_protocol) {
-    umbrellaOrCaretForwarder_ =
-        &ClientMcParser<Callback>::forwardCaretReply<Request>;
+    expectNextUmbrella<Request>();
+#endif
   }
 }
 
@@ -80,10 +77,39 @@ template <class Request>
 typename std::enable_if<!ListContains<McRequestList, Request>::value>::type
 ClientMcParser<Callback>::expectNext() {
   assert(parser_.protocol() == mc_caret_protocol);
+  expectNextCaret<Request>();
+}
+
+#ifndef MCROUTER_CARET_ONLY
+template <class Callback>
+template <class Request>
+typename std::enable_if<ListContains<McRequestList, Request>::value>::type
+ClientMcParser<Callback>::expectNextAscii() {
+  asciiParser_.initializeReplyParser<Request>();
+  replyForwarder_ = &ClientMcParser<Callback>::forwardAsciiReply<Request>;
+  if (UNLIKELY(debugFifo_ && debugFifo_->isConnected())) {
+    debugFifo_->startMessage(
+        MessageDirection::Received, ReplyT<Request>::typeId);
+  }
+}
+
+template <class Callback>
+template <class Request>
+typename std::enable_if<ListContains<McRequestList, Request>::value>::type
+ClientMcParser<Callback>::expectNextUmbrella() {
+  umbrellaOrCaretForwarder_ =
+      &ClientMcParser<Callback>::forwardUmbrellaReply<Request>;
+}
+#endif
+
+template <class Callback>
+template <class Request>
+void ClientMcParser<Callback>::expectNextCaret() {
   umbrellaOrCaretForwarder_ =
       &ClientMcParser<Callback>::forwardCaretReply<Request>;
 }
 
+#ifndef MCROUTER_CARET_ONLY
 template <class Callback>
 template <class Request>
 void ClientMcParser<Callback>::forwardAsciiReply() {
@@ -117,6 +143,7 @@ void ClientMcParser<Callback>::forwardUmbrellaReply(
       reqId,
       ReplyStatsContext(0 /* usedCodecId */, info.bodySize, info.bodySize));
 }
+#endif
 
 template <class Callback>
 template <class Request>
@@ -165,6 +192,11 @@ std::unique_ptr<folly::IOBuf> ClientMcParser<Callback>::decompress(
 template <class Callback>
 bool ClientMcParser<Callback>::umMessageReady(const UmbrellaMessageInfo& info,
                                               const folly::IOBuf& buffer) {
+#ifdef MCROUTER_CARET_ONLY
+  callback_.parseError(
+      mc_res_local_error, "Umbrella protocol support is compiled out");
+  return false;
+#else
   if (UNLIKELY(parser_.protocol() != mc_umbrella_protocol)) {
     std::string reason =
         folly::sformat("Expected {} protocol, but received umbrella!",
@@ -187,6 +219,7 @@ bool ClientMcParser<Callback>::umMessageReady(const UmbrellaMessageInfo& info,
     callback_.parseError(mc_res_local_error, reason);
     return false;
   }
+#endif
 }
 
 template <class Callback>
@@ -217,6 +250,10 @@ bool ClientMcParser<Callback>::caretMessageReady(
 
 template <class Callback>
 void ClientMcParser<Callback>::handleAscii(folly::IOBuf& readBuffer) {
+#ifdef MCROUTER_CARET_ONLY
+  callback_.parseError(
+      mc_res_local_error, "Ascii protocol support is compiled out");
+#else
   if (UNLIKELY(parser_.protocol() != mc_ascii_protocol)) {
     std::string reason(
       folly::sformat("Expected {} protocol, but received ASCII!",
@@ -265,6 +302,7 @@ void ClientMcParser<Callback>::handleAscii(folly::IOBuf& readBuffer) {
         return;
     }
   }
+#endif
 }
 
 template <class Callback>
@@ -273,11 +311,13 @@ void ClientMcParser<Callback>::parseError(mc_res_t result,
   callback_.parseError(result, reason);
 }
 
+#ifndef MCROUTER_CARET_ONLY
 template <class Callback>
 bool ClientMcParser<Callback>::shouldReadToAsciiBuffer() const {
   return parser_.protocol() == mc_ascii_protocol &&
       asciiParser_.hasReadBuffer();
 }
+#endif
 
 template <class Callback>
 ReplyStatsContext ClientMcParser<Callback>::getCompressionStats(
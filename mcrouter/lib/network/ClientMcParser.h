@@ -18,7 +18,9 @@
 #include "mcrouter/lib/CompressionCodecManager.h"
 #include "mcrouter/lib/debug/ConnectionFifo.h"
 #include "mcrouter/lib/network/CarbonMessageTraits.h"
+#ifndef MCROUTER_CARET_ONLY
 #include "mcrouter/lib/network/McAsciiParser.h"
+#endif
 #include "mcrouter/lib/network/McParser.h"
 #include "mcrouter/lib/network/ReplyStatsContext.h"
 #include "mcrouter/lib/network/UmbrellaProtocol.h"
@@ -67,6 +69,24 @@ class ClientMcParser : private McParser::ParserCallback {
       !ListContains<McRequestList, Request>::value>::type
   expectNext();
 
+  /**
+   * Protocol-specialized variants of expectNext().  The connection's
+   * protocol is fixed, so the client selects one of these at
+   * request-creation time (see AsyncMcClientImpl::selectParserInitializer())
+   * and the per-reply initializer runs without re-branching on protocol
+   * on the receive path.
+   */
+#ifndef MCROUTER_CARET_ONLY
+  template <class Request>
+  typename std::enable_if<ListContains<McRequestList, Request>::value>::type
+  expectNextAscii();
+  template <class Request>
+  typename std::enable_if<ListContains<McRequestList, Request>::value>::type
+  expectNextUmbrella();
+#endif
+  template <class Request>
+  void expectNextCaret();
+
   void setProtocol(mc_protocol_t protocol) {
     parser_.setProtocol(protocol);
   }
@@ -75,8 +95,10 @@ class ClientMcParser : private McParser::ParserCallback {
 
  private:
   McParser parser_;
+#ifndef MCROUTER_CARET_ONLY
   McClientAsciiParser asciiParser_;
   void (ClientMcParser<Callback>::*replyForwarder_)(){nullptr};
+#endif
   void (ClientMcParser<Callback>::*umbrellaOrCaretForwarder_)(
       const UmbrellaMessageInfo&, const folly::IOBuf&, uint64_t){nullptr};
 
@@ -86,6 +108,7 @@ class ClientMcParser : private McParser::ParserCallback {
 
   const CompressionCodecMap* compressionCodecMap_{nullptr};
 
+#ifndef MCROUTER_CARET_ONLY
   template <class Request>
   void forwardAsciiReply();
 
@@ -93,12 +116,24 @@ class ClientMcParser : private McParser::ParserCallback {
   void forwardUmbrellaReply(const UmbrellaMessageInfo& info,
                             const folly::IOBuf& buffer,
                             uint64_t reqId);
+#endif
 
   template <class Request>
   void forwardCaretReply(const UmbrellaMessageInfo& headerInfo,
                          const folly::IOBuf& buffer,
                          uint64_t reqId);
 
+  /**
+   * Decompresses the body of a caret message.
+   *
+   * Note on memory traffic: the returned buffer is written exactly once
+   * (by the codec, sized to uncompressedBodySize up front) and then
+   * becomes the backing storage of the deserialized reply - value fields
+   * are slices of it (see CarbonProtocolReader::readRawInto) and the
+   * serializer appends those slices to the write path by reference. So a
+   * big decompressed value crosses memory once; don't be tempted to pool
+   * or recycle this buffer, its lifetime is owned by the reply.
+   */
   std::unique_ptr<folly::IOBuf> decompress(
       const UmbrellaMessageInfo& headerInfo,
       const folly::IOBuf& buffer);
@@ -111,7 +146,9 @@ class ClientMcParser : private McParser::ParserCallback {
   void handleAscii(folly::IOBuf& readBuffer) override final;
   void parseError(mc_res_t result, folly::StringPiece reason) override final;
 
+#ifndef MCROUTER_CARET_ONLY
   bool shouldReadToAsciiBuffer() const;
+#endif
 
   ReplyStatsContext getCompressionStats(
       const UmbrellaMessageInfo& headerInfo) const;
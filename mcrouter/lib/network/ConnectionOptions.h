@@ -77,6 +77,47 @@ struct ConnectionOptions {
    */
   std::chrono::milliseconds writeTimeout{0};
 
+  /**
+   * TCP_NOTSENT_LOWAT value in bytes. If > 0 (and supported by the OS),
+   * limits how much not-yet-sent data the kernel accepts into the socket
+   * buffer; further writes back up inside the transport, where
+   * isSaturated() can detect them. 0 disables the option.
+   */
+  uint32_t tcpNotsentLowat{0};
+
+  /**
+   * SO_BUSY_POLL value in microseconds. If > 0 (and supported by the
+   * OS), the kernel busy-polls the device queue for up to this long
+   * before sleeping in a blocking receive on the connection.
+   * 0 disables the option.
+   */
+  unsigned int busyPollUs{0};
+
+  /**
+   * If true (and supported by the OS), sets TCP_FASTOPEN_CONNECT on the
+   * socket, so that once the kernel holds a TCP Fast Open cookie for the
+   * destination, the first write after a reconnect is carried in the SYN
+   * instead of waiting out the handshake round trip.
+   */
+  bool enableTfo{false};
+
+  /**
+   * If true, keep one warm standby socket connected to the destination
+   * while the main connection is up, and adopt it instantly when the main
+   * connection drops, so reconnects skip the connect round trip entirely.
+   * Only applies to plain (non-SSL) connections.
+   */
+  bool keepStandbyConnection{false};
+
+  /**
+   * If true, talk to the destination over UDP (memcached UDP frame)
+   * instead of TCP. Each request goes out as a single datagram and
+   * replies are matched back by the frame's request id, so loss simply
+   * surfaces as a request timeout. Only supported for the ascii
+   * protocol without SSL.
+   */
+  bool useUdp{false};
+
   /**
    * Informs whether QoS is enabled.
    */
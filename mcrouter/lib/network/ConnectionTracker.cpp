@@ -57,15 +57,35 @@ bool ConnectionTracker::writesPending() const {
   return false;
 }
 
+uint64_t ConnectionTracker::collectRequestCount() {
+  uint64_t total = 0;
+  for (auto& session : sessions_) {
+    total += session.decayRecentRequests();
+  }
+  return total;
+}
+
+int ConnectionTracker::detachBusiestConnectionFd() {
+  McServerSession* busiest = nullptr;
+  for (auto& session : sessions_) {
+    if (session.isDetachable() &&
+        (busiest == nullptr ||
+         session.recentRequests() > busiest->recentRequests())) {
+      busiest = &session;
+    }
+  }
+  return busiest != nullptr ? busiest->detachFd() : -1;
+}
+
 void ConnectionTracker::touch(McServerSession& session) {
-  static uint64_t numCalls = 0;
-  // Find the connection and bring it to the front of the LRU.
-  // Do it only once in 16 requests because it's still expensive.
-  if (((numCalls++) & 15) || !session.isLinked()) {
+  if (!session.isLinked()) {
     return;
   }
-  sessions_.erase(sessions_.iterator_to(session));
-  sessions_.push_front(session);
+  // Bring the connection to the front of the LRU.  A splice within the
+  // intrusive list is a handful of pointer stores, so we can afford to
+  // do it on every call rather than sampling.
+  sessions_.splice(
+      sessions_.begin(), sessions_, sessions_.iterator_to(session));
 }
 
 void ConnectionTracker::evict() {
@@ -76,6 +96,10 @@ void ConnectionTracker::evict() {
   session.close();
 }
 
+bool ConnectionTracker::onWriteScheduled(McServerSession& session) {
+  return onWriteScheduled_ ? onWriteScheduled_(session) : false;
+}
+
 void ConnectionTracker::onWriteQuiescence(McServerSession& session) {
   touch(session);
   if (onWriteQuiescence_) {
@@ -45,6 +45,10 @@ class ConnectionTracker : public McServerSession::StateCallback {
     onShutdown_ = std::move(cb);
   }
 
+  void setOnWriteScheduled(std::function<bool(McServerSession&)> cb) {
+    onWriteScheduled_ = std::move(cb);
+  }
+
   /**
    * Creates a new entry in the LRU and places the connection at the front.
    *
@@ -61,12 +65,37 @@ class ConnectionTracker : public McServerSession::StateCallback {
    */
   void closeAll();
 
+  /**
+   * Sum the decayed per-session request counters, halving each.
+   * Called periodically by the server's connection rebalancer, so the
+   * result behaves like an exponentially decayed request rate.
+   */
+  uint64_t collectRequestCount();
+
+  /**
+   * Detach the fd of the busiest session that is currently at a message
+   * boundary (see McServerSession::isDetachable()); the session is torn
+   * down and the caller owns the fd.
+   *
+   * @return  the fd, or -1 if no session can be moved right now.
+   */
+  int detachBusiestConnectionFd();
+
   /**
    * Check if we have pending writes on any connection (session)
    */
   bool writesPending() const;
+
+  /**
+   * Number of connections (sessions) currently tracked, including
+   * closing sessions that still have pending writes.
+   */
+  size_t numConnections() const {
+    return sessions_.size();
+  }
  private:
   McServerSession::Queue sessions_;
+  std::function<bool(McServerSession&)> onWriteScheduled_;
   std::function<void(McServerSession&)> onWriteQuiescence_;
   std::function<void(McServerSession&)> onCloseStart_;
   std::function<void(McServerSession&)> onCloseFinish_;
@@ -78,6 +107,7 @@ class ConnectionTracker : public McServerSession::StateCallback {
   void evict();
 
   // McServerSession::StateCallback API
+  bool onWriteScheduled(McServerSession& session) override final;
   void onWriteQuiescence(McServerSession& session) override final;
   void onCloseStart(McServerSession& session) override final;
   void onCloseFinish(McServerSession& session) override final;
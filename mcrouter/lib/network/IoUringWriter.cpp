@@ -0,0 +1,303 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "IoUringWriter.h"
+
+#include <errno.h>
+#include <poll.h>
+
+#ifdef MCROUTER_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include <glog/logging.h>
+
+namespace facebook { namespace memcache {
+
+#ifdef MCROUTER_HAVE_LIBURING
+
+struct IoUringWriter::Ring {
+  struct io_uring ring;
+  bool valid{false};
+
+  explicit Ring(size_t depth) {
+    auto ret = io_uring_queue_init(depth, &ring, 0);
+    if (ret < 0) {
+      LOG(WARNING) << "io_uring_queue_init failed: " << -ret;
+      return;
+    }
+    valid = true;
+  }
+
+  ~Ring() {
+    if (valid) {
+      io_uring_queue_exit(&ring);
+    }
+  }
+};
+
+bool IoUringWriter::isAvailable() noexcept {
+  static const bool available = [] {
+    struct io_uring probeRing;
+    auto ret = io_uring_queue_init(4, &probeRing, 0);
+    if (ret < 0) {
+      return false;
+    }
+    io_uring_queue_exit(&probeRing);
+    return true;
+  }();
+  return available;
+}
+
+IoUringWriter::IoUringWriter(folly::EventBase& evb, size_t ringDepth)
+    : folly::EventHandler(&evb),
+      eventBase_(evb),
+      ring_(new Ring(ringDepth)),
+      submitCallback_(*this) {
+  if (ring_->valid) {
+    changeHandlerFD(ring_->ring.ring_fd);
+    registerHandler(EV_READ | EV_PERSIST);
+  }
+}
+
+IoUringWriter::~IoUringWriter() {
+  unregisterHandler();
+  /* Fail any writes that never completed; buffers are owned by sessions
+     which outlive the worker's writer */
+  for (auto& kv : pendingWrites_) {
+    for (auto& pw : kv.second) {
+      if (pw.callback) {
+        pw.callback(-ECANCELED);
+      }
+    }
+  }
+}
+
+bool IoUringWriter::writev(
+    int fd,
+    const struct iovec* iovs,
+    size_t count,
+    WriteCallback cb) {
+  if (!ring_->valid || count == 0) {
+    return false;
+  }
+
+  auto& queue = pendingWrites_[fd];
+  queue.emplace_back();
+  auto& pw = queue.back();
+  pw.fd = fd;
+  pw.iovs.assign(iovs, iovs + count);
+  pw.callback = std::move(cb);
+
+  if (queue.size() > 1) {
+    /* An earlier write on this fd is still in flight; this one gets its
+       SQE once that completes, so per-socket bytes stay in order */
+    return true;
+  }
+
+  if (!enqueueSqe(pw)) {
+    queue.pop_back();
+    pendingWrites_.erase(fd);
+    return false;
+  }
+  return true;
+}
+
+bool IoUringWriter::enqueueSqe(PendingWrite& pw) {
+  auto sqe = io_uring_get_sqe(&ring_->ring);
+  if (sqe == nullptr) {
+    /* SQ ring full: flush what we have and retry once */
+    submitPending();
+    sqe = io_uring_get_sqe(&ring_->ring);
+    if (sqe == nullptr) {
+      return false;
+    }
+  }
+
+  io_uring_prep_writev(
+      sqe,
+      pw.fd,
+      pw.iovs.data() + pw.iovIndex,
+      pw.iovs.size() - pw.iovIndex,
+      0);
+  io_uring_sqe_set_data(sqe, &pw);
+  ++sqesQueued_;
+  scheduleSubmit();
+  return true;
+}
+
+bool IoUringWriter::enqueuePollout(PendingWrite& pw) {
+  auto sqe = io_uring_get_sqe(&ring_->ring);
+  if (sqe == nullptr) {
+    /* SQ ring full: flush what we have and retry once */
+    submitPending();
+    sqe = io_uring_get_sqe(&ring_->ring);
+    if (sqe == nullptr) {
+      return false;
+    }
+  }
+
+  io_uring_prep_poll_add(sqe, pw.fd, POLLOUT);
+  io_uring_sqe_set_data(sqe, &pw);
+  pw.waitingPollout = true;
+  ++sqesQueued_;
+  scheduleSubmit();
+  return true;
+}
+
+void IoUringWriter::scheduleSubmit() {
+  if (!submitScheduled_) {
+    eventBase_.runInLoop(&submitCallback_, /* thisIteration= */ true);
+    submitScheduled_ = true;
+  }
+}
+
+void IoUringWriter::submitPending() {
+  submitScheduled_ = false;
+  if (sqesQueued_ == 0) {
+    return;
+  }
+  auto ret = io_uring_submit(&ring_->ring);
+  if (ret < 0) {
+    LOG_EVERY_N(ERROR, 1000) << "io_uring_submit failed: " << -ret;
+    return;
+  }
+  sqesQueued_ = 0;
+}
+
+void IoUringWriter::finishWrite(PendingWrite& pw, ssize_t result) {
+  const auto fd = pw.fd;
+  auto cb = std::move(pw.callback);
+  auto& queue = pendingWrites_[fd];
+  DCHECK(&queue.front() == &pw);
+  queue.pop_front();
+  /* The finished write was the fd's only in-flight SQE; start the next
+     queued write on this socket, if any */
+  while (!queue.empty() && !enqueueSqe(queue.front())) {
+    /* Ring wedged; surface as an error so the session tears down */
+    auto failedCb = std::move(queue.front().callback);
+    queue.pop_front();
+    failedCb(-EIO);
+  }
+  if (queue.empty()) {
+    pendingWrites_.erase(fd);
+  }
+  cb(result);
+}
+
+void IoUringWriter::drainCompletions() {
+  struct io_uring_cqe* cqe;
+  while (io_uring_peek_cqe(&ring_->ring, &cqe) == 0) {
+    auto pw = reinterpret_cast<PendingWrite*>(io_uring_cqe_get_data(cqe));
+    auto res = cqe->res;
+    io_uring_cqe_seen(&ring_->ring, cqe);
+    if (pw == nullptr) {
+      continue;
+    }
+
+    if (pw->waitingPollout) {
+      /* The POLLOUT wait fired (or failed); retry the writev */
+      pw->waitingPollout = false;
+      if (res < 0 || !enqueueSqe(*pw)) {
+        finishWrite(*pw, res < 0 ? res : -EIO);
+      }
+      continue;
+    }
+
+    if (res < 0) {
+      if (res == -EINTR) {
+        /* Interrupted; try the same range again */
+        if (enqueueSqe(*pw)) {
+          continue;
+        }
+      } else if (res == -EAGAIN) {
+        /* The socket buffer is full; wait until it drains instead of
+           spinning on immediate resubmits that keep failing */
+        if (enqueuePollout(*pw)) {
+          continue;
+        }
+      }
+      finishWrite(*pw, res);
+      continue;
+    }
+
+    /* Advance past fully written iovecs; resubmit any remainder.  The
+       write keeps its spot at the front of the fd's queue, so the tail
+       goes out before any batch queued behind it */
+    size_t written = res;
+    pw->totalWritten += written;
+    while (pw->iovIndex < pw->iovs.size() &&
+           written >= pw->iovs[pw->iovIndex].iov_len) {
+      written -= pw->iovs[pw->iovIndex].iov_len;
+      ++pw->iovIndex;
+    }
+    if (pw->iovIndex < pw->iovs.size()) {
+      if (written > 0) {
+        auto& iov = pw->iovs[pw->iovIndex];
+        iov.iov_base = static_cast<char*>(iov.iov_base) + written;
+        iov.iov_len -= written;
+      }
+      if (enqueueSqe(*pw)) {
+        continue;
+      }
+      /* Ring wedged; surface as an error so the session tears down */
+      finishWrite(*pw, -EIO);
+      continue;
+    }
+
+    finishWrite(*pw, pw->totalWritten);
+  }
+}
+
+void IoUringWriter::handlerReady(uint16_t) noexcept {
+  drainCompletions();
+}
+
+#else  /* !MCROUTER_HAVE_LIBURING */
+
+struct IoUringWriter::Ring {};
+
+bool IoUringWriter::isAvailable() noexcept {
+  return false;
+}
+
+IoUringWriter::IoUringWriter(folly::EventBase& evb, size_t /* ringDepth */)
+    : folly::EventHandler(&evb),
+      eventBase_(evb),
+      submitCallback_(*this) {
+}
+
+IoUringWriter::~IoUringWriter() {
+}
+
+bool IoUringWriter::writev(
+    int /* fd */,
+    const struct iovec* /* iovs */,
+    size_t /* count */,
+    WriteCallback /* cb */) {
+  return false;
+}
+
+bool IoUringWriter::enqueueSqe(PendingWrite&) {
+  return false;
+}
+
+bool IoUringWriter::enqueuePollout(PendingWrite&) {
+  return false;
+}
+
+void IoUringWriter::finishWrite(PendingWrite&, ssize_t) {}
+void IoUringWriter::scheduleSubmit() {}
+void IoUringWriter::submitPending() {}
+void IoUringWriter::drainCompletions() {}
+void IoUringWriter::handlerReady(uint16_t) noexcept {}
+
+#endif  /* MCROUTER_HAVE_LIBURING */
+
+}}  // facebook::memcache
@@ -9,6 +9,11 @@
  */
 #include "McAsciiParser.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <folly/Bits.h>
 #include <folly/String.h>
 
 #include "mcrouter/lib/fbi/cpp/LogFailure.h"
@@ -17,6 +22,31 @@ namespace facebook { namespace memcache {
 
 constexpr size_t kProtocolTailContextLength = 128;
 
+namespace {
+
+inline bool isDigit(char c) {
+  return static_cast<uint8_t>(c - '0') <= 9;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+/**
+ * SWAR conversion of 8 ASCII digits at once: subtract '0' from every
+ * byte, then combine adjacent digits into pairs, pairs into quads and
+ * quads into the full value with three multiply-add steps.
+ */
+inline uint64_t parseEightDigits(const char* p) {
+  constexpr uint64_t kMask = 0x000000FF000000FFULL;
+  constexpr uint64_t kMul1 = 100 + (1000000ULL << 32);
+  constexpr uint64_t kMul2 = 1 + (10000ULL << 32);
+  auto x = folly::loadUnaligned<uint64_t>(p);
+  x -= 0x3030303030303030ULL;
+  x = x * 10 + (x >> 8);
+  return (((x & kMask) * kMul1) + (((x >> 16) & kMask) * kMul2)) >> 32;
+}
+#endif
+
+} // anonymous namespace
+
 McAsciiParserBase::State McClientAsciiParser::consume(folly::IOBuf& buffer) {
   assert(state_ == State::PARTIAL);
   assert(!hasReadBuffer());
@@ -56,6 +86,60 @@ void McAsciiParserBase::readDataAvailable(size_t length) {
   }
 }
 
+const char* McAsciiParserBase::findKeyBoundary(const char* begin,
+                                               const char* end) {
+#if defined(__SSE2__)
+  const auto kSpace = _mm_set1_epi8(0x20);
+  const auto kDel = _mm_set1_epi8(0x7f);
+  while (begin + 16 <= end) {
+    auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    // Unsigned chunk[i] <= 0x20 covers all space and control characters
+    // except DEL, which is matched separately.
+    auto boundary = _mm_cmpeq_epi8(_mm_min_epu8(chunk, kSpace), chunk);
+    boundary = _mm_or_si128(boundary, _mm_cmpeq_epi8(chunk, kDel));
+    auto mask = _mm_movemask_epi8(boundary);
+    if (mask != 0) {
+      return begin + __builtin_ctz(mask);
+    }
+    begin += 16;
+  }
+#endif
+  while (begin != end) {
+    auto c = static_cast<uint8_t>(*begin);
+    if (c <= 0x20 || c == 0x7f) {
+      break;
+    }
+    ++begin;
+  }
+  return begin;
+}
+
+const char* McAsciiParserBase::parseUIntPrefix(const char* begin,
+                                               const char* end,
+                                               uint64_t& value) {
+  assert(begin != end && isDigit(*begin));
+  auto digitEnd = begin + 1;
+  while (digitEnd != end && isDigit(*digitEnd)) {
+    ++digitEnd;
+  }
+  // The last digit is left to the caller; if digitEnd == end the run may
+  // continue in the next buffer and the caller keeps accumulating there.
+  auto last = digitEnd - 1;
+  uint64_t v = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  while (last - begin >= 8) {
+    v = v * 100000000 + parseEightDigits(begin);
+    begin += 8;
+  }
+#endif
+  while (begin != last) {
+    v = v * 10 + (*begin - '0');
+    ++begin;
+  }
+  value = v;
+  return last;
+}
+
 void McAsciiParserBase::handleError(folly::IOBuf& buffer) {
   state_ = State::ERROR;
   // We've encoutered error we need to do proper logging.
@@ -77,6 +77,24 @@ class McAsciiParserBase {
   static void trimIOBufToRange(folly::IOBuf& buffer, const char* posStart,
                                const char* posEnd);
 
+  /**
+   * Returns a pointer to the first space or control character in
+   * [begin, end), or end if there is none. Scans 16 bytes at a time
+   * when SSE2 is available. Used to move over key bytes in one pass
+   * instead of one state machine transition per byte.
+   */
+  static const char* findKeyBoundary(const char* begin, const char* end);
+
+  /**
+   * Converts the run of digits starting at begin (which must point at a
+   * digit) into value, stopping before the last digit of the run.
+   * Returns a pointer to that last digit, so that a per-digit parser
+   * action can fold it in and keep accumulating if the run is cut short
+   * by end (i.e. continues in the next buffer).
+   */
+  static const char* parseUIntPrefix(const char* begin, const char* end,
+                                     uint64_t& value);
+
   std::string currentErrorDescription_;
 
   uint64_t currentUInt_{0};
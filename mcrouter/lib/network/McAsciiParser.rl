@@ -80,13 +80,24 @@ msg_end = new_line @{
 };
 
 # Key that we do not want to store.
-skip_key = (any+ -- (cntrl | space));
+skip_key = (any+ -- (cntrl | space)) >{
+  p_ = findKeyBoundary(p_, pe_) - 1;
+};
 
 action key_start {
   currentKey_.clear();
   keyPieceStart_ = p_;
 }
 
+# Skip over key bytes in one vectorized scan instead of one state machine
+# transition per byte.  Everything up to the next space/control character
+# is guaranteed to stay in the key state, so the machine doesn't need to
+# look at the bytes in between; if the boundary is in a later buffer, p_
+# stops at the last byte and the regular partial-key handling takes over.
+action key_skip {
+  p_ = findKeyBoundary(p_, pe_) - 1;
+}
+
 action key_end {
   appendKeyPiece(buffer, currentKey_, keyPieceStart_, p_);
   keyPieceStart_ = nullptr;
@@ -94,7 +105,7 @@ action key_end {
 }
 
 # Key that we want to store.
-key = (any+ -- (cntrl | space)) >key_start %key_end %{
+key = (any+ -- (cntrl | space)) >key_start >key_skip %key_end %{
   message.key() = std::move(currentKey_);
 };
 
@@ -109,8 +120,13 @@ multi_token = (print+ -- ( '\r' | '\n' )) >key_start %key_end %{
   message.key() = std::move(currentKey_);
 };
 
-# Unsigned integer value.
-uint = digit+ > { currentUInt_ = 0; } ${
+# Unsigned integer value.  The entering action converts the whole digit
+# run except its last digit in one multi-digit (SWAR) pass and skips p_
+# over it; the per-digit action folds in the last digit, and keeps
+# accumulating byte-wise when the run spans a buffer seam.
+uint = digit+ > {
+  p_ = parseUIntPrefix(p_, pe_, currentUInt_);
+} ${
   currentUInt_ = currentUInt_ * 10 + (fc - '0');
 };
 
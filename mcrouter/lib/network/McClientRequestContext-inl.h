@@ -93,7 +93,9 @@ McClientRequestContext<Request>::waitForReply(
     std::chrono::milliseconds timeout) {
 
   batonWaitTimeout_ = timeout;
-  baton_.wait(batonTimeoutHandler_);
+  // The timeout itself is armed once the request is fully written, via
+  // the client's RequestTimeoutWheel; it wakes this baton when it fires.
+  baton_.wait();
 
   switch (state()) {
     case ReqState::REPLIED_QUEUE:
@@ -66,8 +66,9 @@ void McClientRequestContextBase::fireStateChangeCallbacks(
   }
 }
 
-void McClientRequestContextBase::scheduleTimeout() {
-  batonTimeoutHandler_.scheduleTimeout(batonWaitTimeout_);
+void McClientRequestContextBase::timedOut() {
+  assert(state() == ReqState::PENDING_REPLY_QUEUE);
+  baton_.post();
 }
 
 McClientRequestContextBase::~McClientRequestContextBase() {
@@ -138,6 +139,11 @@ void McClientRequestContextQueue::markAsPending(
   }
 }
 
+const McClientRequestContextBase&
+McClientRequestContextQueue::peekNextPending() const {
+  return pendingQueue_.front();
+}
+
 McClientRequestContextBase& McClientRequestContextQueue::markNextAsSending() {
   auto& req = pendingQueue_.front();
   pendingQueue_.pop_front();
@@ -28,10 +28,20 @@ namespace facebook { namespace memcache {
 class AsyncMcClientImpl;
 struct CodecIdRange;
 class McClientRequestContextQueue;
+class RequestTimeoutWheel;
 
 /**
  * Class for storing per request data that is required for proper requests
  * processing inside of AsyncMcClient.
+ *
+ * Note on allocation: contexts are never heap-allocated. Each one lives
+ * on the stack of the fiber running sendSync() (fiber stacks are pooled
+ * by the fiber manager, so this memory is recycled across requests) and
+ * is linked into the queues below intrusively. Serialized request data
+ * is likewise stored inline in reqContext, whose per-protocol
+ * serializers keep fixed-size buffers and spill through a per-thread
+ * block pool. Keep it this way: a heap allocation here would be on the
+ * per-request fast path of every client connection.
  */
 class McClientRequestContextBase
   : public boost::intrusive::unordered_set_base_hook<> {
@@ -68,12 +78,6 @@ class McClientRequestContextBase
    */
   void replyError(mc_res_t result);
 
-  /**
-   * Schedule a timeout so that the request does not wait
-   * indefinitely for a reply.
-   */
-  void scheduleTimeout();
-
   void setReplyStatsContext(ReplyStatsContext value) {
     replyStatsContext_ = value;
   }
@@ -118,21 +122,30 @@ class McClientRequestContextBase
 
   void setState(ReqState newState) {
     fireStateChangeCallbacks(state_, newState);
+    if (state_ == ReqState::PENDING_REPLY_QUEUE &&
+        timeoutWheelHook_.is_linked()) {
+      // Leaving the pending reply state cancels the wheel timeout.
+      timeoutWheelHook_.unlink();
+    }
     state_ = newState;
   }
 
   folly::fibers::Baton baton_;
   McClientRequestContextQueue& queue_;
 
-  folly::fibers::Baton::TimeoutHandler batonTimeoutHandler_;
   std::chrono::milliseconds batonWaitTimeout_{0};
 
  private:
   friend class McClientRequestContextQueue;
+  friend class RequestTimeoutWheel;
 
   std::shared_ptr<AsyncMcClientImpl> client_;
   std::type_index replyType_;
   folly::SafeIntrusiveListHook hook_;
+  // Wheel slot for the wait timeout; the auto-unlink hook makes
+  // cancellation an O(1) splice with no back-reference to the wheel.
+  folly::IntrusiveListHook timeoutWheelHook_;
+  uint64_t timeoutWheelTick_{0};
   void* replyStorage_;
   InitializerFuncPtr initializer_;
 
@@ -152,6 +165,12 @@ class McClientRequestContextBase
    */
   void canceled();
 
+  /**
+   * Notify context that its wait timeout fired; wakes up waitForReply(),
+   * which inspects the request state and replies with mc_res_timeout.
+   */
+  void timedOut();
+
   /**
    * Entry point for propagating reply to the user.
    *
@@ -178,6 +197,9 @@ class McClientRequestContextBase
 
   using Queue = folly::CountedIntrusiveList<McClientRequestContextBase,
                                             &McClientRequestContextBase::hook_>;
+  using TimeoutWheelList =
+    folly::IntrusiveList<McClientRequestContextBase,
+                         &McClientRequestContextBase::timeoutWheelHook_>;
   using UnorderedSet =
     boost::intrusive::unordered_set<McClientRequestContextBase,
                                     boost::intrusive::equal<Equal>,
@@ -254,6 +276,14 @@ class McClientRequestContextQueue {
    */
   void markAsPending(McClientRequestContextBase& req);
 
+  /**
+   * Peek the request that the next markNextAsSending() call would return.
+   *
+   * Note: it's the caller responsibility to ensure that there's at least one
+   *       pending request.
+   */
+  const McClientRequestContextBase& peekNextPending() const;
+
   /**
    * Moves the first request from pending queue into sending queue.
    *
@@ -10,6 +10,8 @@
 #include "McParser.h"
 
 #include <algorithm>
+#include <cstring>
+#include <vector>
 
 #include <folly/Bits.h>
 #include <folly/Format.h>
@@ -27,6 +29,58 @@ namespace {
 // Adjust buffer size after this many CPU cycles (~2 billion)
 constexpr uint64_t kAdjustBufferSizeCpuCycles = 1UL << 31;
 
+/**
+ * Per-thread pool of read buffers, bucketed in power of two size classes.
+ * All parsers of a worker thread draw from the same pool, so in steady
+ * state reads recycle a handful of buffers instead of hitting malloc on
+ * every resize.  Buffers still referenced by parsed-out requests are
+ * simply dropped rather than pooled.
+ */
+class ReadBufferPool {
+ public:
+  folly::IOBuf get(size_t minCapacity) {
+    auto capacity = folly::nextPowTwo(std::max(minCapacity, kMinBufferSize));
+    auto cls = sizeClass(capacity);
+    if (cls < kNumClasses && !free_[cls].empty()) {
+      auto buf = std::move(free_[cls].back());
+      free_[cls].pop_back();
+      return buf;
+    }
+    return folly::IOBuf(folly::IOBuf::CREATE, capacity);
+  }
+
+  void release(folly::IOBuf&& buf) {
+    if (buf.isChained() || buf.isSharedOne() ||
+        buf.capacity() < kMinBufferSize) {
+      return;
+    }
+    /* Classify by the largest power of two the buffer covers, so the
+       allocator rounding IOBuf applies on top of requested capacities
+       doesn't matter */
+    auto cls = sizeClass(buf.capacity());
+    if (cls >= kNumClasses || free_[cls].size() >= kMaxFreePerClass) {
+      return;
+    }
+    buf.clear();
+    free_[cls].push_back(std::move(buf));
+  }
+
+ private:
+  constexpr static size_t kMinBufferSize = 256;
+  /* Pool buffers of 256 bytes up to 1 MiB; anything larger goes back
+     to the allocator */
+  constexpr static size_t kNumClasses = 13;
+  constexpr static size_t kMaxFreePerClass = 8;
+
+  std::vector<folly::IOBuf> free_[kNumClasses];
+
+  static size_t sizeClass(size_t capacity) {
+    return folly::findLastSet(capacity / kMinBufferSize) - 1;
+  }
+};
+
+folly::ThreadLocal<ReadBufferPool> readBufferPool;
+
 size_t mcOpToRequestTypeId(mc_op_t mc_op) {
   switch(mc_op) {
 #define THRIFT_OP(MC_OPERATION)                                           \
@@ -78,16 +132,21 @@ McParser::McParser(ParserCallback& callback,
                    const bool useJemallocNodumpAllocator,
                    ConnectionFifo* debugFifo)
     : callback_(callback),
+      minBufferSize_(minBufferSize),
       bufferSize_(minBufferSize),
       maxBufferSize_(maxBufferSize),
       debugFifo_(debugFifo),
-      readBuffer_(folly::IOBuf::CREATE, bufferSize_),
+      readBuffer_(readBufferPool->get(bufferSize_)),
       useJemallocNodumpAllocator_(useJemallocNodumpAllocator) {
 #ifndef CAN_USE_JEMALLOC_NODUMP_ALLOCATOR
   useJemallocNodumpAllocator_ = false;
 #endif
 }
 
+McParser::~McParser() {
+  readBufferPool->release(std::move(readBuffer_));
+}
+
 void McParser::reset() {
   readBuffer_.clear();
 }
@@ -109,11 +168,12 @@ std::pair<void*, size_t> McParser::getReadBuffer() {
   return std::make_pair(readBuffer_.writableTail(), readBuffer_.tailroom());
 }
 
-bool McParser::readUmbrellaOrCaretData() {
+template <mc_protocol_t Protocol>
+bool McParser::consumeUmbrellaOrCaretData() {
   while (readBuffer_.length() > 0) {
     // Parse header
     UmbrellaParseStatus parseStatus;
-    if (protocol_ == mc_umbrella_protocol) {
+    if (Protocol == mc_umbrella_protocol) {
       parseStatus = umbrellaParseHeader(
           readBuffer_.data(), readBuffer_.length(), umMsgInfo_);
     } else {
@@ -134,12 +194,14 @@ bool McParser::readUmbrellaOrCaretData() {
     }
 
     const auto messageSize = umMsgInfo_.headerSize + umMsgInfo_.bodySize;
+    largestRecentMsgSize_ = std::max<size_t>(largestRecentMsgSize_,
+                                             messageSize);
 
     // Parse message body
     // Case 1: Entire message (and possibly part of next) is in the buffer
     if (readBuffer_.length() >= messageSize) {
       if (UNLIKELY(debugFifo_ && debugFifo_->isConnected())) {
-        if (protocol_ == mc_umbrella_protocol) {
+        if (Protocol == mc_umbrella_protocol) {
           const auto mc_op = umbrellaDetermineOperation(
               readBuffer_.data(), umMsgInfo_.headerSize);
           umMsgInfo_.typeId = mcOpToRequestTypeId(mc_op);
@@ -155,7 +217,7 @@ bool McParser::readUmbrellaOrCaretData() {
       }
 
       bool cbStatus;
-      if (protocol_ == mc_umbrella_protocol) {
+      if (Protocol == mc_umbrella_protocol) {
         cbStatus = callback_.umMessageReady(umMsgInfo_, readBuffer_);
       } else {
         cbStatus = callback_.caretMessageReady(umMsgInfo_, readBuffer_);
@@ -181,55 +243,94 @@ bool McParser::readUmbrellaOrCaretData() {
       assert(!readBuffer_.isChained());
       readBuffer_.unshareOne();
       bufferSize_ = std::max<size_t>(bufferSize_, messageSize);
-      readBuffer_.reserve(
-          0 /* minHeadroom */,
-          bufferSize_ - readBuffer_.length() /* minTailroom */);
+      auto newBuffer = readBufferPool->get(bufferSize_);
+      memcpy(newBuffer.writableTail(), readBuffer_.data(),
+             readBuffer_.length());
+      newBuffer.append(readBuffer_.length());
+      readBufferPool->release(std::move(readBuffer_));
+      readBuffer_ = std::move(newBuffer);
     }
 #ifdef CAN_USE_JEMALLOC_NODUMP_ALLOCATOR
     if (useJemallocNodumpAllocator_) {
-      readBuffer_ = copyToNodumpBuffer(umMsgInfo_, readBuffer_);
+      auto nodumpBuffer = copyToNodumpBuffer(umMsgInfo_, readBuffer_);
+      readBufferPool->release(std::move(readBuffer_));
+      readBuffer_ = std::move(nodumpBuffer);
     }
 #endif
     return true;
   }
 
   // We parsed everything, read buffer is empty.
-  // Try to shrink it to reduce memory footprint
-  if (bufferSize_ > maxBufferSize_) {
-    auto curCycles = cycles::getCpuCycles();
-    if (curCycles > lastShrinkCycles_ + kAdjustBufferSizeCpuCycles) {
-      lastShrinkCycles_ = curCycles;
-      bufferSize_ = maxBufferSize_;
-      readBuffer_ = folly::IOBuf(folly::IOBuf::CREATE, bufferSize_);
+  // Periodically adapt the buffer size to the session's message size
+  // distribution: shrink buffers inflated by an occasional huge message,
+  // and size sessions that only see small messages near the minimum.
+  auto curCycles = cycles::getCpuCycles();
+  if (curCycles > lastShrinkCycles_ + kAdjustBufferSizeCpuCycles) {
+    lastShrinkCycles_ = curCycles;
+    auto targetSize = std::min(
+        std::max(folly::nextPowTwo(largestRecentMsgSize_), minBufferSize_),
+        maxBufferSize_);
+    largestRecentMsgSize_ = 0;
+    if (bufferSize_ != targetSize) {
+      bufferSize_ = targetSize;
+      readBufferPool->release(std::move(readBuffer_));
+      readBuffer_ = readBufferPool->get(bufferSize_);
     }
   }
   return true;
 }
 
-bool McParser::readDataAvailable(size_t len) {
-  // Caller is responsible for ensuring the read buffer has enough tailroom
-  readBuffer_.append(len);
-  if (UNLIKELY(readBuffer_.length() == 0)) {
-    return true;
-  }
+#ifndef MCROUTER_CARET_ONLY
+bool McParser::consumeAsciiData() {
+  callback_.handleAscii(readBuffer_);
+  return true;
+}
+#endif
 
-  if (UNLIKELY(!seenFirstByte_)) {
-    seenFirstByte_ = true;
-    protocol_ = determineProtocol(*readBuffer_.data());
-    if (protocol_ == mc_ascii_protocol) {
+bool McParser::determineProtocolAndConsume() {
+  assert(!seenFirstByte_);
+  seenFirstByte_ = true;
+  protocol_ = determineProtocol(*readBuffer_.data());
+#ifdef MCROUTER_CARET_ONLY
+  /* The ascii and umbrella parse paths are compiled out
+     (--enable-caret-only), so anything but the Caret magic byte is a
+     fatal error. */
+  if (protocol_ != mc_caret_protocol) {
+    callback_.parseError(
+        mc_res_local_error,
+        "Expected Caret protocol, but ascii/umbrella support is "
+        "compiled out (--enable-caret-only)");
+    return false;
+  }
+  outOfOrder_ = true;
+  consumer_ = &McParser::consumeUmbrellaOrCaretData<mc_caret_protocol>;
+#else
+  switch (protocol_) {
+    case mc_ascii_protocol:
       outOfOrder_ = false;
-    } else {
-      assert(protocol_ == mc_umbrella_protocol ||
-             protocol_ == mc_caret_protocol);
+      consumer_ = &McParser::consumeAsciiData;
+      break;
+    case mc_umbrella_protocol:
       outOfOrder_ = true;
-    }
+      consumer_ = &McParser::consumeUmbrellaOrCaretData<mc_umbrella_protocol>;
+      break;
+    default:
+      assert(protocol_ == mc_caret_protocol);
+      outOfOrder_ = true;
+      consumer_ = &McParser::consumeUmbrellaOrCaretData<mc_caret_protocol>;
+      break;
   }
+#endif
+  return (this->*consumer_)();
+}
 
-  if (protocol_ == mc_ascii_protocol) {
-    callback_.handleAscii(readBuffer_);
+bool McParser::readDataAvailable(size_t len) {
+  // Caller is responsible for ensuring the read buffer has enough tailroom
+  readBuffer_.append(len);
+  if (UNLIKELY(readBuffer_.length() == 0)) {
     return true;
   }
-  return readUmbrellaOrCaretData();
+  return (this->*consumer_)();
 }
 
 double McParser::getDropProbability() const {
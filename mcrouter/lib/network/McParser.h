@@ -81,7 +81,7 @@ class McParser {
            const bool useJemallocNodumpAllocator = false,
            ConnectionFifo* debugFifo = nullptr);
 
-  ~McParser() = default;
+  ~McParser();
 
   mc_protocol_t protocol() const {
     return protocol_;
@@ -95,6 +95,14 @@ class McParser {
     return outOfOrder_;
   }
 
+  /**
+   * True if the read buffer holds data of a partially parsed message,
+   * i.e. we're not at a message boundary.
+   */
+  bool hasUnparsedData() const {
+    return readBuffer_.length() != 0;
+  }
+
   /**
    * TAsyncTransport-style getReadBuffer().
    *
@@ -121,10 +129,27 @@ class McParser {
 
   mc_protocol_t protocol_{mc_unknown_protocol};
 
+  /**
+   * Protocol-specific read consumer, in the style of the ascii parsers'
+   * consumer_.  Starts out as determineProtocolAndConsume(), which
+   * inspects the first byte received and installs the real consumer, so
+   * subsequent reads dispatch through one indirect call with no
+   * protocol branching.
+   */
+  using ConsumerFunPtr = bool (McParser::*)();
+  ConsumerFunPtr consumer_{&McParser::determineProtocolAndConsume};
+
   ParserCallback& callback_;
+  size_t minBufferSize_{256};
   size_t bufferSize_{256};
   size_t maxBufferSize_{4096};
 
+  /**
+   * Largest message seen since the last buffer size adjustment; drives
+   * the adaptive read buffer sizing.
+   */
+  size_t largestRecentMsgSize_{0};
+
   ConnectionFifo* debugFifo_{nullptr};
 
   uint64_t lastShrinkCycles_{0};
@@ -141,7 +166,12 @@ class McParser {
    */
   bool useJemallocNodumpAllocator_{false};
 
-  bool readUmbrellaOrCaretData();
+  bool determineProtocolAndConsume();
+#ifndef MCROUTER_CARET_ONLY
+  bool consumeAsciiData();
+#endif
+  template <mc_protocol_t Protocol>
+  bool consumeUmbrellaOrCaretData();
 };
 
 inline McParser::ParserCallback::~ParserCallback() {}
@@ -136,6 +136,26 @@ struct HasDispatchTypedRequest<
   static constexpr std::true_type value{};
 };
 
+template <class T, class Enable = void>
+struct HasParseBatchEnd {
+  static constexpr std::false_type value{};
+};
+
+template <class T>
+struct HasParseBatchEnd<
+  T,
+  typename std::enable_if<
+    std::is_same<
+      decltype(std::declval<T&>().parseBatchEnd()),
+      void>::value>::type> {
+  static constexpr std::true_type value{};
+};
+
+template <class OnRequest>
+void McServerOnRequestWrapper<OnRequest, List<>>::parseBatchEnd() {
+  parseBatchEndIfDefined(HasParseBatchEnd<OnRequest>::value);
+}
+
 template <class OnRequest>
 void McServerOnRequestWrapper<OnRequest, List<>>::caretRequestReady(
     const UmbrellaMessageInfo& headerInfo,
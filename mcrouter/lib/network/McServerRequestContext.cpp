@@ -9,11 +9,56 @@
  */
 #include "McServerRequestContext.h"
 
+#include <folly/Memory.h>
+#include <folly/ThreadLocal.h>
+
 #include "mcrouter/lib/network/McServerSession.h"
 #include "mcrouter/lib/network/MultiOpParent.h"
 
 namespace facebook { namespace memcache {
 
+namespace {
+constexpr size_t kMaxFreeAsciiStates = 64;
+}
+
+/* The context is embedded by value in every pooled WriteBuffer and moved
+   around on the hot path of each request; everything rarely used (multi-op
+   parent, ascii key) lives behind asciiState_ precisely so the rest stays
+   within a single cache line. */
+static_assert(sizeof(McServerRequestContext) <= 64,
+              "McServerRequestContext should fit in one cache line");
+
+std::vector<std::unique_ptr<McServerRequestContext::AsciiState>>&
+McServerRequestContext::asciiStateFreeList() {
+  static folly::ThreadLocal<std::vector<std::unique_ptr<AsciiState>>> freeList;
+  return *freeList;
+}
+
+std::unique_ptr<McServerRequestContext::AsciiState>
+McServerRequestContext::acquireAsciiState() {
+  auto& freeList = asciiStateFreeList();
+  if (freeList.empty()) {
+    return folly::make_unique<AsciiState>();
+  }
+  auto state = std::move(freeList.back());
+  freeList.pop_back();
+  return state;
+}
+
+void McServerRequestContext::releaseAsciiState(
+    std::unique_ptr<AsciiState> state) {
+  auto& freeList = asciiStateFreeList();
+  if (freeList.size() >= kMaxFreeAsciiStates) {
+    return;
+  }
+  /* Dropping the parent reference may run MultiOpParent's destructor,
+     which can reenter this free list; the vector object itself stays
+     valid across that, we just might briefly overshoot the cap. */
+  state->parent_.reset();
+  state->key_.clear();
+  freeList.push_back(std::move(state));
+}
+
 McServerSession& McServerRequestContext::session() {
   assert(session_ != nullptr);
   return *session_;
@@ -31,10 +76,9 @@ McServerRequestContext::McServerRequestContext(
       isEndContext_(isEndContext),
       noReply_(nr),
       reqid_(r),
-      compressionContext_(folly::make_unique<CompressionContext>(
-          CompressionContext(compressionCodecMap, codecRange))) {
+      compressionContext_(compressionCodecMap, codecRange) {
   if (parent) {
-    asciiState_ = folly::make_unique<AsciiState>();
+    asciiState_ = acquireAsciiState();
     asciiState_->parent_ = std::move(parent);
     asciiState_->parent_->recordRequest();
   }
@@ -76,6 +120,9 @@ McServerRequestContext::~McServerRequestContext() {
     assert(replied_);
     session_->onTransactionCompleted(hasParent() || isEndContext_);
   }
+  if (asciiState_) {
+    releaseAsciiState(std::move(asciiState_));
+  }
 }
 
 // Note: defined in .cpp in order to avoid circular dependency between
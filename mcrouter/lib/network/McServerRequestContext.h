@@ -9,8 +9,10 @@
  */
 #pragma once
 
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <folly/io/IOBuf.h>
 #include <folly/Optional.h>
@@ -36,6 +38,7 @@ struct CompressionContext {
 
   CodecIdRange codecIdRange = CodecIdRange::Empty;
 
+  CompressionContext() = default;
   CompressionContext(
       const CompressionCodecMap* codecMap,
       CodecIdRange codecRange)
@@ -88,7 +91,10 @@ class McServerRequestContext {
   };
   std::unique_ptr<AsciiState> asciiState_;
 
-  std::unique_ptr<CompressionContext> compressionContext_;
+  // Stored inline: heap-allocating this (it's only three words) would put
+  // a malloc/free pair on every request, which is most of the cost of
+  // serving a miss.
+  CompressionContext compressionContext_;
 
   template <class Reply>
   bool noReply(const Reply& r) const;
@@ -114,10 +120,20 @@ class McServerRequestContext {
 
   folly::Optional<folly::IOBuf>& asciiKey() {
     if (!asciiState_) {
-      asciiState_ = folly::make_unique<AsciiState>();
+      asciiState_ = acquireAsciiState();
     }
     return asciiState_->key_;
   }
+
+  /**
+   * Every key of an ascii multi-op gets its own context and AsciiState,
+   * so we recycle them through a per-thread free list rather than doing
+   * a malloc/free pair per key.  The keys themselves already share the
+   * connection's read buffer via IOBuf clones.
+   */
+  static std::unique_ptr<AsciiState> acquireAsciiState();
+  static void releaseAsciiState(std::unique_ptr<AsciiState> state);
+  static std::vector<std::unique_ptr<AsciiState>>& asciiStateFreeList();
   bool hasParent() const {
     return asciiState_ && asciiState_->parent_;
   }
@@ -207,7 +223,16 @@ class McServerOnRequestIf<List<Request, Requests...>>
   virtual ~McServerOnRequestIf() = default;
 };
 
-class McServerOnRequest : public McServerOnRequestIf<McRequestList> {};
+class McServerOnRequest : public McServerOnRequestIf<McRequestList> {
+ public:
+  /**
+   * Called after the parser has dispatched every complete request found
+   * in one read event, marking the end of the batch started by the
+   * first requestReady() call.  Callbacks that buffer requests use this
+   * as their flush point.
+   */
+  virtual void parseBatchEnd() {}
+};
 
 /**
  * Helper class to wrap user-defined callbacks in a correct virtual interface.
@@ -230,6 +255,14 @@ class McServerOnRequestWrapper<OnRequest, List<>> : public McServerOnRequest {
       const folly::IOBuf& reqBody,
       McServerRequestContext&& ctx) override final;
 
+  void parseBatchEnd() override final;
+
+  void parseBatchEndIfDefined(std::true_type) {
+    onRequest_.parseBatchEnd();
+  }
+
+  void parseBatchEndIfDefined(std::false_type) {}
+
   void dispatchTypedRequestIfDefined(
       const UmbrellaMessageInfo& headerInfo,
       const folly::IOBuf& reqBody,
@@ -11,6 +11,7 @@
 
 #include <memory>
 
+#include "mcrouter/lib/Tracepoints.h"
 #include "mcrouter/lib/network/McServerRequestContext.h"
 #include "mcrouter/lib/network/MultiOpParent.h"
 #include "mcrouter/lib/network/CarbonMessageList.h"
@@ -34,14 +35,30 @@ void McServerSession::asciiRequestReady(
   }
 
   if (GetLike<Request>::value && !currentMultiop_) {
-    currentMultiop_ = std::make_shared<MultiOpParent>(*this, tailReqid_++);
+    currentMultiop_ = MultiOpParent::create(*this);
   }
   uint64_t reqid;
   reqid = tailReqid_++;
 
   McServerRequestContext ctx(*this, reqid, noreply, currentMultiop_);
 
-  ctx.asciiKey().emplace(req.key().raw().cloneOneAsValue());
+  MCROUTER_PROBE_REQUEST_PARSED(
+      this,
+      reqid,
+      (OpFromType<Request, RequestOpMapping>::value),
+      req.key().fullKey().begin(),
+      req.key().fullKey().size());
+
+  /* The context may outlive the request, so an unmanaged key buffer
+     (e.g. a short key stored inline in the request, see carbon::Keys)
+     must be deep-copied rather than cloned. */
+  if (req.key().raw().isManagedOne()) {
+    ctx.asciiKey().emplace(req.key().raw().cloneOneAsValue());
+  } else {
+    ctx.asciiKey().emplace(folly::IOBuf(folly::IOBuf::COPY_BUFFER,
+                                        req.key().fullKey().begin(),
+                                        req.key().fullKey().size()));
+  }
 
   if (result == mc_res_bad_key) {
     McServerRequestContext::reply(std::move(ctx), Reply(mc_res_bad_key));
@@ -63,6 +80,13 @@ void McServerSession::umbrellaRequestReady(Request&& req, uint64_t reqid) {
 
   McServerRequestContext ctx(*this, reqid);
 
+  MCROUTER_PROBE_REQUEST_PARSED(
+      this,
+      reqid,
+      (OpFromType<Request, RequestOpMapping>::value),
+      req.key().fullKey().begin(),
+      req.key().fullKey().size());
+
   umbrellaRequestReadyImpl(std::move(ctx), std::move(req));
 }
 
@@ -79,8 +103,9 @@ inline void McServerSession::umbrellaRequestReadyImpl(
     McVersionRequest&& req) {
   if (options_.defaultVersionHandler) {
     McVersionReply versionReply(mc_res_ok);
-    versionReply.value() =
-        folly::IOBuf(folly::IOBuf::COPY_BUFFER, options_.versionString);
+    /* options_ outlives all pending writes, so no need to copy */
+    versionReply.value() = folly::IOBuf::wrapBufferAsValue(
+        options_.versionString.data(), options_.versionString.size());
     McServerRequestContext::reply(std::move(ctx), std::move(versionReply));
   } else {
     onRequest_->requestReady(std::move(ctx), std::move(req));
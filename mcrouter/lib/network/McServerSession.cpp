@@ -9,14 +9,38 @@
  */
 #include "McServerSession.h"
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#define MCROUTER_HAVE_MSG_ZEROCOPY 1
+/* Definitions for kernels that support zero copy at runtime but whose
+   uapi headers predate it */
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#endif
+
 #include <folly/Memory.h>
+#include <folly/io/async/EventHandler.h>
 #include <folly/small_vector.h>
 
+#include "mcrouter/lib/Tracepoints.h"
 #include "mcrouter/lib/debug/FifoManager.h"
+#include "mcrouter/lib/network/IoUringWriter.h"
 #include "mcrouter/lib/network/McServerRequestContext.h"
 #include "mcrouter/lib/network/MultiOpParent.h"
+#include "mcrouter/lib/network/ThreadLocalSSLContextProvider.h"
 #include "mcrouter/lib/network/WriteBuffer.h"
 
 namespace facebook { namespace memcache {
@@ -35,10 +59,40 @@ ConnectionFifo getDebugFifo(
   return ConnectionFifo();
 }
 
+/* A session's egress share never drops below this, so that on a crowded
+   worker every connection can still buffer a reasonable reply batch */
+constexpr size_t kMinEgressShare = 64 * 1024;
+
 } // anonymous namespace
 
 constexpr size_t kIovecVectorSize = 64;
 
+/**
+ * Watches the session's socket for zero-copy completion notifications.
+ * Registered alongside the transport's read callback; it only ever reads
+ * from the error queue, so it never consumes stream data.
+ */
+class McServerSession::ZeroCopyNotificationHandler : public folly::EventHandler {
+ public:
+  ZeroCopyNotificationHandler(
+      McServerSession& session,
+      folly::EventBase& evb,
+      int fd)
+      : folly::EventHandler(&evb, fd),
+        session_(session),
+        fd_(fd) {
+    registerHandler(EV_READ | EV_PERSIST);
+  }
+
+  void handlerReady(uint16_t) noexcept override final {
+    session_.processZeroCopyNotifications(fd_);
+  }
+
+ private:
+  McServerSession& session_;
+  int fd_;
+};
+
 McServerSession& McServerSession::create(
     folly::AsyncTransportWrapper::UniquePtr transport,
     std::shared_ptr<McServerOnRequest> cb,
@@ -85,6 +139,7 @@ McServerSession::McServerSession(
       parser_(*this,
               options_.minBufferSize,
               options_.maxBufferSize,
+              options_.useJemallocNodumpAllocator,
               &debugFifo_),
       userCtxt_(userCtxt) {
 
@@ -95,10 +150,37 @@ McServerSession::McServerSession(
     LOG(WARNING) << "Failed to get socket address: " << e.what();
   }
 
+  if (!options_.lowPriorityNetworks.empty() &&
+      (socketAddress_.getFamily() == AF_INET ||
+       socketAddress_.getFamily() == AF_INET6)) {
+    const auto peerIp = socketAddress_.getIPAddress();
+    for (const auto& network : options_.lowPriorityNetworks) {
+      if (peerIp.inSubnet(network.first, network.second)) {
+        lowPriority_ = true;
+        break;
+      }
+    }
+  }
+
   auto socket = transport_->getUnderlyingTransport<folly::AsyncSSLSocket>();
   if (socket != nullptr) {
     socket->sslAccept(this, /* timeout = */ 0);
   }
+
+  if (options_.egressAccount != nullptr) {
+    ++options_.egressAccount->numSessions;
+  }
+}
+
+McServerSession::~McServerSession() {
+  if (options_.egressAccount != nullptr) {
+    /* Writes that never completed (e.g. connection error) still have
+       their bytes accounted; hand them back on the way out */
+    assert(options_.egressAccount->bufferedBytes >= egressBufferedBytes_);
+    options_.egressAccount->bufferedBytes -= egressBufferedBytes_;
+    assert(options_.egressAccount->numSessions > 0);
+    --options_.egressAccount->numSessions;
+  }
 }
 
 void McServerSession::pause(PauseReason reason) {
@@ -121,14 +203,75 @@ void McServerSession::resume(PauseReason reason) {
 
 void McServerSession::onTransactionStarted(bool isSubRequest) {
   ++inFlight_;
-  if (options_.maxInFlight > 0 && !isSubRequest) {
-    if (++realRequestsInFlight_ >= options_.maxInFlight) {
+  if (!isSubRequest) {
+    ++recentRequests_;
+  }
+  if (inFlightLimit() > 0 && !isSubRequest) {
+    ++realRequestsInFlight_;
+    if (!isParsing_) {
       DestructorGuard dg(this);
-      pause(PAUSE_THROTTLED);
+      updateThrottleState();
     }
   }
 }
 
+size_t McServerSession::inFlightLimit() const noexcept {
+  if (lowPriority_ && options_.lowPriorityMaxInFlight > 0) {
+    return options_.lowPriorityMaxInFlight;
+  }
+  return options_.maxInFlight;
+}
+
+void McServerSession::updateThrottleState() {
+  const auto limit = inFlightLimit();
+  if (limit == 0 || state_ != STREAMING) {
+    return;
+  }
+  if (realRequestsInFlight_ >= limit) {
+    pause(PAUSE_THROTTLED);
+  } else if (pauseState_ & PAUSE_THROTTLED) {
+    resume(PAUSE_THROTTLED);
+  }
+}
+
+size_t McServerSession::egressShare() const {
+  const auto account = options_.egressAccount;
+  assert(account != nullptr && account->numSessions > 0);
+  return std::max(
+      kMinEgressShare, options_.maxEgressBytes / account->numSessions);
+}
+
+void McServerSession::onEgressBuffered(size_t bytes) {
+  auto account = options_.egressAccount;
+  if (account == nullptr) {
+    return;
+  }
+  egressBufferedBytes_ += bytes;
+  account->bufferedBytes += bytes;
+  account->maxBufferedBytes =
+      std::max(account->maxBufferedBytes, account->bufferedBytes);
+  account->maxSessionBufferedBytes =
+      std::max(account->maxSessionBufferedBytes, egressBufferedBytes_);
+  if (egressBufferedBytes_ > egressShare()) {
+    pause(PAUSE_EGRESS);
+  }
+}
+
+void McServerSession::onEgressWritten(size_t bytes) {
+  auto account = options_.egressAccount;
+  if (account == nullptr) {
+    return;
+  }
+  assert(egressBufferedBytes_ >= bytes);
+  assert(account->bufferedBytes >= bytes);
+  egressBufferedBytes_ -= bytes;
+  account->bufferedBytes -= bytes;
+  if ((pauseState_ & PAUSE_EGRESS) &&
+      egressBufferedBytes_ <= egressShare() / 2) {
+    resume(PAUSE_EGRESS);
+  }
+}
+
 void McServerSession::checkClosed() {
   if (!inFlight_) {
     assert(pendingWrites_->empty());
@@ -153,10 +296,11 @@ void McServerSession::onTransactionCompleted(bool isSubRequest) {
 
   assert(inFlight_ > 0);
   --inFlight_;
-  if (options_.maxInFlight > 0 && !isSubRequest) {
+  if (inFlightLimit() > 0 && !isSubRequest) {
     assert(realRequestsInFlight_ > 0);
-    if (--realRequestsInFlight_ < options_.maxInFlight) {
-      resume(PAUSE_THROTTLED);
+    --realRequestsInFlight_;
+    if (!isParsing_) {
+      updateThrottleState();
     }
   }
 
@@ -166,6 +310,8 @@ void McServerSession::onTransactionCompleted(bool isSubRequest) {
 void McServerSession::reply(std::unique_ptr<WriteBuffer> wb, uint64_t reqid) {
   DestructorGuard dg(this);
 
+  MCROUTER_PROBE_REPLY_WRITTEN(this, reqid);
+
   if (parser_.outOfOrder()) {
     queueWrite(std::move(wb));
   } else {
@@ -185,6 +331,19 @@ void McServerSession::reply(std::unique_ptr<WriteBuffer> wb, uint64_t reqid) {
   }
 }
 
+void McServerSession::replyStatic(
+    McServerRequestContext&& ctx,
+    const std::string& data,
+    uint32_t typeId) {
+  ctx.replied_ = true;
+  ensureWriteBufs();
+
+  uint64_t reqid = ctx.reqid_;
+  auto wb = writeBufs_->get();
+  wb->prepareStatic(std::move(ctx), data, typeId);
+  reply(std::move(wb), reqid);
+}
+
 void McServerSession::processMultiOpEnd() {
   currentMultiop_->recordEnd(tailReqid_++);
   currentMultiop_.reset();
@@ -207,6 +366,48 @@ void McServerSession::close() {
   checkClosed();
 }
 
+bool McServerSession::isDetachable() const {
+  if (state_ != STREAMING || inFlight_ != 0 || writeScheduled_ ||
+      !pendingWrites_->empty() || !zeroCopyBatches_.empty() ||
+      pauseState_ != 0 || currentMultiop_ != nullptr ||
+      !blockedReplies_.empty() || parser_.hasUnparsedData()) {
+    return false;
+  }
+  if (!transport_ || !transport_->good()) {
+    return false;
+  }
+  if (transport_->getUnderlyingTransport<folly::AsyncSSLSocket>() !=
+      nullptr) {
+    /* SSL record/handshake state can't be moved with the fd */
+    return false;
+  }
+  auto socket = transport_->getUnderlyingTransport<folly::AsyncSocket>();
+  return socket != nullptr && socket->getFd() >= 0;
+}
+
+int McServerSession::detachFd() {
+  DestructorGuard dg(this);
+
+  if (!isDetachable()) {
+    return -1;
+  }
+
+  auto socket = transport_->getUnderlyingTransport<folly::AsyncSocket>();
+  transport_->setReadCB(nullptr);
+  auto fd = socket->detachFd();
+
+  /* Tear down as if the connection had closed, but with the fd alive
+     and owned by the caller */
+  state_ = CLOSING;
+  stateCb_.onCloseStart(*this);
+  state_ = CLOSED;
+  transport_.reset();
+  stateCb_.onCloseFinish(*this);
+  destroy();
+
+  return fd;
+}
+
 void McServerSession::getReadBuffer(void** bufReturn, size_t* lenReturn) {
   curBuffer_ = parser_.getReadBuffer();
   *bufReturn = curBuffer_.first;
@@ -215,7 +416,16 @@ void McServerSession::getReadBuffer(void** bufReturn, size_t* lenReturn) {
 
 void McServerSession::readDataAvailable(size_t len) noexcept {
   DestructorGuard dg(this);
-  if (!parser_.readDataAvailable(len)) {
+  // The parser dispatches every complete request in the buffer in one
+  // synchronous pass; treat them as a single batch and make the
+  // throttle pause/resume decision once afterwards instead of once per
+  // request.
+  isParsing_ = true;
+  const bool parseOk = parser_.readDataAvailable(len);
+  isParsing_ = false;
+  onRequest_->parseBatchEnd();
+  updateThrottleState();
+  if (!parseOk) {
     close();
   }
 }
@@ -249,9 +459,21 @@ void McServerSession::onRequest(
   McServerRequestContext ctx(*this, reqid);
 
   if (options_.defaultVersionHandler) {
+    /* Health checkers poll version at high rates; answer from the
+       worker's preformatted wire reply instead of serializing one per
+       request where possible (the umbrella and caret framings embed the
+       request id, so only ascii replies can be fully preserialized). */
+    if (parser_.protocol() == mc_ascii_protocol &&
+        options_.packedAsciiVersionReply) {
+      replyStatic(
+          std::move(ctx),
+          *options_.packedAsciiVersionReply,
+          static_cast<uint32_t>(McVersionReply::typeId));
+      return;
+    }
     McVersionReply reply(mc_res_ok);
-    reply.value() =
-        folly::IOBuf(folly::IOBuf::COPY_BUFFER, options_.versionString);
+    reply.value() = folly::IOBuf::wrapBufferAsValue(
+        options_.versionString.data(), options_.versionString.size());
     McServerRequestContext::reply(std::move(ctx), std::move(reply));
     return;
   }
@@ -299,11 +521,17 @@ void McServerSession::caretRequestReady(const UmbrellaMessageInfo& headerInfo,
       compressionCodecMap_,
       getCompressionCodecIdRange(headerInfo));
 
+  /* The typed request isn't parsed yet, so no op or key here; the probe
+     still marks when the request came off the wire. */
+  MCROUTER_PROBE_REQUEST_PARSED(
+      this, headerInfo.reqId, mc_op_unknown, nullptr, 0);
+
   if (McVersionRequest::typeId == headerInfo.typeId &&
       options_.defaultVersionHandler) {
     McVersionReply versionReply(mc_res_ok);
-    versionReply.value() =
-        folly::IOBuf(folly::IOBuf::COPY_BUFFER, options_.versionString);
+    /* options_ outlives all pending writes, so no need to copy */
+    versionReply.value() = folly::IOBuf::wrapBufferAsValue(
+        options_.versionString.data(), options_.versionString.size());
     McServerRequestContext::reply(std::move(ctx), std::move(versionReply));
   } else {
     try {
@@ -345,7 +573,14 @@ void McServerSession::parseError(mc_res_t result, folly::StringPiece reason) {
 
 void McServerSession::ensureWriteBufs() {
   if (writeBufs_ == nullptr) {
-    writeBufs_ = folly::make_unique<WriteBufferQueue>(parser_.protocol());
+    auto pool = options_.writeBufferPool;
+    if (pool == nullptr) {
+      /* Sessions created without a worker share a per-thread pool */
+      static thread_local WriteBufferPool fallbackPool;
+      pool = &fallbackPool;
+    }
+    writeBufs_ =
+        folly::make_unique<WriteBufferQueue>(*pool, parser_.protocol());
   }
 }
 
@@ -353,6 +588,7 @@ void McServerSession::queueWrite(std::unique_ptr<WriteBuffer> wb) {
   if (wb == nullptr) {
     return;
   }
+  onEgressBuffered(wb->totalSize());
   if (options_.singleWrite) {
     if (UNLIKELY(debugFifo_.isConnected())) {
       writeToDebugFifo(wb.get());
@@ -370,8 +606,10 @@ void McServerSession::queueWrite(std::unique_ptr<WriteBuffer> wb) {
     pendingWrites_->pushBack(std::move(wb));
 
     if (!writeScheduled_) {
-      eventBase_.runInLoop(&sendWritesCallback_, /* thisIteration= */ true);
       writeScheduled_ = true;
+      if (!stateCb_.onWriteScheduled(*this)) {
+        eventBase_.runInLoop(&sendWritesCallback_, /* thisIteration= */ true);
+      }
     }
   }
 }
@@ -382,12 +620,16 @@ void McServerSession::sendWrites() {
   writeScheduled_ = false;
 
   folly::small_vector<struct iovec, kIovecVectorSize> iovs;
+  size_t totalBytes = 0;
   while (!pendingWrites_->empty()) {
     auto wb = pendingWrites_->popFront();
     if (!wb->noReply()) {
       if (UNLIKELY(debugFifo_.isConnected())) {
         writeToDebugFifo(wb.get());
       }
+      for (size_t i = 0; i < wb->getIovsCount(); ++i) {
+        totalBytes += wb->getIovsBegin()[i].iov_len;
+      }
       iovs.insert(iovs.end(),
                   wb->getIovsBegin(),
                   wb->getIovsBegin() + wb->getIovsCount());
@@ -398,9 +640,195 @@ void McServerSession::sendWrites() {
     writeBufs_->push(std::move(wb));
   }
 
+  if (!iovs.empty() && options_.zeroCopyThreshold > 0 &&
+      totalBytes >= options_.zeroCopyThreshold && ensureZeroCopy() &&
+      !zeroCopyTransportPending()) {
+    auto socket = transport_->getUnderlyingTransport<folly::AsyncSocket>();
+    sendWithZeroCopy(socket->getFd(), iovs.data(), iovs.size(), totalBytes);
+    return;
+  }
+  if (zeroCopyEnabled_) {
+    /* Batches below the threshold still need a tracking entry so that
+       write buffers are retired strictly in order.  Over-threshold
+       batches also land here while an earlier transport write is
+       unconfirmed: AsyncSocket may still hold its unsent tail, which a
+       raw sendmsg() would overtake on the wire */
+    zeroCopyBatches_.emplace_back();
+    zeroCopyBatches_.back().needsTransport = true;
+    transport_->writev(this, iovs.data(), iovs.size());
+    return;
+  }
+
+  if (options_.ioUringWriter != nullptr && !iovs.empty() &&
+      transportWritesPending_ == 0 &&
+      transport_->getUnderlyingTransport<folly::AsyncSSLSocket>() == nullptr) {
+    auto socket = transport_->getUnderlyingTransport<folly::AsyncSocket>();
+    /* The buffers behind iovs are owned by writeBufs_ and stay alive
+       until completeWrite(), so only the iovec array itself is copied
+       by the ring */
+    if (socket != nullptr &&
+        options_.ioUringWriter->writev(
+            socket->getFd(),
+            iovs.data(),
+            iovs.size(),
+            [this](ssize_t result) {
+              if (result >= 0) {
+                writeSuccess();
+              } else {
+                writeErr(
+                    0,
+                    folly::AsyncSocketException(
+                        folly::AsyncSocketException::INTERNAL_ERROR,
+                        "io_uring write failed",
+                        -result));
+              }
+            })) {
+      return;
+    }
+    /* Ring unavailable, or full with nothing of ours queued in it (the
+       writer queues later batches behind an in-flight one itself), so
+       the transport write below cannot overtake any ring bytes */
+  }
+
+  ++transportWritesPending_;
   transport_->writev(this, iovs.data(), iovs.size());
 }
 
+bool McServerSession::ensureZeroCopy() {
+#ifdef MCROUTER_HAVE_MSG_ZEROCOPY
+  if (zeroCopyAttempted_) {
+    return zeroCopyEnabled_;
+  }
+  zeroCopyAttempted_ = true;
+  if (options_.singleWrite || options_.ioUringWriter != nullptr ||
+      transport_->getUnderlyingTransport<folly::AsyncSSLSocket>() != nullptr) {
+    return false;
+  }
+  auto socket = transport_->getUnderlyingTransport<folly::AsyncSocket>();
+  if (socket == nullptr) {
+    return false;
+  }
+  const int fd = socket->getFd();
+  int one = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) != 0) {
+    /* Kernel without MSG_ZEROCOPY support */
+    return false;
+  }
+  zeroCopyHandler_ =
+      folly::make_unique<ZeroCopyNotificationHandler>(*this, eventBase_, fd);
+  zeroCopyEnabled_ = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool McServerSession::zeroCopyTransportPending() const {
+  for (const auto& batch : zeroCopyBatches_) {
+    if (batch.needsTransport && !batch.transportDone) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void McServerSession::sendWithZeroCopy(
+    int fd,
+    const struct iovec* iovs,
+    size_t count,
+    size_t totalBytes) {
+#ifdef MCROUTER_HAVE_MSG_ZEROCOPY
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = const_cast<struct iovec*>(iovs);
+  msg.msg_iovlen = count;
+  const ssize_t sent =
+      sendmsg(fd, &msg, MSG_ZEROCOPY | MSG_DONTWAIT | MSG_NOSIGNAL);
+
+  ZeroCopyBatch batch;
+  size_t skip = 0;
+  if (sent > 0) {
+    /* The kernel bumps the completion counter once per successful send */
+    batch.hasZeroCopy = true;
+    batch.seq = zeroCopySeq_++;
+    skip = sent;
+  }
+  if (sent < 0 || static_cast<size_t>(sent) < totalBytes) {
+    /* Push the unsent tail through the transport (copying) write path;
+       the raw send above already happened, so ordering is preserved */
+    folly::small_vector<struct iovec, kIovecVectorSize> rest;
+    for (size_t i = 0; i < count; ++i) {
+      if (skip >= iovs[i].iov_len) {
+        skip -= iovs[i].iov_len;
+        continue;
+      }
+      auto iov = iovs[i];
+      iov.iov_base = static_cast<char*>(iov.iov_base) + skip;
+      iov.iov_len -= skip;
+      skip = 0;
+      rest.push_back(iov);
+    }
+    batch.needsTransport = true;
+    zeroCopyBatches_.push_back(batch);
+    transport_->writev(this, rest.data(), rest.size());
+    return;
+  }
+  zeroCopyBatches_.push_back(batch);
+#endif
+}
+
+void McServerSession::processZeroCopyNotifications(int fd) {
+#ifdef MCROUTER_HAVE_MSG_ZEROCOPY
+  DestructorGuard dg(this);
+
+  struct msghdr msg;
+  char control[256];
+  while (true) {
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      break;
+    }
+    for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+          !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+      auto serr =
+          reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cmsg));
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        continue;
+      }
+      const uint32_t lo = serr->ee_info;
+      const uint32_t hi = serr->ee_data;
+      for (auto& batch : zeroCopyBatches_) {
+        if (batch.hasZeroCopy && !batch.zeroCopyDone &&
+            batch.seq >= lo && batch.seq <= hi) {
+          batch.zeroCopyDone = true;
+        }
+      }
+    }
+  }
+  drainZeroCopyCompletions();
+#endif
+}
+
+void McServerSession::drainZeroCopyCompletions() {
+  bool popped = false;
+  while (!zeroCopyBatches_.empty() && zeroCopyBatches_.front().done()) {
+    zeroCopyBatches_.pop_front();
+    completeWrite();
+    popped = true;
+  }
+  if (popped && writeBufs_ != nullptr && writeBufs_->empty() &&
+      state_ == STREAMING) {
+    stateCb_.onWriteQuiescence(*this);
+    resume(PAUSE_WRITE);
+  }
+}
+
 void McServerSession::writeToDebugFifo(const WriteBuffer* wb) noexcept {
   if (!wb->isSubRequest()) {
     debugFifo_.startMessage(MessageDirection::Sent, wb->typeId());
@@ -420,11 +848,29 @@ void McServerSession::writeToDebugFifo(const WriteBuffer* wb) noexcept {
 }
 
 void McServerSession::completeWrite() {
-  writeBufs_->pop(!options_.singleWrite /* popBatch */);
+  onEgressWritten(writeBufs_->pop(!options_.singleWrite /* popBatch */));
 }
 
 void McServerSession::writeSuccess() noexcept {
   DestructorGuard dg(this);
+
+  if (zeroCopyEnabled_) {
+    for (auto& batch : zeroCopyBatches_) {
+      if (batch.needsTransport && !batch.transportDone) {
+        batch.transportDone = true;
+        break;
+      }
+    }
+    drainZeroCopyCompletions();
+    return;
+  }
+
+  /* Stays zero when the completion came from the ring or a singleWrite
+     send; only sendWrites()' transport batches are counted */
+  if (transportWritesPending_ > 0) {
+    --transportWritesPending_;
+  }
+
   completeWrite();
 
   assert(writeBufs_ != nullptr);
@@ -440,6 +886,23 @@ void McServerSession::writeErr(
   const folly::AsyncSocketException& ex) noexcept {
 
   DestructorGuard dg(this);
+
+  if (zeroCopyEnabled_) {
+    /* The socket is going away and the kernel purges its send queue,
+       so don't wait for zero-copy notifications that may never arrive */
+    for (auto& batch : zeroCopyBatches_) {
+      batch.zeroCopyDone = true;
+      batch.transportDone = true;
+    }
+    drainZeroCopyCompletions();
+    close();
+    return;
+  }
+
+  if (transportWritesPending_ > 0) {
+    --transportWritesPending_;
+  }
+
   completeWrite();
   close();
 }
@@ -479,18 +942,38 @@ bool McServerSession::handshakeVer(folly::AsyncSSLSocket*,
 
 void McServerSession::handshakeSuc(folly::AsyncSSLSocket* sock) noexcept {
   auto cert = sock->getPeerCert();
-  if (cert == nullptr) {
-    return;
-  }
-  auto sub = X509_get_subject_name(cert.get());
-  if (sub != nullptr) {
-    char cn[ub_common_name + 1];
-    const auto res =
-        X509_NAME_get_text_by_NID(sub, NID_commonName, cn, ub_common_name);
-    if (res > 0) {
-      clientCommonName_.assign(std::string(cn, res));
+  if (cert != nullptr) {
+    auto sub = X509_get_subject_name(cert.get());
+    if (sub != nullptr) {
+      char cn[ub_common_name + 1];
+      const auto res =
+          X509_NAME_get_text_by_NID(sub, NID_commonName, cn, ub_common_name);
+      if (res > 0) {
+        clientCommonName_.assign(std::string(cn, res));
+      }
     }
   }
+
+  if (options_.useKernelTls) {
+    trySwitchToKernelTls(sock);
+  }
+}
+
+void McServerSession::trySwitchToKernelTls(folly::AsyncSSLSocket* sslSocket) {
+  DestructorGuard dg(this);
+
+  const int fd = sslSocket->getFd();
+  if (!enableKernelTls(
+          const_cast<SSL*>(sslSocket->getSSL()), fd)) {
+    return;
+  }
+
+  /* The kernel now owns record crypto for both directions; hand the fd
+     over to a plain socket so writes go out via writev() and can use
+     the batched/zero-copy send paths */
+  sslSocket->detachFd();
+  transport_.reset(new folly::AsyncSocket(&eventBase_, fd));
+  transport_->setReadCB(pauseState_ == 0 ? this : nullptr);
 }
 
 void McServerSession::handshakeErr(
@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include <deque>
+
 #include <folly/IntrusiveList.h>
 #include <folly/io/async/AsyncSocket.h>
 #include <folly/io/async/AsyncSSLSocket.h>
@@ -41,14 +43,29 @@ class McServerSession :
       private folly::AsyncTransportWrapper::WriteCallback {
  private:
   folly::SafeIntrusiveListHook hook_;
+  folly::SafeIntrusiveListHook flushHook_;
 
  public:
   using Queue = folly::CountedIntrusiveList<McServerSession,
                                             &McServerSession::hook_>;
+  using FlushList = folly::IntrusiveList<McServerSession,
+                                         &McServerSession::flushHook_>;
 
   class StateCallback {
    public:
     virtual ~StateCallback() {}
+
+    /**
+     * Called when the session gets its first pending write of the current
+     * event loop iteration.  Return true to take over flushing: the callee
+     * must then call flushWrites() on the session before the end of the
+     * loop iteration.  Return false (the default) to have the session
+     * schedule its own flush loop callback.
+     */
+    virtual bool onWriteScheduled(McServerSession&) {
+      return false;
+    }
+
     virtual void onWriteQuiescence(McServerSession&) = 0;
     virtual void onCloseStart(McServerSession&) = 0;
     virtual void onCloseFinish(McServerSession&) = 0;
@@ -126,6 +143,54 @@ class McServerSession :
     resume(PAUSE_USER);
   }
 
+  /**
+   * Write out accumulated pending replies.  Called by the worker's flush
+   * aggregator for sessions whose onWriteScheduled() returned true.
+   * No-op if there is nothing to flush.
+   */
+  void flushWrites() {
+    if (writeScheduled_) {
+      sendWrites();
+    }
+  }
+
+  /**
+   * Number of requests this session has received recently; decayed by
+   * decayRecentRequests().  Used by the worker load balancer to find
+   * hot connections.
+   */
+  uint64_t recentRequests() const noexcept {
+    return recentRequests_;
+  }
+
+  /**
+   * Halve the recent request counter and return the new value, giving
+   * periodic load collection an exponentially decayed request rate.
+   */
+  uint64_t decayRecentRequests() noexcept {
+    recentRequests_ /= 2;
+    return recentRequests_;
+  }
+
+  /**
+   * True if this session is at a message boundary with nothing in
+   * flight, so its connection can be moved to another worker: streaming
+   * state, no unparsed input, no outstanding requests or writes, and a
+   * plain (non-SSL) socket.
+   */
+  bool isDetachable() const;
+
+  /**
+   * Detach the connection's fd from this session and tear the session
+   * down without closing the fd; the caller assumes ownership and
+   * typically re-adds the fd on another worker's event base.  The usual
+   * onCloseStart()/onCloseFinish() callbacks are invoked and the session
+   * self-destructs as if the connection had closed.
+   *
+   * @return  the fd, or -1 if the session is not detachable.
+   */
+  int detachFd();
+
   /**
    * Get the user context associated with this session.
    */
@@ -140,6 +205,14 @@ class McServerSession :
     return socketAddress_;
   }
 
+  /**
+   * True if this client was classified as low-priority (batch) traffic
+   * by source network; see AsyncMcServerWorkerOptions::lowPriorityNetworks.
+   */
+  bool isLowPriority() const noexcept {
+    return lowPriority_;
+  }
+
   /**
    * @return  the client's common name obtained from the
    *          SSL cert if this is an SSL session. Else it
@@ -198,6 +271,15 @@ class McServerSession :
    */
   bool writeScheduled_{false};
 
+  /**
+   * Number of batches handed to transport_->writev() on the io_uring
+   * fallback path that haven't completed yet.  While nonzero, new
+   * batches must also go through the transport: AsyncSocket may still
+   * hold an unsent tail of those batches, and a ring write issued now
+   * would overtake it on the wire.
+   */
+  size_t transportWritesPending_{0};
+
   /**
    * Total number of alive McTransactions in the system.
    */
@@ -211,6 +293,31 @@ class McServerSession :
    */
   size_t realRequestsInFlight_{0};
 
+  /**
+   * Decayed count of requests received, see recentRequests().
+   */
+  uint64_t recentRequests_{0};
+
+  /**
+   * Reply bytes this session currently has buffered for write
+   * (pending and in-flight).  Only maintained when
+   * options_.egressAccount is set; see onEgressBuffered().
+   */
+  size_t egressBufferedBytes_{0};
+
+  /**
+   * Set once at construction from the peer address; see isLowPriority().
+   */
+  bool lowPriority_{false};
+
+  /**
+   * True while a single read buffer is being parsed.  All requests
+   * dispatched from that buffer form one batch: the throttle
+   * pause/resume decision is applied once when the batch ends instead
+   * of once per request.
+   */
+  bool isParsing_{false};
+
   struct SendWritesCallback : public folly::EventBase::LoopCallback {
     explicit SendWritesCallback(McServerSession& session) : session_(session) {}
     void runLoopCallback() noexcept override final {
@@ -221,11 +328,77 @@ class McServerSession :
 
   SendWritesCallback sendWritesCallback_;
 
+  /**
+   * Zero-copy send state.
+   *
+   * When options_.zeroCopyThreshold is nonzero and the transport is a
+   * plain socket, write batches whose total size crosses the threshold
+   * are sent with sendmsg(MSG_ZEROCOPY).  The write buffers backing such
+   * a batch (and thus the reply value IOBufs, via WriteBuffer's
+   * destructor callback) are recycled only after the kernel completion
+   * notification arrives on the socket error queue.  To keep the
+   * write buffer queue strictly FIFO, every batch gets a tracking entry
+   * once zero copy is enabled, whether or not it used MSG_ZEROCOPY.
+   */
+  class ZeroCopyNotificationHandler;
+
+  struct ZeroCopyBatch {
+    /* sendmsg() completion counter value, valid iff hasZeroCopy */
+    uint32_t seq{0};
+    bool hasZeroCopy{false};
+    bool zeroCopyDone{false};
+    bool needsTransport{false};
+    bool transportDone{false};
+
+    bool done() const {
+      return (!hasZeroCopy || zeroCopyDone) &&
+             (!needsTransport || transportDone);
+    }
+  };
+
+  bool zeroCopyEnabled_{false};
+  bool zeroCopyAttempted_{false};
+  uint32_t zeroCopySeq_{0};
+  std::deque<ZeroCopyBatch> zeroCopyBatches_;
+  std::unique_ptr<ZeroCopyNotificationHandler> zeroCopyHandler_;
+
+  /**
+   * Lazily set SO_ZEROCOPY on the underlying socket and install the
+   * error queue notification handler.
+   * @return true if zero-copy sends may be used on this session.
+   */
+  bool ensureZeroCopy();
+
+  /**
+   * True while some batch routed through the transport hasn't been
+   * confirmed written.  Raw sendmsg() must not be used until then:
+   * AsyncSocket may still hold the batch's unsent tail, and the raw
+   * send would bypass its queue.
+   */
+  bool zeroCopyTransportPending() const;
+
+  /**
+   * Send a batch with sendmsg(MSG_ZEROCOPY), pushing any unsent tail
+   * through the regular transport write path to preserve ordering.
+   */
+  void sendWithZeroCopy(
+      int fd,
+      const struct iovec* iovs,
+      size_t count,
+      size_t totalBytes);
+
+  /**
+   * Drain the socket error queue and retire completed batches in order.
+   */
+  void processZeroCopyNotifications(int fd);
+  void drainZeroCopyCompletions();
+
   /* OR-able bits of pauseState_ */
   enum PauseReason : uint64_t {
     PAUSE_THROTTLED = 1 << 0,
     PAUSE_WRITE = 1 << 1,
     PAUSE_USER = 1 << 2,
+    PAUSE_EGRESS = 1 << 3,
   };
 
   /* Reads are enabled iff pauseState_ == 0 */
@@ -268,6 +441,38 @@ class McServerSession :
   void pause(PauseReason reason);
   void resume(PauseReason reason);
 
+  /**
+   * Applies PAUSE_THROTTLED for the current realRequestsInFlight_.
+   * Called once per parsed request batch, and per transaction outside
+   * of a batch.
+   */
+  void updateThrottleState();
+
+  /**
+   * Outstanding request limit in effect for this session:
+   * options_.lowPriorityMaxInFlight for low-priority clients when set,
+   * options_.maxInFlight otherwise.  0 means unlimited.
+   */
+  size_t inFlightLimit() const noexcept;
+
+  /**
+   * This session's byte share of the worker's egress budget: an equal
+   * split of options_.maxEgressBytes across open sessions, with a fixed
+   * floor so a crowded worker can still buffer a reasonable reply batch
+   * per session.  Only meaningful when options_.egressAccount is set.
+   */
+  size_t egressShare() const;
+
+  /**
+   * Egress accounting, no-ops unless options_.egressAccount is set.
+   * onEgressBuffered() is called as replies are queued for write and
+   * applies PAUSE_EGRESS once this session exceeds its share;
+   * onEgressWritten() is called as write buffers are retired and lifts
+   * the pause once the backlog drains below half the share.
+   */
+  void onEgressBuffered(size_t bytes);
+  void onEgressWritten(size_t bytes);
+
   /**
    * Flush pending writes to the transport.
    */
@@ -281,6 +486,16 @@ class McServerSession :
 
   void reply(std::unique_ptr<WriteBuffer> wb, uint64_t reqid);
 
+  /**
+   * Queue already serialized reply bytes for the given context, skipping
+   * per-request serialization.  `data` must stay alive until the write
+   * completes (e.g. owned by the worker).
+   */
+  void replyStatic(
+      McServerRequestContext&& ctx,
+      const std::string& data,
+      uint32_t typeId);
+
   /**
    * Called when end context is seen (for multi-op requests) or connection
    * close to close out an in flight multi-op request.
@@ -359,6 +574,13 @@ class McServerSession :
       folly::AsyncSSLSocket* sock,
       const folly::AsyncSocketException& ex) noexcept override final;
 
+  /**
+   * After a successful handshake, try to move record crypto into the
+   * kernel and replace the SSL transport with a plain socket on the
+   * same fd.  No-op unless options_.useKernelTls is set.
+   */
+  void trySwitchToKernelTls(folly::AsyncSSLSocket* sslSocket);
+
   void onTransactionStarted(bool isSubRequest);
   void onTransactionCompleted(bool isSubRequest);
 
@@ -378,10 +600,13 @@ class McServerSession :
     void* userCtxt,
     const CompressionCodecMap* codecMap);
 
+  ~McServerSession() override;
+
   McServerSession(const McServerSession&) = delete;
   McServerSession& operator=(const McServerSession&) = delete;
 
   friend class McServerRequestContext;
+  friend class MultiOpParent;
   friend class ServerMcParser<McServerSession>;
 };
 
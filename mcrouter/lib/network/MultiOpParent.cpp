@@ -9,11 +9,98 @@
  */
 #include "MultiOpParent.h"
 
+#include <cassert>
+#include <vector>
+
+#include <folly/ThreadLocal.h>
+
 namespace facebook { namespace memcache {
 
-MultiOpParent::MultiOpParent(McServerSession& session, uint64_t blockReqid)
-    : session_(session),
-      block_(session, blockReqid, true /* noReply */) {
+namespace {
+
+/**
+ * Per-thread free list for the single allocation behind each parent
+ * (std::allocate_shared fuses the MultiOpParent and its control block).
+ * All blocks are the same size, so we just recycle raw storage.  A
+ * session only manipulates its parents on its worker thread, so the
+ * allocate and deallocate sides always see the same list.
+ */
+class ParentBlockStorage {
+ public:
+  void* allocate(size_t bytes) {
+    if (bytes == blockSize_ && !free_.empty()) {
+      auto p = free_.back();
+      free_.pop_back();
+      return p;
+    }
+    blockSize_ = bytes;
+    return ::operator new(bytes);
+  }
+
+  void deallocate(void* p, size_t bytes) {
+    if (bytes == blockSize_ && free_.size() < kMaxFree) {
+      free_.push_back(p);
+      return;
+    }
+    ::operator delete(p);
+  }
+
+  ~ParentBlockStorage() {
+    for (auto p : free_) {
+      ::operator delete(p);
+    }
+  }
+
+ private:
+  constexpr static size_t kMaxFree = 64;
+
+  size_t blockSize_{0};
+  std::vector<void*> free_;
+};
+
+folly::ThreadLocal<ParentBlockStorage> parentBlockStorage;
+
+template <class T>
+struct ParentBlockAllocator {
+  using value_type = T;
+
+  ParentBlockAllocator() = default;
+  template <class U>
+  /* implicit */ ParentBlockAllocator(const ParentBlockAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+    assert(n == 1);
+    return static_cast<T*>(parentBlockStorage->allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, size_t n) {
+    parentBlockStorage->deallocate(p, n * sizeof(T));
+  }
+};
+
+template <class T, class U>
+bool operator==(const ParentBlockAllocator<T>&,
+                const ParentBlockAllocator<U>&) {
+  return true;
+}
+template <class T, class U>
+bool operator!=(const ParentBlockAllocator<T>&,
+                const ParentBlockAllocator<U>&) {
+  return false;
+}
+
+} // anonymous
+
+MultiOpParent::MultiOpParent(McServerSession& session)
+    : session_(session) {
+  /* The whole batch counts as one real request for throttling, from
+     the first sub-request until the end context replies in release() */
+  session_.onTransactionStarted(false /* isSubRequest */);
+}
+
+std::shared_ptr<MultiOpParent> MultiOpParent::create(McServerSession& session) {
+  return std::allocate_shared<MultiOpParent>(
+      ParentBlockAllocator<MultiOpParent>(), session);
 }
 
 bool MultiOpParent::reply(mc_res_t result,
@@ -58,9 +145,7 @@ void MultiOpParent::release() {
     reply_.emplace(mc_res_found);
   }
   McServerRequestContext::reply(std::move(*end_), std::move(*reply_));
-  // It doesn't really matter what reply type we use for the multi-op
-  // blocking context
-  McServerRequestContext::reply(std::move(block_), McGetReply());
+  session_.onTransactionCompleted(false /* isSubRequest */);
 }
 
 }}  // facebook::memcache
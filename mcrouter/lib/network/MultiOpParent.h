@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <memory>
 #include <string>
 
 #include <folly/Optional.h>
@@ -25,30 +26,38 @@ class McServerSession;
  * We use this struct to track the state of multi-op operations
  * for in-order protocols.
  *
- * Consider the request "get a b". This generates four contexts:
- *   block_ctx, a_ctx, b_ctx, end_ctx
- *
- * The purpose of the block_ctx is to prevent any writes until
- * both a and b complete (it's a hack that uses the head of line
- * blocking property of the in-order protocol).
+ * Consider the request "get a b". This generates three contexts:
+ *   a_ctx, b_ctx, end_ctx
  *
  * a_ctx and b_ctx are the real contexts dispatched to the application,
- * and they both have back pointers to this parent struct.
+ * and they both have back pointers to this parent struct.  Each reply
+ * streams out as soon as it and all its predecessors are ready (the
+ * in-order reply queue already enforces that order), so the first
+ * VALUE block leaves after the fastest sub-request completes rather
+ * than the slowest.
  *
  * end_ctx is for writing the END message on the wire.
  *
- * Error handling: if either a or b returns an error, we want to
- * turn the entire reply into a single error reply.
- * How it's implemented: if b_ctx returns an error, we'll store the error
- * reply in the parent. Then when unblocked, both a_ctx and b_ctx
- * will check that the parent has a stored error and will not
- * write anything to the transport (same as if 'noreply' was set).
- *
- * Finally the end context will write out the stored error reply.
+ * Error handling: on the first error reply, the parent stores the
+ * error and stops further VALUE blocks.
+ * How it's implemented: if b_ctx returns an error, we'll store the
+ * error reply in the parent. Every sub-reply not yet written to the
+ * transport checks the parent for a stored error and is suppressed
+ * (same as if 'noreply' was set); VALUE blocks that already hit the
+ * wire stay there, the same as memcached itself when a multiget fails
+ * mid-stream. Finally the end context writes out the stored error
+ * reply in place of END.
  */
 class MultiOpParent {
  public:
-  MultiOpParent(McServerSession& session, uint64_t blockReqid);
+  explicit MultiOpParent(McServerSession& session);
+
+  /**
+   * Create a parent for a new multi-op batch.  The object and its
+   * shared_ptr control block are carved out of a per-thread free list,
+   * so in steady state starting a batch doesn't go to malloc.
+   */
+  static std::shared_ptr<MultiOpParent> create(McServerSession& session);
 
   /**
    * Examine the reply result of one of the sub-requests. If it's an error
@@ -86,7 +95,6 @@ class MultiOpParent {
   bool error_{false};
 
   McServerSession& session_;
-  McServerRequestContext block_;
   folly::Optional<McServerRequestContext> end_;
 
   void release();
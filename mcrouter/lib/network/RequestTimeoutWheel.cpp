@@ -0,0 +1,85 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "RequestTimeoutWheel.h"
+
+#include <algorithm>
+
+namespace facebook { namespace memcache {
+
+constexpr std::chrono::milliseconds RequestTimeoutWheel::kTick;
+constexpr size_t RequestTimeoutWheel::kNumBuckets;
+
+RequestTimeoutWheel::RequestTimeoutWheel(folly::EventBase& eventBase)
+    : folly::AsyncTimeout(&eventBase), lastTick_(tickOf(Clock::now())) {
+  static_assert((kNumBuckets & (kNumBuckets - 1)) == 0,
+                "kNumBuckets must be a power of two");
+}
+
+uint64_t RequestTimeoutWheel::tickOf(Clock::time_point tp) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             tp.time_since_epoch()).count() / kTick.count();
+}
+
+bool RequestTimeoutWheel::empty() const {
+  for (const auto& bucket : buckets_) {
+    if (!bucket.empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void RequestTimeoutWheel::scheduleTimeout(McClientRequestContextBase& req) {
+  if (req.state() !=
+      McClientRequestContextBase::ReqState::PENDING_REPLY_QUEUE) {
+    // Already replied (or cancelled) before the socket write completed.
+    return;
+  }
+
+  if (!isScheduled()) {
+    // The wheel was idle (and thus empty); catch lastTick_ up so the
+    // next firing doesn't replay the idle period.
+    lastTick_ = tickOf(Clock::now());
+    folly::AsyncTimeout::scheduleTimeout(kTick.count());
+  }
+
+  // Round up to the next tick so a request never fires early.
+  auto tick = tickOf(Clock::now() + req.batonWaitTimeout_);
+  if (tick <= lastTick_) {
+    tick = lastTick_ + 1;
+  }
+  req.timeoutWheelTick_ = tick;
+  buckets_[tick & (kNumBuckets - 1)].push_back(req);
+}
+
+void RequestTimeoutWheel::timeoutExpired() noexcept {
+  const auto nowTick = tickOf(Clock::now());
+  // Visit every bucket whose turn came up since the last firing; after
+  // a full revolution each bucket was already seen once.
+  const auto steps = std::min<uint64_t>(nowTick - lastTick_, kNumBuckets);
+  for (uint64_t i = 1; i <= steps; ++i) {
+    auto& bucket = buckets_[(lastTick_ + i) & (kNumBuckets - 1)];
+    auto it = bucket.begin();
+    while (it != bucket.end()) {
+      auto& req = *it;
+      ++it;
+      if (req.timeoutWheelTick_ <= nowTick) {
+        req.timeoutWheelHook_.unlink();
+        req.timedOut();
+      }
+    }
+  }
+  lastTick_ = nowTick;
+  if (!empty()) {
+    folly::AsyncTimeout::scheduleTimeout(kTick.count());
+  }
+}
+
+}} // facebook::memcache
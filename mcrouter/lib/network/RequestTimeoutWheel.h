@@ -0,0 +1,62 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <chrono>
+
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBase.h>
+
+#include "mcrouter/lib/network/McClientRequestContext.h"
+
+namespace facebook { namespace memcache {
+
+/**
+ * Hashed timer wheel for request timeouts.
+ *
+ * Request timeouts are overwhelmingly cancelled early by fast replies,
+ * so arming one timer per in-flight request pays timer bookkeeping for
+ * timeouts that almost never fire. The wheel makes arming an intrusive
+ * list splice and cancelling an unlink, at the cost of firing on a
+ * coarse tick. One tick timer per client drives the whole wheel, and it
+ * runs only while at least one request is armed.
+ *
+ * May only be used from the event base thread.
+ */
+class RequestTimeoutWheel : private folly::AsyncTimeout {
+ public:
+  explicit RequestTimeoutWheel(folly::EventBase& eventBase);
+
+  /**
+   * Arm the request's wait timeout; no-op unless the request is waiting
+   * for a reply. There is no explicit cancel: the entry unlinks itself
+   * when the request leaves the pending reply state.
+   */
+  void scheduleTimeout(McClientRequestContextBase& req);
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // Wheel geometry: with a 10ms tick and 256 buckets one revolution
+  // covers 2.56s. Deadlines further out than that stay linked and get
+  // skipped until their tick comes around again.
+  static constexpr std::chrono::milliseconds kTick{10};
+  static constexpr size_t kNumBuckets = 256; // must be a power of two
+
+  McClientRequestContextBase::TimeoutWheelList buckets_[kNumBuckets];
+  uint64_t lastTick_;
+
+  static uint64_t tickOf(Clock::time_point tp);
+  bool empty() const;
+
+  void timeoutExpired() noexcept override final;
+};
+
+}} // facebook::memcache
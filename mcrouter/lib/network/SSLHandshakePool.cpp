@@ -0,0 +1,107 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "SSLHandshakePool.h"
+
+#include <cassert>
+
+#include <glog/logging.h>
+
+#include <folly/io/async/SSLContext.h>
+#include <folly/Memory.h>
+
+namespace facebook { namespace memcache {
+
+namespace {
+/* Bound on how long a client may take to complete its handshake */
+constexpr uint32_t kHandshakeTimeoutMs = 8000;
+} // anonymous
+
+class SSLHandshakePool::Handshake : public folly::AsyncSSLSocket::HandshakeCB {
+ public:
+  Handshake(folly::AsyncSSLSocket::UniquePtr socket,
+            folly::EventBase& destEvb,
+            OnHandshakeSuccess onSuccess)
+      : socket_(std::move(socket)),
+        destEvb_(destEvb),
+        onSuccess_(std::move(onSuccess)) {}
+
+  void start() {
+    socket_->sslAccept(this, kHandshakeTimeoutMs);
+  }
+
+  void handshakeSuc(folly::AsyncSSLSocket*) noexcept override final {
+    auto socket = std::move(socket_);
+    auto& destEvb = destEvb_;
+    auto onSuccess = std::move(onSuccess_);
+    delete this;
+
+    assert(socket->isDetachable());
+    socket->detachEventBase();
+    /* std::function must be copyable, so hand the socket over raw;
+       the lambda re-wraps it and on an abandoned run (destination loop
+       already gone) the event base destructor reclaims it */
+    auto rawSocket = socket.release();
+    destEvb.runInEventBaseThread([rawSocket, onSuccess]() mutable {
+      onSuccess(folly::AsyncSocket::UniquePtr(rawSocket));
+    });
+  }
+
+  void handshakeErr(
+      folly::AsyncSSLSocket*,
+      const folly::AsyncSocketException& ex) noexcept override final {
+    VLOG(1) << "SSL handshake failure: " << ex.what();
+    /* Destroying the socket closes the connection */
+    delete this;
+  }
+
+ private:
+  folly::AsyncSSLSocket::UniquePtr socket_;
+  folly::EventBase& destEvb_;
+  OnHandshakeSuccess onSuccess_;
+};
+
+SSLHandshakePool::SSLHandshakePool(size_t numThreads) {
+  assert(numThreads > 0);
+  evbs_.reserve(numThreads);
+  threads_.reserve(numThreads);
+  for (size_t i = 0; i < numThreads; ++i) {
+    evbs_.push_back(folly::make_unique<folly::EventBase>());
+    auto evb = evbs_.back().get();
+    threads_.emplace_back([evb]() { evb->loopForever(); });
+  }
+}
+
+SSLHandshakePool::~SSLHandshakePool() {
+  for (auto& evb : evbs_) {
+    evb->terminateLoopSoon();
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void SSLHandshakePool::startHandshake(
+    int fd,
+    std::shared_ptr<folly::SSLContext> sslCtx,
+    folly::EventBase& destEvb,
+    OnHandshakeSuccess onSuccess) {
+  auto& evb =
+    *evbs_[nextThread_.fetch_add(1, std::memory_order_relaxed) % evbs_.size()];
+  evb.runInEventBaseThread(
+      [&evb, fd, sslCtx, &destEvb, onSuccess]() mutable {
+        folly::AsyncSSLSocket::UniquePtr socket(new folly::AsyncSSLSocket(
+            sslCtx, &evb, fd, /* server = */ true));
+        auto handshake =
+          new Handshake(std::move(socket), destEvb, std::move(onSuccess));
+        handshake->start();
+      });
+}
+
+}} // facebook::memcache
@@ -0,0 +1,71 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/io/async/AsyncSSLSocket.h>
+#include <folly/io/async/EventBase.h>
+
+namespace folly {
+class SSLContext;
+} // folly
+
+namespace facebook { namespace memcache {
+
+/**
+ * Pool of threads that run server-side TLS handshakes for accepted
+ * connections.
+ *
+ * Handshake crypto is orders of magnitude more expensive than serving a
+ * request, so running it inline on the worker event bases lets a client
+ * reconnect storm stall request processing for established connections.
+ * The pool completes the handshake on its own event bases and hands the
+ * established socket back to the owning worker, keeping crypto off the
+ * request-serving loops.
+ */
+class SSLHandshakePool {
+ public:
+  using OnHandshakeSuccess =
+    std::function<void(folly::AsyncSocket::UniquePtr)>;
+
+  explicit SSLHandshakePool(size_t numThreads);
+  ~SSLHandshakePool();
+
+  SSLHandshakePool(const SSLHandshakePool&) = delete;
+  SSLHandshakePool& operator=(const SSLHandshakePool&) = delete;
+
+  /**
+   * Run the server-side handshake for fd on one of the pool's threads;
+   * takes ownership of fd.  On success, onSuccess is run on destEvb with
+   * the established socket, detached and ready to be attached there.  On
+   * failure or timeout the connection is closed.
+   * May be called from any thread.
+   */
+  void startHandshake(int fd,
+                      std::shared_ptr<folly::SSLContext> sslCtx,
+                      folly::EventBase& destEvb,
+                      OnHandshakeSuccess onSuccess);
+
+ private:
+  /* Self-owning handshake state: deletes itself once the handshake
+     completes either way. */
+  class Handshake;
+
+  std::vector<std::unique_ptr<folly::EventBase>> evbs_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> nextThread_{0};
+};
+
+}} // facebook::memcache
@@ -19,14 +19,17 @@ ServerMcParser<Callback>::ServerMcParser(
     Callback& cb,
     size_t minBufferSize,
     size_t maxBufferSize,
+    bool useJemallocNodumpAllocator,
     ConnectionFifo* debugFifo)
     : parser_(
           *this,
           minBufferSize,
           maxBufferSize,
-          /* useJemallocNodumpAllocator */ false,
+          useJemallocNodumpAllocator,
           debugFifo),
+#ifndef MCROUTER_CARET_ONLY
       asciiParser_(*this),
+#endif
       callback_(cb),
       debugFifo_(debugFifo) {}
 
@@ -36,21 +39,23 @@ ServerMcParser<Callback>::~ServerMcParser() {
 
 template <class Callback>
 std::pair<void*, size_t> ServerMcParser<Callback>::getReadBuffer() {
+#ifndef MCROUTER_CARET_ONLY
   if (shouldReadToAsciiBuffer()) {
     return asciiParser_.getReadBuffer();
-  } else {
-    return parser_.getReadBuffer();
   }
+#endif
+  return parser_.getReadBuffer();
 }
 
 template <class Callback>
 bool ServerMcParser<Callback>::readDataAvailable(size_t len) {
+#ifndef MCROUTER_CARET_ONLY
   if (shouldReadToAsciiBuffer()) {
     asciiParser_.readDataAvailable(len);
     return true;
-  } else {
-    return parser_.readDataAvailable(len);
   }
+#endif
+  return parser_.readDataAvailable(len);
 }
 
 template <class Callback>
@@ -63,6 +68,11 @@ void ServerMcParser<Callback>::requestReadyHelper(
 template <class Callback>
 bool ServerMcParser<Callback>::umMessageReady(const UmbrellaMessageInfo& info,
                                               const folly::IOBuf& buffer) {
+#ifdef MCROUTER_CARET_ONLY
+  callback_.parseError(
+      mc_res_remote_error, "Umbrella protocol support is compiled out");
+  return false;
+#else
   try {
     uint64_t reqid;
     const mc_op_t op = umbrellaDetermineOperation(
@@ -99,6 +109,7 @@ bool ServerMcParser<Callback>::umMessageReady(const UmbrellaMessageInfo& info,
     return false;
   }
   return true;
+#endif
 }
 
 template <class Callback>
@@ -119,6 +130,10 @@ bool ServerMcParser<Callback>::caretMessageReady(
 
 template <class Callback>
 void ServerMcParser<Callback>::handleAscii(folly::IOBuf& readBuffer) {
+#ifdef MCROUTER_CARET_ONLY
+  callback_.parseError(
+      mc_res_local_error, "Ascii protocol support is compiled out");
+#else
   if (UNLIKELY(parser_.protocol() != mc_ascii_protocol)) {
     std::string reason(
       folly::sformat("Expected {} protocol, but received ASCII!",
@@ -135,6 +150,7 @@ void ServerMcParser<Callback>::handleAscii(folly::IOBuf& readBuffer) {
     // "malformed request" (e.g. asciiParser_.getErrorDescription()).
     callback_.parseError(mc_res_client_error, "malformed request");
   }
+#endif
 }
 
 template <class Callback>
@@ -143,11 +159,13 @@ void ServerMcParser<Callback>::parseError(mc_res_t result,
   callback_.parseError(result, reason);
 }
 
+#ifndef MCROUTER_CARET_ONLY
 template <class Callback>
 bool ServerMcParser<Callback>::shouldReadToAsciiBuffer() const {
   return parser_.protocol() == mc_ascii_protocol &&
          asciiParser_.hasReadBuffer();
 }
+#endif
 
 template <class Callback>
 template <class Request>
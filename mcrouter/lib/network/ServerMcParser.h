@@ -10,7 +10,9 @@
 #pragma once
 
 #include "mcrouter/lib/network/AsciiSerialized.h"
+#ifndef MCROUTER_CARET_ONLY
 #include "mcrouter/lib/network/McAsciiParser.h"
+#endif
 #include "mcrouter/lib/network/McParser.h"
 
 namespace facebook { namespace memcache {
@@ -24,6 +26,7 @@ class ServerMcParser : private McParser::ParserCallback {
       Callback& cb,
       size_t minBufferSize,
       size_t maxBufferSize,
+      bool useJemallocNodumpAllocator = false,
       ConnectionFifo* debugFifo = nullptr);
 
   ~ServerMcParser();
@@ -53,16 +56,26 @@ class ServerMcParser : private McParser::ParserCallback {
     return parser_.outOfOrder();
   }
 
+  bool hasUnparsedData() const {
+    return parser_.hasUnparsedData();
+  }
+
   /**
    * @return error message from ascii parser about parsing error.
    */
   folly::StringPiece getUnderlyingAsciiParserError() const {
+#ifdef MCROUTER_CARET_ONLY
+    return "";
+#else
     return asciiParser_.getErrorDescription();
+#endif
   }
 
  private:
   McParser parser_;
+#ifndef MCROUTER_CARET_ONLY
   McServerAsciiParser asciiParser_;
+#endif
 
   Callback& callback_;
 
@@ -81,7 +94,9 @@ class ServerMcParser : private McParser::ParserCallback {
                          const folly::IOBuf& buffer) override final;
   void handleAscii(folly::IOBuf& readBuffer) override final;
   void parseError(mc_res_t result, folly::StringPiece reason) override final;
+#ifndef MCROUTER_CARET_ONLY
   bool shouldReadToAsciiBuffer() const;
+#endif
 
   // McServerAsciiParser callbacks
   template <class Request>
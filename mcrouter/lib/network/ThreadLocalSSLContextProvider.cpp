@@ -9,8 +9,26 @@
  */
 #include "ThreadLocalSSLContextProvider.h"
 
+#include <cstring>
+#include <mutex>
 #include <unordered_map>
 
+#ifdef MCROUTER_HAVE_KTLS
+#include <linux/tls.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <openssl/hmac.h>
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#endif
+
 #include <folly/io/async/SSLContext.h>
 #include <wangle/ssl/TLSTicketKeyManager.h>
 
@@ -25,6 +43,122 @@ namespace {
 /* Sessions are valid for upto 30 mins */
 constexpr size_t kSessionLifeTime = 1800;
 
+/**
+ * Process-wide external SSL session cache, shared by the per-thread
+ * SSL contexts of all server workers.  A client that reconnects and
+ * lands on a different worker can still resume by session id instead
+ * of paying a full handshake.  Sharded by session id to keep lock
+ * contention negligible on the accept path.
+ */
+class SharedSessionCache {
+ public:
+  static SharedSessionCache& instance() {
+    static SharedSessionCache cache;
+    return cache;
+  }
+
+  void store(const unsigned char* id, size_t idLen, SSL_SESSION* session) {
+    int len = i2d_SSL_SESSION(session, nullptr);
+    if (len <= 0) {
+      return;
+    }
+    std::string der(len, '\0');
+    auto out = reinterpret_cast<unsigned char*>(&der[0]);
+    if (i2d_SSL_SESSION(session, &out) != len) {
+      return;
+    }
+    auto& shard = getShard(id, idLen);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    if (shard.sessions.size() >= kMaxSessionsPerShard &&
+        shard.sessions.find(std::string(
+            reinterpret_cast<const char*>(id), idLen)) ==
+            shard.sessions.end()) {
+      /* Cheap bound: drop an arbitrary entry */
+      shard.sessions.erase(shard.sessions.begin());
+    }
+    shard.sessions[std::string(reinterpret_cast<const char*>(id), idLen)] =
+        Entry{std::move(der), std::chrono::steady_clock::now()};
+  }
+
+  SSL_SESSION* lookup(const unsigned char* id, size_t idLen) {
+    std::string der;
+    {
+      auto& shard = getShard(id, idLen);
+      std::lock_guard<std::mutex> guard(shard.lock);
+      auto it = shard.sessions.find(
+          std::string(reinterpret_cast<const char*>(id), idLen));
+      if (it == shard.sessions.end()) {
+        return nullptr;
+      }
+      if (std::chrono::steady_clock::now() - it->second.createdAt >
+          std::chrono::seconds(kSessionLifeTime)) {
+        shard.sessions.erase(it);
+        return nullptr;
+      }
+      der = it->second.der;
+    }
+    auto in = reinterpret_cast<const unsigned char*>(der.data());
+    return d2i_SSL_SESSION(nullptr, &in, der.size());
+  }
+
+  void remove(const unsigned char* id, size_t idLen) {
+    auto& shard = getShard(id, idLen);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    shard.sessions.erase(
+        std::string(reinterpret_cast<const char*>(id), idLen));
+  }
+
+ private:
+  constexpr static size_t kNumShards = 16;
+  constexpr static size_t kMaxSessionsPerShard = 16 * 1024;
+
+  struct Entry {
+    std::string der;
+    std::chrono::time_point<std::chrono::steady_clock> createdAt;
+  };
+
+  struct Shard {
+    std::mutex lock;
+    std::unordered_map<std::string, Entry> sessions;
+  };
+
+  Shard shards_[kNumShards];
+
+  Shard& getShard(const unsigned char* id, size_t idLen) {
+    size_t hash = 5381;
+    for (size_t i = 0; i < idLen; ++i) {
+      hash = hash * 33 + id[i];
+    }
+    return shards_[hash % kNumShards];
+  }
+};
+
+int sharedCacheNewSessionCallback(SSL* /* ssl */, SSL_SESSION* session) {
+  SharedSessionCache::instance().store(
+      session->session_id, session->session_id_length, session);
+  /* We serialized our own copy; no reference taken */
+  return 0;
+}
+
+void sharedCacheRemoveSessionCallback(
+    SSL_CTX* /* ctx */,
+    SSL_SESSION* session) {
+  SharedSessionCache::instance().remove(
+      session->session_id, session->session_id_length);
+}
+
+SSL_SESSION* sharedCacheGetSessionCallback(
+    SSL* /* ssl */,
+    unsigned char* id,
+    int idLen,
+    int* copy) {
+  *copy = 0;
+  if (idLen <= 0) {
+    return nullptr;
+  }
+  return SharedSessionCache::instance().lookup(id, idLen);
+}
+
 struct CertPaths {
   folly::StringPiece pemCertPath;
   folly::StringPiece pemKeyPath;
@@ -180,6 +314,18 @@ std::shared_ptr<SSLContext> getSSLContext(folly::StringPiece pemCertPath,
       contextInfo.context->setSessionCacheContext("async-server");
       SSL_CTX_set_timeout(contextInfo.context->getSSLCtx(), kSessionLifeTime);
 
+      /* Replace the per-context internal session cache with the shared
+         process-wide one, so session-id resumption works regardless of
+         which worker the client reconnects to.  Ticket resumption is
+         already worker-independent since all contexts use the same
+         ticket key seeds. */
+      auto rawCtx = contextInfo.context->getSSLCtx();
+      SSL_CTX_set_session_cache_mode(
+          rawCtx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+      SSL_CTX_sess_set_new_cb(rawCtx, sharedCacheNewSessionCallback);
+      SSL_CTX_sess_set_get_cb(rawCtx, sharedCacheGetSessionCallback);
+      SSL_CTX_sess_set_remove_cb(rawCtx, sharedCacheRemoveSessionCallback);
+
       #ifdef SSL_CTRL_SET_TLSEXT_TICKET_KEY_CB
       auto mgr = folly::make_unique<wangle::TLSTicketKeyManager>(
           contextInfo.context.get(), nullptr);
@@ -197,4 +343,149 @@ std::shared_ptr<SSLContext> getSSLContext(folly::StringPiece pemCertPath,
   return contextInfo.context;
 }
 
+#if defined(MCROUTER_HAVE_KTLS) && defined(TLS_RX) && \
+    OPENSSL_VERSION_NUMBER < 0x10100000L
+
+namespace {
+
+/* TLS 1.2 PRF with P_SHA256 (RFC 5246 section 5) */
+bool tls12PrfSha256(
+    const uint8_t* secret,
+    size_t secretLen,
+    const uint8_t* seed,
+    size_t seedLen,
+    uint8_t* out,
+    size_t outLen) {
+  uint8_t a[SHA256_DIGEST_LENGTH];
+  unsigned int aLen = 0;
+  if (HMAC(EVP_sha256(), secret, secretLen, seed, seedLen, a, &aLen) ==
+      nullptr) {
+    return false;
+  }
+
+  size_t produced = 0;
+  while (produced < outLen) {
+    HMAC_CTX ctx;
+    HMAC_CTX_init(&ctx);
+    uint8_t block[SHA256_DIGEST_LENGTH];
+    unsigned int blockLen = 0;
+    const bool ok =
+        HMAC_Init_ex(&ctx, secret, secretLen, EVP_sha256(), nullptr) &&
+        HMAC_Update(&ctx, a, aLen) &&
+        HMAC_Update(&ctx, seed, seedLen) &&
+        HMAC_Final(&ctx, block, &blockLen);
+    HMAC_CTX_cleanup(&ctx);
+    if (!ok) {
+      return false;
+    }
+    const auto n = std::min<size_t>(blockLen, outLen - produced);
+    memcpy(out + produced, block, n);
+    produced += n;
+
+    /* A(i+1) = HMAC(secret, A(i)) */
+    if (HMAC(EVP_sha256(), secret, secretLen, a, aLen, a, &aLen) == nullptr) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+bool enableKernelTls(SSL* ssl, int fd) {
+  if (ssl == nullptr || fd < 0 || ssl->s3 == nullptr ||
+      ssl->session == nullptr) {
+    return false;
+  }
+  if (SSL_version(ssl) != TLS1_2_VERSION) {
+    return false;
+  }
+  auto cipher = SSL_get_current_cipher(ssl);
+  if (cipher == nullptr) {
+    return false;
+  }
+  const char* cipherName = SSL_CIPHER_get_name(cipher);
+  if (cipherName == nullptr ||
+      strstr(cipherName, "AES128-GCM-SHA256") == nullptr) {
+    return false;
+  }
+  if (SSL_pending(ssl) > 0) {
+    /* Records already decrypted in userspace would be lost */
+    return false;
+  }
+
+  /* Re-derive the key block from the master secret (RFC 5246 6.3).
+     For AES128-GCM there are no MAC keys:
+       client_write_key[16] server_write_key[16]
+       client_write_IV[4]   server_write_IV[4] */
+  constexpr size_t kKeyLen = 16;
+  constexpr size_t kSaltLen = 4;
+  constexpr char kLabel[] = "key expansion";
+  uint8_t seed[sizeof(kLabel) - 1 + 2 * SSL3_RANDOM_SIZE];
+  memcpy(seed, kLabel, sizeof(kLabel) - 1);
+  memcpy(seed + sizeof(kLabel) - 1, ssl->s3->server_random, SSL3_RANDOM_SIZE);
+  memcpy(seed + sizeof(kLabel) - 1 + SSL3_RANDOM_SIZE,
+         ssl->s3->client_random, SSL3_RANDOM_SIZE);
+
+  uint8_t keyBlock[2 * kKeyLen + 2 * kSaltLen];
+  if (!tls12PrfSha256(
+          ssl->session->master_key,
+          ssl->session->master_key_length,
+          seed,
+          sizeof(seed),
+          keyBlock,
+          sizeof(keyBlock))) {
+    return false;
+  }
+  const uint8_t* clientKey = keyBlock;
+  const uint8_t* serverKey = keyBlock + kKeyLen;
+  const uint8_t* clientSalt = keyBlock + 2 * kKeyLen;
+  const uint8_t* serverSalt = keyBlock + 2 * kKeyLen + kSaltLen;
+
+  if (setsockopt(fd, IPPROTO_TCP, TCP_ULP, "tls", 3) != 0) {
+    /* Kernel without the tls ULP */
+    return false;
+  }
+
+  struct tls12_crypto_info_aes_gcm_128 tx;
+  memset(&tx, 0, sizeof(tx));
+  tx.info.version = TLS_1_2_VERSION;
+  tx.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+  memcpy(tx.key, serverKey, kKeyLen);
+  memcpy(tx.salt, serverSalt, kSaltLen);
+  memcpy(tx.rec_seq, ssl->s3->write_sequence, sizeof(tx.rec_seq));
+  memcpy(tx.iv, ssl->s3->write_sequence, sizeof(tx.iv));
+
+  struct tls12_crypto_info_aes_gcm_128 rx;
+  memset(&rx, 0, sizeof(rx));
+  rx.info.version = TLS_1_2_VERSION;
+  rx.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+  memcpy(rx.key, clientKey, kKeyLen);
+  memcpy(rx.salt, clientSalt, kSaltLen);
+  memcpy(rx.rec_seq, ssl->s3->read_sequence, sizeof(rx.rec_seq));
+  memcpy(rx.iv, ssl->s3->read_sequence, sizeof(rx.iv));
+
+  if (setsockopt(fd, SOL_TLS, TLS_TX, &tx, sizeof(tx)) != 0) {
+    return false;
+  }
+  if (setsockopt(fd, SOL_TLS, TLS_RX, &rx, sizeof(rx)) != 0) {
+    /* TX crypto state is already installed, so this connection can no
+       longer fall back to userspace TLS; the first failed read tears
+       it down and the client reconnects.  Only happens on kernels with
+       TX-only kTLS. */
+    LOG_FAILURE("SSLCert", failure::Category::kSystemError,
+                "kTLS: TLS_RX rejected after TLS_TX was installed");
+    return false;
+  }
+  return true;
+}
+
+#else
+
+bool enableKernelTls(SSL* /* ssl */, int /* fd */) {
+  return false;
+}
+
+#endif
+
 }}  // facebook::memcache
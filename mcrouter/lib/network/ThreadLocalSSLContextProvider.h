@@ -11,6 +11,8 @@
 
 #include <folly/Range.h>
 
+#include <openssl/ssl.h>
+
 namespace folly {
 class SSLContext;
 } // folly
@@ -27,4 +29,19 @@ std::shared_ptr<folly::SSLContext> getSSLContext(
   folly::StringPiece pemKeyPath,
   folly::StringPiece pemCaPath);
 
+/**
+ * Move record encryption of an established TLS session into the kernel
+ * (kTLS), installing both TX and RX crypto state on the socket so that
+ * subsequent plain read()/writev() calls on the fd operate on cleartext.
+ *
+ * Only supported for TLS 1.2 AES128-GCM sessions on kernels with the
+ * "tls" ULP; the write/read keys are re-derived from the session master
+ * secret and handshake randoms, and in-flight record sequence numbers
+ * are carried over.
+ *
+ * @return true on success; on failure the socket is left untouched and
+ *         userspace TLS keeps working.
+ */
+bool enableKernelTls(SSL* ssl, int fd);
+
 }}  // facebook::memcache
@@ -33,6 +33,7 @@ struct CallDispatcherImplExpanded;
 /* Contains a single array that maps Ids to processMsg calls */
 template <class... Ms, size_t MaxId, class Proc, class... Args>
 struct CallDispatcherImplExpanded<List<Ms...>, MaxId, Proc, Args...> {
+  static constexpr size_t kMaxId = MaxId;
   static constexpr DispatchFunc<Proc, Args...> array_[MaxId + 1] = {
       DispatchImpl<Ms, Proc, Args...>::func...};
 };
@@ -12,6 +12,8 @@
 #include <cstddef>
 #include <utility>
 
+#include <folly/Likely.h>
+
 #include "mcrouter/lib/fbi/cpp/TypeList.h"
 
 namespace facebook { namespace memcache {
@@ -66,6 +68,10 @@ class CallDispatcher {
    * @return true iff id is the typeId of a message in MessageList
    */
   bool dispatch(size_t id, Proc& proc, Args... args) {
+    /* ids come off the wire; anything past the table is unknown */
+    if (UNLIKELY(id > impl_.kMaxId)) {
+      return false;
+    }
     auto& f = impl_.array_[id];
     if (f == nullptr) {
       return false;
@@ -0,0 +1,307 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "UdpClientTransport.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace facebook { namespace memcache {
+
+namespace {
+
+/* Memcached UDP frame header, all fields big-endian */
+constexpr size_t kUdpHeaderSize = 8;
+
+/* Hard cap on a single outgoing datagram; requests that serialize
+   larger than this can't be sent over UDP at all */
+constexpr size_t kMaxDatagramSize = 64 * 1024 - 1;
+
+/* Replies we're willing to reassemble at once; memcached fragments at
+   ~1400 bytes, so in-flight fragments are bounded by in-flight gets */
+constexpr size_t kMaxReassemblies = 32;
+
+/* Big enough for any reply fragment the server will send */
+constexpr size_t kReadBufferSize = 2048;
+
+/* Frame header plus the most iovecs one serialized request produces
+   (McSerializedRequest::kMaxIovs) */
+constexpr size_t kMaxWriteIovecs = 32;
+
+} // anonymous namespace
+
+UdpClientTransport::UdpClientTransport(
+    folly::EventBase& evb,
+    const folly::SocketAddress& dest)
+    : folly::EventHandler(&evb),
+      eventBase_(evb),
+      peer_(dest) {
+  fd_ = ::socket(dest.getFamily(), SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if (fd_ < 0) {
+    throw std::runtime_error("Failed to create UDP socket");
+  }
+
+  sockaddr_storage addr;
+  const auto addrLen = dest.getAddress(&addr);
+  if (::connect(fd_, reinterpret_cast<sockaddr*>(&addr), addrLen) != 0) {
+    ::close(fd_);
+    fd_ = -1;
+    throw std::runtime_error("Failed to connect UDP socket");
+  }
+
+  changeHandlerFD(fd_);
+}
+
+UdpClientTransport::~UdpClientTransport() {
+  unregisterHandler();
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+void UdpClientTransport::setReadCB(ReadCallback* callback) {
+  if (readCallback_ == callback) {
+    return;
+  }
+  readCallback_ = callback;
+  if (callback != nullptr) {
+    registerHandler(EV_READ | EV_PERSIST);
+  } else {
+    unregisterHandler();
+  }
+}
+
+void UdpClientTransport::writeRequest(
+    WriteCallback* callback,
+    uint16_t reqid,
+    const iovec* iovs,
+    size_t count) {
+  if (!good()) {
+    if (callback != nullptr) {
+      callback->writeErr(
+          0,
+          folly::AsyncSocketException(
+              folly::AsyncSocketException::NOT_OPEN,
+              "UDP socket is closed"));
+    }
+    return;
+  }
+
+  size_t total = 0;
+  for (size_t i = 0; i < count; ++i) {
+    total += iovs[i].iov_len;
+  }
+  if (count >= kMaxWriteIovecs ||
+      total > kMaxDatagramSize - kUdpHeaderSize) {
+    if (callback != nullptr) {
+      callback->writeErr(
+          0,
+          folly::AsyncSocketException(
+              folly::AsyncSocketException::BAD_ARGS,
+              "Request too large for a UDP datagram"));
+    }
+    return;
+  }
+
+  uint8_t header[kUdpHeaderSize];
+  header[0] = reqid >> 8;
+  header[1] = reqid & 0xff;
+  header[2] = 0; /* sequence number */
+  header[3] = 0;
+  header[4] = 0; /* datagram count */
+  header[5] = 1;
+  header[6] = 0;
+  header[7] = 0;
+
+  iovec out[kMaxWriteIovecs];
+  out[0].iov_base = header;
+  out[0].iov_len = kUdpHeaderSize;
+  std::copy(iovs, iovs + count, out + 1);
+
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = out;
+  msg.msg_iovlen = 1 + count;
+  const auto sent = ::sendmsg(fd_, &msg, 0);
+  if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+      errno != ENOBUFS) {
+    if (callback != nullptr) {
+      callback->writeErr(
+          0,
+          folly::AsyncSocketException(
+              folly::AsyncSocketException::INTERNAL_ERROR,
+              "UDP send failed",
+              errno));
+    }
+    return;
+  }
+
+  /* A datagram the kernel dropped for lack of buffers looks exactly
+     like network loss: report success and let the request time out */
+  appBytesWritten_ += total;
+  if (callback != nullptr) {
+    callback->writeSuccess();
+  }
+}
+
+void UdpClientTransport::write(
+    WriteCallback* callback,
+    const void* /* buf */,
+    size_t /* bytes */,
+    folly::WriteFlags /* flags */) {
+  /* Plain writes have no request id to stamp; only writeRequest() makes
+     sense on this transport */
+  if (callback != nullptr) {
+    callback->writeErr(
+        0,
+        folly::AsyncSocketException(
+            folly::AsyncSocketException::NOT_SUPPORTED,
+            "Raw writes are not supported over UDP"));
+  }
+}
+
+void UdpClientTransport::writev(
+    WriteCallback* callback,
+    const iovec* /* iovs */,
+    size_t /* count */,
+    folly::WriteFlags /* flags */) {
+  write(callback, nullptr, 0);
+}
+
+void UdpClientTransport::writeChain(
+    WriteCallback* callback,
+    std::unique_ptr<folly::IOBuf>&& /* buf */,
+    folly::WriteFlags /* flags */) {
+  write(callback, nullptr, 0);
+}
+
+void UdpClientTransport::close() {
+  closed_ = true;
+  unregisterHandler();
+}
+
+void UdpClientTransport::closeNow() {
+  close();
+}
+
+void UdpClientTransport::shutdownWrite() {
+  closed_ = true;
+}
+
+void UdpClientTransport::shutdownWriteNow() {
+  closed_ = true;
+}
+
+void UdpClientTransport::getLocalAddress(folly::SocketAddress* address) const {
+  if (fd_ >= 0) {
+    address->setFromLocalAddress(fd_);
+  } else {
+    *address = folly::SocketAddress();
+  }
+}
+
+void UdpClientTransport::handlerReady(uint16_t) noexcept {
+  DestructorGuard dg(this);
+
+  uint8_t buf[kReadBufferSize];
+  while (readCallback_ != nullptr && !closed_) {
+    const auto received = ::recv(fd_, buf, sizeof(buf), 0);
+    if (received < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return;
+      }
+      /* E.g. ICMP port unreachable bounced back; nothing to deliver,
+         the outstanding requests will time out */
+      continue;
+    }
+    processDatagram(buf, received);
+  }
+}
+
+void UdpClientTransport::processDatagram(const uint8_t* data, size_t len) {
+  if (len < kUdpHeaderSize) {
+    return;
+  }
+  const uint16_t reqid = (data[0] << 8) | data[1];
+  const uint16_t seq = (data[2] << 8) | data[3];
+  const uint16_t total = (data[4] << 8) | data[5];
+  if (total <= 1) {
+    if (seq == 0) {
+      deliverReply(reqid, data + kUdpHeaderSize, len - kUdpHeaderSize);
+    }
+    return;
+  }
+
+  if (seq >= total) {
+    return;
+  }
+  auto it = reassembly_.find(reqid);
+  if (it == reassembly_.end()) {
+    if (reassembly_.size() >= kMaxReassemblies) {
+      /* Partial replies this stale will never complete anyway */
+      reassembly_.clear();
+    }
+    it = reassembly_.emplace(reqid, Reassembly()).first;
+    it->second.pieces.resize(total);
+  } else if (it->second.pieces.size() != total) {
+    /* The 16-bit id wrapped onto a half-assembled reply; start over */
+    it->second = Reassembly();
+    it->second.pieces.resize(total);
+  }
+
+  auto& entry = it->second;
+  if (entry.pieces[seq].empty()) {
+    ++entry.received;
+  }
+  entry.pieces[seq].assign(
+      reinterpret_cast<const char*>(data + kUdpHeaderSize),
+      len - kUdpHeaderSize);
+  if (entry.received < total) {
+    return;
+  }
+
+  std::string payload;
+  for (const auto& piece : entry.pieces) {
+    payload += piece;
+  }
+  reassembly_.erase(it);
+  deliverReply(
+      reqid,
+      reinterpret_cast<const uint8_t*>(payload.data()),
+      payload.size());
+}
+
+void UdpClientTransport::deliverReply(
+    uint16_t reqid,
+    const uint8_t* data,
+    size_t len) {
+  currentRequestId_ = reqid;
+  ++repliesDelivered_;
+
+  appBytesReceived_ += len;
+  size_t offset = 0;
+  while (readCallback_ != nullptr && offset < len) {
+    void* buf;
+    size_t bufLen;
+    readCallback_->getReadBuffer(&buf, &bufLen);
+    if (buf == nullptr || bufLen == 0) {
+      return;
+    }
+    const auto n = std::min(bufLen, len - offset);
+    memcpy(buf, data + offset, n);
+    offset += n;
+    readCallback_->readDataAvailable(n);
+  }
+}
+
+}}  // facebook::memcache
@@ -0,0 +1,181 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/SocketAddress.h>
+#include <folly/io/async/AsyncTransport.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventHandler.h>
+
+namespace facebook { namespace memcache {
+
+/**
+ * Client-side transport speaking the memcached UDP protocol (8 byte
+ * frame header: request id, sequence number, datagram count, reserved;
+ * all big-endian) over a connected UDP socket.
+ *
+ * Each writeRequest() call becomes exactly one datagram carrying one
+ * serialized request, stamped with the low 16 bits of the request id.
+ * The server echoes that id back, so replies can be matched out of
+ * order; multi-datagram replies are reassembled before delivery.  While
+ * a reply is being fed to the installed ReadCallback, currentRequestId()
+ * exposes the id from its frame header, and repliesDelivered() ticks
+ * once per reply so the callback can tell reply boundaries apart.
+ *
+ * There are no delivery guarantees: a dropped request or reply datagram
+ * simply surfaces as the request's timeout, which is why this transport
+ * is meant for small idempotent requests that the routing layer retries
+ * anyway.
+ */
+class UdpClientTransport : public folly::AsyncTransportWrapper,
+                           private folly::EventHandler {
+ public:
+  /**
+   * Creates a connected nonblocking UDP socket to `dest` and registers
+   * with the event base.
+   *
+   * @throws std::runtime_error on socket/connect failure.
+   */
+  UdpClientTransport(folly::EventBase& evb, const folly::SocketAddress& dest);
+
+  /**
+   * Sends one serialized request as a single framed datagram.
+   *
+   * The iovecs are consumed synchronously: the write callback (success
+   * or error) is invoked before this call returns, so the caller's
+   * buffers may live on the stack.  A send the kernel refuses with a
+   * transient error is reported as success -- on UDP it is
+   * indistinguishable from network loss and the request will time out.
+   */
+  void writeRequest(
+      WriteCallback* callback,
+      uint16_t reqid,
+      const iovec* iovs,
+      size_t count);
+
+  /**
+   * Frame id of the reply currently being delivered to the read
+   * callback; valid only during delivery.
+   */
+  uint16_t currentRequestId() const {
+    return currentRequestId_;
+  }
+
+  /**
+   * Total replies delivered (or started delivering) so far; increments
+   * before each reply's first readDataAvailable() call.
+   */
+  uint64_t repliesDelivered() const {
+    return repliesDelivered_;
+  }
+
+  /* AsyncTransportWrapper */
+  void setReadCB(ReadCallback* callback) override;
+  ReadCallback* getReadCallback() const override {
+    return readCallback_;
+  }
+  void write(
+      WriteCallback* callback,
+      const void* buf,
+      size_t bytes,
+      folly::WriteFlags flags = folly::WriteFlags::NONE) override;
+  void writev(
+      WriteCallback* callback,
+      const iovec* iovs,
+      size_t count,
+      folly::WriteFlags flags = folly::WriteFlags::NONE) override;
+  void writeChain(
+      WriteCallback* callback,
+      std::unique_ptr<folly::IOBuf>&& buf,
+      folly::WriteFlags flags = folly::WriteFlags::NONE) override;
+
+  /* AsyncTransport */
+  void close() override;
+  void closeNow() override;
+  void shutdownWrite() override;
+  void shutdownWriteNow() override;
+  bool good() const override {
+    return fd_ >= 0 && !closed_;
+  }
+  bool readable() const override {
+    return good();
+  }
+  bool connecting() const override {
+    return false;
+  }
+  bool error() const override {
+    return false;
+  }
+  void attachEventBase(folly::EventBase* eventBase) override {}
+  void detachEventBase() override {}
+  bool isDetachable() const override {
+    return false;
+  }
+  folly::EventBase* getEventBase() const override {
+    return &eventBase_;
+  }
+  void setSendTimeout(uint32_t milliseconds) override {}
+  uint32_t getSendTimeout() const override {
+    return 0;
+  }
+  void getLocalAddress(folly::SocketAddress* address) const override;
+  void getPeerAddress(folly::SocketAddress* address) const override {
+    *address = peer_;
+  }
+  bool isEorTrackingEnabled() const override {
+    return false;
+  }
+  void setEorTracking(bool track) override {}
+  size_t getAppBytesWritten() const override {
+    return appBytesWritten_;
+  }
+  size_t getRawBytesWritten() const override {
+    return appBytesWritten_;
+  }
+  size_t getAppBytesReceived() const override {
+    return appBytesReceived_;
+  }
+  size_t getRawBytesReceived() const override {
+    return appBytesReceived_;
+  }
+
+ private:
+  /* Multi-datagram reply being reassembled; pieces are indexed by the
+     sequence number from the frame header. */
+  struct Reassembly {
+    std::vector<std::string> pieces;
+    size_t received{0};
+  };
+
+  folly::EventBase& eventBase_;
+  folly::SocketAddress peer_;
+  ReadCallback* readCallback_{nullptr};
+  int fd_{-1};
+  bool closed_{false};
+
+  uint16_t currentRequestId_{0};
+  uint64_t repliesDelivered_{0};
+  size_t appBytesWritten_{0};
+  size_t appBytesReceived_{0};
+
+  std::unordered_map<uint16_t, Reassembly> reassembly_;
+
+  void handlerReady(uint16_t events) noexcept override final;
+  void processDatagram(const uint8_t* data, size_t len);
+  void deliverReply(uint16_t reqid, const uint8_t* data, size_t len);
+
+  ~UdpClientTransport() override;
+};
+
+}}  // facebook::memcache
@@ -0,0 +1,378 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "UdpListener.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "mcrouter/lib/network/AsyncMcServerWorker.h"
+
+namespace facebook { namespace memcache {
+
+namespace {
+
+/* Memcached UDP frame header, all fields big-endian */
+constexpr size_t kUdpHeaderSize = 8;
+
+/* Conservative bound keeping header + payload under typical MTU */
+constexpr size_t kMaxPayloadPerDatagram = 1400;
+
+/* Datagrams drained per recvmmsg() / sent per sendmmsg() call */
+constexpr size_t kIoBatchSize = 64;
+
+/* Enough for any reasonable request line */
+constexpr size_t kReadBufferSize = 2048;
+
+} // anonymous namespace
+
+UdpPeerTransport::UdpPeerTransport(
+    UdpListener* listener,
+    folly::EventBase& evb,
+    folly::SocketAddress peer)
+    : listener_(listener),
+      eventBase_(evb),
+      peer_(std::move(peer)) {
+}
+
+UdpPeerTransport::~UdpPeerTransport() {
+  if (listener_ != nullptr) {
+    listener_->removePeer(peer_);
+  }
+}
+
+void UdpPeerTransport::deliverPayload(const uint8_t* data, size_t len) {
+  DestructorGuard dg(this);
+
+  appBytesReceived_ += len;
+  size_t offset = 0;
+  while (readCallback_ != nullptr && offset < len) {
+    void* buf;
+    size_t bufLen;
+    readCallback_->getReadBuffer(&buf, &bufLen);
+    if (buf == nullptr || bufLen == 0) {
+      return;
+    }
+    const auto n = std::min(bufLen, len - offset);
+    memcpy(buf, data + offset, n);
+    offset += n;
+    readCallback_->readDataAvailable(n);
+  }
+}
+
+void UdpPeerTransport::write(
+    WriteCallback* callback,
+    const void* buf,
+    size_t bytes,
+    folly::WriteFlags flags) {
+  iovec iov;
+  iov.iov_base = const_cast<void*>(buf);
+  iov.iov_len = bytes;
+  writev(callback, &iov, 1, flags);
+}
+
+void UdpPeerTransport::writeChain(
+    WriteCallback* callback,
+    std::unique_ptr<folly::IOBuf>&& buf,
+    folly::WriteFlags flags) {
+  std::vector<iovec> iovs;
+  for (auto range = buf.get(); ;) {
+    if (range->length() > 0) {
+      iovec iov;
+      iov.iov_base = const_cast<uint8_t*>(range->data());
+      iov.iov_len = range->length();
+      iovs.push_back(iov);
+    }
+    range = range->next();
+    if (range == buf.get()) {
+      break;
+    }
+  }
+  writev(callback, iovs.data(), iovs.size(), flags);
+}
+
+void UdpPeerTransport::writev(
+    WriteCallback* callback,
+    const iovec* iovs,
+    size_t count,
+    folly::WriteFlags /* flags */) {
+  if (listener_ == nullptr || closed_) {
+    if (callback != nullptr) {
+      callback->writeErr(
+          0,
+          folly::AsyncSocketException(
+              folly::AsyncSocketException::NOT_OPEN,
+              "UDP listener is gone"));
+    }
+    return;
+  }
+
+  size_t total = 0;
+  for (size_t i = 0; i < count; ++i) {
+    total += iovs[i].iov_len;
+  }
+
+  uint16_t reqid = lastRequestId_;
+  if (!pendingReplyIds_.empty()) {
+    reqid = pendingReplyIds_.front();
+    pendingReplyIds_.pop_front();
+    lastRequestId_ = reqid;
+  }
+
+  const size_t numFragments =
+      std::max<size_t>(1, (total + kMaxPayloadPerDatagram - 1) /
+                              kMaxPayloadPerDatagram);
+
+  /* Flatten the reply once, then cut it into MTU-sized fragments */
+  auto payload = folly::IOBuf::create(total);
+  for (size_t i = 0; i < count; ++i) {
+    memcpy(payload->writableTail(), iovs[i].iov_base, iovs[i].iov_len);
+    payload->append(iovs[i].iov_len);
+  }
+
+  size_t offset = 0;
+  for (size_t frag = 0; frag < numFragments; ++frag) {
+    const auto fragLen =
+        std::min(kMaxPayloadPerDatagram, total - offset);
+    auto datagram = folly::IOBuf::create(kUdpHeaderSize + fragLen);
+    auto out = datagram->writableTail();
+    out[0] = reqid >> 8;
+    out[1] = reqid & 0xff;
+    out[2] = frag >> 8;
+    out[3] = frag & 0xff;
+    out[4] = numFragments >> 8;
+    out[5] = numFragments & 0xff;
+    out[6] = 0;
+    out[7] = 0;
+    memcpy(out + kUdpHeaderSize, payload->data() + offset, fragLen);
+    datagram->append(kUdpHeaderSize + fragLen);
+    offset += fragLen;
+    listener_->sendDatagram(peer_, std::move(datagram));
+  }
+
+  appBytesWritten_ += total;
+  if (callback != nullptr) {
+    /* Data was copied into the datagram; the caller's buffers are free */
+    callback->writeSuccess();
+  }
+}
+
+void UdpPeerTransport::close() {
+  closed_ = true;
+}
+
+void UdpPeerTransport::closeNow() {
+  closed_ = true;
+}
+
+void UdpPeerTransport::shutdownWrite() {
+  closed_ = true;
+}
+
+void UdpPeerTransport::shutdownWriteNow() {
+  closed_ = true;
+}
+
+void UdpPeerTransport::getLocalAddress(folly::SocketAddress* address) const {
+  if (listener_ != nullptr) {
+    *address = listener_->localAddress();
+  } else {
+    *address = folly::SocketAddress();
+  }
+}
+
+UdpListener::UdpListener(
+    AsyncMcServerWorker& worker,
+    folly::EventBase& evb,
+    uint16_t port)
+    : folly::EventHandler(&evb),
+      worker_(worker),
+      eventBase_(evb),
+      flushSendsCallback_(*this) {
+  fd_ = ::socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if (fd_ < 0) {
+    throw std::runtime_error("Failed to create UDP socket");
+  }
+
+  int one = 1;
+  if (setsockopt(fd_, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+    ::close(fd_);
+    fd_ = -1;
+    throw std::runtime_error("Failed to set SO_REUSEPORT on UDP socket");
+  }
+  /* Accept both v4 and v6 peers on the one socket */
+  int zero = 0;
+  setsockopt(fd_, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));
+
+  sockaddr_in6 addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_any;
+  addr.sin6_port = htons(port);
+  if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    ::close(fd_);
+    fd_ = -1;
+    throw std::runtime_error("Failed to bind UDP socket");
+  }
+  localAddress_.setFromLocalAddress(fd_);
+
+  changeHandlerFD(fd_);
+  registerHandler(EV_READ | EV_PERSIST);
+}
+
+UdpListener::~UdpListener() {
+  unregisterHandler();
+  for (auto& it : peers_) {
+    it.second->detachListener();
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+UdpPeerTransport* UdpListener::getPeerTransport(
+    const folly::SocketAddress& from) {
+  auto it = peers_.find(from);
+  if (it != peers_.end()) {
+    return it->second;
+  }
+
+  auto transport = new UdpPeerTransport(this, eventBase_, from);
+  folly::AsyncTransportWrapper::UniquePtr transportPtr(transport);
+  if (!worker_.addUdpTransport(std::move(transportPtr))) {
+    return nullptr;
+  }
+  peers_.emplace(from, transport);
+  return transport;
+}
+
+void UdpListener::processDatagram(
+    const folly::SocketAddress& from,
+    const uint8_t* data,
+    size_t len) {
+  if (len < kUdpHeaderSize) {
+    return;
+  }
+  const uint16_t reqid = (data[0] << 8) | data[1];
+  const uint16_t seq = (data[2] << 8) | data[3];
+  const uint16_t total = (data[4] << 8) | data[5];
+  if (seq != 0 || total > 1) {
+    /* Multi-datagram requests are not supported (same as memcached) */
+    LOG_EVERY_N(WARNING, 10000) << "Dropping multi-datagram UDP request";
+    return;
+  }
+
+  auto transport = getPeerTransport(from);
+  if (transport == nullptr) {
+    return;
+  }
+  transport->pushRequestId(reqid);
+  transport->deliverPayload(data + kUdpHeaderSize, len - kUdpHeaderSize);
+}
+
+void UdpListener::handlerReady(uint16_t) noexcept {
+  mmsghdr msgs[kIoBatchSize];
+  iovec iovs[kIoBatchSize];
+  sockaddr_storage addrs[kIoBatchSize];
+  static thread_local std::vector<uint8_t> buffers(
+      kIoBatchSize * kReadBufferSize);
+
+  while (true) {
+    memset(msgs, 0, sizeof(msgs));
+    for (size_t i = 0; i < kIoBatchSize; ++i) {
+      iovs[i].iov_base = buffers.data() + i * kReadBufferSize;
+      iovs[i].iov_len = kReadBufferSize;
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      msgs[i].msg_hdr.msg_name = &addrs[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+    }
+
+    const int received = recvmmsg(fd_, msgs, kIoBatchSize, 0, nullptr);
+    if (received <= 0) {
+      return;
+    }
+
+    for (int i = 0; i < received; ++i) {
+      folly::SocketAddress from;
+      try {
+        from.setFromSockaddr(
+            reinterpret_cast<sockaddr*>(&addrs[i]),
+            msgs[i].msg_hdr.msg_namelen);
+      } catch (const std::exception&) {
+        continue;
+      }
+      processDatagram(
+          from,
+          static_cast<const uint8_t*>(iovs[i].iov_base),
+          msgs[i].msg_len);
+    }
+
+    if (static_cast<size_t>(received) < kIoBatchSize) {
+      return;
+    }
+  }
+}
+
+void UdpListener::sendDatagram(
+    const folly::SocketAddress& peer,
+    std::unique_ptr<folly::IOBuf> datagram) {
+  pendingSends_.push_back(OutDatagram{peer, std::move(datagram)});
+  if (!flushScheduled_) {
+    eventBase_.runInLoop(&flushSendsCallback_, /* thisIteration= */ true);
+    flushScheduled_ = true;
+  }
+}
+
+void UdpListener::flushSends() {
+  flushScheduled_ = false;
+
+  size_t offset = 0;
+  while (offset < pendingSends_.size()) {
+    mmsghdr msgs[kIoBatchSize];
+    iovec iovs[kIoBatchSize];
+    sockaddr_storage addrs[kIoBatchSize];
+    memset(msgs, 0, sizeof(msgs));
+
+    const auto batch =
+        std::min(kIoBatchSize, pendingSends_.size() - offset);
+    for (size_t i = 0; i < batch; ++i) {
+      auto& out = pendingSends_[offset + i];
+      iovs[i].iov_base = const_cast<uint8_t*>(out.data->data());
+      iovs[i].iov_len = out.data->length();
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      msgs[i].msg_hdr.msg_namelen = out.peer.getAddress(&addrs[i]);
+      msgs[i].msg_hdr.msg_name = &addrs[i];
+    }
+
+    const int sent = sendmmsg(fd_, msgs, batch, 0);
+    if (sent < 0) {
+      LOG_EVERY_N(ERROR, 1000) << "sendmmsg failed: " << errno;
+      break;
+    }
+    offset += sent;
+    if (static_cast<size_t>(sent) < batch) {
+      /* Socket buffer full; drop the rest, UDP clients retry */
+      break;
+    }
+  }
+  pendingSends_.clear();
+}
+
+void UdpListener::removePeer(const folly::SocketAddress& peer) {
+  peers_.erase(peer);
+}
+
+}}  // facebook::memcache
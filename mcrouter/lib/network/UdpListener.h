@@ -0,0 +1,223 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/SocketAddress.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/async/AsyncTransport.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventHandler.h>
+
+namespace facebook { namespace memcache {
+
+class AsyncMcServerWorker;
+class UdpListener;
+
+/**
+ * Pseudo-transport representing a single UDP peer.
+ *
+ * Incoming datagram payloads are fed into the installed ReadCallback
+ * (i.e. the McServerSession parser) by the owning UdpListener, and
+ * writes become memcached-UDP-framed datagrams sent back to the peer
+ * through the listener's batched send queue.  This lets UDP traffic
+ * reuse the whole ServerMcParser / McServerRequestContext machinery
+ * unchanged.
+ *
+ * UDP sessions run in singleWrite mode, so each writev() call carries
+ * exactly one reply; the reply is stamped with the request id of the
+ * oldest unanswered request.  Multi-op (multiget) replies consist of
+ * several write buffers and are not given proper sequence numbers --
+ * the UDP fast path is intended for single-key get/metaget traffic.
+ */
+class UdpPeerTransport : public folly::AsyncTransportWrapper {
+ public:
+  UdpPeerTransport(
+      UdpListener* listener,
+      folly::EventBase& evb,
+      folly::SocketAddress peer);
+
+  /* Called by UdpListener */
+  void pushRequestId(uint16_t reqid) {
+    pendingReplyIds_.push_back(reqid);
+  }
+  void deliverPayload(const uint8_t* data, size_t len);
+  void detachListener() {
+    listener_ = nullptr;
+  }
+
+  /* AsyncTransportWrapper */
+  void setReadCB(ReadCallback* callback) override {
+    readCallback_ = callback;
+  }
+  ReadCallback* getReadCallback() const override {
+    return readCallback_;
+  }
+  void write(
+      WriteCallback* callback,
+      const void* buf,
+      size_t bytes,
+      folly::WriteFlags flags = folly::WriteFlags::NONE) override;
+  void writev(
+      WriteCallback* callback,
+      const iovec* iovs,
+      size_t count,
+      folly::WriteFlags flags = folly::WriteFlags::NONE) override;
+  void writeChain(
+      WriteCallback* callback,
+      std::unique_ptr<folly::IOBuf>&& buf,
+      folly::WriteFlags flags = folly::WriteFlags::NONE) override;
+
+  /* AsyncTransport */
+  void close() override;
+  void closeNow() override;
+  void shutdownWrite() override;
+  void shutdownWriteNow() override;
+  bool good() const override {
+    return !closed_ && listener_ != nullptr;
+  }
+  bool readable() const override {
+    return good();
+  }
+  bool connecting() const override {
+    return false;
+  }
+  bool error() const override {
+    return false;
+  }
+  void attachEventBase(folly::EventBase* eventBase) override {}
+  void detachEventBase() override {}
+  bool isDetachable() const override {
+    return false;
+  }
+  folly::EventBase* getEventBase() const override {
+    return &eventBase_;
+  }
+  void setSendTimeout(uint32_t milliseconds) override {}
+  uint32_t getSendTimeout() const override {
+    return 0;
+  }
+  void getLocalAddress(folly::SocketAddress* address) const override;
+  void getPeerAddress(folly::SocketAddress* address) const override {
+    *address = peer_;
+  }
+  bool isEorTrackingEnabled() const override {
+    return false;
+  }
+  void setEorTracking(bool track) override {}
+  size_t getAppBytesWritten() const override {
+    return appBytesWritten_;
+  }
+  size_t getRawBytesWritten() const override {
+    return appBytesWritten_;
+  }
+  size_t getAppBytesReceived() const override {
+    return appBytesReceived_;
+  }
+  size_t getRawBytesReceived() const override {
+    return appBytesReceived_;
+  }
+
+ private:
+  UdpListener* listener_;
+  folly::EventBase& eventBase_;
+  folly::SocketAddress peer_;
+  ReadCallback* readCallback_{nullptr};
+  std::deque<uint16_t> pendingReplyIds_;
+  uint16_t lastRequestId_{0};
+  size_t appBytesWritten_{0};
+  size_t appBytesReceived_{0};
+  bool closed_{false};
+
+  ~UdpPeerTransport() override;
+
+  friend class UdpListener;
+};
+
+/**
+ * Per-worker UDP endpoint implementing the memcached UDP protocol
+ * (8 byte frame header: request id, sequence number, datagram count,
+ * reserved; all big-endian).
+ *
+ * The socket is opened with SO_REUSEPORT so that every worker thread
+ * can bind the same port and the kernel spreads datagrams across
+ * workers.  Incoming datagrams are drained in batches with recvmmsg()
+ * and routed to a per-peer UdpPeerTransport/McServerSession; replies
+ * are collected across all peers and flushed once per event loop
+ * iteration with sendmmsg().
+ */
+class UdpListener : private folly::EventHandler {
+ public:
+  /**
+   * Creates the socket, binds and registers with the event base.
+   *
+   * @throws std::runtime_error on socket/bind failure.
+   */
+  UdpListener(
+      AsyncMcServerWorker& worker,
+      folly::EventBase& evb,
+      uint16_t port);
+  ~UdpListener() override;
+
+  /* Called by UdpPeerTransport */
+  void sendDatagram(
+      const folly::SocketAddress& peer,
+      std::unique_ptr<folly::IOBuf> datagram);
+  void removePeer(const folly::SocketAddress& peer);
+  const folly::SocketAddress& localAddress() const {
+    return localAddress_;
+  }
+
+ private:
+  struct PeerHash {
+    size_t operator()(const folly::SocketAddress& addr) const {
+      return addr.hash();
+    }
+  };
+
+  struct OutDatagram {
+    folly::SocketAddress peer;
+    std::unique_ptr<folly::IOBuf> data;
+  };
+
+  void handlerReady(uint16_t events) noexcept override final;
+  void processDatagram(
+      const folly::SocketAddress& from,
+      const uint8_t* data,
+      size_t len);
+  UdpPeerTransport* getPeerTransport(const folly::SocketAddress& from);
+  void flushSends();
+
+  AsyncMcServerWorker& worker_;
+  folly::EventBase& eventBase_;
+  int fd_{-1};
+  folly::SocketAddress localAddress_;
+  std::unordered_map<folly::SocketAddress, UdpPeerTransport*, PeerHash> peers_;
+  std::vector<OutDatagram> pendingSends_;
+  bool flushScheduled_{false};
+
+  struct FlushSendsCallback : public folly::EventBase::LoopCallback {
+    explicit FlushSendsCallback(UdpListener& listener) : listener_(listener) {}
+    void runLoopCallback() noexcept override final {
+      listener_.flushSends();
+    }
+    UdpListener& listener_;
+  };
+  FlushSendsCallback flushSendsCallback_;
+
+  UdpListener(const UdpListener&) = delete;
+  UdpListener& operator=(const UdpListener&) = delete;
+};
+
+}}  // facebook::memcache
@@ -10,6 +10,7 @@
 #include <arpa/inet.h>
 
 #include <folly/Bits.h>
+#include <folly/small_vector.h>
 
 #include "mcrouter/lib/fbi/cpp/TypeList.h"
 #include "mcrouter/lib/IOBufUtil.h"
@@ -453,11 +454,17 @@ void umbrellaParseMessage(Message& message, Op, const folly::IOBuf& source,
     throw std::runtime_error("Invalid number of entries");
   }
   using Handler = FieldPolicyHandler<typename TagSet<Op, Message>::Tags>;
+  // Byte-swap all entry tags in one sweep up front, so the dispatch loop
+  // below reads them as plain loads.  Entry values are still converted
+  // in the per-field handlers, since the swap width depends on the
+  // entry type.
+  folly::small_vector<uint16_t, 16> tags(nentries);
+  decodeEntryTags(msg->entries, nentries, tags.data());
   for (size_t i = 0; i < nentries; ++i) {
     // Process entries in the reverse order, since it's easier to handle
     // double fields that way.
     auto& entry = msg->entries[nentries - i - 1];
-    size_t tag = folly::Endian::big((uint16_t)entry.tag);
+    const size_t tag = tags[nentries - i - 1];
     switch (tag) {
       case msg_cas:
         Handler::parseField(Op(), CasTag(), message, source, body, entry);
@@ -553,10 +560,7 @@ bool UmbrellaSerializedMessage::prepareRequestImpl(const Request& request,
 
   auto valuePtr = carbon::valuePtrUnsafe(request);
   if (valuePtr != nullptr) {
-    auto valueRange = coalesceAndGetRange(const_cast<folly::IOBuf&>(*valuePtr));
-    appendString(msg_value,
-                 reinterpret_cast<const uint8_t*>(valueRange.begin()),
-                 valueRange.size());
+    appendString(msg_value, const_cast<folly::IOBuf&>(*valuePtr));
   }
 
 #ifndef LIBMC_FBTRACE_DISABLE
@@ -603,16 +607,11 @@ bool UmbrellaSerializedMessage::prepareReplyImpl(Reply&& reply,
 
   // Serialize type-specific fields, e.g., cas token for gets reply
   prepareHelper(reply);
-  /* TODO: if we intend to pass chained IOBufs as values,
-     we can optimize this to write multiple iovs directly */
   if (auto valuePtr = carbon::valuePtrUnsafe(reply)) {
     // TODO(jmswen) Use 'message' field for error messages instead of 'value'?
     assert(!iobuf_.hasValue());
     iobuf_.emplace(std::move(*valuePtr));
-    auto valueRange = coalesceAndGetRange(*iobuf_);
-    appendString(msg_value,
-                 reinterpret_cast<const uint8_t*>(valueRange.begin()),
-                 valueRange.size());
+    appendString(msg_value, *iobuf_);
   }
 
   // It is important that we write msg_result after msg_value. Parsing
@@ -9,11 +9,16 @@
  */
 #include "UmbrellaProtocol.h"
 
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
 #include <folly/Bits.h>
 #include <folly/GroupVarint.h>
 #include <folly/io/IOBuf.h>
 #include <folly/Varint.h>
 
+#include "mcrouter/lib/IOBufUtil.h"
 #include "mcrouter/lib/mc/umbrella.h"
 
 #ifndef LIBMC_FBTRACE_DISABLE
@@ -106,8 +111,8 @@ size_t serializeAdditionalFieldIfNonZero(
     uint64_t value) {
   uint8_t* buf = destination;
   if (value > 0) {
-    buf += folly::encodeVarint(static_cast<uint64_t>(type), buf);
-    buf += folly::encodeVarint(value, buf);
+    buf += caretEncodeVarint(static_cast<uint64_t>(type), buf);
+    buf += caretEncodeVarint(value, buf);
   }
   return buf - destination;
 }
@@ -147,6 +152,41 @@ size_t serializeAdditionalFields(
 
 } // anonymous namespace
 
+namespace detail {
+
+void decodeEntryTags(const um_elist_entry_t* entries, size_t nentries,
+                     uint16_t* tagsOut) {
+  size_t i = 0;
+#if defined(__SSSE3__)
+  // Entries are packed 12-byte records with the tag at offset 2, so four
+  // entries span exactly three 16-byte loads: the tags of a block sit at
+  // bytes 2, 14, 26 and 38.  Each shuffle picks out its tags with the
+  // two bytes already swapped; the other lanes are zeroed and OR'd
+  // together.
+  const auto* base = reinterpret_cast<const uint8_t*>(entries);
+  const auto maskA = _mm_setr_epi8(3, 2, 15, 14, -1, -1, -1, -1,
+                                   -1, -1, -1, -1, -1, -1, -1, -1);
+  const auto maskB = _mm_setr_epi8(-1, -1, -1, -1, 11, 10, -1, -1,
+                                   -1, -1, -1, -1, -1, -1, -1, -1);
+  const auto maskC = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 7, 6,
+                                   -1, -1, -1, -1, -1, -1, -1, -1);
+  for (; i + 4 <= nentries; i += 4, base += 48) {
+    auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base));
+    auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base + 16));
+    auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base + 32));
+    auto tags = _mm_or_si128(
+        _mm_shuffle_epi8(a, maskA),
+        _mm_or_si128(_mm_shuffle_epi8(b, maskB), _mm_shuffle_epi8(c, maskC)));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(tagsOut + i), tags);
+  }
+#endif
+  for (; i < nentries; ++i) {
+    tagsOut[i] = folly::Endian::big((uint16_t)entries[i].tag);
+  }
+}
+
+} // detail
+
 UmbrellaParseStatus umbrellaParseHeader(const uint8_t* buf, size_t nbuf,
                                         UmbrellaMessageInfo& infoOut) {
 
@@ -221,8 +261,8 @@ UmbrellaParseStatus caretParseHeader(const uint8_t* buff,
   resetAdditionalFields(headerInfo);
   for (uint32_t i = 0; i < additionalFields; i++) {
     try {
-      uint64_t fieldType = folly::decodeVarint(range);
-      uint64_t fieldValue = folly::decodeVarint(range);
+      uint64_t fieldType = caretDecodeVarint(range);
+      uint64_t fieldValue = caretDecodeVarint(range);
 
       if (fieldType > static_cast<uint64_t>(
                           CaretAdditionalFieldType::DROP_PROBABILITY)) {
@@ -335,7 +375,7 @@ UmbrellaSerializedMessage::UmbrellaSerializedMessage() noexcept {
 }
 
 void UmbrellaSerializedMessage::clear() {
-  nEntries_ = nStrings_ = offset_ = 0;
+  nEntries_ = nStrings_ = nStringIovs_ = offset_ = 0;
   error_ = false;
 
   iobuf_.clear();
@@ -364,7 +404,48 @@ void UmbrellaSerializedMessage::appendString(
     return;
   }
 
+  stringTerminated_[nStrings_] = true;
   strings_[nStrings_++] = folly::StringPiece((const char*)data, len);
+  nStringIovs_ += 2;
+
+  um_elist_entry_t& entry = entries_[nEntries_++];
+  entry.type = folly::Endian::big((uint16_t)type);
+  entry.tag = folly::Endian::big((uint16_t)tag);
+  entry.data.str.offset = folly::Endian::big((uint32_t)offset_);
+  entry.data.str.len = folly::Endian::big((uint32_t)(len + 1));
+  offset_ += len + 1;
+}
+
+void UmbrellaSerializedMessage::appendString(
+  int32_t tag, folly::IOBuf& buf, entry_type_t type) {
+
+  if (!buf.isChained()) {
+    appendString(tag, buf.data(), buf.length(), type);
+    return;
+  }
+
+  const size_t links = buf.countChainElements();
+  if (nStrings_ + links > kInlineStrings ||
+      2 + nStringIovs_ + links + 1 > kMaxIovs) {
+    auto range = coalesceAndGetRange(buf);
+    appendString(tag, reinterpret_cast<const uint8_t*>(range.begin()),
+                 range.size(), type);
+    return;
+  }
+
+  /* One entry covers the whole chain; each link is its own string piece
+     and only the last one is followed by the nul terminator. */
+  size_t len = 0;
+  const folly::IOBuf* link = &buf;
+  do {
+    stringTerminated_[nStrings_] = false;
+    strings_[nStrings_++] =
+      folly::StringPiece((const char*)link->data(), link->length());
+    len += link->length();
+    link = link->next();
+  } while (link != &buf);
+  stringTerminated_[nStrings_ - 1] = true;
+  nStringIovs_ += links + 1;
 
   um_elist_entry_t& entry = entries_[nEntries_++];
   entry.type = folly::Endian::big((uint16_t)type);
@@ -392,9 +473,11 @@ size_t UmbrellaSerializedMessage::finalizeMessage() {
     iovs_[niovOut].iov_len = strings_[i].size();
     niovOut++;
 
-    iovs_[niovOut].iov_base = &nul;
-    iovs_[niovOut].iov_len = 1;
-    niovOut++;
+    if (stringTerminated_[i]) {
+      iovs_[niovOut].iov_base = &nul;
+      iovs_[niovOut].iov_len = 1;
+      niovOut++;
+    }
   }
   return niovOut;
 }
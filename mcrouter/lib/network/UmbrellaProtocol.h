@@ -11,7 +11,9 @@
 
 #include <string>
 
+#include <folly/Bits.h>
 #include <folly/io/IOBuf.h>
+#include <folly/Likely.h>
 #include <folly/Optional.h>
 #include <folly/Range.h>
 #include <folly/Varint.h>
@@ -37,6 +39,67 @@ enum class UmbrellaParseStatus {
 UmbrellaParseStatus umbrellaParseHeader(const uint8_t* buf, size_t nbuf,
                                         UmbrellaMessageInfo& infoOut);
 
+namespace detail {
+
+/**
+ * Decodes the big-endian tag field of every umbrella entry into tagsOut,
+ * which must hold nentries elements.  Processes four entries (48 bytes)
+ * per step with SSSE3 shuffles when available, so the field dispatch
+ * loops can read tags as plain native-endian loads.
+ */
+void decodeEntryTags(const um_elist_entry_t* entries, size_t nentries,
+                     uint16_t* tagsOut);
+
+} // detail
+
+/**
+ * Encodes value as a varint into buf, which must have room for
+ * folly::kMaxVarintLength64 bytes. Wire-compatible with
+ * folly::encodeVarint, but the byte count is computed up front with a
+ * bit scan so the store loop has no data-dependent exit condition.
+ *
+ * @return  Number of bytes written.
+ */
+inline size_t caretEncodeVarint(uint64_t value, uint8_t* buf) {
+  const size_t len = (folly::findLastSet(value | 1) + 6) / 7;
+  for (size_t i = 0; i < len - 1; ++i) {
+    buf[i] = static_cast<uint8_t>(value) | 0x80;
+    value >>= 7;
+  }
+  buf[len - 1] = static_cast<uint8_t>(value);
+  return len;
+}
+
+/**
+ * Decodes a varint from range and advances past it, like
+ * folly::decodeVarint. When at least 8 bytes are available, the
+ * terminating byte is located with a single 64-bit load and the payload
+ * bits are compacted without a per-byte loop; varints longer than 8
+ * bytes (values >= 2^56) and buffer tails take the folly path.
+ *
+ * @throw std::invalid_argument  If range doesn't hold a complete varint.
+ */
+inline uint64_t caretDecodeVarint(folly::StringPiece& range) {
+  if (LIKELY(range.size() >= sizeof(uint64_t))) {
+    auto x = folly::loadUnaligned<uint64_t>(range.data());
+    const auto terminators = ~x & 0x8080808080808080ULL;
+    if (LIKELY(terminators != 0)) {
+      const size_t len =
+          ((folly::findFirstSet(terminators) - 1) >> 3) + 1;
+      // Drop the bytes past the terminator and the continuation bits,
+      // then collapse the 7-bit groups pairwise into a 56-bit value.
+      x &= ~0ULL >> (64 - 8 * len);
+      x &= 0x7f7f7f7f7f7f7f7fULL;
+      x = ((x & 0x7f007f007f007f00ULL) >> 1) | (x & 0x007f007f007f007fULL);
+      x = ((x & 0x3fff00003fff0000ULL) >> 2) | (x & 0x00003fff00003fffULL);
+      x = ((x >> 32) << 28) | (x & 0x0fffffffULL);
+      range.advance(len);
+      return x;
+    }
+  }
+  return folly::decodeVarint(range);
+}
+
 /**
  * Parses caret message header
  * and fills up the UmbrellaMessageInfo
@@ -146,6 +209,12 @@ class UmbrellaSerializedMessage {
   static constexpr size_t kInlineStrings = 16;
   size_t nStrings_{0};
   folly::StringPiece strings_[kInlineStrings];
+  // A chained IOBuf string occupies several consecutive slots of
+  // strings_; only the last one carries the nul terminator.
+  bool stringTerminated_[kInlineStrings];
+  // Number of iovecs the strings appended so far will need (pieces plus
+  // terminators), for the chain fallback check in appendString().
+  size_t nStringIovs_{0};
 
   folly::Optional<folly::IOBuf> iobuf_;
   folly::Optional<std::string> auxString_;
@@ -157,6 +226,14 @@ class UmbrellaSerializedMessage {
   void appendInt(entry_type_t type, int32_t tag, uint64_t val);
   void appendString(int32_t tag, const uint8_t* data, size_t len,
                     entry_type_t type = BSTRING);
+  /**
+   * Appends the contents of buf without copying: every link of the chain
+   * becomes its own iovec pointing at the link's data. The caller must
+   * keep buf alive until the message is written out. Falls back to
+   * coalescing when the chain doesn't fit the inline iovec/string tables.
+   */
+  void appendString(int32_t tag, folly::IOBuf& buf,
+                    entry_type_t type = BSTRING);
 
   template <class Request>
   bool prepareRequestImpl(const Request& request, mc_op_t op, uint64_t reqid,
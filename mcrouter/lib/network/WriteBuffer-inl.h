@@ -55,8 +55,8 @@ WriteBuffer::prepareTyped(
       return caretReply_.prepare(
           std::move(reply),
           ctx_->reqid_,
-          ctx_->compressionContext_->codecIdRange,
-          ctx_->compressionContext_->compressionCodecMap,
+          ctx_->compressionContext_.codecIdRange,
+          ctx_->compressionContext_.compressionCodecMap,
           dropProbability,
           iovsBegin_,
           iovsCount_);
@@ -98,8 +98,8 @@ WriteBuffer::prepareTyped(
   return caretReply_.prepare(
       std::move(reply),
       ctx_->reqid_,
-      ctx_->compressionContext_->codecIdRange,
-      ctx_->compressionContext_->compressionCodecMap,
+      ctx_->compressionContext_.codecIdRange,
+      ctx_->compressionContext_.compressionCodecMap,
       dropProbability,
       iovsBegin_,
       iovsCount_);
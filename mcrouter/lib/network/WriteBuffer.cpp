@@ -82,6 +82,19 @@ void WriteBuffer::clear() {
   }
 }
 
+void WriteBuffer::prepareStatic(
+    McServerRequestContext&& ctx,
+    folly::StringPiece data,
+    uint32_t typeId) {
+  ctx_.emplace(std::move(ctx));
+  typeId_ = typeId;
+
+  staticIov_.iov_base = const_cast<char*>(data.begin());
+  staticIov_.iov_len = data.size();
+  iovsBegin_ = &staticIov_;
+  iovsCount_ = 1;
+}
+
 bool WriteBuffer::noReply() const {
   return ctx_.hasValue() && ctx_->hasParent() && ctx_->parent().error();
 }
@@ -12,6 +12,7 @@
 #include <string>
 
 #include <folly/io/IOBuf.h>
+#include <folly/Range.h>
 
 #include "mcrouter/lib/mc/protocol.h"
 #include "mcrouter/lib/mc/umbrella.h"
@@ -76,11 +77,32 @@ class WriteBuffer {
       Reply&& reply,
       Destructor destructor = Destructor(nullptr, nullptr));
 
+  /**
+   * Point this buffer at an already serialized reply instead of
+   * serializing one.  `data` must stay alive until the write completes
+   * (e.g. owned by the worker); no copy is made.
+   */
+  void prepareStatic(
+      McServerRequestContext&& ctx,
+      folly::StringPiece data,
+      uint32_t typeId);
+
   const struct iovec* getIovsBegin() const {
     return iovsBegin_;
   }
   size_t getIovsCount() const { return iovsCount_; }
 
+  /**
+   * Total number of bytes this reply serializes to.
+   */
+  size_t totalSize() const {
+    size_t bytes = 0;
+    for (size_t i = 0; i < iovsCount_; ++i) {
+      bytes += iovsBegin_[i].iov_len;
+    }
+    return bytes;
+  }
+
   /**
    * Checks if we should send a reply for this request.
    *
@@ -107,6 +129,10 @@ class WriteBuffer {
     return typeId_;
   }
 
+  mc_protocol_t protocol() const {
+    return protocol_;
+  }
+
  private:
   const mc_protocol_t protocol_;
 
@@ -120,6 +146,7 @@ class WriteBuffer {
   folly::Optional<McServerRequestContext> ctx_;
   const struct iovec* iovsBegin_;
   size_t iovsCount_{0};
+  struct iovec staticIov_;
   bool isEndOfBatch_{false};
   uint32_t typeId_{0};
 
@@ -134,35 +161,85 @@ class WriteBuffer {
 class WriteBufferIntrusiveList : public WriteBuffer::Queue {
 };
 
+/**
+ * Bounded pool of free WriteBuffers keyed by protocol, shared by all
+ * sessions of a worker.  Sessions borrow buffers through their
+ * WriteBufferQueue and return them here once the write completes, so
+ * idle connections hold no write-path memory and the worker's total
+ * pooled buffer count stays bounded regardless of connection count.
+ *
+ * Single threaded; must only be used from the owning worker's thread.
+ */
+class WriteBufferPool {
+ public:
+  explicit WriteBufferPool(size_t maxFree = kDefaultMaxFree) noexcept
+      : maxFree_(maxFree) {
+  }
+
+  std::unique_ptr<WriteBuffer> get(mc_protocol_t protocol) {
+    auto& freeQ = freeQueue(protocol);
+    if (freeQ.empty()) {
+      return folly::make_unique<WriteBuffer>(protocol);
+    }
+    return freeQ.popFront();
+  }
+
+  void release(std::unique_ptr<WriteBuffer> wb) {
+    auto& freeQ = freeQueue(wb->protocol());
+    if (freeQ.size() < maxFree_) {
+      wb->clear();
+      freeQ.pushBack(std::move(wb));
+    }
+    /* else drop on the floor: the pool is full */
+  }
+
+ private:
+  constexpr static size_t kDefaultMaxFree = 50;
+
+  size_t maxFree_;
+  WriteBuffer::Queue free_[mc_nprotocols];
+
+  WriteBuffer::Queue& freeQueue(mc_protocol_t protocol) noexcept {
+    assert(protocol == mc_ascii_protocol ||
+           protocol == mc_umbrella_protocol ||
+           protocol == mc_caret_protocol);
+    return free_[static_cast<size_t>(protocol)];
+  }
+
+  WriteBufferPool(const WriteBufferPool&) = delete;
+  WriteBufferPool& operator=(const WriteBufferPool&) = delete;
+  WriteBufferPool(WriteBufferPool&&) noexcept = delete;
+  WriteBufferPool& operator=(WriteBufferPool&&) = delete;
+};
+
 class WriteBufferQueue {
  public:
-  explicit WriteBufferQueue(mc_protocol_t protocol) noexcept
-      : protocol_(protocol),
-        tlFreeQueue_(initFreeQueue(protocol_)) {
+  WriteBufferQueue(WriteBufferPool& pool, mc_protocol_t protocol) noexcept
+      : pool_(pool),
+        protocol_(protocol) {
   }
 
   std::unique_ptr<WriteBuffer> get() {
-    if (tlFreeQueue_.empty()) {
-      return folly::make_unique<WriteBuffer>(protocol_);
-    } else {
-      return tlFreeQueue_.popFront();
-    }
+    return pool_.get(protocol_);
   }
 
   void push(std::unique_ptr<WriteBuffer> wb) { queue_.pushBack(std::move(wb)); }
 
-  void pop(bool popBatch) {
+  /**
+   * Releases the frontmost buffer (or batch of buffers) back to the pool.
+   * @return  total number of reply bytes released, for egress accounting.
+   */
+  size_t pop(bool popBatch) {
+    size_t poppedBytes = 0;
     bool done = false;
     do {
       assert(!empty());
-      if (tlFreeQueue_.size() < kMaxFreeQueueSz) {
-        auto& wb = tlFreeQueue_.pushBack(queue_.popFront());
-        done = wb.isEndOfBatch();
-        wb.clear();
-      } else {
-        done = queue_.popFront()->isEndOfBatch();
-      }
+      auto wb = queue_.popFront();
+      done = wb->isEndOfBatch();
+      poppedBytes += wb->totalSize();
+      pool_.release(std::move(wb));
     } while (!done && popBatch);
+    return poppedBytes;
   }
 
   bool empty() const noexcept {
@@ -170,21 +247,10 @@ class WriteBufferQueue {
   }
 
  private:
-  constexpr static size_t kMaxFreeQueueSz = 50;
-
+  WriteBufferPool& pool_;
   mc_protocol_t protocol_;
-  WriteBuffer::Queue& tlFreeQueue_;
   WriteBuffer::Queue queue_;
 
-  static WriteBuffer::Queue& initFreeQueue(mc_protocol_t protocol) noexcept {
-    assert(protocol == mc_ascii_protocol ||
-           protocol == mc_umbrella_protocol ||
-           protocol == mc_caret_protocol);
-
-    static thread_local WriteBuffer::Queue freeQ[mc_nprotocols];
-    return freeQ[static_cast<size_t>(protocol)];
-  }
-
   WriteBufferQueue(const WriteBufferQueue&) = delete;
   WriteBufferQueue& operator=(const WriteBufferQueue&) = delete;
   WriteBufferQueue(WriteBufferQueue&&) noexcept = delete;
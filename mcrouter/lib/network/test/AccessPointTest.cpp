@@ -103,6 +103,33 @@ TEST(AccessPoint, host_port_proto_ssl) {
   EXPECT_TRUE(AccessPoint::create("[::1]:12345:ascii:blah", proto) == nullptr);
 }
 
+TEST(AccessPoint, hash) {
+  auto proto = mc_ascii_protocol;
+  auto ap = AccessPoint::create("127.0.0.1:12345:ascii:ssl:compressed", proto);
+  auto same = AccessPoint::create("127.0.0.1:12345:ascii:ssl:compressed",
+                                  proto);
+  EXPECT_TRUE(*ap == *same);
+  EXPECT_EQ(ap->hash(), same->hash());
+
+  // Every field participates in the hash.
+  for (auto other : {"127.0.0.2:12345:ascii:ssl:compressed",
+                     "127.0.0.1:12346:ascii:ssl:compressed",
+                     "127.0.0.1:12345:caret:ssl:compressed",
+                     "127.0.0.1:12345:ascii:plain:compressed",
+                     "127.0.0.1:12345:ascii:ssl:notcompressed"}) {
+    auto otherAp = AccessPoint::create(other, proto);
+    EXPECT_TRUE(*ap != *otherAp);
+    EXPECT_NE(ap->hash(), otherAp->hash());
+  }
+
+  // Mutation keeps the cached hash in sync.
+  ap->disableCompression();
+  auto uncompressed =
+    AccessPoint::create("127.0.0.1:12345:ascii:ssl:notcompressed", proto);
+  EXPECT_TRUE(*ap == *uncompressed);
+  EXPECT_EQ(ap->hash(), uncompressed->hash());
+}
+
 TEST(AccessPoint, port_override) {
   auto proto = mc_unknown_protocol;
   auto ap = AccessPoint::create("127.0.0.1:12345", proto, false, 44);
@@ -111,3 +111,20 @@ TEST(CarbonMessage, basic) {
   EXPECT_TRUE(ret);
   EXPECT_TRUE(getCalled);
 }
+
+TEST(CarbonMessage, typeIdPastTable) {
+  bool called = false;
+  TestCallback cb(
+      [&called](McGetRequest&&) { called = true; },
+      [&called](McSetRequest&&) { called = true; });
+
+  /* type ids beyond the dispatch table must be rejected, not indexed */
+  UmbrellaMessageInfo headerInfo;
+  headerInfo.typeId = 1 << 20;
+  headerInfo.headerSize = 0;
+  headerInfo.bodySize = 0;
+  folly::IOBuf empty(folly::IOBuf::CREATE, 0);
+
+  EXPECT_FALSE(cb.dispatchTypedRequest(headerInfo, empty));
+  EXPECT_FALSE(called);
+}
@@ -18,6 +18,8 @@
 #include <folly/io/IOBuf.h>
 
 #include "mcrouter/lib/carbon/CarbonQueueAppender.h"
+#include "mcrouter/lib/CompressionCodecManager.h"
+#include "mcrouter/lib/network/CaretSerializedMessage.h"
 #include "mcrouter/lib/network/gen/Memcache.h"
 #include "mcrouter/lib/network/test/gen/CarbonTest.h"
 #include "mcrouter/lib/network/UmbrellaProtocol.h"
@@ -205,3 +207,63 @@ TEST(CarbonQueueAppender, manyFields) {
   EXPECT_STREQ(str1, reinterpret_cast<const char*>(manyFields2.buf39().data()));
   EXPECT_STREQ(str2, reinterpret_cast<const char*>(manyFields2.buf40().data()));
 }
+
+namespace {
+std::string flattenIovs(const struct iovec* iovs, size_t niovs) {
+  std::string out;
+  for (size_t i = 0; i < niovs; ++i) {
+    out.append(reinterpret_cast<const char*>(iovs[i].iov_base),
+               iovs[i].iov_len);
+  }
+  return out;
+}
+} // anonymous
+
+TEST(CarbonQueueAppender, fanoutSharedBody) {
+  McSetRequest req("shared:key");
+  req.value() = folly::IOBuf(folly::IOBuf::COPY_BUFFER, "some value");
+  req.markFanout();
+  EXPECT_EQ(nullptr, req.serializedCaretBody());
+
+  // A copy never inherits the mark or the cached body.
+  McSetRequest copy(req);
+  EXPECT_FALSE(copy.isFanout());
+
+  const struct iovec* iovs1;
+  size_t niovs1;
+  CaretSerializedMessage msg1;
+  EXPECT_TRUE(msg1.prepare(req, 1, CodecIdRange::Empty, iovs1, niovs1));
+  EXPECT_NE(nullptr, req.serializedCaretBody());
+  auto cached = req.serializedCaretBody();
+
+  const struct iovec* iovs2;
+  size_t niovs2;
+  CaretSerializedMessage msg2;
+  EXPECT_TRUE(msg2.prepare(req, 2, CodecIdRange::Empty, iovs2, niovs2));
+  // Second leg reused the body serialized by the first one.
+  EXPECT_EQ(cached.get(), req.serializedCaretBody().get());
+
+  auto wire1 = flattenIovs(iovs1, niovs1);
+  auto wire2 = flattenIovs(iovs2, niovs2);
+
+  UmbrellaMessageInfo header1, header2;
+  caretParseHeader(
+      reinterpret_cast<const uint8_t*>(wire1.data()), wire1.size(), header1);
+  caretParseHeader(
+      reinterpret_cast<const uint8_t*>(wire2.data()), wire2.size(), header2);
+  EXPECT_EQ(1, header1.reqId);
+  EXPECT_EQ(2, header2.reqId);
+  EXPECT_EQ(header1.bodySize, header2.bodySize);
+  // Headers differ (request id), bodies are byte-identical.
+  EXPECT_EQ(wire1.substr(header1.headerSize), wire2.substr(header2.headerSize));
+
+  McSetRequest parsed;
+  auto body = folly::IOBuf::wrapBuffer(
+      wire2.data() + header2.headerSize, header2.bodySize);
+  carbon::CarbonProtocolReader reader{folly::io::Cursor(body.get())};
+  parsed.deserialize(reader);
+  EXPECT_EQ("shared:key", parsed.key().fullKey().str());
+  EXPECT_EQ(
+      "some value",
+      folly::StringPiece(folly::ByteRange(parsed.value().coalesce())).str());
+}
@@ -0,0 +1,105 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Varint.h>
+
+#include "mcrouter/lib/network/UmbrellaProtocol.h"
+
+using namespace facebook::memcache;
+
+namespace {
+
+/**
+ * A mix representative of Caret additional fields: small field type
+ * tags, drop probabilities (< 10^6), body sizes and full 64-bit trace
+ * ids.
+ */
+std::vector<uint64_t> makeValues() {
+  std::vector<uint64_t> values;
+  uint64_t seed = 0x5deece66d;
+  for (size_t i = 0; i < 1000; ++i) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    values.push_back(i % 8);                  // field type
+    values.push_back(seed % 1000000);         // drop probability
+    values.push_back(seed % (1ULL << 20));    // body size
+    values.push_back(seed);                   // trace id
+  }
+  return values;
+}
+
+const std::vector<uint64_t>& values() {
+  static auto vals = makeValues();
+  return vals;
+}
+
+std::string encodeAll() {
+  std::string buf;
+  buf.resize(values().size() * folly::kMaxVarintLength64);
+  auto p = reinterpret_cast<uint8_t*>(&buf[0]);
+  for (auto v : values()) {
+    p += caretEncodeVarint(v, p);
+  }
+  buf.resize(p - reinterpret_cast<const uint8_t*>(buf.data()));
+  return buf;
+}
+
+} // anonymous namespace
+
+BENCHMARK(FollyEncode, n) {
+  uint8_t buf[folly::kMaxVarintLength64];
+  for (int iter = 0; iter < n; ++iter) {
+    for (auto v : values()) {
+      folly::doNotOptimizeAway(folly::encodeVarint(v, buf));
+    }
+  }
+}
+
+BENCHMARK_RELATIVE(CaretEncode, n) {
+  uint8_t buf[folly::kMaxVarintLength64];
+  for (int iter = 0; iter < n; ++iter) {
+    for (auto v : values()) {
+      folly::doNotOptimizeAway(caretEncodeVarint(v, buf));
+    }
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(FollyDecode, n) {
+  folly::BenchmarkSuspender susp;
+  auto encoded = encodeAll();
+  susp.dismiss();
+  for (int iter = 0; iter < n; ++iter) {
+    folly::StringPiece range(encoded);
+    while (!range.empty()) {
+      folly::doNotOptimizeAway(folly::decodeVarint(range));
+    }
+  }
+}
+
+BENCHMARK_RELATIVE(CaretDecode, n) {
+  folly::BenchmarkSuspender susp;
+  auto encoded = encodeAll();
+  susp.dismiss();
+  for (int iter = 0; iter < n; ++iter) {
+    folly::StringPiece range(encoded);
+    while (!range.empty()) {
+      folly::doNotOptimizeAway(caretDecodeVarint(range));
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <cstring>
+#include <string>
+
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+
+#include "mcrouter/lib/network/McAsciiParser.h"
+#include "mcrouter/lib/network/ServerMcParser.h"
+#include "mcrouter/lib/network/UmbrellaProtocol.h"
+
+using namespace facebook::memcache;
+
+namespace {
+
+/**
+ * Minimal session stand-in for ServerMcParser; just counts requests.
+ */
+class ServerParserCallback {
+ public:
+  template <class Request>
+  void umbrellaRequestReady(Request&&, uint64_t) {
+    ++requests;
+  }
+
+  void caretRequestReady(const UmbrellaMessageInfo&, const folly::IOBuf&) {
+    ++requests;
+  }
+
+  template <class Request>
+  void onRequest(Request&&, bool) {
+    ++requests;
+  }
+
+  void multiOpEnd() {}
+
+  void parseError(mc_res_t, folly::StringPiece) {
+    parseFailed = true;
+  }
+
+  size_t requests{0};
+  bool parseFailed{false};
+};
+
+using BenchServerParser = ServerMcParser<ServerParserCallback>;
+
+void feed(BenchServerParser& parser, folly::StringPiece data) {
+  size_t consumed = 0;
+  while (consumed < data.size()) {
+    auto buffer = parser.getReadBuffer();
+    auto len = std::min(buffer.second, data.size() - consumed);
+    memcpy(buffer.first, data.data() + consumed, len);
+    parser.readDataAvailable(len);
+    consumed += len;
+  }
+}
+
+/* Request mixes mirroring the McAsciiParserTest/McServerAsciiParserTest
+   fixtures. */
+
+std::string makeMultiget(size_t nKeys) {
+  std::string request = "get";
+  for (size_t i = 0; i < nKeys; ++i) {
+    request += folly::sformat(" test:key:{}", i);
+  }
+  request += "\r\n";
+  return request;
+}
+
+std::string makeUmbrellaGetReply() {
+  UmbrellaSerializedMessage serialized;
+  McGetReply reply(mc_res_found);
+  reply.flags() = 1120;
+  reply.value().emplace(
+      folly::IOBuf(folly::IOBuf::COPY_BUFFER, "test test "));
+  const struct iovec* iovs;
+  size_t niovs;
+  CHECK(serialized.prepare(std::move(reply), 1, iovs, niovs));
+  std::string wire;
+  for (size_t i = 0; i < niovs; ++i) {
+    wire.append(
+        reinterpret_cast<const char*>(iovs[i].iov_base), iovs[i].iov_len);
+  }
+  return wire;
+}
+
+UmbrellaMessageInfo makeCaretHeaderInfo() {
+  UmbrellaMessageInfo info;
+  info.bodySize = 1024;
+  info.typeId = McGetRequest::typeId;
+  info.reqId = 12345;
+  info.version = UmbrellaVersion::TYPED_MESSAGE;
+  info.traceId = 0x123456789abcULL;
+  return info;
+}
+
+} // anonymous namespace
+
+BENCHMARK(ServerAsciiMultiget10, n) {
+  folly::BenchmarkSuspender susp;
+  ServerParserCallback callback;
+  BenchServerParser parser(callback, 4096, 16384);
+  auto request = makeMultiget(10);
+  susp.dismiss();
+  for (int iter = 0; iter < n; ++iter) {
+    feed(parser, request);
+  }
+  folly::doNotOptimizeAway(callback.requests);
+  CHECK(!callback.parseFailed);
+}
+
+BENCHMARK(ServerAsciiSet, n) {
+  folly::BenchmarkSuspender susp;
+  ServerParserCallback callback;
+  BenchServerParser parser(callback, 4096, 16384);
+  std::string request = "set test:key:12345 10 1461110400 10\r\nvalue67890\r\n";
+  susp.dismiss();
+  for (int iter = 0; iter < n; ++iter) {
+    feed(parser, request);
+  }
+  folly::doNotOptimizeAway(callback.requests);
+  CHECK(!callback.parseFailed);
+}
+
+BENCHMARK(ClientAsciiGetHitReply, n) {
+  folly::BenchmarkSuspender susp;
+  folly::IOBuf reply(
+      folly::IOBuf::COPY_BUFFER, "VALUE test 1120 10\r\ntest test \r\nEND\r\n");
+  susp.dismiss();
+  for (int iter = 0; iter < n; ++iter) {
+    McClientAsciiParser parser;
+    parser.initializeReplyParser<McGetRequest>();
+    auto buffer = reply.cloneOne();
+    auto state = parser.consume(*buffer);
+    CHECK(state == McAsciiParserBase::State::COMPLETE);
+    folly::doNotOptimizeAway(parser.getReply<McGetReply>().result());
+  }
+}
+
+BENCHMARK(UmbrellaParseGetReply, n) {
+  folly::BenchmarkSuspender susp;
+  auto wire = makeUmbrellaGetReply();
+  folly::IOBuf source(folly::IOBuf::WRAP_BUFFER, wire.data(), wire.size());
+  UmbrellaMessageInfo info;
+  CHECK(
+      umbrellaParseHeader(
+          reinterpret_cast<const uint8_t*>(wire.data()), wire.size(), info) ==
+      UmbrellaParseStatus::OK);
+  susp.dismiss();
+  for (int iter = 0; iter < n; ++iter) {
+    auto reply = umbrellaParseReply<McGetRequest>(
+        source,
+        reinterpret_cast<const uint8_t*>(wire.data()),
+        info.headerSize,
+        reinterpret_cast<const uint8_t*>(wire.data()) + info.headerSize,
+        info.bodySize);
+    folly::doNotOptimizeAway(reply.result());
+  }
+}
+
+BENCHMARK(CaretPrepareHeader, n) {
+  folly::BenchmarkSuspender susp;
+  auto info = makeCaretHeaderInfo();
+  char buf[kMaxHeaderLength];
+  susp.dismiss();
+  for (int iter = 0; iter < n; ++iter) {
+    folly::doNotOptimizeAway(caretPrepareHeader(info, buf));
+  }
+}
+
+BENCHMARK(CaretParseHeader, n) {
+  folly::BenchmarkSuspender susp;
+  auto info = makeCaretHeaderInfo();
+  char buf[kMaxHeaderLength];
+  auto headerSize = caretPrepareHeader(info, buf);
+  UmbrellaMessageInfo parsed;
+  susp.dismiss();
+  for (int iter = 0; iter < n; ++iter) {
+    auto status = caretParseHeader(
+        reinterpret_cast<const uint8_t*>(buf), headerSize, parsed);
+    CHECK(status == UmbrellaParseStatus::OK);
+    folly::doNotOptimizeAway(parsed.reqId);
+  }
+}
+
+int main(int argc, char **argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
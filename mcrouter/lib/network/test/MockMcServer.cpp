@@ -9,14 +9,21 @@
  */
 #include <signal.h>
 
+#include <algorithm>
 #include <iostream>
+#include <mutex>
+#include <random>
 #include <thread>
+#include <vector>
 
 #include <glog/logging.h>
 
 #include <folly/Format.h>
+#include <folly/Hash.h>
+#include <folly/Likely.h>
 
 #include "mcrouter/lib/McOperation.h"
+#include "mcrouter/lib/Xorshift128Plus.h"
 #include "mcrouter/lib/network/AsyncMcServer.h"
 #include "mcrouter/lib/network/AsyncMcServerWorker.h"
 #include "mcrouter/lib/network/gen/Memcache.h"
@@ -34,6 +41,8 @@
  *    integration tests;
  * 3) Serve as a Memcached mock for other project's integration tests;
  * 4) Provide an easy to follow Memcached logic reference.
+ * 5) Serve as a high-QPS backend for load tests and the replay tooling
+ *    (run multithreaded via -n; see also the -e/-l injection knobs).
  *
  * The intention is to have the same semantics as our Memcached fork.
  *
@@ -43,30 +52,82 @@
 
 using namespace facebook::memcache;
 
+/**
+ * MockMc sharded by key hash, one mutex per shard, shared by all server
+ * worker threads.  The shard count just needs to comfortably exceed the
+ * worker count to keep lock contention negligible.
+ */
+class ShardedMockMc {
+ public:
+  explicit ShardedMockMc(size_t nShards) : shards_(nShards) {}
+
+  /**
+   * Runs `f(MockMc&)` on the shard owning `key`, under that shard's
+   * lock.  Anything derived from the store (e.g. cloned values) must be
+   * done inside `f`; pointers into the store do not outlive the call.
+   */
+  template <class F>
+  auto withShard(folly::StringPiece key, F&& f)
+      -> decltype(f(std::declval<MockMc&>())) {
+    auto& shard =
+        shards_[folly::hash::fnv64_buf(key.data(), key.size()) %
+                shards_.size()];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    return f(shard.mc);
+  }
+
+  void flushAll() {
+    for (auto& shard : shards_) {
+      std::lock_guard<std::mutex> guard(shard.lock);
+      shard.mc.flushAll();
+    }
+  }
+
+ private:
+  struct Shard {
+    std::mutex lock;
+    MockMc mc;
+  };
+  std::vector<Shard> shards_;
+};
+
+constexpr size_t kStoreShards = 32;
+
 class MockMcOnRequest {
  public:
+  MockMcOnRequest(
+      std::shared_ptr<ShardedMockMc> mc,
+      folly::EventBase& evb,
+      double errorProbability,
+      uint32_t meanLatencyMs)
+      : mc_(std::move(mc)),
+        evb_(evb),
+        errorProbability_(errorProbability),
+        meanLatencyMs_(meanLatencyMs) {}
+
   void onRequest(McServerRequestContext&& ctx, McMetagetRequest&& req) {
     using Reply = McMetagetReply;
 
     auto key = req.key().fullKey().str();
 
-    auto item = mc_.get(key);
-    if (!item) {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_notfound));
-      return;
-    }
-
-    Reply reply(mc_res_found);
-    reply.exptime() = item->exptime;
-    if (key == "unknown_age") {
-      reply.age() = -1;
-    } else {
-      reply.age() = 123;
-    }
-    reply.ipAddress() = "127.0.0.1";
-    reply.ipv() = 4;
+    auto reply = mc_->withShard(key, [&](MockMc& mc) {
+      auto item = mc.get(key);
+      if (!item) {
+        return Reply(mc_res_notfound);
+      }
 
-    McServerRequestContext::reply(std::move(ctx), std::move(reply));
+      Reply r(mc_res_found);
+      r.exptime() = item->exptime;
+      if (key == "unknown_age") {
+        r.age() = -1;
+      } else {
+        r.age() = 123;
+      }
+      r.ipAddress() = "127.0.0.1";
+      r.ipv() = 4;
+      return r;
+    });
+    sendReply(std::move(ctx), std::move(reply));
   }
 
   void onRequest(McServerRequestContext&& ctx, McGetRequest&& req) {
@@ -95,16 +156,17 @@ class MockMcOnRequest {
       return;
     }
 
-    auto item = mc_.get(key);
-    if (!item) {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_notfound));
-    } else {
-      Reply reply(mc_res_found);
-      auto cloned = item->value->cloneAsValue();
-      reply.value() = std::move(cloned);
-      reply.flags() = item->flags;
-      McServerRequestContext::reply(std::move(ctx), std::move(reply));
-    }
+    auto reply = mc_->withShard(key, [&](MockMc& mc) {
+      auto item = mc.get(key);
+      if (!item) {
+        return Reply(mc_res_notfound);
+      }
+      Reply r(mc_res_found);
+      r.value() = item->value->cloneAsValue();
+      r.flags() = item->flags;
+      return r;
+    });
+    sendReply(std::move(ctx), std::move(reply));
   }
 
   void onRequest(McServerRequestContext&& ctx, McLeaseGetRequest&& req) {
@@ -112,15 +174,17 @@ class MockMcOnRequest {
 
     auto key = req.key().fullKey().str();
 
-    auto out = mc_.leaseGet(key);
-    Reply reply(mc_res_found);
-    auto cloned = out.first->value->cloneAsValue();
-    reply.value() = std::move(cloned);
-    reply.leaseToken() = out.second;
-    if (out.second) {
-      reply.result() = mc_res_notfound;
-    }
-    McServerRequestContext::reply(std::move(ctx), std::move(reply));
+    auto reply = mc_->withShard(key, [&](MockMc& mc) {
+      auto out = mc.leaseGet(key);
+      Reply r(mc_res_found);
+      r.value() = out.first->value->cloneAsValue();
+      r.leaseToken() = out.second;
+      if (out.second) {
+        r.result() = mc_res_notfound;
+      }
+      return r;
+    });
+    sendReply(std::move(ctx), std::move(reply));
   }
 
   void onRequest(McServerRequestContext&& ctx, McLeaseSetRequest&& req) {
@@ -128,34 +192,36 @@ class MockMcOnRequest {
 
     auto key = req.key().fullKey().str();
 
-    switch (mc_.leaseSet(key, MockMc::Item(req), req.leaseToken())) {
-      case MockMc::LeaseSetResult::NOT_STORED:
-        McServerRequestContext::reply(std::move(ctx), Reply(mc_res_notstored));
-        return;
-
-      case MockMc::LeaseSetResult::STORED:
-        McServerRequestContext::reply(std::move(ctx), Reply(mc_res_stored));
-        return;
-
-      case MockMc::LeaseSetResult::STALE_STORED:
-        McServerRequestContext::reply(std::move(ctx),
-                                      Reply(mc_res_stalestored));
-        return;
-    }
+    auto reply = mc_->withShard(key, [&](MockMc& mc) {
+      switch (mc.leaseSet(key, MockMc::Item(req), req.leaseToken())) {
+        case MockMc::LeaseSetResult::NOT_STORED:
+          return Reply(mc_res_notstored);
+        case MockMc::LeaseSetResult::STORED:
+          return Reply(mc_res_stored);
+        case MockMc::LeaseSetResult::STALE_STORED:
+          return Reply(mc_res_stalestored);
+      }
+      return Reply(mc_res_remote_error);
+    });
+    sendReply(std::move(ctx), std::move(reply));
   }
 
   void onRequest(McServerRequestContext&& ctx, McSetRequest&& req) {
-    McSetReply reply;
+    using Reply = McSetReply;
+
     auto key = req.key().fullKey().str();
     if (key == "__mockmc__.trigger_server_error") {
-      reply.result() = mc_res_remote_error;
+      Reply reply(mc_res_remote_error);
       reply.message() = "returned error msg with binary data \xdd\xab";
-    } else {
-      mc_.set(key, MockMc::Item(req));
-      reply.result() = mc_res_stored;
+      McServerRequestContext::reply(std::move(ctx), std::move(reply));
+      return;
     }
 
-    McServerRequestContext::reply(std::move(ctx), std::move(reply));
+    auto reply = mc_->withShard(key, [&](MockMc& mc) {
+      mc.set(key, MockMc::Item(req));
+      return Reply(mc_res_stored);
+    });
+    sendReply(std::move(ctx), std::move(reply));
   }
 
   void onRequest(McServerRequestContext&& ctx, McAddRequest&& req) {
@@ -163,11 +229,11 @@ class MockMcOnRequest {
 
     auto key = req.key().fullKey().str();
 
-    if (mc_.add(key, MockMc::Item(req))) {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_stored));
-    } else {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_notstored));
-    }
+    auto reply = mc_->withShard(key, [&](MockMc& mc) {
+      return mc.add(key, MockMc::Item(req)) ? Reply(mc_res_stored)
+                                            : Reply(mc_res_notstored);
+    });
+    sendReply(std::move(ctx), std::move(reply));
   }
 
   void onRequest(McServerRequestContext&& ctx, McReplaceRequest&& req) {
@@ -175,11 +241,11 @@ class MockMcOnRequest {
 
     auto key = req.key().fullKey().str();
 
-    if (mc_.replace(key, MockMc::Item(req))) {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_stored));
-    } else {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_notstored));
-    }
+    auto reply = mc_->withShard(key, [&](MockMc& mc) {
+      return mc.replace(key, MockMc::Item(req)) ? Reply(mc_res_stored)
+                                                : Reply(mc_res_notstored);
+    });
+    sendReply(std::move(ctx), std::move(reply));
   }
 
   void onRequest(McServerRequestContext&& ctx, McAppendRequest&& req) {
@@ -187,11 +253,11 @@ class MockMcOnRequest {
 
     auto key = req.key().fullKey().str();
 
-    if (mc_.append(key, MockMc::Item(req))) {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_stored));
-    } else {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_notstored));
-    }
+    auto reply = mc_->withShard(key, [&](MockMc& mc) {
+      return mc.append(key, MockMc::Item(req)) ? Reply(mc_res_stored)
+                                               : Reply(mc_res_notstored);
+    });
+    sendReply(std::move(ctx), std::move(reply));
   }
 
   void onRequest(McServerRequestContext&& ctx, McPrependRequest&& req) {
@@ -199,11 +265,11 @@ class MockMcOnRequest {
 
     auto key = req.key().fullKey().str();
 
-    if (mc_.prepend(key, MockMc::Item(req))) {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_stored));
-    } else {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_notstored));
-    }
+    auto reply = mc_->withShard(key, [&](MockMc& mc) {
+      return mc.prepend(key, MockMc::Item(req)) ? Reply(mc_res_stored)
+                                                : Reply(mc_res_notstored);
+    });
+    sendReply(std::move(ctx), std::move(reply));
   }
 
   void onRequest(McServerRequestContext&& ctx, McDeleteRequest&& req) {
@@ -211,11 +277,10 @@ class MockMcOnRequest {
 
     auto key = req.key().fullKey().str();
 
-    if (mc_.del(key)) {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_deleted));
-    } else {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_notfound));
-    }
+    auto reply = mc_->withShard(key, [&](MockMc& mc) {
+      return mc.del(key) ? Reply(mc_res_deleted) : Reply(mc_res_notfound);
+    });
+    sendReply(std::move(ctx), std::move(reply));
   }
 
   void onRequest(McServerRequestContext&& ctx, McTouchRequest&& req) {
@@ -223,46 +288,52 @@ class MockMcOnRequest {
 
     auto key = req.key().fullKey().str();
 
-    if (mc_.touch(key, req.exptime())) {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_touched));
-    } else {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_notfound));
-    }
+    auto reply = mc_->withShard(key, [&](MockMc& mc) {
+      return mc.touch(key, req.exptime()) ? Reply(mc_res_touched)
+                                          : Reply(mc_res_notfound);
+    });
+    sendReply(std::move(ctx), std::move(reply));
   }
 
   void onRequest(McServerRequestContext&& ctx, McIncrRequest&& req) {
     using Reply = McIncrReply;
 
     auto key = req.key().fullKey().str();
-    auto p = mc_.arith(key, req.delta());
-    if (!p.first) {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_notfound));
-    } else {
-      Reply reply(mc_res_stored);
-      reply.delta() = p.second;
-      McServerRequestContext::reply(std::move(ctx), std::move(reply));
-    }
+
+    auto reply = mc_->withShard(key, [&](MockMc& mc) {
+      auto p = mc.arith(key, req.delta());
+      if (!p.first) {
+        return Reply(mc_res_notfound);
+      }
+      Reply r(mc_res_stored);
+      r.delta() = p.second;
+      return r;
+    });
+    sendReply(std::move(ctx), std::move(reply));
   }
 
   void onRequest(McServerRequestContext&& ctx, McDecrRequest&& req) {
     using Reply = McDecrReply;
 
     auto key = req.key().fullKey().str();
-    auto p = mc_.arith(key, -req.delta());
-    if (!p.first) {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_notfound));
-    } else {
-      Reply reply(mc_res_stored);
-      reply.delta() = p.second;
-      McServerRequestContext::reply(std::move(ctx), std::move(reply));
-    }
+
+    auto reply = mc_->withShard(key, [&](MockMc& mc) {
+      auto p = mc.arith(key, -req.delta());
+      if (!p.first) {
+        return Reply(mc_res_notfound);
+      }
+      Reply r(mc_res_stored);
+      r.delta() = p.second;
+      return r;
+    });
+    sendReply(std::move(ctx), std::move(reply));
   }
 
   void onRequest(McServerRequestContext&& ctx, McFlushAllRequest&& req) {
     using Reply = McFlushAllReply;
 
     std::this_thread::sleep_for(std::chrono::seconds(req.delay()));
-    mc_.flushAll();
+    mc_->flushAll();
     McServerRequestContext::reply(std::move(ctx), Reply(mc_res_ok));
   }
 
@@ -270,34 +341,38 @@ class MockMcOnRequest {
     using Reply = McGetsReply;
 
     auto key = req.key().fullKey().str();
-    auto p = mc_.gets(key);
-    if (!p.first) {
-      McServerRequestContext::reply(std::move(ctx), Reply(mc_res_notfound));
-    } else {
-      Reply reply(mc_res_found);
-      reply.value() = p.first->value->cloneAsValue();
-      reply.flags() = p.first->flags;
-      reply.casToken() = p.second;
-      McServerRequestContext::reply(std::move(ctx), std::move(reply));
-    }
+
+    auto reply = mc_->withShard(key, [&](MockMc& mc) {
+      auto p = mc.gets(key);
+      if (!p.first) {
+        return Reply(mc_res_notfound);
+      }
+      Reply r(mc_res_found);
+      r.value() = p.first->value->cloneAsValue();
+      r.flags() = p.first->flags;
+      r.casToken() = p.second;
+      return r;
+    });
+    sendReply(std::move(ctx), std::move(reply));
   }
 
   void onRequest(McServerRequestContext&& ctx, McCasRequest&& req) {
     using Reply = McCasReply;
 
     auto key = req.key().fullKey().str();
-    auto ret = mc_.cas(key, MockMc::Item(req), req.casToken());
-    switch (ret) {
-      case MockMc::CasResult::NOT_FOUND:
-        McServerRequestContext::reply(std::move(ctx), Reply(mc_res_notfound));
-        break;
-      case MockMc::CasResult::EXISTS:
-        McServerRequestContext::reply(std::move(ctx), Reply(mc_res_exists));
-        break;
-      case MockMc::CasResult::STORED:
-        McServerRequestContext::reply(std::move(ctx), Reply(mc_res_stored));
-        break;
-    }
+
+    auto reply = mc_->withShard(key, [&](MockMc& mc) {
+      switch (mc.cas(key, MockMc::Item(req), req.casToken())) {
+        case MockMc::CasResult::NOT_FOUND:
+          return Reply(mc_res_notfound);
+        case MockMc::CasResult::EXISTS:
+          return Reply(mc_res_exists);
+        case MockMc::CasResult::STORED:
+          return Reply(mc_res_stored);
+      }
+      return Reply(mc_res_remote_error);
+    });
+    sendReply(std::move(ctx), std::move(reply));
   }
 
   template <class Unsupported>
@@ -310,16 +385,53 @@ class MockMcOnRequest {
     McServerRequestContext::reply(std::move(ctx), std::move(reply));
   }
 
-
  private:
-  MockMc mc_;
-};
+  std::shared_ptr<ShardedMockMc> mc_;
+  folly::EventBase& evb_;
+  const double errorProbability_;
+  const uint32_t meanLatencyMs_;
+  Xorshift128Plus rng_;
+
+  /**
+   * Sends the reply, applying the configured injections: with
+   * -e probability the reply is replaced by a remote error, and with
+   * -l the send is delayed by an exponentially distributed number of
+   * milliseconds (capped at 10x the mean) scheduled on the worker's
+   * event base, so injected latency does not block the worker.
+   */
+  template <class Reply>
+  void sendReply(McServerRequestContext&& ctx, Reply&& reply) {
+    if (UNLIKELY(errorProbability_ > 0.0) &&
+        rng_.randomDouble() < errorProbability_) {
+      reply = Reply(mc_res_remote_error);
+      reply.message() = "MockMcServer: injected error";
+    }
+    if (UNLIKELY(meanLatencyMs_ > 0)) {
+      const uint32_t delayMs = drawLatencyMs();
+      if (delayMs > 0) {
+        auto state = std::make_shared<std::pair<McServerRequestContext, Reply>>(
+            std::move(ctx), std::move(reply));
+        evb_.runAfterDelay(
+            [state]() {
+              McServerRequestContext::reply(
+                  std::move(state->first), std::move(state->second));
+            },
+            delayMs);
+        return;
+      }
+    }
+    McServerRequestContext::reply(std::move(ctx), std::move(reply));
+  }
 
-void serverLoop(size_t threadId, folly::EventBase& evb,
-                AsyncMcServerWorker& worker) {
-  worker.setOnRequest(MemcacheRequestHandler<MockMcOnRequest>());
-  evb.loop();
-}
+  uint32_t drawLatencyMs() {
+    const double mean = meanLatencyMs_;
+    /* Exponential distribution with the configured mean: delay =
+       -mean * ln(1 - u).  Capped to keep the tail sane. */
+    std::exponential_distribution<double> dist(1.0 / mean);
+    const double delay = std::min(dist(rng_), 10.0 * mean);
+    return static_cast<uint32_t>(delay + 0.5);
+  }
+};
 
 void usage(char** argv) {
   std::cerr <<
@@ -327,6 +439,10 @@ void usage(char** argv) {
     "  -P <port>      TCP port on which to listen\n"
     "  -t <fd>        TCP listen sock fd\n"
     "  -s             Use ssl\n"
+    "  -n <threads>   Number of server threads (default 1)\n"
+    "  -e <prob>      Reply with a remote error with this probability\n"
+    "  -l <ms>        Mean injected reply latency, exponentially\n"
+    "                 distributed (default 0: no injected latency)\n"
     "Usage:\n"
     "  $ " << argv[0] << " -p 15213\n";
   exit(1);
@@ -340,9 +456,11 @@ int main(int argc, char** argv) {
 
   bool ssl = false;
   uint16_t port = 0;
+  double errorProbability = 0.0;
+  uint32_t meanLatencyMs = 0;
 
   int c;
-  while ((c = getopt(argc, argv, "P:t:sh")) >= 0) {
+  while ((c = getopt(argc, argv, "P:t:n:e:l:sh")) >= 0) {
     switch (c) {
       case 's':
         ssl = true;
@@ -353,6 +471,15 @@ int main(int argc, char** argv) {
       case 't':
         opts.existingSocketFd = folly::to<int>(optarg);
         break;
+      case 'n':
+        opts.numThreads = folly::to<size_t>(optarg);
+        break;
+      case 'e':
+        errorProbability = folly::to<double>(optarg);
+        break;
+      case 'l':
+        meanLatencyMs = folly::to<uint32_t>(optarg);
+        break;
       default:
         usage(argv);
     }
@@ -371,11 +498,23 @@ int main(int argc, char** argv) {
     }
   }
 
+  // One store shared by all workers; both ascii and caret/umbrella
+  // clients are served (the protocol is detected per session).
+  auto mc = std::make_shared<ShardedMockMc>(kStoreShards);
+
   try {
     LOG(INFO) << "Starting server";
     AsyncMcServer server(opts);
     server.installShutdownHandler({SIGINT, SIGTERM});
-    server.spawn(&serverLoop);
+    server.spawn(
+        [mc, errorProbability, meanLatencyMs](
+            size_t /* threadId */,
+            folly::EventBase& evb,
+            AsyncMcServerWorker& worker) {
+          worker.setOnRequest(MemcacheRequestHandler<MockMcOnRequest>(
+              mc, evb, errorProbability, meanLatencyMs));
+          evb.loop();
+        });
     server.join();
     LOG(INFO) << "Shutting down";
   } catch (const std::exception& e) {
@@ -0,0 +1,142 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <sys/uio.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <folly/io/IOBuf.h>
+
+#include "mcrouter/lib/IOBufUtil.h"
+#include "mcrouter/lib/network/gen/Memcache.h"
+#include "mcrouter/lib/network/UmbrellaProtocol.h"
+
+using namespace facebook::memcache;
+
+namespace {
+
+std::string flatten(const struct iovec* iovs, size_t niovs) {
+  std::string wire;
+  for (size_t i = 0; i < niovs; ++i) {
+    wire.append(
+        reinterpret_cast<const char*>(iovs[i].iov_base), iovs[i].iov_len);
+  }
+  return wire;
+}
+
+folly::IOBuf makeChain(const std::vector<std::string>& links) {
+  auto head = folly::IOBuf::copyBuffer(links[0]);
+  for (size_t i = 1; i < links.size(); ++i) {
+    head->prependChain(folly::IOBuf::copyBuffer(links[i]));
+  }
+  return std::move(*head);
+}
+
+std::string serializeReply(McGetReply&& reply) {
+  UmbrellaSerializedMessage serialized;
+  const struct iovec* iovs;
+  size_t niovs;
+  EXPECT_TRUE(serialized.prepare(std::move(reply), 123, iovs, niovs));
+  return flatten(iovs, niovs);
+}
+
+McGetReply parseReply(const std::string& wire) {
+  folly::IOBuf source(folly::IOBuf::WRAP_BUFFER, wire.data(), wire.size());
+  UmbrellaMessageInfo info;
+  EXPECT_EQ(
+      UmbrellaParseStatus::OK,
+      umbrellaParseHeader(
+          reinterpret_cast<const uint8_t*>(wire.data()), wire.size(), info));
+  return umbrellaParseReply<McGetRequest>(
+      source,
+      reinterpret_cast<const uint8_t*>(wire.data()),
+      info.headerSize,
+      reinterpret_cast<const uint8_t*>(wire.data()) + info.headerSize,
+      info.bodySize);
+}
+
+} // anonymous namespace
+
+TEST(UmbrellaProtocol, chainedValueReply) {
+  McGetReply chained(mc_res_found);
+  chained.flags() = 1120;
+  chained.value().emplace(makeChain({"hello ", "chained ", "world"}));
+  EXPECT_TRUE(chained.value()->isChained());
+  auto wire = serializeReply(std::move(chained));
+
+  // The chained serialization must be byte-identical to the unchained one.
+  McGetReply flat(mc_res_found);
+  flat.flags() = 1120;
+  flat.value().emplace(
+      folly::IOBuf(folly::IOBuf::COPY_BUFFER, "hello chained world"));
+  EXPECT_EQ(serializeReply(std::move(flat)), wire);
+
+  auto parsed = parseReply(wire);
+  EXPECT_EQ(mc_res_found, parsed.result());
+  EXPECT_EQ(1120, parsed.flags());
+  EXPECT_EQ("hello chained world", coalesceAndGetRange(parsed.value()).str());
+}
+
+TEST(UmbrellaProtocol, longChainFallsBackToCoalescing) {
+  // More chain links than the inline iovec table can hold; the
+  // serializer must coalesce and still produce the same wire format.
+  std::vector<std::string> links;
+  std::string expected;
+  for (size_t i = 0; i < 20; ++i) {
+    links.push_back(std::string(1, static_cast<char>('a' + i)));
+    expected += links.back();
+  }
+  McGetReply reply(mc_res_found);
+  reply.value().emplace(makeChain(links));
+  auto wire = serializeReply(std::move(reply));
+
+  McGetReply flat(mc_res_found);
+  flat.value().emplace(folly::IOBuf(folly::IOBuf::COPY_BUFFER, expected));
+  EXPECT_EQ(serializeReply(std::move(flat)), wire);
+
+  auto parsed = parseReply(wire);
+  EXPECT_EQ(expected, coalesceAndGetRange(parsed.value()).str());
+}
+
+TEST(UmbrellaProtocol, chainedValueRequest) {
+  McSetRequest request("test:key:chained");
+  request.flags() = 6;
+  request.value() = makeChain({"first|", "second|", "third"});
+  EXPECT_TRUE(request.value().isChained());
+
+  UmbrellaSerializedMessage serialized;
+  const struct iovec* iovs;
+  size_t niovs;
+  ASSERT_TRUE(serialized.prepare(request, 456, iovs, niovs));
+  auto wire = flatten(iovs, niovs);
+  // Serialization must not unchain the caller's value.
+  EXPECT_TRUE(request.value().isChained());
+
+  folly::IOBuf source(folly::IOBuf::WRAP_BUFFER, wire.data(), wire.size());
+  UmbrellaMessageInfo info;
+  ASSERT_EQ(
+      UmbrellaParseStatus::OK,
+      umbrellaParseHeader(
+          reinterpret_cast<const uint8_t*>(wire.data()), wire.size(), info));
+  uint64_t reqid = 0;
+  auto parsed = umbrellaParseRequest<McSetRequest>(
+      source,
+      reinterpret_cast<const uint8_t*>(wire.data()),
+      info.headerSize,
+      reinterpret_cast<const uint8_t*>(wire.data()) + info.headerSize,
+      info.bodySize,
+      reqid);
+  EXPECT_EQ(456, reqid);
+  EXPECT_EQ("test:key:chained", parsed.key().fullKey().str());
+  EXPECT_EQ(6, parsed.flags());
+  EXPECT_EQ("first|second|third", coalesceAndGetRange(parsed.value()).str());
+}
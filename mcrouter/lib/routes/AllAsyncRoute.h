@@ -43,6 +43,11 @@ class AllAsyncRoute {
   template <class Request>
   ReplyT<Request> route(const Request& req) const {
     auto reqCopy = std::make_shared<Request>(req);
+    if (children_.size() > 1) {
+      // All tasks route the same copy, so the serialized body can be
+      // shared between the legs.
+      reqCopy->markFanout();
+    }
     for (auto& rh : children_) {
       folly::fibers::addTask(
         [rh, reqCopy]() {
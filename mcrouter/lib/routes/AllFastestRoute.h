@@ -17,6 +17,7 @@
 
 #include "mcrouter/lib/McResUtil.h"
 #include "mcrouter/lib/Operation.h"
+#include "mcrouter/lib/Reply.h"
 #include "mcrouter/lib/RouteHandleTraverser.h"
 
 namespace facebook { namespace memcache {
@@ -46,21 +47,43 @@ class AllFastestRoute {
   ReplyT<Request> route(const Request& req) const {
     using Reply = ReplyT<Request>;
 
-    std::vector<std::function<Reply()>> funcs;
-    funcs.reserve(children_.size());
-    auto reqCopy = std::make_shared<Request>(req);
-    for (auto& rh : children_) {
-      funcs.push_back(
-        [reqCopy, rh]() {
-          return rh->route(*reqCopy);
+    /**
+     * All children share one copy of the request plus a flag that is set
+     * once the winning reply is returned to the caller.  A task whose fiber
+     * first runs after that point skips the downstream request entirely:
+     * it would only generate duplicate backend load, and its reply is never
+     * observed (awaitNext() consumes replies only until route() returns,
+     * which is what sets the flag).
+     */
+    struct SharedState {
+      explicit SharedState(const Request& r) : req(r) {}
+      const Request req;
+      bool replied{false};
+    };
+    auto state = std::make_shared<SharedState>(req);
+
+    auto makeTask = [&state](const std::shared_ptr<RouteHandleIf>& rh) {
+      return [state, rh]() -> Reply {
+        if (state->replied) {
+          return createReply<Request>(ErrorReply);
         }
-      );
+        return rh->route(state->req);
+      };
+    };
+
+    // A vector of the concrete closure type: unlike std::function, this
+    // doesn't type-erase (and possibly heap-allocate) each task.
+    std::vector<decltype(makeTask(children_.front()))> funcs;
+    funcs.reserve(children_.size());
+    for (const auto& rh : children_) {
+      funcs.push_back(makeTask(rh));
     }
 
     auto taskIt = folly::fibers::addTasks(funcs.begin(), funcs.end());
     while (true) {
       auto reply = taskIt.awaitNext();
       if (!isFailoverErrorResult(reply.result()) || !taskIt.hasNext()) {
+        state->replied = true;
         return reply;
       }
     }
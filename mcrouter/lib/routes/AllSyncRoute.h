@@ -47,6 +47,12 @@ class AllSyncRoute {
   ReplyT<Request> route(const Request& req) const {
     using Reply = ReplyT<Request>;
 
+    if (children_.size() > 1) {
+      // Every child sees the same unmodified object, so the serialized
+      // body can be shared between the legs.
+      req.markFanout();
+    }
+
     const auto& children = children_;
     auto fs = makeFuncGenerator([&req, &children](size_t id) {
       return children[id]->route(req);
@@ -11,6 +11,7 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <folly/Conv.h>
@@ -60,11 +61,29 @@ class HashRoute {
   const std::string salt_;
   const HashFunc hashFunc_;
 
+  /**
+   * Preferred overload: hash functions that accept a precomputed key
+   * hash get the memoized one off the request, so the pass over the key
+   * bytes is shared between all hash routes the request descends
+   * through.
+   */
+  template <class Request>
+  auto pickUnsalted(const Request& req, int) const
+      -> decltype(std::declval<const HashFunc&>()(
+             req.key().routingKey(), req.key().routingKeyFurcHash())) {
+    return hashFunc_(req.key().routingKey(), req.key().routingKeyFurcHash());
+  }
+
+  template <class Request>
+  size_t pickUnsalted(const Request& req, ...) const {
+    return hashFunc_(req.key().routingKey());
+  }
+
   template <class Request>
   size_t pick(const Request& req) const {
     size_t n = 0;
     if (salt_.empty()) {
-      n = hashFunc_(req.key().routingKey());
+      n = pickUnsalted(req, 0);
     } else {
       // fast string concatenation
       char c[kMaxKeySaltSize];
@@ -11,6 +11,7 @@
 
 #include <memory>
 #include <string>
+#include <unordered_set>
 
 #include <folly/fibers/FiberManager.h>
 #include <folly/io/IOBuf.h>
@@ -94,15 +95,29 @@ class L1L2CacheRoute {
     /* else */
     auto l2Reply = l2_->route(req);
     if (isHitResult(l2Reply.result())) {
-      folly::fibers::addTask([
-        l1 = l1_,
-        addReq = l1UpdateFromL2<McAddRequest>(req, l2Reply, upgradingL1Exptime_)
-      ]() { l1->route(addReq); });
+      if (startL1Fill(req.key().fullKey())) {
+        folly::fibers::addTask([
+          l1 = l1_,
+          pending = pendingL1Fills_,
+          key = req.key().fullKey().str(),
+          addReq =
+              l1UpdateFromL2<McAddRequest>(req, l2Reply, upgradingL1Exptime_)
+        ]() {
+          l1->route(addReq);
+          pending->erase(key);
+        });
+      }
     } else if (isMissResult(l2Reply.result()) && ncacheUpdatePeriod_) {
-      folly::fibers::addTask(
-          [l1 = l1_, addReq = l1Ncache<McAddRequest>(req, ncacheExptime_)]() {
-            l1->route(addReq);
-          });
+      if (startL1Fill(req.key().fullKey())) {
+        folly::fibers::addTask(
+            [l1 = l1_,
+             pending = pendingL1Fills_,
+             key = req.key().fullKey().str(),
+             addReq = l1Ncache<McAddRequest>(req, ncacheExptime_)]() {
+              l1->route(addReq);
+              pending->erase(key);
+            });
+      }
     }
     return l2Reply;
   }
@@ -121,6 +136,22 @@ class L1L2CacheRoute {
   size_t ncacheExptime_{0};
   size_t ncacheUpdatePeriod_{0};
   size_t ncacheUpdateCounter_{0};
+  /* Keys with an L1 fill currently in flight.  Shared with the fill tasks,
+     which may outlive this route handle on config swap. */
+  const std::shared_ptr<std::unordered_set<std::string>> pendingL1Fills_{
+      std::make_shared<std::unordered_set<std::string>>()};
+
+  /**
+   * Marks an asynchronous L1 fill for 'key' as in flight.
+   *
+   * @return true if the caller should issue the fill, false if some
+   *         earlier request is already filling this key.  Dedups the
+   *         herd of identical L1 adds that a hot key generates when many
+   *         concurrent requests miss L1 before the first fill lands.
+   */
+  bool startL1Fill(folly::StringPiece key) {
+    return pendingL1Fills_->emplace(key.str()).second;
+  }
 
   template <class ToRequest, class Request, class Reply>
   static ToRequest l1UpdateFromL2(const Request& origReq,
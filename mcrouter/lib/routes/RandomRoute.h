@@ -9,14 +9,13 @@
  */
 #pragma once
 
-#include <chrono>
 #include <memory>
-#include <random>
 #include <string>
 #include <vector>
 
 #include "mcrouter/lib/McOperation.h"
 #include "mcrouter/lib/RouteHandleTraverser.h"
+#include "mcrouter/lib/Xorshift128Plus.h"
 
 namespace facebook { namespace memcache {
 
@@ -35,20 +34,19 @@ class RandomRoute {
   }
 
   explicit RandomRoute(std::vector<std::shared_ptr<RouteHandleIf>> children)
-      : children_(std::move(children)),
-        gen_(std::ranlux24_base(
-              std::chrono::system_clock::now().time_since_epoch().count())) {
+      : children_(std::move(children)) {
     assert(!children_.empty());
   }
 
   template <class Request>
   ReplyT<Request> route(const Request& req) {
-    return children_[gen_() % children_.size()]->route(req);
+    return children_[gen_.randomInt(children_.size())]->route(req);
   }
 
  private:
   const std::vector<std::shared_ptr<RouteHandleIf>> children_;
-  std::ranlux24_base gen_;
+  /* Route handles belong to a single proxy thread, so no locking. */
+  Xorshift128Plus gen_;
 };
 
 }} // facebook::memcache
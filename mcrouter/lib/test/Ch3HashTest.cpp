@@ -48,6 +48,17 @@ TEST(Ch3Func, basic) {
   EXPECT_TRUE(67101 == func_99999(test_max_key));
 }
 
+TEST(Ch3Func, precomputedKeyHash) {
+  Ch3HashFunc func_100(100);
+  Ch3HashFunc func_99999(99999);
+  for (size_t i = 0; i < 1000; ++i) {
+    auto key = folly::to<std::string>("key:", i);
+    auto keyHash = furc_key_hash(key.data(), key.size());
+    EXPECT_EQ(func_100(key), func_100(key, keyHash));
+    EXPECT_EQ(func_99999(key), func_99999(key, keyHash));
+  }
+}
+
 TEST(Ch3Func, ch3_3) {
   Ch3HashFunc ch3_func_3(3);
   std::vector<size_t> ch3_counts(3, 0);
@@ -0,0 +1,286 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <dirent.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/io/IOBuf.h>
+
+#include "mcrouter/lib/Compression.h"
+
+/**
+ * Codec benchmark harness.
+ *
+ * Runs every codec type (LZ4, LZ4Immutable, zstd at several levels)
+ * over a corpus of captured values and reports compression ratio and
+ * throughput per codec and value-size bucket, so codec and level
+ * choices in flavor configs can be driven by measurements.
+ *
+ * Usage: mcrouter_compression_benchmark [corpus_dir] [dictionary_file]
+ *
+ *   corpus_dir       Directory of files, one captured value per file.
+ *                    Without it, a synthetic JSON-ish corpus is used.
+ *   dictionary_file  Optional compression dictionary. Without it, one
+ *                    is synthesized from the corpus.
+ */
+
+using namespace facebook::memcache;
+
+namespace {
+
+constexpr size_t kMaxDictionarySize = 16 * 1024;
+const std::vector<uint32_t> kZstdLevels = {1, 4, 8, 12, 19};
+
+// Value-size buckets, upper bounds inclusive.
+const std::vector<std::pair<size_t, const char*>> kBuckets = {
+    {512, "<=512B"},
+    {4 * 1024, "<=4KiB"},
+    {32 * 1024, "<=32KiB"},
+    {256 * 1024, "<=256KiB"},
+    {std::numeric_limits<size_t>::max(), ">256KiB"},
+};
+
+size_t bucketOf(size_t size) {
+  size_t i = 0;
+  while (size > kBuckets[i].first) {
+    ++i;
+  }
+  return i;
+}
+
+std::vector<std::string> loadCorpus(const char* dir) {
+  std::vector<std::string> corpus;
+  DIR* d = opendir(dir);
+  if (d == nullptr) {
+    fprintf(stderr, "Cannot open corpus directory '%s'\n", dir);
+    return corpus;
+  }
+  while (struct dirent* entry = readdir(d)) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    std::string path = std::string(dir) + "/" + entry->d_name;
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      continue;
+    }
+    std::string value(
+        (std::istreambuf_iterator<char>(file)),
+        std::istreambuf_iterator<char>());
+    if (!value.empty()) {
+      corpus.push_back(std::move(value));
+    }
+  }
+  closedir(d);
+  return corpus;
+}
+
+std::vector<std::string> syntheticCorpus() {
+  std::mt19937 gen(1234);
+  const char* words[] = {"alpha", "bravo", "charlie", "delta", "echo"};
+  std::vector<std::string> corpus;
+  for (size_t sizeTarget : {200, 2000, 20000, 100000, 500000}) {
+    for (size_t i = 0; i < 200; ++i) {
+      std::string v = "{\"payload\":\"";
+      while (v.size() < sizeTarget) {
+        v += words[gen() % 5];
+        v += ':';
+        v += std::to_string(gen() % 1000);
+        v += ',';
+      }
+      v += "\"}";
+      corpus.push_back(std::move(v));
+    }
+  }
+  return corpus;
+}
+
+std::string makeDictionary(const std::vector<std::string>& corpus) {
+  // Crude but serviceable: concatenate corpus prefixes. Pass a real
+  // trained dictionary as the second argument for meaningful ratios.
+  std::string dictionary;
+  for (const auto& value : corpus) {
+    if (dictionary.size() >= kMaxDictionarySize) {
+      break;
+    }
+    dictionary.append(
+        value, 0, std::min(value.size(), kMaxDictionarySize - dictionary.size()));
+  }
+  return dictionary;
+}
+
+struct Result {
+  size_t count{0};
+  size_t uncompressedBytes{0};
+  size_t compressedBytes{0};
+  double compressMBps{0};
+  double uncompressMBps{0};
+};
+
+double elapsedSeconds(
+    std::chrono::steady_clock::time_point begin,
+    std::chrono::steady_clock::time_point end) {
+  return std::chrono::duration<double>(end - begin).count();
+}
+
+/**
+ * Runs one codec over one bucket's values, repeating passes until each
+ * phase accumulates enough wall time to be stable.
+ */
+Result runCodec(
+    CompressionCodec& codec, const std::vector<const std::string*>& values) {
+  constexpr double kMinSeconds = 0.2;
+  constexpr size_t kMaxPasses = 200;
+
+  Result result;
+  for (const auto* value : values) {
+    result.uncompressedBytes += value->size();
+  }
+  result.count = values.size();
+
+  // Correctness pass: also records compressed sizes for the ratio.
+  for (const auto* value : values) {
+    auto compressed = codec.compress(value->data(), value->size());
+    result.compressedBytes += compressed->computeChainDataLength();
+    auto uncompressed = codec.uncompress(*compressed, value->size());
+    auto flat = uncompressed->coalesce();
+    if (flat.size() != value->size() ||
+        memcmp(flat.data(), value->data(), flat.size()) != 0) {
+      fprintf(stderr, "Roundtrip mismatch! Results are not trustworthy.\n");
+    }
+  }
+
+  double compressSeconds = 0;
+  size_t compressPasses = 0;
+  while (compressPasses < kMaxPasses && compressSeconds < kMinSeconds) {
+    auto begin = std::chrono::steady_clock::now();
+    for (const auto* value : values) {
+      codec.compress(value->data(), value->size());
+    }
+    compressSeconds += elapsedSeconds(begin, std::chrono::steady_clock::now());
+    ++compressPasses;
+  }
+
+  std::vector<std::unique_ptr<folly::IOBuf>> compressed;
+  compressed.reserve(values.size());
+  for (const auto* value : values) {
+    compressed.push_back(codec.compress(value->data(), value->size()));
+  }
+  double uncompressSeconds = 0;
+  size_t uncompressPasses = 0;
+  while (uncompressPasses < kMaxPasses && uncompressSeconds < kMinSeconds) {
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < values.size(); ++i) {
+      codec.uncompress(*compressed[i], values[i]->size());
+    }
+    uncompressSeconds +=
+        elapsedSeconds(begin, std::chrono::steady_clock::now());
+    ++uncompressPasses;
+  }
+
+  // MB/s counts uncompressed bytes crossing the codec, both directions.
+  const double megabytes = result.uncompressedBytes / 1e6;
+  result.compressMBps = megabytes * compressPasses / compressSeconds;
+  result.uncompressMBps = megabytes * uncompressPasses / uncompressSeconds;
+  return result;
+}
+
+void report(const char* codecName, const char* bucketName, const Result& r) {
+  if (r.count == 0) {
+    return;
+  }
+  printf(
+      "%-18s %-9s %6zu  %5.3f  %10.1f  %10.1f\n",
+      codecName,
+      bucketName,
+      r.count,
+      static_cast<double>(r.compressedBytes) / r.uncompressedBytes,
+      r.compressMBps,
+      r.uncompressMBps);
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+  auto corpus = argc > 1 ? loadCorpus(argv[1]) : syntheticCorpus();
+  if (corpus.empty()) {
+    fprintf(stderr, "Empty corpus, nothing to do.\n");
+    return 1;
+  }
+
+  std::string dictionary;
+  if (argc > 2) {
+    std::ifstream file(argv[2], std::ios::binary);
+    dictionary.assign(
+        (std::istreambuf_iterator<char>(file)),
+        std::istreambuf_iterator<char>());
+  }
+  if (dictionary.empty()) {
+    dictionary = makeDictionary(corpus);
+  }
+
+  std::vector<std::vector<const std::string*>> buckets(kBuckets.size());
+  for (const auto& value : corpus) {
+    buckets[bucketOf(value.size())].push_back(&value);
+  }
+
+  struct NamedCodec {
+    std::string name;
+    std::unique_ptr<CompressionCodec> codec;
+  };
+  std::vector<NamedCodec> codecs;
+  uint32_t id = 1;
+  auto add = [&](std::string name, CompressionCodecType type, uint32_t level) {
+    try {
+      auto codec = createCompressionCodec(
+          type,
+          folly::IOBuf::copyBuffer(dictionary),
+          id++,
+          FilteringOptions(),
+          level);
+      if (codec != nullptr) {
+        codecs.push_back({std::move(name), std::move(codec)});
+      } else {
+        fprintf(stderr, "%s: not available in this build\n", name.c_str());
+      }
+    } catch (const std::exception& e) {
+      fprintf(stderr, "%s: %s\n", name.c_str(), e.what());
+    }
+  };
+  add("LZ4", CompressionCodecType::LZ4, 1);
+  add("LZ4Immutable", CompressionCodecType::LZ4Immutable, 1);
+  for (auto level : kZstdLevels) {
+    add("ZSTD-" + std::to_string(level), CompressionCodecType::ZSTD, level);
+  }
+
+  printf(
+      "%-18s %-9s %6s  %5s  %10s  %10s\n",
+      "codec", "bucket", "n", "ratio", "comp MB/s", "uncomp MB/s");
+  for (const auto& namedCodec : codecs) {
+    for (size_t i = 0; i < kBuckets.size(); ++i) {
+      if (buckets[i].empty()) {
+        continue;
+      }
+      auto r = runCodec(*namedCodec.codec, buckets[i]);
+      report(namedCodec.name.c_str(), kBuckets[i].second, r);
+    }
+  }
+  return 0;
+}
@@ -356,6 +356,47 @@ void buildCodecConfigs(
               true /* isEnabled */)));
 }
 
+TEST(CompressionCodecManager, updateCodecConfigs) {
+  std::unordered_map<uint32_t, CodecConfigPtr> codecConfigs;
+  for (uint32_t i = 1; i <= 4; ++i) {
+    codecConfigs.emplace(
+        i,
+        folly::make_unique<CodecConfig>(
+            i, CompressionCodecType::LZ4, createBinaryData(i * 1024)));
+  }
+
+  CompressionCodecManager codecManager(std::move(codecConfigs));
+  auto oldMap = codecManager.getCodecMap();
+  EXPECT_EQ(1, oldMap->getIdRange().firstId);
+  EXPECT_EQ(4, oldMap->getIdRange().size);
+
+  // Roll over to a disjoint set of dictionaries.
+  std::unordered_map<uint32_t, CodecConfigPtr> newConfigs;
+  for (uint32_t i = 5; i <= 10; ++i) {
+    newConfigs.emplace(
+        i,
+        folly::make_unique<CodecConfig>(
+            i, CompressionCodecType::LZ4, createBinaryData(i * 1024)));
+  }
+  codecManager.updateCodecConfigs(std::move(newConfigs));
+
+  auto newMap = codecManager.getCodecMap();
+  EXPECT_NE(oldMap, newMap);
+  EXPECT_EQ(5, newMap->getIdRange().firstId);
+  EXPECT_EQ(6, newMap->getIdRange().size);
+  for (uint32_t i = 5; i <= 10; ++i) {
+    validateCodec(newMap->get(i));
+  }
+  EXPECT_FALSE(newMap->get(2));
+
+  // The old generation must stay usable, so connections that negotiated
+  // before the rollover keep decoding.
+  validateCodec(oldMap->get(2));
+
+  // No new generation until the next rollover.
+  EXPECT_EQ(newMap, codecManager.getCodecMap());
+}
+
 TEST(CompressionCodecManager, getBest_validateCodecs) {
   std::unordered_map<uint32_t, CodecConfigPtr> codecConfigs;
   buildCodecConfigs(codecConfigs);
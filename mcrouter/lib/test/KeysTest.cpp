@@ -0,0 +1,128 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <folly/io/IOBuf.h>
+
+#include "mcrouter/lib/carbon/Keys.h"
+
+using carbon::Keys;
+
+namespace {
+
+template <class K>
+bool storedInline(const K& key) {
+  auto data = key.fullKey().data();
+  auto obj = reinterpret_cast<const char*>(&key);
+  return data >= obj && data < obj + sizeof(key);
+}
+
+} // anonymous
+
+TEST(Keys, shortKeyStoredInline) {
+  Keys<folly::IOBuf> key("foo:bar");
+  EXPECT_EQ("foo:bar", key.fullKey().str());
+  EXPECT_TRUE(storedInline(key));
+}
+
+TEST(Keys, longKeyOnHeap) {
+  std::string longKey(100, 'x');
+  Keys<folly::IOBuf> key{folly::StringPiece(longKey)};
+  EXPECT_EQ(longKey, key.fullKey().str());
+  EXPECT_FALSE(storedInline(key));
+}
+
+TEST(Keys, routingPiecesParsedInline) {
+  Keys<folly::IOBuf> key("/region/cluster/foo:key|#|etc");
+  EXPECT_EQ("/region/cluster/", key.routingPrefix().str());
+  EXPECT_EQ("foo:key|#|etc", key.keyWithoutRoute().str());
+  EXPECT_EQ("foo:key", key.routingKey().str());
+}
+
+TEST(Keys, copyIsSelfContained) {
+  Keys<folly::IOBuf> a("/r/c/short");
+  Keys<folly::IOBuf> b(a);
+  EXPECT_EQ(a.fullKey().str(), b.fullKey().str());
+  EXPECT_TRUE(storedInline(b));
+  EXPECT_EQ("/r/c/", b.routingPrefix().str());
+  EXPECT_EQ("short", b.keyWithoutRoute().str());
+}
+
+TEST(Keys, moveIsSelfContained) {
+  Keys<folly::IOBuf> a("abcdef");
+  Keys<folly::IOBuf> b(std::move(a));
+  EXPECT_EQ("abcdef", b.fullKey().str());
+  EXPECT_TRUE(storedInline(b));
+}
+
+TEST(Keys, copyPreservesStrippedPrefix) {
+  Keys<folly::IOBuf> a("/r/c/key");
+  a.stripRoutingPrefix();
+  EXPECT_EQ("key", a.fullKey().str());
+  Keys<folly::IOBuf> b(a);
+  EXPECT_EQ("key", b.fullKey().str());
+  EXPECT_TRUE(b.routingPrefix().empty());
+  EXPECT_EQ("key", b.keyWithoutRoute().str());
+}
+
+TEST(Keys, smallExternalBufferCapturedInline) {
+  folly::IOBuf buf(folly::IOBuf::COPY_BUFFER, "xyz", 3);
+  Keys<folly::IOBuf> key;
+  key = std::move(buf);
+  EXPECT_EQ("xyz", key.fullKey().str());
+  EXPECT_TRUE(storedInline(key));
+}
+
+TEST(Keys, reassignAcrossSizeBoundary) {
+  std::string longKey(200, 'y');
+  Keys<folly::IOBuf> key{folly::StringPiece(longKey)};
+  key = folly::StringPiece("tiny");
+  EXPECT_TRUE(storedInline(key));
+  key = folly::StringPiece(longKey);
+  EXPECT_FALSE(storedInline(key));
+  EXPECT_EQ(longKey, key.fullKey().str());
+}
+
+TEST(Keys, survivesContainerReallocation) {
+  std::vector<Keys<folly::IOBuf>> keys;
+  for (int i = 0; i < 100; ++i) {
+    keys.emplace_back(folly::StringPiece("/a/b/somekey"));
+  }
+  for (const auto& key : keys) {
+    EXPECT_EQ("/a/b/somekey", key.fullKey().str());
+    EXPECT_EQ("somekey", key.routingKey().str());
+    EXPECT_TRUE(storedInline(key));
+  }
+}
+
+TEST(Keys, routingKeyFurcHashMemoized) {
+  Keys<folly::IOBuf> key("/r/c/foo:key|#|etc");
+  auto routingKey = key.routingKey();
+  EXPECT_EQ(furc_key_hash(routingKey.begin(), routingKey.size()),
+            key.routingKeyFurcHash());
+
+  Keys<folly::IOBuf> copy(key);
+  EXPECT_EQ(key.routingKeyFurcHash(), copy.routingKeyFurcHash());
+
+  key = folly::StringPiece("other:key");
+  EXPECT_EQ(furc_key_hash("other:key", 9), key.routingKeyFurcHash());
+}
+
+TEST(Keys, stringStorageUnchanged) {
+  Keys<std::string> key("/r/c/foo");
+  EXPECT_EQ("/r/c/", key.routingPrefix().str());
+  Keys<std::string> copy(key);
+  EXPECT_EQ("/r/c/foo", copy.fullKey().str());
+  Keys<std::string> moved(std::move(copy));
+  EXPECT_EQ("foo", moved.keyWithoutRoute().str());
+}
@@ -299,6 +299,34 @@ TEST(Lz4Immutable, chained_ascii) {
   auto decompressedStr = decompressed->moveToFbString();
   EXPECT_EQ(sourceStr, decompressedStr);
 }
+TEST(Lz4Immutable, batch) {
+  auto dictionary = getAsciiDictionary();
+  Lz4Immutable compressor(dictionary->clone());
+
+  std::vector<std::unique_ptr<folly::IOBuf>> values;
+  std::vector<const folly::IOBuf*> sources;
+  for (size_t i = 0; i < 32; ++i) {
+    values.push_back(getRandomAsciiData(16, 1024));
+    sources.push_back(values.back().get());
+  }
+
+  auto batch = compressor.compressBatch(sources);
+  ASSERT_EQ(sources.size(), batch.size());
+
+  for (size_t i = 0; i < batch.size(); ++i) {
+    // Batch output is byte-identical to the single-value output.
+    auto single = compressor.compress(*values[i]);
+    EXPECT_TRUE(folly::IOBufEqual()(*single, *batch[i]));
+
+    auto sourceSize = values[i]->computeChainDataLength();
+    auto decompressed = compressor.decompress(*batch[i], sourceSize);
+    EXPECT_EQ(sourceSize, decompressed->computeChainDataLength());
+    auto sourceStr = values[i]->clone()->moveToFbString();
+    auto decompressedStr = decompressed->moveToFbString();
+    EXPECT_EQ(sourceStr, decompressedStr);
+  }
+}
+
 TEST(Lz4Immutable, chained_binary) {
   auto dictionary = getRandomBinaryData(64 * 1024);
   Lz4Immutable compressor(dictionary->clone());
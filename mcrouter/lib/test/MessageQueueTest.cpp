@@ -0,0 +1,134 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mcrouter/lib/MessageQueue.h"
+
+using facebook::memcache::MessageQueue;
+using facebook::memcache::Notifier;
+
+namespace {
+
+int64_t zeroNowUsec() {
+  return 0;
+}
+
+int64_t fakeTimeUsec = 0;
+
+int64_t fakeNowUsec() {
+  return fakeTimeUsec;
+}
+
+} // anonymous
+
+TEST(MessageQueue, drainsRingAndSpill) {
+  // (producer, sequence) pairs.
+  using Message = std::pair<size_t, size_t>;
+
+  constexpr size_t kProducers = 4;
+  constexpr size_t kPerProducer = 20000;
+  // Tiny ring, so the bulk of the traffic goes through the spill buffer.
+  constexpr size_t kCapacity = 16;
+
+  std::vector<size_t> nextSeq(kProducers, 0);
+  size_t total = 0;
+
+  MessageQueue<Message> queue(
+      kCapacity,
+      [&nextSeq, &total](Message&& msg) {
+        ASSERT_LT(msg.first, nextSeq.size());
+        // Messages of one producer must arrive in the order it sent them.
+        EXPECT_EQ(nextSeq[msg.first], msg.second);
+        ++nextSeq[msg.first];
+        ++total;
+      },
+      /* noNotifyRate */ 0,
+      /* targetLatencyUs */ 0,
+      /* waitThreshold */ 0,
+      &zeroNowUsec,
+      /* notifyCallback */ nullptr);
+
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&queue, p]() {
+      for (size_t s = 0; s < kPerProducer; ++s) {
+        queue.blockingWriteRelaxed(p, s);
+      }
+    });
+  }
+
+  while (total < kProducers * kPerProducer) {
+    queue.drain();
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+
+  EXPECT_EQ(kProducers * kPerProducer, total);
+  for (size_t p = 0; p < kProducers; ++p) {
+    EXPECT_EQ(kPerProducer, nextSeq[p]);
+  }
+}
+
+TEST(MessageQueue, adaptiveNotifyPeriod) {
+  fakeTimeUsec = 0;
+  Notifier notifier(
+      /* noNotifyRate */ 0,
+      /* targetLatencyUs */ 50,
+      /* waitThresholdUs */ 0,
+      &fakeNowUsec);
+  EXPECT_EQ(0, notifier.currentNotifyPeriod());
+
+  // One message per microsecond with instant wakeups: the full budget
+  // goes to skipped notifications, so the period converges to 51 (up to
+  // 50 one-us gaps of added wait plus the triggering message).
+  for (size_t i = 0; i < 2000000; ++i) {
+    notifier.bumpMessages();
+  }
+  fakeTimeUsec = 2000000;
+  notifier.maybeUpdatePeriod();
+  EXPECT_EQ(51, notifier.currentNotifyPeriod());
+
+  // Slow wakeups eat into the budget, shrinking the period.
+  for (size_t i = 0; i < 64; ++i) {
+    EXPECT_TRUE(notifier.shouldNotify());
+    fakeTimeUsec += 40;
+    notifier.drainWhileNonEmpty([]() {});
+  }
+  auto measured = notifier.wakeupLatencyUs();
+  EXPECT_LT(0, measured);
+  EXPECT_GE(40, measured);
+  for (size_t i = 0; i < 2000000; ++i) {
+    notifier.bumpMessages();
+  }
+  fakeTimeUsec += 2000000;
+  notifier.maybeUpdatePeriod();
+  EXPECT_LE(2, notifier.currentNotifyPeriod());
+  EXPECT_GE(50 - measured + 1, notifier.currentNotifyPeriod());
+
+  // Once the wakeup alone blows the budget, fall back to notifying on
+  // every message.
+  for (size_t i = 0; i < 64; ++i) {
+    EXPECT_TRUE(notifier.shouldNotify());
+    fakeTimeUsec += 1000;
+    notifier.drainWhileNonEmpty([]() {});
+  }
+  EXPECT_LT(50, notifier.wakeupLatencyUs());
+  for (size_t i = 0; i < 2000000; ++i) {
+    notifier.bumpMessages();
+  }
+  fakeTimeUsec += 2000000;
+  notifier.maybeUpdatePeriod();
+  EXPECT_EQ(0, notifier.currentNotifyPeriod());
+}
@@ -0,0 +1,44 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <cstring>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "mcrouter/lib/RequestArena.h"
+
+using facebook::memcache::RequestArena;
+
+TEST(RequestArena, concat) {
+  RequestArena arena;
+  auto key = arena.concat({"/a/b/", std::string("foo"), "key"});
+  EXPECT_EQ("/a/b/fookey", key.str());
+}
+
+TEST(RequestArena, allocationsStayValid) {
+  RequestArena arena;
+  auto first = arena.concat({"first"});
+  /* Push well past the inline buffer. */
+  for (int i = 0; i < 1000; ++i) {
+    auto p = arena.allocate(100);
+    memset(p, 'x', 100);
+  }
+  auto big = arena.concat({std::string(4096, 'y'), "tail"});
+  EXPECT_EQ("first", first.str());
+  EXPECT_EQ(std::string(4096, 'y') + "tail", big.str());
+}
+
+TEST(RequestArena, reset) {
+  RequestArena arena;
+  arena.concat({std::string(2048, 'z')});
+  arena.reset();
+  auto key = arena.concat({"after", "reset"});
+  EXPECT_EQ("afterreset", key.str());
+}
@@ -434,15 +434,16 @@ int main(int argc, char **argv) {
 
     if (validate_configs == ValidateConfigMode::EXIT) {
       try {
-        auto router = McrouterInstance::init("standalone-validate", opts);
-        if (router == nullptr) {
-          throw std::runtime_error("Couldn't create mcrouter");
+        /* Validation-only: builds one route tree without spawning
+           proxies or connecting destinations. */
+        if (!McrouterInstance::validateConfig(opts)) {
+          throw std::runtime_error("Couldn't validate config");
         }
       } catch (const std::exception& e) {
-        LOG(ERROR) << "CRITICAL: Failed to initialize mcrouter: " << e.what();
+        LOG(ERROR) << "CRITICAL: Failed to validate config: " << e.what();
         exit(kExitStatusUnrecoverableError);
       } catch (...) {
-        LOG(ERROR) << "CRITICAL: Failed to initialize mcrouter";
+        LOG(ERROR) << "CRITICAL: Failed to validate config";
         exit(kExitStatusUnrecoverableError);
       }
 
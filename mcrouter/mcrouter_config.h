@@ -73,6 +73,16 @@ struct ProxyStatsContainer {
 
 struct AdditionalProxyRequestLogger {
   explicit AdditionalProxyRequestLogger(Proxy*) {}
+
+  /**
+   * Cheap sampling predicate consulted before a RequestLoggerContext is
+   * materialized for log(): string views and the routing key hash are
+   * only computed for replies this returns true for.
+   */
+  constexpr bool shouldLog() const {
+    return false;
+  }
+
   /**
    * Called once a reply is received to record a stats sample if required.
    */
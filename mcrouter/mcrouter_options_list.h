@@ -66,11 +66,48 @@ mcrouter_option_toggle(
   "use-asynclog-version2", no_short,
   "Enable using the asynclog version 2.0")
 
+mcrouter_option_toggle(
+  use_asynclog_binary_format, false,
+  "use-asynclog-binary-format", no_short,
+  "Spool asynclog entries in the compact binary format instead of JSON"
+  " lines. Spools can be converted for JSON consumers with"
+  " mcasynclogconvert.")
+
+mcrouter_option_integer(
+  size_t, asynclog_num_threads, 1,
+  "asynclog-num-threads", no_short,
+  "Number of asynclog writer threads. Entries are sharded over them by"
+  " key hash and every thread appends to its own spool file.")
+
+mcrouter_option_integer(
+  size_t, asynclog_dedupe_window_ms, 0,
+  "asynclog-dedupe-window-ms", no_short,
+  "If nonzero, skip spooling an asynclog delete when an identical one"
+  " (same key, destination and pool) was already spooled within roughly"
+  " this many milliseconds. Cuts replay volume during invalidation"
+  " storms that delete the same keys repeatedly. 0 to disable.")
+
 mcrouter_option_integer(
   size_t, num_proxies, DEFAULT_NUM_PROXIES,
   "num-proxies", no_short,
   "adjust how many proxy threads to run")
 
+mcrouter_option_toggle(
+  background_proxy_init, false,
+  "background-proxy-init", no_short,
+  "Return from initialization as soon as the first proxy is configured"
+  " and serving; configure and start the remaining proxies from a"
+  " background thread. New clients are assigned to already-started"
+  " proxies in the meantime. Only applies when mcrouter owns the proxy"
+  " threads (i.e. not with user event bases).")
+
+mcrouter_option_toggle(
+  numa_aware, false,
+  "numa-aware", no_short,
+  "Pin proxy threads round-robin to NUMA nodes and prefer node-local"
+  " memory for their allocations.  No-op if mcrouter was built without"
+  " libnuma or the host has a single node.")
+
 mcrouter_option_integer(
   size_t, client_queue_size, 1024,
   no_long, no_short,
@@ -84,6 +121,14 @@ mcrouter_option_integer(
   " best effort avoid notifying twice.  Higher values decrease CPU utilization,"
   " but increase average latency.")
 
+mcrouter_option_integer(
+  size_t, client_queue_target_latency_us, 0,
+  no_long, no_short,
+  "If nonzero, adapt the client queue notification period automatically,"
+  " from measured message inter-arrival and wakeup latency, so that"
+  " skipped notifications add at most this many microseconds of queueing"
+  " latency.  Takes precedence over client_queue_no_notify_rate.")
+
 mcrouter_option_integer(
   size_t, client_queue_wait_threshold_us, 0,
   no_long, no_short,
@@ -165,12 +210,93 @@ mcrouter_option_integer(
   "keepalive-idle", 'I',
   "set TCP KEEPALIVE idle parameter in seconds")
 
+mcrouter_option_toggle(
+  proxy_busy_loop, false,
+  "proxy-busy-loop", no_short,
+  "Spin proxy event loops with nonblocking polls instead of sleeping in"
+  " epoll_wait, falling back to short adaptive sleeps after idle windows."
+  " Trades a core per proxy thread for wakeup latency; intended for"
+  " latency-critical deployments.")
+
+mcrouter_option_integer(
+  unsigned int, socket_busy_poll_us, 0,
+  "socket-busy-poll-us", no_short,
+  "If non-zero, sets SO_BUSY_POLL on destination connections (and on"
+  " accepted client connections in standalone mode) so the kernel"
+  " busy-polls the device queue for up to this many microseconds before"
+  " sleeping in a blocking receive. If 0, the option is not set.")
+
+mcrouter_option_integer(
+  uint32_t, tcp_notsent_lowat, 0,
+  "tcp-notsent-lowat", no_short,
+  "If non-zero, sets TCP_NOTSENT_LOWAT on destination connections so"
+  " the kernel only accepts this many bytes of not-yet-sent data."
+  " Requests that would back up behind a full socket buffer are then"
+  " shed with a busy reply (and can fail over) instead of queueing"
+  " until they time out. If 0, the option is not set.")
+
+mcrouter_option_toggle(
+  tcp_fastopen, false,
+  "tcp-fastopen", no_short,
+  "If set, enables TCP Fast Open (TCP_FASTOPEN_CONNECT) on destination"
+  " connections: once the kernel holds a Fast Open cookie for a"
+  " destination, the first request after a reconnect is carried in the"
+  " SYN instead of waiting out the handshake round trip. No-op on"
+  " kernels without support.")
+
+mcrouter_option_toggle(
+  standby_connections, false,
+  "standby-connections", no_short,
+  "Keep one warm standby socket per destination connection while it is"
+  " up, and adopt it instantly when the connection drops, so reconnects"
+  " skip the connect round trip. Plain (non-SSL) connections only.")
+
+mcrouter_option_toggle(
+  shared_destination_connections, false,
+  "shared-destination-connections", no_short,
+  "Share destination connections across proxy threads: each destination's"
+  " connections live on one owner proxy chosen by key hash, and the other"
+  " proxies forward their requests to it through the lock-free proxy"
+  " message queue. Cuts per-host connection counts by roughly the number"
+  " of proxy threads, at the cost of a cross-thread hop per forwarded"
+  " request.")
+
+mcrouter_option_toggle(
+  cross_router_shared_destinations, false,
+  "cross-router-shared-destinations", no_short,
+  "Share destination connections across mcrouter instances in this"
+  " process: a destination whose access point and timeout match one"
+  " already held by another registered instance with this option set"
+  " forwards its requests to that copy instead of opening its own"
+  " connections. An adopting instance keeps the owner instance alive,"
+  " so sharing instances must be torn down through the instance"
+  " registry or process exit, not by calling shutdown() on one while"
+  " others still route through it.")
+
+mcrouter_option_toggle(
+  udp_gets, false,
+  "udp-gets", no_short,
+  "Send get requests over UDP (memcached UDP frame) instead of the TCP"
+  " connection, one datagram per request, with replies matched back by"
+  " the frame's request id. A lost datagram surfaces as the request's"
+  " timeout; after several consecutive UDP timeouts the destination"
+  " falls back to TCP for all traffic. Only applies to plain (non-SSL)"
+  " ascii destinations.")
+
 mcrouter_option_integer(
   unsigned int, reset_inactive_connection_interval, 60000,
   "reset-inactive-connection-interval", no_short,
   "Will close open connections without any activity after at most 2 * interval"
   " ms. If value is 0, connections won't be closed.")
 
+mcrouter_option_integer(
+  unsigned int, dns_refresh_interval_ms, 0,
+  "dns-refresh-interval-ms", no_short,
+  "Re-resolve destination hostnames in the background every interval ms"
+  " and reconnect connections whose destination address changed, so IP"
+  " churn behind a stable hostname doesn't require a config push."
+  " If value is 0, hostnames are only resolved when connecting.")
+
 mcrouter_option_integer(
   int, tcp_rto_min, -1,
   "tcp-rto-min", no_short,
@@ -197,6 +323,21 @@ mcrouter_option_integer(
   " per target per thread.  Requests that would exceed this limit are dropped"
   " immediately.")
 
+mcrouter_option_integer(
+  size_t, max_shadow_queue_size, 1000,
+  "max-shadow-queue-size", no_short,
+  "Bound on the number of shadow requests queued per proxy thread waiting"
+  " for event loop headroom.  Shadows over the limit are dropped"
+  " (see shadow_queue_drops stat).  0 means unbounded.")
+
+mcrouter_option_integer(
+  size_t, shadow_send_max_lag_us, 1000,
+  "shadow-send-max-lag-us", no_short,
+  "Queued shadow requests are only sent while the smoothed interval between"
+  " event loop drains stays below this many microseconds; while the loop is"
+  " more lagged the queue holds and overflow is dropped.  0 sends shadows"
+  " regardless of loop lag.")
+
 mcrouter_option_toggle(
   no_network, false, "no-network", no_short,
   "Debug only. Return random generated replies, do not use network.")
@@ -217,6 +358,50 @@ mcrouter_option_integer(
   "proxy. Further requests will be rejected with an error immediately. 0 means "
   "disabled.")
 
+mcrouter_option_integer(
+  size_t, proxy_steal_threshold, 0,
+  "proxy-steal-threshold", no_short,
+  "If non-zero, a request from a client that shares proxy threads is"
+  " redirected to the least-loaded proxy whenever its assigned proxy has at"
+  " least this many messages pending in its queue, so skewed embedding"
+  " clients can't saturate one proxy while others sit idle. 0 disables"
+  " stealing. Has no effect on same-thread clients.")
+
+mcrouter_option_integer(
+  size_t, lease_get_collapse_wait_ms, 0,
+  "lease-get-collapse-wait-ms", no_short,
+  "If non-zero, at most one lease-get per key is routed at a time:"
+  " while one is outstanding, further lease-gets for the same key wait"
+  " up to this many milliseconds on the proxy. If the outstanding"
+  " request returns a hit, the waiters are answered from its reply;"
+  " otherwise (miss, error or timeout) they are routed as usual. Turns"
+  " a stampede on a hot missing key into a single backend fetch."
+  " 0 disables collapsing.")
+
+mcrouter_option_integer(
+  size_t, brownout_lag_threshold_us, 0,
+  "brownout-lag-threshold-us", no_short,
+  "If non-zero, enables brownout mode: when the smoothed interval between"
+  " event loop message queue drains exceeds this threshold, a fraction of"
+  " incoming get-like and update-like requests is answered with mc_res_busy"
+  " immediately instead of being routed, so an overloaded proxy serves"
+  " degraded-but-fast instead of uniformly slow. The fraction ramps linearly"
+  " from 0 at the threshold to brownout-max-shed-percent at twice the"
+  " threshold.")
+
+mcrouter_option_integer(
+  size_t, brownout_max_shed_percent, 90,
+  "brownout-max-shed-percent", no_short,
+  "Maximum percentage of get-like and update-like requests shed in brownout"
+  " mode. Capped at 100.")
+
+mcrouter_option_toggle(
+  brownout_gets_as_miss, false,
+  "brownout-gets-as-miss", no_short,
+  "In brownout mode, answer shed get-like requests as misses instead of"
+  " mc_res_busy, for clients that treat busy replies as errors rather than"
+  " cache misses.")
+
 mcrouter_option_string(
   pem_cert_path, "",
   "pem-cert-path", no_short,
@@ -265,6 +450,44 @@ mcrouter_option_toggle(
   "compression algorithms/dictionaries supported by the client. Only "
   "compresses caret protocol replies.")
 
+mcrouter_option_toggle(
+  compression_dictionary_training, false,
+  "compression-dictionary-training", no_short,
+  "If enabled (together with --enable-compression, in a build with "
+  "zdict), sample reply values and periodically retrain compression "
+  "dictionaries in the background so they track the current value mix.")
+
+mcrouter_option_integer(
+  unsigned int, compression_training_interval_ms, 10000,
+  "compression-training-interval-ms", no_short,
+  "How often the background trainer collects sampled reply values and "
+  "checks whether any compression dictionary is ready to retrain.")
+
+mcrouter_option_toggle(
+  adaptive_compression, false,
+  "adaptive-compression", no_short,
+  "If enabled (together with --enable-compression), each proxy adjusts "
+  "the compression level it uses for replies based on event loop lag, "
+  "so compression sheds CPU during traffic peaks and improves ratio "
+  "during troughs.")
+
+mcrouter_option_integer(
+  unsigned int, adaptive_compression_min_level, 1,
+  "adaptive-compression-min-level", no_short,
+  "Lowest compression level adaptive compression may fall back to.")
+
+mcrouter_option_integer(
+  unsigned int, adaptive_compression_max_level, 19,
+  "adaptive-compression-max-level", no_short,
+  "Highest compression level adaptive compression may ramp up to. "
+  "A codec is never raised above the level set in its config.")
+
+mcrouter_option_integer(
+  unsigned int, adaptive_compression_target_lag_us, 10000,
+  "adaptive-compression-target-lag-us", no_short,
+  "Event loop lag (smoothed message queue drain interval) above which "
+  "adaptive compression starts lowering the compression level.")
+
 mcrouter_option_group("Routing configuration")
 
 mcrouter_option_toggle(
@@ -296,6 +519,14 @@ mcrouter_option_string(
   "DEPRECATED. Configuration string provided as a command line argument."
   " This option has no effect if --config option is used.")
 
+mcrouter_option_string(
+  preprocessed_config_cache_path, "",
+  "preprocessed-config-cache-path", no_short,
+  "Path of a file used to cache the preprocessed configuration between"
+  " restarts. The cache is reused only if the config and all imported"
+  " files are unchanged, so startup skips macro expansion. Empty string"
+  " to disable.")
+
 mcrouter_option(
   facebook::memcache::mcrouter::RoutingPrefix, default_route, "/././",
   "route-prefix", 'R',
@@ -351,11 +582,28 @@ mcrouter_option_integer(
   "probe-timeout-max", no_short,
   "TKO probe retry max timeout in ms")
 
+mcrouter_option_integer(
+  size_t, max_probes_per_second, 0,
+  "max-probes-per-second", no_short,
+  "Global limit on TKO probes sent per second across all destinations"
+  " and proxy threads, to smooth recovery traffic when many boxes are"
+  " TKO at once. Probes over the budget are deferred, not dropped."
+  " 0 means unlimited.")
+
 mcrouter_option_integer(
   int, failures_until_tko, 3,
   "timeouts-until-tko", no_short,
   "Mark as TKO after this many failures")
 
+mcrouter_option_string(
+  tko_shared_memory_path, "",
+  "tko-shared-memory-path", no_short,
+  "Path of a file-backed shared memory segment for sharing TKO state"
+  " between mcrouter instances on this host (e.g."
+  " /dev/shm/mcrouter.tko). The first instance to mark a destination"
+  " TKO protects all of them; only that instance sends probes."
+  " Empty (default) disables sharing.")
+
 mcrouter_option_integer(
   size_t, maximum_soft_tkos, 40,
   "maximum-soft-tkos", no_short,
@@ -436,6 +684,13 @@ mcrouter_option_integer(
   "surpassing this threshold rtt time means we will log it as an outlier. "
   "0 (the default) means that we will do no logging of outliers.")
 
+mcrouter_option_integer(
+  unsigned int, slow_request_threshold_us, 0,
+  "slow-request-threshold-us", no_short,
+  "Replies slower than this many microseconds are summarized in an "
+  "in-memory ring per proxy, dumpable with the \"slow_requests\" "
+  "ServiceInfo command. 0 (the default) disables recording.")
+
 mcrouter_option_integer(
   unsigned int, stats_async_queue_length, 50,
   "stats-async-queue-length", no_short,
@@ -447,9 +702,17 @@ mcrouter_option_toggle(
   "Disable failure logging.")
 
 mcrouter_option_toggle(
-  cpu_cycles, false,
-  "cpu-cycles", no_short,
-  "Enables CPU cycles counting for performance measurement.")
+  cpu_cycles, true,
+  "disable-cpu-cycles", no_short,
+  "Disable sampled CPU cycles accounting. Only a small fraction of "
+  "requests is metered, so it is cheap enough to leave enabled.")
+
+mcrouter_option_integer(
+  unsigned int, canary_interval_ms, 0,
+  "canary-interval-ms", no_short,
+  "Time in ms between synthetic canary requests each proxy routes "
+  "through its route tree to measure router-internal overhead "
+  "(see the canary_* stats). 0 (the default) disables canaries.")
 
 mcrouter_option_toggle(
   test_mode, false,
@@ -494,6 +757,38 @@ mcrouter_option_integer(
   " threshold is always at most max-rxmit-reconnect-threshold rxmits/kb."
   " If max-rxmit-reconnect-threshold is 0, the dynamic threshold is unbounded.")
 
+mcrouter_option_integer(
+  uint64_t, destination_warmup_rate, 0,
+  "destination-warmup-rate", no_short,
+  "If non-zero, connections to newly configured destinations are opened"
+  " and health-checked in the background, at up to this many destinations"
+  " per second, so the first real requests don't pay connect (and TLS"
+  " handshake) latency. If 0, connections are only opened on demand.")
+
+mcrouter_option_toggle(
+  destination_dedup_gets, false,
+  "destination-dedup-gets", no_short,
+  "If enabled, concurrent gets for the same key headed to the same"
+  " destination are collapsed into a single wire request whose reply is"
+  " fanned out to all waiters. Helps with hot-key stampedes.")
+
+mcrouter_option_integer(
+  size_t, destination_max_hedge_percent, 0,
+  "destination-max-hedge-percent", no_short,
+  "If non-zero, enables hedged (backup) gets: when a get has not"
+  " completed within roughly the destination's high latency percentiles,"
+  " one backup copy of it is sent over another connection to the same"
+  " destination and the first reply wins. At most this percent of gets"
+  " are hedged. If 0, hedging is disabled.")
+
+mcrouter_option_toggle(
+  enable_adaptive_timeouts, false,
+  "enable-adaptive-timeouts", no_short,
+  "If enabled, the effective per-request timeout for each destination is"
+  " derived from its smoothed latency plus four smoothed deviations,"
+  " clamped from above by the configured timeout, so timeouts track the"
+  " real latency distribution of each server.")
+
 mcrouter_option_integer(
   int, asynclog_port_override, 0, no_long, no_short,
   "If non-zero use this port while logging to async log")
@@ -13,6 +13,7 @@
 #include <folly/fibers/WhenN.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
+#include <folly/Memory.h>
 #include <folly/Range.h>
 
 #include "mcrouter/lib/IOBufUtil.h"
@@ -199,17 +200,28 @@ Reply BigValueRoute::mergeChunkGetReplies(
     return Reply(reduced_reply_it->result());
   }
 
-  std::vector<std::unique_ptr<folly::IOBuf>> data_vec;
-  while (begin != end) {
-    if (begin->value().hasValue()) {
-      data_vec.push_back(begin->value()->clone());
+  // Chain the chunk values together without copying any data: the replies
+  // are owned by the caller, so each value can be moved into the chain, and
+  // the write path sends an IOBuf chain as scatter/gather iovecs, so the
+  // assembled value never needs to be contiguous.
+  folly::IOBuf assembled;
+  bool empty = true;
+  for (; begin != end; ++begin) {
+    if (!begin->value().hasValue()) {
+      continue;
+    }
+    if (empty) {
+      assembled = std::move(*begin->value());
+      empty = false;
+    } else {
+      assembled.prependChain(
+          folly::make_unique<folly::IOBuf>(std::move(*begin->value())));
     }
-    ++begin;
   }
 
   if (auto* value =
           const_cast<folly::IOBuf*>(carbon::valuePtrUnsafe(initialReply))) {
-    *value = concatAll(data_vec.begin(), data_vec.end());
+    *value = std::move(assembled);
   }
   initialReply.result() = reduced_reply_it->result();
   return initialReply;
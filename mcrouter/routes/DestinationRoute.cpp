@@ -15,6 +15,17 @@ namespace facebook { namespace memcache { namespace mcrouter {
 
 const char* const kFailoverTag = ":failover=1";
 
+namespace {
+
+// Hedging budget window size: once this many gets were seen, both
+// counters are halved, so the budget tracks the recent hedge rate.
+constexpr size_t kHedgingWindow = 1000;
+// The hedge fires after avgLatency + factor * latencyDeviation, i.e.
+// roughly past the high percentiles of the latency distribution.
+constexpr double kHedgingDeviationFactor = 2.0;
+
+} // anonymous namespace
+
 std::string DestinationRoute::routeName() const {
   return folly::sformat("host|pool={}|id={}|ap={}|timeout={}ms",
     poolName_,
@@ -28,6 +39,38 @@ std::string DestinationRoute::keyWithFailoverTag(
   return folly::to<std::string>(fullKey, kFailoverTag);
 }
 
+std::chrono::milliseconds DestinationRoute::hedgingDelay(
+    const McrouterOptions& opts) const {
+  const size_t maxHedgePercent = opts.destination_max_hedge_percent;
+  if (maxHedgePercent == 0) {
+    return std::chrono::milliseconds(0);
+  }
+  const auto& stats = destination_->stats();
+  if (!stats.avgLatency.hasValue()) {
+    return std::chrono::milliseconds(0);
+  }
+
+  auto& requests = const_cast<size_t&>(hedgingRequests_);
+  auto& hedges = const_cast<size_t&>(hedgesSent_);
+  if (++requests >= kHedgingWindow) {
+    requests /= 2;
+    hedges /= 2;
+  }
+  if (hedges * 100 >= requests * maxHedgePercent) {
+    return std::chrono::milliseconds(0);
+  }
+
+  /* Latency samples are in microseconds; round up to whole ms */
+  const double delayUs = stats.avgLatency.value() +
+      kHedgingDeviationFactor * stats.latencyDeviation.value();
+  const auto delayMs = static_cast<int64_t>(delayUs / 1000.0) + 1;
+  if (timeout_.count() > 0 && delayMs >= timeout_.count()) {
+    /* The request would time out before the hedge could fire */
+    return std::chrono::milliseconds(0);
+  }
+  return std::chrono::milliseconds(delayMs);
+}
+
 McrouterRouteHandlePtr makeDestinationRoute(
   std::shared_ptr<ProxyDestination> destination,
   std::string poolName,
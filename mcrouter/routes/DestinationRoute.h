@@ -12,9 +12,13 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include <folly/fibers/AddTasks.h>
+#include <folly/fibers/Baton.h>
 #include <folly/fibers/FiberManager.h>
+#include <folly/Likely.h>
 #include <folly/Memory.h>
 #include <folly/Optional.h>
 #include <folly/ScopeGuard.h>
@@ -32,7 +36,9 @@
 #include "mcrouter/lib/McOperation.h"
 #include "mcrouter/lib/Reply.h"
 #include "mcrouter/lib/RouteHandleTraverser.h"
+#include "mcrouter/lib/Tracepoints.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
+#include "mcrouter/lib/network/CarbonMessageList.h"
 #include "mcrouter/lib/network/gen/Memcache.h"
 #include "mcrouter/routes/McrouterRouteHandle.h"
 
@@ -89,6 +95,49 @@ class DestinationRoute {
     return routeWithDestination(req);
   }
 
+  /**
+   * Plain gets may additionally be deduplicated (see
+   * --destination-dedup-gets): during a hot-key stampede all concurrent
+   * gets for one key collapse into a single wire request whose reply is
+   * fanned out to every waiter.
+   */
+  McGetReply route(const McGetRequest& req) const {
+    auto& ctx = fiber_local::getSharedCtx();
+    if (!ctx || ctx->recording() ||
+        !ctx->proxy().router().opts().destination_dedup_gets) {
+      return routeWithDestination(req);
+    }
+
+    auto& inflight = const_cast<
+        std::unordered_map<std::string, InflightGetEntry>&>(inflightGets_);
+    auto key = req.key().fullKey().str();
+
+    auto it = inflight.find(key);
+    if (it != inflight.end()) {
+      /* Attach to the outstanding get for this key. Keep the shared
+         reply alive: the leader erases the entry after posting. */
+      auto result = it->second.reply;
+      folly::fibers::Baton baton;
+      it->second.waiters.push_back(&baton);
+      baton.wait();
+      return *result;
+    }
+
+    /* Leader: map references stay valid under rehash, so entry can be
+       used after waiters attached themselves while we were routing */
+    auto& entry = inflight[key];
+    auto result = entry.reply;
+    SCOPE_EXIT {
+      for (auto* baton : entry.waiters) {
+        baton->post();
+      }
+      inflight.erase(key);
+    };
+    auto reply = routeWithDestination(req);
+    *result = reply;
+    return reply;
+  }
+
  private:
   const std::shared_ptr<ProxyDestination> destination_;
   const std::string poolName_;
@@ -96,6 +145,18 @@ class DestinationRoute {
   const std::chrono::milliseconds timeout_;
   const bool keepRoutingPrefix_;
   size_t pendingShadowReqs_{0};
+  // Hedging budget window: gets seen and backup copies sent (see
+  // hedgingDelay()).
+  size_t hedgingRequests_{0};
+  size_t hedgesSent_{0};
+
+  struct InflightGetEntry {
+    std::vector<folly::fibers::Baton*> waiters;
+    std::shared_ptr<McGetReply> reply{std::make_shared<McGetReply>()};
+  };
+  // Outstanding deduplicated gets, keyed by full key. All fibers of a
+  // proxy run on one thread, so no synchronization is needed.
+  std::unordered_map<std::string, InflightGetEntry> inflightGets_;
 
   template <class Request>
   ReplyT<Request> routeWithDestination(const Request& req) const {
@@ -115,7 +176,15 @@ class DestinationRoute {
       return constructAndLog(req, *ctx, BusyReply);
     }
 
-    if (ctx->recording()) {
+    /* Shed load before requests queue up behind a full socket buffer
+       and time out anyway; busy is a failover-able result */
+    if (destination_->isSaturated()) {
+      return constructAndLog(req, *ctx, BusyReply);
+    }
+
+    /* Recording contexts exist only for ServiceInfo introspection; keep
+       that branch off the hot path. */
+    if (UNLIKELY(ctx->recording())) {
       ctx->recordDestination(poolName_, indexInPool_,
                              *destination_->accessPoint());
       return constructAndLog(req, *ctx, DefaultReply, req);
@@ -163,6 +232,11 @@ class DestinationRoute {
   template <class Request>
   ReplyT<Request> doRoute(const Request& req,
                           ProxyRequestContext& ctx) const {
+    MCROUTER_PROBE_REQUEST_ROUTED(
+        ctx.requestId(),
+        (OpFromType<Request, RequestOpMapping>::value),
+        req.key().routingKeyHash(),
+        indexInPool_);
     DestinationRequestCtx dctx(nowUs());
     folly::Optional<Request> newReq;
     folly::StringPiece strippedRoutingPrefix;
@@ -184,7 +258,7 @@ class DestinationRoute {
     }
 
     const auto& reqToSend = newReq ? *newReq : req;
-    auto reply = destination_->send(reqToSend, dctx, timeout_);
+    auto reply = sendWithOptionalHedging(reqToSend, dctx, ctx);
     ctx.onReplyReceived(poolName_,
                         *destination_->accessPoint(),
                         strippedRoutingPrefix,
@@ -196,6 +270,85 @@ class DestinationRoute {
     return reply;
   }
 
+  /**
+   * If hedging is allowed right now, returns how long to wait for the
+   * primary before sending a backup copy of a get; returns 0ms when
+   * hedging is disabled, over budget or not useful (see
+   * --destination-max-hedge-percent). Also advances the budget window.
+   */
+  std::chrono::milliseconds hedgingDelay(const McrouterOptions& opts) const;
+
+  /**
+   * Sends a get, optionally racing a delayed backup copy of it against
+   * the primary over another connection to the same destination;
+   * whichever reply arrives first wins and its timings are stored into
+   * dctx. The loser completes asynchronously.
+   */
+  template <class Request>
+  ReplyT<Request> sendWithOptionalHedging(const Request& req,
+                                          DestinationRequestCtx& dctx,
+                                          ProxyRequestContext& ctx,
+                                          GetLikeT<Request> = 0) const {
+    using Reply = ReplyT<Request>;
+
+    const auto hedgeDelay = hedgingDelay(ctx.proxy().router().opts());
+    if (hedgeDelay.count() == 0) {
+      return destination_->send(req, dctx, timeout_);
+    }
+
+    struct TaskResult {
+      Reply reply;
+      DestinationRequestCtx dctx;
+    };
+
+    auto reqCopy = std::make_shared<Request>(req);
+    auto destination = destination_;
+    auto timeout = timeout_;
+    // All fibers of a proxy run on one thread, so plain flags suffice:
+    // whether a winning reply was already taken and whether the backup
+    // copy was actually sent.
+    auto winnerTaken = std::make_shared<bool>(false);
+    auto backupSent = std::make_shared<bool>(false);
+
+    std::vector<std::function<TaskResult()>> funcs;
+    funcs.push_back([reqCopy, destination, timeout]() {
+      DestinationRequestCtx taskCtx(nowUs());
+      auto taskReply = destination->send(*reqCopy, taskCtx, timeout);
+      return TaskResult{std::move(taskReply), taskCtx};
+    });
+    funcs.push_back(
+        [reqCopy, destination, timeout, hedgeDelay, winnerTaken, backupSent]() {
+          folly::fibers::Baton delayBaton;
+          delayBaton.timed_wait(hedgeDelay);
+          DestinationRequestCtx taskCtx(nowUs());
+          if (*winnerTaken) {
+            /* The primary was fast enough, nothing to hedge */
+            return TaskResult{createReply<Request>(ErrorReply), taskCtx};
+          }
+          *backupSent = true;
+          auto taskReply = destination->send(*reqCopy, taskCtx, timeout);
+          return TaskResult{std::move(taskReply), taskCtx};
+        });
+
+    auto taskIt = folly::fibers::addTasks(funcs.begin(), funcs.end());
+    auto result = taskIt.awaitNext();
+    *winnerTaken = true;
+    if (*backupSent) {
+      ++const_cast<size_t&>(hedgesSent_);
+    }
+    dctx = result.dctx;
+    return std::move(result.reply);
+  }
+
+  template <class Request>
+  ReplyT<Request> sendWithOptionalHedging(
+      const Request& req,
+      DestinationRequestCtx& dctx,
+      ProxyRequestContext& /* ctx */,
+      OtherThanT<Request, GetLike<>> = 0) const {
+    return destination_->send(req, dctx, timeout_);
+  }
+
   template <class Request>
   bool spool(const Request& req) const {
     auto asynclogName = fiber_local::getAsynclogName();
@@ -209,21 +362,13 @@ class DestinationRoute {
 
     auto proxy = &fiber_local::getSharedCtx()->proxy();
     auto& ap = *destination_->accessPoint();
-    folly::fibers::Baton b;
-    auto res = proxy->router().asyncWriter().run(
-      [&b, &ap, proxy, key, asynclogName] () {
-        asynclog_delete(proxy, ap, key, asynclogName);
-        b.post();
-      }
-    );
-    if (!res) {
+    /* Blocks until the entry is group-committed to disk */
+    if (!asynclog_delete(proxy, ap, key, asynclogName)) {
       MC_LOG_FAILURE(proxy->router().opts(),
                      memcache::failure::Category::kOutOfResources,
                      "Could not enqueue asynclog request (key {}, pool {})",
                      key, asynclogName);
     } else {
-      /* Don't reply to the user until we safely logged the request to disk */
-      b.wait();
       stat_incr(proxy->stats, asynclog_requests_stat, 1);
     }
     return true;
@@ -16,6 +16,8 @@
 
 #include <folly/dynamic.h>
 
+#include "mcrouter/config.h"
+#include "mcrouter/ExponentialSmoothData.h"
 #include "mcrouter/lib/fbi/cpp/ParsingUtil.h"
 #include "mcrouter/lib/Operation.h"
 
@@ -186,4 +188,121 @@ class FailoverLeastFailuresPolicy {
   std::vector<size_t> recentErrorCount_;
 };
 
+/**
+ * Orders failover destinations by the smoothed latency of their recent
+ * replies, so failover lands on the fastest replica first.  Latency is
+ * sampled around each failover request this policy routes; error replies
+ * are not sampled, since a fast error (e.g. a TKO'd destination) says
+ * nothing about how quickly the child serves real traffic.  Children that
+ * have not been sampled yet sort first, so every child gets measured.
+ */
+template <typename RouteHandleIf>
+class FailoverLeastLatencyPolicy {
+ public:
+  using RouteHandlePtr = std::shared_ptr<RouteHandleIf>;
+
+  FailoverLeastLatencyPolicy(
+      const std::vector<std::shared_ptr<RouteHandleIf>>& children,
+      const folly::dynamic& policyConfig) :
+    children_(children),
+    avgLatencyUs_(children_.size()) {
+
+    maxTries_ = children_.size();
+    if (auto jMaxTries = policyConfig.get_ptr("max_tries")) {
+      maxTries_ = static_cast<size_t>(
+          parseInt(*jMaxTries, "max_tries", 1, children_.size()));
+    }
+  }
+
+  class ChildProxy {
+   public:
+    ChildProxy(FailoverLeastLatencyPolicy<RouteHandleIf>& failoverPolicy,
+               size_t index)
+      : failoverPolicy_(failoverPolicy), index_(index) {}
+
+    template <class Request>
+    ReplyT<Request> route(const Request& req) {
+      auto& child = failoverPolicy_.children_[index_];
+      const auto startUs = nowUs();
+      auto reply = child->route(req);
+      if (!isErrorResult(reply.result())) {
+        failoverPolicy_.avgLatencyUs_[index_].insertSample(nowUs() - startUs);
+      }
+
+      return reply;
+    }
+
+   private:
+    FailoverLeastLatencyPolicy<RouteHandleIf>& failoverPolicy_;
+    size_t index_;
+  };
+
+  class Iterator : public boost::iterator_facade<
+                            Iterator,
+                            ChildProxy,
+                            std::forward_iterator_tag,
+                            ChildProxy> {
+   public:
+    Iterator(FailoverLeastLatencyPolicy<RouteHandleIf>& failoverPolicy,
+             std::vector<size_t> order,
+             size_t id)
+      : policy_(failoverPolicy), order_(std::move(order)), id_(id) {}
+
+    size_t getTrueIndex() const {
+      return order_[id_];
+    }
+
+   private:
+    void increment() {
+      ++id_;
+    }
+
+    bool equal(const Iterator& other) const {
+      return id_ == other.id_;
+    }
+
+    ChildProxy dereference() const {
+      return ChildProxy(policy_, order_[id_]);
+    }
+
+    friend class boost::iterator_core_access;
+
+    FailoverLeastLatencyPolicy<RouteHandleIf>& policy_;
+    const std::vector<size_t> order_;
+    size_t id_;
+  };
+
+
+  Iterator begin() {
+    return Iterator(*this, getLeastLatencyRouteIndices(), 0);
+  }
+
+  Iterator end() {
+    return Iterator(*this, {}, maxTries_ - 1);
+  }
+
+ private:
+  std::vector<size_t> getLeastLatencyRouteIndices() const {
+    std::vector<size_t> indices;
+    // Start at i = 1 since we don't consider first child
+    for (size_t i = 1; i < avgLatencyUs_.size(); ++i) {
+      indices.push_back(i);
+    }
+    // Unsampled children report 0.0 and therefore sort first.
+    std::stable_sort(indices.begin(), indices.end(),
+        [this](size_t a, size_t b) {
+          return avgLatencyUs_[a].value() < avgLatencyUs_[b].value();
+        }
+    );
+    indices.resize(maxTries_ - 1);
+
+    return indices;
+  }
+
+  const std::vector<RouteHandlePtr>& children_;
+  size_t maxTries_;
+
+  std::vector<ExponentialSmoothData<16>> avgLatencyUs_;
+};
+
 }}} // facebook::memcache::mcrouter
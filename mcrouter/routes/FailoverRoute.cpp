@@ -73,6 +73,29 @@ makeFailoverRouteLeastFailures(std::vector<McrouterRouteHandlePtr> rh,
       json);
 }
 
+McrouterRouteHandlePtr
+makeFailoverRouteLeastLatency(std::vector<McrouterRouteHandlePtr> rh,
+                              FailoverErrorsSettings failoverErrors,
+                              std::unique_ptr<FailoverRateLimiter> rateLimiter,
+                              bool failoverTagging,
+                              bool enableLeasePairing,
+                              std::string name,
+                              const folly::dynamic& json) {
+  if (rh.size() <= 1) {
+    return makeNullOrSingletonRoute(std::move(rh));
+  }
+
+  using FailoverPolicyT = FailoverLeastLatencyPolicy<McrouterRouteHandleIf>;
+  return makeMcrouterRouteHandle<FailoverRoute, FailoverPolicyT>(
+      std::move(rh),
+      std::move(failoverErrors),
+      std::move(rateLimiter),
+      failoverTagging,
+      enableLeasePairing,
+      std::move(name),
+      json);
+}
+
 McrouterRouteHandlePtr makeFailoverRoute(
     const folly::dynamic& json,
     std::vector<McrouterRouteHandlePtr> children) {
@@ -112,12 +135,19 @@ McrouterRouteHandlePtr makeFailoverRoute(
       auto jPolicyType = jFailoverPolicy->get_ptr("type");
       checkLogic(jPolicyType != nullptr,
                  "Failover: failover_policy object is missing 'type' field");
-      if (parseString(*jPolicyType, "type") == "LeastFailuresPolicy") {
+      auto policyType = parseString(*jPolicyType, "type");
+      if (policyType == "LeastFailuresPolicy") {
         return makeFailoverRouteLeastFailures(
             std::move(children), std::move(failoverErrors),
             std::move(rateLimiter), failoverTagging,
             enableLeasePairing, std::move(name),
             *jFailoverPolicy);
+      } else if (policyType == "LeastLatencyPolicy") {
+        return makeFailoverRouteLeastLatency(
+            std::move(children), std::move(failoverErrors),
+            std::move(rateLimiter), failoverTagging,
+            enableLeasePairing, std::move(name),
+            *jFailoverPolicy);
       }
     }
   }
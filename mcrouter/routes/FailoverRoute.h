@@ -172,24 +172,28 @@ class FailoverRoute {
 
 
       auto cur = failoverPolicy_.begin();
-      // set the index of the child that generated the reply.
+      const auto end = failoverPolicy_.end();
+      // index of the child that generated the reply.  Tracked separately
+      // so we never copy iterators (for some policies they own state) and
+      // never dereference the advanced-past-the-end one.
+      size_t failoverIndex = cur.getTrueIndex();
       SCOPE_EXIT {
-        childIndex = cur.getTrueIndex();
+        childIndex = failoverIndex;
       };
-      auto nx = cur;
-      for (++nx; nx != failoverPolicy_.end(); ++cur, ++nx) {
+      while (true) {
+        failoverIndex = cur.getTrueIndex();
         auto failoverReply = doFailover(cur);
+        ++cur;
+        if (cur == end) {
+          if (isErrorResult(failoverReply.result())) {
+            stat_incr(proxy.stats, failover_all_failed_stat, 1);
+          }
+          return failoverReply;
+        }
         if (!failoverErrors_.shouldFailover(failoverReply, req)) {
           return failoverReply;
         }
       }
-
-      auto failoverReply = doFailover(cur);
-      if (isErrorResult(failoverReply.result())) {
-        stat_incr(proxy.stats, failover_all_failed_stat, 1);
-      }
-
-      return failoverReply;
     });
   }
 };
@@ -24,6 +24,14 @@ std::vector<McrouterRouteHandlePtr> getFailoverChildren(
 
   std::vector<McrouterRouteHandlePtr> children;
   children.push_back(std::move(normal));
+  if (failoverExptime == 0) {
+    /* 0 means infinite exptime, so min(exptime, infinity) never modifies
+       the request: route straight to the failover destinations. */
+    for (auto& frh : failover) {
+      children.push_back(std::move(frh));
+    }
+    return children;
+  }
   for (auto& frh : failover) {
     auto rh = std::make_shared<McrouterRouteHandle<ModifyExptimeRoute>>(
         std::move(frh), failoverExptime, ModifyExptimeRoute::Action::Min);
@@ -12,6 +12,7 @@
 #include <folly/dynamic.h>
 
 #include "mcrouter/lib/config/RouteHandleFactory.h"
+#include "mcrouter/lib/fbi/cpp/util.h"
 #include "mcrouter/routes/McrouterRouteHandle.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
@@ -24,14 +25,27 @@ McrouterRouteHandlePtr makeLoggingRoute(
     RouteHandleFactory<McrouterRouteHandleIf>& factory,
     const folly::dynamic& json) {
   McrouterRouteHandlePtr target;
+  size_t sampleRate = 1;
+  size_t logsPerSecond = 0;
   if (json.isObject()) {
     if (auto jtarget = json.get_ptr("target")) {
       target = factory.create(*jtarget);
     }
+    if (auto jrate = json.get_ptr("sample_rate")) {
+      checkLogic(jrate->isInt() && jrate->getInt() >= 0,
+                 "LoggingRoute: sample_rate is not a non-negative int");
+      sampleRate = jrate->getInt();
+    }
+    if (auto jbudget = json.get_ptr("logs_per_second")) {
+      checkLogic(jbudget->isInt() && jbudget->getInt() >= 0,
+                 "LoggingRoute: logs_per_second is not a non-negative int");
+      logsPerSecond = jbudget->getInt();
+    }
   } else if (json.isString()) {
     target = factory.create(json);
   }
-  return makeLoggingRoute(std::move(target));
+  return std::make_shared<McrouterRouteHandle<LoggingRoute>>(
+      std::move(target), sampleRate, logsPerSecond);
 }
 
 }}}  // facebook::memcache::mcrouter
@@ -24,6 +24,11 @@ namespace facebook { namespace memcache { namespace mcrouter {
 
 /**
  * Forwards requests to the child route, then logs the request and response.
+ *
+ * Logging can be sampled so the route is cheap enough to leave in
+ * production configs: with sampleRate N only every Nth request is
+ * logged, further capped at logsPerSecond log lines per second.
+ * Unsampled requests pay a single counter increment on top of routing.
  */
 class LoggingRoute {
  public:
@@ -31,8 +36,18 @@ class LoggingRoute {
     return "logging";
   }
 
-  explicit LoggingRoute(McrouterRouteHandlePtr rh)
-    : child_(std::move(rh)) {}
+  /**
+   * @param rh             Child route; nullptr routes like NullRoute.
+   * @param sampleRate     Log every sampleRate-th request; 1 logs all,
+   *                       0 logs nothing.
+   * @param logsPerSecond  Cap on log lines per second; 0 means no cap.
+   */
+  explicit LoggingRoute(McrouterRouteHandlePtr rh,
+                        size_t sampleRate = 1,
+                        size_t logsPerSecond = 0)
+    : child_(std::move(rh)),
+      sampleRate_(sampleRate),
+      logsPerSecond_(logsPerSecond) {}
 
   template <class Request>
   void traverse(const Request& req,
@@ -44,15 +59,19 @@ class LoggingRoute {
 
   template <class Request>
   ReplyT<Request> route(const Request& req) {
-    ReplyT<Request> reply;
-    if (child_ == nullptr) {
-      reply = NullRoute<McrouterRouteHandleIf>::route(req);
-    } else {
-      reply = child_->route(req);
+    if (sampleRate_ != 1 &&
+        (sampleRate_ == 0 || ++sampleCounter_ % sampleRate_ != 0)) {
+      return routeChild(req);
     }
 
+    ReplyT<Request> reply = routeChild(req);
+
     // Pull the IP (if available) out of the saved request
     auto& ctx = mcrouter::fiber_local::getSharedCtx();
+
+    if (!underLogBudget(ctx->proxy().coarseNowWallSec())) {
+      return reply;
+    }
     auto& ip = ctx->userIpAddress();
     folly::StringPiece userIp;
     if (!ip.empty()) {
@@ -84,6 +103,40 @@ class LoggingRoute {
 
  private:
   const McrouterRouteHandlePtr child_;
+  const size_t sampleRate_;
+  const size_t logsPerSecond_;
+
+  /* Route handles are per proxy thread, so plain counters suffice */
+  uint64_t sampleCounter_{0};
+  time_t budgetSec_{0};
+  size_t budgetUsed_{0};
+
+  template <class Request>
+  ReplyT<Request> routeChild(const Request& req) {
+    if (child_ == nullptr) {
+      return NullRoute<McrouterRouteHandleIf>::route(req);
+    }
+    return child_->route(req);
+  }
+
+  /**
+   * Take one log line out of this second's budget if available.  Uses
+   * the proxy's coarse cached clock, so no time syscall per request.
+   */
+  bool underLogBudget(time_t now) {
+    if (logsPerSecond_ == 0) {
+      return true;
+    }
+    if (now != budgetSec_) {
+      budgetSec_ = now;
+      budgetUsed_ = 0;
+    }
+    if (budgetUsed_ >= logsPerSecond_) {
+      return false;
+    }
+    ++budgetUsed_;
+    return true;
+  }
 };
 
 }}} // facebook::memcache::mcrouter
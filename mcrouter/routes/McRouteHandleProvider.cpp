@@ -11,6 +11,7 @@
 
 #include <memory>
 
+#include <folly/Conv.h>
 #include <folly/Range.h>
 
 #include "mcrouter/McrouterInstance.h"
@@ -103,6 +104,9 @@ McrouterRouteHandlePtr makeLatestRoute(McRouteHandleFactory& factory,
 McrouterRouteHandlePtr makeLoggingRoute(McRouteHandleFactory& factory,
                                         const folly::dynamic& json);
 
+McrouterRouteHandlePtr makeMicrocacheRoute(McRouteHandleFactory& factory,
+                                           const folly::dynamic& json);
+
 McrouterRouteHandlePtr makeMigrateRoute(McRouteHandleFactory& factory,
                                         const folly::dynamic& json);
 
@@ -115,6 +119,9 @@ McrouterRouteHandlePtr makeModifyExptimeRoute(McRouteHandleFactory& factory,
 McrouterRouteHandlePtr makeModifyKeyRoute(McRouteHandleFactory& factory,
                                           const folly::dynamic& json);
 
+McrouterRouteHandlePtr makeNegativeCacheRoute(McRouteHandleFactory& factory,
+                                              const folly::dynamic& json);
+
 McrouterRouteHandlePtr makeNullRoute(McRouteHandleFactory& factory,
                                      const folly::dynamic& json);
 
@@ -123,7 +130,8 @@ McrouterRouteHandlePtr makeOperationSelectorRoute(McRouteHandleFactory& factory,
 
 McrouterRouteHandlePtr makeOutstandingLimitRoute(
   McrouterRouteHandlePtr normalRoute,
-  size_t maxOutstanding);
+  size_t maxOutstanding,
+  bool adaptive);
 
 McrouterRouteHandlePtr makeRateLimitRoute(McrouterRouteHandlePtr normalRoute,
                                           RateLimiter rateLimiter);
@@ -179,10 +187,12 @@ McRouteHandleProvider::McRouteHandleProvider(
           {"L1L2CacheRoute", &makeL1L2CacheRoute},
           {"LatestRoute", &makeLatestRoute},
           {"LoggingRoute", &makeLoggingRoute},
+          {"MicrocacheRoute", &makeMicrocacheRoute},
           {"MigrateRoute", &makeMigrateRoute},
           {"MissFailoverRoute", &makeMissFailoverRoute},
           {"ModifyExptimeRoute", &makeModifyExptimeRoute},
           {"ModifyKeyRoute", &makeModifyKeyRoute},
+          {"NegativeCacheRoute", &makeNegativeCacheRoute},
           {"NullRoute", &makeNullRoute},
           {"OperationSelectorRoute", &makeOperationSelectorRoute},
           {"PoolRoute",
@@ -306,6 +316,13 @@ McRouteHandleProvider::makePool(McRouteHandleFactory& factory,
       useSsl = parseBool(*jUseSsl, "use_ssl");
     }
 
+    // Number of parallel connections to each server of this pool.
+    uint64_t connectionsPerServer = 1;
+    if (auto jConns = json.get_ptr("connections_per_server")) {
+      connectionsPerServer =
+          parseInt(*jConns, "connections_per_server", 1, 64);
+    }
+
     // default to 0, which doesn't override
     uint16_t port = 0;
     if (auto jPort = json.get_ptr("port_override")) {
@@ -325,22 +342,31 @@ McRouteHandleProvider::makePool(McRouteHandleFactory& factory,
         destinations.push_back(factory.create(server));
         continue;
       }
-      auto ap = AccessPoint::create(server.stringPiece(), protocol, useSsl,
-                                    port, enableCompression);
-      checkLogic(ap != nullptr, "invalid server {}", server.stringPiece());
-
-      if (ap->compressed() && proxy_.router().getCodecManager() == nullptr) {
-        if (!initCompression(proxy_.router())) {
-          MC_LOG_FAILURE(
-              opts,
-              failure::Category::kBadEnvironment,
-              "Pool {}: Failed to initialize compression. "
-              "Disabling compression for host: {}",
-              name,
-              server.stringPiece());
-
-          ap->disableCompression();
+      // AccessPoints are immutable once parsed; share them between the
+      // proxies built from the same config instead of reparsing per proxy.
+      auto apCacheKey = folly::to<std::string>(
+        server.stringPiece(), '|', static_cast<int>(protocol), '|', useSsl,
+        '|', port, '|', enableCompression);
+      auto ap = poolFactory_.findAccessPoint(apCacheKey);
+      if (!ap) {
+        ap = AccessPoint::create(server.stringPiece(), protocol, useSsl,
+                                 port, enableCompression);
+        checkLogic(ap != nullptr, "invalid server {}", server.stringPiece());
+
+        if (ap->compressed() && proxy_.router().getCodecManager() == nullptr) {
+          if (!initCompression(proxy_.router())) {
+            MC_LOG_FAILURE(
+                opts,
+                failure::Category::kBadEnvironment,
+                "Pool {}: Failed to initialize compression. "
+                "Disabling compression for host: {}",
+                name,
+                server.stringPiece());
+
+            ap->disableCompression();
+          }
         }
+        poolFactory_.cacheAccessPoint(apCacheKey, ap);
       }
 
       accessPoints_[name].push_back(ap);
@@ -348,7 +374,7 @@ McRouteHandleProvider::makePool(McRouteHandleFactory& factory,
       auto pdstn = proxy_.destinationMap->find(*ap, timeout);
       if (!pdstn) {
         pdstn = proxy_.destinationMap->emplace(
-          std::move(ap), timeout, qosClass, qosPath
+          std::move(ap), timeout, qosClass, qosPath, connectionsPerServer
         );
       }
       pdstn->updatePoolName(name);
@@ -385,8 +411,15 @@ McRouteHandleProvider::makePoolRoute(McRouteHandleFactory& factory,
       if (auto maxOutstandingPtr = json.get_ptr("max_outstanding")) {
         auto v = parseInt(*maxOutstandingPtr, "max_outstanding", 0, 1000000);
         if (v) {
+          bool adaptive = false;
+          if (auto adaptivePtr = json.get_ptr("max_outstanding_adaptive")) {
+            checkLogic(adaptivePtr->isBool(),
+                       "PoolRoute: max_outstanding_adaptive is not bool");
+            adaptive = adaptivePtr->getBool();
+          }
           for (auto& destination: destinations) {
-            destination = makeOutstandingLimitRoute(std::move(destination), v);
+            destination =
+              makeOutstandingLimitRoute(std::move(destination), v, adaptive);
           }
         }
       }
@@ -19,8 +19,11 @@ namespace facebook { namespace memcache { namespace mcrouter {
 
 class McrouterRouteHandleIf;
 
+/* 'final' lets the compiler devirtualize route()/traverse() wherever the
+   concrete handle type is statically known (speculative devirtualization
+   under LTO included): nothing ever derives from a concrete handle. */
 template <typename Route>
-class McrouterRouteHandle
+class McrouterRouteHandle final
     : public RouteHandle<Route, McrouterRouteHandleIf, McRequestList> {
  public:
   template <typename... Args>
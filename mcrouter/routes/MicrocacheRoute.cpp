@@ -0,0 +1,59 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "MicrocacheRoute.h"
+
+#include <folly/dynamic.h>
+
+#include "mcrouter/lib/config/RouteHandleFactory.h"
+#include "mcrouter/lib/fbi/cpp/util.h"
+#include "mcrouter/routes/McRouteHandleBuilder.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+namespace {
+
+/** Bounded to "a few MB": a cache this size can hold any realistic
+    top-K working set, and a fat-fingered config can't eat the heap. */
+constexpr size_t kDefaultSizeBytes = 4 * 1024 * 1024;
+constexpr size_t kMaxSizeBytes = 64 * 1024 * 1024;
+constexpr size_t kDefaultTtlMs = 1000;
+
+} // anonymous namespace
+
+McrouterRouteHandlePtr makeMicrocacheRoute(
+    RouteHandleFactory<McrouterRouteHandleIf>& factory,
+    const folly::dynamic& json) {
+  checkLogic(json.isObject(), "MicrocacheRoute should be an object");
+  auto jtarget = json.get_ptr("target");
+  checkLogic(jtarget, "MicrocacheRoute: no target");
+  auto target = factory.create(*jtarget);
+
+  size_t sizeBytes = kDefaultSizeBytes;
+  if (auto jsize = json.get_ptr("size_bytes")) {
+    checkLogic(jsize->isInt() && jsize->getInt() > 0,
+               "MicrocacheRoute: size_bytes is not a positive integer");
+    sizeBytes = jsize->getInt();
+    checkLogic(sizeBytes <= kMaxSizeBytes,
+               "MicrocacheRoute: size_bytes is larger than {}",
+               kMaxSizeBytes);
+  }
+
+  size_t ttlMs = kDefaultTtlMs;
+  if (auto jttl = json.get_ptr("ttl_ms")) {
+    checkLogic(jttl->isInt() && jttl->getInt() > 0,
+               "MicrocacheRoute: ttl_ms is not a positive integer");
+    ttlMs = jttl->getInt();
+  }
+
+  return makeMcrouterRouteHandle<MicrocacheRoute>(
+    std::move(target), sizeBytes, ttlMs);
+}
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,187 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+
+#include <folly/Conv.h>
+#include <folly/experimental/StringKeyedUnorderedMap.h>
+#include <folly/io/IOBuf.h>
+
+#include "mcrouter/McrouterFiberContext.h"
+#include "mcrouter/Proxy.h"
+#include "mcrouter/lib/McResUtil.h"
+#include "mcrouter/lib/Operation.h"
+#include "mcrouter/lib/OperationTraits.h"
+#include "mcrouter/lib/Reply.h"
+#include "mcrouter/lib/RouteHandleTraverser.h"
+#include "mcrouter/lib/network/gen/Memcache.h"
+#include "mcrouter/routes/McrouterRouteHandle.h"
+#include "mcrouter/stats.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Tiny in-process cache for ultra-hot keys.
+ *
+ * Plain gets for keys currently in the proxy's hot key top-K (see
+ * HotKeyTracker) can be answered straight from a small LRU in mcrouter
+ * memory, so one viral key is absorbed at the router layer instead of
+ * melting its memcached box.  Entries carry a short TTL; on top of
+ * that, updates, deletes and arithmetic ops passing through this route
+ * invalidate the cached entry before being forwarded, so the TTL only
+ * bounds staleness for writes that bypass this mcrouter.
+ *
+ * Gets with stronger semantics (gets/cas, lease-get, metaget) are
+ * never served from the microcache.  The cache belongs to this route
+ * instance: it is proxy-thread-only and starts cold on reconfiguration.
+ */
+class MicrocacheRoute {
+ public:
+  std::string routeName() const {
+    return folly::to<std::string>(
+      "microcache|size_bytes=", maxSizeBytes_, "|ttl_ms=", ttlMs_);
+  }
+
+  MicrocacheRoute(McrouterRouteHandlePtr target,
+                  size_t maxSizeBytes,
+                  size_t ttlMs)
+    : target_(std::move(target)),
+      maxSizeBytes_(maxSizeBytes),
+      ttlMs_(ttlMs) {
+  }
+
+  template <class Request>
+  void traverse(const Request& req,
+                const RouteHandleTraverser<McrouterRouteHandleIf>& t) const {
+    t(*target_, req);
+  }
+
+  McGetReply route(const McGetRequest& req) {
+    auto& proxy = fiber_local::getSharedCtx()->proxy();
+    const auto key = req.key().fullKey();
+    const auto now = nowUs();
+
+    auto it = cache_.find(key);
+    if (it != cache_.end()) {
+      if (now < it->second->expiryUs) {
+        /* Move to the front of the LRU and serve from memory */
+        lru_.splice(lru_.begin(), lru_, it->second);
+        stat_incr(proxy.stats, microcache_hits_stat, 1);
+        McGetReply reply(mc_res_found);
+        reply.value() = it->second->value;
+        reply.flags() = it->second->flags;
+        return reply;
+      }
+      evict(it);
+    }
+
+    auto reply = target_->route(req);
+    if (isHitResult(reply.result()) && reply.value().hasValue() &&
+        proxy.hotKeys.isHot(key)) {
+      store(key, reply.value().value(), reply.flags(), now);
+      stat_incr(proxy.stats, microcache_stores_stat, 1);
+    }
+    return reply;
+  }
+
+  template <class Request>
+  ReplyT<Request> route(const Request& req) {
+    invalidate(req);
+    return target_->route(req);
+  }
+
+ private:
+  struct Entry {
+    std::string key;
+    folly::IOBuf value;
+    uint64_t flags;
+    int64_t expiryUs;
+    size_t bytes;
+  };
+  using Lru = std::list<Entry>;
+
+  const McrouterRouteHandlePtr target_;
+  const size_t maxSizeBytes_;
+  const size_t ttlMs_;
+
+  /** Most recently used first */
+  Lru lru_;
+  folly::StringKeyedUnorderedMap<Lru::iterator> cache_;
+  size_t sizeBytes_{0};
+
+  template <class Request>
+  void invalidate(const Request& req, UpdateLikeT<Request> = 0) {
+    invalidateKey(req.key().fullKey());
+  }
+  template <class Request>
+  void invalidate(const Request& req, DeleteLikeT<Request> = 0) {
+    invalidateKey(req.key().fullKey());
+  }
+  template <class Request>
+  void invalidate(const Request& req, ArithmeticLikeT<Request> = 0) {
+    invalidateKey(req.key().fullKey());
+  }
+  template <class Request>
+  void invalidate(const Request&,
+                  OtherThanT<Request,
+                             UpdateLike<>,
+                             DeleteLike<>,
+                             ArithmeticLike<>> = 0) {
+  }
+
+  void invalidateKey(folly::StringPiece key) {
+    auto it = cache_.find(key);
+    if (it != cache_.end()) {
+      stat_incr(fiber_local::getSharedCtx()->proxy().stats,
+                microcache_invalidates_stat, 1);
+      evict(it);
+    }
+  }
+
+  void evict(folly::StringKeyedUnorderedMap<Lru::iterator>::iterator it) {
+    sizeBytes_ -= it->second->bytes;
+    lru_.erase(it->second);
+    cache_.erase(it);
+  }
+
+  void store(folly::StringPiece key,
+             const folly::IOBuf& value,
+             uint64_t flags,
+             int64_t now) {
+    auto it = cache_.find(key);
+    if (it != cache_.end()) {
+      evict(it);
+    }
+
+    const size_t bytes = key.size() + value.computeChainDataLength() +
+      sizeof(Entry);
+    if (bytes > maxSizeBytes_) {
+      return;
+    }
+    while (sizeBytes_ + bytes > maxSizeBytes_) {
+      auto oldest = cache_.find(lru_.back().key);
+      assert(oldest != cache_.end());
+      evict(oldest);
+    }
+
+    lru_.push_front(Entry{key.str(),
+                          value,
+                          flags,
+                          now + static_cast<int64_t>(ttlMs_) * 1000,
+                          bytes});
+    cache_[key] = lru_.begin();
+    sizeBytes_ += bytes;
+  }
+};
+
+}}}  // facebook::memcache::mcrouter
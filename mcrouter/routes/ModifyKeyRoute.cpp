@@ -27,21 +27,31 @@ ModifyKeyRoute::ModifyKeyRoute(
       keyPrefix_(std::move(keyPrefix)),
       modifyInplace_(modifyInplace) {}
 
-folly::Optional<std::string> ModifyKeyRoute::getModifiedKey(
+bool ModifyKeyRoute::needsKeyEdit(
     const carbon::Keys<folly::IOBuf>& reqKey) const {
+  if (!reqKey.keyWithoutRoute().startsWith(keyPrefix_)) {
+    return true;
+  }
+  return routingPrefix_.hasValue() &&
+      routingPrefix_.value() != reqKey.routingPrefix();
+}
+
+void ModifyKeyRoute::applyKeyEdit(
+    carbon::Keys<folly::IOBuf>& reqKey) const {
   folly::StringPiece rp = routingPrefix_.hasValue() ? routingPrefix_.value()
                                                     : reqKey.routingPrefix();
-
-  if (!reqKey.keyWithoutRoute().startsWith(keyPrefix_)) {
-    auto keyWithoutRoute = reqKey.keyWithoutRoute();
-    if (modifyInplace_ && keyWithoutRoute.size() >= keyPrefix_.size()) {
-      keyWithoutRoute.advance(keyPrefix_.size());
-    }
-    return folly::to<std::string>(rp, keyPrefix_, keyWithoutRoute);
-  } else if (routingPrefix_.hasValue() && rp != reqKey.routingPrefix()) {
-    return folly::to<std::string>(rp, reqKey.keyWithoutRoute());
+  /* Decide both edits off the original key before splicing. */
+  const bool ensurePrefix = !reqKey.keyWithoutRoute().startsWith(keyPrefix_);
+  const size_t removeLen = ensurePrefix && modifyInplace_ &&
+          reqKey.keyWithoutRoute().size() >= keyPrefix_.size()
+      ? keyPrefix_.size()
+      : 0;
+  if (routingPrefix_.hasValue() && rp != reqKey.routingPrefix()) {
+    reqKey.spliceKey(0, reqKey.routingPrefix().size(), rp);
+  }
+  if (ensurePrefix) {
+    reqKey.spliceKey(rp.size(), removeLen, keyPrefix_);
   }
-  return folly::none;
 }
 
 McrouterRouteHandlePtr makeModifyKeyRoute(
@@ -57,20 +57,27 @@ class ModifyKeyRoute {
   void traverse(const Request& req,
                 const RouteHandleTraverser<McrouterRouteHandleIf>& t) const {
     auto cloneReq = req;
-    auto key = getModifiedKey(req.key());
-    if (key) {
-      cloneReq.key() = key.value();
+    if (needsKeyEdit(cloneReq.key())) {
+      applyKeyEdit(cloneReq.key());
     }
     t(*target_, cloneReq);
   }
 
   template <class Request>
   ReplyT<Request> route(const Request& req) const {
-    const auto key = getModifiedKey(req.key());
-    if (key) {
-      return routeReqWithKey(req, key.value());
+    if (!needsKeyEdit(req.key())) {
+      return target_->route(req);
     }
-    return target_->route(req);
+    auto cloneReq = req;
+    applyKeyEdit(cloneReq.key());
+    const auto err = isKeyValid(cloneReq.key().fullKey());
+    if (err != mc_req_err_valid) {
+      return createReply<Request>(
+          ErrorReply,
+          "ModifyKeyRoute: invalid key: " +
+              std::string(mc_req_err_to_string(err)));
+    }
+    return target_->route(cloneReq);
   }
 
  private:
@@ -79,23 +86,17 @@ class ModifyKeyRoute {
   const std::string keyPrefix_;
   const bool modifyInplace_;
 
-  folly::Optional<std::string> getModifiedKey(
-      const carbon::Keys<folly::IOBuf>& reqKey) const;
+  /**
+   * Cheap check whether the key needs any modification; the common
+   * "already in shape" case then routes the original request untouched.
+   */
+  bool needsKeyEdit(const carbon::Keys<folly::IOBuf>& reqKey) const;
 
-  template <class Request>
-  ReplyT<Request>
-  routeReqWithKey(const Request& req, folly::StringPiece key) const {
-    auto err = isKeyValid(key);
-    if (err != mc_req_err_valid) {
-      return createReply<Request>(
-          ErrorReply,
-          "ModifyKeyRoute: invalid key: " +
-              std::string(mc_req_err_to_string(err)));
-    }
-    auto cloneReq = req;
-    cloneReq.key() = key;
-    return target_->route(cloneReq);
-  }
+  /**
+   * Rewrites the key in place via Keys::spliceKey(); short keys are
+   * edited within the key's inline buffer without allocating.
+   */
+  void applyKeyEdit(carbon::Keys<folly::IOBuf>& reqKey) const;
 };
 
 }}}  // facebook::memcache::mcrouter
@@ -0,0 +1,65 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "NegativeCacheRoute.h"
+
+#include <folly/dynamic.h>
+
+#include "mcrouter/lib/config/RouteHandleFactory.h"
+#include "mcrouter/lib/fbi/cpp/util.h"
+#include "mcrouter/routes/McRouteHandleBuilder.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+namespace {
+
+/** 64K slots x 16 bytes = 1MB per route instance */
+constexpr size_t kDefaultEntries = 64 * 1024;
+constexpr size_t kMaxEntries = 4 * 1024 * 1024;
+constexpr size_t kDefaultTtlMs = 200;
+
+size_t roundUpToPowerOfTwo(size_t n) {
+  size_t result = 1;
+  while (result < n) {
+    result *= 2;
+  }
+  return result;
+}
+
+} // anonymous namespace
+
+McrouterRouteHandlePtr makeNegativeCacheRoute(
+    RouteHandleFactory<McrouterRouteHandleIf>& factory,
+    const folly::dynamic& json) {
+  checkLogic(json.isObject(), "NegativeCacheRoute should be an object");
+  auto jtarget = json.get_ptr("target");
+  checkLogic(jtarget, "NegativeCacheRoute: no target");
+  auto target = factory.create(*jtarget);
+
+  size_t entries = kDefaultEntries;
+  if (auto jentries = json.get_ptr("entries")) {
+    checkLogic(jentries->isInt() && jentries->getInt() > 0,
+               "NegativeCacheRoute: entries is not a positive integer");
+    entries = roundUpToPowerOfTwo(jentries->getInt());
+    checkLogic(entries <= kMaxEntries,
+               "NegativeCacheRoute: entries is larger than {}", kMaxEntries);
+  }
+
+  size_t ttlMs = kDefaultTtlMs;
+  if (auto jttl = json.get_ptr("ttl_ms")) {
+    checkLogic(jttl->isInt() && jttl->getInt() > 0,
+               "NegativeCacheRoute: ttl_ms is not a positive integer");
+    ttlMs = jttl->getInt();
+  }
+
+  return makeMcrouterRouteHandle<NegativeCacheRoute>(
+    std::move(target), entries, ttlMs);
+}
+
+}}}  // facebook::memcache::mcrouter
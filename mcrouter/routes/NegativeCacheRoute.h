@@ -0,0 +1,147 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/Conv.h>
+#include <folly/Hash.h>
+
+#include "mcrouter/McrouterFiberContext.h"
+#include "mcrouter/Proxy.h"
+#include "mcrouter/lib/Operation.h"
+#include "mcrouter/lib/OperationTraits.h"
+#include "mcrouter/lib/Reply.h"
+#include "mcrouter/lib/RouteHandleTraverser.h"
+#include "mcrouter/lib/network/gen/Memcache.h"
+#include "mcrouter/routes/McrouterRouteHandle.h"
+#include "mcrouter/stats.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Remembers recent definite misses and answers repeat probes locally.
+ *
+ * Pools with high miss rates spend most of their round trips
+ * confirming that a key still does not exist.  This route records a
+ * plain get that came back mc_res_notfound in a compact fixed-size
+ * table (64-bit key hash + expiry, 16 bytes per slot, no key storage)
+ * and answers further gets for the same key with a local notfound
+ * until the entry expires a few hundred milliseconds later.  Updates,
+ * deletes and arithmetic ops passing through clear the entry before
+ * being forwarded, so a client that probes, then sets, then gets sees
+ * its own write; the TTL only bounds staleness for writes that bypass
+ * this mcrouter.
+ *
+ * The table is direct-mapped: a colliding key simply overwrites the
+ * slot.  Serving a wrong notfound would need two distinct keys to
+ * share a full 64-bit hash, which we ignore.  Only plain gets are
+ * answered; gets/cas, lease-get and metaget always pass through.
+ */
+class NegativeCacheRoute {
+ public:
+  std::string routeName() const {
+    return folly::to<std::string>(
+      "negative-cache|entries=", entries_.size(), "|ttl_ms=", ttlMs_);
+  }
+
+  NegativeCacheRoute(McrouterRouteHandlePtr target,
+                     size_t numEntries,
+                     size_t ttlMs)
+    : target_(std::move(target)),
+      entries_(numEntries),
+      ttlMs_(ttlMs) {
+    assert((numEntries & (numEntries - 1)) == 0);
+  }
+
+  template <class Request>
+  void traverse(const Request& req,
+                const RouteHandleTraverser<McrouterRouteHandleIf>& t) const {
+    t(*target_, req);
+  }
+
+  McGetReply route(const McGetRequest& req) {
+    const auto hash = keyHash(req);
+    auto& entry = entries_[hash & (entries_.size() - 1)];
+    const auto now = nowUs();
+
+    if (entry.keyHash == hash && now < entry.expiryUs) {
+      stat_incr(fiber_local::getSharedCtx()->proxy().stats,
+                negative_cache_hits_stat, 1);
+      return McGetReply(mc_res_notfound);
+    }
+
+    auto reply = target_->route(req);
+    if (reply.result() == mc_res_notfound) {
+      entry.keyHash = hash;
+      entry.expiryUs = now + static_cast<int64_t>(ttlMs_) * 1000;
+      stat_incr(fiber_local::getSharedCtx()->proxy().stats,
+                negative_cache_stores_stat, 1);
+    } else if (entry.keyHash == hash) {
+      /* The key exists after all (e.g. it was set elsewhere while our
+         entry aged); don't leave a stale miss behind. */
+      entry.expiryUs = 0;
+    }
+    return reply;
+  }
+
+  template <class Request>
+  ReplyT<Request> route(const Request& req) {
+    invalidate(req);
+    return target_->route(req);
+  }
+
+ private:
+  struct Entry {
+    uint64_t keyHash{0};
+    int64_t expiryUs{0};
+  };
+
+  const McrouterRouteHandlePtr target_;
+  std::vector<Entry> entries_;
+  const size_t ttlMs_;
+
+  template <class Request>
+  static uint64_t keyHash(const Request& req) {
+    const auto key = req.key().fullKey();
+    return folly::hash::fnv64_buf(key.data(), key.size());
+  }
+
+  template <class Request>
+  void invalidate(const Request& req, UpdateLikeT<Request> = 0) {
+    invalidateHash(keyHash(req));
+  }
+  template <class Request>
+  void invalidate(const Request& req, DeleteLikeT<Request> = 0) {
+    invalidateHash(keyHash(req));
+  }
+  template <class Request>
+  void invalidate(const Request& req, ArithmeticLikeT<Request> = 0) {
+    invalidateHash(keyHash(req));
+  }
+  template <class Request>
+  void invalidate(const Request&,
+                  OtherThanT<Request,
+                             UpdateLike<>,
+                             DeleteLike<>,
+                             ArithmeticLike<>> = 0) {
+  }
+
+  void invalidateHash(uint64_t hash) {
+    auto& entry = entries_[hash & (entries_.size() - 1)];
+    if (entry.keyHash == hash) {
+      entry.expiryUs = 0;
+    }
+  }
+};
+
+}}}  // facebook::memcache::mcrouter
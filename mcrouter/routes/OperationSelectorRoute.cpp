@@ -54,6 +54,10 @@ McrouterRouteHandlePtr makeOperationSelectorRoute(
       orderedPolicies.emplace(std::move(key), &it.second);
     }
 
+    if (orderedPolicies.empty()) {
+      return defaultPolicy;
+    }
+
     // order is important here: named handles may not be resolved if we parse
     // policies in random order
     for (const auto& it : orderedPolicies) {
@@ -15,11 +15,13 @@ namespace facebook { namespace memcache { namespace mcrouter {
 
 McrouterRouteHandlePtr makeOutstandingLimitRoute(
   McrouterRouteHandlePtr normalRoute,
-  size_t maxOutstanding) {
+  size_t maxOutstanding,
+  bool adaptive) {
 
   return std::make_shared<McrouterRouteHandle<OutstandingLimitRoute>>(
     std::move(normalRoute),
-    maxOutstanding);
+    maxOutstanding,
+    adaptive);
 }
 
 }}}  // facebook::memcache::mcrouter
@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <list>
 #include <memory>
 #include <vector>
@@ -35,11 +36,22 @@ namespace facebook { namespace memcache { namespace mcrouter {
  * No more than N requests will be allowed to be concurrently processed by child
  * route. All blocked requests will be sent one request per sender id in
  * round-robin fashion to guarantee fairness.
+ *
+ * In adaptive mode the configured limit only acts as a ceiling: the
+ * effective limit follows the latency gradient of the child route (the
+ * ratio of a long-term smoothed RTT to the recent smoothed RTT).  When
+ * latency climbs above the baseline the limit is cut multiplicatively;
+ * while the limit is binding and latency stays flat it creeps back up
+ * one slot at a time (AIMD), so a slow destination sheds concurrency
+ * before client fibers start hitting timeouts.
  */
 class OutstandingLimitRoute {
  public:
   std::string routeName() const {
-    return folly::to<std::string>("outstanding-limit|limit=", maxOutstanding_);
+    return adaptive_
+      ? folly::to<std::string>("outstanding-limit|limit=", maxOutstanding_,
+                               "|adaptive")
+      : folly::to<std::string>("outstanding-limit|limit=", maxOutstanding_);
   }
 
   template <class Request>
@@ -48,19 +60,26 @@ class OutstandingLimitRoute {
     t(*target_, req);
   }
 
-  OutstandingLimitRoute(McrouterRouteHandlePtr target, size_t maxOutstanding)
-    : target_(std::move(target)), maxOutstanding_(maxOutstanding) {
+  OutstandingLimitRoute(McrouterRouteHandlePtr target,
+                        size_t maxOutstanding,
+                        bool adaptive = false)
+    : target_(std::move(target)),
+      maxOutstanding_(maxOutstanding),
+      adaptive_(adaptive),
+      currentLimit_(maxOutstanding) {
   }
 
   template <class Request>
   ReplyT<Request> route(const Request& req) {
-    if (outstanding_ == maxOutstanding_) {
+    if (outstanding_ >= currentLimit_) {
       auto& ctx = fiber_local::getSharedCtx();
       auto senderId = ctx->senderId();
       auto& entry = [&]() -> QueueEntry& {
-        auto entry_it = senderIdToEntry_.find(senderId);
-        if (entry_it != senderIdToEntry_.end()) {
-          return *entry_it->second;
+        if (senderId) {
+          auto entry_it = senderIdToEntry_.find(senderId);
+          if (entry_it != senderIdToEntry_.end()) {
+            return *entry_it->second;
+          }
         }
         blockedRequests_.push_back(folly::make_unique<QueueEntry>(senderId));
         if (senderId) {
@@ -70,7 +89,11 @@ class OutstandingLimitRoute {
       }();
 
       auto& stats = ctx->proxy().stats;
-      folly::fibers::Baton baton;
+      /* The waitlist is intrusive: the node lives on this fiber's stack
+         for as long as the fiber is suspended, so queueing a request
+         costs no allocation.  The poster unlinks the node before
+         posting the baton. */
+      Waiter waiter;
       int64_t waitingSince = 0;
       if (GetLike<Request>::value) {
         ++currentGetReqsWaiting_;
@@ -79,8 +102,8 @@ class OutstandingLimitRoute {
         ++currentUpdateReqsWaiting_;
         waitingSince = nowUs();
       }
-      entry.batons.push_back(&baton);
-      baton.wait();
+      entry.push(waiter);
+      waiter.baton.wait();
       if (waitingSince > 0) {
         if (GetLike<Request>::value) {
           stat_incr(stats, outstanding_route_get_wait_time_sum_us_stat,
@@ -100,20 +123,21 @@ class OutstandingLimitRoute {
       }
     } else {
       outstanding_++;
-      assert(outstanding_ <= maxOutstanding_);
+      assert(outstanding_ <= currentLimit_);
     }
 
     SCOPE_EXIT {
-      if (!blockedRequests_.empty()) {
+      /* A shrunken adaptive limit drains by decrementing instead of
+         handing the slot to a waiter until outstanding_ fits again. */
+      if (!blockedRequests_.empty() && outstanding_ <= currentLimit_) {
         auto entry = std::move(blockedRequests_.front());
         blockedRequests_.pop_front();
 
-        assert(!entry->batons.empty());
+        assert(!entry->empty());
 
-        entry->batons.front()->post();
-        entry->batons.pop_front();
+        entry->pop()->baton.post();
 
-        if (!entry->batons.empty()) {
+        if (!entry->empty()) {
           blockedRequests_.push_back(std::move(entry));
         } else {
           senderIdToEntry_.erase(entry->senderId);
@@ -123,15 +147,92 @@ class OutstandingLimitRoute {
       }
     };
 
-    return target_->route(req);
+    if (!adaptive_) {
+      return target_->route(req);
+    }
+
+    const auto startUs = nowUs();
+    auto reply = target_->route(req);
+    recordLatency(nowUs() - startUs);
+    return reply;
   }
 
  private:
   const McrouterRouteHandlePtr target_;
   const size_t maxOutstanding_;
+  const bool adaptive_;
+  size_t currentLimit_;
   size_t outstanding_{0};
   size_t currentGetReqsWaiting_{0};
   size_t currentUpdateReqsWaiting_{0};
+  double fastRttUs_{0.0};
+  double windowMinRttUs_{0.0};
+  double prevMinRttUs_{0.0};
+  size_t samplesInWindow_{0};
+  size_t windowsInEpoch_{0};
+
+  void recordLatency(int64_t rttUs) {
+    constexpr double kFastAlpha = 0.2;
+    constexpr size_t kWindowSamples = 100;
+
+    if (fastRttUs_ == 0.0) {
+      fastRttUs_ = rttUs;
+      return;
+    }
+    fastRttUs_ += kFastAlpha * (rttUs - fastRttUs_);
+    if (++samplesInWindow_ >= kWindowSamples) {
+      samplesInWindow_ = 0;
+      adaptLimit();
+    }
+  }
+
+  void adaptLimit() {
+    constexpr double kGradientTolerance = 0.75;
+    constexpr double kMinGradient = 0.5;
+    constexpr size_t kMinLimit = 1;
+    /* Two rotating min buckets give a baseline horizon of 50-100
+       windows: long enough that a load-induced latency ramp can't drag
+       the baseline up with it, short enough that a destination whose
+       latency is high regardless of load regains its full limit. */
+    constexpr size_t kBaselineEpochWindows = 50;
+
+    if (windowMinRttUs_ == 0.0 || fastRttUs_ < windowMinRttUs_) {
+      windowMinRttUs_ = fastRttUs_;
+    }
+    if (++windowsInEpoch_ >= kBaselineEpochWindows) {
+      windowsInEpoch_ = 0;
+      prevMinRttUs_ = windowMinRttUs_;
+      windowMinRttUs_ = fastRttUs_;
+    }
+    const double baseline = prevMinRttUs_ == 0.0
+      ? windowMinRttUs_
+      : std::min(prevMinRttUs_, windowMinRttUs_);
+
+    /* Values below 1.0 mean recent latency has climbed above the best
+       RTT seen over the baseline horizon. */
+    const double gradient = baseline / fastRttUs_;
+    auto& stats = fiber_local::getSharedCtx()->proxy().stats;
+    if (gradient < kGradientTolerance) {
+      /* Multiplicative decrease, proportional to how steep the climb is;
+         kMinGradient keeps a single spike from crushing the limit. */
+      currentLimit_ = std::max(
+          kMinLimit,
+          static_cast<size_t>(
+              currentLimit_ * std::max(gradient, kMinGradient)));
+      stat_incr(stats, outstanding_route_limit_decreases_stat, 1);
+    } else if (currentLimit_ < maxOutstanding_ &&
+               (outstanding_ >= currentLimit_ || !blockedRequests_.empty())) {
+      /* Additive increase, and only while the limit is actually binding. */
+      ++currentLimit_;
+      stat_incr(stats, outstanding_route_limit_increases_stat, 1);
+    }
+  }
+
+  /* Waitlist node, allocated on the suspended fiber's stack */
+  struct Waiter {
+    folly::fibers::Baton baton;
+    Waiter* next{nullptr};
+  };
 
   struct QueueEntry {
     QueueEntry(QueueEntry&&) = delete;
@@ -139,8 +240,35 @@ class OutstandingLimitRoute {
 
     explicit QueueEntry(size_t senderId_) : senderId(senderId_) {
     }
+
+    void push(Waiter& waiter) {
+      if (tail) {
+        tail->next = &waiter;
+      } else {
+        head = &waiter;
+      }
+      tail = &waiter;
+    }
+
+    /* Unlinks and returns the oldest waiter.  The returned node is only
+       valid until its baton is posted: the owning fiber reclaims it on
+       wakeup. */
+    Waiter* pop() {
+      auto waiter = head;
+      head = waiter->next;
+      if (!head) {
+        tail = nullptr;
+      }
+      return waiter;
+    }
+
+    bool empty() const {
+      return head == nullptr;
+    }
+
     size_t senderId;
-    std::list<folly::fibers::Baton*> batons;
+    Waiter* head{nullptr};
+    Waiter* tail{nullptr};
   };
 
   std::list<std::unique_ptr<QueueEntry>> blockedRequests_;
@@ -9,16 +9,63 @@
  */
 #include "ProxyRoute.h"
 
+#include <chrono>
+
 #include <folly/Optional.h>
+#include <folly/fibers/AddTasks.h>
+#include <folly/fibers/Baton.h>
+#include <folly/ScopeGuard.h>
 
 #include "mcrouter/McrouterInstance.h"
 #include "mcrouter/Proxy.h"
+#include "mcrouter/lib/McResUtil.h"
 #include "mcrouter/routes/RootRoute.h"
 
 namespace facebook {
 namespace memcache {
 namespace mcrouter {
 
+/**
+ * In-flight lease-get state for one key (see ProxyRoute::route for
+ * McLeaseGetRequest). The entry lives on the leader fiber's stack;
+ * waiter nodes live on the waiting fibers' stacks, so parking a
+ * request costs no allocation. Proxy thread only, so no locking.
+ */
+struct LeaseGetCollapseEntry {
+  struct Waiter {
+    folly::fibers::Baton baton;
+    /** Set by the leader before posting when its reply is shareable. */
+    folly::Optional<McLeaseGetReply> reply;
+    Waiter* next{nullptr};
+  };
+
+  void push(Waiter& waiter) {
+    if (tail) {
+      tail->next = &waiter;
+    } else {
+      head = &waiter;
+    }
+    tail = &waiter;
+  }
+
+  /** Unlinks a waiter that timed out; a no-op if it was already popped. */
+  void remove(Waiter& waiter) {
+    Waiter* prev = nullptr;
+    for (auto cur = head; cur != nullptr; prev = cur, cur = cur->next) {
+      if (cur == &waiter) {
+        (prev != nullptr ? prev->next : head) = waiter.next;
+        if (tail == &waiter) {
+          tail = prev;
+        }
+        return;
+      }
+    }
+  }
+
+  Waiter* head{nullptr};
+  Waiter* tail{nullptr};
+};
+
 McrouterRouteHandlePtr makeBigValueRoute(McrouterRouteHandlePtr ch,
                                          BigValueRouteOptions options);
 
@@ -40,6 +87,91 @@ ProxyRoute::ProxyRoute(Proxy* proxy, const RouteSelectorMap& routeSelectors)
   }
 }
 
+McLeaseGetReply ProxyRoute::route(const McLeaseGetRequest& req) const {
+  const auto waitMs = proxy_->getRouterOptions().lease_get_collapse_wait_ms;
+  if (waitMs == 0) {
+    return root_->route(req);
+  }
+
+  auto& inFlight = proxy_->leaseGetInFlight;
+  auto keyStr = req.key().fullKey().str();
+  auto it = inFlight.find(keyStr);
+
+  if (it == inFlight.end()) {
+    /* Leader: route normally and answer whoever piled up behind us. */
+    LeaseGetCollapseEntry entry;
+    inFlight.emplace(keyStr, &entry);
+    SCOPE_EXIT {
+      /* Erase by key: insertions for other keys while we were
+         suspended may have rehashed the table. Waiters left without a
+         reply (miss, error or an exception below) route themselves. */
+      inFlight.erase(keyStr);
+      while (auto waiter = entry.head) {
+        entry.head = waiter->next;
+        waiter->baton.post();
+      }
+      entry.tail = nullptr;
+    };
+    auto reply = root_->route(req);
+    if (isHitResult(reply.result())) {
+      for (auto waiter = entry.head; waiter != nullptr;
+           waiter = waiter->next) {
+        waiter->reply = reply;
+      }
+    }
+    return reply;
+  }
+
+  /* Another lease-get for this key is outstanding; park behind it. */
+  LeaseGetCollapseEntry::Waiter waiter;
+  it->second->push(waiter);
+  const bool posted =
+    waiter.baton.timed_wait(std::chrono::milliseconds(waitMs));
+  if (!posted) {
+    /* Timed out. Unlink our stack node so the leader doesn't touch it
+       after we're gone; re-find the entry since the leader may have
+       finished (and popped us) while our wakeup was pending. */
+    auto entryIt = inFlight.find(keyStr);
+    if (entryIt != inFlight.end()) {
+      entryIt->second->remove(waiter);
+    }
+    stat_incr(proxy_->stats, lease_get_collapse_timeouts_stat, 1);
+  }
+  if (waiter.reply.hasValue()) {
+    stat_incr(proxy_->stats, lease_get_collapsed_stat, 1);
+    return std::move(waiter.reply.value());
+  }
+  return root_->route(req);
+}
+
+std::vector<McGetReply> ProxyRoute::route(
+    std::vector<McGetRequest>&& reqs) const {
+  std::vector<McGetReply> replies(reqs.size());
+  if (reqs.empty()) {
+    return replies;
+  }
+
+  // The route handle interface is per-request, so we can't partition the
+  // batch by hash below this point.  Instead, fan all keys out through
+  // the tree at once: tasks run concurrently on this thread's fiber
+  // manager, so requests that end up on the same destination are picked
+  // up together by a single write loop iteration.
+  std::vector<std::function<McGetReply()>> funcs;
+  funcs.reserve(reqs.size());
+  for (size_t i = 0; i < reqs.size(); ++i) {
+    funcs.push_back([this, &reqs, i]() {
+      return root_->route(reqs[i]);
+    });
+  }
+
+  auto taskIt = folly::fibers::addTasks(funcs.begin(), funcs.end());
+  while (taskIt.hasNext()) {
+    auto reply = taskIt.awaitNext();
+    replies[taskIt.getTaskID()] = std::move(reply);
+  }
+  return replies;
+}
+
 std::vector<McrouterRouteHandlePtr> ProxyRoute::getAllDestinations() const {
   std::vector<McrouterRouteHandlePtr> rh;
   for (auto& it : proxy_->getConfig()->getPools()) {
@@ -55,6 +55,24 @@ class ProxyRoute {
     return AllSyncRoute<McrouterRouteHandleIf>(getAllDestinations()).route(req);
   }
 
+  /**
+   * With --lease-get-collapse-wait-ms set, at most one lease-get per
+   * key is in flight below this point: concurrent lease-gets for the
+   * same key park on the proxy's in-flight table and are answered from
+   * the first reply when it is a hit, or routed as usual once it comes
+   * back a miss (or after the wait times out).
+   */
+  McLeaseGetReply route(const McLeaseGetRequest& req) const;
+
+  /**
+   * Batch entry point for multi-key gets: dispatches the whole batch in
+   * a single fiber task batch instead of one dispatch per key, and
+   * returns the replies in request order.  Requests that hash to the
+   * same destination are coalesced into one batched write by the client
+   * write loop.
+   */
+  std::vector<McGetReply> route(std::vector<McGetRequest>&& reqs) const;
+
  private:
   Proxy* proxy_;
   McrouterRouteHandlePtr root_;
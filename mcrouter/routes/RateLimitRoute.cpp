@@ -31,7 +31,11 @@ McrouterRouteHandlePtr makeRateLimitRoute(
   auto target = factory.create(*jtarget);
   auto jrates = json.get_ptr("rates");
   checkLogic(jrates, "RateLimitRoute: rates not found");
-  return makeRateLimitRoute(std::move(target), RateLimiter(*jrates));
+  RateLimiter rateLimiter(*jrates);
+  if (rateLimiter.isNoop()) {
+    return target;
+  }
+  return makeRateLimitRoute(std::move(target), std::move(rateLimiter));
 }
 
 }}}  // facebook::memcache::mcrouter
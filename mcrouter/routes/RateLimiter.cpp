@@ -52,19 +52,19 @@ RateLimiter::RateLimiter(const folly::dynamic& json) {
   if (json.count("gets_rate")) {
     double rate = asPositiveDouble(json, "gets_rate");
     double burst = asPositiveDoubleDefault(json, "gets_burst", rate);
-    getsTb_ = folly::TokenBucket(rate, burst, now);
+    getsTb_ = TokenBucket(rate, burst, now);
   }
 
   if (json.count("sets_rate")) {
     double rate = asPositiveDouble(json, "sets_rate");
     double burst = asPositiveDoubleDefault(json, "sets_burst", rate);
-    setsTb_ = folly::TokenBucket(rate, burst, now);
+    setsTb_ = TokenBucket(rate, burst, now);
   }
 
   if (json.count("deletes_rate")) {
     double rate = asPositiveDouble(json, "deletes_rate");
     double burst = asPositiveDoubleDefault(json, "deletes_burst", rate);
-    deletesTb_ = folly::TokenBucket(rate, burst, now);
+    deletesTb_ = TokenBucket(rate, burst, now);
   }
 }
 
@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include <algorithm>
+
 #include <folly/Optional.h>
 #include <folly/TokenBucket.h>
 
@@ -43,6 +45,44 @@ class RateLimiter {
    */
   explicit RateLimiter(const folly::dynamic& json);
 
+  /**
+   * Single-threaded token bucket.  Route handles, and therefore rate
+   * limiters, belong to one proxy thread, so consuming a token is plain
+   * arithmetic; there is no need for folly::TokenBucket's atomic
+   * compare-and-swap loop on every request.
+   */
+  class TokenBucket {
+   public:
+    /* Like folly::TokenBucket, starts empty and fills at 'rate' */
+    TokenBucket(double rate, double burst, double nowInSeconds)
+        : rate_(rate),
+          burst_(burst),
+          tokens_(0.0),
+          lastUpdate_(nowInSeconds) {}
+
+    bool consume(double toConsume, double nowInSeconds) {
+      if (nowInSeconds > lastUpdate_) {
+        tokens_ = std::min(
+            burst_, tokens_ + (nowInSeconds - lastUpdate_) * rate_);
+        lastUpdate_ = nowInSeconds;
+      }
+      if (tokens_ < toConsume) {
+        return false;
+      }
+      tokens_ -= toConsume;
+      return true;
+    }
+
+    double rate() const { return rate_; }
+    double burst() const { return burst_; }
+
+   private:
+    double rate_;
+    double burst_;
+    double tokens_;
+    double lastUpdate_;
+  };
+
   template <class Request>
   bool canPassThrough(GetLikeT<Request> = 0) {
     return LIKELY(
@@ -72,15 +112,24 @@ class RateLimiter {
     return true;
   }
 
+  /**
+   * @return true if no operation type is rate limited, i.e. the limiter
+   *         would pass every request through.
+   */
+  bool isNoop() const {
+    return !getsTb_.hasValue() && !setsTb_.hasValue() &&
+           !deletesTb_.hasValue();
+  }
+
   /**
    * String representation useful for debugging
    */
   std::string toDebugStr() const;
 
  private:
-  folly::Optional<folly::TokenBucket> getsTb_;
-  folly::Optional<folly::TokenBucket> setsTb_;
-  folly::Optional<folly::TokenBucket> deletesTb_;
+  folly::Optional<TokenBucket> getsTb_;
+  folly::Optional<TokenBucket> setsTb_;
+  folly::Optional<TokenBucket> deletesTb_;
 };
 
 }}}  // facebook::memcache::mcrouter
@@ -16,6 +16,7 @@
 
 #include <folly/fibers/FiberManager.h>
 #include <folly/Hash.h>
+#include <folly/Likely.h>
 
 #include "mcrouter/Proxy.h"
 #include "mcrouter/RoutingPrefix.h"
@@ -109,6 +110,7 @@ RouteHandleMap::RouteHandleMap(
 
   assert(byRoute_.find(defaultRoute_) != byRoute_.end());
   defaultRouteMap_ = byRoute_[defaultRoute_];
+  defaultRouteUniformTargets_ = defaultRouteMap_->getUniformTargets();
 }
 
 void RouteHandleMap::foreachRoutePolicy(folly::StringPiece prefix,
@@ -186,6 +188,12 @@ RouteHandleMap::getTargetsForKeyFast(folly::StringPiece prefix,
   const std::vector<McrouterRouteHandlePtr>* result = nullptr;
   if (prefix.empty()) {
     // empty prefix => route to default route
+    if (LIKELY(defaultRouteUniformTargets_ != nullptr)) {
+      /* No key-prefix policies: every unprefixed key resolves to the same
+         precomputed targets, so skip the prefix lookup entirely.  The
+         invalid-route fallback below would return the same vector. */
+      return defaultRouteUniformTargets_;
+    }
     result = &defaultRouteMap_->getTargetsForKey(key);
   } else if (prefix == "/*/*/") {
     // route to all routes
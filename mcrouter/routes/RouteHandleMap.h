@@ -58,6 +58,13 @@ class RouteHandleMap {
   const RoutingPrefix& defaultRoute_;
   bool sendInvalidRouteToDefault_;
   std::shared_ptr<RoutePolicyMap> defaultRouteMap_;
+  /**
+   * Targets every unprefixed key resolves to, when the default route has
+   * no key-prefix policies (the overwhelmingly common config).  nullptr
+   * if targets depend on the key.
+   */
+  const std::vector<McrouterRouteHandlePtr>* defaultRouteUniformTargets_{
+      nullptr};
 
   std::shared_ptr<RoutePolicyMap> allRoutes_;
   folly::StringKeyedUnorderedMap<std::shared_ptr<RoutePolicyMap>> byRegion_;
@@ -10,9 +10,11 @@
 #include "RoutePolicyMap.h"
 
 #include <algorithm>
+#include <string>
 #include <unordered_set>
 #include <utility>
 
+#include "mcrouter/lib/fbi/cpp/Trie.h"
 #include "mcrouter/routes/PrefixSelectorRoute.h"
 
 using std::pair;
@@ -65,24 +67,37 @@ RoutePolicyMap::RoutePolicyMap(
     }
   }
 
-  ut_.emplace("", std::move(wildcards));
-  // we iterate over keys in lexicographic order, so all prefixes of key will go
-  // before key itself
+  vector<pair<std::string, vector<McrouterRouteHandlePtr>>> items;
+  items.emplace_back("", std::move(wildcards));
+  // we iterate over keys in lexicographic order, so all prefixes of key will
+  // go before key itself and the current prefix chain forms a stack
+  vector<size_t> chain{0};
   for (auto& it : t) {
-    auto existing = ut_.findPrefix(it.first);
-    // at least empty string should be there
-    assert(existing != ut_.end());
-    ut_.emplace(it.first, overrideItems(existing->second, it.second));
+    folly::StringPiece key = it.first;
+    while (chain.size() > 1 && !key.startsWith(items[chain.back()].first)) {
+      chain.pop_back();
+    }
+    items.emplace_back(it.first,
+                       overrideItems(items[chain.back()].second, it.second));
+    chain.push_back(items.size() - 1);
   }
-  for (auto& it : ut_) {
+  for (auto& it : items) {
     it.second = orderedUnique(it.second);
   }
+  ut_ = PrefixMap<vector<McrouterRouteHandlePtr>>(std::move(items));
 }
 
 const vector<McrouterRouteHandlePtr>&
 RoutePolicyMap::getTargetsForKey(folly::StringPiece key) const {
   auto result = ut_.findPrefix(key);
-  return result == ut_.end() ? emptyV_ : result->second;
+  return result == nullptr ? emptyV_ : *result;
+}
+
+const vector<McrouterRouteHandlePtr>*
+RoutePolicyMap::getUniformTargets() const {
+  // The wildcards entry (key "") is always stored, so a single entry
+  // means every key resolves to it.
+  return ut_.size() == 1 ? &getTargetsForKey(folly::StringPiece()) : nullptr;
 }
 
 }}}  // facebook::memcache::mcrouter
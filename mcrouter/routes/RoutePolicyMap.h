@@ -14,7 +14,7 @@
 
 #include <folly/Range.h>
 
-#include "mcrouter/lib/fbi/cpp/Trie.h"
+#include "mcrouter/lib/fbi/cpp/PrefixMap.h"
 #include "mcrouter/routes/McrouterRouteHandle.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
@@ -56,15 +56,22 @@ class RoutePolicyMap {
   const std::vector<McrouterRouteHandlePtr>&
   getTargetsForKey(folly::StringPiece key) const;
 
+  /**
+   * If this map routes every key to the same targets, i.e. no cluster has
+   * key-prefix policies configured, returns that single targets vector.
+   * Returns nullptr otherwise.  The pointer stays valid as long as this map.
+   */
+  const std::vector<McrouterRouteHandlePtr>* getUniformTargets() const;
+
  private:
   const std::vector<McrouterRouteHandlePtr> emptyV_;
   /**
-   * This Trie contains targets for each key prefix. It is built like this:
+   * This map contains targets for each key prefix. It is built like this:
    * 1) targets for empty string are wildcards.
    * 2) targets for string of length n+1 S[0..n] are targets for S[0..n-1] with
    *    OperationSelectorRoutes for key prefix == S[0..n] overridden.
    */
-  Trie<std::vector<McrouterRouteHandlePtr>> ut_;
+  PrefixMap<std::vector<McrouterRouteHandlePtr>> ut_;
 };
 
 }}}  // facebook::memcache::mcrouter
@@ -51,15 +51,20 @@ void ShadowRoute<ShadowPolicy>::sendAndValidateRequestGetImpl(
 
   auto normalDest = normalReply.destination();
 
-  folly::fibers::addTask(
+  auto ctx = fiber_local::getSharedCtx();
+  auto& proxy = ctx->proxy();
+  proxy.dispatchShadowTask(
     [shadow = std::move(shadow),
      adjustedReq = std::move(adjustedReq),
      flags,
      result,
      hashVal,
-     normalDest = std::move(normalDest)]() mutable {
-      // we don't want to spool shadow request
-      fiber_local::clearAsynclogName();
+     normalDest = std::move(normalDest),
+     ctx = std::move(ctx)]() mutable {
+      // This runs on a fresh fiber without the request's locals, so
+      // restore its context; the asynclog name starts out clear, which
+      // is what we want (shadow requests aren't spooled)
+      fiber_local::setSharedCtx(std::move(ctx));
       fiber_local::addRequestClass(RequestClass::kShadow);
 
       auto shadowReply = shadow->route(*adjustedReq);
@@ -94,10 +99,19 @@ void ShadowRoute<ShadowPolicy>::dispatchShadowRequest(
     std::shared_ptr<McrouterRouteHandleIf> shadow,
     std::shared_ptr<Request> adjustedReq) const {
 
-  folly::fibers::addTask(
-    [shadow = std::move(shadow), adjustedReq = std::move(adjustedReq)]() {
-      // we don't want to spool shadow requests
-      fiber_local::clearAsynclogName();
+  /* Shadows go through the proxy's low priority queue instead of
+     straight onto a fiber, so slow shadow targets can't backpressure
+     the production path; the queue is bounded and drops on overflow */
+  auto ctx = fiber_local::getSharedCtx();
+  auto& proxy = ctx->proxy();
+  proxy.dispatchShadowTask(
+    [shadow = std::move(shadow),
+     adjustedReq = std::move(adjustedReq),
+     ctx = std::move(ctx)]() mutable {
+      // This runs on a fresh fiber without the request's locals, so
+      // restore its context; the asynclog name starts out clear, which
+      // is what we want (shadow requests aren't spooled)
+      fiber_local::setSharedCtx(std::move(ctx));
       fiber_local::addRequestClass(RequestClass::kShadow);
       shadow->route(*adjustedReq);
     });
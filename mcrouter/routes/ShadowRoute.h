@@ -66,6 +66,9 @@ class ShadowRoute {
         if (!adjustedReq) {
           adjustedReq = std::make_shared<Request>(
             shadowPolicy_.updateRequestForShadowing(req));
+          // The normal route and all shadows see this same object, so
+          // the serialized body can be shared between the legs.
+          adjustedReq->markFanout();
         }
         if (!normalReply && shadowPolicy_.shouldDelayShadow(req)) {
           normalReply = normal_->route(*adjustedReq);
@@ -49,20 +49,17 @@ bool ConstShardHashFunc::shardLookup(folly::StringPiece key,
   if (!getShardId(key, shard)) {
     return false;
   }
-  for (const auto& iter: shard) {
-    if (!isdigit(iter)) {
+  // Validate and accumulate in one pass; checking the bound as we go also
+  // rules out overflow without folly::to()'s exception machinery.
+  size_t index = 0;
+  for (const auto c : shard) {
+    if (!isdigit(c)) {
       return false;
     }
-  }
-  size_t index;
-  try {
-    index = folly::to<size_t>(shard);
-  } catch (...) {
-    return false;
-  }
-
-  if (index >= n_) {
-    return false; // out of bounds
+    index = index * 10 + (c - '0');
+    if (index >= n_) {
+      return false; // out of bounds
+    }
   }
   *result = index;
   return true;
@@ -15,6 +15,7 @@
 
 #include <folly/dynamic.h>
 #include <folly/fibers/FiberManager.h>
+#include <folly/io/IOBuf.h>
 #include <folly/Range.h>
 
 #include "mcrouter/config.h"
@@ -145,7 +146,14 @@ class ShardSplitRoute {
   Request splitReq(const Request& req, size_t offset,
                    folly::StringPiece shard) const {
     auto reqCopy = req;
-    reqCopy.key() = createSplitKey(req.key().fullKey(), offset, shard);
+    const char suffix[2] = {static_cast<char>('a' + offset % 26),
+                            static_cast<char>('a' + offset / 26)};
+    /* Insert the split suffix in place right after the shard id; short
+       keys are rewritten within the key's inline buffer without
+       allocating. */
+    reqCopy.key().spliceKey(shard.end() - req.key().fullKey().begin(),
+                            0,
+                            folly::StringPiece(suffix, sizeof(suffix)));
     return reqCopy;
   }
 };
@@ -9,6 +9,8 @@
  */
 #include "ShardSplitter.h"
 
+#include <algorithm>
+
 #include <folly/dynamic.h>
 
 #include "mcrouter/routes/ShardHashFunc.h"
@@ -17,6 +19,35 @@ namespace facebook { namespace memcache { namespace mcrouter {
 
 constexpr size_t kMaxSplits = 26 * 26;
 
+/** Bound on the dense lookup table: 1M shards x 4 bytes = 4MB */
+constexpr size_t kMaxDenseShard = 1024 * 1024;
+
+namespace {
+
+/**
+ * Parses a decimal shard id, bounding it by `limit` as it accumulates
+ * (which also rules out overflow). Returns false for non-numeric or
+ * out-of-bounds ids.
+ */
+bool parseShardId(folly::StringPiece shard, size_t limit, size_t& id) {
+  if (shard.empty()) {
+    return false;
+  }
+  id = 0;
+  for (const auto c : shard) {
+    if (!isdigit(c)) {
+      return false;
+    }
+    id = id * 10 + (c - '0');
+    if (id >= limit) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // anonymous namespace
+
 ShardSplitter::ShardSplitter(const folly::dynamic& json) {
   if (!json.isObject()) {
     return;
@@ -41,14 +72,46 @@ ShardSplitter::ShardSplitter(const folly::dynamic& json) {
       shardSplits_.emplace(it.first.c_str(), splitCnt);
     }
   }
+
+  /* Build the dense table for numeric shard ids; anything non-numeric
+     or past the bound stays map-only. */
+  size_t maxId = 0;
+  bool haveDense = false;
+  for (const auto& it : shardSplits_) {
+    size_t id;
+    if (parseShardId(it.first, kMaxDenseShard, id)) {
+      maxId = std::max(maxId, id);
+      haveDense = true;
+    }
+  }
+  if (haveDense) {
+    denseSplits_.assign(maxId + 1, 1);
+    for (const auto& it : shardSplits_) {
+      size_t id;
+      if (parseShardId(it.first, kMaxDenseShard, id)) {
+        denseSplits_[id] = it.second;
+      }
+    }
+  }
 }
 
 size_t ShardSplitter::getShardSplitCnt(folly::StringPiece routingKey,
                                        folly::StringPiece& shard) const {
+  if (shardSplits_.empty()) {
+    // Common case for tiers with no splits configured: skip the key scan.
+    return 1;
+  }
+
   if (!getShardId(routingKey, shard)) {
     return 1;
   }
 
+  /* Fast path: numeric shard id within the dense table is two loads */
+  size_t id;
+  if (parseShardId(shard, denseSplits_.size(), id)) {
+    return denseSplits_[id];
+  }
+
   auto splitIt = shardSplits_.find(shard);
   if (splitIt == shardSplits_.end()) {
     return 1;
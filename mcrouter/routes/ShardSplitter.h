@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include <vector>
+
 #include <folly/experimental/StringKeyedUnorderedMap.h>
 #include <folly/Range.h>
 
@@ -38,6 +40,15 @@ class ShardSplitter {
   }
  private:
   folly::StringKeyedUnorderedMap<size_t> shardSplits_;
+
+  /**
+   * Dense split counts indexed by numeric shard id, built at config
+   * time. getShardSplitCnt() runs on every request of a sharded
+   * service, so the common case (numeric shard id within bounds) is
+   * answered with an array load instead of a string-keyed hash lookup;
+   * non-numeric or very large shard ids fall back to shardSplits_.
+   */
+  std::vector<uint32_t> denseSplits_;
 };
 
 }}}  // facebook::memcache::mcrouter
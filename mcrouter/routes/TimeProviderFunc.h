@@ -10,6 +10,9 @@
 #pragma once
 
 #include "mcrouter/config.h"
+#include "mcrouter/McrouterFiberContext.h"
+#include "mcrouter/Proxy.h"
+#include "mcrouter/ProxyRequestContext.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
@@ -17,6 +20,11 @@ namespace facebook { namespace memcache { namespace mcrouter {
 class TimeProviderFunc {
  public:
   time_t operator() () const {
+    /* Migration boundaries are second-granular, so the proxy's cached
+       coarse clock is plenty accurate and avoids a per-request time call */
+    if (const auto& ctx = fiber_local::getSharedCtx()) {
+      return ctx->proxy().coarseNowWallSec();
+    }
     return nowWallSec();
   }
 };
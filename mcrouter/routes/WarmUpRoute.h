@@ -24,6 +24,9 @@
 #include "mcrouter/lib/OperationTraits.h"
 #include "mcrouter/lib/Reply.h"
 #include "mcrouter/lib/RouteHandleTraverser.h"
+#include "mcrouter/McrouterFiberContext.h"
+#include "mcrouter/Proxy.h"
+#include "mcrouter/ProxyRequestContext.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
@@ -199,7 +202,8 @@ class WarmUpRoute {
     if (isHitResult(warmMeta.result())) {
       exptime = warmMeta.exptime();
       if (exptime != 0) {
-        auto curTime = time(nullptr);
+        auto curTime =
+            fiber_local::getSharedCtx()->proxy().coarseNowWallSec();
         if (curTime >= exptime) {
           return false;
         }
@@ -45,6 +45,15 @@ makeFailoverRouteLeastFailures(std::vector<McrouterRouteHandlePtr> rh,
                                std::string name,
                                const folly::dynamic& json);
 
+McrouterRouteHandlePtr
+makeFailoverRouteLeastLatency(std::vector<McrouterRouteHandlePtr> rh,
+                              FailoverErrorsSettings failoverErrors,
+                              std::unique_ptr<FailoverRateLimiter> rateLimiter,
+                              bool failoverTagging,
+                              bool enableLeasePairing,
+                              std::string name,
+                              const folly::dynamic& json);
+
 }}}  // facebook::memcache::mcrouter
 
 TEST(failoverRouteTest, success) {
@@ -520,3 +529,69 @@ TEST(failoverRouteTest, leastFailuresComplex) {
   auto reply7 = rh->route(McGetRequest("0"));
   EXPECT_EQ("c", carbon::valueRangeSlow(reply7).str());
 }
+
+TEST(failoverRouteTest, leastLatencyNoFailover) {
+  std::vector<std::shared_ptr<TestHandle>> test_handles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "b")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "c"))
+  };
+
+  mockFiberContext();
+  folly::dynamic json = folly::dynamic::object ("type", "LeastLatencyPolicy");
+  auto rh = makeFailoverRouteLeastLatency(get_route_handles(test_handles),
+                                          FailoverErrorsSettings(),
+                                          nullptr,
+                                          /* failoverTagging */ false,
+                                          /* enableLeasePairing */ false,
+                                          "route01",
+                                          json);
+
+  auto reply = rh->route(McGetRequest("0"));
+  EXPECT_EQ("a", carbon::valueRangeSlow(reply).str());
+}
+
+TEST(failoverRouteTest, leastLatencyFailoverOnce) {
+  std::vector<std::shared_ptr<TestHandle>> test_handles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_timeout, "a")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "b")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "c"))
+  };
+
+  mockFiberContext();
+  folly::dynamic json = folly::dynamic::object ("type", "LeastLatencyPolicy");
+  auto rh = makeFailoverRouteLeastLatency(get_route_handles(test_handles),
+                                          FailoverErrorsSettings(),
+                                          nullptr,
+                                          /* failoverTagging */ false,
+                                          /* enableLeasePairing */ false,
+                                          "route01",
+                                          json);
+
+  // Unsampled children keep their config order on the first pass
+  auto reply = rh->route(McGetRequest("0"));
+  EXPECT_EQ("b", carbon::valueRangeSlow(reply).str());
+}
+
+TEST(failoverRouteTest, leastLatencyMaxTries) {
+  std::vector<std::shared_ptr<TestHandle>> test_handles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_timeout, "a")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_timeout, "b")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "c"))
+  };
+
+  mockFiberContext();
+  folly::dynamic json = folly::dynamic::object ("type", "LeastLatencyPolicy")
+                                               ("max_tries", 2);
+  auto rh = makeFailoverRouteLeastLatency(get_route_handles(test_handles),
+                                          FailoverErrorsSettings(),
+                                          nullptr,
+                                          /* failoverTagging */ false,
+                                          /* enableLeasePairing */ false,
+                                          "route01",
+                                          json);
+
+  // max_tries = 2 stops after child b even though c would succeed
+  auto reply = rh->route(McGetRequest("0"));
+  EXPECT_EQ("b", carbon::valueRangeSlow(reply).str());
+}
@@ -0,0 +1,217 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <memory>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/dynamic.h>
+#include <folly/Format.h>
+
+#include "mcrouter/lib/network/gen/Memcache.h"
+#include "mcrouter/routes/DefaultShadowPolicy.h"
+#include "mcrouter/routes/ShadowRoute.h"
+#include "mcrouter/routes/ShadowRouteIf.h"
+#include "mcrouter/routes/ShardSplitRoute.h"
+#include "mcrouter/routes/ShardSplitter.h"
+#include "mcrouter/routes/test/RouteHandleTestUtil.h"
+
+using namespace facebook::memcache;
+using namespace facebook::memcache::mcrouter;
+
+using std::make_shared;
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+McrouterRouteHandlePtr makeHashRoute(
+  const folly::dynamic& json,
+  std::vector<McrouterRouteHandlePtr> rh,
+  size_t threadId);
+
+McrouterRouteHandlePtr makeFailoverRoute(
+  const folly::dynamic& json,
+  std::vector<McrouterRouteHandlePtr> children);
+
+McrouterRouteHandlePtr makeShardSplitRoute(McrouterRouteHandlePtr rh,
+                                           ShardSplitter shardSplitter);
+
+}}}  // facebook::memcache::mcrouter
+
+namespace {
+
+/**
+ * ns/request benchmarks over representative route handle trees with
+ * TestHandle leaves, so that what's measured is route-layer overhead
+ * (hashing, request copies, fiber locals), not network or destination
+ * work.
+ *
+ * Run with: make mcrouter_routes_benchmark && ./mcrouter_routes_benchmark
+ */
+
+constexpr size_t kNumKeys = 1000;
+
+std::vector<std::shared_ptr<TestHandle>> makeLeaves(size_t n) {
+  std::vector<std::shared_ptr<TestHandle>> leaves;
+  leaves.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    leaves.push_back(make_shared<TestHandle>(
+        GetRouteTestData(mc_res_found, "value"),
+        UpdateRouteTestData(mc_res_stored),
+        DeleteRouteTestData(mc_res_deleted)));
+  }
+  return leaves;
+}
+
+McrouterRouteHandlePtr makeHashTree(
+    std::vector<std::shared_ptr<TestHandle>>& leaves) {
+  leaves = makeLeaves(100);
+  return makeHashRoute(
+      folly::dynamic::object(), get_route_handles(leaves), /* threadId */ 0);
+}
+
+std::vector<std::string> makeKeys(folly::StringPiece prefix) {
+  std::vector<std::string> keys;
+  keys.reserve(kNumKeys);
+  for (size_t i = 0; i < kNumKeys; ++i) {
+    keys.push_back(folly::sformat("{}:{}", prefix, i));
+  }
+  return keys;
+}
+
+} // anonymous namespace
+
+BENCHMARK(hashRouteGet, iters) {
+  folly::BenchmarkSuspender susp;
+  std::vector<std::shared_ptr<TestHandle>> leaves;
+  auto rh = makeHashTree(leaves);
+  auto keys = makeKeys("hash_get");
+  mockFiberContext();
+  susp.dismiss();
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(
+        rh->route(McGetRequest(keys[i % kNumKeys])).result());
+  }
+}
+
+BENCHMARK(hashRouteSet, iters) {
+  folly::BenchmarkSuspender susp;
+  std::vector<std::shared_ptr<TestHandle>> leaves;
+  auto rh = makeHashTree(leaves);
+  auto keys = makeKeys("hash_set");
+  mockFiberContext();
+  susp.dismiss();
+  for (size_t i = 0; i < iters; ++i) {
+    McSetRequest req(keys[i % kNumKeys]);
+    req.value() = folly::IOBuf(folly::IOBuf::COPY_BUFFER, "value");
+    folly::doNotOptimizeAway(rh->route(req).result());
+  }
+}
+
+BENCHMARK(hashRouteDelete, iters) {
+  folly::BenchmarkSuspender susp;
+  std::vector<std::shared_ptr<TestHandle>> leaves;
+  auto rh = makeHashTree(leaves);
+  auto keys = makeKeys("hash_del");
+  mockFiberContext();
+  susp.dismiss();
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(
+        rh->route(McDeleteRequest(keys[i % kNumKeys])).result());
+  }
+}
+
+// Three destinations deep; the first one answers, so this is the common
+// (no failover) path.
+BENCHMARK(failoverRouteGetFirstHit, iters) {
+  folly::BenchmarkSuspender susp;
+  auto leaves = makeLeaves(3);
+  auto rh = makeFailoverRoute(
+      folly::dynamic::object(), get_route_handles(leaves));
+  auto keys = makeKeys("failover_hit");
+  mockFiberContext();
+  susp.dismiss();
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(
+        rh->route(McGetRequest(keys[i % kNumKeys])).result());
+  }
+}
+
+// First two destinations time out, so every request walks the full
+// failover chain (including the per-hop request copy).
+BENCHMARK(failoverRouteGetFailover, iters) {
+  folly::BenchmarkSuspender susp;
+  std::vector<std::shared_ptr<TestHandle>> leaves{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_timeout, "")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_timeout, "")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "value")),
+  };
+  auto rh = makeFailoverRoute(
+      folly::dynamic::object(), get_route_handles(leaves));
+  auto keys = makeKeys("failover_miss");
+  mockFiberContext();
+  susp.dismiss();
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(
+        rh->route(McGetRequest(keys[i % kNumKeys])).result());
+  }
+}
+
+// Normal destination plus two shadows covering the whole key range;
+// shadow sends run as additional fiber tasks.
+BENCHMARK(shadowRouteGet, iters) {
+  folly::BenchmarkSuspender susp;
+  auto normalLeaves = makeLeaves(1);
+  auto normalRh = get_route_handles(normalLeaves)[0];
+  auto shadowLeaves = makeLeaves(2);
+  auto shadowRhs = get_route_handles(shadowLeaves);
+
+  auto settings = ShadowSettings::create(
+      folly::dynamic::object("index_range", folly::dynamic::array(0, 1)),
+      *getTestRouter());
+  settings->setKeyRange(0, 1);
+  McrouterShadowData shadowData{
+    {std::move(shadowRhs[0]), settings},
+    {std::move(shadowRhs[1]), settings},
+  };
+  McrouterRouteHandle<ShadowRoute<DefaultShadowPolicy>> rh(
+      std::move(normalRh), std::move(shadowData), DefaultShadowPolicy());
+  auto keys = makeKeys("shadow_get");
+
+  TestFiberManager fm{fiber_local::ContextTypeTag()};
+  susp.dismiss();
+  fm.run([&]() {
+    mockFiberContext();
+    for (size_t i = 0; i < iters; ++i) {
+      folly::doNotOptimizeAway(
+          rh.route(McGetRequest(keys[i % kNumKeys])).result());
+    }
+  });
+}
+
+// Shard-split over a hash tree; every key hits a shard with 10 splits,
+// so each get is rewritten to its split before being hashed.
+BENCHMARK(shardSplitRouteGet, iters) {
+  folly::BenchmarkSuspender susp;
+  std::vector<std::shared_ptr<TestHandle>> leaves;
+  auto rh = makeShardSplitRoute(
+      makeHashTree(leaves), ShardSplitter(folly::dynamic::object("1234", 10)));
+  auto keys = makeKeys("a:1234");
+  mockFiberContext();
+  susp.dismiss();
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(
+        rh->route(McGetRequest(keys[i % kNumKeys])).result());
+  }
+}
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -11,8 +11,16 @@
 
 #include <signal.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <thread>
 
+#include <folly/IPAddress.h>
+#include <folly/Memory.h>
+#include <folly/String.h>
+
+#include "mcrouter/ListenSocketHandoff.h"
 #include "mcrouter/McrouterClient.h"
 #include "mcrouter/McrouterInstance.h"
 #include "mcrouter/McrouterLogFailure.h"
@@ -20,6 +28,7 @@
 #include "mcrouter/Proxy.h"
 #include "mcrouter/ProxyThread.h"
 #include "mcrouter/ServerOnRequest.h"
+#include "mcrouter/ThreadUtil.h"
 #include "mcrouter/config.h"
 #include "mcrouter/lib/network/AsyncMcServer.h"
 #include "mcrouter/lib/network/AsyncMcServerWorker.h"
@@ -37,6 +46,13 @@ void serverLoop(
   AsyncMcServerWorker& worker,
   const McrouterStandaloneOptions& standaloneOpts) {
 
+  if (router.opts().numa_aware) {
+    /* In standalone mode proxies share the server worker threads, so
+       pinning here places both the accept path and the routing path
+       (and their first-touch allocations) on the same node. */
+    mcrouterBindThisThreadToNumaNode(threadId);
+  }
+
   auto routerClient = router.createSameThreadClient(
       0 /* maximum_outstanding_requests */);
 
@@ -54,6 +70,20 @@ void serverLoop(
       [proxy](facebook::memcache::McServerSession&) {
         stat_decr(proxy->stats, num_clients_stat, 1);
       });
+  if (standaloneOpts.max_egress_buffered_bytes > 0) {
+    worker.setOnWriteQuiescence(
+        [proxy, &worker](facebook::memcache::McServerSession&) {
+          const auto account = worker.egressAccount();
+          stat_set_uint64(
+              proxy->stats,
+              max_egress_buffered_bytes_stat,
+              account->maxBufferedBytes);
+          stat_set_uint64(
+              proxy->stats,
+              max_session_egress_buffered_bytes_stat,
+              account->maxSessionBufferedBytes);
+        });
+  }
 
   // Setup compression on each worker.
   if (standaloneOpts.enable_server_compression) {
@@ -69,10 +99,38 @@ void serverLoop(
   /* TODO(libevent): the only reason this is not simply evb.loop() is
      because we need to call asox stuff on every loop iteration.
      We can clean this up once we convert everything to EventBase */
-  while (worker.isAlive() ||
-         worker.writesPending() ||
-         proxy->fiberManager.hasTasks()) {
-    evb.loopOnce();
+  if (router.opts().proxy_busy_loop) {
+    /* Same spin-then-backoff discipline as ProxyThread::busyLoopRun();
+       in standalone mode the proxy shares this worker thread, so
+       spinning here covers both the server and the routing path. */
+    constexpr int64_t kIdleSpinUs = 200;
+    constexpr int64_t kMinSleepUs = 1;
+    constexpr int64_t kMaxSleepUs = 1000;
+
+    int64_t sleepUs = kMinSleepUs;
+    int64_t lastWorkUs = nowUs();
+
+    while (worker.isAlive() ||
+           worker.writesPending() ||
+           proxy->fiberManager.hasTasks()) {
+      evb.loopOnce(EVLOOP_NONBLOCK);
+
+      if (proxy->fiberManager.hasTasks()) {
+        lastWorkUs = nowUs();
+        sleepUs = kMinSleepUs;
+        continue;
+      }
+      if (nowUs() - lastWorkUs > kIdleSpinUs) {
+        std::this_thread::sleep_for(std::chrono::microseconds(sleepUs));
+        sleepUs = std::min(sleepUs * 2, kMaxSleepUs);
+      }
+    }
+  } else {
+    while (worker.isAlive() ||
+           worker.writesPending() ||
+           proxy->fiberManager.hasTasks()) {
+      evb.loopOnce();
+    }
   }
 
   // destroy proxy on proxy thread
@@ -85,26 +143,78 @@ bool runServer(const McrouterStandaloneOptions& standaloneOpts,
                const McrouterOptions& mcrouterOpts) {
   AsyncMcServer::Options opts;
 
-  if (standaloneOpts.listen_sock_fd >= 0) {
+  /*
+   * If a running instance serves the handoff path, adopt its listen
+   * sockets so the restart is invisible to connecting clients; we ack
+   * once our workers are up, and only then does it start draining.
+   */
+  std::vector<int> handoffPlainFds;
+  std::vector<int> handoffSslFds;
+  int handoffAckFd = -1;
+  bool adoptedListenSockets = false;
+  if (!standaloneOpts.handoff_sock_path.empty() &&
+      !standaloneOpts.listen_reuseport) {
+    adoptedListenSockets = receiveListenSockets(
+      standaloneOpts.handoff_sock_path,
+      handoffPlainFds, handoffSslFds, handoffAckFd);
+  }
+
+  if (adoptedListenSockets) {
+    LOG(INFO) << "Adopted "
+              << handoffPlainFds.size() + handoffSslFds.size()
+              << " listen socket(s) from a running instance";
+    opts.existingSocketFds = std::move(handoffPlainFds);
+    opts.existingSslSocketFds = std::move(handoffSslFds);
+    if (!opts.existingSslSocketFds.empty()) {
+      opts.pemCertPath = mcrouterOpts.pem_cert_path;
+      opts.pemKeyPath = mcrouterOpts.pem_key_path;
+      opts.pemCaPath = mcrouterOpts.pem_ca_path;
+      opts.numSslHandshakeThreads = standaloneOpts.ssl_handshake_threads;
+    }
+    opts.udpPorts = standaloneOpts.udp_ports;
+  } else if (standaloneOpts.listen_sock_fd >= 0) {
     opts.existingSocketFd = standaloneOpts.listen_sock_fd;
   } else if (!standaloneOpts.unix_domain_sock.empty()) {
     opts.unixDomainSockPath = standaloneOpts.unix_domain_sock;
   } else {
     opts.ports = standaloneOpts.ports;
     opts.sslPorts = standaloneOpts.ssl_ports;
+    opts.udpPorts = standaloneOpts.udp_ports;
     opts.pemCertPath = mcrouterOpts.pem_cert_path;
     opts.pemKeyPath = mcrouterOpts.pem_key_path;
     opts.pemCaPath = mcrouterOpts.pem_ca_path;
+    opts.numSslHandshakeThreads = standaloneOpts.ssl_handshake_threads;
   }
 
   opts.numThreads = mcrouterOpts.num_proxies;
 
   opts.setPerThreadMaxConns(standaloneOpts.max_conns, opts.numThreads);
   opts.tcpListenBacklog = standaloneOpts.tcp_listen_backlog;
+  opts.reusePort = standaloneOpts.listen_reuseport;
   opts.worker.defaultVersionHandler = false;
   opts.worker.maxInFlight = standaloneOpts.max_client_outstanding_reqs;
+  opts.worker.lowPriorityMaxInFlight =
+    standaloneOpts.max_low_priority_outstanding_reqs;
+  if (!standaloneOpts.low_priority_cidrs.empty()) {
+    std::vector<folly::StringPiece> cidrs;
+    folly::split(',', standaloneOpts.low_priority_cidrs, cidrs,
+                 /* ignoreEmpty= */ true);
+    for (const auto cidr : cidrs) {
+      try {
+        opts.worker.lowPriorityNetworks.push_back(
+          folly::IPAddress::createNetwork(cidr));
+      } catch (const std::exception& e) {
+        LOG(ERROR) << "Invalid --low-priority-cidrs entry '" << cidr
+                   << "': " << e.what();
+        return false;
+      }
+    }
+  }
+  opts.worker.maxEgressBytes = standaloneOpts.max_egress_buffered_bytes;
   opts.worker.sendTimeout = std::chrono::milliseconds{
     standaloneOpts.client_timeout_ms};
+  opts.worker.useJemallocNodumpAllocator = mcrouterOpts.jemalloc_nodump_buffers;
+  opts.worker.busyPollUs = mcrouterOpts.socket_busy_poll_us;
   if (!mcrouterOpts.debug_fifo_root.empty()) {
     opts.worker.debugFifoPath = getServerDebugFifoFullPath(mcrouterOpts);
   }
@@ -140,6 +250,8 @@ bool runServer(const McrouterStandaloneOptions& standaloneOpts,
       initCompression(*router);
     }
 
+    std::unique_ptr<ListenSocketHandoffServer> handoffServer;
+
     server.spawn(
       [router, &standaloneOpts] (size_t threadId,
                                  folly::EventBase& evb,
@@ -151,6 +263,33 @@ bool runServer(const McrouterStandaloneOptions& standaloneOpts,
       }
     );
 
+    /*
+     * Offer our listen sockets to a successor, then tell any predecessor
+     * we took over from that it can drain; the path is live again before
+     * the ack, so back-to-back restarts chain cleanly.
+     */
+    if (!standaloneOpts.handoff_sock_path.empty() &&
+        !standaloneOpts.listen_reuseport) {
+      try {
+        auto listenFds = server.listenSocketFds();
+        if (!listenFds.first.empty() || !listenFds.second.empty()) {
+          handoffServer = folly::make_unique<ListenSocketHandoffServer>(
+            standaloneOpts.handoff_sock_path,
+            std::move(listenFds.first),
+            std::move(listenFds.second),
+            [&server] () {
+              LOG(INFO) << "Draining after listen socket handoff";
+              server.shutdown();
+            });
+        }
+      } catch (const std::exception& e) {
+        LOG(ERROR) << "Listen socket handoff disabled: " << e.what();
+      }
+    }
+    if (handoffAckFd != -1) {
+      sendReadyAck(handoffAckFd);
+    }
+
     server.join();
 
     LOG(INFO) << "Shutting down";
@@ -36,6 +36,19 @@ mcrouter_option_other(
   "ssl-port", no_short,
   "SSL Port(s) to listen on (comma separated)")
 
+mcrouter_option_integer(
+  size_t, ssl_handshake_threads, 0,
+  "ssl-handshake-threads", no_short,
+  "If nonzero, run TLS handshakes of accepted connections on a dedicated "
+  "pool of this many threads instead of inline on the request-serving "
+  "threads, so reconnect storms don't stall established connections.")
+
+mcrouter_option_other(
+  std::vector<uint16_t>, udp_ports, ,
+  "udp-port", no_short,
+  "UDP Port(s) to serve the memcached UDP protocol on (comma separated). "
+  "Intended for small single-key get/metaget traffic.")
+
 mcrouter_option_integer(
   int, listen_sock_fd, -1,
   "listen-sock-fd", no_short,
@@ -46,6 +59,15 @@ mcrouter_option_string(
   "unix-domain-sock", no_short,
   "Unix domain socket path")
 
+mcrouter_option_string(
+  handoff_sock_path, "",
+  "handoff-sock-path", no_short,
+  "Unix domain socket path used to hand listen sockets off to a new "
+  "mcrouter instance on restart. On startup, adopt the listen sockets of "
+  "a running instance serving this path (if any); once serving, offer our "
+  "own listen sockets on it and drain after a successor takes them. "
+  "Incompatible with --listen-reuseport.")
+
 mcrouter_option_integer(
   size_t, max_conns, 0,
   "max-conns", no_short,
@@ -58,11 +80,42 @@ mcrouter_option_integer(
   "tcp-listen-backlog", no_short,
   "TCP listen backlog size")
 
+mcrouter_option_toggle(
+  listen_reuseport, false,
+  "listen-reuseport", no_short,
+  "Open a separate SO_REUSEPORT listening socket per server thread so the "
+  "kernel spreads accepted connections across threads. Requires --port "
+  "and/or --ssl-port.")
+
 mcrouter_option_integer(
   uint32_t, max_client_outstanding_reqs, DEFAULT_MAX_CLIENT_OUTSTANDING_REQS,
   "max-client-outstanding-reqs", no_short,
   "Maximum requests outstanding per client (0 to disable)")
 
+mcrouter_option_string(
+  low_priority_cidrs, "",
+  "low-priority-cidrs", no_short,
+  "Comma-separated source networks in CIDR notation whose clients are"
+  " classified as low-priority batch traffic (e.g. backfill jobs)."
+  " See --max-low-priority-outstanding-reqs.")
+
+mcrouter_option_integer(
+  uint32_t, max_low_priority_outstanding_reqs, 0,
+  "max-low-priority-outstanding-reqs", no_short,
+  "Maximum requests outstanding per low-priority client (see"
+  " --low-priority-cidrs), replacing --max-client-outstanding-reqs for"
+  " those clients. A smaller value here keeps batch clients from"
+  " starving interactive traffic. 0 means no separate limit.")
+
+mcrouter_option_integer(
+  size_t, max_egress_buffered_bytes, 0,
+  "max-egress-buffered-bytes", no_short,
+  "Bound on reply bytes buffered for write across all connections of a"
+  " server thread. Each connection gets an equal share of the bound and"
+  " is not read while its buffered replies exceed that share, so a slow"
+  " client reading a multiget flood can't pin unbounded memory."
+  " 0 to disable.")
+
 mcrouter_option_integer(
   size_t, requests_per_read, 0,
   "reqs-per-read", no_short,
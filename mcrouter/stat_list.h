@@ -24,6 +24,13 @@
   STUI(num_servers_closed, 0, 1)
   STUI(num_clients, 0, 1)
   STUI(num_suspect_servers, 0, 1)
+  /* Requests redirected to a less loaded proxy (--proxy-steal-threshold) */
+  STUI(proxy_requests_stolen, 0, 1)
+  /* High-water marks of reply bytes buffered for write on this proxy's
+     server worker, total and for any single connection
+     (see --max-egress-buffered-bytes) */
+  STUI(max_egress_buffered_bytes, 0, 1)
+  STUI(max_session_egress_buffered_bytes, 0, 1)
 #undef GROUP
 #define GROUP mcproxy_stats | rate_stats
   STUI(destination_batches_sum, 0, 1)
@@ -37,6 +44,28 @@
   /* Number of requests/second that couldn't be processed immediately in OLR */
   STUI(outstanding_route_get_reqs_queued, 0, 1)
   STUI(outstanding_route_update_reqs_queued, 0, 1)
+  /* Adaptive OLR limit adjustments per second */
+  STUI(outstanding_route_limit_increases, 0, 1)
+  STUI(outstanding_route_limit_decreases, 0, 1)
+  /* Requests/second answered immediately in brownout mode */
+  STUI(brownout_shed_requests, 0, 1)
+  /* Lease-gets answered from another in-flight lease-get's reply
+   * (--lease-get-collapse-wait-ms) */
+  STUI(lease_get_collapsed, 0, 1)
+  /* Lease-gets that waited the full collapse window and were routed */
+  STUI(lease_get_collapse_timeouts, 0, 1)
+  /* Gets served from an in-process MicrocacheRoute LRU */
+  STUI(microcache_hits, 0, 1)
+  /* Hot-key replies copied into a MicrocacheRoute LRU */
+  STUI(microcache_stores, 0, 1)
+  /* Microcache entries dropped by an observed write to their key */
+  STUI(microcache_invalidates, 0, 1)
+  /* Gets answered with a locally remembered miss (NegativeCacheRoute) */
+  STUI(negative_cache_hits, 0, 1)
+  /* Definite misses recorded by NegativeCacheRoute */
+  STUI(negative_cache_stores, 0, 1)
+  /* Shadow requests/second dropped because the shadow queue was full */
+  STUI(shadow_queue_drops, 0, 1)
 #undef GROUP
 #define GROUP ods_stats | mcproxy_stats
   /* Average number of requests waiting in OLR at any given time */
@@ -47,6 +76,8 @@
   STAT(outstanding_route_update_avg_wait_time_sec, stat_double, 0, .dbl = 0.0)
   /* Connections closed due to retransmits */
   STUI(retrans_closed_connections, 0, 1)
+  /* Background DNS refreshes that saw a destination's address change */
+  STUI(dns_resolution_changes, 0, 1)
 #undef GROUP
 #define GROUP rate_stats
   /* OutstandingLimitRoute queue-related helper stats */
@@ -65,11 +96,25 @@
   STUI(destination_inflight_reqs, 0, 1)
   STAT(destination_batch_size, stat_double, 0, .dbl = 0.0)
   STUI(asynclog_requests, 0, 1)
+  /* Deletes not spooled because an identical entry was spooled within
+   * the dedupe window (--asynclog-dedupe-window-ms) */
+  STUI(asynclog_duplicate_deletes, 0, 1)
+  /* Smoothed time an asynclog entry waits before it is on disk,
+   * averaged over proxies. */
+  STAT(asynclog_spool_lag_us, stat_double, 0, .dbl = 0.0)
+  /* Asynclog entries queued for the next group commit */
+  STUI(asynclog_pending_entries, 0, 0)
   /* Proxy requests we started routing */
   STUI(proxy_reqs_processing, 0, 1)
   /* Proxy requests queued up and not routed yet */
   STUI(proxy_reqs_waiting, 0, 1)
   STAT(client_queue_notify_period, stat_double, 0, .dbl = 0.0)
+  /* Notification-to-drain delay of the client queue, averaged over
+   * proxies; 0 unless client_queue_target_latency_us is set. */
+  STAT(client_queue_wakeup_latency_us, stat_double, 0, .dbl = 0.0)
+  /* Compression level in effect, averaged over proxies; 0 if
+   * adaptive compression is disabled. */
+  STAT(adaptive_compression_level, stat_double, 0, .dbl = 0.0)
 //  STUI(bytes_read, 0)
 //  STUI(bytes_written, 0)
 //  STUI(get_hits, 0)
@@ -85,6 +130,8 @@
   STUI(fibers_allocated, 0, 0)
   STUI(fibers_pool_size, 0, 0)
   STUI(fibers_stack_high_watermark, 0, 0)
+  STUI(proxy_request_pool_hits, 0, 0)
+  STUI(proxy_request_pool_misses, 0, 0)
 //  STUI(failed_client_connections, 0)
   STUI(successful_client_connections, 0, 1)
   STUI(cycles_avg, 0, 1)
@@ -96,6 +143,10 @@
   STUI(cycles_p95, 0, 1)
   STUI(cycles_p99, 0, 1)
   STUI(cycles_num, 0, 1)
+  // Stage durations of the last synthetic canary, in raw cycles like
+  // the cycles_* stats above (see --canary-interval-ms)
+  STUI(canary_dispatch_cycles, 0, 1)
+  STUI(canary_route_cycles, 0, 1)
   STAT(duration_us, stat_double, 0, .dbl = 0.0)
 #undef GROUP
 #define GROUP ods_stats | mcproxy_stats | max_stats
@@ -21,6 +21,7 @@
 #include <folly/json.h>
 #include <folly/Range.h>
 
+#include "mcrouter/LatencyHistogram.h"
 #include "mcrouter/McrouterInstanceBase.h"
 #include "mcrouter/Proxy.h"
 #include "mcrouter/ProxyDestination.h"
@@ -70,6 +71,7 @@ struct ServerStat {
   bool isSoftTko{false};
   double sumLatencies{0.0};
   size_t cntLatencies{0};
+  LatencyHistogram latencyHistogram;
   size_t pendingRequestsCount{0};
   size_t inflightRequestsCount{0};
   double sumRetransPerKByte{0.0};
@@ -80,6 +82,15 @@ struct ServerStat {
   std::string toString() const {
     double avgLatency = cntLatencies == 0 ? 0 : sumLatencies / cntLatencies;
     auto res = folly::format("avg_latency_us:{:.3f}", avgLatency).str();
+    if (latencyHistogram.count() > 0) {
+      folly::format(
+          " p50_latency_us:{:.0f} p99_latency_us:{:.0f}"
+          " p999_latency_us:{:.0f}",
+          latencyHistogram.getPercentile(50),
+          latencyHistogram.getPercentile(99),
+          latencyHistogram.getPercentile(99.9))
+          .appendTo(res);
+    }
     folly::format(" pending_reqs:{}", pendingRequestsCount).appendTo(res);
     folly::format(" inflight_reqs:{}", inflightRequestsCount).appendTo(res);
     if (isHardTko) {
@@ -374,6 +385,9 @@ void prepare_stats(McrouterInstanceBase& router, stat_t* stats) {
   stat_set_uint64(stats, num_suspect_servers_stat,
                   router.tkoTrackerMap().getSuspectServersCount());
 
+  stat_set_uint64(stats, proxy_requests_stolen_stat,
+                  router.stolenRequests());
+
   double avgBatchSize = 0.0;
   if (destinationBatchesSum != 0) {
     avgBatchSize = destinationRequestsSum / (double)destinationBatchesSum;
@@ -441,6 +455,8 @@ void prepare_stats(McrouterInstanceBase& router, stat_t* stats) {
   stats[fibers_allocated_stat].data.uint64 = 0;
   stats[fibers_pool_size_stat].data.uint64 = 0;
   stats[fibers_stack_high_watermark_stat].data.uint64 = 0;
+  stats[proxy_request_pool_hits_stat].data.uint64 = 0;
+  stats[proxy_request_pool_misses_stat].data.uint64 = 0;
   for (size_t i = 0; i < router.opts().num_proxies; ++i) {
     auto pr = router.getProxy(i);
     stats[fibers_allocated_stat].data.uint64 +=
@@ -450,13 +466,35 @@ void prepare_stats(McrouterInstanceBase& router, stat_t* stats) {
     stats[fibers_stack_high_watermark_stat].data.uint64 =
       std::max(stats[fibers_stack_high_watermark_stat].data.uint64,
                pr->fiberManager.stackHighWatermark());
+    stats[proxy_request_pool_hits_stat].data.uint64 +=
+      pr->requestContextPool.hits();
+    stats[proxy_request_pool_misses_stat].data.uint64 +=
+      pr->requestContextPool.misses();
     stats[duration_us_stat].data.dbl += pr->durationUs.value();
     stats[client_queue_notify_period_stat].data.dbl += pr->queueNotifyPeriod();
+    stats[client_queue_wakeup_latency_us_stat].data.dbl +=
+      pr->queueWakeupLatencyUs();
+    stats[adaptive_compression_level_stat].data.dbl +=
+      pr->adaptiveCompressionLevel();
+    double spoolLagUs = 0.0;
+    for (auto& shard : pr->asynclogShards) {
+      spoolLagUs += shard.spoolLagUs.value();
+      std::lock_guard<std::mutex> lock(shard.batchLock);
+      stats[asynclog_pending_entries_stat].data.uint64 += shard.batch.size();
+    }
+    stats[asynclog_spool_lag_us_stat].data.dbl +=
+      spoolLagUs / pr->asynclogShards.size();
   }
   if (router.opts().num_proxies > 0) {
     stats[duration_us_stat].data.dbl /= router.opts().num_proxies;
     stats[client_queue_notify_period_stat].data.dbl /=
       router.opts().num_proxies;
+    stats[client_queue_wakeup_latency_us_stat].data.dbl /=
+      router.opts().num_proxies;
+    stats[adaptive_compression_level_stat].data.dbl /=
+      router.opts().num_proxies;
+    stats[asynclog_spool_lag_us_stat].data.dbl /=
+      router.opts().num_proxies;
   }
 
   for (int i = 0; i < num_stats; i++) {
@@ -477,13 +515,15 @@ void prepare_stats(McrouterInstanceBase& router, stat_t* stats) {
   }
 }
 
-// Thread-safe increment of the given counter
+// Thread-safe increment of the given counter. These are plain counters
+// with no ordering requirements, so a relaxed add is enough; no need for
+// the full barrier __sync_fetch_and_add implies.
 void stat_incr_safe(stat_t* stats, stat_name_t stat_name) {
-  __sync_fetch_and_add(&stats[stat_name].data.uint64, 1);
+  __atomic_fetch_add(&stats[stat_name].data.uint64, 1, __ATOMIC_RELAXED);
 }
 
 void stat_decr_safe(stat_t* stats, stat_name_t stat_name) {
-  __sync_fetch_and_add(&stats[stat_name].data.uint64, -1);
+  __atomic_fetch_add(&stats[stat_name].data.uint64, -1, __ATOMIC_RELAXED);
 }
 
 void stat_set_uint64(stat_t* stats,
@@ -529,10 +569,33 @@ static stat_group_t stat_parse_group_str(folly::StringPiece str) {
   }
 }
 
+StatsSnapshot::Data stats_snapshot_entries(const std::vector<stat_t>& stats) {
+  StatsSnapshot::Data entries;
+  for (const auto& stat : stats) {
+    if (stat.group & ods_stats) {
+      entries.emplace_back(stat.name, stat_to_str(&stat, nullptr));
+    }
+  }
+  return entries;
+}
+
 /**
  * @param Proxy proxy
  */
 McStatsReply stats_reply(Proxy* proxy, folly::StringPiece group_str) {
+  if (group_str == "snapshot") {
+    // Served from the last snapshot published by the stats logger
+    // thread, without taking the stats lock, so it's safe to scrape at
+    // high frequency. Empty until the logger has run once.
+    StatsReply reply;
+    if (auto snapshot = proxy->router().statsSnapshot().read()) {
+      for (const auto& entry : *snapshot) {
+        reply.addStat(entry.first, entry.second);
+      }
+    }
+    return reply.getReply();
+  }
+
   std::lock_guard<std::mutex> guard(proxy->stats_lock);
 
   StatsReply reply;
@@ -570,10 +633,12 @@ McStatsReply stats_reply(Proxy* proxy, folly::StringPiece group_str) {
 
   if (groups & server_stats) {
     folly::StringKeyedUnorderedMap<ServerStat> serverStats;
+    folly::StringKeyedUnorderedMap<LatencyHistogram> poolLatencies;
     auto& router = proxy->router();
     for (size_t i = 0; i < router.opts().num_proxies; ++i) {
       router.getProxy(i)->destinationMap->foreachDestinationSynced(
-        [&serverStats](folly::StringPiece key, const ProxyDestination& pdstn) {
+        [&serverStats, &poolLatencies](
+            folly::StringPiece key, const ProxyDestination& pdstn) {
           auto& stat = serverStats[key];
           stat.isHardTko = pdstn.tracker->isHardTko();
           stat.isSoftTko = pdstn.tracker->isSoftTko();
@@ -589,6 +654,12 @@ McStatsReply stats_reply(Proxy* proxy, folly::StringPiece group_str) {
             ++stat.cntLatencies;
           }
 
+          stat.latencyHistogram.merge(pdstn.stats().latencyHistogramUs);
+          if (!pdstn.poolName().empty()) {
+            poolLatencies[pdstn.poolName()].merge(
+                pdstn.stats().latencyHistogramUs);
+          }
+
           if (pdstn.stats().retransPerKByte >= 0.0) {
             const auto val = pdstn.stats().retransPerKByte;
             stat.sumRetransPerKByte += val;
@@ -604,6 +675,19 @@ McStatsReply stats_reply(Proxy* proxy, folly::StringPiece group_str) {
     for (const auto& it : serverStats) {
       reply.addStat(it.first, it.second.toString());
     }
+    for (const auto& it : poolLatencies) {
+      if (it.second.count() == 0) {
+        continue;
+      }
+      reply.addStat(
+          folly::to<std::string>("pool_latency_us.", it.first),
+          folly::format(
+              "p50:{:.0f} p99:{:.0f} p999:{:.0f}",
+              it.second.getPercentile(50),
+              it.second.getPercentile(99),
+              it.second.getPercentile(99.9))
+              .str());
+    }
   }
 
   if (groups & suspect_server_stats) {
@@ -11,10 +11,12 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <folly/Range.h>
 
 #include "mcrouter/lib/network/gen/Memcache.h"
+#include "mcrouter/StatsSnapshot.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
@@ -124,6 +126,13 @@ uint64_t stat_get_config_age(const stat_t* stats, uint64_t now);
 McStatsReply stats_reply(Proxy*, folly::StringPiece);
 void prepare_stats(McrouterInstanceBase& router, stat_t* stats);
 
+/**
+ * Renders the "ods" group of an already-prepared and aggregated stats
+ * array into name/value pairs, formatted the same way stats_reply
+ * reports them. Used to build the snapshot served by "stats snapshot".
+ */
+StatsSnapshot::Data stats_snapshot_entries(const std::vector<stat_t>& stats);
+
 void set_standalone_args(folly::StringPiece args);
 
 }}} // facebook::memcache::mcrouter
@@ -0,0 +1,54 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <limits>
+
+#include <gtest/gtest.h>
+
+#include "mcrouter/LatencyHistogram.h"
+
+using facebook::memcache::mcrouter::LatencyHistogram;
+
+TEST(LatencyHistogram, sanity) {
+  LatencyHistogram hist;
+  EXPECT_EQ(0, hist.count());
+  EXPECT_DOUBLE_EQ(0.0, hist.getPercentile(99));
+
+  for (uint64_t i = 1; i <= 1000; ++i) {
+    hist.insertSample(i);
+  }
+  EXPECT_EQ(1000, hist.count());
+
+  // Log-linear buckets bound the relative error by the sub-bucket width.
+  EXPECT_NEAR(500, hist.getPercentile(50), 500 * 0.07);
+  EXPECT_NEAR(990, hist.getPercentile(99), 990 * 0.07);
+}
+
+TEST(LatencyHistogram, out_of_range) {
+  LatencyHistogram hist;
+  hist.insertSample(0);
+  hist.insertSample(std::numeric_limits<uint64_t>::max());
+  EXPECT_EQ(2, hist.count());
+  EXPECT_LE(0.0, hist.getPercentile(0));
+  // Huge samples saturate into the last bucket instead of overflowing.
+  EXPECT_GE(1ULL << 26, hist.getPercentile(100));
+}
+
+TEST(LatencyHistogram, merge) {
+  LatencyHistogram a;
+  LatencyHistogram b;
+  for (size_t i = 0; i < 1000; ++i) {
+    a.insertSample(100);
+    b.insertSample(10000);
+  }
+  a.merge(b);
+  EXPECT_EQ(2000, a.count());
+  EXPECT_NEAR(100, a.getPercentile(25), 100 * 0.07);
+  EXPECT_NEAR(10000, a.getPercentile(75), 10000 * 0.07);
+}
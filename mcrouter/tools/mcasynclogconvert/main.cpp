@@ -0,0 +1,61 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <iostream>
+#include <string>
+
+#include <folly/FileUtil.h>
+#include <folly/Range.h>
+
+#include "mcrouter/AsynclogSpoolFormat.h"
+
+using namespace facebook::memcache::mcrouter;
+
+namespace {
+
+/**
+ * Converts a binary asynclog spool (see mcrouter/AsynclogSpoolFormat.h,
+ * written with --use-asynclog-binary-format) to the equivalent asynclog
+ * version 2.0 JSON lines on stdout, for consumers of the old format.
+ */
+int convert(const std::string& path) {
+  std::string data;
+  if (!folly::readFile(path.c_str(), data)) {
+    std::cerr << "Can't read " << path << std::endl;
+    return 1;
+  }
+
+  folly::StringPiece buffer(data);
+  size_t records = 0;
+  AsynclogBinaryRecord record;
+  while (!buffer.empty() && parseAsynclogRecord(buffer, record)) {
+    std::cout << asynclogRecordToJsonLine(record);
+    ++records;
+  }
+  if (!buffer.empty()) {
+    std::cerr << path << ": stopped after " << records << " records, "
+              << buffer.size() << " trailing bytes unparseable" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " SPOOL_FILE..." << std::endl;
+    return 1;
+  }
+  int ret = 0;
+  for (int i = 1; i < argc; ++i) {
+    ret |= convert(argv[i]);
+  }
+  return ret;
+}
@@ -0,0 +1,338 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <glog/logging.h>
+
+#include <folly/fibers/EventBaseLoopController.h>
+#include <folly/fibers/FiberManager.h>
+#include <folly/FileUtil.h>
+#include <folly/Format.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/json.h>
+#include <folly/Memory.h>
+
+#include "mcrouter/AsynclogSpoolFormat.h"
+#include "mcrouter/lib/mc/msg.h"
+#include "mcrouter/lib/mc/protocol.h"
+#include "mcrouter/lib/network/AsyncMcClient.h"
+#include "mcrouter/lib/network/gen/Memcache.h"
+
+using namespace facebook::memcache;
+using namespace facebook::memcache::mcrouter;
+
+namespace {
+
+struct Settings {
+  std::vector<std::string> spools;
+  std::string checkpoint;
+  std::string protocol{"ascii"};
+  size_t maxInflight{100};
+  size_t timeoutMs{1000};
+};
+
+struct SpoolDelete {
+  std::string host;
+  uint16_t port;
+  std::string key;
+};
+
+/**
+ * Extracts host and port from the "[host]:port" form the asynclog
+ * version 2.0 "h" field uses.
+ */
+bool parseHostPort(folly::StringPiece hp, std::string& host, uint16_t& port) {
+  if (hp.empty() || hp.front() != '[') {
+    return false;
+  }
+  const auto closing = hp.str().rfind("]:");
+  if (closing == std::string::npos) {
+    return false;
+  }
+  host = hp.subpiece(1, closing - 1).str();
+  try {
+    port = folly::to<uint16_t>(hp.subpiece(closing + 2));
+  } catch (const std::exception&) {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Parses one spool file into delete entries. Handles the binary format
+ * (see mcrouter/AsynclogSpoolFormat.h) and the version 1.0/2.0 JSON
+ * line formats; lines that don't parse are counted and skipped, the
+ * way the production consumer treats them.
+ */
+bool parseSpool(const std::string& path, std::vector<SpoolDelete>& deletes) {
+  std::string data;
+  if (!folly::readFile(path.c_str(), data)) {
+    std::cerr << "Can't read " << path << std::endl;
+    return false;
+  }
+
+  size_t skipped = 0;
+  folly::StringPiece buffer(data);
+  AsynclogBinaryRecord record;
+  if (parseAsynclogRecord(buffer, record)) {
+    do {
+      deletes.push_back(
+          {record.host.str(), record.port, record.key.str()});
+    } while (parseAsynclogRecord(buffer, record));
+    if (!buffer.empty()) {
+      std::cerr << path << ": " << buffer.size()
+                << " trailing bytes unparseable" << std::endl;
+    }
+  } else {
+    while (!buffer.empty()) {
+      auto line = buffer.split_step('\n');
+      if (line.empty()) {
+        continue;
+      }
+      SpoolDelete del;
+      try {
+        auto json = folly::parseJson(line);
+        const auto& magic = json[0].getString();
+        const auto& entry = json[3];
+        if (magic == "AS1.0") {
+          /* ["host", port, "delete key\r\n"] */
+          del.host = entry[0].getString();
+          del.port = folly::to<uint16_t>(entry[1].getInt());
+          auto cmd = entry[2].getString();
+          if (cmd.compare(0, 7, "delete ") != 0) {
+            throw std::runtime_error("not a delete");
+          }
+          del.key = cmd.substr(7, cmd.size() - 7 - 2 /* \r\n */);
+        } else if (magic == "AS2.0") {
+          /* {"f":flavor,"h":"[host]:port","p":pool,"k":key} */
+          if (!parseHostPort(entry["h"].getString(), del.host, del.port)) {
+            throw std::runtime_error("bad h field");
+          }
+          del.key = entry["k"].getString();
+        } else {
+          throw std::runtime_error("unknown magic");
+        }
+      } catch (const std::exception&) {
+        ++skipped;
+        continue;
+      }
+      deletes.push_back(std::move(del));
+    }
+    if (skipped > 0) {
+      std::cerr << path << ": skipped " << skipped << " unparseable lines"
+                << std::endl;
+    }
+  }
+  return true;
+}
+
+/**
+ * Replays spooled deletes against the destinations they were recorded
+ * for, one pipelined connection per destination, with a global bound
+ * on requests in flight. Finished spool files are recorded in the
+ * checkpoint file so an interrupted replay can resume where it
+ * stopped.
+ */
+class Replayer {
+ public:
+  explicit Replayer(const Settings& settings)
+      : settings_(settings),
+        protocol_(mc_string_to_protocol(settings.protocol.c_str())),
+        fiberManager_(
+            folly::make_unique<folly::fibers::EventBaseLoopController>()) {
+    dynamic_cast<folly::fibers::EventBaseLoopController&>(
+        fiberManager_.loopController()).attachEventBase(eventBase_);
+  }
+
+  bool replayFile(const std::string& path) {
+    std::vector<SpoolDelete> deletes;
+    if (!parseSpool(path, deletes)) {
+      return false;
+    }
+
+    const auto timeout = std::chrono::milliseconds(settings_.timeoutMs);
+    size_t fileErrors = 0;
+    for (const auto& del : deletes) {
+      while (inflight_ >= settings_.maxInflight) {
+        eventBase_.loopOnce();
+      }
+      ++inflight_;
+      auto& client = clientFor(del.host, del.port);
+      fiberManager_.addTask([this, &client, &del, &fileErrors, timeout]() {
+        McDeleteRequest req(del.key);
+        auto reply = client.sendSync(req, timeout);
+        // not_found just means the delete already went through.
+        if (mc_res_is_err(reply.result())) {
+          ++fileErrors;
+        }
+        --inflight_;
+      });
+      eventBase_.loopOnce(EVLOOP_NONBLOCK);
+    }
+    while (inflight_ > 0) {
+      eventBase_.loopOnce();
+    }
+
+    replayed_ += deletes.size() - fileErrors;
+    errors_ += fileErrors;
+    if (fileErrors > 0) {
+      std::cerr << path << ": " << fileErrors << " of " << deletes.size()
+                << " deletes failed; not checkpointing this file"
+                << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  size_t replayed() const { return replayed_; }
+  size_t errors() const { return errors_; }
+
+ private:
+  AsyncMcClient& clientFor(const std::string& host, uint16_t port) {
+    auto& client = clients_[folly::sformat("[{}]:{}", host, port)];
+    if (!client) {
+      client = folly::make_unique<AsyncMcClient>(
+          eventBase_, ConnectionOptions(host, port, protocol_));
+      client->setThrottle(settings_.maxInflight, 0);
+    }
+    return *client;
+  }
+
+  const Settings& settings_;
+  const mc_protocol_t protocol_;
+  folly::EventBase eventBase_;
+  folly::fibers::FiberManager fiberManager_;
+  std::unordered_map<std::string, std::unique_ptr<AsyncMcClient>> clients_;
+  size_t inflight_{0};
+  size_t replayed_{0};
+  size_t errors_{0};
+};
+
+std::unordered_set<std::string> loadCheckpoint(const std::string& path) {
+  std::unordered_set<std::string> done;
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty()) {
+      done.insert(line);
+    }
+  }
+  return done;
+}
+
+Settings parseOptions(int argc, char** argv) {
+  Settings settings;
+
+  namespace po = boost::program_options;
+
+  po::options_description namedOpts("Allowed options");
+  namedOpts.add_options()
+    ("help,h", "Print this help message.")
+    ("checkpoint",
+      po::value<std::string>(&settings.checkpoint),
+      "Progress file; fully replayed spool files are recorded there and "
+      "skipped on restart.")
+    ("protocol",
+      po::value<std::string>(&settings.protocol),
+      "Protocol to use: ascii|umbrella|caret (default: ascii).")
+    ("max-inflight",
+      po::value<size_t>(&settings.maxInflight),
+      "Max number of deletes waiting for reply (default: 100).")
+    ("timeout-ms",
+      po::value<size_t>(&settings.timeoutMs),
+      "Per-request timeout, in ms (default: 1000).");
+
+  po::options_description allOpts;
+  allOpts.add(namedOpts);
+  allOpts.add_options()
+    ("spool", po::value<std::vector<std::string>>(&settings.spools));
+  po::positional_options_description positional;
+  positional.add("spool", -1);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv)
+                  .options(allOpts).positional(positional).run(),
+              vm);
+    po::notify(vm);
+  } catch (const po::error& ex) {
+    std::cerr << ex.what() << std::endl;
+    exit(1);
+  }
+
+  if (vm.count("help") || settings.spools.empty()) {
+    std::cerr << "Usage: " << argv[0]
+              << " [OPTION]... SPOOL_FILE..." << std::endl
+              << "Replay asynclog spools (JSON or binary format) against "
+              << "the destinations they were recorded for." << std::endl
+              << std::endl << namedOpts << std::endl;
+    exit(vm.count("help") ? 0 : 1);
+  }
+
+  auto protocol = mc_string_to_protocol(settings.protocol.c_str());
+  if (protocol != mc_ascii_protocol && protocol != mc_umbrella_protocol &&
+      protocol != mc_caret_protocol) {
+    std::cerr << "Invalid protocol. ascii|umbrella|caret expected, got "
+              << settings.protocol << std::endl;
+    exit(1);
+  }
+
+  return settings;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  auto settings = parseOptions(argc, argv);
+
+  std::unordered_set<std::string> done;
+  if (!settings.checkpoint.empty()) {
+    done = loadCheckpoint(settings.checkpoint);
+  }
+  std::ofstream checkpoint;
+  if (!settings.checkpoint.empty()) {
+    checkpoint.open(settings.checkpoint, std::ios::app);
+    if (!checkpoint) {
+      std::cerr << "Can't open checkpoint file " << settings.checkpoint
+                << std::endl;
+      return 1;
+    }
+  }
+
+  Replayer replayer(settings);
+  int ret = 0;
+  for (const auto& spool : settings.spools) {
+    if (done.count(spool)) {
+      std::cerr << "Skipping " << spool << " (already checkpointed)"
+                << std::endl;
+      continue;
+    }
+    if (replayer.replayFile(spool)) {
+      if (checkpoint.is_open()) {
+        checkpoint << spool << std::endl;
+      }
+    } else {
+      ret = 1;
+    }
+  }
+
+  std::cout << "replayed: " << replayer.replayed() << std::endl
+            << "errors: " << replayer.errors() << std::endl;
+  return ret;
+}
@@ -193,6 +193,7 @@ FifoReaderManager::FifoReaderManager(
       directory_(std::move(dir)),
       filenamePattern_(std::move(filenamePattern)) {
   runScanDirectory();
+  runPollRings();
 }
 
 std::vector<std::string> FifoReaderManager::getMatchedFiles() const {
@@ -210,6 +211,10 @@ std::vector<std::string> FifoReaderManager::getMatchedFiles() const {
           continue;
         }
         auto& path = it->path();
+        if (path.extension() == ".ring") {
+          // Shared-memory rings we created next to the fifos.
+          continue;
+        }
         if (!filenamePattern_ ||
             boost::regex_search(path.filename().string(),
                                 *filenamePattern_,
@@ -241,6 +246,18 @@ void FifoReaderManager::runScanDirectory() {
       fifoReaders_.emplace(fifo,
                            FifoReader(std::move(pipeReader),
                                       std::move(callback)));
+
+      // Offer the writer a shared-memory ring as well; writers that
+      // support it switch their stream over on their next connect pass.
+      auto ring = folly::make_unique<ShmRingReader>(fifo + ".ring",
+                                                    kRingBufSize);
+      if (ring->initialized()) {
+        ringReaders_.emplace(
+            fifo,
+            RingReader(std::move(ring),
+                       folly::make_unique<FifoReadCallback>(fifo,
+                                                            messageReady_)));
+      }
     } else {
       PLOG(WARNING) << "Error opening fifo: " << fifo;
     }
@@ -251,4 +268,29 @@ void FifoReaderManager::runScanDirectory() {
     }, kPollDirectoryIntervalMs);
 }
 
+void FifoReaderManager::runPollRings() {
+  for (auto& it : ringReaders_) {
+    auto& ring = it.second.first;
+    auto& callback = it.second.second;
+    ring->read([&callback](const void* buf, size_t len) {
+      // Feed the record through the same parsing path the pipe uses.
+      auto data = static_cast<const char*>(buf);
+      while (len > 0) {
+        void* readBuf;
+        size_t readBufLen;
+        callback->getReadBuffer(&readBuf, &readBufLen);
+        auto chunk = std::min(len, readBufLen);
+        std::memcpy(readBuf, data, chunk);
+        callback->readDataAvailable(chunk);
+        data += chunk;
+        len -= chunk;
+      }
+    });
+  }
+
+  evb_.runAfterDelay([this]() {
+      runPollRings();
+    }, kPollRingIntervalMs);
+}
+
 }} // facebook::memcache
@@ -23,6 +23,7 @@
 #include <folly/SocketAddress.h>
 
 #include "mcrouter/lib/debug/ConnectionFifoProtocol.h"
+#include "mcrouter/lib/debug/ShmRing.h"
 
 namespace folly {
 class EventBase;
@@ -111,16 +112,26 @@ class FifoReaderManager {
  private:
   using FifoReader = std::pair<folly::AsyncPipeReader::UniquePtr,
                                std::unique_ptr<FifoReadCallback>>;
+  using RingReader = std::pair<std::unique_ptr<ShmRingReader>,
+                               std::unique_ptr<FifoReadCallback>>;
 
   static constexpr size_t kPollDirectoryIntervalMs = 1000;
+  static constexpr size_t kPollRingIntervalMs = 10;
+  // Size of the ring requested for each fifo; absorbs bursts that would
+  // overflow the pipe, see lib/debug/ShmRing.h.
+  static constexpr uint32_t kRingBufSize = 4 * 1024 * 1024;
   folly::EventBase& evb_;
   MessageReadyFn messageReady_;
   const std::string directory_;
   const std::unique_ptr<boost::regex> filenamePattern_;
   std::unordered_map<std::string, FifoReader> fifoReaders_;
+  // Shared-memory rings created next to each fifo; writers that know
+  // about them send their stream there instead of the pipe.
+  std::unordered_map<std::string, RingReader> ringReaders_;
 
   std::vector<std::string> getMatchedFiles() const;
   void runScanDirectory();
+  void runPollRings();
 };
 
 }} // facebook::memcache
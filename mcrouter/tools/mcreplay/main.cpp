@@ -0,0 +1,340 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <glog/logging.h>
+
+#include <folly/fibers/EventBaseLoopController.h>
+#include <folly/fibers/FiberManager.h>
+#include <folly/FileUtil.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/Memory.h>
+
+#include "mcrouter/LatencyHistogram.h"
+#include "mcrouter/lib/debug/ConnectionFifoProtocol.h"
+#include "mcrouter/lib/network/AsyncMcClient.h"
+#include "mcrouter/tools/mcpiper/ClientServerMcParser.h"
+
+/**
+ * Replays a captured mcrouter traffic stream against a running mcrouter
+ * (or memcached/MockMcServer) and reports throughput and latency
+ * percentiles.
+ *
+ * The capture is a raw dump of a ConnectionFifo debug stream -- the same
+ * format mcpiper consumes. To record one, point mcrouter's --debug-fifo-root
+ * at a directory and copy the fifo's bytes to a file, e.g.:
+ *
+ *   cat /var/mcrouter/fifos/mcrouter.debug.fifo > capture.bin
+ *
+ * Only requests are replayed; replies present in the capture are ignored.
+ * Inter-arrival times come from the capture's own timestamps and can be
+ * compressed with --speedup (0 replays as fast as --max-inflight allows).
+ *
+ * A typical benchmark setup runs MockMcServer (from
+ * mcrouter/lib/network/test) as the backend so that measured latency is
+ * dominated by mcrouter itself.
+ */
+
+using namespace facebook::memcache;
+
+namespace {
+
+struct Settings {
+  std::string capture;
+  std::string host{"localhost"};
+  uint16_t port{0};
+  std::string protocol{"ascii"};
+  double speedup{1.0};
+  size_t maxInflight{100};
+  size_t timeoutMs{1000};
+  size_t loops{1};
+};
+
+struct ReplayRequest {
+  uint64_t captureTimeUs;
+  std::function<mc_res_t(AsyncMcClient&, std::chrono::milliseconds)> send;
+};
+
+/**
+ * Callback of ClientServerMcParser that collects the requests of the
+ * capture, type-erased into closures that send them via AsyncMcClient.
+ */
+class RequestCollector {
+ public:
+  explicit RequestCollector(std::vector<ReplayRequest>& requests)
+      : requests_(requests) {}
+
+  void setCurrentMsgTime(uint64_t timeUs) {
+    currentMsgTimeUs_ = timeUs;
+  }
+
+  template <class Request>
+  void requestReady(uint64_t, Request&& req) {
+    if (std::is_same<Request, McQuitRequest>::value ||
+        std::is_same<Request, McShutdownRequest>::value) {
+      // Control requests in the capture must not take the target down.
+      return;
+    }
+    auto shared = std::make_shared<Request>(std::move(req));
+    auto timeUs = currentMsgTimeUs_;
+    requests_.push_back(
+        {timeUs,
+         [shared](AsyncMcClient& client, std::chrono::milliseconds timeout) {
+           return client.sendSync(*shared, timeout).result();
+         }});
+  }
+
+  template <class Reply>
+  void replyReady(uint64_t, Reply&&, ReplyStatsContext) {}
+
+ private:
+  std::vector<ReplayRequest>& requests_;
+  uint64_t currentMsgTimeUs_{0};
+};
+
+using CaptureParser = ClientServerMcParser<RequestCollector>;
+
+/**
+ * Walks the MessageHeader/PacketHeader framing of the capture and feeds
+ * request packets into a per-connection parser.
+ */
+bool parseCapture(folly::StringPiece data,
+                  std::vector<ReplayRequest>& requests) {
+  RequestCollector collector(requests);
+  std::unordered_map<uint64_t, std::unique_ptr<CaptureParser>> parsers;
+
+  MessageHeader msgHeader;
+  size_t pos = 0;
+  while (pos + sizeof(uint32_t) <= data.size()) {
+    uint32_t rawMagic;
+    std::memcpy(&rawMagic, data.begin() + pos, sizeof(rawMagic));
+    if (folly::Endian::little(rawMagic) == MessageHeader().magic()) {
+      if (pos + sizeof(uint32_t) + sizeof(uint8_t) > data.size()) {
+        break;
+      }
+      const uint8_t version = data[pos + sizeof(uint32_t)];
+      const size_t headerSize = MessageHeader::size(version);
+      if (headerSize > sizeof(MessageHeader) ||
+          pos + headerSize > data.size()) {
+        break;
+      }
+      std::memcpy(&msgHeader, data.begin() + pos, headerSize);
+      pos += headerSize;
+      continue;
+    }
+
+    if (pos + sizeof(PacketHeader) > data.size()) {
+      break;
+    }
+    PacketHeader packetHeader;
+    std::memcpy(&packetHeader, data.begin() + pos, sizeof(packetHeader));
+    pos += sizeof(packetHeader);
+    if (packetHeader.packetSize() > kFifoMaxPacketSize ||
+        pos + packetHeader.packetSize() > data.size()) {
+      break;
+    }
+    folly::ByteRange packet(
+        reinterpret_cast<const uint8_t*>(data.begin() + pos),
+        packetHeader.packetSize());
+    pos += packetHeader.packetSize();
+
+    // Requests have odd type ids; everything else is reply traffic.
+    if (msgHeader.typeId() % 2 != 1) {
+      continue;
+    }
+
+    auto& parser = parsers[packetHeader.connectionId()];
+    if (!parser) {
+      parser = folly::make_unique<CaptureParser>(collector);
+    }
+    if (packetHeader.packetId() == 0) {
+      parser->reset();
+    }
+    collector.setCurrentMsgTime(msgHeader.timeUs());
+    parser->parse(packet, msgHeader.typeId(),
+                  packetHeader.packetId() == 0 /* isFirstPacket */);
+  }
+
+  return pos == data.size();
+}
+
+uint64_t nowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int replay(const Settings& settings,
+           const std::vector<ReplayRequest>& requests) {
+  folly::EventBase eventBase;
+  folly::fibers::FiberManager fiberManager(
+      folly::make_unique<folly::fibers::EventBaseLoopController>());
+  dynamic_cast<folly::fibers::EventBaseLoopController&>(
+      fiberManager.loopController()).attachEventBase(eventBase);
+
+  auto protocol = mc_string_to_protocol(settings.protocol.c_str());
+  if (protocol != mc_ascii_protocol && protocol != mc_umbrella_protocol &&
+      protocol != mc_caret_protocol) {
+    std::cerr << "Invalid protocol. ascii|umbrella|caret expected, got "
+              << settings.protocol << std::endl;
+    return 1;
+  }
+  AsyncMcClient client(
+      eventBase, ConnectionOptions(settings.host, settings.port, protocol));
+  client.setThrottle(settings.maxInflight, 0);
+
+  mcrouter::LatencyHistogram latencyUs;
+  size_t inflight = 0;
+  size_t errors = 0;
+  const auto timeout = std::chrono::milliseconds(settings.timeoutMs);
+
+  const auto startUs = nowUs();
+  for (size_t loop = 0; loop < settings.loops; ++loop) {
+    const uint64_t loopStartUs = nowUs();
+    const uint64_t captureBaseUs = requests.front().captureTimeUs;
+    for (const auto& request : requests) {
+      if (settings.speedup > 0 &&
+          request.captureTimeUs > captureBaseUs) {
+        const uint64_t targetUs = loopStartUs +
+            (request.captureTimeUs - captureBaseUs) / settings.speedup;
+        while (nowUs() < targetUs) {
+          eventBase.loopOnce(EVLOOP_NONBLOCK);
+        }
+      }
+      while (inflight >= settings.maxInflight) {
+        eventBase.loopOnce();
+      }
+
+      ++inflight;
+      fiberManager.addTask(
+          [&client, &request, &latencyUs, &inflight, &errors, timeout]() {
+            const auto sentUs = nowUs();
+            auto result = request.send(client, timeout);
+            latencyUs.insertSample(nowUs() - sentUs);
+            if (mc_res_is_err(result)) {
+              ++errors;
+            }
+            --inflight;
+          });
+      eventBase.loopOnce(EVLOOP_NONBLOCK);
+    }
+  }
+  while (inflight > 0) {
+    eventBase.loopOnce();
+  }
+  const double durationSec = (nowUs() - startUs) / 1e6;
+
+  const size_t total = requests.size() * settings.loops;
+  std::cout << "requests: " << total << std::endl
+            << "errors: " << errors << std::endl
+            << "duration_sec: " << durationSec << std::endl
+            << "qps: " << static_cast<size_t>(total / durationSec)
+            << std::endl
+            << "p50_latency_us: " << latencyUs.getPercentile(0.5) << std::endl
+            << "p95_latency_us: " << latencyUs.getPercentile(0.95) << std::endl
+            << "p99_latency_us: " << latencyUs.getPercentile(0.99) << std::endl
+            << "p999_latency_us: " << latencyUs.getPercentile(0.999)
+            << std::endl;
+
+  return errors == total ? 1 : 0;
+}
+
+Settings parseOptions(int argc, char** argv) {
+  Settings settings;
+
+  namespace po = boost::program_options;
+
+  po::options_description namedOpts("Allowed options");
+  namedOpts.add_options()
+    ("help,h", "Print this help message.")
+    ("capture,c",
+      po::value<std::string>(&settings.capture),
+      "Capture file to replay (raw dump of a ConnectionFifo stream).")
+    ("host,H",
+      po::value<std::string>(&settings.host),
+      "Host to send requests to (default: localhost).")
+    ("port,p",
+      po::value<uint16_t>(&settings.port),
+      "Port to send requests to.")
+    ("protocol",
+      po::value<std::string>(&settings.protocol),
+      "Protocol to use: ascii|umbrella|caret (default: ascii).")
+    ("speedup,s",
+      po::value<double>(&settings.speedup),
+      "Replay time compression factor; 2 halves the capture's "
+      "inter-arrival gaps, 0 replays as fast as possible (default: 1).")
+    ("max-inflight",
+      po::value<size_t>(&settings.maxInflight),
+      "Max number of requests waiting for reply (default: 100).")
+    ("timeout-ms",
+      po::value<size_t>(&settings.timeoutMs),
+      "Per-request timeout, in ms (default: 1000).")
+    ("loops,n",
+      po::value<size_t>(&settings.loops),
+      "Number of times to replay the capture (default: 1).");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, namedOpts), vm);
+    po::notify(vm);
+  } catch (const po::error& ex) {
+    std::cerr << ex.what() << std::endl;
+    exit(1);
+  }
+
+  if (vm.count("help") || settings.capture.empty() || settings.port == 0) {
+    std::cerr << "Usage: " << argv[0]
+              << " --capture FILE --port PORT [OPTION]..." << std::endl
+              << "Replay a mcrouter traffic capture against HOST:PORT."
+              << std::endl << std::endl
+              << namedOpts << std::endl;
+    exit(vm.count("help") ? 0 : 1);
+  }
+
+  return settings;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  auto settings = parseOptions(argc, argv);
+
+  std::string data;
+  if (!folly::readFile(settings.capture.c_str(), data)) {
+    std::cerr << "Can't read " << settings.capture << std::endl;
+    return 1;
+  }
+
+  std::vector<ReplayRequest> requests;
+  if (!parseCapture(data, requests)) {
+    std::cerr << "Warning: trailing garbage in " << settings.capture
+              << "; replaying the " << requests.size()
+              << " requests parsed before it." << std::endl;
+  }
+  if (requests.empty()) {
+    std::cerr << "No requests found in " << settings.capture << std::endl;
+    return 1;
+  }
+  std::cerr << "Replaying " << requests.size() << " requests "
+            << settings.loops << " time(s) against " << settings.host << ":"
+            << settings.port << std::endl;
+
+  return replay(settings, requests);
+}
@@ -0,0 +1,121 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <folly/FileUtil.h>
+#include <folly/json.h>
+
+#include "mcrouter/StatsBinaryLog.h"
+#include "mcrouter/stats.h"
+
+using facebook::memcache::mcrouter::StatsBinaryLog;
+
+namespace {
+
+/**
+ * Dumps the live records of a binary stats log (see
+ * mcrouter/StatsBinaryLog.h) as one JSON object per line, oldest first.
+ * Records being overwritten while we read may be skipped.
+ */
+int dump(const std::string& path) {
+  std::string data;
+  if (!folly::readFile(path.c_str(), data)) {
+    std::cerr << "Can't read " << path << std::endl;
+    return 1;
+  }
+  if (data.size() < sizeof(StatsBinaryLog::Header)) {
+    std::cerr << path << ": too short to be a binary stats log" << std::endl;
+    return 1;
+  }
+
+  StatsBinaryLog::Header header;
+  ::memcpy(&header, data.data(), sizeof(header));
+  if (header.magic != StatsBinaryLog::kMagic) {
+    std::cerr << path << ": bad magic" << std::endl;
+    return 1;
+  }
+  if (header.version != StatsBinaryLog::kVersion) {
+    std::cerr << path << ": unsupported version " << header.version
+              << std::endl;
+    return 1;
+  }
+  if (data.size() < header.recordsOffset +
+          static_cast<size_t>(header.numRecords) * header.recordSize ||
+      header.metadataOffset + header.metadataSize > header.recordsOffset) {
+    std::cerr << path << ": truncated" << std::endl;
+    return 1;
+  }
+
+  auto names = folly::parseJson(folly::StringPiece(
+      data.data() + header.metadataOffset, header.metadataSize));
+  if (names.size() != header.numStats) {
+    std::cerr << path << ": metadata doesn't match numStats" << std::endl;
+    return 1;
+  }
+
+  const uint64_t nextSeq = header.nextSeq;
+  const uint64_t firstSeq =
+      nextSeq > header.numRecords ? nextSeq - header.numRecords + 1 : 1;
+  for (uint64_t seq = firstSeq; seq <= nextSeq; ++seq) {
+    const char* record = data.data() + header.recordsOffset +
+        ((seq - 1) % header.numRecords) * header.recordSize;
+    uint64_t recordSeq;
+    ::memcpy(&recordSeq, record, sizeof(recordSeq));
+    if (recordSeq != seq) {
+      // Overwritten (or torn) while reading; skip.
+      continue;
+    }
+    uint64_t timeMs;
+    ::memcpy(&timeMs, record + sizeof(uint64_t), sizeof(timeMs));
+
+    const char* values = record + 2 * sizeof(uint64_t);
+    const uint8_t* types = reinterpret_cast<const uint8_t*>(
+        values + header.numStats * sizeof(uint64_t));
+
+    folly::dynamic obj = folly::dynamic::object("time_ms", timeMs);
+    for (uint32_t i = 0; i < header.numStats; ++i) {
+      uint64_t raw;
+      ::memcpy(&raw, values + i * sizeof(uint64_t), sizeof(raw));
+      const auto name = names[i].stringPiece();
+      switch (types[i]) {
+        case facebook::memcache::mcrouter::stat_uint64:
+          obj[name] = raw;
+          break;
+        case facebook::memcache::mcrouter::stat_int64:
+          obj[name] = static_cast<int64_t>(raw);
+          break;
+        case facebook::memcache::mcrouter::stat_double: {
+          double dbl;
+          ::memcpy(&dbl, &raw, sizeof(dbl));
+          obj[name] = dbl;
+          break;
+        }
+        default:
+          break;
+      }
+    }
+    std::cout << folly::toJson(obj) << std::endl;
+  }
+  return 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    std::cerr << "usage: " << argv[0] << " <stats.bin file>" << std::endl;
+    return 1;
+  }
+  return dump(argv[1]);
+}